@@ -0,0 +1,733 @@
+/*
+ * INQP Aggregate: group lookup and child report merging against the
+ * number of groups and children.
+ *
+ * The aggregation is GROUP BY g with SUM, COUNT, MIN, MAX and AVG of an
+ * INTEGER value v. For g groups and c children
+ *  - local: 4g local rows (g, v) are pushed in random order, then the end
+ *    of input
+ *  - child: a stream of reports from random children for random groups,
+ *    every report covers its previous one plus a few more values (as
+ *    aggregate operators report)
+ * with Aggregate and with its former implementation (linear group search
+ * in every table, kept here as LegacyAggregate). Before timing both are
+ * fed the same data and have to send the same rows.
+ *
+ * Output: groups children impl local_us_per_row child_us_per_report
+ *
+ * Usage: aggregate_benchmark
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#define INQP_AGGREGATE_CHECK_INTERVAL 1000
+	#define WISELIB_TIME_FACTOR 1
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <map>
+#include <vector>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/types.h>
+#include <util/pstl/map_static_vector.h>
+#include <algorithms/rdf/inqp/row.h>
+#include <algorithms/rdf/inqp/table.h>
+#include <algorithms/rdf/inqp/operators/aggregate.h>
+
+typedef Row<Os> RowT;
+typedef RowT::Value Value;
+
+enum { MAX_NEIGHBORS = 64 };
+
+/**
+ * The parts of INQPQueryProcessor the aggregate operator uses.
+ */
+class Processor {
+	public:
+		typedef Processor self_type;
+		typedef ::uint8_t operator_id_t;
+		typedef ::uint8_t query_id_t;
+		typedef ::RowT RowT;
+		typedef RowT::Value Value;
+		typedef Processor Dictionary;
+		typedef Processor Translator;
+		typedef Processor ReverseTranslator;
+		
+		enum { COMMUNICATION_TYPE_AGGREGATE = 'a' };
+		
+		/**
+		 * Remembers the timer callback, it is called by the benchmark.
+		 */
+		class Timer {
+			public:
+				typedef ::uint32_t millis_t;
+				
+				template<typename T, void (T::*TMethod)(void*)>
+				int set_timer(millis_t millis, T* obj, void* userdata) {
+					userdata_ = userdata;
+					return Os::SUCCESS;
+				}
+				
+				void *userdata_;
+		};
+		
+		class Query {
+			public:
+				Query(self_type *p) : processor_(p) { }
+				self_type& processor() { return *processor_; }
+				query_id_t id() { return 1; }
+			private:
+				self_type *processor_;
+		};
+		
+		Processor() : record_(false), sent_(0) { }
+		
+		void send_row(int type, size_type columns, RowT& row, query_id_t qid, operator_id_t oid) {
+			sent_++;
+			if(record_) {
+				std::vector<Value> &r = rows_[row[0]];
+				r.assign(&row[0], &row[0] + columns);
+			}
+		}
+		
+		Timer& timer() { return timer_; }
+		
+		Timer timer_;
+		bool record_;
+		unsigned long sent_;
+		std::map<Value, std::vector<Value> > rows_;
+};
+
+typedef AggregateDescription<Os, Processor> AD;
+typedef Aggregate<Os, Processor, MAX_NEIGHBORS> AggregateT;
+
+/**
+ * The former Aggregate.
+ */
+template<
+	typename OsModel_P,
+	typename Processor_P,
+	int MAX_NEIGHBORS_P
+>
+class LegacyAggregate : public Operator<OsModel_P, Processor_P> {
+	
+	public:
+		typedef OsModel_P OsModel;
+		typedef typename OsModel::block_data_t block_data_t;
+		typedef typename OsModel::size_t size_type;
+		typedef Operator<OsModel_P, Processor_P> Base;
+		typedef typename Base::Query Query;
+		typedef Processor_P Processor;
+		typedef LegacyAggregate self_type;
+		typedef Row<OsModel> RowT;
+		typedef Table<OsModel, RowT> TableT;
+		typedef typename RowT::Value Value;
+		typedef AggregateDescription<OsModel, Processor> AD;
+		
+		typedef typename OsModel::Radio::node_id_t node_id_t;
+		
+		typedef typename RowT::column_mask_t column_mask_t;
+		
+		typedef delegate2<int, RowT&, RowT&> compare_delegate_t;
+		typedef typename ProjectionInfoBase::TypeInfo TypeInfo;
+		
+		enum { npos = (size_type)(-1) };
+		enum { MAX_CHILDS = MAX_NEIGHBORS_P };
+		typedef MapStaticVector<OsModel, node_id_t, TableT, MAX_CHILDS> ChildStates;
+		
+		enum { WAIT_AFTER_LOCAL = 1000 * WISELIB_TIME_FACTOR, CHECK_INTERVAL = INQP_AGGREGATE_CHECK_INTERVAL * WISELIB_TIME_FACTOR };
+		
+		struct TimerInfo { bool alive; };
+		
+		#pragma GCC diagnostic push
+		#pragma GCC diagnostic ignored "-Wpmf-conversions"
+		void init(AggregateDescription<OsModel, Processor> *ad, Query *query) {
+			Base::init(reinterpret_cast<AggregateDescription<OsModel, Processor>*>(ad), query);
+			hardcore_cast(this->destruct_, &self_type::destruct);
+			
+			hardcore_cast(this->push_, &self_type::push);
+			operations_ = 0;
+			post_inited_ = false;
+			
+			aggregation_columns_logical_ = ad->aggregation_columns();
+			aggregation_types_ = ::get_allocator().template allocate_array< ::uint8_t>(aggregation_columns_logical_).raw();
+			memcpy(aggregation_types_, ad->aggregation_types(), aggregation_columns_logical_);
+			timer_info_ = 0;
+		}
+		#pragma GCC diagnostic pop
+		
+		uint8_t *aggregation_types() { return aggregation_types_; }
+		size_type aggregation_columns_logical() { return aggregation_columns_logical_; }
+		
+		void post_init() {
+			if(!post_inited_) {
+				operations_ = ::get_allocator().template allocate_array<Operation>(aggregation_columns_logical_).raw();
+				
+				size_type i = 0, j = 0, k = 0;
+				
+				while(i < aggregation_columns_logical_) {
+					Operation &op = operations_[i];
+					op.data_column_ = k;
+					op.aggregate_column_ = j;
+					op.type_ = this->child(Base::CHILD_LEFT).result_type(k);
+					
+					switch(aggregation_types_[i] & ~AD::AGAIN) {
+						case AD::GROUP:
+							op.aggregate_ = &Operation::aggregate_noop;
+							op.init_ = &Operation::init_value;
+							j += Operation::COLS_GROUP;
+							break;
+						case AD::SUM:
+							op.aggregate_ = &Operation::aggregate_sum;
+							op.init_ = &Operation::init_value;
+							j += Operation::COLS_SUM;
+							break;
+						case AD::AVG:
+							op.aggregate_ = &Operation::aggregate_avg;
+							op.init_ = &Operation::init_avg;
+							j += Operation::COLS_AVG;
+							break;
+						case AD::COUNT:
+							op.aggregate_ = &Operation::aggregate_count;
+							op.init_ = &Operation::init_one;
+							j += Operation::COLS_COUNT;
+							break;
+						case AD::MIN:
+							op.aggregate_ = &Operation::aggregate_min;
+							op.init_ = &Operation::init_value;
+							j += Operation::COLS_MIN;
+							break;
+						case AD::MAX:
+							op.aggregate_ = &Operation::aggregate_max;
+							op.init_ = &Operation::init_value;
+							j += Operation::COLS_MAX;
+							break;
+					}
+					
+					if(!(aggregation_types_[i] & AD::AGAIN)) {
+						k++;
+					}
+					i++;
+				}
+				aggregation_columns_physical_ = j;
+				
+				local_aggregates_.init(aggregation_columns_physical_);
+				updated_aggregates_.init(aggregation_columns_physical_);
+				post_inited_ = true;
+			}
+		}
+		
+		size_type columns_logical() { return aggregation_columns_logical_; }
+		size_type columns_physical() { return aggregation_columns_physical_; }
+		
+		void destruct() {
+			
+			if(timer_info_ != 0) {
+				timer_info_->alive = false;
+			}
+			if(operations_) {
+				::get_allocator().template free_array(operations_);
+				operations_ = 0;
+			}
+			if(aggregation_types_) {
+				::get_allocator().template free_array(aggregation_types_);
+				aggregation_types_ = 0;
+			}
+		}
+		
+		void push(size_type port, RowT& row) {
+			post_init();
+
+			RowT * volatile r = &row;
+			if(r) {
+				size_type idx = find_matching_group(local_aggregates_, row);
+				if(idx == npos) {
+					create_group(row);
+				}
+				else {
+					add_to_aggregate(local_aggregates_[idx], row);
+				}
+			}
+			else {
+				local_aggregates_.pack();
+				
+				for(typename TableT::iterator iter = local_aggregates_.begin(); iter != local_aggregates_.end(); ++iter) {
+					refresh_group(*iter, true);
+				}
+
+				timer_info_ = ::get_allocator().template allocate<TimerInfo>().raw();
+				assert(timer_info_ != 0);
+				timer_info_->alive = true;
+				this->timer().template set_timer<self_type, &self_type::on_sending_time>(WAIT_AFTER_LOCAL, this, (void*)timer_info_);
+			}
+			
+		}
+
+		void refresh_group(RowT& r, bool r_is_output_form = false) {
+			size_type idx = npos;
+			size_type uidx = npos;
+
+			idx = find_matching_group(updated_aggregates_, r);
+			if(idx != npos) {
+				if(idx < updated_aggregates_.size() - 1) {
+					updated_aggregates_.set(idx, updated_aggregates_[updated_aggregates_.size() - 1]);
+				}
+				updated_aggregates_.pop_back();
+			}
+
+			idx = find_matching_group(local_aggregates_, r, r_is_output_form);
+			if(idx != npos) {
+				uidx = merge_or_create_updated(local_aggregates_[idx], uidx);
+			}
+
+			for(typename ChildStates::iterator iter = child_states_.begin(); iter != child_states_.end(); ++iter) {
+				idx = find_matching_group(iter->second, r, r_is_output_form);
+				if(idx != npos) {
+					uidx = merge_or_create_updated(iter->second[idx], uidx);
+				}
+			}
+		}
+
+		size_type merge_or_create_updated(RowT& source, size_type index) {
+			if(index == npos) {
+				index = updated_aggregates_.size();
+				updated_aggregates_.insert(source);
+			}
+			else {
+				merge_aggregates(updated_aggregates_[index], source);
+			}
+			return index;
+		}
+		
+		void on_receive_row(RowT& row, node_id_t from) {
+			if(!child_states_.contains(from)) {
+				child_states_[from].init(aggregation_columns_physical_);
+			}
+				
+			size_type idx = find_matching_group(child_states_[from], row, true);
+			if(idx != npos) {
+				child_states_[from].set(idx, row);
+			}
+			else {
+				child_states_[from].insert(row);
+			}
+			
+			refresh_group(row);
+		}
+		
+		void on_sending_time(void* ti_) {
+			
+			TimerInfo *ti = reinterpret_cast<TimerInfo*>(ti_);
+			if(!ti->alive) {
+				::get_allocator().free(ti);
+				return;
+			}
+			
+			for(typename TableT::iterator iter = updated_aggregates_.begin(); iter != updated_aggregates_.end(); ++iter) {
+				this->processor().send_row(
+						Base::Processor::COMMUNICATION_TYPE_AGGREGATE,
+						aggregation_columns_physical_, *iter, this->query().id(), this->id()
+				);
+			}
+			updated_aggregates_.clear();
+			this->timer().template set_timer<self_type, &self_type::on_sending_time>(CHECK_INTERVAL, this, ti_);
+		}
+
+		size_type find_matching_group(TableT& table, RowT& row, bool row_is_output = false) {
+			for(size_type group = 0; group < table.size(); group++) {
+				RowT& aggregate = table[group];
+				bool match = true;
+				for(size_type i = 0; i < aggregation_columns_logical_; i++) {
+
+					if((aggregation_types_[i] & ~AD::AGAIN) == AD::GROUP
+							&& row[row_is_output ? operations_[i].aggregate_column_ : operations_[i].data_column_] != aggregate[operations_[i].aggregate_column_]) {
+
+						match = false;
+						break;
+					}
+				}
+				if(match) {
+					return group;
+				}
+			}
+			return npos;
+		}
+
+		void create_group(RowT& row) {
+			RowT *aggregate = RowT::create(aggregation_columns_physical_);
+			for(size_type i = 0; i < aggregation_columns_logical_; i++) {
+				operations_[i].init(*aggregate, row);
+			}
+			local_aggregates_.insert(*aggregate);
+			aggregate->destroy();
+		}
+
+		void merge_aggregates(RowT& a, RowT& b) {
+			for(size_type i = 0; i < aggregation_columns_logical_; i++) {
+
+				operations_[i].aggregate(a, b);
+			}
+		}
+
+		void add_to_aggregate(RowT& aggregate, RowT& row) {
+			RowT *converted = RowT::create(aggregation_columns_physical_);
+			for(size_type i = 0; i < aggregation_columns_logical_; i++) {
+				operations_[i].init(*converted, row);
+			}
+			merge_aggregates(aggregate, *converted);
+			converted->destroy();
+		}
+		
+		void execute() {
+		}
+		
+	private:
+		
+		struct Operation {
+			enum AggregateColumns {
+				COLS_SUM = 1, COLS_AVG = 2, COLS_MIN = 1, COLS_MAX = 1, COLS_COUNT = 1,
+				COLS_STD = 2, COLS_GROUP = 1
+			};
+			
+			void init_value(RowT& aggregate, RowT& row) {
+				aggregate[aggregate_column_] = row[data_column_];
+			}
+			
+			void init_one(RowT& aggregate, RowT& row) {
+				aggregate[aggregate_column_] = 1;
+			}
+			
+			void init_avg(RowT& aggregate, RowT& row) {
+				init_value(aggregate, row);
+				aggregate[aggregate_column_ + 1] = 1;
+			}
+			
+			void aggregate_noop(RowT& aggregate1, RowT& aggregate2) {
+			}
+			
+			void aggregate_min(RowT& aggregate1, RowT& aggregate2) {
+				
+				Value& v1 = aggregate1[aggregate_column_];
+				Value& v2 = aggregate2[aggregate_column_];
+				
+				int c = compare_values(type_, v1, v2);
+				if(c > 0) { v1 = v2; }
+			}
+			
+			void aggregate_max(RowT& aggregate1, RowT& aggregate2) {
+				Value& v1 = aggregate1[aggregate_column_];
+				Value& v2 = aggregate2[aggregate_column_];
+				int c = compare_values(type_, v1, v2);
+				if(c < 0) { v1 = v2; }
+			}
+			
+			void aggregate_count(RowT& aggregate1, RowT& aggregate2) {
+				Value& v1 = aggregate1[aggregate_column_];
+				Value& v2 = aggregate2[aggregate_column_];
+				v1 += v2;
+			}
+			
+			void aggregate_sum(RowT& aggregate1, RowT& aggregate2) {
+				Value& v1 = aggregate1[aggregate_column_];
+				Value& v2 = aggregate2[aggregate_column_];
+				Value r = 0;
+				switch(type_) {
+					case ProjectionInfoBase::IGNORE:
+						break;
+					case ProjectionInfoBase::INTEGER: {
+						typedef typename Sint<sizeof(Value)>::t S;
+						r = (Value)((S)v1 + (S)v2);
+						break;
+					}
+					case ProjectionInfoBase::FLOAT: {
+						float f1, f2;
+						memcpy(&f1, &v1, sizeof(f1));
+						memcpy(&f2, &v2, sizeof(f2));
+						float sum = f1 + f2;
+						memcpy(&r, &sum, sizeof(r));
+						break;
+					}
+					case ProjectionInfoBase::STRING:
+						break;
+				};
+				v1 = r;
+			}
+			
+			void aggregate_avg(RowT& aggregate1, RowT& aggregate2) {
+				Value& v1 = aggregate1[aggregate_column_];
+				Value& n1 = aggregate1[aggregate_column_ + 1];
+				
+				Value& v2 = aggregate2[aggregate_column_];
+				Value& n2 = aggregate2[aggregate_column_ + 1];
+				
+				Value r = 0;
+				switch(type_) {
+					case ProjectionInfoBase::IGNORE:
+						break;
+					case ProjectionInfoBase::INTEGER: {
+						typedef unsigned long long ULL;
+						ULL avg = (ULL)v1 * (ULL)n1 + (ULL)v2 * (ULL)n2;
+						ULL avg2 = avg / ((ULL)n1 + (ULL)n2);
+						r = avg2;
+						
+						break;
+					}
+					case ProjectionInfoBase::FLOAT: {
+						float f1, f2;
+						memcpy(&f1, &v1, sizeof(f1));
+						memcpy(&f2, &v2, sizeof(f2));
+						float avg = f1 * (float)n1/(float)(n1 + n2)
+							+ f2 * (float)n2/(float)(n1 + n2);
+						memcpy(&r, &avg, sizeof(r));
+						break;
+					}
+					case ProjectionInfoBase::STRING:
+						break;
+				};
+				
+				v1 = r;
+				n1 += n2;
+			}
+
+			void aggregate(RowT& a1, RowT& a2) {
+				(this->*aggregate_)(a1, a2);
+			}
+			
+			void init(RowT& a, RowT& r) {
+				(this->*init_)(a, r);
+			}
+			
+			void (Operation::*aggregate_)(RowT& aggregate1, RowT& aggregate2);
+			void (Operation::*init_)(RowT& aggregate, RowT& row);
+			
+			size_type aggregate_column_; // physical aggregation column
+			size_type data_column_;
+			int type_;
+		};
+		
+		ChildStates child_states_;
+		TableT local_aggregates_;
+		TableT updated_aggregates_;
+		Operation *operations_;
+		bool post_inited_;
+		uint8_t aggregation_columns_logical_;
+		uint8_t aggregation_columns_physical_;
+		uint8_t *aggregation_types_;
+		TimerInfo *timer_info_;
+	
+};
+
+typedef LegacyAggregate<Os, Processor, MAX_NEIGHBORS> LegacyAggregateT;
+
+/**
+ * A child's running aggregate of one group.
+ */
+struct Partial {
+	long sum;
+	Value count, min, max;
+};
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+			
+			// description: GROUP(g), SUM(v), COUNT(v), MIN(v), MAX(v), AVG(v)
+			memset(description_, 0, sizeof(description_));
+			description_[AD::OFFSET_TYPE] = 'a';
+			block_data_t *types = description_ + AD::OFFSET_AGGREGATION_METHODS;
+			description_[AD::OFFSET_COLUMNS] = 6;
+			types[0] = AD::GROUP;
+			types[1] = AD::SUM | AD::AGAIN;
+			types[2] = AD::COUNT | AD::AGAIN;
+			types[3] = AD::MIN | AD::AGAIN;
+			types[4] = AD::MAX | AD::AGAIN;
+			types[5] = AD::AVG;
+			
+			// (g, v), both INTEGER
+			input_ = ProjectionInfo<Os>(ProjectionInfoBase::INTEGER | ProjectionInfoBase::INTEGER << 2);
+			
+			debug_->debug("# groups children impl local_us_per_row child_us_per_report");
+			static const size_type gs[] = { 100, 1000, 10000 };
+			static const size_type cs[] = { 8, 64 };
+			for(size_type i = 0; i < sizeof(gs) / sizeof(gs[0]); i++) {
+				for(size_type j = 0; j < sizeof(cs) / sizeof(cs[0]); j++) {
+					make_data(gs[i], cs[j], 4000);
+					check(gs[i], cs[j]);
+					run<AggregateT>("aggregate", gs[i], cs[j]);
+					run<LegacyAggregateT>("legacy", gs[i], cs[j]);
+				}
+			}
+		}
+		
+	private:
+		enum { COLUMNS = 7 };
+		
+		double now() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+		}
+		
+		struct Report {
+			size_type child;
+			Value row[COLUMNS];
+		};
+		
+		/**
+		 * Local rows for g groups and n reports of c children.
+		 */
+		void make_data(size_type g, size_type c, size_type n) {
+			srand(g * 100 + c);
+			local_.clear();
+			for(size_type i = 0; i < 4 * g; i++) {
+				local_.push_back(rand() % g);
+				local_.push_back(rand() % 1000);
+			}
+			
+			reports_.clear();
+			std::map<std::pair<size_type, Value>, Partial> partials;
+			for(size_type i = 0; i < n; i++) {
+				Report r;
+				r.child = rand() % c;
+				Value group = rand() % g;
+				Partial &p = partials[std::make_pair(r.child, group)];
+				if(!p.count) { p.sum = 0; p.min = (Value)-1; p.max = 0; }
+				for(int k = 1 + rand() % 3; k; k--) {
+					Value v = rand() % 1000;
+					p.sum += v;
+					p.count++;
+					if(v < p.min) { p.min = v; }
+					if(v > p.max) { p.max = v; }
+				}
+				r.row[0] = group;
+				r.row[1] = (Value)p.sum;
+				r.row[2] = p.count;
+				r.row[3] = p.min;
+				r.row[4] = p.max;
+				r.row[5] = (Value)(p.sum / p.count);
+				r.row[6] = p.count;
+				reports_.push_back(r);
+			}
+		}
+		
+		template<typename Op>
+		void setup(Op& op, Processor::Query& query) {
+			op.init(reinterpret_cast<AD*>(description_), &query);
+			op.set_projection_info(Op::Base::CHILD_LEFT, input_);
+		}
+		
+		template<typename Op>
+		void feed_local(Op& op) {
+			RowT *row = RowT::create(2);
+			for(size_type i = 0; i < local_.size(); i += 2) {
+				(*row)[0] = local_[i];
+				(*row)[1] = local_[i + 1];
+				op.push(0, *row);
+			}
+			row->destroy();
+			RowT *end_of_input = 0;
+			op.push(0, *end_of_input);
+		}
+		
+		template<typename Op>
+		void feed_reports(Op& op) {
+			RowT *row = RowT::create(COLUMNS);
+			for(size_type i = 0; i < reports_.size(); i++) {
+				memcpy(&(*row)[0], reports_[i].row, sizeof(reports_[i].row));
+				op.on_receive_row(*row, reports_[i].child);
+			}
+			row->destroy();
+		}
+		
+		template<typename Op>
+		void run(const char *impl, size_type g, size_type c) {
+			Processor processor;
+			Processor::Query query(&processor);
+			Op op;
+			setup(op, query);
+			
+			double t = now();
+			feed_local(op);
+			double local = now() - t;
+			
+			t = now();
+			feed_reports(op);
+			double child = now() - t;
+			
+			debug_->debug("%lu %lu %s %.3f %.3f", (unsigned long)g, (unsigned long)c, impl,
+					2 * local / local_.size(), child / reports_.size());
+			op.destruct();
+		}
+		
+		template<typename Op>
+		void collect(Op& op, Processor& processor) {
+			Processor::Query query(&processor);
+			setup(op, query);
+			feed_local(op);
+			feed_reports(op);
+			processor.record_ = true;
+			op.on_sending_time(processor.timer().userdata_);
+			op.destruct();
+		}
+		
+		void check(size_type g, size_type c) {
+			Processor p, lp;
+			AggregateT op;
+			LegacyAggregateT legacy;
+			collect(op, p);
+			collect(legacy, lp);
+			
+			if(p.rows_.size() != lp.rows_.size()) { fail("number of groups"); }
+			for(std::map<Value, std::vector<Value> >::iterator it = p.rows_.begin(); it != p.rows_.end(); ++it) {
+				std::vector<Value> &a = it->second;
+				std::vector<Value> &b = lp.rows_[it->first];
+				if(a.size() != COLUMNS || b.size() != COLUMNS) { fail("columns"); }
+				if(a != b) { fail("rows"); }
+			}
+		}
+		
+		void fail(const char *what) {
+			debug_->debug("%s check failed", what);
+			exit(1);
+		}
+		
+		block_data_t description_[32];
+		ProjectionInfo<Os> input_;
+		std::vector<Value> local_;
+		std::vector<Report> reports_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
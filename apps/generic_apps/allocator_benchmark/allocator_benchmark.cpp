@@ -0,0 +1,478 @@
+/*
+ * Replay benchmark of the static buffer allocators.
+ *
+ * First an allocation trace is captured from the tuple store of
+ * tuplestore_example (same setup_tuplestore.h: list_dynamic container,
+ * UnbalancedTreeDictionary, Huffman codec) by running it on a recording
+ * wrapper around MallocFreeAllocator: n RDF-like triples are inserted,
+ * queried by subject, every other one is erased, n/2 more are inserted
+ * and finally the store is emptied.
+ *
+ * The trace (or one read from a file) is then replayed on
+ *  - malloc: malloc() / free() of the C library
+ *  - tlsf: TlsfAllocator (two-level segregated fit)
+ *  - firstfit: FirstFitAllocator
+ *  - bitmap: BitmapAllocator (best fit, 16 byte blocks)
+ * reporting throughput, per operation latency and failed allocations.
+ * For TLSF additionally the peak of allocated bytes (including rounding)
+ * relative to the peak of requested bytes and the consistency of its
+ * block structure after every operation is checked.
+ *
+ * Output: allocator ops mops p50_ns p99_ns max_ns failed
+ *
+ * Usage: allocator_benchmark [n [trace_out]]
+ *        allocator_benchmark -r trace_in
+ *
+ * Trace format: one operation per line, "a <id> <bytes>" or "f <id>".
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	#include "util/allocators/malloc_free_allocator.h"
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+
+#include <util/allocators/tlsf_allocator.h>
+#include <util/allocators/first_fit_allocator.h>
+#include <util/allocators/bitmap_allocator.h>
+
+struct TraceEvent {
+	char op;
+	size_type id;
+	size_type size;
+};
+
+std::vector<TraceEvent> trace_;
+
+/**
+ * MallocFreeAllocator that appends every allocation and free to trace_.
+ */
+class RecordingAllocator : public MallocFreeAllocator<Os> {
+	public:
+		typedef MallocFreeAllocator<Os> Base;
+
+		RecordingAllocator() : next_id_(0) { }
+
+		template<typename T>
+		pointer_t<T> allocate() {
+			pointer_t<T> r = Base::allocate<T>();
+			record_allocate(r.raw(), sizeof(T));
+			return r;
+		}
+
+		template<typename T>
+		array_pointer_t<T> allocate_array(size_type n) {
+			array_pointer_t<T> r = Base::allocate_array<T>(n);
+			record_allocate(r.raw(), n * sizeof(T));
+			return r;
+		}
+
+		template<typename T>
+		int free(pointer_t<T> p) { record_free(p.raw()); return Base::free(p); }
+
+		template<typename T>
+		int free(T* p) { record_free(p); return Base::free(p); }
+
+		template<typename T>
+		int free_array(array_pointer_t<T> p) { record_free(p.raw()); return Base::free_array(p); }
+
+		template<typename T>
+		int free_array(T* p) { record_free(p); return Base::free_array(p); }
+
+	private:
+		void record_allocate(void *p, size_type size) {
+			TraceEvent e = { 'a', next_id_, size };
+			ids_[p] = next_id_++;
+			trace_.push_back(e);
+		}
+
+		void record_free(void *p) {
+			std::map<void*, size_type>::iterator it = ids_.find(p);
+			if(it == ids_.end()) { return; }
+			TraceEvent e = { 'f', it->second, 0 };
+			ids_.erase(it);
+			trace_.push_back(e);
+		}
+
+		size_type next_id_;
+		std::map<void*, size_type> ids_;
+};
+
+typedef RecordingAllocator Allocator;
+Allocator& get_allocator();
+
+#define TS_USE_BLOCK_MEMORY 0
+#include "../tuplestore_example/setup_tuplestore.h"
+
+enum { ARENA_SIZE = 4 << 20, BITMAP_ARENA_SIZE = 1 << 20 };
+
+typedef TlsfAllocator<Os, ARENA_SIZE> Tlsf;
+typedef FirstFitAllocator<Os, ARENA_SIZE, 65535> FirstFit;
+typedef BitmapAllocator<Os, BITMAP_ARENA_SIZE, 16> Bitmap;
+
+/*
+ * The replayers share one interface: alloc(slot, bytes) and free(slot),
+ * slots are dense indices of the live allocations.
+ */
+
+struct MallocReplay {
+	typedef void* value_type;
+	std::vector<value_type> p;
+	bool alloc(size_type slot, size_type n) { p[slot] = malloc(n); return p[slot] != 0; }
+	void free(size_type slot) { ::free(p[slot]); }
+};
+
+struct TlsfReplay {
+	typedef block_data_t* value_type;
+	Tlsf *a;
+	std::vector<value_type> p;
+	bool alloc(size_type slot, size_type n) {
+		p[slot] = a->allocate_array<block_data_t>(n).raw();
+		return p[slot] != 0;
+	}
+	void free(size_type slot) { a->free_array(p[slot]); }
+};
+
+struct FirstFitReplay {
+	typedef FirstFit::array_pointer_t<block_data_t> value_type;
+	FirstFit *a;
+	std::vector<value_type> p;
+	bool alloc(size_type slot, size_type n) {
+		p[slot] = a->allocate_array<block_data_t>(n);
+		return p[slot];
+	}
+	void free(size_type slot) { if(p[slot]) { a->free_array(p[slot]); } }
+};
+
+struct BitmapReplay {
+	typedef block_data_t* value_type;
+	Bitmap *a;
+	std::vector<value_type> p;
+	bool alloc(size_type slot, size_type n) {
+		p[slot] = a->allocate_array<block_data_t>(n).raw();
+		return p[slot] != 0;
+	}
+	void free(size_type slot) { if(p[slot]) { a->free_array(p[slot]); } }
+};
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			if(amp.argc > 2 && std::string(amp.argv[1]) == "-r") {
+				read_trace(amp.argv[2]);
+			}
+			else {
+				size_type n = 2000;
+				if(amp.argc > 1) { n = atol(amp.argv[1]); }
+				capture(n);
+				if(amp.argc > 2) { write_trace(amp.argv[2]); }
+			}
+			prepare();
+
+			debug_->debug("# %lu operations, %lu live at most, peak %lu bytes requested",
+					(unsigned long)events_.size(), (unsigned long)slots_, (unsigned long)peak_requested_);
+
+			check_tlsf_random();
+			check_tlsf_trace();
+
+			debug_->debug("# allocator ops mops p50_ns p99_ns max_ns failed");
+			MallocReplay m;
+			replay(m, "malloc");
+
+			TlsfReplay t;
+			t.a = new Tlsf;
+			replay(t, "tlsf");
+			delete t.a;
+
+			FirstFitReplay f;
+			f.a = new FirstFit;
+			replay(f, "firstfit");
+			delete f.a;
+
+			BitmapReplay b;
+			b.a = new Bitmap;
+			replay(b, "bitmap");
+			delete b.a;
+		}
+
+	private:
+		struct Event {
+			bool alloc;
+			size_type slot;
+			size_type size;
+		};
+
+		double now_ns() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1e9 + ts.tv_nsec;
+		}
+
+		/**
+		 * Run the tuple store workload on the recording allocator.
+		 */
+		void capture(size_type n) {
+			CodecTupleStoreT::Dictionary dictionary;
+			CodecTupleStoreT::TupleContainer container;
+			CodecTupleStoreT tuplestore;
+			dictionary.init(debug_);
+			tuplestore.init(&dictionary, &container, debug_);
+
+			char s[64], p[64], o[64];
+			Tuple t;
+			for(size_type i = 0; i < n + n / 2; i++) {
+				triple(i, s, p, o);
+				t.set(s, p, o);
+				tuplestore.insert(t);
+
+				if(i == n - 1) {
+					// query every subject, erase every other triple
+					for(size_type j = 0; j < n; j++) {
+						triple(j, s, p, o);
+						t.set(s, 0, 0);
+						size_type found = 0;
+						for(CodecTupleStoreT::iterator it = tuplestore.begin(&t, BIN(001)); it != tuplestore.end(); ++it) {
+							found++;
+						}
+						if(j % 2) { continue; }
+						t.set(s, p, o);
+						CodecTupleStoreT::iterator it = tuplestore.begin(&t, BIN(111));
+						if(it != tuplestore.end()) { tuplestore.erase(it); }
+					}
+				}
+			}
+			while(tuplestore.begin() != tuplestore.end()) {
+				tuplestore.erase(tuplestore.begin());
+			}
+		}
+
+		/**
+		 * i-th triple: sensors with a handful of properties and
+		 * observations, values partly shared.
+		 */
+		void triple(size_type i, char *s, char *p, char *o) {
+			static const char *properties[] = { "rdf:type", "ssn:observedProperty", "ssn:hasValue", "rdfs:label", "geo:location" };
+			snprintf(s, 64, "<http://example.org/sensor/%lu>", (unsigned long)(i / 5));
+			snprintf(p, 64, "%s", properties[i % 5]);
+			if(i % 5 == 2) { snprintf(o, 64, "\"%lu.%lu\"", (unsigned long)(i * 7919 % 1000), (unsigned long)(i % 10)); }
+			else { snprintf(o, 64, "<http://example.org/type/%lu>", (unsigned long)(i % 37)); }
+		}
+
+		void read_trace(const char *path) {
+			FILE *f = fopen(path, "r");
+			if(!f) { fail("cannot open trace"); }
+			char op;
+			unsigned long id, size;
+			while(fscanf(f, " %c %lu", &op, &id) == 2) {
+				size = 0;
+				if(op == 'a' && fscanf(f, "%lu", &size) != 1) { break; }
+				TraceEvent e = { op, id, size };
+				trace_.push_back(e);
+			}
+			fclose(f);
+		}
+
+		void write_trace(const char *path) {
+			FILE *f = fopen(path, "w");
+			if(!f) { fail("cannot write trace"); }
+			for(size_type i = 0; i < trace_.size(); i++) {
+				if(trace_[i].op == 'a') { fprintf(f, "a %lu %lu\n", (unsigned long)trace_[i].id, (unsigned long)trace_[i].size); }
+				else { fprintf(f, "f %lu\n", (unsigned long)trace_[i].id); }
+			}
+			fclose(f);
+		}
+
+		/**
+		 * Map allocation ids to reusable slots so replaying needs no
+		 * lookups. Allocations that are never freed are freed at the
+		 * end.
+		 */
+		void prepare() {
+			std::map<size_type, size_type> slot_of;
+			std::vector<size_type> free_slots;
+			size_type requested = 0;
+			std::map<size_type, size_type> size_of;
+			slots_ = 0;
+			peak_requested_ = 0;
+			for(size_type i = 0; i < trace_.size(); i++) {
+				Event e;
+				e.alloc = (trace_[i].op == 'a');
+				if(e.alloc) {
+					if(free_slots.empty()) { free_slots.push_back(slots_++); }
+					e.slot = free_slots.back();
+					free_slots.pop_back();
+					e.size = trace_[i].size;
+					slot_of[trace_[i].id] = e.slot;
+					size_of[trace_[i].id] = e.size;
+					requested += e.size;
+					peak_requested_ = std::max(peak_requested_, requested);
+				}
+				else {
+					std::map<size_type, size_type>::iterator it = slot_of.find(trace_[i].id);
+					if(it == slot_of.end()) { continue; }
+					e.slot = it->second;
+					e.size = 0;
+					free_slots.push_back(e.slot);
+					requested -= size_of[trace_[i].id];
+					slot_of.erase(it);
+				}
+				events_.push_back(e);
+			}
+			for(std::map<size_type, size_type>::iterator it = slot_of.begin(); it != slot_of.end(); ++it) {
+				Event e = { false, it->second, 0 };
+				events_.push_back(e);
+			}
+		}
+
+		template<typename Replay>
+		void replay(Replay& r, const char *name) {
+			enum { ROUNDS = 5 };
+			r.p.assign(slots_, typename Replay::value_type());
+			std::vector<bool> ok(slots_, false);
+
+			// throughput: whole trace, best of ROUNDS
+			double best = 0;
+			size_type failed = 0;
+			for(int round = 0; round < ROUNDS; round++) {
+				failed = 0;
+				double t = now_ns();
+				for(size_type i = 0; i < events_.size(); i++) {
+					const Event& e = events_[i];
+					if(e.alloc) {
+						ok[e.slot] = r.alloc(e.slot, e.size);
+						failed += !ok[e.slot];
+					}
+					else if(ok[e.slot]) { r.free(e.slot); }
+				}
+				t = now_ns() - t;
+				if(round == 0 || t < best) { best = t; }
+			}
+
+			// latency of single operations
+			std::vector<double> latencies;
+			latencies.reserve(events_.size());
+			for(size_type i = 0; i < events_.size(); i++) {
+				const Event& e = events_[i];
+				double t = now_ns();
+				if(e.alloc) { ok[e.slot] = r.alloc(e.slot, e.size); }
+				else if(ok[e.slot]) { r.free(e.slot); }
+				latencies.push_back(now_ns() - t);
+			}
+			std::sort(latencies.begin(), latencies.end());
+			size_type n = latencies.size();
+
+			debug_->debug("%s %lu %.2f %.0f %.0f %.0f %lu", name, (unsigned long)n,
+					n / (best / 1000.0), latencies[n / 2], latencies[n * 99 / 100],
+					latencies[n - 1], (unsigned long)failed);
+		}
+
+		/**
+		 * Random sizes and frees, block structure verified throughout,
+		 * contents of live blocks verified before freeing.
+		 */
+		void check_tlsf_random() {
+			typedef TlsfAllocator<Os, 1 << 16, 3> Small;
+			Small *a = new Small;
+			std::vector<block_data_t*> live;
+			std::vector<size_type> sizes;
+			srand(1);
+			for(size_type i = 0; i < 200000; i++) {
+				if(live.empty() || rand() % 2) {
+					size_type n = (rand() % 4 == 0) ? rand() % 4096 : rand() % 64 + 1;
+					block_data_t *p = a->allocate_array<block_data_t>(n).raw();
+					if(!p) { continue; }
+					if(a->block_size(p) < n) { fail("tlsf block too small"); }
+					memset(p, (int)(n & 0xff), n);
+					live.push_back(p);
+					sizes.push_back(n);
+				}
+				else {
+					size_type j = rand() % live.size();
+					for(size_type k = 0; k < sizes[j]; k++) {
+						if(live[j][k] != (block_data_t)(sizes[j] & 0xff)) { fail("tlsf block overwritten"); }
+					}
+					a->free_array(live[j]);
+					live[j] = live.back();
+					sizes[j] = sizes.back();
+					live.pop_back();
+					sizes.pop_back();
+				}
+				if(i % 97 == 0 && a->check()) { fail("tlsf check"); }
+			}
+			for(size_type j = 0; j < live.size(); j++) { a->free_array(live[j]); }
+			if(a->check() || a->size() != 0 || a->largest_free_block() + 1024 < Small::BUFFER_SIZE) {
+				fail("tlsf not empty after freeing everything");
+			}
+			delete a;
+		}
+
+		/**
+		 * Replay the trace on TLSF once, checking the block structure
+		 * after every operation, report the overhead at peak usage.
+		 */
+		void check_tlsf_trace() {
+			Tlsf *a = new Tlsf;
+			std::vector<block_data_t*> p(slots_, 0);
+			size_type peak = 0;
+			for(size_type i = 0; i < events_.size(); i++) {
+				const Event& e = events_[i];
+				if(e.alloc) {
+					p[e.slot] = a->allocate_array<block_data_t>(e.size).raw();
+					if(!p[e.slot]) { fail("tlsf trace allocation"); }
+					peak = std::max(peak, a->size());
+				}
+				else { a->free_array(p[e.slot]); }
+				if(i < 20000 && a->check()) { fail("tlsf trace check"); }
+			}
+			if(a->check() || a->size() != 0) { fail("tlsf not empty after trace"); }
+			debug_->debug("# tlsf: peak %lu bytes allocated for %lu requested (+%.1f%%)",
+					(unsigned long)peak, (unsigned long)peak_requested_,
+					100.0 * (peak - peak_requested_) / peak_requested_);
+			delete a;
+		}
+
+		void fail(const char *what) {
+			debug_->debug("%s failed", what);
+			exit(1);
+		}
+
+		std::vector<Event> events_;
+		size_type slots_;
+		size_type peak_requested_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,240 @@
+/*
+ * False positive rate against space and throughput of the approximate
+ * membership filters.
+ *
+ * For every filter a number of distinct random keys is inserted (for
+ * the fixed size filters: different numbers, giving different bits per
+ * element), then all of them are looked up (there must be no false
+ * negatives) and the same number of keys that have not been inserted,
+ * the fraction of those found is the false positive rate.
+ *
+ *  - bloom-k1: BloomFilter, one bit per element
+ *  - bloom-kK-B: BlockedBloomFilter with K hashes and B bit blocks
+ *    (64 = register blocked, 512 = cache line, all = unblocked)
+ *  - cuckoo-F: CuckooFilter with F bit fingerprints, 4 slots per bucket
+ *  - xor-F: XorFilter with F bit fingerprints
+ *
+ * Output: filter n bits_per_element fp_percent insert_mops query_mops
+ *
+ * Usage: amq_benchmark
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <algorithms/bloom_filter/bloom_filter.h>
+#include <algorithms/bloom_filter/blocked_bloom_filter.h>
+#include <algorithms/bloom_filter/cuckoo_filter.h>
+#include <algorithms/bloom_filter/xor_filter.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+struct Key {
+	::uint32_t v;
+	::uint32_t hash() const { return v; }
+};
+
+enum { BITS = 1 << 20, CUCKOO_BUCKETS = 1 << 16, XOR_CAPACITY = 1 << 17 };
+
+typedef BloomFilter<Os, Key, BITS> Bloom1;
+typedef BlockedBloomFilter<Os, Key, BITS, 6, 1, ::uint64_t> Bloom6Register;
+typedef BlockedBloomFilter<Os, Key, BITS, 6, 8, ::uint64_t> Bloom6Line;
+typedef BlockedBloomFilter<Os, Key, BITS, 6, BITS / 64, ::uint64_t> Bloom6;
+typedef BlockedBloomFilter<Os, Key, BITS, 3, BITS / 64, ::uint64_t> Bloom3;
+typedef CuckooFilter<Os, Key, CUCKOO_BUCKETS, ::uint8_t> Cuckoo8;
+typedef CuckooFilter<Os, Key, CUCKOO_BUCKETS, ::uint16_t> Cuckoo16;
+typedef XorFilter<Os, Key, XOR_CAPACITY, ::uint8_t> Xor8;
+typedef XorFilter<Os, Key, XOR_CAPACITY, ::uint16_t> Xor16;
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			// distinct keys: a bijective mix of 0, 1, 2, ...
+			// the first half is inserted, the second half are negatives
+			keys_.resize(2 * BITS / 4);
+			for(size_type i = 0; i < keys_.size(); i++) { keys_[i].v = amq_mix32(i); }
+
+			debug_->debug("# filter n bits_per_element fp_percent insert_mops query_mops");
+			static const int bpe[] = { 4, 8, 12, 16, 24 };
+			for(size_type i = 0; i < sizeof(bpe) / sizeof(bpe[0]); i++) {
+				size_type n = BITS / bpe[i];
+				run_bloom<Bloom1>("bloom-k1", n);
+				run_bloom<Bloom3>("bloom-k3-all", n);
+				run_bloom<Bloom6>("bloom-k6-all", n);
+				run_bloom<Bloom6Line>("bloom-k6-512", n);
+				run_bloom<Bloom6Register>("bloom-k6-64", n);
+			}
+
+			static const int load[] = { 50, 75, 90, 95 };
+			for(size_type i = 0; i < sizeof(load) / sizeof(load[0]); i++) {
+				run_cuckoo<Cuckoo8>("cuckoo-8", Cuckoo8::ENTRIES * load[i] / 100);
+				run_cuckoo<Cuckoo16>("cuckoo-16", Cuckoo16::ENTRIES * load[i] / 100);
+			}
+
+			run_xor<Xor8>("xor-8", XOR_CAPACITY / 2);
+			run_xor<Xor8>("xor-8", XOR_CAPACITY);
+			run_xor<Xor16>("xor-16", XOR_CAPACITY / 2);
+			run_xor<Xor16>("xor-16", XOR_CAPACITY);
+
+			check_bloom_operations();
+			check_cuckoo_erase();
+		}
+
+	private:
+		double now() {
+			timeval tv;
+			gettimeofday(&tv, 0);
+			return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+		}
+
+		const Key& positive(size_type i) { return keys_[i]; }
+		const Key& negative(size_type i) { return keys_[keys_.size() / 2 + i]; }
+
+		/**
+		 * Look up the n inserted and n other keys, report.
+		 */
+		template<typename Filter>
+		void query(Filter& filter, const char *name, size_type n, double bits, double insert_ms) {
+			double t = now();
+			size_type found = 0;
+			for(size_type i = 0; i < n; i++) { found += filter.contains(positive(i)); }
+			size_type fp = 0;
+			for(size_type i = 0; i < n; i++) { fp += filter.contains(negative(i)); }
+			double query_ms = now() - t;
+
+			if(found != n) {
+				debug_->debug("%s: false negatives (%lu of %lu found)", name, (unsigned long)found, (unsigned long)n);
+				exit(1);
+			}
+			debug_->debug("%s %lu %.2f %.4f %.1f %.1f", name, (unsigned long)n, bits / n,
+					100.0 * fp / n, n / (insert_ms * 1000.0), 2 * n / (query_ms * 1000.0));
+		}
+
+		template<typename Filter>
+		void run_bloom(const char *name, size_type n) {
+			Filter *filter = new Filter;
+			double t = now();
+			for(size_type i = 0; i < n; i++) { filter->insert(positive(i)); }
+			t = now() - t;
+			query(*filter, name, n, Filter::SIZE, t);
+			delete filter;
+		}
+
+		template<typename Filter>
+		void run_cuckoo(const char *name, size_type n) {
+			Filter *filter = new Filter;
+			double t = now();
+			for(size_type i = 0; i < n; i++) {
+				if(filter->insert(positive(i)) != Filter::SUCCESS) {
+					debug_->debug("%s: full after %lu of %lu elements", name, (unsigned long)i, (unsigned long)n);
+					n = i;
+					break;
+				}
+			}
+			t = now() - t;
+			query(*filter, name, n, 8.0 * Filter::SIZE_BYTES, t);
+			delete filter;
+		}
+
+		template<typename Filter>
+		void run_xor(const char *name, size_type n) {
+			Filter *filter = new Filter;
+			double t = now();
+			if(filter->build(&keys_[0], n) != Filter::SUCCESS) {
+				debug_->debug("%s: build failed", name);
+				exit(1);
+			}
+			t = now() - t;
+			query(*filter, name, n, 8.0 * Filter::SIZE_BYTES, t);
+			delete filter;
+		}
+
+		/**
+		 * Union, intersection and size estimate of two small filters
+		 * as used in the semantic entity neighborhood.
+		 */
+		void check_bloom_operations() {
+			typedef BlockedBloomFilter<Os, Key, 2048, 4, 2048 / 32> Small;
+			Small a, b, u;
+			for(size_type i = 0; i < 100; i++) { a.insert(positive(i)); }
+			for(size_type i = 50; i < 200; i++) { b.insert(positive(i)); }
+			u = a;
+			u |= b;
+			for(size_type i = 0; i < 200; i++) {
+				if(!u.contains(positive(i))) { fail("union"); }
+			}
+			Small c = a;
+			c &= b;
+			for(size_type i = 50; i < 100; i++) {
+				if(!c.contains(positive(i))) { fail("intersection"); }
+			}
+			if(!a.intersects(b)) { fail("intersects"); }
+			debug_->debug("# size estimates (true 100 150 200): %lu %lu %lu %lu",
+					(unsigned long)a.estimate_size(), (unsigned long)b.estimate_size(),
+					(unsigned long)u.estimate_size(), (unsigned long)a.estimate_union_size(b));
+		}
+
+		void check_cuckoo_erase() {
+			Cuckoo16 *filter = new Cuckoo16;
+			size_type n = Cuckoo16::ENTRIES * 9 / 10;
+			for(size_type i = 0; i < n; i++) { filter->insert(positive(i)); }
+			for(size_type i = 0; i < n; i += 2) {
+				if(!filter->erase(positive(i))) { fail("cuckoo erase"); }
+			}
+			for(size_type i = 1; i < n; i += 2) {
+				if(!filter->contains(positive(i))) { fail("cuckoo contains after erase"); }
+			}
+			Cuckoo16 *other = new Cuckoo16;
+			for(size_type i = n; i < n + n / 4; i++) { other->insert(positive(i)); }
+			if(filter->merge(*other) != Cuckoo16::SUCCESS) { fail("cuckoo merge"); }
+			for(size_type i = n; i < n + n / 4; i++) {
+				if(!filter->contains(positive(i))) { fail("cuckoo contains after merge"); }
+			}
+			debug_->debug("# cuckoo erase/merge ok, %lu entries", (unsigned long)filter->size());
+			delete other;
+			delete filter;
+		}
+
+		void fail(const char *what) {
+			debug_->debug("%s failed", what);
+			exit(1);
+		}
+
+		std::vector<Key> keys_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
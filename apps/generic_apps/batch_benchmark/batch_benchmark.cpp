@@ -0,0 +1,373 @@
+/*
+ * INQP operators: row-at-a-time against batch mode (INQP_BATCH_ROWS).
+ *
+ * Workloads, all columns INTEGER values in [0, 1000):
+ *  - select: n rows (a, b, c) through a Selection
+ *    a < s AND b >= 200 AND c != a into a Collect, for selectivities of
+ *    about 1%, 40% and 80%
+ *  - join: 64 rows (k, a) on the left and n rows (k, b) on the right
+ *    through a SimpleLocalJoin on k into a Collect
+ * The rows come from a scan operator that produces rows or batches the
+ * way GraphPatternSelection does. Before timing both modes are run on
+ * the same data and have to send the same rows in the same order. The
+ * select is also checked (not timed) with FLOAT columns.
+ *
+ * Output: workload rows sent mode ns_per_row
+ *
+ * Usage: batch_benchmark
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#define INQP_BATCH_ROWS 256
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <vector>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/types.h>
+#include <util/serialization/serialization.h>
+#include <algorithms/rdf/inqp/row.h>
+#include <algorithms/rdf/inqp/operators/selection.h>
+#include <algorithms/rdf/inqp/operators/simple_local_join.h>
+#include <algorithms/rdf/inqp/operators/collect.h>
+
+typedef Row<Os> RowT;
+typedef RowT::Value Value;
+
+/**
+ * The parts of INQPQueryProcessor the operators use.
+ */
+class Processor {
+	public:
+		typedef Processor self_type;
+		typedef ::uint8_t operator_id_t;
+		typedef ::uint8_t query_id_t;
+		typedef ::RowT RowT;
+		typedef RowT::Value Value;
+		typedef Processor Dictionary;
+		typedef Processor Translator;
+		typedef Processor ReverseTranslator;
+		typedef Processor Timer;
+		
+		enum { COMMUNICATION_TYPE_SINK = 'c' };
+		
+		class Query {
+			public:
+				Query(self_type *p) : processor_(p) { }
+				self_type& processor() { return *processor_; }
+				query_id_t id() { return 1; }
+			private:
+				self_type *processor_;
+		};
+		
+		Processor() : record_(false), sent_(0), sum_(0) { }
+		
+		void send_row(int type, size_type columns, RowT& row, query_id_t qid, operator_id_t oid) {
+			sent_++;
+			for(size_type i = 0; i < columns; i++) {
+				sum_ += row[i];
+			}
+			if(record_) {
+				rows_.insert(rows_.end(), &row[0], &row[0] + columns);
+			}
+		}
+		
+		bool record_;
+		unsigned long sent_;
+		Value sum_;
+		std::vector<Value> rows_;
+};
+
+typedef Operator<Os, Processor> OperatorT;
+typedef OperatorT::Description OD;
+typedef SelectionDescription<Os, Processor> SD;
+typedef SimpleLocalJoinDescription<Os, Processor> SLJD;
+typedef Selection<Os, Processor> SelectionT;
+typedef SimpleLocalJoin<Os, Processor> SimpleLocalJoinT;
+typedef Collect<Os, Processor> CollectT;
+
+/**
+ * Pushes the rows of a vector, in batches if the parent takes them (as
+ * GraphPatternSelection does).
+ */
+class Scan : public OperatorT {
+	public:
+		typedef OperatorT Base;
+		
+		void init(Processor::Query *query, ::uint8_t id, ::uint8_t parent_id, ::uint8_t parent_port,
+				ProjectionInfo<Os> projection, std::vector<Value> *data) {
+			Base::init('g', query, id, parent_id, parent_port, projection);
+			data_ = data;
+		}
+		
+		void execute() {
+			size_type columns = this->projection_info().columns();
+			if(this->parent().batched()) {
+				RowBatchT *batch = RowBatchT::create(columns);
+				for(size_type i = 0; i < data_->size(); i += columns) {
+					size_type j = batch->append();
+					for(size_type c = 0; c < columns; c++) {
+						batch->column(c)[j] = (*data_)[i + c];
+					}
+					if(batch->full()) {
+						this->parent().push_batch(*batch);
+						batch->clear();
+					}
+				}
+				batch->set_end_of_input();
+				this->parent().push_batch(*batch);
+				batch->destroy();
+			}
+			else {
+				RowT *row = RowT::create(columns);
+				for(size_type i = 0; i < data_->size(); i += columns) {
+					for(size_type c = 0; c < columns; c++) {
+						(*row)[c] = (*data_)[i + c];
+					}
+					this->parent().push(*row);
+				}
+				row->destroy();
+				this->parent().push(Base::END_OF_INPUT);
+			}
+		}
+		
+	private:
+		std::vector<Value> *data_;
+};
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+			
+			debug_->debug("# workload rows sent mode ns_per_row");
+			enum { N = 1000000 };
+			make_data(3, N, 1000, right_);
+			static const Value thresholds[] = { 10, 500, 1000 };
+			for(size_type i = 0; i < sizeof(thresholds) / sizeof(thresholds[0]); i++) {
+				check_select(thresholds[i]);
+				check_select_float(thresholds[i]);
+				run_select(thresholds[i], false);
+				run_select(thresholds[i], true);
+			}
+			
+			make_data(2, 64, 1000, left_);
+			make_data(2, N, 1000, right_);
+			check_join();
+			run_join(false);
+			run_join(true);
+		}
+		
+	private:
+		double now() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1000000000.0 + ts.tv_nsec;
+		}
+		
+		void make_data(size_type columns, size_type rows, Value range, std::vector<Value>& data) {
+			srand(columns * 1000 + rows);
+			data.resize(columns * rows);
+			for(size_type i = 0; i < data.size(); i++) {
+				data[i] = rand() % range;
+			}
+		}
+		
+		void describe(block_data_t *d, int type, ::uint8_t id, ::uint8_t parent_id, ProjectionInfo<Os> projection) {
+			d[OD::OFFSET_ID] = id;
+			d[OD::OFFSET_TYPE] = type;
+			d[OD::OFFSET_PARENT_ID] = parent_id;
+			memcpy(d + OD::OFFSET_PROJECTION_INFO, &projection, sizeof(projection));
+		}
+		
+		static Value float_value(float f) {
+			Value v;
+			memcpy(&v, &f, sizeof(v));
+			return v;
+		}
+		
+		/**
+		 * scan (1) -> selection (2) -> collect (3), on the rows of
+		 * @a data with columns of @a type.
+		 */
+		void select(Value threshold, Value b_min, int type, std::vector<Value>& data, bool batches, Processor& processor) {
+			Processor::Query query(&processor);
+			ProjectionInfo<Os> abc((int)(type | type << 2 | type << 4));
+			
+			block_data_t d[64];
+			memset(d, 0, sizeof(d));
+			describe(d, OD::SELECTION, 2, 3, abc);
+			d[SD::OFFSET_COLUMNS] = 3;
+			d[SD::OFFSET_VALUE_COUNT] = 2;
+			block_data_t *criteria = d + SD::OFFSET_CRITERIA;
+			criteria[0] = SD::LT | 0;
+			criteria[1] = SD::GEQ | 1;
+			criteria[2] = SD::NEQ | (2 + 0);
+			wiselib::write<Os, block_data_t, Value>(criteria + 3, threshold);
+			wiselib::write<Os, block_data_t, Value>(criteria + 3 + sizeof(Value), b_min);
+			
+			Scan scan;
+			SelectionT selection;
+			CollectT collect;
+			scan.init(&query, 1, 2, 0, abc, &data);
+			selection.init(reinterpret_cast<SD*>(d), &query);
+			collect.init(&query, 3, 0, 0, abc);
+			scan.attach_to(&selection, batches);
+			selection.attach_to(&collect, batches);
+			
+			scan.execute();
+			selection.destruct();
+		}
+		
+		/**
+		 * scan (1, left) + scan (2, right) -> join (3) -> collect (4)
+		 */
+		void join(bool batches, Processor& processor) {
+			Processor::Query query(&processor);
+			ProjectionInfo<Os> ka((int)(ProjectionInfoBase::INTEGER | ProjectionInfoBase::INTEGER << 2));
+			// (k, a, b), the right k is left out
+			ProjectionInfo<Os> kab((int)(ProjectionInfoBase::INTEGER | ProjectionInfoBase::INTEGER << 2 | ProjectionInfoBase::INTEGER << 6));
+			
+			block_data_t d[64];
+			memset(d, 0, sizeof(d));
+			describe(d, OD::SIMPLE_LOCAL_JOIN, 3, 4, kab);
+			d[SLJD::OFFSET_COLUMNS] = 0x00;
+			
+			Scan left, right;
+			SimpleLocalJoinT slj;
+			CollectT collect;
+			left.init(&query, 1, 3, 0, ka, &left_);
+			right.init(&query, 2, 3, 1, ka, &right_);
+			slj.init(reinterpret_cast<SLJD*>(d), &query);
+			collect.init(&query, 4, 0, 0, kab);
+			left.attach_to(&slj, batches);
+			right.attach_to(&slj, batches);
+			slj.attach_to(&collect, batches);
+			
+			left.execute();
+			right.execute();
+			slj.destruct();
+		}
+		
+		void report(const char *workload, size_type rows, Processor& p, bool batches, double ns) {
+			debug_->debug("%s %lu %lu %s %.2f", workload, (unsigned long)rows, p.sent_,
+					batches ? "batch" : "row", ns / rows);
+		}
+		
+		void run_select(Value threshold, bool batches) {
+			Processor p;
+			double t = now();
+			select(threshold, 200, ProjectionInfoBase::INTEGER, right_, batches, p);
+			char workload[32];
+			snprintf(workload, sizeof(workload), "select-%lu", (unsigned long)threshold);
+			report(workload, right_.size() / 3, p, batches, now() - t);
+		}
+		
+		void run_join(bool batches) {
+			Processor p;
+			double t = now();
+			join(batches, p);
+			report("join", right_.size() / 2, p, batches, now() - t);
+		}
+		
+		void check_select(Value threshold) {
+			Processor r, b;
+			r.record_ = b.record_ = true;
+			select(threshold, 200, ProjectionInfoBase::INTEGER, right_, false, r);
+			select(threshold, 200, ProjectionInfoBase::INTEGER, right_, true, b);
+			
+			size_type expected = 0;
+			for(size_type i = 0; i < right_.size(); i += 3) {
+				Value *v = &right_[i];
+				if(v[0] < threshold && v[1] >= 200 && v[2] != v[0]) { expected++; }
+			}
+			if(r.sent_ != expected) { fail("select row mode"); }
+			if(r.rows_ != b.rows_) { fail("select batch mode"); }
+		}
+		
+		/**
+		 * Like check_select() with the values mapped to floats in
+		 * [-62.5, 62.5).
+		 */
+		void check_select_float(Value threshold) {
+			std::vector<Value> data(right_.size());
+			for(size_type i = 0; i < right_.size(); i++) {
+				data[i] = float_value(to_float(right_[i]));
+			}
+			
+			Processor r, b;
+			r.record_ = b.record_ = true;
+			Value t = float_value(to_float(threshold)), b_min = float_value(to_float(200));
+			select(t, b_min, ProjectionInfoBase::FLOAT, data, false, r);
+			select(t, b_min, ProjectionInfoBase::FLOAT, data, true, b);
+			
+			size_type expected = 0;
+			for(size_type i = 0; i < right_.size(); i += 3) {
+				float a = to_float(right_[i]), bv = to_float(right_[i + 1]), c = to_float(right_[i + 2]);
+				if(a < to_float(threshold) && bv >= to_float(200) && c != a) { expected++; }
+			}
+			if(r.sent_ != expected) { fail("float select row mode"); }
+			if(r.rows_ != b.rows_) { fail("float select batch mode"); }
+		}
+		
+		static float to_float(Value v) { return ((float)v - 500.0f) / 8.0f; }
+		
+		void check_join() {
+			Processor r, b;
+			r.record_ = b.record_ = true;
+			join(false, r);
+			join(true, b);
+			
+			size_type expected = 0;
+			for(size_type i = 0; i < right_.size(); i += 2) {
+				for(size_type j = 0; j < left_.size(); j += 2) {
+					if(left_[j] == right_[i]) { expected++; }
+				}
+			}
+			if(r.sent_ != expected) { fail("join row mode"); }
+			if(r.rows_ != b.rows_) { fail("join batch mode"); }
+		}
+		
+		void fail(const char *what) {
+			debug_->debug("%s check failed", what);
+			exit(1);
+		}
+		
+		std::vector<Value> left_;
+		std::vector<Value> right_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
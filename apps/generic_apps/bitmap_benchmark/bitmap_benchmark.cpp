@@ -0,0 +1,374 @@
+/*
+ * Free run search, rank / select and bulk operations of BitArray.
+ *
+ * The bitmaps are fragmented like the used() map of a BitmapAllocator:
+ * random used runs of 1 to 16 blocks and free runs of 1 to g blocks
+ * (g = 4, 16, 64 for tight to loose fragmentation).
+ *  - first_fit / best_fit: search a free run of 1 to 32 blocks, like
+ *    BitmapAllocator does, one bit at a time with get() (legacy) and a
+ *    word at a time with find_run() and find_first_clear/_set()
+ *  - rank / select: random queries with count() from the start
+ *    (linear), with BitArrayRankIndex (indexed) and get() (legacy)
+ *  - and / count: bit_and() and count() over the whole bitmap against
+ *    a byte loop (legacy)
+ * Also checks every operation against std::vector<bool> and runs random
+ * allocations of BitmapAllocator, checking that chunks do not overlap.
+ *
+ * Output: workload bits gap impl ns_per_op
+ *
+ * Usage: bitmap_benchmark
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <vector>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/pstl/bit_array.h>
+#include <util/allocators/bitmap_allocator.h>
+
+typedef BitArray<Os> bitarray_t;
+
+enum { MAX_BITS = 1 << 16 };
+typedef BitArrayRankIndex<Os, MAX_BITS> RankIndex;
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			check();
+			check_allocator();
+
+			debug_->debug("# workload bits gap impl ns_per_op");
+			static const size_type sizes[] = { 1024, 8192, MAX_BITS };
+			static const size_type gaps[] = { 4, 16, 64 };
+			for(size_type i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+				for(size_type g = 0; g < sizeof(gaps) / sizeof(gaps[0]); g++) {
+					fragment(sizes[i], gaps[g]);
+					run_search(sizes[i], gaps[g]);
+				}
+				run_rank_select(sizes[i]);
+				run_bulk(sizes[i]);
+			}
+		}
+
+	private:
+		enum { OPS = 1 << 16 };
+
+		double now_ns() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1e9 + ts.tv_nsec;
+		}
+
+		bitarray_t& bits() { return *reinterpret_cast<bitarray_t*>(data_); }
+		bitarray_t& other() { return *reinterpret_cast<bitarray_t*>(other_); }
+
+		/**
+		 * Used runs of 1..16 bits alternating with free runs of 1..gap.
+		 */
+		void fragment(size_type n, size_type gap) {
+			memset(data_, 0, sizeof(data_));
+			for(size_type pos = 0; pos < n; ) {
+				size_type used = 1 + rand() % 16;
+				bits().set_range(pos, (pos + used < n) ? pos + used : n, true);
+				pos += used + 1 + rand() % gap;
+			}
+		}
+
+		// the former BitmapAllocator searches
+
+		size_type legacy_first_fit(size_type n, size_type required) {
+			size_type start_pos = 0, length = 0;
+			for(size_type i = 0; i < n; i++) {
+				if(bits().get(i)) {
+					length = 0;
+					start_pos = i + 1;
+				}
+				else if(++length >= required) {
+					return start_pos;
+				}
+			}
+			return bitarray_t::npos;
+		}
+
+		size_type legacy_best_fit(size_type n, size_type required) {
+			size_type best_start_pos = 0, best_length = -1;
+			size_type start_pos = 0, length = 0;
+			for(size_type i = 0; i < n; i++) {
+				if(bits().get(i)) {
+					if(length >= required && length < best_length) {
+						best_length = length;
+						best_start_pos = start_pos;
+						if(best_length == required) { break; }
+					}
+					length = 0;
+					start_pos = i + 1;
+				}
+				else {
+					length++;
+				}
+			}
+			if(length >= required && length < best_length) {
+				best_length = length;
+				best_start_pos = start_pos;
+			}
+			return (best_length == (size_type)-1) ? (size_type)bitarray_t::npos : best_start_pos;
+		}
+
+		size_type best_fit(size_type n, size_type required) {
+			size_type best_start_pos = 0, best_length = -1;
+			for(size_type pos = 0; pos < n; ) {
+				size_type start_pos = bits().find_first_clear(pos, n);
+				if(start_pos == bitarray_t::npos) { break; }
+				pos = bits().find_first_set(start_pos, n);
+				if(pos == bitarray_t::npos) { pos = n; }
+				size_type length = pos - start_pos;
+				if(length >= required && length < best_length) {
+					best_length = length;
+					best_start_pos = start_pos;
+					if(best_length == required) { break; }
+				}
+			}
+			return (best_length == (size_type)-1) ? (size_type)bitarray_t::npos : best_start_pos;
+		}
+
+		void start() { t_ = now_ns(); }
+
+		void stop(const char *workload, size_type n, size_type gap, const char *impl, size_type ops) {
+			debug_->debug("%s %lu %lu %s %.1f", workload, (unsigned long)n, (unsigned long)gap, impl,
+					(now_ns() - t_) / ops);
+		}
+
+		void run_search(size_type n, size_type gap) {
+			size_type ops = OPS / (n / 1024);
+			std::vector<size_type> req(ops);
+			for(size_type i = 0; i < ops; i++) { req[i] = 1 + rand() % 32; }
+
+			start();
+			for(size_type i = 0; i < ops; i++) { sink_ += legacy_first_fit(n, req[i]); }
+			stop("first_fit", n, gap, "legacy", ops);
+			start();
+			for(size_type i = 0; i < ops; i++) { sink_ += bits().find_run(req[i], 0, n); }
+			stop("first_fit", n, gap, "word", ops);
+
+			start();
+			for(size_type i = 0; i < ops; i++) { sink_ += legacy_best_fit(n, req[i]); }
+			stop("best_fit", n, gap, "legacy", ops);
+			start();
+			for(size_type i = 0; i < ops; i++) { sink_ += best_fit(n, req[i]); }
+			stop("best_fit", n, gap, "word", ops);
+		}
+
+		void run_rank_select(size_type n) {
+			fragment(n, 16);
+			RankIndex index;
+			index.build(&bits(), n);
+			size_type total = index.count();
+			std::vector<size_type> q(OPS);
+			for(size_type i = 0; i < OPS; i++) { q[i] = rand() % n; }
+			size_type ops = OPS / (n / 1024);
+
+			start();
+			for(size_type i = 0; i < ops; i++) {
+				size_type r = 0;
+				for(size_type j = 0; j < q[i]; j++) { r += bits().get(j); }
+				sink_ += r;
+			}
+			stop("rank", n, 16, "legacy", ops);
+			start();
+			for(size_type i = 0; i < ops; i++) { sink_ += bits().rank(q[i]); }
+			stop("rank", n, 16, "linear", ops);
+			start();
+			for(size_type i = 0; i < OPS; i++) { sink_ += index.rank(q[i]); }
+			stop("rank", n, 16, "indexed", OPS);
+
+			start();
+			for(size_type i = 0; i < ops; i++) { sink_ += bits().select(q[i] % total, 0, n); }
+			stop("select", n, 16, "linear", ops);
+			start();
+			for(size_type i = 0; i < OPS; i++) { sink_ += index.select(q[i] % total); }
+			stop("select", n, 16, "indexed", OPS);
+		}
+
+		void run_bulk(size_type n) {
+			fragment(n, 16);
+			memcpy(other_, data_, sizeof(data_));
+			size_type ops = OPS / (n / 1024) / 8;
+
+			start();
+			for(size_type i = 0; i < ops; i++) {
+				for(size_type b = 0; b < n / 8; b++) { data_[b] &= other_[b]; }
+				other_[i % (n / 8)]++;
+			}
+			stop("and", n, 16, "legacy", ops);
+			start();
+			for(size_type i = 0; i < ops; i++) {
+				bits().bit_and(other(), n);
+				other_[i % (n / 8)]++;
+			}
+			stop("and", n, 16, "word", ops);
+
+			start();
+			for(size_type i = 0; i < ops; i++) {
+				size_type c = 0;
+				for(size_type b = 0; b < n; b++) { c += bits().get(b); }
+				sink_ += c;
+			}
+			stop("count", n, 16, "legacy", ops);
+			start();
+			for(size_type i = 0; i < ops; i++) { sink_ += bits().count(0, n); }
+			stop("count", n, 16, "word", ops);
+		}
+
+		/**
+		 * Random bitmaps and ranges against std::vector<bool>.
+		 */
+		void check() {
+			for(int round = 0; round < 2000; round++) {
+				size_type n = 1 + rand() % 700;
+				std::vector<bool> ref(n);
+				memset(data_, 0, sizeof(data_));
+				size_type density = rand() % 4;
+				for(size_type i = 0; i < n; i++) {
+					bool v = (size_type)(rand() % 4) < density;
+					ref[i] = v;
+					bits().set(i, v);
+				}
+				// ranges must not look beyond their end
+				data_[(n + 7) / 8] = 0xa5;
+
+				size_type a = rand() % n, b = a + rand() % (n - a + 1);
+				if(rand() % 2) {
+					bool v = rand() % 2;
+					bits().set_range(a, b, v);
+					for(size_type i = a; i < b; i++) { ref[i] = v; }
+				}
+				for(size_type i = 0; i < n; i++) {
+					if(bits().get(i) != ref[i]) { fail("set_range"); }
+				}
+
+				size_type first_set = npos_of(ref, true, a, b), first_clear = npos_of(ref, false, a, b);
+				if(bits().find_first_set(a, b) != first_set) { fail("find_first_set"); }
+				if(bits().find_first_clear(a, b) != first_clear) { fail("find_first_clear"); }
+
+				size_type run = 1 + rand() % 12, ref_run = bitarray_t::npos;
+				for(size_type i = a, l = 0; i < b; i++) {
+					l = ref[i] ? 0 : l + 1;
+					if(l == run) { ref_run = i + 1 - run; break; }
+				}
+				if(bits().find_run(run, a, b) != ref_run) { fail("find_run"); }
+
+				size_type c = 0;
+				for(size_type i = a; i < b; i++) { c += ref[i]; }
+				if(bits().count(a, b) != c) { fail("count"); }
+
+				RankIndex index;
+				index.build(&bits(), n);
+				for(size_type i = 0, r = 0; i <= n; i++) {
+					if(bits().rank(i) != r || index.rank(i) != r) { fail("rank"); }
+					if(i < n && ref[i]) {
+						if(index.select(r) != i || bits().select(r, 0, n) != i) { fail("select"); }
+						r++;
+					}
+				}
+				if(index.select(index.count()) != bitarray_t::npos) { fail("select beyond count"); }
+
+				std::vector<bool> ref2(n);
+				for(size_type i = 0; i < n; i++) {
+					ref2[i] = rand() % 2;
+					other().set(i, ref2[i]);
+				}
+				int op = rand() % 3;
+				if(op == 0) { bits().bit_and(other(), n); }
+				else if(op == 1) { bits().bit_or(other(), n); }
+				else { bits().bit_xor(other(), n); }
+				for(size_type i = 0; i < n; i++) {
+					bool e = (op == 0) ? (ref[i] && ref2[i]) : (op == 1) ? (ref[i] || ref2[i]) : (ref[i] != ref2[i]);
+					if(bits().get(i) != e) { fail("bulk operation"); }
+				}
+			}
+		}
+
+		size_type npos_of(std::vector<bool>& ref, bool v, size_type a, size_type b) {
+			for(size_type i = a; i < b; i++) { if(ref[i] == v) { return i; } }
+			return bitarray_t::npos;
+		}
+
+		/**
+		 * Random allocations and frees, every chunk is filled with a
+		 * pattern that is checked before it is freed.
+		 */
+		void check_allocator() {
+			typedef BitmapAllocator<Os, 4096, 16> Bitmap;
+			Bitmap *a = new Bitmap;
+			std::vector<block_data_t*> chunks;
+			std::vector<size_type> sizes;
+			for(int k = 0; k < 20000; k++) {
+				if(chunks.empty() || rand() % 2) {
+					size_type s = 1 + rand() % 100;
+					block_data_t *p = a->allocate_array<block_data_t>(s).raw();
+					if(!p) { continue; }
+					memset(p, (int)chunks.size() & 0xff, s);
+					chunks.push_back(p);
+					sizes.push_back(s);
+				}
+				else {
+					size_type i = rand() % chunks.size();
+					for(size_type j = 0; j < sizes[i]; j++) {
+						if(chunks[i][j] != (block_data_t)(i & 0xff)) { fail("bitmap allocator: overlapping chunks"); }
+					}
+					a->free_array(chunks[i]);
+					// keep the pattern of the moved chunk
+					chunks[i] = chunks.back();
+					sizes[i] = sizes.back();
+					chunks.pop_back();
+					sizes.pop_back();
+					if(i < chunks.size()) { memset(chunks[i], (int)i & 0xff, sizes[i]); }
+				}
+			}
+			for(size_type i = 0; i < chunks.size(); i++) { a->free_array(chunks[i]); }
+			// everything free again: the whole buffer is one run
+			if(!a->allocate_array<block_data_t>(4096).raw()) { fail("bitmap allocator: free"); }
+			delete a;
+		}
+
+		void fail(const char *what) {
+			debug_->debug("%s check failed", what);
+			exit(1);
+		}
+
+		block_data_t data_[MAX_BITS / 8 + 1];
+		block_data_t other_[MAX_BITS / 8 + 1];
+		double t_;
+		unsigned long sink_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,286 @@
+/*
+ * Insert / lookup benchmark of the block memory based BlockDictionary
+ * against the in-memory dictionaries.
+ *
+ * Generates n distinct URI-like strings in random order and measures for
+ * each dictionary: inserting all of them, inserting them a second time
+ * (reference count increase), looking all of them up, looking up n
+ * strings that are not present and erasing everything again.
+ * For the BlockDictionary also the number of used pages and block I/Os
+ * are reported, after erasing all pages have to be returned to the
+ * allocator.
+ * (UnbalancedTreeDictionary is left out, its invariant checks make every
+ * operation linear in the dictionary size.)
+ *
+ * Before the measurements the BlockDictionary is checked against a
+ * std::map with a random mix of inserts and erases of strings of
+ * varying length, so pages get fragmented, compacted and their slots
+ * reused. Every live value, key and reference count is verified
+ * regularly and at the end.
+ *
+ * Usage: block_dictionary_benchmark [n ...]   (default: 10^4 10^5 10^6)
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <map>
+#include <string>
+
+#include <algorithms/block_memory/ram_block_memory.h>
+#include <algorithms/block_memory/cached_block_memory.h>
+#include <algorithms/block_memory/bitmap_chunk_allocator.h>
+#include <algorithms/hash/sdbm.h>
+#include <util/tuple_store/block_dictionary.h>
+#include <util/tuple_store/avl_dictionary.h>
+#include <util/tuple_store/prescilla_dictionary.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <vector>
+
+typedef RamBlockMemory<Os> PhysicalBlockMemory;
+typedef CachedBlockMemory<Os, PhysicalBlockMemory, 10, 3, true> BlockCache;
+typedef BitmapChunkAllocator<Os, BlockCache, 8, Os::size_t> BlockAllocator;
+typedef BlockDictionary<Os, BlockAllocator, Sdbm<Os> > BlockDict;
+
+typedef AvlDictionary<Os> AvlDict;
+typedef PrescillaDictionary<Os> PrescillaDict;
+
+// 100 MiB, too large for the stack
+BlockCache block_cache_;
+BlockAllocator block_allocator_;
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			std::vector<size_type> sizes;
+			for(int i = 1; i < amp.argc; i++) { sizes.push_back(atol(amp.argv[i])); }
+			if(sizes.empty()) {
+				sizes.push_back(10000);
+				sizes.push_back(100000);
+				sizes.push_back(1000000);
+			}
+
+			check_block(200000);
+
+			debug_->debug("# dictionary n insert_ms reinsert_ms find_ms miss_ms erase_ms pages io_reads io_writes pages_after_erase");
+			for(size_type i = 0; i < sizes.size(); i++) {
+				generate(sizes[i]);
+				run_block();
+				run<AvlDict>("avl");
+				run<PrescillaDict>("prescilla");
+			}
+		}
+
+	private:
+		double now() {
+			timeval tv;
+			gettimeofday(&tv, 0);
+			return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+		}
+
+		block_data_t* str(std::vector<size_type>& offsets, size_type i) {
+			return reinterpret_cast<block_data_t*>(&pool_[offsets[i]]);
+		}
+
+		/**
+		 * n distinct strings with a shared prefix and varying length
+		 * (like URIs in RDF data) plus n other strings for failing
+		 * lookups. Order is pseudo-random, so the unbalanced tree does
+		 * not degenerate.
+		 */
+		void generate(size_type n) {
+			n_ = n;
+			pool_.clear();
+			present_.clear();
+			absent_.clear();
+			char buf[128];
+			for(size_type i = 0; i < 2 * n; i++) {
+				unsigned long x = (unsigned long)((i * 2654435761UL) % 4294967291UL);
+				int l = snprintf(buf, sizeof(buf), "<http://example.org/%s/%lx/%.*s>",
+						(x & 1) ? "sensor" : "observation", x, (int)(x % 24), "abcdefghijklmnopqrstuvwxyz");
+				((i & 1) ? absent_ : present_).push_back(pool_.size());
+				pool_.insert(pool_.end(), buf, buf + l + 1);
+			}
+		}
+
+		void init_block() {
+			block_cache_.physical().init();
+			block_cache_.init();
+			block_allocator_.init(&block_cache_, debug_);
+			block_allocator_.wipe();
+		}
+
+		/**
+		 * @a ops random inserts and erases on a BlockDictionary,
+		 * compared to a std::map of the expected keys and reference
+		 * counts.
+		 */
+		void check_block(size_type ops) {
+			typedef std::map<std::string, std::pair<BlockDict::key_type, size_type> > Expected;
+			enum { STRINGS = 4000, VERIFY_INTERVAL = 1000 };
+
+			init_block();
+			BlockDict *dict = new BlockDict;
+			dict->init(&block_allocator_, debug_);
+
+			Expected expected;
+			char buf[256];
+			srand(ops);
+			for(size_type i = 0; i < ops; i++) {
+				int x = rand() % STRINGS;
+				snprintf(buf, sizeof(buf), "<http://example.org/%d/%.*s>", x,
+						x % 150, "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz"
+						"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+				Expected::iterator it = expected.find(buf);
+
+				// Erase slightly less often than insert so the
+				// dictionary grows while staying fragmented
+				if(it != expected.end() && rand() % 100 < 45) {
+					dict->erase(it->second.first);
+					if(--it->second.second == 0) { expected.erase(it); }
+				}
+				else {
+					BlockDict::key_type k = dict->insert(reinterpret_cast<block_data_t*>(buf));
+					if(k == BlockDict::NULL_KEY) { fail("block", "random insert", i); }
+					if(it == expected.end()) {
+						expected[buf] = std::make_pair(k, (size_type)1);
+					}
+					else {
+						if(k != it->second.first) { fail("block", "random reinsert", i); }
+						it->second.second++;
+					}
+				}
+
+				if(i % VERIFY_INTERVAL == VERIFY_INTERVAL - 1 || i == ops - 1) {
+					if(dict->size() != expected.size()) { fail("block", "random size", i); }
+					for(it = expected.begin(); it != expected.end(); ++it) {
+						block_data_t *s = reinterpret_cast<block_data_t*>(const_cast<char*>(it->first.c_str()));
+						block_data_t *v = dict->get_value(it->second.first);
+						if(strcmp(reinterpret_cast<char*>(v), it->first.c_str()) != 0) { fail("block", "random value", i); }
+						dict->free_value(v);
+						if(dict->count(it->second.first) != it->second.second) { fail("block", "random count", i); }
+						if(dict->find(s) != it->second.first) { fail("block", "random find", i); }
+					}
+				}
+			}
+
+			for(Expected::iterator it = expected.begin(); it != expected.end(); ++it) {
+				for(size_type j = 0; j < it->second.second; j++) { dict->erase(it->second.first); }
+			}
+			if(dict->size() != 0 || dict->pages() != 0) { fail("block", "random erase", ops); }
+			delete dict;
+		}
+
+		void run_block() {
+			init_block();
+
+			BlockDict *dict = new BlockDict;
+			dict->init(&block_allocator_, debug_);
+			block_cache_.reset_stats();
+
+			measure(*dict, "block");
+
+			debug_->debug("block %lu %.1f %.1f %.1f %.1f %.1f %lu %lu %lu %lu",
+					(unsigned long)n_, t_insert_, t_reinsert_, t_find_, t_miss_, t_erase_,
+					(unsigned long)pages_, (unsigned long)block_cache_.reads(),
+					(unsigned long)block_cache_.writes(), (unsigned long)dict->pages());
+			delete dict;
+		}
+
+		template<typename Dict>
+		void run(const char *name) {
+			Dict *dict = new Dict;
+			dict->init(debug_);
+			measure(*dict, name);
+			debug_->debug("%s %lu %.1f %.1f %.1f %.1f %.1f - - - -",
+					name, (unsigned long)n_, t_insert_, t_reinsert_, t_find_, t_miss_, t_erase_);
+			delete dict;
+		}
+
+		template<typename Dict>
+		void measure(Dict& dict, const char *name) {
+			std::vector<typename Dict::key_type> keys(n_);
+
+			double t0 = now();
+			for(size_type i = 0; i < n_; i++) {
+				keys[i] = dict.insert(str(present_, i));
+			}
+			double t1 = now();
+			for(size_type i = 0; i < n_; i++) {
+				if(dict.insert(str(present_, i)) != keys[i]) { fail(name, "reinsert", i); }
+			}
+			double t2 = now();
+			for(size_type i = 0; i < n_; i++) {
+				if(dict.find(str(present_, i)) != keys[i]) { fail(name, "find", i); }
+			}
+			double t3 = now();
+			for(size_type i = 0; i < n_; i++) {
+				if(dict.find(str(absent_, i)) != Dict::NULL_KEY) { fail(name, "miss", i); }
+			}
+			double t4 = now();
+			pages_ = pages(dict);
+			for(size_type i = 0; i < n_; i++) {
+				dict.erase(keys[i]);
+				dict.erase(keys[i]);
+			}
+			double t5 = now();
+
+			t_insert_ = t1 - t0;
+			t_reinsert_ = t2 - t1;
+			t_find_ = t3 - t2;
+			t_miss_ = t4 - t3;
+			t_erase_ = t5 - t4;
+		}
+
+		template<typename Dict>
+		size_type pages(Dict&) { return 0; }
+		size_type pages(BlockDict& dict) { return dict.pages(); }
+
+		void fail(const char *name, const char *phase, size_type i) {
+			debug_->debug("%s: %s failed for string %lu", name, phase, (unsigned long)i);
+			exit(1);
+		}
+
+		size_type n_;
+		std::vector<char> pool_;
+		std::vector<size_type> present_, absent_;
+		double t_insert_, t_reinsert_, t_find_, t_miss_, t_erase_;
+		size_type pages_;
+
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,324 @@
+/*
+ * Loading N-Triples / N-Quads into a TupleStore: line by line against
+ * N3BulkLoader.
+ *
+ * The input (gzipped or not) is repeated the given number of times,
+ * every URI getting a per-copy suffix so copies do not share terms, and
+ * written to a temporary file. Then it is loaded
+ *  - line: fgets(), SplitN3::parse_line() and TupleStore::insert() per
+ *    line, as tuplestore_example, hash_test and shdt_test do
+ *  - bulk-T: N3BulkLoader with T threads (mmapped input)
+ * into a tuple store of the first three elements of every line, with
+ * HashDictionary and PrescillaDictionary. Before timing, both have to
+ * produce the same tuples and (for HashDictionary) the same reference
+ * counts.
+ *
+ * Output: input copies tuples dictionary impl seconds tuples_per_s
+ *
+ * Usage: bulk_load_benchmark [file.nq[.gz] ...]
+ *   (default: ../hash_test/data-0.nq.gz)
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <util/split_n3.h>
+#include <util/tuple_store/tuplestore.h>
+#include <util/tuple_store/hash_dictionary.h>
+#include <util/tuple_store/prescilla_dictionary.h>
+#include <util/tuple_store/n3_bulk_loader.h>
+
+/**
+ * Triple of dictionary keys as wide as pointers.
+ */
+class TupleT {
+	public:
+		enum { SIZE = 3 };
+		
+		TupleT() { for(size_type i = 0; i < SIZE; i++) { data_[i] = 0; } }
+		
+		block_data_t* get(size_type i) { return reinterpret_cast<block_data_t*>(data_[i]); }
+		void set(size_type i, block_data_t* data) { data_[i] = reinterpret_cast<unsigned long>(data); }
+		size_type length(size_type i) { return get(i) ? strlen((char*)get(i)) : 0; }
+		
+		void set_deep(size_type i, block_data_t* data) {
+			size_type l = strlen((char*)data) + 1;
+			set(i, ::get_allocator().allocate_array<block_data_t>(l).raw());
+			memcpy(get(i), data, l);
+		}
+		void free_deep(size_type i) {
+			if(get(i)) { ::get_allocator().free_array(get(i)); }
+			set(i, 0);
+		}
+		void destruct_deep() { for(size_type i = 0; i < SIZE; i++) { free_deep(i); } }
+		
+		void set_key(size_type i, unsigned long k) { data_[i] = k; }
+		unsigned long get_key(size_type i) const { return data_[i]; }
+		
+		static int compare(int col, ::uint8_t *a, int alen, ::uint8_t *b, int blen) {
+			if(alen != blen) { return blen - alen; }
+			return memcmp(a, b, alen);
+		}
+		
+		bool operator==(const TupleT& other) const {
+			return data_[0] == other.data_[0] && data_[1] == other.data_[1] && data_[2] == other.data_[2];
+		}
+		
+	private:
+		unsigned long data_[SIZE];
+};
+
+/**
+ * Tuple container on std::vector. (vector_dynamic counts its elements
+ * in 16 bits, too few for this benchmark.)
+ */
+class TupleContainer {
+	public:
+		typedef TupleT value_type;
+		typedef std::vector<TupleT>::iterator iterator;
+		typedef ::size_type size_type;
+		
+		iterator begin() { return v_.begin(); }
+		iterator end() { return v_.end(); }
+		size_type size() { return v_.size(); }
+		void clear() { v_.clear(); }
+		
+		iterator insert(const TupleT& t) {
+			v_.push_back(t);
+			return v_.end() - 1;
+		}
+		iterator erase(iterator it) { return v_.erase(it); }
+		iterator find(TupleT& t) { return std::find(v_.begin(), v_.end(), t); }
+		
+	private:
+		std::vector<TupleT> v_;
+};
+
+/**
+ * A tuple store with its dictionary and container.
+ */
+template<typename Dictionary_P>
+struct Store {
+	typedef Dictionary_P Dictionary;
+	typedef TupleStore<Os, TupleContainer, Dictionary, Os::Debug, BIN(111), &TupleT::compare> TupleStoreT;
+	
+	Store(Os::Debug::self_pointer_t debug) {
+		dictionary.init(debug);
+		tuple_store.init(&dictionary, &container, debug);
+	}
+	
+	~Store() {
+		container.clear();
+	}
+	
+	Dictionary dictionary;
+	TupleContainer container;
+	TupleStoreT tuple_store;
+};
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+			
+			size_type n_files = (amp.argc > 1) ? amp.argc - 1 : 1;
+			debug_->debug("# input copies tuples dictionary impl seconds tuples_per_s");
+			for(size_type f = 0; f < n_files; f++) {
+				const char *path = (amp.argc > 1) ? amp.argv[f + 1] : "../hash_test/data-0.nq.gz";
+				if(!read(path)) {
+					debug_->debug("could not read %s", path);
+					continue;
+				}
+				static const size_type copies[] = { 1, 4 };
+				for(size_type c = 0; c < sizeof(copies) / sizeof(copies[0]); c++) {
+					if(!write(copies[c])) {
+						debug_->debug("could not write temporary file");
+						exit(1);
+					}
+					check< HashDictionary<Os> >(true);
+					check< PrescillaDictionary<Os> >(false);
+					run< HashDictionary<Os> >(path, copies[c], "hash");
+					run< PrescillaDictionary<Os> >(path, copies[c], "prescilla");
+					unlink(tmp_);
+				}
+			}
+		}
+		
+	private:
+		double now() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec + ts.tv_nsec / 1e9;
+		}
+		
+		bool read(const char *path) {
+			std::string cmd = std::string("gzip -dcf '") + path + "'";
+			FILE *f = popen(cmd.c_str(), "r");
+			if(!f) { return false; }
+			input_.clear();
+			char buffer[65536];
+			for(size_t n; (n = fread(buffer, 1, sizeof(buffer), f)) > 0; ) {
+				input_.insert(input_.end(), buffer, buffer + n);
+			}
+			return pclose(f) == 0 && !input_.empty();
+		}
+		
+		/**
+		 * Write the given number of copies of the input to a temporary
+		 * file.
+		 */
+		bool write(size_type copies) {
+			strcpy(tmp_, "/tmp/bulk_load_benchmark_XXXXXX");
+			int fd = mkstemp(tmp_);
+			if(fd < 0) { return false; }
+			FILE *f = fdopen(fd, "w");
+			fwrite(&input_[0], 1, input_.size(), f);
+			for(size_type c = 1; c < copies; c++) {
+				char suffix[32];
+				snprintf(suffix, sizeof(suffix), "~%lu>", (unsigned long)c);
+				for(size_type i = 0; i < input_.size(); i++) {
+					if(input_[i] == '>') { fputs(suffix, f); }
+					else { fputc(input_[i], f); }
+				}
+			}
+			copies_ = copies;
+			return fclose(f) == 0;
+		}
+		
+		template<typename StoreT>
+		void load_lines(StoreT& store) {
+			FILE *f = fopen(tmp_, "r");
+			static char line[20480];
+			SplitN3<Os> splitter;
+			TupleT t;
+			while(fgets(line, sizeof(line), f)) {
+				line[strcspn(line, "\r\n")] = '\0';
+				splitter.parse_line(line);
+				if(splitter.size() < 3) { continue; }
+				for(size_type i = 0; i < 3; i++) { t.set(i, (block_data_t*)splitter[i]); }
+				store.tuple_store.insert(t);
+			}
+			fclose(f);
+		}
+		
+		template<typename StoreT>
+		void load_bulk(StoreT& store, size_type threads) {
+			N3BulkLoader<Os, typename StoreT::TupleStoreT> loader;
+			loader.init(&store.tuple_store, threads);
+			loader.load(tmp_);
+		}
+		
+		template<typename Dictionary>
+		void run(const char *path, size_type copies, const char *dictionary) {
+			static const size_type threads[] = { 0, 1, 2, 4 };
+			for(size_type i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+				Store<Dictionary> store(debug_);
+				double t = now();
+				char impl[32];
+				if(threads[i] == 0) {
+					load_lines(store);
+					strcpy(impl, "line");
+				}
+				else {
+					load_bulk(store, threads[i]);
+					snprintf(impl, sizeof(impl), "bulk-%lu", (unsigned long)threads[i]);
+				}
+				t = now() - t;
+				unsigned long n = store.tuple_store.size();
+				debug_->debug("%s %lu %lu %s %s %.3f %.0f", path, (unsigned long)copies, n, dictionary, impl, t, n / t);
+			}
+		}
+		
+		template<typename StoreT>
+		void tuples(StoreT& store, std::vector<std::string>& r) {
+			r.clear();
+			for(TupleContainer::iterator it = store.container.begin(); it != store.container.end(); ++it) {
+				std::string s;
+				for(size_type i = 0; i < 3; i++) {
+					block_data_t *v = store.dictionary.get_value(it->get_key(i));
+					s += (char*)v;
+					s += '\t';
+					store.dictionary.free_value(v);
+				}
+				r.push_back(s);
+			}
+			std::sort(r.begin(), r.end());
+		}
+		
+		template<typename Dictionary>
+		void check(bool refcounts) {
+			Store<Dictionary> line(debug_), bulk(debug_);
+			load_lines(line);
+			load_bulk(bulk, 3);
+			
+			std::vector<std::string> a, b;
+			tuples(line, a);
+			tuples(bulk, b);
+			if(a.empty() || a != b) { fail("tuples"); }
+			
+			if(refcounts) {
+				check_refcounts(line.dictionary, bulk.dictionary);
+			}
+		}
+		
+		void check_refcounts(HashDictionary<Os>& a, HashDictionary<Os>& b) {
+			if(a.size() != b.size()) { fail("dictionary size"); }
+			for(HashDictionary<Os>::iterator it = a.begin_keys(); it != a.end_keys(); ++it) {
+				HashDictionary<Os>::key_type k = b.find(a.get_value(*it));
+				if(k == HashDictionary<Os>::NULL_KEY || a.count(*it) != b.count(k)) { fail("reference counts"); }
+			}
+		}
+		
+		template<typename Dictionary>
+		void check_refcounts(Dictionary& a, Dictionary& b) {
+		}
+		
+		void fail(const char *what) {
+			debug_->debug("%s check failed (copies %lu)", what, (unsigned long)copies_);
+			exit(1);
+		}
+		
+		std::vector<char> input_;
+		char tmp_[64];
+		size_type copies_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,256 @@
+/*
+ * CodecTupleStore with
+ *  - null: CopyCodec (below), "encoding" is a copy, as a baseline for
+ *    the cost of the wrapper itself
+ *  - huffman: HuffmanCodec
+ *  - cached: HuffmanCodec with CACHE_SIZE encodings and decodings of
+ *    hot terms cached
+ * each on the in-memory tuple store of tuplestore_example
+ * (setup_tuplestore.h: list_dynamic, UnbalancedTreeDictionary).
+ *
+ * The store gets n RDF-like triples: sensors with five properties,
+ * objects partly shared. Workloads:
+ *  - insert: insert() one triple at a time
+ *  - batch: insert() of all triples at once
+ *  - lookup: q queries by subject, 90% of them for one of HOT
+ *    subjects, every column of every result is read
+ *  - scan: iterate over all triples reading every column
+ * All variants have to give the same triples as the ones inserted for
+ * the scan and the same results for the lookups.
+ *
+ * Output: codec tuples workload ms us_per_op encode_hit_rate decode_hit_rate
+ *   (hit rates of the term caches in that workload, - if not used)
+ *
+ * Usage: codec_benchmark [n [q]]
+ *   (default: 4000 triples, 4000 queries)
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#define TS_USE_BLOCK_MEMORY 0
+#include "../tuplestore_example/setup_tuplestore.h"
+
+/**
+ * Codec with the static interface CodecTupleStore expects that copies
+ * the strings unchanged. (NullCodec in algorithms/codecs works on
+ * string_dynamic / BitString_dynamic instead.)
+ */
+class CopyCodec {
+	public:
+		static block_data_t* encode(block_data_t *in) { return copy(in); }
+		static block_data_t* decode(block_data_t *in) { return copy(in); }
+		static void free_result(block_data_t *s) { get_allocator().free_array(s); }
+
+	private:
+		static block_data_t* copy(block_data_t *in) {
+			size_type l = strlen((char*)in) + 1;
+			block_data_t *r = get_allocator().allocate_array<block_data_t>(l).raw();
+			memcpy(r, in, l);
+			return r;
+		}
+};
+
+enum { CACHE_SIZE = 256 };
+
+typedef CodecTupleStore<Os, TupleStoreT, CopyCodec, BIN(111)> NullStore;
+typedef CodecTupleStore<Os, TupleStoreT, HuffmanCodec<Os>, BIN(111)> HuffmanStore;
+typedef CodecTupleStore<Os, TupleStoreT, HuffmanCodec<Os>, BIN(111), CACHE_SIZE> CachedStore;
+
+typedef std::vector<std::string> Triple;
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			size_type n = (amp.argc > 1) ? atol(amp.argv[1]) : 4000;
+			size_type q = (amp.argc > 2) ? atol(amp.argv[2]) : 4000;
+
+			strings_.resize(3 * n);
+			tuples_.resize(n);
+			for(size_type i = 0; i < n; i++) {
+				char *s = strings_[3 * i], *p = strings_[3 * i + 1], *o = strings_[3 * i + 2];
+				triple(i, s, p, o);
+				tuples_[i].set(s, p, o);
+				expected_.push_back(to_triple(tuples_[i]));
+			}
+			std::sort(expected_.begin(), expected_.end());
+
+			srand(q);
+			for(size_type j = 0; j < q; j++) {
+				size_type subjects = (n + 4) / 5;
+				size_type s = (rand() % 10) ? (rand() % HOT) : (rand() % subjects);
+				queries_.push_back(s % subjects);
+			}
+
+			debug_->debug("# codec tuples workload ms us_per_op encode_hit_rate decode_hit_rate");
+			run<NullStore>("null");
+			run<HuffmanStore>("huffman");
+			run<CachedStore>("cached");
+		}
+
+	private:
+		enum { HOT = 16 };
+
+		struct Term {
+			char s[64];
+			operator char*() { return s; }
+		};
+
+		double now() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+		}
+
+		/**
+		 * i-th triple: sensors with a handful of properties and
+		 * observations, values partly shared (as in allocator_benchmark).
+		 */
+		void triple(size_type i, char *s, char *p, char *o) {
+			static const char *properties[] = { "rdf:type", "ssn:observedProperty", "ssn:hasValue", "rdfs:label", "geo:location" };
+			snprintf(s, 64, "<http://example.org/sensor/%lu>", (unsigned long)(i / 5));
+			snprintf(p, 64, "%s", properties[i % 5]);
+			if(i % 5 == 2) { snprintf(o, 64, "\"%lu.%lu\"", (unsigned long)(i * 7919 % 1000), (unsigned long)(i % 10)); }
+			else { snprintf(o, 64, "<http://example.org/type/%lu>", (unsigned long)(i % 37)); }
+		}
+
+		static Triple to_triple(Tuple& t) {
+			Triple r;
+			for(size_type i = 0; i < 3; i++) { r.push_back((char*)t.get(i)); }
+			return r;
+		}
+
+		template<typename Store>
+		Store* create() {
+			Store *store = new Store;
+			store->init(&dictionary_, &container_, debug_);
+			return store;
+		}
+
+		template<typename Store>
+		void destroy(Store *store) {
+			while(store->begin() != store->end()) {
+				store->erase(store->begin());
+			}
+			delete store;
+		}
+
+		template<typename Store>
+		void run(const char *codec) {
+			size_type n = tuples_.size();
+			dictionary_.init(debug_);
+
+			// insert
+			Store *store = create<Store>();
+			double t = now();
+			for(size_type i = 0; i < n; i++) {
+				store->insert(tuples_[i]);
+			}
+			report(codec, "insert", now() - t, n, *store);
+			destroy(store);
+
+			// batch
+			store = create<Store>();
+			t = now();
+			store->insert(&tuples_[0], n);
+			report(codec, "batch", now() - t, n, *store);
+
+			// lookup
+			char s[64], p[64], o[64];
+			std::vector<Triple> results;
+			t = now();
+			for(size_type j = 0; j < queries_.size(); j++) {
+				triple(queries_[j] * 5, s, p, o);
+				Tuple query;
+				query.set(s, 0, 0);
+				for(typename Store::iterator it = store->begin(&query, BIN(001)); it != store->end(); ++it) {
+					results.push_back(to_triple(*it));
+				}
+			}
+			report(codec, "lookup", now() - t, queries_.size(), *store);
+			if(lookup_results_.empty()) { lookup_results_ = results; }
+			else if(results != lookup_results_) { fail("lookup"); }
+
+			// scan
+			results.clear();
+			t = now();
+			for(typename Store::iterator it = store->begin(); it != store->end(); ++it) {
+				results.push_back(to_triple(*it));
+			}
+			report(codec, "scan", now() - t, n, *store);
+			std::sort(results.begin(), results.end());
+			if(results != expected_) { fail("scan"); }
+
+			destroy(store);
+		}
+
+		template<typename Store>
+		void report(const char *codec, const char *workload, double ms, size_type ops, Store& store) {
+			char e[16] = "-", d[16] = "-";
+			if(Store::CACHE_SIZE > 0) {
+				rate(e, store.encode_cache());
+				rate(d, store.decode_cache());
+			}
+			debug_->debug("%s %lu %s %.3f %.3f %s %s", codec, (unsigned long)tuples_.size(), workload,
+					ms, ms * 1000.0 / ops, e, d);
+		}
+
+		template<typename Cache>
+		void rate(char *out, Cache& cache) {
+			unsigned long all = cache.hits() + cache.misses();
+			if(all) { snprintf(out, 16, "%.3f", (double)cache.hits() / all); }
+			cache.reset_stats();
+		}
+
+		void fail(const char *what) {
+			debug_->debug("%s check failed", what);
+			exit(1);
+		}
+
+		std::vector<Term> strings_;
+		std::vector<Tuple> tuples_;
+		std::vector<Triple> expected_;
+		std::vector<Triple> lookup_results_;
+		std::vector<size_type> queries_;
+		Dictionary dictionary_;
+		TupleContainer container_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
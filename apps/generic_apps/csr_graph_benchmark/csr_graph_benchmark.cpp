@@ -0,0 +1,347 @@
+/*
+ * Traversal rate of the linked AdjacencyList against a CsrGraph snapshot
+ * of the same graph.
+ *
+ * A random geometric (unit disk) graph with n nodes in the unit square
+ * and the given average degree is built in an AdjacencyList, edges are
+ * inserted in random order as they would be by incremental topology
+ * updates. Then for each representation:
+ *  - BFS from a few sources,
+ *  - Dijkstra from the same sources (weight = distance in 1/1000),
+ *  - connected components,
+ * the CSR kernels with 1 worker and with the given number of workers.
+ * Results have to be identical, reported are times in ms and traversed
+ * (directed) edges per microsecond.
+ *
+ * With a Shawn world or WiseML file instead of n, the unit disk graph of
+ * the nodes in it is built directly as CsrGraph and its statistics are
+ * printed.
+ *
+ * Usage: csr_graph_benchmark [n [degree [threads]]]
+ *        csr_graph_benchmark <world.xml | file.wiseml> range [threads]
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::size_t size_type;
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <algorithms/graph/adjacency_list.h>
+#include <algorithms/graph/csr_graph.h>
+#include <algorithms/graph/csr_graph_kernels.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+enum { MAX_N = 131072, MAX_M = 1 << 20, SOURCES = 4 };
+
+typedef AdjacencyList<Os, MAX_N, MAX_M, int, ::uint32_t> LinkedGraph;
+typedef CsrGraph<Os, ::uint32_t> Graph;
+typedef CsrGraphKernels<Os, Graph> Kernels;
+typedef Kernels::depth_type depth_type;
+typedef Graph::vertex_type vertex_type;
+
+struct EdgeWeight {
+	::uint32_t operator()(::uint32_t data) const { return data; }
+};
+
+struct DistEntry {
+	::uint32_t dist;
+	size_type vertex;
+};
+
+int compare_entries(DistEntry& a, DistEntry& b) {
+	return a.dist < b.dist ? -1 : b.dist < a.dist;
+}
+
+typedef IndexedHeap<Os, DistEntry, std::vector<size_type>,
+		std::vector<IndexedHeap_detail::Node<DistEntry, size_type> >, &compare_entries> Heap;
+
+// ~80 MiB, too large for the stack
+LinkedGraph linked_;
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			if(amp.argc > 1 && (strstr(amp.argv[1], ".xml") || strstr(amp.argv[1], ".wiseml"))) {
+				double range = (amp.argc > 2) ? atof(amp.argv[2]) : 10.0;
+				threads_ = (amp.argc > 3) ? atol(amp.argv[3]) : 0;
+				run_file(amp.argv[1], range);
+				return;
+			}
+
+			size_type n = (amp.argc > 1) ? atol(amp.argv[1]) : 100000;
+			double degree = (amp.argc > 2) ? atof(amp.argv[2]) : 8.0;
+			threads_ = (amp.argc > 3) ? atol(amp.argv[3]) : 0;
+			if(n > MAX_N) { n = MAX_N; }
+
+			generate(n, degree);
+			if(linked_.num_edges() != csr_.edges()) { fail("snapshot", "edge count"); }
+			debug_->debug("# %lu vertices, %lu edges", (unsigned long)csr_.size(), (unsigned long)csr_.edges());
+			debug_->debug("# snapshot from AdjacencyList: %.1f ms", t_snapshot_);
+			debug_->debug("# representation kernel threads ms edges_per_us");
+
+			for(size_type i = 0; i < SOURCES; i++) { sources_[i] = (i * 7919) % n; }
+
+			run_linked();
+			run_csr(1);
+			Kernels probe;
+			probe.init(&csr_, threads_);
+			if(probe.threads() > 1) { run_csr(threads_); }
+			debug_->debug("# all results identical");
+		}
+
+	private:
+		double now() {
+			timeval tv;
+			gettimeofday(&tv, 0);
+			return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+		}
+
+		void report(const char *rep, const char *kernel, size_type threads, double ms, double edges) {
+			debug_->debug("%s %s %lu %.1f %.1f", rep, kernel, (unsigned long)threads, ms, edges / (ms * 1000.0));
+		}
+
+		void fail(const char *what, const char *detail) {
+			debug_->debug("%s: %s differs", what, detail);
+			exit(1);
+		}
+
+		/**
+		 * Random points in the unit square, range chosen for the
+		 * expected average degree. Neighbour pairs come from a CsrGraph
+		 * built from the positions, they are inserted into the linked
+		 * graph in random order.
+		 */
+		void generate(size_type n, double degree) {
+			srand(1);
+			std::vector<double> x(n), y(n);
+			for(size_type i = 0; i < n; i++) {
+				x[i] = rand() / (RAND_MAX + 1.0);
+				y[i] = rand() / (RAND_MAX + 1.0);
+			}
+			double range = sqrt(degree / (3.14159265 * n));
+			Graph positions;
+			positions.from_positions(n, &x[0], &y[0], 0, range, 1000.0 / range);
+
+			std::vector<std::pair<vertex_type, vertex_type> > pairs;
+			for(vertex_type u = 0; u < positions.size(); u++) {
+				for(const vertex_type *v = positions.out_begin(u); v != positions.out_end(u); ++v) {
+					if(u < *v) { pairs.push_back(std::make_pair(u, *v)); }
+				}
+			}
+			for(size_type i = pairs.size(); i > 1; i--) {
+				std::swap(pairs[i - 1], pairs[rand() % i]);
+			}
+			if(2 * pairs.size() > MAX_M) { pairs.resize(MAX_M / 2); }
+
+			for(size_type i = 0; i < n; i++) { linked_.add_vertex(); }
+			for(size_type i = 0; i < pairs.size(); i++) {
+				vertex_type u = pairs[i].first, v = pairs[i].second;
+				::uint32_t w = *(std::lower_bound(positions.out_begin(u), positions.out_end(u), v)
+						- positions.out_begin(u) + positions.out_weights(u));
+				linked_.add_edge(linked_.vertex(u), linked_.vertex(v), w);
+				linked_.add_edge(linked_.vertex(v), linked_.vertex(u), w);
+			}
+
+			double t = now();
+			csr_.from_adjacency_list(linked_, EdgeWeight());
+			t_snapshot_ = now() - t;
+		}
+
+		void run_file(const char *filename, double range) {
+			if(csr_.load_topology(filename, range) != Graph::SUCCESS) {
+				debug_->debug("could not read %s", filename);
+				exit(1);
+			}
+			Kernels kernels;
+			kernels.init(&csr_, threads_);
+			std::vector<vertex_type> label;
+			size_type components = kernels.connected_components(label);
+			std::vector<depth_type> depth;
+			kernels.bfs(0, depth);
+			depth_type max_depth = 0;
+			for(size_type i = 0; i < depth.size(); i++) {
+				if(depth[i] != (depth_type)Kernels::UNREACHED) { max_depth = std::max(max_depth, depth[i]); }
+			}
+			debug_->debug("%s: %lu nodes, %lu links, %lu components, eccentricity of %s: %lu",
+					filename, (unsigned long)csr_.size(), (unsigned long)csr_.edges() / 2,
+					(unsigned long)components, csr_.size() ? csr_.name(0) : "-", (unsigned long)max_depth);
+		}
+
+		//
+		// Linked representation, sequential
+		//
+
+		void run_linked() {
+			double t = now();
+			for(size_type s = 0; s < SOURCES; s++) { linked_bfs(sources_[s], linked_depth_[s]); }
+			report("linked", "bfs", 1, now() - t, (double)SOURCES * csr_.edges());
+
+			t = now();
+			for(size_type s = 0; s < SOURCES; s++) { linked_dijkstra(sources_[s], linked_dist_[s]); }
+			report("linked", "dijkstra", 1, now() - t, (double)SOURCES * csr_.edges());
+
+			t = now();
+			linked_components_ = linked_cc(linked_label_);
+			report("linked", "cc", 1, now() - t, (double)csr_.edges());
+		}
+
+		void linked_bfs(size_type source, std::vector<depth_type>& depth) {
+			depth.assign(csr_.size(), (depth_type)Kernels::UNREACHED);
+			std::vector<size_type> queue;
+			queue.reserve(csr_.size());
+			queue.push_back(source);
+			depth[source] = 0;
+			for(size_type i = 0; i < queue.size(); i++) {
+				LinkedGraph::VertexDescriptor u = linked_.vertex(queue[i]);
+				LinkedGraph::VertexDescriptor::OutEdgeIteratorRange out = u.out_edges();
+				for(LinkedGraph::VertexDescriptor::OutEdgeIterator e = out.first; e != out.second; ++e) {
+					size_type v = e.target().index();
+					if(depth[v] == (depth_type)Kernels::UNREACHED) {
+						depth[v] = depth[queue[i]] + 1;
+						queue.push_back(v);
+					}
+				}
+			}
+		}
+
+		void linked_dijkstra(size_type source, std::vector< ::uint32_t>& dist) {
+			enum { SETTLED = (size_type)(-2) };
+			dist.assign(csr_.size(), Kernels::infinity());
+			std::vector<size_type> handles(csr_.size(), (size_type)Heap::NO_HANDLE);
+			Heap heap;
+			DistEntry entry = { 0, source };
+			dist[source] = 0;
+			handles[source] = heap.push(entry);
+			while(!heap.empty()) {
+				DistEntry top = heap.pop();
+				handles[top.vertex] = SETTLED;
+				LinkedGraph::VertexDescriptor u = linked_.vertex(top.vertex);
+				LinkedGraph::VertexDescriptor::OutEdgeIteratorRange out = u.out_edges();
+				for(LinkedGraph::VertexDescriptor::OutEdgeIterator e = out.first; e != out.second; ++e) {
+					size_type v = e.target().index();
+					if(handles[v] == (size_type)SETTLED) { continue; }
+					::uint32_t d = top.dist + *e;
+					if(d >= dist[v]) { continue; }
+					dist[v] = d;
+					entry.dist = d;
+					entry.vertex = v;
+					if(handles[v] == (size_type)Heap::NO_HANDLE) { handles[v] = heap.push(entry); }
+					else { heap.decrease_key(handles[v], entry); }
+				}
+			}
+		}
+
+		/// BFS from every unlabeled vertex in increasing order
+		size_type linked_cc(std::vector<vertex_type>& label) {
+			label.assign(csr_.size(), (vertex_type)Graph::NO_VERTEX);
+			std::vector<size_type> queue;
+			queue.reserve(csr_.size());
+			size_type components = 0;
+			for(size_type s = 0; s < csr_.size(); s++) {
+				if(label[s] != (vertex_type)Graph::NO_VERTEX) { continue; }
+				components++;
+				queue.clear();
+				queue.push_back(s);
+				label[s] = s;
+				for(size_type i = 0; i < queue.size(); i++) {
+					LinkedGraph::VertexDescriptor u = linked_.vertex(queue[i]);
+					LinkedGraph::VertexDescriptor::OutEdgeIteratorRange out = u.out_edges();
+					for(LinkedGraph::VertexDescriptor::OutEdgeIterator e = out.first; e != out.second; ++e) {
+						size_type v = e.target().index();
+						if(label[v] == (vertex_type)Graph::NO_VERTEX) {
+							label[v] = s;
+							queue.push_back(v);
+						}
+					}
+				}
+			}
+			return components;
+		}
+
+		//
+		// CSR kernels
+		//
+
+		void run_csr(size_type threads) {
+			Kernels kernels;
+			kernels.init(&csr_, threads);
+			threads = kernels.threads();
+
+			std::vector<depth_type> depth;
+			size_type bottom_up = 0;
+			double t = now();
+			for(size_type s = 0; s < SOURCES; s++) {
+				kernels.bfs(sources_[s], depth);
+				bottom_up += kernels.bottom_up_levels();
+				if(depth != linked_depth_[s]) { fail("bfs", "depth"); }
+			}
+			report("csr", "bfs", threads, now() - t, (double)SOURCES * csr_.edges());
+
+			t = now();
+			std::vector< ::uint32_t> dist;
+			for(size_type s = 0; s < SOURCES; s++) {
+				kernels.dijkstra(sources_[s], dist);
+				if(dist != linked_dist_[s]) { fail("dijkstra", "distance"); }
+			}
+			report("csr", "dijkstra", 1, now() - t, (double)SOURCES * csr_.edges());
+
+			if(threads > 1) {
+				std::vector< ::uint32_t> dists[SOURCES];
+				t = now();
+				kernels.dijkstra(sources_, SOURCES, dists);
+				report("csr", "dijkstra-parallel", threads, now() - t, (double)SOURCES * csr_.edges());
+				for(size_type s = 0; s < SOURCES; s++) {
+					if(dists[s] != linked_dist_[s]) { fail("dijkstra-parallel", "distance"); }
+				}
+			}
+
+			t = now();
+			std::vector<vertex_type> label;
+			size_type components = kernels.connected_components(label);
+			report("csr", "cc", threads, now() - t, (double)csr_.edges());
+			if(components != linked_components_ || label != linked_label_) { fail("cc", "labels"); }
+
+			debug_->debug("# %lu of the bfs levels were expanded bottom-up", (unsigned long)bottom_up);
+		}
+
+		Graph csr_;
+		double t_snapshot_;
+		size_type threads_;
+		vertex_type sources_[SOURCES];
+		std::vector<depth_type> linked_depth_[SOURCES];
+		std::vector< ::uint32_t> linked_dist_[SOURCES];
+		std::vector<vertex_type> linked_label_;
+		size_type linked_components_;
+
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,426 @@
+/*
+ * INQP graph pattern selection against tuple store size.
+ *
+ * The tuple store is filled with n triples shaped like the inqp_test
+ * data (nqxe_test.cpp): n/5 sensors, each with an observed property, two
+ * numeric values and a feature of interest that has a location. Then the
+ * selection is executed for the patterns
+ *  - value: (?s hasValue ?v), projecting ?s and ?v as INTEGER (40%)
+ *  - property: (?s observedProperty Temperature), projecting ?s (20%)
+ *  - subject: (sensorK ?p ?o), projecting ?p and ?o (4 triples)
+ *  - all: (?s ?p ?o), projecting everything
+ *  - missing: (?s hasValue "-1"), the constant is not in the store
+ * with GraphPatternSelection and with its former execute() (every
+ * column of every tuple translated into a hash value, numeric values
+ * converted before the tuple is known to match, kept here as
+ * LegacySelection). Before timing, both are checked to push the same
+ * rows.
+ * Dictionaries:
+ *  - prescilla: PrescillaDictionary as in inqp_test, the query processor's
+ *    translators with their small caches (constants are resolved by
+ *    iterating the dictionary, which does not reach every key, the others
+ *    are compared by hash value)
+ *  - hash: HashDictionary, translations by its hash index
+ *
+ * Output: dictionary pattern n impl rows us_per_execution
+ *
+ * Usage: gps_benchmark
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <vector>
+#include <algorithm>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithms/hash/sdbm.h>
+#include <util/pstl/vector_static.h>
+#include <util/tuple_store/tuplestore.h>
+#include <util/tuple_store/prescilla_dictionary.h>
+#include <util/tuple_store/hash_dictionary.h>
+#include <algorithms/rdf/inqp/row.h>
+#include <algorithms/rdf/inqp/hash_translator.h>
+#include <algorithms/rdf/inqp/dictionary_translator.h>
+#include <algorithms/rdf/inqp/operators/graph_pattern_selection.h>
+
+typedef Sdbm<Os> Hash;
+/**
+ * The triple of inqp_test/tuple.h, but with dictionary keys as wide as
+ * pointers (PrescillaDictionary keys are node addresses).
+ */
+class TupleT {
+	public:
+		enum { SIZE = 3 };
+		
+		TupleT() { for(size_type i = 0; i < SIZE; i++) { data_[i] = 0; } }
+		
+		block_data_t* get(size_type i) { return reinterpret_cast<block_data_t*>(data_[i]); }
+		void set(size_type i, block_data_t* data) { data_[i] = reinterpret_cast<unsigned long>(data); }
+		size_type length(size_type i) { return get(i) ? strlen((char*)get(i)) : 0; }
+		
+		void set_deep(size_type i, block_data_t* data) {
+			size_type l = strlen((char*)data) + 1;
+			set(i, ::get_allocator().allocate_array<block_data_t>(l).raw());
+			memcpy(get(i), data, l);
+		}
+		void free_deep(size_type i) {
+			if(get(i)) { ::get_allocator().free_array(get(i)); }
+			set(i, 0);
+		}
+		void destruct_deep() { for(size_type i = 0; i < SIZE; i++) { free_deep(i); } }
+		
+		void set_key(size_type i, unsigned long k) { data_[i] = k; }
+		unsigned long get_key(size_type i) const { return data_[i]; }
+		
+		static int compare(int col, ::uint8_t *a, int alen, ::uint8_t *b, int blen) {
+			if(alen != blen) { return blen - alen; }
+			return memcmp(a, b, alen);
+		}
+		
+		bool operator==(const TupleT& other) const {
+			return data_[0] == other.data_[0] && data_[1] == other.data_[1] && data_[2] == other.data_[2];
+		}
+		
+	private:
+		unsigned long data_[SIZE];
+};
+
+enum { MAX_TRIPLES = 100000 };
+typedef vector_static<Os, TupleT, MAX_TRIPLES> TupleContainer;
+typedef Row<Os> RowT;
+
+/**
+ * The parts of INQPQueryProcessor the selection operator uses.
+ */
+template<typename Dictionary_P>
+class Processor {
+	public:
+		typedef Dictionary_P Dictionary;
+		typedef TupleStore<Os, TupleContainer, Dictionary, Os::Debug, BIN(111), &TupleT::compare> TupleStoreT;
+		typedef Processor<Dictionary_P> self_type;
+		typedef ::uint8_t operator_id_t;
+		typedef ::RowT RowT;
+		typedef RowT::Value Value;
+		typedef DictionaryTranslator<Os, Dictionary, Hash, 8> Translator;
+		typedef HashTranslator<Os, Dictionary, Hash, 4> ReverseTranslator;
+		typedef Os::Timer Timer;
+		
+		class Query {
+			public:
+				Query(self_type *p) : processor_(p) { }
+				self_type& processor() { return *processor_; }
+			private:
+				self_type *processor_;
+		};
+		
+		void init(TupleStoreT *ts) {
+			tuple_store_ = ts;
+			translator_.init(&dictionary());
+			reverse_translator_.init(&dictionary());
+		}
+		
+		Dictionary& dictionary() { return tuple_store_->dictionary(); }
+		Translator& translator() { return translator_; }
+		ReverseTranslator& reverse_translator() { return reverse_translator_; }
+		
+	private:
+		TupleStoreT *tuple_store_;
+		Translator translator_;
+		ReverseTranslator reverse_translator_;
+};
+
+/**
+ * The former GraphPatternSelection::execute().
+ */
+template<typename Processor_P>
+class LegacySelection : public Operator<Os, Processor_P> {
+	public:
+		typedef Operator<Os, Processor_P> Base;
+		typedef typename Processor_P::TupleStoreT TupleStoreT;
+		typedef typename Processor_P::Value Value;
+		
+		void init(typename Base::Query* query, ProjectionInfo<Os> projection,
+				bool affected0, bool affected1, bool affected2, Value value0, Value value1, Value value2) {
+			Base::init(0, query, 1, 0, 0, projection);
+			affected_[0] = affected0;
+			affected_[1] = affected1;
+			affected_[2] = affected2;
+			values_[0] = value0;
+			values_[1] = value1;
+			values_[2] = value2;
+		}
+		
+		void execute(TupleStoreT& ts) {
+			typedef typename TupleStoreT::TupleContainer::iterator Citer;
+			
+			RowT *row = RowT::create(this->projection_info().columns());
+			for(Citer iter = ts.container().begin(); iter != ts.container().end(); ++iter) {
+				bool match = true;
+				size_type row_idx = 0;
+				for(size_type i = 0; i < 3; i++) {
+					Value v = this->translator().translate(iter->get_key(i));
+					if(affected_[i] && values_[i] != v) {
+						match = false;
+						break;
+					}
+					switch(this->projection_info().type(i)) {
+						case ProjectionInfoBase::IGNORE:
+							break;
+						case ProjectionInfoBase::INTEGER: {
+							block_data_t *s = this->dictionary().get_value(iter->get_key(i));
+							long l = atol((char*)s);
+							Value v;
+							memcpy(&v, &l, sizeof(v));
+							(*row)[row_idx++] = v;
+							this->dictionary().free_value(s);
+							break;
+						}
+						case ProjectionInfoBase::FLOAT: {
+							block_data_t *s = this->dictionary().get_value(iter->get_key(i));
+							float f = atof((char*)s);
+							Value v;
+							memcpy(&v, &f, sizeof(v));
+							(*row)[row_idx++] = v;
+							this->dictionary().free_value(s);
+							break;
+						}
+						case ProjectionInfoBase::STRING:
+							(*row)[row_idx++] = v;
+							this->reverse_translator().offer(iter->get_key(i), v);
+							break;
+					}
+				}
+				if(match) {
+					this->parent().push(*row);
+				}
+			}
+			row->destroy();
+			this->parent().push(Base::END_OF_INPUT);
+		}
+		
+	private:
+		Value values_[3];
+		bool affected_[3];
+};
+
+/**
+ * Parent operator, records or just counts the pushed rows.
+ */
+class Sink {
+	public:
+		Sink() : columns_(0), record_(false), rows_(0), sum_(0), done_(false) { }
+		
+		void reset(size_type columns, bool record) {
+			columns_ = columns;
+			record_ = record;
+			rows_ = 0;
+			sum_ = 0;
+			done_ = false;
+			values_.clear();
+		}
+		
+		void push(size_type port, RowT& row) {
+			// END_OF_INPUT is a null reference
+			RowT* volatile p = &row;
+			if(!p) {
+				done_ = true;
+				return;
+			}
+			rows_++;
+			for(size_type i = 0; i < columns_; i++) {
+				sum_ += row[i];
+				if(record_) { values_.push_back(row[i]); }
+			}
+		}
+		
+		size_type columns_;
+		bool record_;
+		unsigned long rows_;
+		unsigned long sum_;
+		bool done_;
+		std::vector<RowT::Value> values_;
+};
+
+struct Pattern {
+	const char *name;
+	const char *s, *p, *o;
+	int projection;
+};
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+			
+			debug_->debug("# dictionary pattern n impl rows us_per_execution");
+			static const size_type ns[] = { 1000, 10000, 100000 };
+			for(size_type i = 0; i < sizeof(ns) / sizeof(ns[0]); i++) {
+				run<PrescillaDictionary<Os> >("prescilla", ns[i]);
+				run<HashDictionary<Os, Hash> >("hash", ns[i]);
+			}
+		}
+		
+	private:
+		enum { STRING = ProjectionInfoBase::STRING, INTEGER = ProjectionInfoBase::INTEGER };
+		
+		double now() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+		}
+		
+		static Hash::hash_t hash(const char *s) {
+			return s ? Hash::hash((block_data_t*)s, strlen(s)) : 0;
+		}
+		
+		template<typename TS>
+		void ins(TS& ts, const char *s, const char *p, const char *o) {
+			TupleT t;
+			t.set(0, (block_data_t*)const_cast<char*>(s));
+			t.set(1, (block_data_t*)const_cast<char*>(p));
+			t.set(2, (block_data_t*)const_cast<char*>(o));
+			ts.insert(t);
+		}
+		
+		template<typename TS>
+		void fill(TS& ts, size_type n) {
+			char sensor[64], room[64], v0[16], v1[16];
+			for(size_type i = 0; i < n / 5; i++) {
+				snprintf(sensor, sizeof(sensor), "<http://foo.bar/sensor%lu>", (unsigned long)i);
+				snprintf(room, sizeof(room), "<http://foo.bar/room%lu>", (unsigned long)i);
+				snprintf(v0, sizeof(v0), "%lu", (unsigned long)(i % 100) * 17);
+				snprintf(v1, sizeof(v1), "%lu", (unsigned long)(i * 7919) % 100000);
+				ins(ts, sensor, "<http://purl.oclc.org/NET/ssnx/ssn#observedProperty>", "<http://me.exmpl/Temperature>");
+				ins(ts, sensor, "<http://www.ontologydesignpatterns.org/ont/dul/hasValue>", v0);
+				ins(ts, sensor, "<http://www.ontologydesignpatterns.org/ont/dul/hasValue>", v1);
+				ins(ts, sensor, "<http://purl.oclc.org/NET/ssnx/ssn#featureOfInterest>", room);
+				ins(ts, room, "<http://www.ontologydesignpatterns.org/ont/dul/hasLocation>", "<http://me.exmpl/DERI>");
+			}
+		}
+		
+		template<typename Dictionary>
+		void run(const char *dictionary_name, size_type n) {
+			typedef Processor<Dictionary> P;
+			typedef typename P::TupleStoreT TS;
+			typedef typename P::Query Query;
+			
+			Dictionary dictionary;
+			TupleContainer *container = new TupleContainer;
+			TS ts;
+			dictionary.init(debug_);
+			ts.init(&dictionary, container, debug_);
+			fill(ts, n);
+			
+			P processor;
+			processor.init(&ts);
+			Query query(&processor);
+			
+			char subject[64];
+			snprintf(subject, sizeof(subject), "<http://foo.bar/sensor%lu>", (unsigned long)(n / 10));
+			const Pattern patterns[] = {
+				{ "value", 0, "<http://www.ontologydesignpatterns.org/ont/dul/hasValue>", 0, STRING | INTEGER << 4 },
+				{ "property", 0, "<http://purl.oclc.org/NET/ssnx/ssn#observedProperty>", "<http://me.exmpl/Temperature>", STRING },
+				{ "subject", subject, 0, 0, STRING << 2 | STRING << 4 },
+				{ "all", 0, 0, 0, STRING | STRING << 2 | STRING << 4 },
+				{ "missing", 0, "<http://www.ontologydesignpatterns.org/ont/dul/hasValue>", "-1", STRING },
+			};
+			
+			for(size_type i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+				const Pattern &pt = patterns[i];
+				ProjectionInfo<Os> projection(pt.projection);
+				
+				GraphPatternSelection<Os, P> gps;
+				gps.init(&query, 1, 0, 0, projection, pt.s != 0, pt.p != 0, pt.o != 0,
+						hash(pt.s), hash(pt.p), hash(pt.o));
+				LegacySelection<P> legacy;
+				legacy.init(&query, projection, pt.s != 0, pt.p != 0, pt.o != 0,
+						hash(pt.s), hash(pt.p), hash(pt.o));
+				
+				Sink sink;
+				gps.parent().push_ = Operator<Os, P>::push_t::template from_method<Sink, &Sink::push>(&sink);
+				legacy.parent().push_ = gps.parent().push_;
+				
+				check(gps, legacy, ts, sink, projection.columns(), pt.name);
+				
+				// roughly the same total work for every n
+				size_type reps = 1 + 1000000 / n;
+				time(gps, ts, sink, reps, dictionary_name, pt.name, n, "gps");
+				time(legacy, ts, sink, reps, dictionary_name, pt.name, n, "legacy");
+			}
+			delete container;
+		}
+		
+		template<typename Op, typename TS>
+		void time(Op& op, TS& ts, Sink& sink, size_type reps,
+				const char *dictionary_name, const char *pattern, size_type n, const char *impl) {
+			double t = now();
+			unsigned long rows = 0;
+			for(size_type r = 0; r < reps; r++) {
+				sink.reset(op.projection_info().columns(), false);
+				op.execute(ts);
+				rows = sink.rows_;
+			}
+			t = now() - t;
+			debug_->debug("%s %s %lu %s %lu %.2f", dictionary_name, pattern, (unsigned long)n,
+					impl, rows, t / reps);
+		}
+		
+		/**
+		 * Both implementations push the same rows (in the same order, as
+		 * both scan the container).
+		 */
+		template<typename Gps, typename Legacy, typename TS>
+		void check(Gps& gps, Legacy& legacy, TS& ts, Sink& sink, size_type columns, const char *pattern) {
+			sink.reset(columns, true);
+			gps.execute(ts);
+			if(!sink.done_) { fail(pattern, "gps end of input"); }
+			std::vector<RowT::Value> v = sink.values_;
+			unsigned long rows = sink.rows_;
+			
+			sink.reset(columns, true);
+			legacy.execute(ts);
+			if(!sink.done_) { fail(pattern, "legacy end of input"); }
+			if(rows != sink.rows_ || v != sink.values_) { debug_->debug("%lu %lu %lu %lu", rows, sink.rows_, v.size(), sink.values_.size()); for(size_type i=0;i<v.size()&&i<8;i++) debug_->debug("%x %x", v[i], sink.values_[i]); fail(pattern, "rows"); }
+		}
+		
+		void fail(const char *pattern, const char *what) {
+			debug_->debug("%s: %s check failed", pattern, what);
+			exit(1);
+		}
+		
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
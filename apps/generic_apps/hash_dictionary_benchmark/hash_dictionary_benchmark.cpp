@@ -0,0 +1,263 @@
+/*
+ * RDF term interning with HashDictionary against AvlDictionary and
+ * PrescillaDictionary.
+ *
+ * Reads the shdt_test corpora (N-Triples). For copies > 1 the corpus is
+ * repeated with a per-copy suffix on every term, giving larger
+ * dictionaries with the same string shapes. For every dictionary:
+ *  - insert: insert every term occurrence (reference counted), like a
+ *    tuple store does
+ *  - find: look up every occurrence
+ *  - miss: look up every occurrence with an extra character appended
+ *  - erase: erase every occurrence again
+ * All the same string must get the same key, the dictionary must be
+ * empty afterwards.
+ *
+ * Output: corpus copies occurrences distinct dictionary insert_ns find_ns
+ * miss_ns erase_ns bytes (ns per operation, bytes only for the hash
+ * dictionary)
+ *
+ * Usage: hash_dictionary_benchmark [file.rdf ...]
+ *   (default: ../shdt_test/{incontextsensing,btcsample0,ssp}.rdf)
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/split_n3.h>
+#include <util/tuple_store/hash_dictionary.h>
+#include <util/tuple_store/avl_dictionary.h>
+#include <util/tuple_store/prescilla_dictionary.h>
+
+typedef HashDictionary<Os> HashDict;
+typedef AvlDictionary<Os> AvlDict;
+typedef PrescillaDictionary<Os> PrescillaDict;
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			check();
+
+			const char *defaults[] = {
+				"../shdt_test/incontextsensing.rdf",
+				"../shdt_test/btcsample0.rdf",
+				"../shdt_test/ssp.rdf"
+			};
+			size_type n_files = (amp.argc > 1) ? amp.argc - 1 : 3;
+
+			debug_->debug("# corpus copies occurrences distinct dictionary insert_ns find_ns miss_ns erase_ns bytes");
+			for(size_type f = 0; f < n_files; f++) {
+				const char *path = (amp.argc > 1) ? amp.argv[f + 1] : defaults[f];
+				if(!load(path)) {
+					debug_->debug("could not read %s", path);
+					continue;
+				}
+				static const size_type copies[] = { 1, 8, 64 };
+				for(size_type c = 0; c < sizeof(copies) / sizeof(copies[0]); c++) {
+					generate(copies[c]);
+					run<HashDict>(path, copies[c], "hash");
+					run<AvlDict>(path, copies[c], "avl");
+					run<PrescillaDict>(path, copies[c], "prescilla");
+				}
+			}
+		}
+
+	private:
+		double now_ns() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1e9 + ts.tv_nsec;
+		}
+
+		bool load(const char *path) {
+			terms_.clear();
+			FILE *f = fopen(path, "r");
+			if(!f) { return false; }
+			static char line[20480];
+			SplitN3<Os> splitter;
+			while(fgets(line, sizeof(line), f)) {
+				line[strcspn(line, "\r\n")] = '\0';
+				splitter.parse_line(line);
+				if(splitter.size() < 3) { continue; }
+				for(size_type i = 0; i < 3; i++) { terms_.push_back(splitter[i]); }
+			}
+			fclose(f);
+			return true;
+		}
+
+		/**
+		 * Occurrences (and the strings to miss) for the given number of
+		 * copies of the corpus.
+		 */
+		void generate(size_type copies) {
+			pool_.clear();
+			present_.clear();
+			absent_.clear();
+			std::map<std::string, int> distinct;
+			char suffix[16];
+			for(size_type c = 0; c < copies; c++) {
+				snprintf(suffix, sizeof(suffix), c ? "~%lu" : "", (unsigned long)c);
+				for(size_type i = 0; i < terms_.size(); i++) {
+					std::string s = terms_[i] + suffix;
+					distinct[s] = 1;
+					present_.push_back(pool_.size());
+					pool_.insert(pool_.end(), s.begin(), s.end());
+					pool_.push_back('\0');
+					absent_.push_back(pool_.size());
+					pool_.insert(pool_.end(), s.begin(), s.end());
+					pool_.push_back('!');
+					pool_.push_back('\0');
+				}
+			}
+			distinct_ = distinct.size();
+		}
+
+		block_data_t* str(std::vector<size_type>& offsets, size_type i) {
+			return reinterpret_cast<block_data_t*>(&pool_[offsets[i]]);
+		}
+
+		template<typename Dict>
+		void run(const char *path, size_type copies, const char *name) {
+			Dict *dict = new Dict;
+			dict->init(debug_);
+			size_type n = present_.size();
+			std::vector<typename Dict::key_type> keys(n);
+			std::map<std::string, typename Dict::key_type> seen;
+
+			double t0 = now_ns();
+			for(size_type i = 0; i < n; i++) { keys[i] = dict->insert(str(present_, i)); }
+			double t1 = now_ns();
+			for(size_type i = 0; i < n; i++) {
+				if(dict->find(str(present_, i)) != keys[i]) { fail(name, "find"); }
+			}
+			double t2 = now_ns();
+			for(size_type i = 0; i < n; i++) {
+				if(dict->find(str(absent_, i)) != Dict::NULL_KEY) { fail(name, "miss"); }
+			}
+			double t3 = now_ns();
+			size_type bytes = memory(*dict);
+
+			for(size_type i = 0; i < n; i++) {
+				std::string s((char*)str(present_, i));
+				if(seen.count(s) && seen[s] != keys[i]) { fail(name, "same key for the same string"); }
+				seen[s] = keys[i];
+			}
+			if(seen.size() != distinct_) { fail(name, "distinct keys"); }
+
+			double t4 = now_ns();
+			for(size_type i = 0; i < n; i++) { dict->erase(keys[i]); }
+			double t5 = now_ns();
+			if(dict->find(str(present_, 0)) != Dict::NULL_KEY) { fail(name, "erase"); }
+
+			debug_->debug("%s %lu %lu %lu %s %.1f %.1f %.1f %.1f %lu", path, (unsigned long)copies,
+					(unsigned long)n, (unsigned long)distinct_, name,
+					(t1 - t0) / n, (t2 - t1) / n, (t3 - t2) / n, (t5 - t4) / n, (unsigned long)bytes);
+			delete dict;
+		}
+
+		template<typename Dict>
+		size_type memory(Dict&) { return 0; }
+		size_type memory(HashDict& dict) { return dict.memory(); }
+
+		/**
+		 * Random inserts and erases against std::map, with key reuse,
+		 * compaction and inserting strings obtained from the dictionary.
+		 */
+		void check() {
+			HashDict dict;
+			dict.init(debug_);
+			std::map<std::string, std::pair<HashDict::key_type, int> > ref;
+			char buf[64];
+			srand(7);
+			for(int k = 0; k < 200000; k++) {
+				snprintf(buf, sizeof(buf), "<http://example.org/%d>", rand() % 3000);
+				std::string s(buf);
+				if(rand() % 3) {
+					HashDict::key_type key = dict.insert((block_data_t*)buf);
+					if(ref.count(s)) {
+						if(ref[s].first != key) { fail("hash", "check: key changed"); }
+						ref[s].second++;
+					}
+					else {
+						ref[s] = std::make_pair(key, 1);
+					}
+				}
+				else if(ref.count(s)) {
+					HashDict::key_type key = ref[s].first;
+					if(dict.find((block_data_t*)buf) != key) { fail("hash", "check: find"); }
+					if(rand() % 4 == 0) {
+						// from the dictionary itself
+						if(dict.insert(dict.get_value(key)) != key) { fail("hash", "check: insert of get_value()"); }
+						dict.erase(key);
+					}
+					dict.erase(key);
+					if(--ref[s].second == 0) {
+						ref.erase(s);
+						if(dict.find((block_data_t*)buf) != HashDict::NULL_KEY) { fail("hash", "check: erase"); }
+					}
+				}
+				if(dict.size() != ref.size()) { fail("hash", "check: size"); }
+			}
+
+			size_type n = 0;
+			for(HashDict::iterator it = dict.begin_keys(); it != dict.end_keys(); ++it, n++) {
+				std::string s((char*)dict.get(*it));
+				if(!ref.count(s) || ref[s].first != *it || (int)dict.count(*it) != ref[s].second) {
+					fail("hash", "check: contents");
+				}
+			}
+			if(n != ref.size()) { fail("hash", "check: iteration"); }
+		}
+
+		void fail(const char *name, const char *what) {
+			debug_->debug("%s: %s failed", name, what);
+			exit(1);
+		}
+
+		std::vector<std::string> terms_;
+		std::vector<char> pool_;
+		std::vector<size_type> present_, absent_;
+		size_type distinct_;
+
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
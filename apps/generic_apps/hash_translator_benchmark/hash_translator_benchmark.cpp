@@ -0,0 +1,209 @@
+/*
+ * INQP hash <-> dictionary key translation against dictionary size.
+ *
+ * A dictionary is filled with n distinct URI-like strings, then
+ *  - setup: a query with 8 constants (hash values) is set up, i.e. the
+ *    constants are translated into dictionary keys with HashTranslator.
+ *    Half of them are not in the dictionary.
+ *  - scan: every key is translated into its hash value with
+ *    DictionaryTranslator, as GraphPatternSelection does per tuple.
+ * Dictionaries:
+ *  - prescilla: PrescillaDictionary, translators with their small caches
+ *    and the exhaustive dictionary search
+ *  - prescilla+index: HashIndexedDictionary around PrescillaDictionary
+ *  - hash: HashDictionary with the query processor's hash function
+ *
+ * Output: dictionary n setup_us_per_query scan_ns_per_key
+ *
+ * Usage: hash_translator_benchmark
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <vector>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithms/hash/sdbm.h>
+#include <util/tuple_store/prescilla_dictionary.h>
+#include <util/tuple_store/hash_dictionary.h>
+#include <util/tuple_store/hash_indexed_dictionary.h>
+#include <algorithms/rdf/inqp/hash_translator.h>
+#include <algorithms/rdf/inqp/dictionary_translator.h>
+
+typedef Sdbm<Os> Hash;
+typedef Hash::hash_t hash_t;
+
+typedef PrescillaDictionary<Os> Prescilla;
+typedef HashIndexedDictionary<Os, Prescilla, Hash> IndexedPrescilla;
+typedef HashDictionary<Os, Hash> HashDict;
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			check_index();
+
+			debug_->debug("# dictionary n setup_us_per_query scan_ns_per_key");
+			static const size_type sizes[] = { 1000, 10000, 100000 };
+			for(size_type i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+				generate(sizes[i]);
+				run<Prescilla>("prescilla");
+				run<IndexedPrescilla>("prescilla+index");
+				run<HashDict>("hash");
+			}
+		}
+
+	private:
+		enum { CONSTANTS = 8 };
+
+		double now_ns() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1e9 + ts.tv_nsec;
+		}
+
+		block_data_t* str(size_type i) { return reinterpret_cast<block_data_t*>(&pool_[offsets_[i]]); }
+		hash_t hash(size_type i) { return Hash::hash(str(i), strlen((char*)str(i))); }
+
+		/**
+		 * 2n strings, the first n go into the dictionary.
+		 */
+		void generate(size_type n) {
+			n_ = n;
+			pool_.clear();
+			offsets_.clear();
+			char buf[128];
+			for(size_type i = 0; i < 2 * n; i++) {
+				unsigned long x = (unsigned long)((i * 2654435761UL) % 4294967291UL);
+				int l = snprintf(buf, sizeof(buf), "<http://example.org/%s/%lx/%.*s>",
+						(x & 1) ? "sensor" : "observation", x, (int)(x % 24), "abcdefghijklmnopqrstuvwxyz");
+				offsets_.push_back(pool_.size());
+				pool_.insert(pool_.end(), buf, buf + l + 1);
+			}
+		}
+
+		template<typename Dict>
+		void run(const char *name) {
+			typedef HashTranslator<Os, Dict, Hash, 4> ReverseTranslator;
+			typedef DictionaryTranslator<Os, Dict, Hash, 8> Translator;
+
+			Dict *dict = new Dict;
+			dict->init(debug_);
+			std::vector<typename Dict::key_type> keys(n_);
+			for(size_type i = 0; i < n_; i++) { keys[i] = dict->insert(str(i)); }
+
+			ReverseTranslator *reverse = new ReverseTranslator;
+			reverse->init(dict);
+			Translator *translator = new Translator;
+			translator->init(dict);
+
+			// setup: run queries until at least 0.2s have passed
+			size_type queries = 0;
+			double t0 = now_ns(), t = t0;
+			for( ; t - t0 < 2e8 && queries < 100000; queries++) {
+				for(size_type c = 0; c < CONSTANTS; c++) {
+					size_type i = (queries * 7919 + c * 104729) % n_ + ((c & 1) ? n_ : 0);
+					typename Dict::key_type k = reverse->translate(hash(i));
+					if(i < n_ && k != keys[i]) {
+						// only hash collisions may give another key
+						block_data_t *s = dict->get_value(k);
+						bool same = (k != Dict::NULL_KEY) && Hash::hash(s, strlen((char*)s)) == hash(i);
+						dict->free_value(s);
+						if(!same) { fail(name, "reverse translation"); }
+					}
+				}
+				t = now_ns();
+			}
+			double setup = (t - t0) / queries / 1000.0;
+
+			t0 = now_ns();
+			for(size_type i = 0; i < n_; i++) {
+				if(translator->translate(keys[i]) != hash(i)) { fail(name, "translation"); }
+			}
+			double scan = (now_ns() - t0) / n_;
+
+			debug_->debug("%s %lu %.2f %.1f", name, (unsigned long)n_, setup, scan);
+			delete translator;
+			delete reverse;
+			delete dict;
+		}
+
+		/**
+		 * Random inserts and erases, the index must always agree with
+		 * the strings.
+		 */
+		void check_index() {
+			generate(2000);
+			IndexedPrescilla dict;
+			dict.init(debug_);
+			std::vector<int> refs(n_, 0);
+			std::vector<IndexedPrescilla::key_type> keys(n_, IndexedPrescilla::NULL_KEY);
+			srand(11);
+			for(int k = 0; k < 100000; k++) {
+				size_type i = rand() % n_;
+				if(rand() % 2) {
+					keys[i] = dict.insert(str(i));
+					refs[i]++;
+				}
+				else if(refs[i]) {
+					dict.erase(keys[i]);
+					refs[i]--;
+				}
+				if(refs[i]) {
+					if(dict.hash(keys[i]) != hash(i) || (int)dict.count(keys[i]) != refs[i]) { fail("prescilla+index", "hash"); }
+					if(dict.find_hash(hash(i)) != keys[i]) { fail("prescilla+index", "find_hash"); }
+				}
+				else if(dict.find_hash(hash(i)) != IndexedPrescilla::NULL_KEY) {
+					fail("prescilla+index", "find_hash after erase");
+				}
+			}
+			size_type distinct = 0;
+			for(size_type i = 0; i < n_; i++) { distinct += (refs[i] != 0); }
+			if(dict.size() != distinct) { fail("prescilla+index", "size"); }
+		}
+
+		void fail(const char *name, const char *what) {
+			debug_->debug("%s: %s check failed", name, what);
+			exit(1);
+		}
+
+		size_type n_;
+		std::vector<char> pool_;
+		std::vector<size_type> offsets_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,466 @@
+/*
+ * INQP standing queries: complete against incremental re-evaluation.
+ *
+ * The tuple store holds n sensors, each with an observed property
+ * (Temperature for every other one, Humidity for the rest) and a
+ * numeric value. Three standing queries are executed periodically:
+ *  - selection: (?s hasValue ?v) FILTER(?v > 50), sends (?s, ?v)
+ *  - join: (?s observedProperty Temperature) (?s hasValue ?v), sends
+ *    (?s, ?v)
+ *  - aggregate: COUNT, SUM and MAX of ?v over (?s hasValue ?v)
+ * Before every period the values of c random sensors change (one tuple
+ * erased, one inserted each) through INQPQueryProcessor::erase_tuple()
+ * and insert_tuple(), then all queries are executed and the aggregate
+ * timer fires once.
+ *  - full: every execution evaluates the queries completely and sends
+ *    the complete results
+ *  - incremental: the changes are pushed through the operators as they
+ *    happen, executions of up-to-date queries do nothing and only
+ *    changed rows (and retractions) are sent
+ * Before timing both modes are run on the same changes and the result
+ * the sink holds (full: the rows of the period, incremental: all rows
+ * sent minus the retracted ones) has to be the same after every period.
+ *
+ * Output: n changes mode us_per_period rows_per_period
+ *
+ * Usage: incremental_benchmark
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#define INQP_INCREMENTAL 1
+	#define INQP_AGGREGATE_CHECK_INTERVAL 1000
+	#define WISELIB_TIME_FACTOR 1
+	#define WISELIB_MAX_NEIGHBORS 4
+	
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	
+	// the query processor's debug output would dominate the timings
+	#undef DBG
+	#define DBG(...)
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+	
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/delegates/delegate.hpp>
+#include <util/serialization/serialization.h>
+#include <algorithms/hash/sdbm.h>
+#include <util/pstl/vector_static.h>
+#include <util/tuple_store/tuplestore.h>
+#include <util/tuple_store/hash_dictionary.h>
+#include <algorithms/rdf/inqp/query_processor.h>
+
+typedef Sdbm<Os> Hash;
+
+/**
+ * The triple of inqp_test/tuple.h, but with dictionary keys as wide as
+ * pointers (as in gps_benchmark).
+ */
+class TupleT {
+	public:
+		enum { SIZE = 3 };
+		
+		TupleT() { for(size_type i = 0; i < SIZE; i++) { data_[i] = 0; } }
+		
+		block_data_t* get(size_type i) { return reinterpret_cast<block_data_t*>(data_[i]); }
+		void set(size_type i, block_data_t* data) { data_[i] = reinterpret_cast<unsigned long>(data); }
+		size_type length(size_type i) { return get(i) ? strlen((char*)get(i)) : 0; }
+		
+		void set_deep(size_type i, block_data_t* data) {
+			size_type l = strlen((char*)data) + 1;
+			set(i, ::get_allocator().allocate_array<block_data_t>(l).raw());
+			memcpy(get(i), data, l);
+		}
+		void free_deep(size_type i) {
+			if(get(i)) { ::get_allocator().free_array(get(i)); }
+			set(i, 0);
+		}
+		// All columns hold dictionary keys here, TupleStore::erase() sets
+		// them to NULL_KEY which is not 0 for HashDictionary.
+		void destruct_deep() { }
+		
+		void set_key(size_type i, unsigned long k) { data_[i] = k; }
+		unsigned long get_key(size_type i) const { return data_[i]; }
+		
+		static int compare(int col, ::uint8_t *a, int alen, ::uint8_t *b, int blen) {
+			if(alen != blen) { return blen - alen; }
+			return memcmp(a, b, alen);
+		}
+		
+		bool operator==(const TupleT& other) const {
+			return data_[0] == other.data_[0] && data_[1] == other.data_[1] && data_[2] == other.data_[2];
+		}
+	
+	private:
+		unsigned long data_[SIZE];
+};
+
+/**
+ * Timer whose callbacks only run when fire() is called, so a period
+ * takes no wall clock time.
+ */
+class ManualTimer {
+	public:
+		typedef ManualTimer self_type;
+		typedef self_type* self_pointer_t;
+		typedef Os::Timer::millis_t millis_t;
+		typedef delegate1<void, void*> timer_delegate_t;
+		
+		template<typename T, void (T::*TMethod)(void*)>
+		int set_timer(millis_t millis, T* obj, void* userdata) {
+			pending_.push_back(std::make_pair(timer_delegate_t::from_method<T, TMethod>(obj), userdata));
+			return Os::SUCCESS;
+		}
+		
+		/**
+		 * Run the callbacks set so far (not the ones they set).
+		 */
+		void fire() {
+			std::vector<std::pair<timer_delegate_t, void*> > due;
+			due.swap(pending_);
+			for(size_type i = 0; i < due.size(); i++) {
+				due[i].first(due[i].second);
+			}
+		}
+		
+		void clear() { pending_.clear(); }
+	
+	private:
+		std::vector<std::pair<timer_delegate_t, void*> > pending_;
+};
+
+enum { MAX_TRIPLES = 4096 };
+typedef vector_static<Os, TupleT, MAX_TRIPLES> TupleContainer;
+typedef HashDictionary<Os, Hash> Dictionary;
+typedef TupleStore<Os, TupleContainer, Dictionary, Os::Debug, BIN(111), &TupleT::compare> TupleStoreT;
+typedef INQPQueryProcessor<Os, TupleStoreT, Hash, 4, WISELIB_MAX_NEIGHBORS, Dictionary,
+		DictionaryTranslator<Os, Dictionary, Hash, 8>, HashTranslator<Os, Dictionary, Hash, 4>,
+		::uint32_t, ManualTimer> Processor;
+typedef Processor::RowT RowT;
+typedef RowT::Value Value;
+typedef Processor::AggregateDescriptionT AD;
+typedef Processor::SelectionDescriptionT SD;
+
+/**
+ * What the sink knows after a period: the result rows of the
+ * selection and join queries and the last aggregate row.
+ */
+struct View {
+	std::map<int, std::set<std::vector<Value> > > rows;
+	std::vector<Value> aggregate;
+	
+	bool operator==(const View& other) const {
+		return rows == other.rows && aggregate == other.aggregate;
+	}
+};
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+			
+			check(100, 4, 30);
+			check(100, 16, 30);
+			
+			debug_->debug("# n changes mode us_per_period rows_per_period");
+			static const size_type ns[] = { 100, 1000 };
+			static const size_type cs[] = { 0, 1, 16 };
+			for(size_type i = 0; i < sizeof(ns) / sizeof(ns[0]); i++) {
+				for(size_type j = 0; j < sizeof(cs) / sizeof(cs[0]); j++) {
+					run(false, ns[i], cs[j], PERIODS, 0);
+					run(true, ns[i], cs[j], PERIODS, 0);
+				}
+			}
+		}
+		
+		void on_row(int type, size_type columns, RowT& row, Processor::query_id_t qid, Processor::operator_id_t oid) {
+			rows_sent_++;
+			std::vector<Value> r(&row[0], &row[0] + columns);
+			switch(type) {
+				case Processor::COMMUNICATION_TYPE_SINK:
+					view_.rows[qid].insert(r);
+					break;
+				case Processor::COMMUNICATION_TYPE_SINK_RETRACT:
+					if(!view_.rows[qid].erase(r)) { fail("retracted row never sent"); }
+					break;
+				case Processor::COMMUNICATION_TYPE_AGGREGATE:
+					view_.aggregate = r;
+					break;
+			}
+		}
+	
+	private:
+		enum { PERIODS = 100 };
+		enum { STRING = ProjectionInfoBase::STRING, INTEGER = ProjectionInfoBase::INTEGER };
+		enum { LEFT = 0, RIGHT = 0x80, ROOT = 0 };
+		enum { QUERY_SELECTION = 1, QUERY_JOIN = 2, QUERY_AGGREGATE = 3 };
+		
+		double now() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+		}
+		
+		static Hash::hash_t hash(const char *s) {
+			return Hash::hash((block_data_t*)s, strlen(s));
+		}
+		
+		static const char* has_value() { return "<http://www.ontologydesignpatterns.org/ont/dul/hasValue>"; }
+		static const char* observed_property() { return "<http://purl.oclc.org/NET/ssnx/ssn#observedProperty>"; }
+		static const char* temperature() { return "<http://me.exmpl/Temperature>"; }
+		
+		void sensor(char *buf, size_type size, size_type i) {
+			snprintf(buf, size, "<http://foo.bar/sensor%lu>", (unsigned long)i);
+		}
+		
+		void insert(const char *s, const char *p, const char *o) {
+			TupleT t;
+			t.set(0, (block_data_t*)const_cast<char*>(s));
+			t.set(1, (block_data_t*)const_cast<char*>(p));
+			t.set(2, (block_data_t*)const_cast<char*>(o));
+			processor_->insert_tuple(t);
+		}
+		
+		void fill(size_type n) {
+			char s[64], v[16];
+			values_.resize(n);
+			for(size_type i = 0; i < n; i++) {
+				sensor(s, sizeof(s), i);
+				values_[i] = rand() % 100;
+				snprintf(v, sizeof(v), "%d", values_[i]);
+				insert(s, observed_property(), (i % 2) ? temperature() : "<http://me.exmpl/Humidity>");
+				insert(s, has_value(), v);
+			}
+		}
+		
+		/**
+		 * Give sensor @a i the value @a value.
+		 */
+		void change(size_type i, int value) {
+			char s[64], v[16];
+			sensor(s, sizeof(s), i);
+			
+			TupleT query;
+			query.set(0, (block_data_t*)s);
+			query.set(1, (block_data_t*)const_cast<char*>(has_value()));
+			TupleStoreT::iterator it = ts_->begin(&query, BIN(011));
+			if(it == ts_->end()) { fail("value tuple"); }
+			processor_->erase_tuple(it);
+			
+			values_[i] = value;
+			snprintf(v, sizeof(v), "%d", value);
+			insert(s, has_value(), v);
+		}
+		
+		/**
+		 * Write the operator description @a op (id, type, parent,
+		 * projection) followed by the constants of a graph pattern
+		 * selection with pattern (s, p, o), 0 for variables.
+		 */
+		size_type gps(block_data_t *op, block_data_t id, block_data_t parent, int projection,
+				const char *s, const char *p, const char *o) {
+			const char *c[] = { s, p, o };
+			size_type l = header(op, id, 'g', parent, projection);
+			block_data_t &affected = op[l++];
+			affected = 0;
+			for(size_type i = 0; i < 3; i++) {
+				if(!c[i]) { continue; }
+				affected |= 1 << i;
+				Value h = hash(c[i]);
+				l += wiselib::write<Os, block_data_t, Value>(op + l, h);
+			}
+			return l;
+		}
+		
+		size_type header(block_data_t *op, block_data_t id, char type, block_data_t parent, int projection) {
+			op[0] = id;
+			op[1] = type;
+			op[2] = parent;
+			memset(op + 3, 0, sizeof(ProjectionInfo<Os>));
+			op[3] = projection;
+			return 3 + sizeof(ProjectionInfo<Os>);
+		}
+		
+		void add(Processor::query_id_t qid, block_data_t *op, size_type l) {
+			processor_->handle_operator(qid, l, op);
+		}
+		
+		void start(Processor::query_id_t qid, size_type operators, bool incremental) {
+			processor_->get_query(qid)->set_incremental(incremental);
+			processor_->handle_query_info(qid, operators);
+		}
+		
+		void create_queries(bool incremental) {
+			block_data_t op[64];
+			size_type l;
+			
+			// selection: (?s hasValue ?v) FILTER(?v > 50)
+			l = gps(op, 1, LEFT | 2, STRING | INTEGER << 4, 0, has_value(), 0);
+			add(QUERY_SELECTION, op, l);
+			l = header(op, 2, 's', LEFT | 3, STRING | INTEGER << 2);
+			op[l++] = 2;
+			op[l++] = 1;
+			op[l++] = SD::IGNORE;
+			op[l++] = SD::GT | 0;
+			Value threshold = 50;
+			l += wiselib::write<Os, block_data_t, Value>(op + l, threshold);
+			add(QUERY_SELECTION, op, l);
+			l = header(op, 3, 'c', ROOT, STRING | INTEGER << 2);
+			add(QUERY_SELECTION, op, l);
+			start(QUERY_SELECTION, 3, incremental);
+			
+			// join: (?s observedProperty Temperature) (?s hasValue ?v)
+			l = gps(op, 1, LEFT | 3, STRING, 0, observed_property(), temperature());
+			add(QUERY_JOIN, op, l);
+			l = gps(op, 2, RIGHT | 3, STRING | INTEGER << 4, 0, has_value(), 0);
+			add(QUERY_JOIN, op, l);
+			l = header(op, 3, 'j', LEFT | 4, STRING | INTEGER << 4);
+			op[l++] = 0; // LEFT_COL(0) | RIGHT_COL(0)
+			add(QUERY_JOIN, op, l);
+			l = header(op, 4, 'c', ROOT, STRING | INTEGER << 2);
+			add(QUERY_JOIN, op, l);
+			start(QUERY_JOIN, 4, incremental);
+			
+			// aggregate: COUNT(?v) SUM(?v) MAX(?v) { ?s hasValue ?v }
+			l = gps(op, 1, LEFT | 2, INTEGER << 4, 0, has_value(), 0);
+			add(QUERY_AGGREGATE, op, l);
+			l = header(op, 2, 'a', ROOT, INTEGER | INTEGER << 2 | INTEGER << 4);
+			op[l++] = 3;
+			op[l++] = AD::COUNT | AD::AGAIN;
+			op[l++] = AD::SUM | AD::AGAIN;
+			op[l++] = AD::MAX;
+			add(QUERY_AGGREGATE, op, l);
+			start(QUERY_AGGREGATE, 2, incremental);
+		}
+		
+		/**
+		 * One period: @a c changes, execute all queries, let the
+		 * aggregate send.
+		 */
+		void period(bool incremental, size_type c) {
+			if(!incremental) {
+				// the sink gets the complete result again
+				view_ = View();
+			}
+			for(size_type k = 0; k < c; k++) {
+				change(rand() % values_.size(), rand() % 100);
+			}
+			processor_->execute_all();
+			timer_.fire();
+		}
+		
+		/**
+		 * Run @a periods periods with @a c changes each on @a n sensors,
+		 * print the time and rows sent per period or, if @a views is
+		 * given, record the view after every period.
+		 */
+		void run(bool incremental, size_type n, size_type c, size_type periods, std::vector<View> *views) {
+			srand(n * 100 + c);
+			
+			Dictionary dictionary;
+			TupleContainer *container = new TupleContainer;
+			TupleStoreT ts;
+			dictionary.init(debug_);
+			ts.init(&dictionary, container, debug_);
+			Processor processor;
+			processor.init(&ts, &timer_);
+			processor.reg_row_callback<App, &App::on_row>(this);
+			ts_ = &ts;
+			processor_ = &processor;
+			view_ = View();
+			
+			fill(n);
+			create_queries(incremental);
+			timer_.fire();
+			if(views) { views->push_back(view_); }
+			
+			rows_sent_ = 0;
+			double t = now();
+			for(size_type p = 0; p < periods; p++) {
+				period(incremental, c);
+				if(views) { views->push_back(view_); }
+			}
+			t = now() - t;
+			
+			if(!views) {
+				debug_->debug("%lu %lu %s %.2f %.2f", (unsigned long)n, (unsigned long)c,
+						incremental ? "incremental" : "full", t / periods, (double)rows_sent_ / periods);
+			}
+			
+			processor.erase_query(QUERY_SELECTION);
+			processor.erase_query(QUERY_JOIN);
+			processor.erase_query(QUERY_AGGREGATE);
+			timer_.fire(); // let the aggregate free its timer info
+			timer_.clear();
+			while(ts.begin() != ts.end()) {
+				ts.erase(ts.begin());
+			}
+			delete container;
+		}
+		
+		/**
+		 * Both modes leave the sink with the same result after every
+		 * period.
+		 */
+		void check(size_type n, size_type c, size_type periods) {
+			std::vector<View> full, incremental;
+			run(false, n, c, periods, &full);
+			run(true, n, c, periods, &incremental);
+			
+			if(full.size() != incremental.size()) { fail("periods"); }
+			for(size_type p = 0; p < full.size(); p++) {
+				if(full[p].rows[QUERY_SELECTION].empty() || full[p].rows[QUERY_JOIN].empty()) { fail("empty result"); }
+				if(full[p].aggregate.empty()) { fail("no aggregate"); }
+				if(!(full[p] == incremental[p])) {
+					debug_->debug("period %lu", (unsigned long)p);
+					fail("views");
+				}
+			}
+		}
+		
+		void fail(const char *what) {
+			debug_->debug("%s check failed", what);
+			exit(1);
+		}
+		
+		ManualTimer timer_;
+		TupleStoreT *ts_;
+		Processor *processor_;
+		std::vector<int> values_;
+		View view_;
+		unsigned long rows_sent_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
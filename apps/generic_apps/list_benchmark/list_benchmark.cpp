@@ -0,0 +1,386 @@
+/*
+ * list_static against list_chunked at protocol queue sizes.
+ *
+ * Workloads, each for lists of n elements (a 16 byte "message" with a
+ * timer offset, as in the PC timer queue):
+ *  - traverse: sum up the offsets of a list that has seen some churn
+ *  - timer: insert at the position found by a linear scan of the
+ *    accumulated offsets, pop_front (TimerQueue of pc_timer.h)
+ *  - fifo: push_back / pop_front (message queues)
+ *  - erase_if: remove every second element, refill
+ *    (list_static: erase(it++) loop)
+ *  - splice: move all elements to a second list and back
+ *    (list_chunked on a shared pool: chunks are relinked)
+ *
+ * Output: workload impl n ns_per_op
+ *
+ * Usage: list_benchmark
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::size_t size_type;
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <list>
+#include <vector>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/pstl/list_static.h>
+#include <util/pstl/list_chunked.h>
+
+struct Message {
+	long offset_;
+	void *userdata_;
+
+	bool operator==(const Message& other) const { return offset_ == other.offset_; }
+};
+
+enum { MAX_SIZE = 64 };
+
+typedef list_static<Os, Message, MAX_SIZE> StaticList;
+typedef list_chunked<Os, Message, MAX_SIZE> ChunkedList;
+typedef list_chunked<Os, Message, MAX_SIZE, 16> ChunkedList16;
+typedef list_chunked_pool<Os, Message, 2 * MAX_SIZE> SharedPool;
+typedef list_chunked<Os, Message, 0> SharedList;
+
+struct IsOdd {
+	bool operator()(const Message& m) { return m.offset_ & 1; }
+};
+
+template<typename List>
+void erase_odd(List& l) {
+	l.erase_if(IsOdd());
+}
+
+template<>
+void erase_odd(StaticList& l) {
+	for(StaticList::iterator it = l.begin(); it != l.end(); ) {
+		if(it->offset_ & 1) { l.erase(it++); }
+		else { ++it; }
+	}
+}
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			check();
+
+			debug_->debug("# workload impl n ns_per_op");
+			static const int ns[] = { 8, 16, 32, 64 };
+			for(size_type i = 0; i < sizeof(ns) / sizeof(ns[0]); i++) {
+				int n = ns[i];
+				run<StaticList>("list_static", n);
+				run<ChunkedList>("list_chunked-8", n);
+				run<ChunkedList16>("list_chunked-16", n);
+				run_splice_static(n);
+				run_splice_shared(n);
+			}
+		}
+
+	private:
+		enum { OPS = 1 << 20 };
+
+		double now_ns() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1e9 + ts.tv_nsec;
+		}
+
+		void report(const char *workload, const char *impl, int n, double t, long ops) {
+			debug_->debug("%s %s %d %.2f", workload, impl, n, t / ops);
+		}
+
+		Message message(long offset) {
+			Message m;
+			m.offset_ = offset;
+			m.userdata_ = 0;
+			return m;
+		}
+
+		/**
+		 * n elements, after some random inserts and erases.
+		 */
+		template<typename List>
+		void churn(List& l, int n) {
+			l.clear();
+			for(int i = 0; i < n; i++) { l.push_back(message(rand() % 1000)); }
+			for(int k = 0; k < 4 * n; k++) {
+				typename List::iterator it = l.begin();
+				for(int j = rand() % n; j > 0; j--) { ++it; }
+				l.erase(it);
+				it = l.begin();
+				for(int j = rand() % n; j > 0; j--) { ++it; }
+				l.insert(it, message(rand() % 1000));
+			}
+		}
+
+		/**
+		 * Sorted insert by accumulated offsets like TimerQueue::insert().
+		 */
+		template<typename List>
+		void timer_insert(List& l, long interval) {
+			long t = 0, t_prev = 0;
+			typename List::iterator it = l.begin();
+			for( ; it != l.end(); ++it) {
+				t += it->offset_;
+				if(interval < t) { break; }
+				t_prev = t;
+			}
+			if(it != l.end()) { it->offset_ -= interval - t_prev; }
+			l.insert(it, message(interval - t_prev));
+		}
+
+		template<typename List>
+		void run(const char *impl, int n) {
+			List *l = new List;
+			srand(n);
+			double t;
+
+			churn(*l, n);
+			long reps = OPS / n;
+			t = now_ns();
+			for(long r = 0; r < reps; r++) {
+				for(typename List::iterator it = l->begin(); it != l->end(); ++it) {
+					sink_ += it->offset_;
+				}
+			}
+			report("traverse", impl, n, now_ns() - t, reps * n);
+
+			l->clear();
+			for(int i = 0; i < n; i++) { timer_insert(*l, rand() % 10000); }
+			t = now_ns();
+			for(long r = 0; r < OPS / 4; r++) {
+				sink_ += l->front().offset_;
+				l->pop_front();
+				timer_insert(*l, (r * 7919) % 10000);
+			}
+			report("timer", impl, n, now_ns() - t, OPS / 4);
+
+			l->clear();
+			for(int i = 0; i < n; i++) { l->push_back(message(i)); }
+			t = now_ns();
+			for(long r = 0; r < OPS; r++) {
+				sink_ += l->front().offset_;
+				l->pop_front();
+				l->push_back(message(r));
+			}
+			report("fifo", impl, n, now_ns() - t, OPS);
+
+			reps = OPS / n;
+			t = now_ns();
+			for(long r = 0; r < reps; r++) {
+				l->clear();
+				for(int i = 0; i < n; i++) { l->push_back(message(i)); }
+				erase_odd(*l);
+				sink_ += l->size();
+			}
+			report("erase_if", impl, n, now_ns() - t, reps * n);
+
+			delete l;
+		}
+
+		void run_splice_static(int n) {
+			StaticList *a = new StaticList, *b = new StaticList;
+			for(int i = 0; i < n; i++) { a->push_back(message(i)); }
+			long reps = OPS / n;
+			double t = now_ns();
+			for(long r = 0; r < reps; r++) {
+				b->splice(b->end(), *a);
+				a->splice(a->end(), *b);
+			}
+			report("splice", "list_static", n, now_ns() - t, 2 * reps);
+			delete a;
+			delete b;
+		}
+
+		void run_splice_shared(int n) {
+			SharedPool *pool = new SharedPool;
+			SharedList *a = new SharedList(*pool), *b = new SharedList(*pool);
+			for(int i = 0; i < n; i++) { a->push_back(message(i)); }
+			long reps = OPS / n;
+			double t = now_ns();
+			for(long r = 0; r < reps; r++) {
+				b->splice(b->end(), *a);
+				a->splice(a->end(), *b);
+			}
+			report("splice", "list_chunked-shared", n, now_ns() - t, 2 * reps);
+			delete a;
+			delete b;
+			delete pool;
+		}
+
+		template<typename List>
+		void expect(List& l, const std::list<long>& ref, const char *what) {
+			if((size_type)l.size() != ref.size()) { fail(what); }
+			std::list<long>::const_iterator r = ref.begin();
+			for(typename List::iterator it = l.begin(); it != l.end(); ++it, ++r) {
+				if(it->offset_ != *r) { fail(what); }
+			}
+			// backwards
+			std::list<long>::const_reverse_iterator rr = ref.rbegin();
+			for(typename List::riterator it = l.rbegin(); it != l.rend(); ++it, ++rr) {
+				if((*it).offset_ != *rr) { fail(what); }
+			}
+		}
+
+		/**
+		 * Random operations on list_chunked against std::list, with
+		 * handles, at the capacity limit.
+		 */
+		void check() {
+			ChunkedList l;
+			std::list<long> ref;
+			std::vector<ChunkedList::handle_t> handles;
+			std::vector<long> handle_values;
+			srand(1);
+
+			for(int k = 0; k < 200000; k++) {
+				int op = rand() % 8;
+				int at = ref.empty() ? 0 : rand() % (ref.size() + 1);
+				std::list<long>::iterator r = ref.begin();
+				for(int j = 0; j < at; j++) { ++r; }
+				ChunkedList::iterator it = l.at_index(at);
+
+				if(op < 4) {
+					long v = rand() % 100;
+					ChunkedList::handle_t h = l.insert_handle(it, message(v));
+					if(h == ChunkedList::NO_HANDLE) {
+						if((int)ref.size() < l.max_size()) { fail("insert with space left"); }
+					}
+					else {
+						ref.insert(r, v);
+						if(rand() % 4 == 0) {
+							handles.push_back(h);
+							handle_values.push_back(v);
+						}
+					}
+				}
+				else if(op < 7 && r != ref.end()) {
+					for(size_type j = 0; j < handles.size(); j++) {
+						if(handles[j] == l.handle(it)) {
+							handles.erase(handles.begin() + j);
+							handle_values.erase(handle_values.begin() + j);
+							break;
+						}
+					}
+					ChunkedList::iterator next = l.erase(it);
+					r = ref.erase(r);
+					if((r == ref.end()) != (next == l.end()) || (r != ref.end() && next->offset_ != *r)) {
+						fail("erase result");
+					}
+				}
+				else if(k % 97 == 0) {
+					long v = rand() % 100;
+					l.remove(message(v));
+					ref.remove(v);
+					l.unique();
+					ref.unique();
+					handles.clear();
+					handle_values.clear();
+				}
+				for(size_type j = 0; j < handles.size(); j++) {
+					if(!l.valid(handles[j]) || l.get(handles[j]).offset_ != handle_values[j]
+							|| l.find_handle(handles[j])->offset_ != handle_values[j]) {
+						fail("handle");
+					}
+				}
+				if(k % 1000 == 0) { expect(l, ref, "random operations"); }
+			}
+			expect(l, ref, "random operations");
+
+			l.reverse();
+			ref.reverse();
+			expect(l, ref, "reverse");
+
+			IsOdd odd;
+			l.erase_if(odd);
+			for(std::list<long>::iterator r = ref.begin(); r != ref.end(); ) {
+				if(*r & 1) { r = ref.erase(r); }
+				else { ++r; }
+			}
+			expect(l, ref, "erase_if");
+
+			std::vector<Message> range;
+			for(int i = 0; i < 20; i++) { range.push_back(message(1000 + i)); }
+			ChunkedList m;
+			m.push_back(message(1));
+			m.push_back(message(2));
+			m.insert_range(++m.begin(), range.begin(), range.end());
+			std::list<long> mref;
+			mref.push_back(1);
+			for(int i = 0; i < 20; i++) { mref.push_back(1000 + i); }
+			mref.push_back(2);
+			expect(m, mref, "insert_range");
+
+			ChunkedList copy(m);
+			copy.insert(copy.end(), 3, message(7));
+			mref.push_back(7);
+			mref.push_back(7);
+			mref.push_back(7);
+			expect(copy, mref, "copy");
+
+			// splice on a shared pool keeps handles
+			SharedPool pool;
+			SharedList a(pool), b(pool);
+			std::list<long> aref, bref;
+			for(int i = 0; i < 20; i++) { a.push_back(message(i)); aref.push_back(i); }
+			SharedList::handle_t h = a.insert_handle(a.end(), message(99));
+			aref.push_back(99);
+			for(int i = 0; i < 30; i++) { b.push_back(message(100 + i)); bref.push_back(100 + i); }
+			SharedList::iterator pos = b.at_index(13);
+			b.splice(pos, a);
+			std::list<long>::iterator rpos = bref.begin();
+			for(int i = 0; i < 13; i++) { ++rpos; }
+			bref.splice(rpos, aref);
+			expect(a, aref, "splice source");
+			expect(b, bref, "splice");
+			if(!b.valid(h) || b.get(h).offset_ != 99) { fail("handle after splice"); }
+			b.clear();
+			if(pool.used() != 0) { fail("shared pool release"); }
+
+			// list_static fixes
+			StaticList s, t;
+			for(int i = 0; i < 5; i++) { s.push_back(message(i)); t.push_back(message(10 + i)); }
+			s.splice(++s.begin(), t);
+			std::list<long> sref;
+			sref.push_back(0);
+			for(int i = 0; i < 5; i++) { sref.push_back(10 + i); }
+			for(int i = 1; i < 5; i++) { sref.push_back(i); }
+			if(!t.empty()) { fail("list_static splice"); }
+			expect(s, sref, "list_static splice");
+		}
+
+		void fail(const char *what) {
+			debug_->debug("%s check failed", what);
+			exit(1);
+		}
+
+		long sink_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,194 @@
+/*
+ * Scalability benchmark for the centralized batch localization solver.
+ *
+ * Generates synthetic topologies (random uniform and perturbed grid
+ * deployments with noisy range measurements), runs DV-hop + LM refinement
+ * with 1..N threads and reports run times and position errors.
+ *
+ * Usage: localization_batch_benchmark [nodes [max_threads]]
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <algorithms/localization/distance_based/batch/localization_batch_solver.h>
+
+#include <sys/time.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+typedef LocalizationBatchSolver<Os, double, 2> Solver;
+typedef Solver::Position Position;
+
+class App {
+	// {{{
+	public:
+		enum Topology { UNIFORM, GRID };
+
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			size_type sizes[] = { 1000, 10000, 50000 };
+			size_type n_sizes = 3;
+			size_type max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+			if(amp.argc > 1) {
+				sizes[0] = atol(amp.argv[1]);
+				n_sizes = 1;
+			}
+			if(amp.argc > 2) { max_threads = atol(amp.argv[2]); }
+
+			debug_->debug("# topology nodes ranges anchors threads localized dvhop_ms lm_ms lm_iter err_dvhop err_lm");
+			for(size_type s = 0; s < n_sizes; s++) {
+				for(int topo = UNIFORM; topo <= GRID; topo++) {
+					generate((Topology)topo, sizes[s]);
+					for(size_type t = 1; t <= max_threads; t *= 2) {
+						run((Topology)topo, t);
+					}
+				}
+			}
+		}
+
+	private:
+		double now() {
+			timeval tv;
+			gettimeofday(&tv, 0);
+			return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+		}
+
+		double gauss() {
+			double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+			double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+			return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+		}
+
+		/**
+		 * Place nodes in a square with density such that the expected
+		 * degree is about 10 at radio range 1, connect all pairs within
+		 * range (via grid cells) with 5% gaussian range noise,
+		 * make 5% of the nodes anchors.
+		 */
+		void generate(Topology topo, size_type n) {
+			srand(42);
+			double side = sqrt(n * M_PI / 10.0);
+			truth_.resize(n);
+			if(topo == UNIFORM) {
+				for(size_type i = 0; i < n; i++) {
+					truth_[i] = Position(side * rand() / RAND_MAX, side * rand() / RAND_MAX);
+				}
+			}
+			else {
+				size_type cols = (size_type)ceil(sqrt((double)n));
+				double step = side / cols;
+				for(size_type i = 0; i < n; i++) {
+					truth_[i] = Position((i % cols) * step + 0.2 * step * gauss(),
+							(i / cols) * step + 0.2 * step * gauss());
+				}
+			}
+
+			size_type cells = (size_type)ceil(side) + 1;
+			std::vector< std::vector<size_type> > grid(cells * cells);
+			for(size_type i = 0; i < n; i++) {
+				size_type cx = (size_type)truth_[i].x(), cy = (size_type)truth_[i].y();
+				if(cx >= cells) { cx = cells - 1; }
+				if(cy >= cells) { cy = cells - 1; }
+				grid[cy * cells + cx].push_back(i);
+			}
+
+			ranges_a_.clear(); ranges_b_.clear(); ranges_d_.clear();
+			for(size_type cy = 0; cy < cells; cy++) {
+				for(size_type cx = 0; cx < cells; cx++) {
+					std::vector<size_type>& c = grid[cy * cells + cx];
+					for(size_type k = 0; k < c.size(); k++) {
+						for(int dy = 0; dy <= 1; dy++) {
+							for(int dx = -1; dx <= 1; dx++) {
+								if(dy == 0 && dx < 0) { continue; }
+								long nx = (long)cx + dx, ny = (long)cy + dy;
+								if(nx < 0 || nx >= (long)cells || ny >= (long)cells) { continue; }
+								std::vector<size_type>& o = grid[ny * cells + nx];
+								for(size_type l = (dx == 0 && dy == 0) ? k + 1 : 0; l < o.size(); l++) {
+									double d = Position::euclidean_distance(truth_[c[k]], truth_[o[l]]);
+									if(d > 1.0) { continue; }
+									ranges_a_.push_back(c[k]);
+									ranges_b_.push_back(o[l]);
+									ranges_d_.push_back(d * (1.0 + 0.05 * gauss()));
+								}
+							}
+						}
+					}
+				}
+			}
+
+			anchors_.clear();
+			for(size_type i = 0; i < n; i += 20) { anchors_.push_back(i); }
+		}
+
+		double error(Solver& solver) {
+			double sum = 0.0;
+			size_type cnt = 0;
+			for(size_type i = 0; i < solver.size(); i++) {
+				if(solver.is_anchor(i) || !solver.is_localized(i)) { continue; }
+				sum += Position::euclidean_distance(solver.position(i), truth_[i]);
+				cnt++;
+			}
+			// mean error in units of radio range
+			return cnt ? sum / cnt : 0.0;
+		}
+
+		void run(Topology topo, size_type threads) {
+			Solver solver;
+			solver.init(truth_.size(), threads);
+			for(size_type i = 0; i < ranges_a_.size(); i++) {
+				solver.add_range(ranges_a_[i], ranges_b_[i], ranges_d_[i]);
+			}
+			for(size_type i = 0; i < anchors_.size(); i++) {
+				solver.set_anchor(anchors_[i], truth_[anchors_[i]]);
+			}
+
+			double t0 = now();
+			size_type localized = solver.compute_dv_hop();
+			double t1 = now();
+			double err_dvhop = error(solver);
+			double t2 = now();
+			int iterations = solver.solve();
+			double t3 = now();
+			double err_lm = error(solver);
+
+			debug_->debug("%s %lu %lu %lu %lu %lu %.1f %.1f %d %.3f %.3f",
+					topo == UNIFORM ? "uniform" : "grid",
+					(unsigned long)solver.size(), (unsigned long)solver.range_count(),
+					(unsigned long)solver.anchor_count(), (unsigned long)threads,
+					(unsigned long)localized, t1 - t0, t3 - t2, iterations,
+					err_dvhop, err_lm);
+		}
+
+		std::vector<Position> truth_;
+		std::vector<size_type> ranges_a_, ranges_b_;
+		std::vector<double> ranges_d_;
+		std::vector<size_type> anchors_;
+
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,339 @@
+/*
+ * Priority queue throughput.
+ *
+ * 1. push n random values, then pop all of them (checked for order) with
+ *    the static priority_queue, PriorityQueueDynamic, the indexed queues
+ *    and std::priority_queue for reference.
+ * 2. Dijkstra on a random graph (n nodes, 8 n edges): the indexed queues
+ *    with decrease_key() against lazy reinsertion (push a new entry on
+ *    every improvement, skip outdated ones on pop) with
+ *    PriorityQueueDynamic and std::priority_queue. All have to compute
+ *    the same distances.
+ * 3. Timer churn: n pending timers, each step cancels a random one
+ *    (erase()), reschedules another one (update()) and pops the earliest.
+ *
+ * The dynamic queues are based on vector_dynamic, which holds at most
+ * 65535 elements, so n should stay below about 30000. Before the
+ * measurements IndexedPriorityQueueDynamic is filled up to that limit,
+ * one more push() has to fail and the pops have to be in order.
+ *
+ * Usage: priority_queue_benchmark [n ...]   (default: 1000 4000 16000)
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <util/pstl/priority_queue.h>
+#include <util/pstl/priority_queue_dynamic.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <queue>
+#include <functional>
+
+enum { MAX_N = 32768 };
+
+struct Entry {
+	::uint32_t distance;
+	::uint32_t node;
+
+	bool operator<(const Entry& other) const { return distance < other.distance; }
+	bool operator>(const Entry& other) const { return other.distance < distance; }
+};
+
+typedef priority_queue<Os, ::uint32_t, MAX_N> StaticQueue;
+typedef PriorityQueueDynamic<Os, ::uint32_t> DynamicQueue;
+typedef indexed_priority_queue<Os, ::uint32_t, MAX_N> IndexedStaticQueue;
+typedef IndexedPriorityQueueDynamic<Os, ::uint32_t> IndexedDynamicQueue;
+
+typedef PriorityQueueDynamic<Os, Entry> DynamicEntryQueue;
+typedef indexed_priority_queue<Os, Entry, MAX_N> IndexedStaticEntryQueue;
+typedef IndexedPriorityQueueDynamic<Os, Entry> IndexedDynamicEntryQueue;
+
+// too large for the stack
+StaticQueue static_queue_;
+IndexedStaticQueue indexed_static_queue_;
+IndexedStaticEntryQueue indexed_static_entry_queue_;
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			std::vector<size_type> sizes;
+			for(int i = 1; i < amp.argc; i++) { sizes.push_back(atol(amp.argv[i])); }
+			if(sizes.empty()) {
+				sizes.push_back(1000);
+				sizes.push_back(4000);
+				sizes.push_back(16000);
+			}
+
+			check_indexed_dynamic_limit();
+
+			debug_->debug("# times in ms");
+			debug_->debug("# heapsort n static dynamic indexed_static indexed_dynamic std");
+			for(size_type i = 0; i < sizes.size(); i++) { run_heapsort(sizes[i]); }
+			debug_->debug("# dijkstra n edges lazy_dynamic lazy_std indexed_static indexed_dynamic");
+			for(size_type i = 0; i < sizes.size(); i++) { run_dijkstra(sizes[i]); }
+			debug_->debug("# timers n steps indexed_static indexed_dynamic");
+			for(size_type i = 0; i < sizes.size(); i++) { run_timers(sizes[i]); }
+		}
+
+	private:
+		double now() {
+			timeval tv;
+			gettimeofday(&tv, 0);
+			return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+		}
+
+		void fail(const char *what, const char *queue) {
+			debug_->debug("%s: %s failed", queue, what);
+			exit(1);
+		}
+
+		void check_indexed_dynamic_limit() {
+			enum { LIMIT = 0xffff };
+			IndexedDynamicQueue q;
+			for(size_type i = 0; i < LIMIT; i++) {
+				if(q.push(LIMIT - i) == IndexedDynamicQueue::NO_HANDLE) { fail("push below limit", "IndexedPriorityQueueDynamic"); }
+			}
+			if(q.push(0) != IndexedDynamicQueue::NO_HANDLE) { fail("push beyond limit", "IndexedPriorityQueueDynamic"); }
+			if(q.size() != LIMIT) { fail("size at limit", "IndexedPriorityQueueDynamic"); }
+			for(size_type i = 1; i <= LIMIT; i++) {
+				if(q.pop() != i) { fail("pop at limit", "IndexedPriorityQueueDynamic"); }
+			}
+		}
+
+		//
+		// heapsort
+		//
+
+		template<typename Q>
+		double heapsort(Q& q, const char *name) {
+			double t = now();
+			for(size_type i = 0; i < values_.size(); i++) { q.push(values_[i]); }
+			for(size_type i = 0; i < values_.size(); i++) { out_[i] = q.pop(); }
+			t = now() - t;
+			for(size_type i = 0; i < values_.size(); i++) {
+				if(out_[i] != sorted_[i]) { fail("heapsort", name); }
+			}
+			return t;
+		}
+
+		double heapsort_std() {
+			std::priority_queue< ::uint32_t, std::vector< ::uint32_t>, std::greater< ::uint32_t> > q;
+			double t = now();
+			for(size_type i = 0; i < values_.size(); i++) { q.push(values_[i]); }
+			for(size_type i = 0; i < values_.size(); i++) { out_[i] = q.top(); q.pop(); }
+			return now() - t;
+		}
+
+		void run_heapsort(size_type n) {
+			srand(1);
+			values_.resize(n);
+			out_.resize(n);
+			for(size_type i = 0; i < n; i++) { values_[i] = rand() % (4 * n); }
+			sorted_ = values_;
+			std::sort(sorted_.begin(), sorted_.end());
+
+			DynamicQueue dynamic;
+			IndexedDynamicQueue indexed_dynamic;
+			static_queue_.clear();
+			indexed_static_queue_.clear();
+
+			double t_static = heapsort(static_queue_, "priority_queue");
+			double t_dynamic = heapsort(dynamic, "PriorityQueueDynamic");
+			double t_indexed_static = heapsort(indexed_static_queue_, "indexed_priority_queue");
+			double t_indexed_dynamic = heapsort(indexed_dynamic, "IndexedPriorityQueueDynamic");
+			double t_std = heapsort_std();
+
+			debug_->debug("heapsort %lu %.2f %.2f %.2f %.2f %.2f", (unsigned long)n,
+					t_static, t_dynamic, t_indexed_static, t_indexed_dynamic, t_std);
+		}
+
+		//
+		// dijkstra
+		//
+
+		void generate_graph(size_type n) {
+			srand(2);
+			offsets_.assign(n + 1, 0);
+			targets_.clear();
+			weights_.clear();
+			for(size_type v = 0; v < n; v++) {
+				offsets_[v] = targets_.size();
+				for(size_type e = 0; e < 8; e++) {
+					targets_.push_back(rand() % n);
+					weights_.push_back(1 + rand() % 1000);
+				}
+			}
+			offsets_[n] = targets_.size();
+		}
+
+		template<typename Q>
+		double dijkstra_lazy(Q& q, std::vector< ::uint32_t>& dist) {
+			double t = now();
+			size_type n = offsets_.size() - 1;
+			dist.assign(n, (::uint32_t)-1);
+			dist[0] = 0;
+			Entry s = { 0, 0 };
+			q.push(s);
+			while(q.size()) {
+				Entry e = pop(q);
+				if(e.distance > dist[e.node]) { continue; }
+				for(size_type i = offsets_[e.node]; i < offsets_[e.node + 1]; i++) {
+					::uint32_t d = e.distance + weights_[i];
+					if(d < dist[targets_[i]]) {
+						dist[targets_[i]] = d;
+						Entry f = { d, targets_[i] };
+						q.push(f);
+					}
+				}
+			}
+			return now() - t;
+		}
+
+		Entry pop(DynamicEntryQueue& q) { return q.pop(); }
+		Entry pop(std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> >& q) {
+			Entry e = q.top();
+			q.pop();
+			return e;
+		}
+
+		template<typename Q>
+		double dijkstra_indexed(Q& q, std::vector< ::uint32_t>& dist) {
+			double t = now();
+			size_type n = offsets_.size() - 1;
+			std::vector<typename Q::handle_type> handle(n, (typename Q::handle_type)Q::NO_HANDLE);
+			dist.assign(n, (::uint32_t)-1);
+			dist[0] = 0;
+			Entry s = { 0, 0 };
+			handle[0] = q.push(s);
+			while(!q.empty()) {
+				Entry e = q.pop();
+				for(size_type i = offsets_[e.node]; i < offsets_[e.node + 1]; i++) {
+					::uint32_t w = targets_[i];
+					::uint32_t d = e.distance + weights_[i];
+					if(d < dist[w]) {
+						Entry f = { d, w };
+						if(dist[w] == (::uint32_t)-1) { handle[w] = q.push(f); }
+						else { q.decrease_key(handle[w], f); }
+						dist[w] = d;
+					}
+				}
+			}
+			return now() - t;
+		}
+
+		void run_dijkstra(size_type n) {
+			generate_graph(n);
+			std::vector< ::uint32_t> d_dynamic, d_std, d_indexed_static, d_indexed_dynamic;
+
+			DynamicEntryQueue dynamic;
+			std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > std_queue;
+			IndexedDynamicEntryQueue indexed_dynamic;
+			indexed_static_entry_queue_.clear();
+
+			double t_dynamic = dijkstra_lazy(dynamic, d_dynamic);
+			double t_std = dijkstra_lazy(std_queue, d_std);
+			double t_indexed_static = dijkstra_indexed(indexed_static_entry_queue_, d_indexed_static);
+			double t_indexed_dynamic = dijkstra_indexed(indexed_dynamic, d_indexed_dynamic);
+
+			if(d_dynamic != d_std) { fail("dijkstra", "PriorityQueueDynamic"); }
+			if(d_indexed_static != d_std) { fail("dijkstra", "indexed_priority_queue"); }
+			if(d_indexed_dynamic != d_std) { fail("dijkstra", "IndexedPriorityQueueDynamic"); }
+
+			debug_->debug("dijkstra %lu %lu %.2f %.2f %.2f %.2f", (unsigned long)n, (unsigned long)targets_.size(),
+					t_dynamic, t_std, t_indexed_static, t_indexed_dynamic);
+		}
+
+		//
+		// timers
+		//
+
+		template<typename Q>
+		double timers(Q& q, size_type n, size_type steps, const char *name) {
+			srand(3);
+			// timer -> handle, handle -> timer
+			std::vector<typename Q::handle_type> handles(n);
+			// (handles of earlier runs may be reused, so they can exceed n)
+			std::vector<size_type> owner(MAX_N);
+			std::vector< ::uint32_t> deadline(n);
+			for(size_type i = 0; i < n; i++) {
+				deadline[i] = rand() % 100000;
+				handles[i] = q.push(deadline[i]);
+				owner[handles[i]] = i;
+			}
+
+			double t = now();
+			::uint32_t clock = 0;
+			for(size_type s = 0; s < steps; s++) {
+				// cancel and re-arm timer i
+				size_type i = rand() % n;
+				q.erase(handles[i]);
+				deadline[i] = clock + rand() % 100000;
+				handles[i] = q.push(deadline[i]);
+				owner[handles[i]] = i;
+
+				// reschedule timer j
+				size_type j = rand() % n;
+				deadline[j] = clock + rand() % 100000;
+				q.update(handles[j], deadline[j]);
+
+				// fire the earliest one and re-arm it
+				i = owner[q.top_handle()];
+				clock = q.pop();
+				if(clock != deadline[i]) { fail("timers", name); }
+				deadline[i] = clock + rand() % 100000;
+				handles[i] = q.push(deadline[i]);
+				owner[handles[i]] = i;
+			}
+			return now() - t;
+		}
+
+		void run_timers(size_type n) {
+			size_type steps = 1000000;
+			IndexedDynamicQueue indexed_dynamic;
+			indexed_static_queue_.clear();
+			double t_static = timers(indexed_static_queue_, n, steps, "indexed_priority_queue");
+			double t_dynamic = timers(indexed_dynamic, n, steps, "IndexedPriorityQueueDynamic");
+			debug_->debug("timers %lu %lu %.2f %.2f", (unsigned long)n, (unsigned long)steps, t_static, t_dynamic);
+		}
+
+		std::vector< ::uint32_t> values_, sorted_, out_;
+		std::vector<size_type> offsets_;
+		std::vector< ::uint32_t> targets_, weights_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
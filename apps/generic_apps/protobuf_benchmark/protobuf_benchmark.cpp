@@ -0,0 +1,410 @@
+/*
+ * Protobuf encoding / decoding throughput.
+ *
+ * 1. Varint codec: encodes and decodes a million 64 bit values (10 times) of mixed
+ *    magnitude with the previous recursive byte-at-a-time implementation
+ *    (copied below) and with protobuf::VarInt on a plain buffer.
+ * 2. RDF payloads: splits the shdt_test corpora (N-Triples) into packets
+ *    with the previous ProtobufRdfSerializer scheme (every statement is
+ *    written into a temporary buffer, then copied into a temporary
+ *    description, then into the packet) and with the current two-phase
+ *    SizedWriter based one. Verifies that both produce identical bytes
+ *    and that read_next() decodes them back to the input.
+ *
+ * Usage: protobuf_benchmark [file.rdf ...]
+ *   (default: ../shdt_test/{incontextsensing,btcsample0,ssp}.rdf)
+ */
+
+#include "../shdt_test/platform.h"
+
+using namespace wiselib;
+#include <util/broker/protobuf_rdf_serializer.h>
+#include <util/protobuf/varint.h>
+#include <util/split_n3.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <vector>
+
+typedef Os::size_t size_type;
+typedef Os::block_data_t block_data_t;
+
+typedef ProtobufRdfSerializer<Os, 255> Serializer;
+typedef protobuf::VarInt<Os, block_data_t*, ::uint64_t> VarInt64;
+
+struct Tuple {
+	Tuple() { data_[0] = data_[1] = data_[2] = 0; }
+	~Tuple() { for(size_t i = 0; i < 3; i++) { free(data_[i]); } }
+	void set(size_t idx, block_data_t* data) { data_[idx] = data; }
+	void set_deep(size_t idx, block_data_t* data) {
+		free(data_[idx]);
+		data_[idx] = (block_data_t*)strdup((char*)data);
+	}
+	block_data_t *get(size_t idx) { return data_[idx]; }
+	block_data_t *data_[3];
+};
+
+/**
+ * Previous implementation: recursive varints, one checked byte at a time,
+ * nested messages through temporary buffers.
+ */
+struct Legacy {
+	static bool write_varint(block_data_t*& p, block_data_t* end, ::uint64_t v) {
+		bool continuation = (v >> 7) != 0;
+		if(p == end) { return false; }
+		*p++ = (block_data_t)((v & 0x7f) | (continuation << 7));
+		if(continuation) { return write_varint(p, end, v >> 7); }
+		return true;
+	}
+
+	static bool read_varint(block_data_t*& p, block_data_t* end, ::uint64_t& out) {
+		if(p == end) { return false; }
+		::uint64_t v = *p++;
+		bool continuation = (v >> 7) != 0;
+		v &= 0x7f;
+		if(continuation) {
+			::uint64_t v2;
+			if(!read_varint(p, end, v2)) { return false; }
+			out = v | (v2 << 7);
+		}
+		else {
+			out = v;
+		}
+		return true;
+	}
+
+	static bool write_bytes(block_data_t*& p, block_data_t* end, unsigned field, const block_data_t* s, size_type l) {
+		if(!write_varint(p, end, field << 3 | 2)) { return false; }
+		if(!write_varint(p, end, l)) { return false; }
+		for(size_type i = 0; i < l; i++) {
+			if(p == end) { return false; }
+			*p++ = s[i];
+		}
+		return true;
+	}
+
+	static bool write_string(block_data_t*& p, block_data_t* end, unsigned field, const char* s) {
+		return write_bytes(p, end, field, (const block_data_t*)s, strlen(s));
+	}
+
+	template<typename iterator>
+	static size_type fill_buffer(block_data_t* buffer, size_type max_packet_size, iterator& current, const iterator& end) {
+		static block_data_t description[16384], statement[16384];
+		block_data_t *descr = description, *descr_end = description + max_packet_size;
+		const size_type node_size = 2 + strlen("sensornode1");
+
+		iterator it = current;
+		for( ; it != end; ++it) {
+			block_data_t *stmt = statement, *stmt_end = statement + max_packet_size;
+			block_data_t *before = descr;
+			bool ok = write_string(stmt, stmt_end, 1, (char*)(*it).get(0)) &&
+				write_string(stmt, stmt_end, 2, (char*)(*it).get(1)) &&
+				write_string(stmt, stmt_end, 3, (char*)(*it).get(2)) &&
+				write_bytes(descr, descr_end, 1, statement, stmt - statement);
+			size_type l = descr - description;
+			if(!ok || node_size + 1 + VarInt64::size(l) + l > max_packet_size) {
+				descr = before;
+				break;
+			}
+		}
+
+		block_data_t *buf = buffer, *buf_end = buffer + max_packet_size;
+		if(!write_string(buf, buf_end, 1, "sensornode1")) { return 0; }
+		if(!write_bytes(buf, buf_end, 4, description, descr - description)) { return 0; }
+		current = it;
+		return buf - buffer;
+	}
+
+	static bool skip_to_contents(block_data_t*& p, block_data_t* end, ::uint64_t& field, block_data_t*& data, ::uint64_t& l) {
+		::uint64_t tag;
+		if(!read_varint(p, end, tag) || !read_varint(p, end, l)) { return false; }
+		field = tag >> 3;
+		data = p;
+		p += l;
+		return p <= end;
+	}
+
+	/// Decode a packet, calls t.set_deep() for each string.
+	template<typename T>
+	static size_type read_packet(block_data_t* buffer, size_type size, std::vector<T*>& out) {
+		block_data_t *p = buffer, *end = buffer + size, *data;
+		::uint64_t field, l;
+		size_type n = 0;
+		char s[256];
+		while(p < end) {
+			if(!skip_to_contents(p, end, field, data, l)) { return n; }
+			if(field != 4) { continue; }
+			block_data_t *d = data, *d_end = data + l;
+			while(d < d_end) {
+				if(!skip_to_contents(d, d_end, field, data, l)) { return n; }
+				block_data_t *st = data, *st_end = data + l;
+				T *t = new T;
+				while(st < st_end) {
+					if(!skip_to_contents(st, st_end, field, data, l)) { return n; }
+					size_type i = 0;
+					for( ; i < l && i < sizeof(s) - 1; i++) { s[i] = data[i]; }
+					s[i] = '\0';
+					t->set_deep(field - 1, (block_data_t*)s);
+				}
+				out.push_back(t);
+				n++;
+			}
+		}
+		return n;
+	}
+};
+
+class App {
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			run_varint();
+
+			const char *defaults[] = {
+				"../shdt_test/incontextsensing.rdf",
+				"../shdt_test/btcsample0.rdf",
+				"../shdt_test/ssp.rdf"
+			};
+			size_type n_files = (amp.argc > 1) ? amp.argc - 1 : 3;
+
+			debug_->debug("# corpus tuples packet packets bytes identical legacy_enc/s sized_enc/s enc_speedup legacy_dec/s sized_dec/s dec_speedup");
+			for(size_type f = 0; f < n_files; f++) {
+				const char *path = (amp.argc > 1) ? amp.argv[f + 1] : defaults[f];
+				if(!load(path)) {
+					debug_->debug("could not read %s", path);
+					continue;
+				}
+				size_type packets[] = { 128, 512, 2048, 8192 };
+				for(size_type p = 0; p < 4; p++) {
+					run_rdf(path, packets[p]);
+				}
+			}
+		}
+
+	private:
+		double now() {
+			timeval tv;
+			gettimeofday(&tv, 0);
+			return tv.tv_sec + tv.tv_usec / 1000000.0;
+		}
+
+		void run_varint() {
+			const size_type n = 1000000;
+			std::vector< ::uint64_t> values(n), decoded(n);
+			::uint64_t x = 88172645463325252ULL;
+			for(size_type i = 0; i < n; i++) {
+				// xorshift, then keep 7..64 bits
+				x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+				values[i] = x >> (x % 58);
+			}
+			std::vector<block_data_t> out_legacy(n * 10), out_new(n * 10);
+
+			const size_type rounds = 10;
+			block_data_t *p, *end;
+			size_type bytes = 0;
+
+			double t0 = now();
+			for(size_type r = 0; r < rounds; r++) {
+				p = &out_legacy[0];
+				end = p + out_legacy.size();
+				for(size_type i = 0; i < n; i++) { Legacy::write_varint(p, end, values[i]); }
+				bytes = p - &out_legacy[0];
+			}
+			double t1 = now();
+			for(size_type r = 0; r < rounds; r++) {
+				p = &out_new[0];
+				end = p + out_new.size();
+				for(size_type i = 0; i < n; i++) { VarInt64::write(p, end, values[i]); }
+			}
+			double t2 = now();
+			bool identical = (size_type)(p - &out_new[0]) == bytes &&
+				memcmp(&out_legacy[0], &out_new[0], bytes) == 0;
+
+			for(size_type r = 0; r < rounds; r++) {
+				p = &out_legacy[0];
+				end = p + bytes;
+				for(size_type i = 0; i < n; i++) { Legacy::read_varint(p, end, decoded[i]); }
+			}
+			double t3 = now();
+			bool ok_legacy = (decoded == values);
+			for(size_type r = 0; r < rounds; r++) {
+				p = &out_new[0];
+				end = p + bytes;
+				for(size_type i = 0; i < n; i++) { VarInt64::read(p, end, decoded[i]); }
+			}
+			double t4 = now();
+			bool ok_new = (decoded == values);
+			bytes *= rounds;
+
+			debug_->debug("# varint values bytes identical legacy_enc_MB/s new_enc_MB/s legacy_dec_MB/s new_dec_MB/s");
+			debug_->debug("varint %lu %lu %s %.0f %.0f %.0f %.0f", (unsigned long)n, (unsigned long)bytes,
+					(identical && ok_legacy && ok_new) ? "yes" : "NO",
+					bytes / (t1 - t0) / 1e6, bytes / (t2 - t1) / 1e6,
+					bytes / (t3 - t2) / 1e6, bytes / (t4 - t3) / 1e6);
+		}
+
+		bool load(const char *path) {
+			for(size_type i = 0; i < strings_.size(); i++) { free(strings_[i]); }
+			strings_.clear();
+			tuples_.clear();
+
+			FILE *f = fopen(path, "r");
+			if(!f) { return false; }
+			static char line[20480];
+			SplitN3<Os> splitter;
+			while(fgets(line, sizeof(line), f)) {
+				line[strcspn(line, "\r\n")] = '\0';
+				splitter.parse_line(line);
+				if(splitter.size() < 3) { continue; }
+				for(size_type i = 0; i < 3; i++) {
+					// longer strings would be truncated by the decoder
+					if(strlen(splitter[i]) >= Serializer::MAX_STRING_LENGTH) { splitter[i][Serializer::MAX_STRING_LENGTH - 1] = '\0'; }
+					strings_.push_back(strdup(splitter[i]));
+				}
+			}
+			fclose(f);
+
+			tuples_.resize(strings_.size() / 3);
+			for(size_type i = 0; i < tuples_.size(); i++) {
+				for(size_type j = 0; j < 3; j++) { tuples_[i].set(j, (block_data_t*)strings_[3 * i + j]); }
+			}
+			return true;
+		}
+
+		struct PlainTuple {
+			void set(size_t idx, block_data_t* data) { data_[idx] = data; }
+			block_data_t *get(size_t idx) { return data_[idx]; }
+			block_data_t *data_[3];
+		};
+		typedef std::vector<PlainTuple>::iterator iterator;
+
+		/**
+		 * Split all tuples into packets, tuples that do not fit into an
+		 * empty packet are left out (by both variants).
+		 */
+		template<typename Fill>
+		double encode(Fill& fill, size_type packet, std::vector<block_data_t>& out,
+				std::vector<size_type>& packet_ends, size_type rounds) {
+			std::vector<block_data_t> buffer(packet);
+			double t0 = now();
+			for(size_type r = 0; r < rounds; r++) {
+				out.clear();
+				packet_ends.clear();
+				skipped_.assign(tuples_.size(), false);
+				iterator it = tuples_.begin();
+				while(it != tuples_.end()) {
+					iterator before = it;
+					size_type l = fill(&buffer[0], packet, it, tuples_.end());
+					if(it == before) {
+						skipped_[it - tuples_.begin()] = true;
+						++it;
+						continue;
+					}
+					out.insert(out.end(), buffer.begin(), buffer.begin() + l);
+					packet_ends.push_back(out.size());
+				}
+			}
+			return (now() - t0) / rounds;
+		}
+
+		struct LegacyFill {
+			size_type operator()(block_data_t* b, size_type s, iterator& it, const iterator& end) {
+				return Legacy::fill_buffer(b, s, it, end);
+			}
+		};
+
+		struct SizedFill {
+			Serializer serializer;
+			size_type operator()(block_data_t* b, size_type s, iterator& it, const iterator& end) {
+				return serializer.fill_buffer(b, s, it, end);
+			}
+		};
+
+		size_type decode_legacy(std::vector<block_data_t>& out, std::vector<size_type>& packet_ends, std::vector<Tuple*>& decoded) {
+			size_type start = 0;
+			for(size_type p = 0; p < packet_ends.size(); p++) {
+				Legacy::read_packet(&out[start], packet_ends[p] - start, decoded);
+				start = packet_ends[p];
+			}
+			return decoded.size();
+		}
+
+		size_type decode_sized(std::vector<block_data_t>& out, std::vector<size_type>& packet_ends, std::vector<Tuple*>& decoded) {
+			Serializer serializer;
+			size_type start = 0;
+			for(size_type p = 0; p < packet_ends.size(); p++) {
+				serializer.start_reading(&out[start], packet_ends[p] - start);
+				Tuple *t = new Tuple;
+				while(serializer.read_next(*t)) {
+					decoded.push_back(t);
+					t = new Tuple;
+				}
+				delete t;
+				start = packet_ends[p];
+			}
+			return decoded.size();
+		}
+
+		void clear(std::vector<Tuple*>& v) {
+			for(size_type i = 0; i < v.size(); i++) { delete v[i]; }
+			v.clear();
+		}
+
+		bool verify(std::vector<Tuple*>& decoded) {
+			size_type d = 0;
+			for(size_type i = 0; i < tuples_.size(); i++) {
+				if(skipped_[i]) { continue; }
+				if(d >= decoded.size()) { return false; }
+				for(size_type j = 0; j < 3; j++) {
+					if(strcmp((char*)decoded[d]->get(j), (char*)tuples_[i].get(j)) != 0) { return false; }
+				}
+				d++;
+			}
+			return d == decoded.size();
+		}
+
+		void run_rdf(const char *path, size_type packet) {
+			std::vector<block_data_t> out_legacy, out_sized;
+			std::vector<size_type> ends_legacy, ends_sized;
+			LegacyFill legacy;
+			SizedFill sized;
+
+			size_type rounds = 3;
+			double te_legacy = encode(legacy, packet, out_legacy, ends_legacy, rounds);
+			double te_sized = encode(sized, packet, out_sized, ends_sized, rounds);
+			bool identical = (out_legacy == out_sized) && (ends_legacy == ends_sized);
+
+			std::vector<Tuple*> decoded;
+			double t0 = now();
+			decode_legacy(out_sized, ends_sized, decoded);
+			double td_legacy = now() - t0;
+			bool ok_legacy = verify(decoded);
+			clear(decoded);
+
+			t0 = now();
+			decode_sized(out_sized, ends_sized, decoded);
+			double td_sized = now() - t0;
+			bool ok_sized = verify(decoded);
+			size_type tuples = decoded.size();
+			clear(decoded);
+
+			debug_->debug("%s %lu %lu %lu %lu %s %.0f %.0f %.2f %.0f %.0f %.2f", path, (unsigned long)tuples,
+					(unsigned long)packet, (unsigned long)ends_sized.size(), (unsigned long)out_sized.size(),
+					(identical && ok_legacy && ok_sized) ? "yes" : "NO",
+					tuples / te_legacy, tuples / te_sized, te_legacy / te_sized,
+					tuples / td_legacy, tuples / td_sized, td_legacy / td_sized);
+		}
+
+		std::vector<char*> strings_;
+		std::vector<PlainTuple> tuples_;
+		std::vector<bool> skipped_;
+		Os::Debug::self_pointer_t debug_;
+};
+
+wiselib::WiselibApplication<Os, App> app;
+void application_main(Os::AppMainParameter& amp) {
+	app.init(amp);
+}
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab :
@@ -0,0 +1,220 @@
+/*
+ * Write amplification, wear and write latency of the set/erase to
+ * set/write layers on RamSetEraseStorage.
+ *
+ * Fills a fraction of the logical capacity, then overwrites random
+ * blocks (uniform or 90% of the writes to 10% of the blocks) and reports
+ * per layer / policy:
+ *  - number of successful overwrites (the redirect map based
+ *    SetEraseToSetWrite gives up once it runs out of space),
+ *  - write amplification (blocks set on the storage per user write),
+ *  - erases and min/max erase counts (log-structured only),
+ *  - write latency percentiles in microseconds.
+ * "bg" runs emulate the GC timer by calling gc_idle() between writes.
+ * After each log-structured run all blocks are verified, also after
+ * re-mounting.
+ *
+ * Usage: set_write_benchmark [writes [utilization_percent]]
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <algorithms/block_memory/ram_set_erase_storage.h>
+#include <algorithms/block_memory/set_erase_to_set_write.h>
+#include <algorithms/block_memory/log_set_erase_to_set_write.h>
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+// 64 erase blocks of 128 blocks = 4 MiB
+typedef RamSetEraseStorage<Os, Os::Debug, 128, 64> Storage;
+typedef SetEraseToSetWrite<Os, Storage> RedirectLayer;
+typedef LogSetEraseToSetWrite<Os, Storage> LogLayer;
+
+Storage storage_;
+RedirectLayer redirect_layer_;
+LogLayer log_layer_;
+LogLayer log_layer2_;
+
+class App {
+	// {{{
+	public:
+		enum Pattern { UNIFORM, HOTCOLD };
+
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			size_type writes = 200000;
+			size_type util = 80;
+			if(amp.argc > 1) { writes = atol(amp.argv[1]); }
+			if(amp.argc > 2) { util = atol(amp.argv[2]); }
+			blocks_ = LogLayer::LOGICAL_BLOCKS * util / 100;
+
+			debug_->debug("# %lu blocks (%lu%% of %lu logical), %lu overwrites",
+					(unsigned long)blocks_, (unsigned long)util,
+					(unsigned long)LogLayer::LOGICAL_BLOCKS, (unsigned long)writes);
+			debug_->debug("# layer pattern done wa erases min_ec max_ec p50_us p99_us p999_us max_us");
+
+			for(int pattern = UNIFORM; pattern <= HOTCOLD; pattern++) {
+				run_redirect((Pattern)pattern, writes);
+				run_log((Pattern)pattern, writes, LogLayer::GC_GREEDY, false, "log-greedy");
+				run_log((Pattern)pattern, writes, LogLayer::GC_COST_BENEFIT, false, "log-costbenefit");
+				run_log((Pattern)pattern, writes, LogLayer::GC_GREEDY, true, "log-greedy-bg");
+				run_log((Pattern)pattern, writes, LogLayer::GC_COST_BENEFIT, true, "log-costbenefit-bg");
+			}
+		}
+
+	private:
+		double now_us() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+		}
+
+		size_type pick(Pattern pattern) {
+			if(pattern == HOTCOLD && (rand() % 10) != 0) {
+				return rand() % (blocks_ / 10);
+			}
+			return rand() % blocks_;
+		}
+
+		void fill(block_data_t *buf, size_type block, size_type version) {
+			memset(buf, (int)(block * 31 + version), 512);
+			memcpy(buf, &block, sizeof(block));
+			memcpy(buf + sizeof(block), &version, sizeof(version));
+		}
+
+		void report(const char *layer, Pattern pattern, size_type done, size_type sets,
+				size_type erases, size_type min_ec, size_type max_ec) {
+			std::sort(latencies_.begin(), latencies_.end());
+			size_type n = latencies_.size();
+			double p50 = n ? latencies_[n / 2] : 0;
+			double p99 = n ? latencies_[n * 99 / 100] : 0;
+			double p999 = n ? latencies_[n * 999 / 1000] : 0;
+			double mx = n ? latencies_[n - 1] : 0;
+			debug_->debug("%s %s %lu %.2f %lu %lu %lu %.2f %.2f %.2f %.2f",
+					layer, pattern == UNIFORM ? "uniform" : "hotcold",
+					(unsigned long)done, done ? (double)sets / done : 0.0,
+					(unsigned long)erases, (unsigned long)min_ec, (unsigned long)max_ec,
+					p50, p99, p999, mx);
+		}
+
+		void run_redirect(Pattern pattern, size_type writes) {
+			block_data_t buf[512];
+			storage_.init(debug_);
+			redirect_layer_.init(&storage_, debug_);
+			redirect_layer_.wipe();
+
+			srand(1);
+			std::vector<size_type> addr(blocks_);
+			size_type created = 0;
+			for( ; created < blocks_; created++) {
+				fill(buf, created, 0);
+				addr[created] = redirect_layer_.create(buf);
+				if(addr[created] == (size_type)RedirectLayer::NO_ADDRESS) { break; }
+			}
+
+			storage_.reset_stats();
+			latencies_.clear();
+			size_type done = 0;
+			if(created == blocks_) {
+				for( ; done < writes; done++) {
+					size_type b = pick(pattern);
+					fill(buf, b, done + 1);
+					double t = now_us();
+					int r = redirect_layer_.write(buf, addr[b]);
+					latencies_.push_back(now_us() - t);
+					if(r != RedirectLayer::SUCCESS) { break; }
+				}
+			}
+			else {
+				debug_->debug("# redirect: only %lu blocks could be created", (unsigned long)created);
+			}
+			report("redirect", pattern, done, storage_.sets(), storage_.erases(), 0, 0);
+		}
+
+		void run_log(Pattern pattern, size_type writes, LogLayer::GcPolicy policy, bool background, const char *name) {
+			block_data_t buf[512];
+			storage_.init(debug_);
+			log_layer_.init(&storage_, debug_);
+			log_layer_.wipe();
+			log_layer_.set_gc_policy(policy);
+			log_layer_.set_gc_free_target(4);
+
+			srand(1);
+			std::vector<size_type> addr(blocks_), version(blocks_, 0);
+			for(size_type i = 0; i < blocks_; i++) {
+				fill(buf, i, 0);
+				addr[i] = log_layer_.create(buf);
+			}
+
+			storage_.reset_stats();
+			log_layer_.reset_stats();
+			latencies_.clear();
+			size_type done = 0;
+			for( ; done < writes; done++) {
+				// emulated timer: some idle time after every write
+				if(background) { log_layer_.gc_idle(); }
+
+				size_type b = pick(pattern);
+				version[b] = done + 1;
+				fill(buf, b, version[b]);
+				double t = now_us();
+				int r = log_layer_.write(buf, addr[b]);
+				latencies_.push_back(now_us() - t);
+				if(r != LogLayer::SUCCESS) { break; }
+			}
+
+			// user_writes + gc_writes + erase block headers
+			size_type sets = storage_.sets();
+			report(name, pattern, done, sets, log_layer_.erases(),
+					log_layer_.min_erase_count(), log_layer_.max_erase_count());
+
+			verify(log_layer_, addr, version, name);
+			log_layer2_.init(&storage_, debug_);
+			log_layer2_.mount();
+			verify(log_layer2_, addr, version, name);
+		}
+
+		void verify(LogLayer& layer, std::vector<size_type>& addr, std::vector<size_type>& version, const char *name) {
+			block_data_t buf[512], expect[512];
+			for(size_type i = 0; i < blocks_; i++) {
+				fill(expect, i, version[i]);
+				if(layer.read(buf, addr[i]) != LogLayer::SUCCESS || memcmp(buf, expect, LogLayer::BLOCK_SIZE) != 0) {
+					debug_->debug("%s: verification failed for block %lu", name, (unsigned long)i);
+					exit(1);
+				}
+			}
+		}
+
+		size_type blocks_;
+		std::vector<double> latencies_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
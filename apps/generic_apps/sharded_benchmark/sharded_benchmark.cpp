@@ -0,0 +1,519 @@
+/*
+ * INQP on a sharded tuple store (ShardedQueryProcessor) with 1 to N
+ * worker threads against INQPQueryProcessor on one tuple store.
+ *
+ * The store holds n sensors, each with an observed property (one of
+ * four), a value (0..999) and a room (one of 100). Queries:
+ *  - selection: (?s hasValue ?v) FILTER(?v > 900), sends (?s, ?v)
+ *  - join: (?s observedProperty Temperature) (?s hasValue ?v)
+ *    FILTER(?v > 990), sends (?s, ?v)
+ *  - group: COUNT(?s) GROUP BY ?p { ?s observedProperty ?p }
+ *  - aggregate: COUNT, SUM, MIN, MAX and COUNT DISTINCT of ?v over
+ *    (?s hasValue ?v)
+ * The sharded store has SHARDS_PER_THREAD * N shards, so workers that
+ * are done early take more of them. Thread counts are 1, 2, 4, ... and
+ * N. Before timing, every configuration has to send the same rows as
+ * the serial processor (compared as multisets, aggregates after the
+ * timer fired once). If N is less than CHECK_THREADS (e.g. on a single
+ * cpu host) this is also checked for CHECK_THREADS threads, without
+ * timing, so the results of concurrent shard workers are always
+ * verified. An execution is execute() plus one timer round for the
+ * aggregates to send.
+ *
+ * Output: sensors tuples query impl shards threads ms_per_execution speedup
+ *   speedup: serial time / this time
+ *
+ * Usage: sharded_benchmark [max_threads [sensors]]
+ *   (default: one thread per cpu, 100000 sensors)
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#define INQP_AGGREGATE_CHECK_INTERVAL 1000
+	#define WISELIB_TIME_FACTOR 1
+	#define WISELIB_MAX_NEIGHBORS 4
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+
+	// the query processor's debug output would dominate the timings
+	#undef DBG
+	#define DBG(...)
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <util/delegates/delegate.hpp>
+#include <util/serialization/serialization.h>
+#include <algorithms/hash/sdbm.h>
+#include <util/tuple_store/tuplestore.h>
+#include <util/tuple_store/hash_dictionary.h>
+#include <algorithms/rdf/inqp/query_processor.h>
+#include <algorithms/rdf/inqp/sharded_query_processor.h>
+
+typedef Sdbm<Os> Hash;
+
+/**
+ * Triple of dictionary keys as wide as pointers.
+ */
+class TupleT {
+	public:
+		enum { SIZE = 3 };
+
+		TupleT() { for(size_type i = 0; i < SIZE; i++) { data_[i] = 0; } }
+
+		block_data_t* get(size_type i) { return reinterpret_cast<block_data_t*>(data_[i]); }
+		void set(size_type i, block_data_t* data) { data_[i] = reinterpret_cast<unsigned long>(data); }
+		size_type length(size_type i) { return get(i) ? strlen((char*)get(i)) : 0; }
+
+		void set_deep(size_type i, block_data_t* data) {
+			size_type l = strlen((char*)data) + 1;
+			set(i, ::get_allocator().allocate_array<block_data_t>(l).raw());
+			memcpy(get(i), data, l);
+		}
+		void free_deep(size_type i) {
+			if(get(i)) { ::get_allocator().free_array(get(i)); }
+			set(i, 0);
+		}
+		// All columns hold dictionary keys here, TupleStore::erase() sets
+		// them to NULL_KEY which is not 0 for HashDictionary.
+		void destruct_deep() { }
+
+		void set_key(size_type i, unsigned long k) { data_[i] = k; }
+		unsigned long get_key(size_type i) const { return data_[i]; }
+
+		static int compare(int col, ::uint8_t *a, int alen, ::uint8_t *b, int blen) {
+			if(alen != blen) { return blen - alen; }
+			return memcmp(a, b, alen);
+		}
+
+		bool operator==(const TupleT& other) const {
+			return data_[0] == other.data_[0] && data_[1] == other.data_[1] && data_[2] == other.data_[2];
+		}
+
+		bool operator<(const TupleT& other) const {
+			for(size_type i = 0; i < SIZE; i++) {
+				if(data_[i] != other.data_[i]) { return data_[i] < other.data_[i]; }
+			}
+			return false;
+		}
+
+	private:
+		unsigned long data_[SIZE];
+};
+
+/**
+ * Tuple container on std::set (as in snapshot_benchmark), graph pattern
+ * selections scan it.
+ */
+class TupleContainer {
+	public:
+		typedef TupleT value_type;
+		typedef ::size_type size_type;
+		typedef std::set<TupleT> set_t;
+
+		/**
+		 * The tuple store wants non-const tuples, it does not change
+		 * their keys though.
+		 */
+		class iterator {
+			public:
+				iterator() { }
+				iterator(set_t::iterator it) : it_(it) { }
+
+				TupleT& operator*() { return const_cast<TupleT&>(*it_); }
+				TupleT* operator->() { return &operator*(); }
+				iterator& operator++() { ++it_; return *this; }
+				bool operator==(const iterator& other) const { return it_ == other.it_; }
+				bool operator!=(const iterator& other) const { return it_ != other.it_; }
+
+				set_t::iterator it_;
+		};
+
+		iterator begin() { return s_.begin(); }
+		iterator end() { return s_.end(); }
+		size_type size() { return s_.size(); }
+		bool empty() { return s_.empty(); }
+		void clear() { s_.clear(); }
+
+		iterator insert(const TupleT& t) { return s_.insert(t).first; }
+		iterator erase(iterator it) { s_.erase(it.it_++); return it; }
+		iterator find(TupleT& t) { return s_.find(t); }
+
+	private:
+		set_t s_;
+};
+
+/**
+ * Timer whose callbacks only run when fire() is called (as in
+ * incremental_benchmark).
+ */
+class ManualTimer {
+	public:
+		typedef ManualTimer self_type;
+		typedef self_type* self_pointer_t;
+		typedef Os::Timer::millis_t millis_t;
+		typedef delegate1<void, void*> timer_delegate_t;
+
+		template<typename T, void (T::*TMethod)(void*)>
+		int set_timer(millis_t millis, T* obj, void* userdata) {
+			pending_.push_back(std::make_pair(timer_delegate_t::from_method<T, TMethod>(obj), userdata));
+			return Os::SUCCESS;
+		}
+
+		/**
+		 * Run the callbacks set so far (not the ones they set).
+		 */
+		void fire() {
+			std::vector<std::pair<timer_delegate_t, void*> > due;
+			due.swap(pending_);
+			for(size_type i = 0; i < due.size(); i++) {
+				due[i].first(due[i].second);
+			}
+		}
+
+		void clear() { pending_.clear(); }
+
+	private:
+		std::vector<std::pair<timer_delegate_t, void*> > pending_;
+};
+
+typedef HashDictionary<Os, Hash> Dictionary;
+typedef TupleStore<Os, TupleContainer, Dictionary, Os::Debug, BIN(111), &TupleT::compare> TupleStoreT;
+typedef INQPQueryProcessor<Os, TupleStoreT, Hash, 4, WISELIB_MAX_NEIGHBORS, Dictionary,
+		DictionaryTranslator<Os, Dictionary, Hash, 8>, HashTranslator<Os, Dictionary, Hash, 4>,
+		::uint32_t, ManualTimer> Processor;
+typedef ShardedQueryProcessor<Os, Processor> Sharded;
+typedef Processor::RowT RowT;
+typedef RowT::Value Value;
+typedef Processor::AggregateDescriptionT AD;
+typedef Processor::SelectionDescriptionT SD;
+
+/**
+ * Rows the sink got, by query.
+ */
+typedef std::map<int, std::map<std::vector<Value>, int> > Sink;
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+			size_type max_threads = (amp.argc > 1) ? atoi(amp.argv[1]) : ((cpus < 1) ? 1 : cpus);
+			size_type sensors = (amp.argc > 2) ? atol(amp.argv[2]) : 100000;
+			if(max_threads < 1) { max_threads = 1; }
+
+			dictionary_.init(debug_);
+			all_.init(&dictionary_, &container_, debug_);
+			fill(sensors);
+
+			debug_->debug("# sensors tuples query impl shards threads ms_per_execution speedup");
+			double serial[QUERIES + 1];
+			Sink expected;
+			{
+				Processor processor;
+				processor.init(&all_, &timer_);
+				processor.reg_row_callback<App, &App::on_row>(this);
+				result(processor, expected);
+				for(int q = 1; q <= QUERIES; q++) {
+					serial[q] = measure(processor, q);
+					report(sensors, q, "serial", 1, 1, serial[q], serial[q]);
+				}
+				for(int q = 1; q <= QUERIES; q++) {
+					processor.erase_query(q);
+				}
+				timer_.fire(); // let the aggregates free their timer info
+				timer_.clear();
+			}
+
+			if(max_threads < CHECK_THREADS) {
+				Sharded *sharded = create(SHARDS_PER_THREAD * CHECK_THREADS, CHECK_THREADS);
+				Sink sink;
+				result(*sharded, sink);
+				check(sink, expected);
+				destroy(sharded);
+			}
+
+			size_type shards = SHARDS_PER_THREAD * max_threads;
+			for(size_type threads = 1; ; threads *= 2) {
+				if(threads > max_threads) { threads = max_threads; }
+
+				Sharded *sharded = create(shards, threads);
+				Sink sink;
+				result(*sharded, sink);
+				check(sink, expected);
+				for(int q = 1; q <= QUERIES; q++) {
+					report(sensors, q, "sharded", shards, threads, measure(*sharded, q), serial[q]);
+				}
+				destroy(sharded);
+
+				if(threads == max_threads) { break; }
+			}
+
+			container_.clear();
+		}
+
+		void on_row(int type, size_type columns, RowT& row, Processor::query_id_t qid, Processor::operator_id_t oid) {
+			rows_++;
+			if(sink_) {
+				std::vector<Value> r(&row[0], &row[0] + columns);
+				(*sink_)[qid][r]++;
+			}
+		}
+
+	private:
+		enum { QUERIES = 4, REPEAT = 10, SHARDS_PER_THREAD = 4, CHECK_THREADS = 4 };
+		enum { STRING = ProjectionInfoBase::STRING, INTEGER = ProjectionInfoBase::INTEGER };
+		enum { LEFT = 0, RIGHT = 0x80, ROOT = 0 };
+		enum { QUERY_SELECTION = 1, QUERY_JOIN = 2, QUERY_GROUP = 3, QUERY_AGGREGATE = 4 };
+
+		double now() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+		}
+
+		static Hash::hash_t hash(const char *s) {
+			return Hash::hash((block_data_t*)s, strlen(s));
+		}
+
+		static const char* has_value() { return "<http://www.ontologydesignpatterns.org/ont/dul/hasValue>"; }
+		static const char* observed_property() { return "<http://purl.oclc.org/NET/ssnx/ssn#observedProperty>"; }
+		static const char* located_in() { return "<http://www.ontologydesignpatterns.org/ont/dul/hasLocation>"; }
+		static const char* temperature() { return "<http://me.exmpl/Temperature>"; }
+
+		void insert(const char *s, const char *p, const char *o) {
+			TupleT t;
+			t.set(0, (block_data_t*)const_cast<char*>(s));
+			t.set(1, (block_data_t*)const_cast<char*>(p));
+			t.set(2, (block_data_t*)const_cast<char*>(o));
+			all_.insert(t);
+		}
+
+		void fill(size_type n) {
+			static const char *properties[] = {
+				temperature(), "<http://me.exmpl/Humidity>", "<http://me.exmpl/Pressure>", "<http://me.exmpl/Light>"
+			};
+			char s[64], v[16], r[64];
+			srand(n);
+			for(size_type i = 0; i < n; i++) {
+				snprintf(s, sizeof(s), "<http://foo.bar/sensor%lu>", (unsigned long)i);
+				snprintf(v, sizeof(v), "%d", rand() % 1000);
+				snprintf(r, sizeof(r), "<http://me.exmpl/room%d>", rand() % 100);
+				insert(s, observed_property(), properties[rand() % 4]);
+				insert(s, has_value(), v);
+				insert(s, located_in(), r);
+			}
+		}
+
+		/**
+		 * Write the operator description @a op (id, type, parent,
+		 * projection) followed by the constants of a graph pattern
+		 * selection with pattern (s, p, o), 0 for variables.
+		 */
+		size_type gps(block_data_t *op, block_data_t id, block_data_t parent, ::uint32_t projection,
+				const char *s, const char *p, const char *o) {
+			const char *c[] = { s, p, o };
+			size_type l = header(op, id, 'g', parent, projection);
+			block_data_t &affected = op[l++];
+			affected = 0;
+			for(size_type i = 0; i < 3; i++) {
+				if(!c[i]) { continue; }
+				affected |= 1 << i;
+				Value h = hash(c[i]);
+				l += wiselib::write<Os, block_data_t, Value>(op + l, h);
+			}
+			return l;
+		}
+
+		size_type header(block_data_t *op, block_data_t id, char type, block_data_t parent, ::uint32_t projection) {
+			op[0] = id;
+			op[1] = type;
+			op[2] = parent;
+			memset(op + 3, 0, sizeof(ProjectionInfo<Os>));
+			for(size_type i = 0; i < sizeof(ProjectionInfo<Os>); i++) {
+				op[3 + i] = (projection >> (8 * i)) & 0xff;
+			}
+			return 3 + sizeof(ProjectionInfo<Os>);
+		}
+
+		/**
+		 * Selection of the rows whose second column is greater than
+		 * @a threshold.
+		 */
+		size_type selection(block_data_t *op, block_data_t id, block_data_t parent, ::uint32_t projection, Value threshold) {
+			size_type l = header(op, id, 's', parent, projection);
+			op[l++] = 2;
+			op[l++] = 1;
+			op[l++] = SD::IGNORE;
+			op[l++] = SD::GT | 0;
+			l += wiselib::write<Os, block_data_t, Value>(op + l, threshold);
+			return l;
+		}
+
+		/**
+		 * Send the queries to @a processor (INQPQueryProcessor or
+		 * ShardedQueryProcessor), which executes them once.
+		 */
+		template<typename P>
+		void create_queries(P& processor) {
+			block_data_t op[64];
+			size_type l;
+
+			// selection: (?s hasValue ?v) FILTER(?v > 900)
+			l = gps(op, 1, LEFT | 2, STRING | INTEGER << 4, 0, has_value(), 0);
+			processor.handle_operator(QUERY_SELECTION, l, op);
+			l = selection(op, 2, LEFT | 3, STRING | INTEGER << 2, 900);
+			processor.handle_operator(QUERY_SELECTION, l, op);
+			l = header(op, 3, 'c', ROOT, STRING | INTEGER << 2);
+			processor.handle_operator(QUERY_SELECTION, l, op);
+			processor.handle_query_info(QUERY_SELECTION, 3);
+
+			// join: (?s observedProperty Temperature) (?s hasValue ?v) FILTER(?v > 990)
+			l = gps(op, 1, LEFT | 4, STRING, 0, observed_property(), temperature());
+			processor.handle_operator(QUERY_JOIN, l, op);
+			l = gps(op, 2, LEFT | 3, STRING | INTEGER << 4, 0, has_value(), 0);
+			processor.handle_operator(QUERY_JOIN, l, op);
+			l = selection(op, 3, RIGHT | 4, STRING | INTEGER << 2, 990);
+			processor.handle_operator(QUERY_JOIN, l, op);
+			l = header(op, 4, 'j', LEFT | 5, STRING | INTEGER << 4);
+			op[l++] = 0; // LEFT_COL(0) | RIGHT_COL(0)
+			processor.handle_operator(QUERY_JOIN, l, op);
+			l = header(op, 5, 'c', ROOT, STRING | INTEGER << 2);
+			processor.handle_operator(QUERY_JOIN, l, op);
+			processor.handle_query_info(QUERY_JOIN, 5);
+
+			// group: COUNT(?s) GROUP BY ?p { ?s observedProperty ?p }
+			l = gps(op, 1, LEFT | 2, STRING << 2, 0, observed_property(), 0);
+			processor.handle_operator(QUERY_GROUP, l, op);
+			l = header(op, 2, 'a', ROOT, STRING | INTEGER << 2);
+			op[l++] = 2;
+			op[l++] = AD::GROUP | AD::AGAIN;
+			op[l++] = AD::COUNT;
+			processor.handle_operator(QUERY_GROUP, l, op);
+			processor.handle_query_info(QUERY_GROUP, 2);
+
+			// aggregate: COUNT(?v) SUM(?v) MIN(?v) MAX(?v) COUNT(DISTINCT ?v) { ?s hasValue ?v }
+			l = gps(op, 1, LEFT | 2, INTEGER << 4, 0, has_value(), 0);
+			processor.handle_operator(QUERY_AGGREGATE, l, op);
+			l = header(op, 2, 'a', ROOT, INTEGER | INTEGER << 2 | INTEGER << 4 | INTEGER << 6 | INTEGER << 8);
+			op[l++] = 5;
+			op[l++] = AD::COUNT | AD::AGAIN;
+			op[l++] = AD::SUM | AD::AGAIN;
+			op[l++] = AD::MIN | AD::AGAIN;
+			op[l++] = AD::MAX | AD::AGAIN;
+			op[l++] = AD::COUNT_DISTINCT;
+			processor.handle_operator(QUERY_AGGREGATE, l, op);
+			processor.handle_query_info(QUERY_AGGREGATE, 2);
+		}
+
+		void execute(Processor& processor, int q) {
+			processor.execute(processor.get_query(q));
+		}
+
+		void execute(Sharded& sharded, int q) {
+			sharded.execute(q);
+		}
+
+		/**
+		 * Create the queries and record what the sink gets from their
+		 * first execution in @a sink.
+		 */
+		template<typename P>
+		void result(P& processor, Sink& sink) {
+			sink_ = &sink;
+			create_queries(processor);
+			timer_.fire();
+			sink_ = 0;
+		}
+
+		/**
+		 * @return milliseconds per execution of query @a q.
+		 */
+		template<typename P>
+		double measure(P& processor, int q) {
+			double t = now();
+			for(size_type r = 0; r < REPEAT; r++) {
+				execute(processor, q);
+				timer_.fire();
+			}
+			return (now() - t) / REPEAT / 1000.0;
+		}
+
+		void report(size_type sensors, int q, const char *impl, size_type shards, size_type threads, double ms, double serial) {
+			static const char *names[] = { "", "selection", "join", "group", "aggregate" };
+			debug_->debug("%lu %lu %s %s %lu %lu %.3f %.2f", (unsigned long)sensors, (unsigned long)container_.size(),
+					names[q], impl, (unsigned long)shards, (unsigned long)threads, ms, serial / ms);
+		}
+
+		Sharded* create(size_type shards, size_type threads) {
+			Sharded *sharded = new Sharded;
+			sharded->init(&dictionary_, &timer_, shards, threads, debug_);
+			sharded->partition(all_);
+			sharded->processor().reg_row_callback<App, &App::on_row>(this);
+			return sharded;
+		}
+
+		void destroy(Sharded *sharded) {
+			delete sharded;
+			timer_.fire();
+			timer_.clear();
+		}
+
+		void check(Sink& sink, Sink& expected) {
+			for(int q = 1; q <= QUERIES; q++) {
+				if(expected[q].empty()) { fail("empty result"); }
+				if(sink[q] != expected[q]) {
+					debug_->debug("query %d: %lu rows, expected %lu", q, (unsigned long)sink[q].size(), (unsigned long)expected[q].size());
+					fail("rows");
+				}
+			}
+		}
+
+		void fail(const char *what) {
+			debug_->debug("%s check failed", what);
+			exit(1);
+		}
+
+		Dictionary dictionary_;
+		TupleContainer container_;
+		TupleStoreT all_;
+		ManualTimer timer_;
+		Sink *sink_;
+		unsigned long rows_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
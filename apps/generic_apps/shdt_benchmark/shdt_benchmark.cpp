@@ -0,0 +1,172 @@
+/*
+ * SHDT encoding throughput, prefix trie index vs. linear table scan.
+ *
+ * Reads the shdt_test corpora (N-Triples), encodes all tuples with both
+ * serializer variants for several packet and table sizes, verifies the
+ * produced byte streams are identical and decode back to the input and
+ * reports encoding throughput.
+ *
+ * Usage: shdt_benchmark [file.rdf ...]
+ *   (default: ../shdt_test/{incontextsensing,btcsample0,ssp}.rdf)
+ */
+
+#define SHDT_REUSE_PREFIXES 1
+
+#include "../shdt_test/platform.h"
+
+using namespace wiselib;
+#include <util/broker/shdt_serializer.h>
+#include <util/split_n3.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <vector>
+
+typedef Os::size_t size_type;
+typedef Os::block_data_t block_data_t;
+
+typedef ShdtSerializer<Os, 255, 4, true> IndexedShdt;
+typedef ShdtSerializer<Os, 255, 4, false> LinearShdt;
+
+struct Tuple {
+	void set(size_t idx, block_data_t* data) { data_[idx] = data; }
+	block_data_t *get(size_t idx) { return data_[idx]; }
+	size_t length(size_t idx) { return strlen((char*)data_[idx]) + 1; }
+	block_data_t *data_[3];
+};
+
+class App {
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			const char *defaults[] = {
+				"../shdt_test/incontextsensing.rdf",
+				"../shdt_test/btcsample0.rdf",
+				"../shdt_test/ssp.rdf"
+			};
+			size_type n_files = (amp.argc > 1) ? amp.argc - 1 : 3;
+
+			debug_->debug("# corpus tuples packet table bytes identical linear_tuples/s indexed_tuples/s speedup");
+			for(size_type f = 0; f < n_files; f++) {
+				const char *path = (amp.argc > 1) ? amp.argv[f + 1] : defaults[f];
+				if(!load(path)) {
+					debug_->debug("could not read %s", path);
+					continue;
+				}
+				for(size_type packet = 20; packet <= 140; packet += 60) {
+					size_type tables[] = { 16, 64, 128, 254 };
+					for(size_type t = 0; t < 4; t++) {
+						run(path, packet, tables[t]);
+					}
+				}
+			}
+		}
+
+	private:
+		bool load(const char *path) {
+			for(size_type i = 0; i < strings_.size(); i++) { free(strings_[i]); }
+			strings_.clear();
+
+			FILE *f = fopen(path, "r");
+			if(!f) { return false; }
+			static char line[20480];
+			SplitN3<Os> splitter;
+			while(fgets(line, sizeof(line), f)) {
+				line[strcspn(line, "\r\n")] = '\0';
+				splitter.parse_line(line);
+				if(splitter.size() < 3) { continue; }
+				for(size_type i = 0; i < 3; i++) {
+					strings_.push_back(strdup(splitter[i]));
+				}
+			}
+			fclose(f);
+			return true;
+		}
+
+		double now() {
+			timeval tv;
+			gettimeofday(&tv, 0);
+			return tv.tv_sec + tv.tv_usec / 1000000.0;
+		}
+
+		template<typename Shdt>
+		void collect(typename Shdt::Writer& w) {
+			out_->insert(out_->end(), w.buffer(), w.buffer() + w.buffer_used());
+			packet_ends_->push_back(out_->size());
+			w.reuse_buffer();
+		}
+
+		template<typename Shdt>
+		double encode(size_type packet, size_type table, std::vector<block_data_t>& out,
+				std::vector<size_type>& packet_ends, size_type rounds) {
+			double t0 = now();
+			for(size_type r = 0; r < rounds; r++) {
+				out.clear();
+				packet_ends.clear();
+				out_ = &out;
+				packet_ends_ = &packet_ends;
+
+				Shdt shdt;
+				typename Shdt::Writer w(&shdt, buffer_, packet,
+						Shdt::Writer::write_callback_t::template from_method<App, &App::collect<Shdt> >(this));
+				w.write_header(table, 3);
+				for(size_type i = 0; i + 2 < strings_.size(); i += 3) {
+					Tuple tuple;
+					for(size_type j = 0; j < 3; j++) { tuple.set(j, (block_data_t*)strings_[i + j]); }
+					w.write_tuple(tuple);
+				}
+				w.flush();
+			}
+			return (now() - t0) / rounds;
+		}
+
+		bool verify_decode(std::vector<block_data_t>& out, std::vector<size_type>& packet_ends) {
+			IndexedShdt shdt;
+			size_type idx = 0, start = 0;
+			for(size_type p = 0; p < packet_ends.size(); p++) {
+				typename IndexedShdt::Reader r(&shdt, &out[start], packet_ends[p] - start);
+				Tuple t;
+				while(r.read_tuple(t)) {
+					for(size_type j = 0; j < 3; j++, idx++) {
+						if(idx >= strings_.size() || strcmp((char*)t.get(j), strings_[idx]) != 0) {
+							return false;
+						}
+					}
+				}
+				start = packet_ends[p];
+			}
+			return idx == strings_.size();
+		}
+
+		void run(const char *path, size_type packet, size_type table) {
+			std::vector<block_data_t> out_linear, out_indexed;
+			std::vector<size_type> ends_linear, ends_indexed;
+
+			size_type rounds = 3;
+			double t_linear = encode<LinearShdt>(packet, table, out_linear, ends_linear, rounds);
+			double t_indexed = encode<IndexedShdt>(packet, table, out_indexed, ends_indexed, rounds);
+
+			bool identical = (out_linear == out_indexed) && (ends_linear == ends_indexed);
+			bool decodes = verify_decode(out_indexed, ends_indexed);
+			size_type tuples = strings_.size() / 3;
+
+			debug_->debug("%s %lu %lu %lu %lu %s %.0f %.0f %.2f", path, (unsigned long)tuples,
+					(unsigned long)packet, (unsigned long)table, (unsigned long)out_indexed.size(),
+					(identical && decodes) ? "yes" : "NO",
+					tuples / t_linear, tuples / t_indexed, t_linear / t_indexed);
+		}
+
+		std::vector<char*> strings_;
+		std::vector<block_data_t> *out_;
+		std::vector<size_type> *packet_ends_;
+		block_data_t buffer_[1024];
+		Os::Debug::self_pointer_t debug_;
+};
+
+wiselib::WiselibApplication<Os, App> app;
+void application_main(Os::AppMainParameter& amp) {
+	app.init(amp);
+}
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab :
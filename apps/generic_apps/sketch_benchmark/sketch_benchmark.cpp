@@ -0,0 +1,622 @@
+/*
+ * Sketch aggregates against exact aggregation over a simulated
+ * aggregation tree.
+ *
+ * A random tree of n nodes, every node measures 40 values of a Zipf
+ * distribution over 5000 values. Every node but the root sends one
+ * summary of its subtree to its parent, in its wire encoding (writeTo(),
+ * read back by the parent):
+ *  - distinct: number of distinct values, exact (the set of values, 2
+ *    bytes each) or HyperLogLog
+ *  - topk: the 4 most frequent values, exact (value, count pairs, 4 bytes
+ *    each) or Count-Min with candidate list
+ *  - quantiles: 10, 25, 50, 75 and 90% quantiles, exact (value, count
+ *    pairs) or KLL
+ *  - inqp: COUNT, COUNT_DISTINCT, TOP_K and QUANTILE of the INQP
+ *    Aggregate operator, it sends rows of its physical columns (one
+ *    row for all of them, so bytes are the same)
+ *
+ * Output: aggregate impl nodes bytes max_bytes error
+ * (bytes sent by all nodes, max_bytes sent by one node; error as mean
+ * over 10 trees: distinct |estimate - exact| / exact, topk share of the
+ * exact top 4 (top_k: INQP_AGGREGATE_TOP_K) not found, quantiles max
+ * |rank(estimate) - q n| / n)
+ *
+ * Usage: sketch_benchmark
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#define INQP_AGGREGATE_CHECK_INTERVAL 1000
+	#define WISELIB_TIME_FACTOR 1
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/types.h>
+#include <algorithms/aggregation/hyperloglog.h>
+#include <algorithms/aggregation/count_min_sketch.h>
+#include <algorithms/aggregation/kll_sketch.h>
+#include <algorithms/rdf/inqp/row.h>
+#include <algorithms/rdf/inqp/operators/aggregate.h>
+
+typedef ::uint16_t Measurement;
+typedef std::map<Measurement, unsigned long> Counts;
+
+typedef Row<Os> RowT;
+typedef RowT::Value Value;
+
+enum { MAX_NEIGHBORS = 64, READINGS = 40, DOMAIN = 5000, TREES = 10, MAX_SUMMARY_SIZE = 512, QUANTILES = 5 };
+
+/// quantiles evaluated
+static const float qs[QUANTILES] = { 0.1, 0.25, 0.5, 0.75, 0.9 };
+
+/**
+ * The parts of INQPQueryProcessor the aggregate operator uses, rows sent
+ * are recorded.
+ */
+class Processor {
+	public:
+		typedef Processor self_type;
+		typedef ::uint8_t operator_id_t;
+		typedef ::uint8_t query_id_t;
+		typedef ::RowT RowT;
+		typedef RowT::Value Value;
+		typedef Processor Dictionary;
+		typedef Processor Translator;
+		typedef Processor ReverseTranslator;
+
+		enum { COMMUNICATION_TYPE_AGGREGATE = 'a' };
+
+		class Timer {
+			public:
+				typedef ::uint32_t millis_t;
+
+				template<typename T, void (T::*TMethod)(void*)>
+				int set_timer(millis_t millis, T* obj, void* userdata) {
+					userdata_ = userdata;
+					return Os::SUCCESS;
+				}
+
+				void *userdata_;
+		};
+
+		class Query {
+			public:
+				Query(self_type *p) : processor_(p) { }
+				self_type& processor() { return *processor_; }
+				query_id_t id() { return 1; }
+			private:
+				self_type *processor_;
+		};
+
+		void send_row(int type, size_type columns, RowT& row, query_id_t qid, operator_id_t oid) {
+			rows_.push_back(std::vector<Value>(&row[0], &row[0] + columns));
+		}
+
+		Timer& timer() { return timer_; }
+
+		Timer timer_;
+		std::vector<std::vector<Value> > rows_;
+};
+
+typedef AggregateDescription<Os, Processor> AD;
+typedef Aggregate<Os, Processor, MAX_NEIGHBORS> AggregateT;
+
+/**
+ * Aggregation tree, parent[i] < i.
+ */
+struct Tree {
+	std::vector<size_type> parent;
+	std::vector<std::vector<size_type> > children;
+	std::vector<std::vector<Measurement> > readings;
+	/// exact counts of every subtree
+	std::vector<Counts> counts;
+};
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			make_zipf(1.1);
+			check();
+			check_inqp();
+
+			debug_->debug("# aggregate impl nodes bytes max_bytes error");
+			static const size_type ns[] = { 50, 500 };
+			for(size_type i = 0; i < sizeof(ns) / sizeof(ns[0]); i++) {
+				run_distinct<HyperLogLog<Os, 6> >("hll-64", ns[i], true);
+				run_distinct<HyperLogLog<Os, 8> >("hll-256", ns[i], false);
+				run_topk<CountMinSketch<Os, Measurement, 32, 3, 4> >("countmin-32x3", ns[i], true);
+				run_topk<CountMinSketch<Os, Measurement, 64, 3, 4> >("countmin-64x3", ns[i], false);
+				run_quantiles<KllSketch<Os, Measurement, 8> >("kll-8", ns[i], true);
+				run_quantiles<KllSketch<Os, Measurement, 16> >("kll-16", ns[i], false);
+				run_inqp(ns[i]);
+			}
+		}
+
+	private:
+		// {{{ Data
+
+		void make_zipf(double s) {
+			zipf_.resize(DOMAIN);
+			double sum = 0.0;
+			for(size_type r = 0; r < DOMAIN; r++) {
+				sum += 1.0 / pow(r + 1.0, s);
+				zipf_[r] = sum;
+			}
+			for(size_type r = 0; r < DOMAIN; r++) { zipf_[r] /= sum; }
+		}
+
+		Measurement measure() {
+			double u = rand() / (RAND_MAX + 1.0);
+			size_type rank = std::lower_bound(zipf_.begin(), zipf_.end(), u) - zipf_.begin();
+			// scatter the ranks over the value range
+			return (Measurement)(rank * 40503u);
+		}
+
+		void make_tree(Tree& t, size_type n, unsigned seed) {
+			srand(seed);
+			t.parent.assign(n, 0);
+			t.children.assign(n, std::vector<size_type>());
+			t.readings.assign(n, std::vector<Measurement>());
+			t.counts.assign(n, Counts());
+			for(size_type i = 0; i < n; i++) {
+				if(i) {
+					t.parent[i] = rand() % i;
+					t.children[t.parent[i]].push_back(i);
+				}
+				for(size_type j = 0; j < READINGS; j++) {
+					t.readings[i].push_back(measure());
+				}
+			}
+			for(size_type i = n; i-- > 0; ) {
+				for(size_type j = 0; j < READINGS; j++) {
+					t.counts[i][t.readings[i][j]]++;
+				}
+				if(i) {
+					Counts &p = t.counts[t.parent[i]];
+					for(Counts::iterator it = t.counts[i].begin(); it != t.counts[i].end(); ++it) {
+						p[it->first] += it->second;
+					}
+				}
+			}
+		}
+
+		/**
+		 * Bytes sent by all / one node with exact summaries of @a
+		 * entry_size bytes per distinct value.
+		 */
+		void exact_bytes(Tree& t, size_type entry_size, unsigned long& bytes, unsigned long& max_bytes) {
+			bytes = 0;
+			max_bytes = 0;
+			for(size_type i = 1; i < t.parent.size(); i++) {
+				unsigned long b = t.counts[i].size() * entry_size;
+				bytes += b;
+				if(b > max_bytes) { max_bytes = b; }
+			}
+		}
+
+		/**
+		 * @return Share of the k most frequent values of @a c not among
+		 * the candidates @a top. Candidates at least as frequent as the
+		 * k-th most frequent value count as found (ties).
+		 */
+		double topk_error(Counts& c, std::vector<Measurement>& top, size_type k) {
+			std::vector<unsigned long> frequencies;
+			for(Counts::iterator it = c.begin(); it != c.end(); ++it) {
+				frequencies.push_back(it->second);
+			}
+			std::sort(frequencies.rbegin(), frequencies.rend());
+			unsigned long kth = frequencies[k - 1];
+
+			size_type found = 0;
+			for(size_type i = 0; i < top.size(); i++) {
+				if(c[top[i]] >= kth) { found++; }
+			}
+			return (k - (found > k ? k : found)) / (double)k;
+		}
+
+		/**
+		 * @return Distance of the ranks of @a v in @a c from q * total,
+		 * relative to total.
+		 */
+		double rank_error(Counts& c, double total, float q, Measurement v) {
+			// ranks [less, less_or_equal] of v
+			double less = 0, less_or_equal = 0;
+			for(Counts::iterator it = c.begin(); it != c.end() && it->first <= v; ++it) {
+				if(it->first < v) { less += it->second; }
+				less_or_equal += it->second;
+			}
+			double r = q * total;
+			double d = (r < less) ? less - r : (r > less_or_equal) ? r - less_or_equal : 0.0;
+			return d / total;
+		}
+
+		// }}}
+		// {{{ Sketch aggregation
+
+		/**
+		 * Aggregate the readings of @a t up the tree, every node sends
+		 * the wire encoding of its sketch to its parent.
+		 */
+		template<typename Sketch>
+		Sketch aggregate(Tree& t, unsigned long& bytes, unsigned long& max_bytes) {
+			std::vector<Sketch> sketches(t.parent.size());
+			block_data_t buffer[MAX_SUMMARY_SIZE];
+			bytes = 0;
+			max_bytes = 0;
+
+			for(size_type i = t.parent.size(); i-- > 0; ) {
+				Sketch &s = sketches[i];
+				for(size_type j = 0; j < READINGS; j++) {
+					s.insert(t.readings[i][j]);
+				}
+				if(i) {
+					unsigned long b = s.size();
+					if(b > MAX_SUMMARY_SIZE) { fail("sketch size"); }
+					s.writeTo(buffer);
+					Sketch received(buffer);
+					sketches[t.parent[i]].merge(received);
+					bytes += b;
+					if(b > max_bytes) { max_bytes = b; }
+				}
+			}
+			return sketches[0];
+		}
+
+		template<typename Sketch>
+		void run_distinct(const char *impl, size_type n, bool with_exact) {
+			unsigned long bytes = 0, max_bytes = 0, exact = 0, exact_max = 0;
+			double error = 0.0;
+			for(size_type k = 0; k < TREES; k++) {
+				Tree t;
+				make_tree(t, n, k + 1);
+				Sketch s = aggregate<Sketch>(t, bytes, max_bytes);
+				double d = t.counts[0].size();
+				error += fabs(s.estimate() - d) / d;
+				exact_bytes(t, sizeof(Measurement), exact, exact_max);
+			}
+			if(with_exact) { report("distinct", "exact", n, exact, exact_max, 0.0); }
+			report("distinct", impl, n, bytes, max_bytes, error / TREES);
+		}
+
+		template<typename Sketch>
+		void run_topk(const char *impl, size_type n, bool with_exact) {
+			unsigned long bytes = 0, max_bytes = 0, exact = 0, exact_max = 0;
+			double error = 0.0;
+			for(size_type k = 0; k < TREES; k++) {
+				Tree t;
+				make_tree(t, n, k + 1);
+				Sketch s = aggregate<Sketch>(t, bytes, max_bytes);
+				Counts &c = t.counts[0];
+
+				std::vector<Measurement> top;
+				for(size_type i = 0; i < s.top_size(); i++) {
+					top.push_back(s.top(i));
+				}
+				error += topk_error(c, top, 4);
+				exact_bytes(t, sizeof(Measurement) + sizeof(::uint16_t), exact, exact_max);
+			}
+			if(with_exact) { report("topk", "exact", n, exact, exact_max, 0.0); }
+			report("topk", impl, n, bytes, max_bytes, error / TREES);
+		}
+
+		template<typename Sketch>
+		void run_quantiles(const char *impl, size_type n, bool with_exact) {
+			unsigned long bytes = 0, max_bytes = 0, exact = 0, exact_max = 0;
+			double error = 0.0;
+			for(size_type k = 0; k < TREES; k++) {
+				Tree t;
+				make_tree(t, n, k + 1);
+				Sketch s = aggregate<Sketch>(t, bytes, max_bytes);
+				Counts &c = t.counts[0];
+				double total = (double)n * READINGS;
+
+				double e = 0.0;
+				for(size_type i = 0; i < QUANTILES; i++) {
+					double d = rank_error(c, total, qs[i], s.quantile(qs[i]));
+					if(d > e) { e = d; }
+				}
+				error += e;
+				exact_bytes(t, sizeof(Measurement) + sizeof(::uint16_t), exact, exact_max);
+			}
+			if(with_exact) { report("quantiles", "exact", n, exact, exact_max, 0.0); }
+			report("quantiles", impl, n, bytes, max_bytes, error / TREES);
+		}
+
+		// }}}
+		// {{{ INQP
+
+		struct InqpResult {
+			unsigned long count;
+			unsigned long distinct;
+			std::vector<Measurement> top;
+			Value quantiles[QUANTILES];
+		};
+
+		/**
+		 * Aggregate operator for COUNT, COUNT_DISTINCT, TOP_K and
+		 * QUANTILE of one column of type @a type.
+		 */
+		void setup(AggregateT& op, Processor::Query& query, int type) {
+			block_data_t description[32];
+			memset(description, 0, sizeof(description));
+			description[AD::OFFSET_TYPE] = 'a';
+			description[AD::OFFSET_COLUMNS] = 4;
+			description[AD::OFFSET_AGGREGATION_METHODS] = AD::COUNT | AD::AGAIN;
+			description[AD::OFFSET_AGGREGATION_METHODS + 1] = AD::COUNT_DISTINCT | AD::AGAIN;
+			description[AD::OFFSET_AGGREGATION_METHODS + 2] = AD::TOP_K | AD::AGAIN;
+			description[AD::OFFSET_AGGREGATION_METHODS + 3] = AD::QUANTILE;
+			op.init(reinterpret_cast<AD*>(description), &query);
+			input_ = ProjectionInfo<Os>(type);
+			op.set_projection_info(AggregateT::Base::CHILD_LEFT, input_);
+		}
+
+		/**
+		 * End the input of @a op, it sends its groups.
+		 * @return The row sent.
+		 */
+		RowT& send(AggregateT& op, Processor& processor) {
+			RowT *end_of_input = 0;
+			op.push(0, *end_of_input);
+			op.on_sending_time(processor.timer().userdata_);
+			return *reinterpret_cast<RowT*>(&processor.rows_[0][0]);
+		}
+
+		void destruct(AggregateT& op, Processor& processor) {
+			void *timer_info = processor.timer().userdata_;
+			op.destruct();
+			// frees the timer info
+			op.on_sending_time(timer_info);
+		}
+
+		/**
+		 * Run the aggregate operator of node @a i of @a t, children's
+		 * rows in @a sent, its own rows are added.
+		 */
+		void run_node(Tree& t, size_type i, std::vector<Processor>& sent, InqpResult& r) {
+			Processor &processor = sent[i];
+			Processor::Query query(&processor);
+			AggregateT op;
+			setup(op, query, ProjectionInfoBase::INTEGER);
+
+			for(size_type c = 0; c < t.children[i].size(); c++) {
+				std::vector<std::vector<Value> > &rows = sent[t.children[i][c]].rows_;
+				for(size_type r = 0; r < rows.size(); r++) {
+					op.on_receive_row(*reinterpret_cast<RowT*>(&rows[r][0]), t.children[i][c]);
+				}
+			}
+
+			RowT *row = RowT::create(1);
+			for(size_type j = 0; j < READINGS; j++) {
+				(*row)[0] = t.readings[i][j];
+				op.push(0, *row);
+			}
+			row->destroy();
+
+			RowT &result = send(op, processor);
+			r.count = result[0];
+			r.distinct = op.count_distinct(result, 1);
+			Value top[INQP_AGGREGATE_TOP_K];
+			r.top.assign(top, top + op.top_k(result, 2, top));
+			for(size_type j = 0; j < QUANTILES; j++) {
+				r.quantiles[j] = op.quantile(result, 3, qs[j]);
+			}
+			destruct(op, processor);
+		}
+
+		void run_inqp(size_type n) {
+			unsigned long bytes = 0, max_bytes = 0;
+			double distinct_error = 0.0, top_error = 0.0, quantile_error = 0.0;
+			for(size_type k = 0; k < TREES; k++) {
+				Tree t;
+				make_tree(t, n, k + 1);
+				std::vector<Processor> sent(n);
+				InqpResult r;
+				bytes = 0;
+				max_bytes = 0;
+				for(size_type i = n; i-- > 0; ) {
+					run_node(t, i, sent, r);
+					if(sent[i].rows_.size() != 1) { fail("inqp rows"); }
+					unsigned long b = sent[i].rows_[0].size() * sizeof(Value);
+					if(i) {
+						bytes += b;
+						if(b > max_bytes) { max_bytes = b; }
+					}
+				}
+				if(r.count != n * READINGS) { fail("inqp count"); }
+				Counts &c = t.counts[0];
+				double d = c.size();
+				distinct_error += fabs(r.distinct - d) / d;
+				top_error += topk_error(c, r.top, INQP_AGGREGATE_TOP_K);
+				double e = 0.0;
+				for(size_type j = 0; j < QUANTILES; j++) {
+					double q = rank_error(c, r.count, qs[j], r.quantiles[j]);
+					if(q > e) { e = q; }
+				}
+				quantile_error += e;
+			}
+			report("inqp", "count_distinct", n, bytes, max_bytes, distinct_error / TREES);
+			report("inqp", "top_k", n, bytes, max_bytes, top_error / TREES);
+			report("inqp", "quantile", n, bytes, max_bytes, quantile_error / TREES);
+		}
+
+		/**
+		 * @a x as value of a column of type @a type (FLOAT: x + 0.5).
+		 */
+		Value inqp_value(int type, int x) {
+			if(type == ProjectionInfoBase::FLOAT) {
+				float f = x + 0.5f;
+				Value v;
+				memcpy(&v, &f, sizeof(v));
+				return v;
+			}
+			return (Value)(::int32_t)x;
+		}
+
+		double inqp_number(int type, Value v) {
+			if(type == ProjectionInfoBase::FLOAT) {
+				float f;
+				memcpy(&f, &v, sizeof(f));
+				return f;
+			}
+			return (::int32_t)v;
+		}
+
+		/**
+		 * TOP_K and QUANTILE of signed INTEGER and FLOAT columns: -10
+		 * to 9 and 10 more 3s.
+		 */
+		void check_inqp() {
+			static const int types[] = { ProjectionInfoBase::INTEGER, ProjectionInfoBase::FLOAT };
+			for(size_type t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+				Processor processor;
+				Processor::Query query(&processor);
+				AggregateT op;
+				setup(op, query, types[t]);
+				RowT *row = RowT::create(1);
+				for(int i = -10; i < 20; i++) {
+					(*row)[0] = inqp_value(types[t], (i < 10) ? i : 3);
+					op.push(0, *row);
+				}
+				row->destroy();
+
+				RowT &result = send(op, processor);
+				if(result[0] != 30) { fail("inqp count"); }
+				Value top[INQP_AGGREGATE_TOP_K];
+				::uint16_t counts[INQP_AGGREGATE_TOP_K];
+				if(op.top_k(result, 2, top, counts) < 1 || top[0] != inqp_value(types[t], 3) || counts[0] < 11) {
+					fail("inqp top_k");
+				}
+				double q10 = inqp_number(types[t], op.quantile(result, 3, 0.1));
+				double q50 = inqp_number(types[t], op.quantile(result, 3, 0.5));
+				double q90 = inqp_number(types[t], op.quantile(result, 3, 0.9));
+				if(!(q10 < 0.0 && q10 <= q50 && q50 <= q90 && q90 > 0.0)) { fail("inqp quantile order"); }
+				destruct(op, processor);
+			}
+		}
+
+		// }}}
+
+		void report(const char *aggregate, const char *impl, size_type n, unsigned long bytes, unsigned long max_bytes, double error) {
+			debug_->debug("%s %s %lu %lu %lu %.4f", aggregate, impl, (unsigned long)n, bytes, max_bytes, error);
+		}
+
+		// {{{ Checks
+
+		template<typename Sketch>
+		bool same_encoding(Sketch& a, Sketch& b) {
+			block_data_t ba[MAX_SUMMARY_SIZE], bb[MAX_SUMMARY_SIZE];
+			if(a.size() != b.size()) { return false; }
+			a.writeTo(ba);
+			b.writeTo(bb);
+			return memcmp(ba, bb, a.size()) == 0;
+		}
+
+		template<typename Sketch>
+		Sketch round_trip(Sketch& s) {
+			block_data_t buffer[MAX_SUMMARY_SIZE];
+			s.writeTo(buffer);
+			return Sketch(buffer);
+		}
+
+		void check() {
+			typedef HyperLogLog<Os, 8> Hll;
+			Hll empty, all, a, b;
+			if(empty.estimate() != 0) { fail("hll empty"); }
+			for(::uint32_t i = 0; i < 10000; i++) {
+				all.insert(i);
+				((i & 1) ? a : b).insert(i);
+			}
+			Hll ab = a.combine(b);
+			if(!same_encoding(ab, all)) { fail("hll merge"); }
+			Hll r = round_trip(all);
+			if(!same_encoding(r, all)) { fail("hll round trip"); }
+			if(fabs(all.estimate() - 10000.0) > 2000.0) { fail("hll estimate"); }
+			Hll small;
+			for(::uint32_t i = 0; i < 20; i++) { small.insert(i); }
+			if(fabs(small.estimate() - 20.0) > 3.0) { fail("hll small range"); }
+
+			typedef CountMinSketch<Os, Measurement, 32, 3, 4> Cm;
+			Cm cm1, cm2;
+			Counts exact;
+			for(size_type i = 0; i < 2000; i++) {
+				Measurement v = measure();
+				((i & 1) ? cm1 : cm2).insert(v);
+				exact[v]++;
+			}
+			Cm cm = cm1.combine(cm2);
+			for(Counts::iterator it = exact.begin(); it != exact.end(); ++it) {
+				if(cm.estimate(it->first) < it->second) { fail("countmin underestimates"); }
+			}
+			// the most frequent rank 0 value is 0
+			if(cm.get() != 0) { fail("countmin top"); }
+			Cm cmr = round_trip(cm);
+			if(!same_encoding(cmr, cm)) { fail("countmin round trip"); }
+
+			typedef KllSketch<Os, Measurement, 16> Kll;
+			Kll k1, k2;
+			for(size_type i = 0; i < 20000; i++) {
+				Measurement v = (i * 7919) % 20000;
+				((i % 3) ? k1 : k2).insert(v);
+			}
+			Kll k = k1.combine(k2);
+			if(k.count() != 20000) { fail("kll count"); }
+			for(float q = 0.1; q < 0.95; q += 0.2) {
+				if(fabs(k.quantile(q) - q * 20000) > 0.1 * 20000) { fail("kll quantile"); }
+				if(fabs(k.rank((Measurement)(q * 20000)) - q * 20000) > 0.1 * 20000) { fail("kll rank"); }
+			}
+			if(k.size() > Kll::MAX_SIZE) { fail("kll size"); }
+			Kll kr = round_trip(k);
+			if(!same_encoding(kr, k) || kr.quantile(0.5) != k.quantile(0.5)) { fail("kll round trip"); }
+		}
+
+		void fail(const char *what) {
+			debug_->debug("%s check failed", what);
+			exit(1);
+		}
+
+		// }}}
+
+		std::vector<double> zipf_;
+		ProjectionInfo<Os> input_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,487 @@
+/*
+ * Starting a tuple store from a memory mapped snapshot (SnapshotFile)
+ * against re-loading the RDF data.
+ *
+ * The input (gzipped or not) is repeated the given number of times,
+ * every URI getting a per-copy suffix so copies do not share terms, and
+ * written to a temporary file, which is bulk loaded (N3BulkLoader) into
+ * a TupleStore with HashDictionary once to write the snapshot. Then
+ *  - reload: the file is bulk loaded again,
+ *  - snapshot: the snapshot is opened (mmap, nothing is decoded)
+ * and the same pattern lookups (every combination of bound columns,
+ * constants taken from a sample of the tuples) are run on both. Before
+ * timing, both have to give the same results for all of them.
+ *
+ * Output:
+ *  input copies tuples impl startup_s heap_bytes file_bytes rss_bytes
+ *    startup_s: load / open time, heap_bytes: memory allocated by
+ *    dictionary and container, file_bytes: size of the file loaded /
+ *    mapped, rss_bytes: growth of the resident set by startup and
+ *    running every lookup once (for the snapshot the pages the lookups
+ *    touched, for reload this misses heap memory freed by earlier runs,
+ *    see heap_bytes)
+ *  input copies pattern impl queries results us_per_query
+ *
+ * Usage: snapshot_benchmark [file.nq[.gz] ...]
+ *   (default: ../hash_test/data-0.nq.gz)
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::block_data_t block_data_t;
+	typedef Os::size_t size_type;
+
+	// Enable dynamic memory allocation using malloc() & free()
+	#include "util/allocators/malloc_free_allocator.h"
+	typedef MallocFreeAllocator<Os> Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <util/tuple_store/tuplestore.h>
+#include <util/tuple_store/hash_dictionary.h>
+#include <util/tuple_store/n3_bulk_loader.h>
+#include <util/tuple_store/snapshot_file.h>
+
+/**
+ * Triple of dictionary keys as wide as pointers.
+ */
+class TupleT {
+	public:
+		enum { SIZE = 3 };
+
+		TupleT() { for(size_type i = 0; i < SIZE; i++) { data_[i] = 0; } }
+
+		block_data_t* get(size_type i) { return reinterpret_cast<block_data_t*>(data_[i]); }
+		void set(size_type i, block_data_t* data) { data_[i] = reinterpret_cast<unsigned long>(data); }
+		size_type length(size_type i) { return get(i) ? strlen((char*)get(i)) : 0; }
+
+		void set_deep(size_type i, block_data_t* data) {
+			size_type l = strlen((char*)data) + 1;
+			set(i, ::get_allocator().allocate_array<block_data_t>(l).raw());
+			memcpy(get(i), data, l);
+		}
+		void free_deep(size_type i) {
+			if(get(i)) { ::get_allocator().free_array(get(i)); }
+			set(i, 0);
+		}
+		void destruct_deep() { for(size_type i = 0; i < SIZE; i++) { free_deep(i); } }
+
+		void set_key(size_type i, unsigned long k) { data_[i] = k; }
+		unsigned long get_key(size_type i) const { return data_[i]; }
+
+		static int compare(int col, ::uint8_t *a, int alen, ::uint8_t *b, int blen) {
+			if(alen != blen) { return blen - alen; }
+			return memcmp(a, b, alen);
+		}
+
+		bool operator==(const TupleT& other) const {
+			return data_[0] == other.data_[0] && data_[1] == other.data_[1] && data_[2] == other.data_[2];
+		}
+
+		bool operator<(const TupleT& other) const {
+			for(size_type i = 0; i < SIZE; i++) {
+				if(data_[i] != other.data_[i]) { return data_[i] < other.data_[i]; }
+			}
+			return false;
+		}
+
+	private:
+		unsigned long data_[SIZE];
+};
+
+/**
+ * Tuple container on std::set, the tuple store assumes a container that
+ * holds every tuple only once. Lookups are scans as for any container
+ * without a TupleStore_detail::Lookup.
+ */
+class TupleContainer {
+	public:
+		typedef TupleT value_type;
+		typedef ::size_type size_type;
+		typedef std::set<TupleT> set_t;
+
+		/**
+		 * The tuple store wants non-const tuples, it does not change
+		 * their keys though.
+		 */
+		class iterator {
+			public:
+				iterator() { }
+				iterator(set_t::iterator it) : it_(it) { }
+
+				TupleT& operator*() { return const_cast<TupleT&>(*it_); }
+				TupleT* operator->() { return &operator*(); }
+				iterator& operator++() { ++it_; return *this; }
+				bool operator==(const iterator& other) const { return it_ == other.it_; }
+				bool operator!=(const iterator& other) const { return it_ != other.it_; }
+
+				set_t::iterator it_;
+		};
+
+		iterator begin() { return s_.begin(); }
+		iterator end() { return s_.end(); }
+		size_type size() { return s_.size(); }
+		bool empty() { return s_.empty(); }
+		void clear() { s_.clear(); }
+
+		iterator insert(const TupleT& t) { return s_.insert(t).first; }
+		iterator erase(iterator it) { return s_.erase(it.it_); }
+		iterator find(TupleT& t) { return s_.find(t); }
+
+		/// Approximately, a tree node is a tuple, three pointers and the
+		/// color.
+		size_type memory() { return s_.size() * (sizeof(TupleT) + 4 * sizeof(void*)); }
+
+	private:
+		set_t s_;
+};
+
+typedef HashDictionary<Os> Dictionary;
+typedef TupleStore<Os, TupleContainer, Dictionary, Os::Debug, BIN(111), &TupleT::compare> TupleStoreT;
+
+typedef SnapshotFile<Os, TupleT> Snapshot;
+typedef TupleStore<Os, Snapshot::Container, Snapshot::Dictionary, Os::Debug, BIN(111), &TupleT::compare> SnapshotStoreT;
+
+/**
+ * A tuple store bulk loaded from a file.
+ */
+struct Store {
+	Store(Os::Debug::self_pointer_t debug) {
+		dictionary.init(debug);
+		tuple_store.init(&dictionary, &container, debug);
+	}
+
+	~Store() {
+		container.clear();
+	}
+
+	void load(const char *path) {
+		N3BulkLoader<Os, TupleStoreT> loader;
+		loader.init(&tuple_store);
+		loader.load(path);
+	}
+
+	size_type memory() { return dictionary.memory() + container.memory(); }
+
+	Dictionary dictionary;
+	TupleContainer container;
+	TupleStoreT tuple_store;
+};
+
+/**
+ * A tuple store on a snapshot.
+ */
+struct SnapshotStore {
+	SnapshotStore(Os::Debug::self_pointer_t debug) : debug_(debug) {
+	}
+
+	bool open(const char *path) {
+		if(snapshot.open(path) != Os::SUCCESS) { return false; }
+		snapshot.dictionary().init(debug_);
+		tuple_store.init(&snapshot.dictionary(), &snapshot.container(), debug_);
+		return true;
+	}
+
+	size_type memory() { return snapshot.dictionary().memory(); }
+
+	Snapshot snapshot;
+	SnapshotStoreT tuple_store;
+	Os::Debug::self_pointer_t debug_;
+};
+
+/**
+ * Bound columns and constants of a lookup.
+ */
+struct Pattern {
+	size_type mask;
+	std::string value[3];
+};
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			size_type n_files = (amp.argc > 1) ? amp.argc - 1 : 1;
+			for(size_type f = 0; f < n_files; f++) {
+				const char *path = (amp.argc > 1) ? amp.argv[f + 1] : "../hash_test/data-0.nq.gz";
+				if(!read(path)) {
+					debug_->debug("could not read %s", path);
+					continue;
+				}
+				static const size_type copies[] = { 1, 4 };
+				for(size_type c = 0; c < sizeof(copies) / sizeof(copies[0]); c++) {
+					if(!write(copies[c])) {
+						debug_->debug("could not write temporary file");
+						exit(1);
+					}
+					prepare();
+
+					debug_->debug("# input copies tuples impl startup_s heap_bytes file_bytes rss_bytes");
+					run_reload(path);
+					run_snapshot(path);
+
+					debug_->debug("# input copies pattern impl queries results us_per_query");
+					for(size_type m = 0; m < 8; m++) {
+						lookups<Store>(path, m, "reload");
+						lookups<SnapshotStore>(path, m, "snapshot");
+					}
+					unlink(tmp_);
+					unlink(snapshot_);
+				}
+			}
+		}
+
+	private:
+		double now() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec + ts.tv_nsec / 1e9;
+		}
+
+		/// Resident set size in bytes.
+		long rss() {
+			long pages = 0, resident = 0;
+			FILE *f = fopen("/proc/self/statm", "r");
+			if(f) {
+				if(fscanf(f, "%ld %ld", &pages, &resident) != 2) { resident = 0; }
+				fclose(f);
+			}
+			return resident * sysconf(_SC_PAGESIZE);
+		}
+
+		long file_size(const char *path) {
+			struct stat st;
+			return (stat(path, &st) == 0) ? (long)st.st_size : 0;
+		}
+
+		bool read(const char *path) {
+			std::string cmd = std::string("gzip -dcf '") + path + "'";
+			FILE *f = popen(cmd.c_str(), "r");
+			if(!f) { return false; }
+			input_.clear();
+			char buffer[65536];
+			for(size_t n; (n = fread(buffer, 1, sizeof(buffer), f)) > 0; ) {
+				input_.insert(input_.end(), buffer, buffer + n);
+			}
+			return pclose(f) == 0 && !input_.empty();
+		}
+
+		/**
+		 * Write the given number of copies of the input to a temporary
+		 * file.
+		 */
+		bool write(size_type copies) {
+			strcpy(tmp_, "/tmp/snapshot_benchmark_XXXXXX");
+			int fd = mkstemp(tmp_);
+			if(fd < 0) { return false; }
+			FILE *f = fdopen(fd, "w");
+			fwrite(&input_[0], 1, input_.size(), f);
+			for(size_type c = 1; c < copies; c++) {
+				char suffix[32];
+				snprintf(suffix, sizeof(suffix), "~%lu>", (unsigned long)c);
+				for(size_type i = 0; i < input_.size(); i++) {
+					if(input_[i] == '>') { fputs(suffix, f); }
+					else { fputc(input_[i], f); }
+				}
+			}
+			copies_ = copies;
+			snprintf(snapshot_, sizeof(snapshot_), "%s.snapshot", tmp_);
+			return fclose(f) == 0;
+		}
+
+		/**
+		 * Load the input, write the snapshot, take the sample of
+		 * patterns and check the snapshot against the loaded store.
+		 */
+		void prepare() {
+			Store store(debug_);
+			store.load(tmp_);
+			if(Snapshot::write(store.tuple_store, snapshot_) != Os::SUCCESS) { fail("writing"); }
+
+			SnapshotStore snapshot(debug_);
+			if(!snapshot.open(snapshot_)) { fail("opening"); }
+
+			// constants from every 64th tuple (at most 256 of them)
+			samples_.clear();
+			size_type n = store.tuple_store.size();
+			size_type step = (n / 64 > 256) ? n / 256 : 64;
+			size_type i = 0;
+			for(TupleStoreT::iterator it = store.tuple_store.begin(); it != store.tuple_store.end(); ++it, i++) {
+				if(i % step) { continue; }
+				Pattern p;
+				for(size_type j = 0; j < 3; j++) { p.value[j] = (char*)it->get(j); }
+				samples_.push_back(p);
+			}
+
+			check(store, snapshot);
+		}
+
+		void run_reload(const char *path) {
+			long r = rss();
+			double t = now();
+			Store store(debug_);
+			store.load(tmp_);
+			t = now() - t;
+			run_all(store);
+			debug_->debug("%s %lu %lu reload %.6f %lu %ld %ld", path, (unsigned long)copies_,
+					(unsigned long)store.tuple_store.size(), t, (unsigned long)store.memory(),
+					file_size(tmp_), rss() - r);
+		}
+
+		void run_snapshot(const char *path) {
+			long r = rss();
+			double t = now();
+			SnapshotStore store(debug_);
+			if(!store.open(snapshot_)) { fail("opening"); }
+			t = now() - t;
+			run_all(store);
+			debug_->debug("%s %lu %lu snapshot %.6f %lu %ld %ld", path, (unsigned long)copies_,
+					(unsigned long)store.tuple_store.size(), t, (unsigned long)store.memory(),
+					(long)store.snapshot.size(), rss() - r);
+		}
+
+		/**
+		 * Run every lookup once.
+		 */
+		template<typename StoreT>
+		void run_all(StoreT& store) {
+			for(size_type m = 0; m < 8; m++) {
+				size_type n = m ? samples_.size() : 1;
+				for(size_type i = 0; i < n; i++) {
+					count(store.tuple_store, samples_[i], m);
+				}
+			}
+		}
+
+		template<typename StoreT>
+		void lookups(const char *path, size_type mask, const char *impl) {
+			StoreT store(debug_);
+			open(store);
+
+			// the full scan only once
+			size_type queries = mask ? samples_.size() : 1;
+			unsigned long results = 0;
+			double t = now();
+			for(size_type i = 0; i < queries; i++) {
+				results += count(store.tuple_store, samples_[i], mask);
+			}
+			t = now() - t;
+
+			static const char *patterns[] = { "all", "s", "p", "sp", "o", "so", "po", "spo" };
+			debug_->debug("%s %lu %s %s %lu %lu %.3f", path, (unsigned long)copies_, patterns[mask], impl,
+					(unsigned long)queries, results, t * 1e6 / queries);
+		}
+
+		void open(Store& store) { store.load(tmp_); }
+		void open(SnapshotStore& store) {
+			if(!store.open(snapshot_)) { fail("opening"); }
+		}
+
+		template<typename TS>
+		unsigned long count(TS& ts, Pattern& p, size_type mask) {
+			TupleT query;
+			for(size_type j = 0; j < 3; j++) { query.set(j, (block_data_t*)p.value[j].c_str()); }
+			unsigned long n = 0;
+			typename TS::iterator end = ts.end();
+			for(typename TS::iterator it = ts.begin(&query, mask); it != end; ++it) {
+				n++;
+			}
+			return n;
+		}
+
+		template<typename TS>
+		void results(TS& ts, Pattern& p, size_type mask, std::vector<std::string>& r) {
+			TupleT query;
+			for(size_type j = 0; j < 3; j++) { query.set(j, (block_data_t*)p.value[j].c_str()); }
+			r.clear();
+			typename TS::iterator end = ts.end();
+			for(typename TS::iterator it = ts.begin(&query, mask); it != end; ++it) {
+				std::string s;
+				for(size_type j = 0; j < 3; j++) {
+					s += (char*)it->get(j);
+					s += '\t';
+				}
+				r.push_back(s);
+			}
+			std::sort(r.begin(), r.end());
+		}
+
+		void check(Store& store, SnapshotStore& snapshot) {
+			if(store.tuple_store.size() != snapshot.tuple_store.size()) { fail("size"); }
+			if(store.dictionary.size() != snapshot.snapshot.dictionary().size()) { fail("dictionary size"); }
+
+			std::vector<std::string> a, b;
+			for(size_type m = 0; m < 8; m++) {
+				// the full scan only once
+				size_type n = m ? samples_.size() : 1;
+				for(size_type i = 0; i < n; i++) {
+					results(store.tuple_store, samples_[i], m, a);
+					results(snapshot.tuple_store, samples_[i], m, b);
+					if(a.empty() || a != b) { fail("lookup"); }
+				}
+			}
+
+			// strings that are not there, in front of, between and
+			// after the others
+			static const char *missing[] = { "", "<", "<http://nektar.oszk.hu/data/auth/magyar_irodalom>~", "\xff" };
+			for(size_type i = 0; i < sizeof(missing) / sizeof(missing[0]); i++) {
+				Pattern p;
+				p.value[0] = p.value[1] = p.value[2] = missing[i];
+				for(size_type m = 1; m < 8; m++) {
+					if(count(snapshot.tuple_store, p, m) != 0) { fail("missing string"); }
+				}
+			}
+
+			// every string resolves to its own key
+			Snapshot::Dictionary &d = snapshot.snapshot.dictionary();
+			for(Snapshot::Dictionary::iterator it = d.begin_keys(); it != d.end_keys(); ++it) {
+				std::string s = (char*)d.get_value(*it);
+				if(d.find((block_data_t*)s.c_str()) != *it) { fail("dictionary"); }
+			}
+		}
+
+		void fail(const char *what) {
+			debug_->debug("%s check failed (copies %lu)", what, (unsigned long)copies_);
+			exit(1);
+		}
+
+		std::vector<char> input_;
+		std::vector<Pattern> samples_;
+		char tmp_[64];
+		char snapshot_[80];
+		size_type copies_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,187 @@
+/*
+ * Sorting throughput of util/pstl/algorithm.h.
+ *
+ * Sorts (key, position) pairs by key with
+ *  - sort (introsort) and the previous heap_sort,
+ *  - stable_sort with a scratch buffer of n / 2 elements, without any
+ *    buffer and the previous insertion_sort (only up to 10^4 elements),
+ *  - inplace_merge of two sorted halves, with and without buffer,
+ *  - std::sort / std::stable_sort for reference,
+ * on random, sorted, reversed and few-unique (16 distinct keys) inputs.
+ * All results are checked for order, the stable variants also for
+ * stability.
+ *
+ * Usage: sort_benchmark [n ...]   (default: 10^3 10^4 10^5 10^6)
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::size_t size_type;
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <util/pstl/algorithm.h>
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+struct Entry {
+	::uint32_t key;
+	::uint32_t position;
+
+	bool operator<(const Entry& other) const { return key < other.key; }
+};
+
+struct CompareKey {
+	bool operator()(const Entry& a, const Entry& b) const { return a.key < b.key; }
+};
+
+class App {
+	// {{{
+	public:
+		enum Input { RANDOM, SORTED, REVERSED, FEW_UNIQUE, INPUTS };
+
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			std::vector<size_type> sizes;
+			for(int i = 1; i < amp.argc; i++) { sizes.push_back(atol(amp.argv[i])); }
+			if(sizes.empty()) {
+				sizes.push_back(1000);
+				sizes.push_back(10000);
+				sizes.push_back(100000);
+				sizes.push_back(1000000);
+			}
+
+			debug_->debug("# times in ms, - = skipped");
+			debug_->debug("# input n sort heap_sort std_sort stable_buf stable_nobuf insertion std_stable merge_buf merge_nobuf");
+			for(size_type i = 0; i < sizes.size(); i++) {
+				for(int input = RANDOM; input < INPUTS; input++) {
+					run((Input)input, sizes[i]);
+				}
+			}
+		}
+
+	private:
+		double now() {
+			timeval tv;
+			gettimeofday(&tv, 0);
+			return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+		}
+
+		void generate(Input input, size_type n) {
+			static const char *names[] = { "random", "sorted", "reversed", "few_unique" };
+			name_ = names[input];
+			srand(1);
+			input_.resize(n);
+			for(size_type i = 0; i < n; i++) {
+				Entry& e = input_[i];
+				e.position = i;
+				switch(input) {
+					case RANDOM: e.key = rand(); break;
+					case SORTED: e.key = i; break;
+					case REVERSED: e.key = n - i; break;
+					default: e.key = rand() % 16; break;
+				}
+			}
+		}
+
+		void check(const char *algorithm, bool stable) {
+			for(size_type i = 1; i < data_.size(); i++) {
+				if(data_[i].key < data_[i - 1].key ||
+						(stable && data_[i].key == data_[i - 1].key && data_[i].position < data_[i - 1].position)) {
+					debug_->debug("%s on %s: %s at %lu", algorithm, name_, stable ? "not sorted/stable" : "not sorted", (unsigned long)i);
+					exit(1);
+				}
+			}
+		}
+
+		template<typename F>
+		double measure(F f, const char *algorithm, bool stable) {
+			data_ = input_;
+			double t = now();
+			f(data_);
+			t = now() - t;
+			check(algorithm, stable);
+			return t;
+		}
+
+		static void wl_sort(std::vector<Entry>& v) { wiselib::sort(&v[0], &v[0] + v.size()); }
+		static void wl_heap_sort(std::vector<Entry>& v) { wiselib::heap_sort(&v[0], &v[0] + v.size(), CompareKey()); }
+		static void std_sort(std::vector<Entry>& v) { std::sort(v.begin(), v.end()); }
+		static void wl_stable_buf(std::vector<Entry>& v) {
+			std::vector<Entry> buffer(v.size() / 2 + 1);
+			wiselib::stable_sort(&v[0], &v[0] + v.size(), &buffer[0], (intptr_t)buffer.size(), CompareKey());
+		}
+		static void wl_stable(std::vector<Entry>& v) { wiselib::stable_sort(&v[0], &v[0] + v.size(), CompareKey()); }
+		static void wl_insertion(std::vector<Entry>& v) { wiselib::insertion_sort(&v[0], &v[0] + v.size(), CompareKey()); }
+		static void std_stable(std::vector<Entry>& v) { std::stable_sort(v.begin(), v.end()); }
+
+		/// Both halves get sorted before the measurement.
+		static void wl_merge_buf(std::vector<Entry>& v) {
+			std::vector<Entry> buffer(v.size() / 2 + 1);
+			wiselib::inplace_merge(&v[0], &v[0] + v.size() / 2, &v[0] + v.size(), &buffer[0], (intptr_t)buffer.size());
+		}
+		static void wl_merge(std::vector<Entry>& v) {
+			wiselib::inplace_merge(&v[0], &v[0] + v.size() / 2, &v[0] + v.size());
+		}
+
+		double merge(void (*f)(std::vector<Entry>&), const char *algorithm) {
+			data_ = input_;
+			std::stable_sort(data_.begin(), data_.begin() + data_.size() / 2);
+			std::stable_sort(data_.begin() + data_.size() / 2, data_.end());
+			double t = now();
+			f(data_);
+			t = now() - t;
+			check(algorithm, true);
+			return t;
+		}
+
+		void run(Input input, size_type n) {
+			generate(input, n);
+
+			double t_sort = measure(wl_sort, "sort", false);
+			double t_heap = measure(wl_heap_sort, "heap_sort", false);
+			double t_std = measure(std_sort, "std::sort", false);
+			double t_stable_buf = measure(wl_stable_buf, "stable_sort(buffer)", true);
+			double t_stable = measure(wl_stable, "stable_sort", true);
+			double t_std_stable = measure(std_stable, "std::stable_sort", true);
+			double t_merge_buf = merge(wl_merge_buf, "inplace_merge(buffer)");
+			double t_merge = merge(wl_merge, "inplace_merge");
+
+			char insertion[32] = "-";
+			if(n <= 10000) {
+				snprintf(insertion, sizeof(insertion), "%.2f", measure(wl_insertion, "insertion_sort", true));
+			}
+
+			debug_->debug("%s %lu %.2f %.2f %.2f %.2f %.2f %s %.2f %.2f %.2f",
+					name_, (unsigned long)n, t_sort, t_heap, t_std, t_stable_buf, t_stable,
+					insertion, t_std_stable, t_merge_buf, t_merge);
+		}
+
+		const char *name_;
+		std::vector<Entry> input_, data_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,328 @@
+/*
+ * Append / concatenation benchmark of string_dynamic.
+ *
+ * Workloads, each run for a number of target lengths n:
+ *  - push_back: build a string of n characters one by one
+ *  - path: append n/8 path segments ("/" and a 7 character name)
+ *  - ints: append_int() of numbers separated by spaces up to n characters
+ *    (debug formatting)
+ *  - split: split a query string of n characters at '&' into its
+ *    key=value parts, with substr() copies or with slices
+ *
+ * For comparison the same is done with the former string_dynamic
+ * (buffers reallocated to the exact size on every append, kept here as
+ * LegacyString) and std::string.
+ *
+ * Output: workload impl n ms allocations
+ * (ms for 2^20 characters in total, allocations of std::string are not
+ * counted)
+ *
+ * Usage: string_benchmark
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::size_t size_type;
+
+	#include "util/allocators/malloc_free_allocator.h"
+
+	/**
+	 * Counts the allocations.
+	 */
+	class CountingAllocator : public MallocFreeAllocator<Os> {
+		public:
+			typedef MallocFreeAllocator<Os> Base;
+			typedef CountingAllocator* self_pointer_t;
+
+			CountingAllocator() : allocations_(0) { }
+
+			template<typename T>
+			array_pointer_t<T> allocate_array(size_type n) {
+				allocations_++;
+				return Base::allocate_array<T>(n);
+			}
+
+			unsigned long allocations_;
+	};
+	typedef CountingAllocator Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <string>
+#include <vector>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/pstl/string_dynamic.h>
+
+typedef string_dynamic<Os, Allocator> String;
+
+/**
+ * The former string_dynamic append strategy: a new buffer of exactly the
+ * new size on every append.
+ */
+class LegacyString {
+	public:
+		typedef Allocator::array_pointer_t<char> buffer_t;
+
+		LegacyString() : buffer_(0), size_(0) { }
+		LegacyString(const char *s, size_type n) : buffer_(0), size_(0) { append(s, n); }
+		~LegacyString() { if(buffer_) { get_allocator().free_array(buffer_); } }
+
+		LegacyString& append(const char *s, size_type n) {
+			buffer_t old = buffer_;
+			buffer_ = get_allocator().allocate_array<char>(size_ + n + 1);
+			if(old) { memcpy(buffer_.raw(), old.raw(), size_); }
+			memcpy(buffer_.raw() + size_, s, n);
+			size_ += n;
+			buffer_[size_] = '\0';
+			if(old) { get_allocator().free_array(old); }
+			return *this;
+		}
+
+		LegacyString& append(const char *s) {
+			// like before: via a temporary copy
+			LegacyString tmp(s, strlen(s));
+			return append(tmp.buffer_.raw(), tmp.size_);
+		}
+
+		LegacyString& push_back(char c) { return append(&c, 1); }
+
+		void append_int(long i) {
+			char buf[24];
+			int l = snprintf(buf, sizeof(buf), "%ld", i);
+			for(int j = 0; j < l; j++) { push_back(buf[j]); }
+		}
+
+		LegacyString substr(size_type from, size_type n) const { return LegacyString(buffer_.raw() + from, n); }
+		int first_index_of(char c, size_type from) const {
+			for(size_type i = from; i < size_; i++) { if(buffer_[i] == c) { return i; } }
+			return -1;
+		}
+		size_type size() const { return size_; }
+		const char* c_str() const { return buffer_.raw(); }
+
+	private:
+		LegacyString(const LegacyString&);
+		buffer_t buffer_;
+		size_type size_;
+};
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			check();
+
+			debug_->debug("# workload impl n ms allocations");
+			static const size_type ns[] = { 16, 256, 4096, 65536 };
+			for(size_type i = 0; i < sizeof(ns) / sizeof(ns[0]); i++) {
+				size_type n = ns[i];
+				size_type reps = (1 << 20) / n;
+				run_push_back<String>("string_dynamic", n, reps);
+				run_push_back<LegacyString>("legacy", n, reps);
+				run_push_back<std::string>("std::string", n, reps);
+
+				run_path<String>("string_dynamic", n, reps);
+				run_path<LegacyString>("legacy", n, reps);
+				run_path<std::string>("std::string", n, reps);
+
+				run_ints<String>("string_dynamic", n, reps);
+				run_ints<LegacyString>("legacy", n, reps);
+
+				run_split(n, reps);
+			}
+		}
+
+	private:
+		double now() {
+			timeval tv;
+			gettimeofday(&tv, 0);
+			return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+		}
+
+		void start() {
+			allocations_ = get_allocator().allocations_;
+			t_ = now();
+		}
+
+		void stop(const char *workload, const char *impl, size_type n) {
+			double t = now() - t_;
+			debug_->debug("%s %s %lu %.2f %lu", workload, impl, (unsigned long)n, t,
+					get_allocator().allocations_ - allocations_);
+		}
+
+		template<typename S>
+		void run_push_back(const char *impl, size_type n, size_type reps) {
+			start();
+			for(size_type r = 0; r < reps; r++) {
+				S s;
+				for(size_type i = 0; i < n; i++) { s.push_back('a' + (i % 26)); }
+				sink_ += s.size();
+			}
+			stop("push_back", impl, n);
+		}
+
+		template<typename S>
+		void run_path(const char *impl, size_type n, size_type reps) {
+			start();
+			for(size_type r = 0; r < reps; r++) {
+				S s;
+				for(size_type i = 0; i < n / 8; i++) {
+					s.append("/");
+					s.append("segment");
+				}
+				sink_ += s.size();
+			}
+			stop("path", impl, n);
+		}
+
+		template<typename S>
+		void run_ints(const char *impl, size_type n, size_type reps) {
+			start();
+			for(size_type r = 0; r < reps; r++) {
+				S s;
+				for(long i = 0; s.size() < n; i++) {
+					s.append_int(i * 7919);
+					s.push_back(' ');
+				}
+				sink_ += s.size();
+			}
+			stop("ints", impl, n);
+		}
+
+		/**
+		 * "k0=v0&k1=v1&..." of about n characters.
+		 */
+		void make_query(size_type n, String& q) {
+			q.clear();
+			for(long i = 0; q.size() < n; i++) {
+				if(i) { q.push_back('&'); }
+				q.append("key");
+				q.append_int(i);
+				q.push_back('=');
+				q.append_int(i * 31);
+			}
+		}
+
+		void run_split(size_type n, size_type reps) {
+			String q;
+			make_query(n, q);
+
+			// substr() copies
+			start();
+			for(size_type r = 0; r < reps; r++) {
+				size_type from = 0;
+				for(int i; (i = q.slice(from).first_index_of('&')) >= 0; from += i + 1) {
+					String part = q.substr(from, i);
+					sink_ += part.size();
+				}
+				sink_ += q.size() - from;
+			}
+			stop("split", "string_dynamic-substr", n);
+
+			LegacyString lq(q.c_str(), q.size());
+			start();
+			for(size_type r = 0; r < reps; r++) {
+				size_type from = 0;
+				for(int i; (i = lq.first_index_of('&', from)) >= 0; from = i + 1) {
+					LegacyString part = lq.substr(from, i - from);
+					sink_ += part.size();
+				}
+				sink_ += lq.size() - from;
+			}
+			stop("split", "legacy-substr", n);
+
+			// slices
+			start();
+			for(size_type r = 0; r < reps; r++) {
+				String::slice_type rest = q.slice();
+				for(int i; (i = rest.first_index_of('&')) >= 0; ) {
+					String::slice_type part = rest.substr(0, i);
+					sink_ += part.size();
+					rest.remove_prefix(i + 1);
+				}
+				sink_ += rest.size();
+			}
+			stop("split", "string_dynamic-slice", n);
+		}
+
+		void check() {
+			String s;
+			if(s.c_str()[0] != '\0' || s.size() != 0) { fail("empty string"); }
+			for(int i = 0; i < 1000; i++) { s.push_back('0' + i % 10); }
+			for(int i = 0; i < 1000; i++) {
+				if(s[i] != '0' + i % 10) { fail("push_back"); }
+			}
+			if(s.c_str()[1000] != '\0') { fail("terminator"); }
+
+			String t("abc");
+			t.append(t);
+			t.append(t.c_str() + 1, 2);
+			if(t != String("abcabcbc")) { fail("self append"); }
+			t += String("0123456789abcdef").slice(10, 3);
+			if(t != String("abcabcbcabc")) { fail("append slice"); }
+
+			String u;
+			u.append_int(0);
+			u.push_back(' ');
+			u.append_int(10);
+			u.push_back(' ');
+			u.append_int(-1234);
+			u.push_back(' ');
+			u.append_int(255, 16);
+			if(u != String("0 10 -1234 ff")) { fail("append_int"); }
+
+			String v = u.substr(2);
+			if(v != String("10 -1234 ff") || u.substr(2, 2) != String("10") || u.substr(0, 0).size() != 0) {
+				fail("substr");
+			}
+			if(v.slice(3).first_index_of(' ') != 5 || !v.slice().starts_with(String::slice_type("10 -"))) {
+				fail("slice");
+			}
+
+			String w = s;
+			w.resize(3);
+			w.shrink_to_fit();
+			if(w != String("012") || w.capacity() != String::INLINE_CAPACITY) { fail("shrink_to_fit"); }
+			w.reserve(100);
+			if(w.capacity() < 100 || w != String("012")) { fail("reserve"); }
+			w.clear();
+			if(!w.empty() || w.c_str()[0] != '\0') { fail("clear"); }
+		}
+
+		void fail(const char *what) {
+			debug_->debug("%s check failed", what);
+			exit(1);
+		}
+
+		double t_;
+		unsigned long allocations_;
+		unsigned long sink_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
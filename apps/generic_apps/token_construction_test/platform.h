@@ -105,6 +105,7 @@
 #define INSE_MAX_SEMANTIC_ENTITIES     4
 #define INSE_MAX_QUERIES               4
 #define INSE_BLOOM_FILTER_BITS        64
+#define INSE_BLOOM_FILTER_HASHES       3
 
 // Memory sizes, word sizes, tec..    
 
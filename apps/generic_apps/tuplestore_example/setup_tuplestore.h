@@ -50,8 +50,14 @@ class Tuple {
 		///@{
 		///@name Get/set string value
 		
+		// memcpy() instead of casting data_ + i to block_data_t**, the
+		// compiler may assume those never alias data_ (-fstrict-aliasing
+		// is on from -O2) and eg. read a pointer before Tuple() zeroed it.
+		
 		block_data_t* get(size_type i) {
-			return *reinterpret_cast<block_data_t**>(data_ + i);
+			block_data_t *r;
+			memcpy(&r, data_ + i, sizeof(r));
+			return r;
 		}
 		
 		size_type length(size_type i) {
@@ -60,7 +66,7 @@ class Tuple {
 		
 		void set(size_type i, block_data_t* data) {
 			data_[i] = 0;
-			*reinterpret_cast<block_data_t**>(data_ + i) = data;
+			memcpy(data_ + i, &data, sizeof(data));
 		}
 		
 		/// Convenience method.
@@ -81,13 +87,15 @@ class Tuple {
 		///@{
 		///@name Get/set dictionary key
 		
-		::uint32_t get_key(size_type i) const {
-			return *reinterpret_cast<const ::uint32_t*>(data_ + i);
+		// Keys of in-memory dictionaries are pointers, so use the full
+		// value_t here.
+		
+		value_t get_key(size_type i) const {
+			return data_[i];
 		}
 		
-		void set_key(size_type i, ::uint32_t k) {
-			data_[i] = 0;
-			*reinterpret_cast< ::uint32_t*>(data_ + i) = k;
+		void set_key(size_type i, value_t k) {
+			data_[i] = k;
 		}
 		
 		///@}
@@ -234,6 +242,12 @@ class Tuple {
 	#include <algorithms/block_memory/b_plus_dictionary.h>
 	typedef BPlusDictionary<Os, BlockAllocator, Hash> Dictionary;
 
+	/* Alternatively, BlockDictionary packs the strings into slotted pages
+	 * (one block each) and only uses the b-plus-tree for the hash index.
+	 */
+	//#include <util/tuple_store/block_dictionary.h>
+	//typedef BlockDictionary<Os, BlockAllocator, Hash> Dictionary;
+
 #endif // TS_USE_BLOCK_MEMORY
 
 
@@ -0,0 +1,405 @@
+/*
+ * Insert / erase / append benchmark of vector_static and vector_dynamic
+ * with message sized elements.
+ *
+ * Element types:
+ *  - message: 32 byte POD (moved with memmove)
+ *  - entry: 32 byte neighbor entry with user defined copy and move
+ *    (moved by assignment)
+ *
+ * Workloads, each for vectors of n elements:
+ *  - insert_erase: insert at and erase from random positions
+ *  - insert_range: insert n/4 elements in the middle, erase them again
+ *  - append: push_back() (copies) or emplace_back() n elements into an
+ *    empty vector_dynamic
+ * For comparison: the former element-by-element insert / erase (legacy,
+ * on vector_static) and std::vector.
+ *
+ * Also the number of allocations of filling and emptying a
+ * vector_dynamic under each shrink policy.
+ *
+ * Output: workload type impl n ns_per_op [copies_per_op]
+ *
+ * Usage: vector_benchmark
+ */
+
+// <general wiselib boilerplate>
+// {{{
+
+	#include "external_interface/external_interface.h"
+	#include "external_interface/external_interface_testing.h"
+	using namespace wiselib;
+	typedef OSMODEL Os;
+	typedef Os::size_t size_type;
+
+	#include "util/allocators/malloc_free_allocator.h"
+
+	/**
+	 * Counts the allocations.
+	 */
+	class CountingAllocator : public MallocFreeAllocator<Os> {
+		public:
+			typedef MallocFreeAllocator<Os> Base;
+			typedef CountingAllocator* self_pointer_t;
+
+			CountingAllocator() : allocations_(0) { }
+
+			template<typename T>
+			array_pointer_t<T> allocate_array(size_type n) {
+				allocations_++;
+				return Base::allocate_array<T>(n);
+			}
+
+			unsigned long allocations_;
+	};
+	typedef CountingAllocator Allocator;
+	Allocator& get_allocator();
+
+// }}}
+// </general wiselib boilerplate>
+
+#include <vector>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/pstl/vector_static.h>
+#include <util/pstl/vector_dynamic.h>
+
+struct Message {
+	::uint32_t source_;
+	::uint32_t target_;
+	::uint16_t type_;
+	::uint16_t length_;
+	::uint8_t payload_[20];
+
+	Message() { }
+	Message(::uint32_t source, ::uint32_t target) : source_(source), target_(target), type_(1), length_(0) { }
+
+	bool operator==(const Message& other) const { return source_ == other.source_ && target_ == other.target_; }
+};
+
+/**
+ * Neighbor entry with non-trivial copy (it checks that it is not moved
+ * around with memmove: self_ must point to the entry itself).
+ */
+struct Entry {
+	static unsigned long copies_;
+
+	Entry() : self_(this), id_(0), link_quality_(0) { memset(stats_, 0, sizeof(stats_)); }
+	Entry(::uint32_t id, ::uint32_t lq) : self_(this), id_(id), link_quality_(lq) { memset(stats_, 0, sizeof(stats_)); }
+	Entry(const Entry& other) : self_(this), id_(other.id_), link_quality_(other.link_quality_) {
+		memcpy(stats_, other.stats_, sizeof(stats_));
+		copies_++;
+	}
+	Entry& operator=(const Entry& other) {
+		id_ = other.id_;
+		link_quality_ = other.link_quality_;
+		memcpy(stats_, other.stats_, sizeof(stats_));
+		copies_++;
+		return *this;
+	}
+#if __cplusplus >= 201103L
+	Entry(Entry&& other) : self_(this), id_(other.id_), link_quality_(other.link_quality_) {
+		memcpy(stats_, other.stats_, sizeof(stats_));
+	}
+	Entry& operator=(Entry&& other) {
+		id_ = other.id_;
+		link_quality_ = other.link_quality_;
+		memcpy(stats_, other.stats_, sizeof(stats_));
+		return *this;
+	}
+#endif
+
+	bool valid() const { return self_ == this; }
+	bool operator==(const Entry& other) const { return id_ == other.id_; }
+
+	Entry *self_;
+	::uint32_t id_;
+	::uint32_t link_quality_;
+	::uint8_t stats_[16];
+};
+unsigned long Entry::copies_ = 0;
+
+enum { MAX_N = 256 };
+
+/**
+ * The former vector_static insert/erase: rotate through the vector by
+ * assignment, one element at a time.
+ */
+template<typename T>
+class LegacyVector : public vector_static<Os, T, MAX_N> {
+	public:
+		typedef vector_static<Os, T, MAX_N> Base;
+		typedef typename Base::iterator iterator;
+
+		iterator insert(iterator position, const T& x) {
+			if(this->full()) { return this->end(); }
+			T cur = x, temp;
+			for(iterator it = position; it != this->end(); ++it) {
+				temp = *it;
+				*it = cur;
+				cur = temp;
+			}
+			this->push_back(cur);
+			return position;
+		}
+
+		iterator erase(iterator position) {
+			for(iterator cur = position; cur + 1 != this->end(); cur++) {
+				*cur = *(cur + 1);
+			}
+			this->pop_back();
+			return position;
+		}
+
+		template<typename It>
+		void insert(iterator position, It first, It last) {
+			// inserting one by one (in order)
+			for( ; first != last; ++first, ++position) { insert(position, *first); }
+		}
+
+		void erase(iterator first, iterator last) {
+			for(size_type n = last - first; n > 0; n--) { erase(first); }
+		}
+};
+
+Message make(Message*, ::uint32_t i) { return Message(i, i * 7); }
+Entry make(Entry*, ::uint32_t i) { return Entry(i, i * 7); }
+
+class App {
+	// {{{
+	public:
+		void init(Os::AppMainParameter& amp) {
+			debug_ = &wiselib::FacetProvider<Os, Os::Debug>::get_facet(amp);
+
+			check<Message>("message");
+			check<Entry>("entry");
+
+			debug_->debug("# workload type impl n ns_per_op [copies_per_op]");
+			static const size_type ns[] = { 16, 64, 256 };
+			for(size_type i = 0; i < sizeof(ns) / sizeof(ns[0]); i++) {
+				size_type n = ns[i];
+				run_type<Message>("message", n);
+				run_type<Entry>("entry", n);
+			}
+
+			run_shrink(VectorDynamic<Message>::SHRINK_QUARTER, "quarter");
+			run_shrink(VectorDynamic<Message>::SHRINK_NEVER, "never");
+			run_shrink(VectorDynamic<Message>::SHRINK_EXACT, "exact");
+		}
+
+	private:
+		template<typename T> struct VectorDynamic : public vector_dynamic<Os, T> { };
+		enum { OPS = 1 << 18 };
+
+		double now_ns() {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1e9 + ts.tv_nsec;
+		}
+
+		void start() {
+			copies_ = Entry::copies_;
+			t_ = now_ns();
+		}
+
+		void stop(const char *workload, const char *type, const char *impl, size_type n, long ops) {
+			double t = now_ns() - t_;
+			debug_->debug("%s %s %s %lu %.2f %.2f", workload, type, impl, (unsigned long)n, t / ops,
+					(double)(Entry::copies_ - copies_) / ops);
+		}
+
+		template<typename T>
+		void run_type(const char *type, size_type n) {
+			run_insert_erase<vector_static<Os, T, MAX_N>, T>(type, "vector_static", n);
+			run_insert_erase<LegacyVector<T>, T>(type, "legacy", n);
+			run_insert_erase<vector_dynamic<Os, T>, T>(type, "vector_dynamic", n);
+			run_insert_erase<std::vector<T>, T>(type, "std::vector", n);
+
+			run_insert_range<vector_static<Os, T, MAX_N>, T>(type, "vector_static", n);
+			run_insert_range<LegacyVector<T>, T>(type, "legacy", n);
+			run_insert_range<vector_dynamic<Os, T>, T>(type, "vector_dynamic", n);
+			run_insert_range<std::vector<T>, T>(type, "std::vector", n);
+
+			run_append<T>(type, n);
+		}
+
+		template<typename V, typename T>
+		void fill(V& v, size_type n) {
+			v.clear();
+			for(size_type i = 0; i < n; i++) { v.push_back(make((T*)0, i)); }
+		}
+
+		template<typename V, typename T>
+		void run_insert_erase(const char *type, const char *impl, size_type n) {
+			V *v = new V;
+			fill<V, T>(*v, n - 1);
+			srand(n);
+			start();
+			for(long r = 0; r < OPS; r++) {
+				v->insert(v->begin() + rand() % (n - 1), make((T*)0, r));
+				v->erase(v->begin() + rand() % n);
+			}
+			stop("insert_erase", type, impl, n, OPS);
+			delete v;
+		}
+
+		template<typename V, typename T>
+		void run_insert_range(const char *type, const char *impl, size_type n) {
+			V *v = new V;
+			fill<V, T>(*v, n - n / 4);
+			std::vector<T> range;
+			for(size_type i = 0; i < n / 4; i++) { range.push_back(make((T*)0, 1000 + i)); }
+			long reps = OPS / n;
+			start();
+			for(long r = 0; r < reps; r++) {
+				v->insert(v->begin() + v->size() / 2, range.begin(), range.end());
+				v->erase(v->begin() + (n - n / 4) / 2, v->begin() + (n - n / 4) / 2 + n / 4);
+			}
+			stop("insert_range", type, impl, n, reps);
+			delete v;
+		}
+
+		template<typename T>
+		void run_append(const char *type, size_type n) {
+			long reps = OPS / n;
+			start();
+			for(long r = 0; r < reps; r++) {
+				vector_dynamic<Os, T> v;
+				for(size_type i = 0; i < n; i++) { v.push_back(make((T*)0, i)); }
+				sink_ += v.size();
+			}
+			stop("append", type, "push_back", n, reps * n);
+
+		#if __cplusplus >= 201103L
+			start();
+			for(long r = 0; r < reps; r++) {
+				vector_dynamic<Os, T> v;
+				for(size_type i = 0; i < n; i++) { v.emplace_back(i, i * 7); }
+				sink_ += v.size();
+			}
+			stop("append", type, "emplace_back", n, reps * n);
+		#endif
+		}
+
+		void run_shrink(int policy, const char *name) {
+			unsigned long a = get_allocator().allocations_;
+			vector_dynamic<Os, Message> v;
+			v.set_shrink_policy((vector_dynamic<Os, Message>::ShrinkPolicy)policy);
+			for(int r = 0; r < 100; r++) {
+				for(::uint32_t i = 0; i < 1000; i++) { v.push_back(make((Message*)0, i)); }
+				for(::uint32_t i = 0; i < 1000; i++) { v.pop_back(); }
+			}
+			debug_->debug("# shrink policy %s: %.1f allocations per fill and empty of 1000",
+					name, (get_allocator().allocations_ - a) / 100.0);
+		}
+
+		/**
+		 * Random operations against std::vector.
+		 */
+		template<typename T>
+		void check(const char *type) {
+			vector_static<Os, T, 64> s;
+			vector_dynamic<Os, T> d;
+			std::vector<T> ref;
+			srand(3);
+			for(int k = 0; k < 20000; k++) {
+				int op = rand() % 6;
+				size_type at = ref.empty() ? 0 : rand() % (ref.size() + 1);
+				if(op < 2 && ref.size() < 60) {
+					T x = make((T*)0, k);
+					s.insert(s.begin() + at, x);
+					d.insert(d.begin() + at, x);
+					ref.insert(ref.begin() + at, x);
+				}
+				else if(op == 2 && ref.size() < 56) {
+					T range[3] = { make((T*)0, k), make((T*)0, k + 1), make((T*)0, k + 2) };
+					s.insert(s.begin() + at, range, range + 3);
+					d.insert(d.begin() + at, range, range + 3);
+					ref.insert(ref.begin() + at, range, range + 3);
+				}
+				else if(op == 3 && at < ref.size()) {
+					s.erase(s.begin() + at);
+					d.erase(d.begin() + at);
+					ref.erase(ref.begin() + at);
+				}
+				else if(op == 4 && at + 2 <= ref.size()) {
+					s.erase(s.begin() + at, s.begin() + at + 2);
+					d.erase(d.begin() + at, d.begin() + at + 2);
+					ref.erase(ref.begin() + at, ref.begin() + at + 2);
+				}
+				else if(op == 5 && ref.size() < 60) {
+				#if __cplusplus >= 201103L
+					s.emplace(s.begin() + at, k, 1);
+					d.emplace(d.begin() + at, k, 1);
+				#else
+					s.insert(s.begin() + at, T(k, 1));
+					d.insert(d.begin() + at, T(k, 1));
+				#endif
+					ref.insert(ref.begin() + at, T(k, 1));
+				}
+				if(s.size() != ref.size() || d.size() != ref.size()) { fail(type, "size"); }
+				for(size_type i = 0; i < ref.size(); i++) {
+					if(!(s[i] == ref[i]) || !(d[i] == ref[i])) { fail(type, "contents"); }
+				}
+			}
+
+			vector_static<Os, T, 64> s2(s);
+			vector_dynamic<Os, T> d2(d), d3;
+			d3.swap(d2);
+			d.insert(d.begin(), d[d.size() / 2]);
+			d.push_back(d[0]);
+			ref.insert(ref.begin(), ref[ref.size() / 2]);
+			ref.push_back(ref[0]);
+			for(size_type i = 0; i < ref.size(); i++) {
+				if(!(d[i] == ref[i])) { fail(type, "aliasing insert"); }
+			}
+			if(s2.size() != s.size() || d3.size() + 2 != d.size() || d2.size() != 0) { fail(type, "copy"); }
+			for(size_type i = 0; i < s.size(); i++) {
+				if(!(s2[i] == s[i]) || !(d3[i] == d[i + 1])) { fail(type, "copy"); }
+			}
+			check_valid(s);
+			check_valid(d);
+		}
+
+		template<typename V>
+		void check_valid(V& v) { }
+
+		void check_valid(vector_static<Os, Entry, 64>& v) {
+			for(size_type i = 0; i < v.size(); i++) {
+				if(!v[i].valid()) { fail("entry", "memmoved vector_static element"); }
+			}
+		}
+
+		void check_valid(vector_dynamic<Os, Entry>& v) {
+			for(size_type i = 0; i < v.size(); i++) {
+				if(!v[i].valid()) { fail("entry", "memmoved vector_dynamic element"); }
+			}
+		}
+
+		void fail(const char *type, const char *what) {
+			debug_->debug("%s: %s check failed", type, what);
+			exit(1);
+		}
+
+		double t_;
+		unsigned long copies_;
+		unsigned long sink_;
+		Os::Debug::self_pointer_t debug_;
+	// }}}
+};
+
+// <general wiselib boilerplate>
+// {{{
+
+	// Application Entry Point & Definiton of allocator
+	Allocator allocator_;
+	Allocator& get_allocator() { return allocator_; }
+	wiselib::WiselibApplication<Os, App> app;
+	void application_main(Os::AppMainParameter& amp) { app.init(amp); }
+
+// }}}
+// </general wiselib boilerplate>
+
+// vim: set ts=4 sw=4 tw=78 noexpandtab foldmethod=marker foldenable :
@@ -0,0 +1,127 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef __WISELIB_INTERNAL_INTERFACE_STL_ELEMENT_TRAITS_H
+#define __WISELIB_INTERNAL_INTERFACE_STL_ELEMENT_TRAITS_H
+
+#include <string.h>
+
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)
+   #define WISELIB_IS_TRIVIALLY_COPYABLE(T) __is_trivially_copyable(T)
+#elif defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3))
+   #define WISELIB_IS_TRIVIALLY_COPYABLE(T) \
+      (__has_trivial_copy(T) && __has_trivial_assign(T) && __has_trivial_destructor(T))
+#else
+   // unknown compiler: always take the elementwise path
+   #define WISELIB_IS_TRIVIALLY_COPYABLE(T) false
+#endif
+
+#ifndef WISELIB_ALLOCATOR_PLACEMENT_NEW
+#define WISELIB_ALLOCATOR_PLACEMENT_NEW
+inline void* operator new(size_t size, void* ptr, bool _) { return ptr; }
+#endif
+
+namespace wiselib
+{
+
+   /**
+    * Whether objects of type T can be moved around with memmove() and
+    * overwritten without destruction. Specialize for types the compiler
+    * can not classify (or on compilers without the type trait builtins).
+    */
+   template<typename T>
+   struct is_trivially_relocatable
+   {
+      enum { value = WISELIB_IS_TRIVIALLY_COPYABLE(T) };
+   };
+   // -----------------------------------------------------------------------
+#if __cplusplus >= 201103L
+   /// x as rvalue, so assignments move (std::move without <utility>)
+   template<typename T>
+   inline T&& rvalue( T& x )
+   { return static_cast<T&&>( x ); }
+#else
+   template<typename T>
+   inline T& rvalue( T& x )
+   { return x; }
+#endif
+   // -----------------------------------------------------------------------
+   /**
+    * Bulk operations of the pstl vectors on slots that hold constructed
+    * objects (like those from allocate_array() or a member array):
+    * memmove()/memcpy() for trivially relocatable types, (move)
+    * assignment otherwise.
+    */
+   template<typename T, bool TRIVIAL_P = is_trivially_relocatable<T>::value>
+   struct element_ops
+   {
+      /// move [first, last) to d, the ranges may overlap
+      static void move( T* d, T* first, T* last )
+      {
+         if ( d < first )
+         {
+            while ( first != last )
+               *d++ = rvalue( *first++ );
+         }
+         else if ( d > first )
+         {
+            d += last - first;
+            while ( last != first )
+               *--d = rvalue( *--last );
+         }
+      }
+      // --------------------------------------------------------------------
+      /// copy [first, last) to d, the ranges must not overlap
+      static void copy( T* d, const T* first, const T* last )
+      {
+         while ( first != last )
+            *d++ = *first++;
+      }
+   };
+   // -----------------------------------------------------------------------
+   template<typename T>
+   struct element_ops<T, true>
+   {
+      static void move( T* d, T* first, T* last )
+      {
+         if ( first != last )
+            memmove( (void*)d, (const void*)first, (last - first) * sizeof(T) );
+      }
+      // --------------------------------------------------------------------
+      static void copy( T* d, const T* first, const T* last )
+      {
+         if ( first != last )
+            memcpy( (void*)d, (const void*)first, (last - first) * sizeof(T) );
+      }
+   };
+   // -----------------------------------------------------------------------
+#if __cplusplus >= 201103L
+   /// replace the constructed object at p by T(args...)
+   template<typename T, typename... Args>
+   inline void reconstruct( T* p, Args&&... args )
+   {
+      p->~T();
+      new( (void*)p, true ) T( static_cast<Args&&>( args )... );
+   }
+#endif
+
+}
+
+#endif
+/* vim: set ts=3 sw=3 tw=78 expandtab :*/
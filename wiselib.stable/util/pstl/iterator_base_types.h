@@ -76,7 +76,7 @@ namespace wiselib
    {
       typedef random_access_iterator_tag iterator_category;
       typedef Iterator_P  value_type;
-      typedef int16_t     difference_type;
+      typedef intptr_t    difference_type;
       typedef Iterator_P* pointer;
       typedef Iterator_P& reference;
    };
@@ -20,6 +20,7 @@
 #define __WISELIB_INTERNAL_INTERFACE_STL_VECTOR_STATIC_H
 
 #include "util/pstl/iterator.h"
+#include "util/pstl/element_traits.h"
 #include <string.h>
 
 namespace wiselib
@@ -46,6 +47,8 @@ namespace wiselib
 
       typedef typename iterator::difference_type difference_type;
       typedef typename OsModel_P::size_t size_type;
+
+      typedef element_ops<value_type> ops;
       // --------------------------------------------------------------------
       vector_static()
       {
@@ -59,6 +62,9 @@ namespace wiselib
       // --------------------------------------------------------------------
       vector_static( size_type n, const value_type& value = value_type() )
       {
+         start_ = &vec_[0];
+         finish_ = start_;
+         end_of_storage_ = start_ + VECTOR_SIZE;
          n = VECTOR_SIZE < n ? VECTOR_SIZE : n;
          for ( unsigned int i = 0; i < n; ++i )
             push_back( value );
@@ -66,18 +72,22 @@ namespace wiselib
       template <class InputIterator>
       vector_static( InputIterator first, InputIterator last )
       {
-         for ( unsigned int i = 0; i < VECTOR_SIZE && first != last; ++i, ++first )
-            push_back( *first++ );
+         start_ = &vec_[0];
+         finish_ = start_;
+         end_of_storage_ = start_ + VECTOR_SIZE;
+         for ( ; finish_ != end_of_storage_ && first != last; ++first )
+            push_back( *first );
       }
       // --------------------------------------------------------------------
       ~vector_static() {}
       // --------------------------------------------------------------------
       vector_static& operator=( const vector_static& vec )
       {
-         memcpy( vec_, vec.vec_, sizeof(vec_) );
          start_ = &vec_[0];
          finish_ = start_ + (vec.finish_ - vec.start_);
          end_of_storage_ = start_ + VECTOR_SIZE;
+         if ( this != &vec )
+            ops::copy( start_, vec.start_, vec.finish_ );
          return *this;
       }
       // --------------------------------------------------------------------
@@ -176,6 +186,31 @@ namespace wiselib
          }
       }
       // --------------------------------------------------------------------
+#if __cplusplus >= 201103L
+      /// construct an element from args at the end (if not full)
+      template<typename... Args>
+      void emplace_back( Args&&... args )
+      {
+         if ( finish_ != end_of_storage_ )
+         {
+            reconstruct( finish_, static_cast<Args&&>( args )... );
+            ++finish_;
+         }
+      }
+      // --------------------------------------------------------------------
+      /// construct an element from args before position (if not full)
+      template<typename... Args>
+      iterator emplace( iterator position, Args&&... args )
+      {
+         if ( full() )
+            return end();
+
+         pointer p = open( position, 1 );
+         reconstruct( p, static_cast<Args&&>( args )... );
+         return iterator( p );
+      }
+#endif
+      // --------------------------------------------------------------------
       void pop_back()
       {
          if ( finish_ != start_ )
@@ -193,29 +228,38 @@ namespace wiselib
          if ( size() == max_size() )
             return iterator(finish_);
 
-         value_type cur = x, temp;
-         for ( iterator it = position; it != end(); ++it )
-         {
-            temp = *it;
-            *it = cur;
-            cur = temp;
-         }
-         push_back( cur );
-
-         return position;
+         // x may be an element that is about to move
+         value_type v = x;
+         pointer p = open( position, 1 );
+         *p = rvalue( v );
+         return iterator( p );
       }
       // --------------------------------------------------------------------
+      /// insert n copies of x (as many as fit)
       void insert( iterator position, size_type n, const value_type& x )
       {
-         for ( int i = 0; i < n; ++i )
-            insert( position, x );
+         if ( n > size_type(end_of_storage_ - finish_) )
+            n = size_type(end_of_storage_ - finish_);
+
+         value_type v = x;
+         pointer p = open( position, n );
+         for ( size_type i = 0; i < n; ++i )
+            p[i] = v;
       }
       // --------------------------------------------------------------------
+      /// insert copies of [first, last) (as many as fit), in one shift
       template <class InputIterator>
       void insert( iterator position, InputIterator first, InputIterator last )
       {
-         for ( ; first != last; ++first )
-            insert( position, *first );
+         size_type n = 0;
+         for ( InputIterator it = first; it != last; ++it )
+            ++n;
+         if ( n > size_type(end_of_storage_ - finish_) )
+            n = size_type(end_of_storage_ - finish_);
+
+         pointer p = open( position, n );
+         for ( size_type i = 0; i < n; ++i, ++first )
+            p[i] = *first;
       }
       // --------------------------------------------------------------------
       iterator erase( iterator position )
@@ -223,10 +267,9 @@ namespace wiselib
          if ( position == end() )
             return end();
 
-         for ( iterator cur = position; cur != end(); cur++ )
-            *cur = *(cur + 1);
-
-         pop_back();
+         pointer p = position.base();
+         ops::move( p, p + 1, finish_ );
+         --finish_;
 
          return position;
       }
@@ -236,17 +279,9 @@ namespace wiselib
          if ( first == end() || first == last )
             return first;
 
-         iterator ret = first;
-
-         while ( last != end() )
-         {
-            *first = *last;
-            first++;
-            last++;
-         }
-
-         finish_ = &(*first);
-         return ret;
+         ops::move( first.base(), last.base(), finish_ );
+         finish_ -= last.base() - first.base();
+         return first;
       }
       // --------------------------------------------------------------------
       void swap( vector_type& vec )
@@ -272,6 +307,18 @@ namespace wiselib
       ///@}
 
    protected:
+      /**
+       * Shift [position, end) up by n (which must fit).
+       * @return pointer to the first of the n slots now free
+       */
+      pointer open( iterator position, size_type n )
+      {
+         pointer p = position.base();
+         ops::move( p + n, p, finish_ );
+         finish_ += n;
+         return p;
+      }
+      // --------------------------------------------------------------------
       value_type vec_[VECTOR_SIZE];
 
       pointer start_, finish_, end_of_storage_;
@@ -0,0 +1,249 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef COUNT_MIN_SKETCH_H
+#define COUNT_MIN_SKETCH_H
+
+#include <util/serialization/serialization.h>
+#include <algorithms/hash/murmur.h>
+
+namespace wiselib {
+
+	/**
+	 * @brief Count-Min sketch with a list of the TOP_K_P most frequent
+	 * keys (heavy hitters).
+	 *
+	 * DEPTH_P rows of WIDTH_P saturating 16 bit counters. The estimated
+	 * count of a key is the minimum of its counters, it never
+	 * underestimates and overestimates by at most about e/WIDTH_P of the
+	 * total count with probability 1 - e^-DEPTH_P (less with the
+	 * conservative update insert() does). Sketches are merged by
+	 * adding their counters, the candidate lists are united and the
+	 * TOP_K_P keys with the highest merged estimates kept.
+	 *
+	 * On the air: the counters (2 * WIDTH_P * DEPTH_P bytes), the number
+	 * of candidates (1 byte) and the candidate keys.
+	 *
+	 * Also implements the aggregate interface of Aggregation (see
+	 * aggregate_base), get() returns the most frequent key.
+	 */
+	template<
+		typename OsModel_P,
+		typename Key_P = ::uint16_t,
+		int WIDTH_P = 16,
+		int DEPTH_P = 2,
+		int TOP_K_P = 4,
+		typename Hash_P = Murmur<OsModel_P>
+	>
+	class CountMinSketch {
+
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef size_type size_t;
+			typedef Key_P Key;
+			typedef Key value_t;
+			typedef ::uint16_t counter_t;
+			typedef Hash_P Hash;
+			typedef ::uint32_t hash_t;
+			typedef CountMinSketch self_type;
+			typedef self_type self_t;
+
+			enum {
+				WIDTH = WIDTH_P,
+				DEPTH = DEPTH_P,
+				TOP_K = TOP_K_P,
+				MAX_COUNT = 0xffff,
+				MAX_SIZE = DEPTH_P * WIDTH_P * sizeof(counter_t) + 1 + TOP_K_P * sizeof(Key_P)
+			};
+
+			CountMinSketch() {
+				clear();
+			}
+
+			/**
+			 * Read a sketch written by writeTo().
+			 */
+			CountMinSketch(block_data_t *buffer) {
+				for(size_type i = 0; i < DEPTH * WIDTH; i++) {
+					counters_[i] = wiselib::read<OsModel, block_data_t, counter_t>(buffer);
+					buffer += sizeof(counter_t);
+				}
+				candidates_ = *buffer++;
+				if(candidates_ > TOP_K) { candidates_ = TOP_K; }
+				for(size_type i = 0; i < candidates_; i++) {
+					keys_[i] = wiselib::read<OsModel, block_data_t, Key>(buffer);
+					counts_[i] = estimate(keys_[i]);
+					buffer += sizeof(Key);
+				}
+			}
+
+			void clear() {
+				memset(counters_, 0, sizeof(counters_));
+				candidates_ = 0;
+			}
+
+			/**
+			 * Conservative update: only counters below the new estimate
+			 * are raised to it, which keeps the estimates of keys sharing
+			 * counters with frequent ones much lower.
+			 */
+			void insert(Key key, counter_t count = 1) {
+				hash_t h = hash(key);
+				::uint32_t e = (::uint32_t)estimate(key) + count;
+				counter_t c_new = (e > MAX_COUNT) ? (counter_t)MAX_COUNT : (counter_t)e;
+				for(size_type d = 0; d < DEPTH; d++) {
+					counter_t &c = counters_[d * WIDTH + index(h, d)];
+					if(c < c_new) { c = c_new; }
+				}
+				offer(key);
+			}
+
+			/**
+			 * @return Estimated number of times @a key was inserted.
+			 */
+			counter_t estimate(Key key) const {
+				hash_t h = hash(key);
+				counter_t r = MAX_COUNT;
+				for(size_type d = 0; d < DEPTH; d++) {
+					counter_t c = counters_[d * WIDTH + index(h, d)];
+					if(c < r) { r = c; }
+				}
+				return r;
+			}
+
+			/**
+			 * Make this the sketch of the values of this and @a other.
+			 */
+			void merge(const self_type& other) {
+				for(size_type i = 0; i < DEPTH * WIDTH; i++) {
+					::uint32_t s = (::uint32_t)counters_[i] + other.counters_[i];
+					counters_[i] = (s > MAX_COUNT) ? (counter_t)MAX_COUNT : (counter_t)s;
+				}
+
+				// estimates of our own candidates changed as well
+				for(size_type i = 0; i < candidates_; i++) {
+					counts_[i] = estimate(keys_[i]);
+				}
+				for(size_type i = 0; i < other.candidates_; i++) {
+					offer(other.keys_[i]);
+				}
+			}
+
+			/**
+			 * Candidates for the most frequent keys, in no particular
+			 * order. Use estimate() for their counts.
+			 */
+			size_type top_size() const { return candidates_; }
+			Key top(size_type i) const { return keys_[i]; }
+
+			// Aggregate interface (see aggregate_base)
+
+			self_type combine(self_type& rhs) {
+				self_type r(*this);
+				r.merge(rhs);
+				return r;
+			}
+
+			/**
+			 * @return The candidate with the highest estimated count, 0 if
+			 * the sketch is empty.
+			 */
+			value_t get() {
+				size_type best = 0;
+				for(size_type i = 1; i < candidates_; i++) {
+					if(counts_[i] > counts_[best]) { best = i; }
+				}
+				return candidates_ ? keys_[best] : 0;
+			}
+
+			void writeTo(block_data_t *buffer) {
+				for(size_type i = 0; i < DEPTH * WIDTH; i++) {
+					buffer += wiselib::write<OsModel, block_data_t, counter_t>(buffer, counters_[i]);
+				}
+				*buffer++ = candidates_;
+				for(size_type i = 0; i < candidates_; i++) {
+					buffer += wiselib::write<OsModel, block_data_t, Key>(buffer, keys_[i]);
+				}
+			}
+
+			size_type size() {
+				return DEPTH * WIDTH * sizeof(counter_t) + 1 + candidates_ * sizeof(Key);
+			}
+
+		private:
+			static hash_t hash(Key key) {
+				block_data_t b[sizeof(Key)];
+				for(size_type i = 0; i < sizeof(Key); i++) {
+					b[i] = (block_data_t)(key >> (8 * i));
+				}
+				return Hash::hash(b, sizeof(Key));
+			}
+
+			/**
+			 * Counter of row @a d, the hash value mixed again for every
+			 * row. (h1 + d * h2 would leave only 2 log2(WIDTH) bits to
+			 * tell keys apart in all rows.)
+			 */
+			static size_type index(hash_t h, size_type d) {
+				h += d * 0x9e3779b9UL;
+				h ^= h >> 16;
+				h *= 0x85ebca6bUL;
+				h ^= h >> 13;
+				h *= 0xc2b2ae35UL;
+				h ^= h >> 16;
+				return h % WIDTH;
+			}
+
+			/**
+			 * Make @a key a candidate if it is more frequent than the
+			 * least frequent one.
+			 */
+			void offer(Key key) {
+				counter_t c = estimate(key);
+				size_type least = 0;
+				for(size_type i = 0; i < candidates_; i++) {
+					if(keys_[i] == key) {
+						counts_[i] = c;
+						return;
+					}
+					if(counts_[i] < counts_[least]) { least = i; }
+				}
+
+				if(candidates_ < TOP_K) {
+					least = candidates_++;
+				}
+				else if(counts_[least] >= c) {
+					return;
+				}
+				keys_[least] = key;
+				counts_[least] = c;
+			}
+
+			counter_t counters_[DEPTH_P * WIDTH_P];
+			Key keys_[TOP_K_P];
+			counter_t counts_[TOP_K_P];
+			::uint8_t candidates_;
+
+	}; // CountMinSketch
+}
+
+#endif // COUNT_MIN_SKETCH_H
+
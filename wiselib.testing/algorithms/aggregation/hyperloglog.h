@@ -0,0 +1,206 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <algorithms/hash/murmur.h>
+
+namespace wiselib {
+
+	/**
+	 * @brief HyperLogLog sketch for estimating the number of distinct
+	 * values (COUNT DISTINCT).
+	 *
+	 * 2^PRECISION_P registers of 4 bits each, so the sketch is
+	 * 2^(PRECISION_P - 1) bytes in memory and on the air. Two sketches
+	 * are merged by taking the maximum of every register, the result is
+	 * the sketch of the union of both value sets. The standard error of
+	 * the estimate is about 1.04 / sqrt(2^PRECISION_P), 13% for the
+	 * default of 64 registers (32 bytes).
+	 *
+	 * Ranks are capped at 15 to fit 4 bits which is fine for up to about
+	 * 2^(PRECISION_P + 15) distinct values.
+	 *
+	 * Also implements the aggregate interface of Aggregation
+	 * (combine(), get(), writeTo(), size(), see aggregate_base), get()
+	 * returns the estimate.
+	 *
+	 * @tparam Hash_P 32 bit hash function (Hash_concept). All nodes have
+	 * to use the same.
+	 */
+	template<
+		typename OsModel_P,
+		int PRECISION_P = 6,
+		typename Hash_P = Murmur<OsModel_P>
+	>
+	class HyperLogLog {
+
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef size_type size_t;
+			typedef Hash_P Hash;
+			typedef ::uint32_t hash_t;
+			typedef ::uint32_t value_t;
+			typedef HyperLogLog self_type;
+			typedef self_type self_t;
+
+			enum {
+				PRECISION = PRECISION_P,
+				REGISTERS = 1 << PRECISION_P,
+				SIZE = REGISTERS / 2,
+				MAX_RANK = 15
+			};
+
+			HyperLogLog() {
+				clear();
+			}
+
+			/**
+			 * Read a sketch written by writeTo().
+			 */
+			HyperLogLog(const block_data_t *buffer) {
+				memcpy(registers_, buffer, SIZE);
+			}
+
+			void clear() {
+				memset(registers_, 0, SIZE);
+			}
+
+			void insert(const block_data_t *data, size_type len) {
+				insert_hash(Hash::hash(data, len));
+			}
+
+			/**
+			 * Insert an integer value, hashed in little endian byte order
+			 * so nodes of different endianness agree.
+			 */
+			void insert(::uint32_t v) {
+				block_data_t b[4] = {
+					(block_data_t)v, (block_data_t)(v >> 8),
+					(block_data_t)(v >> 16), (block_data_t)(v >> 24)
+				};
+				insert(b, sizeof(b));
+			}
+
+			void insert_hash(hash_t h) {
+				size_type idx = h >> (32 - PRECISION);
+				hash_t w = h << PRECISION;
+
+				::uint8_t r = 1;
+				for( ; r < MAX_RANK && !(w & 0x80000000UL); r++) {
+					w <<= 1;
+				}
+
+				if(r > rank(idx)) {
+					block_data_t &b = registers_[idx / 2];
+					b = (idx & 1) ? ((b & 0x0f) | (r << 4)) : ((b & 0xf0) | r);
+				}
+			}
+
+			/**
+			 * Make this the sketch of the union of this and @a other.
+			 */
+			void merge(const self_type& other) {
+				for(size_type i = 0; i < SIZE; i++) {
+					block_data_t a = registers_[i], b = other.registers_[i];
+					registers_[i] = ((a & 0x0f) > (b & 0x0f) ? (a & 0x0f) : (b & 0x0f))
+						| ((a & 0xf0) > (b & 0xf0) ? (a & 0xf0) : (b & 0xf0));
+				}
+			}
+
+			/**
+			 * @return Estimated number of distinct values inserted.
+			 */
+			::uint32_t estimate() const {
+				double sum = 0.0;
+				size_type zeros = 0;
+				for(size_type i = 0; i < REGISTERS; i++) {
+					::uint8_t r = rank(i);
+					sum += 1.0 / (double)(1UL << r);
+					if(r == 0) { zeros++; }
+				}
+
+				double m = REGISTERS;
+				double e = alpha() * m * m / sum;
+				if(e <= 2.5 * m && zeros) {
+					// small range correction (linear counting)
+					e = m * ln(m / (double)zeros);
+				}
+				return (::uint32_t)(e + 0.5);
+			}
+
+			::uint8_t rank(size_type i) const {
+				return (i & 1) ? (registers_[i / 2] >> 4) : (registers_[i / 2] & 0x0f);
+			}
+
+			const block_data_t* data() const { return registers_; }
+
+			// Aggregate interface (see aggregate_base)
+
+			self_type combine(self_type& rhs) {
+				self_type r(*this);
+				r.merge(rhs);
+				return r;
+			}
+
+			value_t get() { return estimate(); }
+
+			void writeTo(block_data_t *buffer) {
+				memcpy(buffer, registers_, SIZE);
+			}
+
+			size_type size() { return SIZE; }
+
+		private:
+			static double alpha() {
+				switch((int)REGISTERS) {
+					case 16: return 0.673;
+					case 32: return 0.697;
+					case 64: return 0.709;
+					default: return 0.7213 / (1.0 + 1.079 / REGISTERS);
+				}
+			}
+
+			/**
+			 * Natural logarithm for x >= 1.
+			 */
+			static double ln(double x) {
+				int e = 0;
+				for( ; x >= 2.0; e++) { x /= 2.0; }
+
+				// ln(x) = 2 atanh((x - 1) / (x + 1)), x in [1, 2)
+				double y = (x - 1.0) / (x + 1.0);
+				double y2 = y * y;
+				double s = 0.0;
+				for(int k = 15; k >= 1; k -= 2) {
+					s = s * y2 + 1.0 / k;
+				}
+				return e * 0.69314718055994531 + 2.0 * y * s;
+			}
+
+			block_data_t registers_[SIZE];
+
+	}; // HyperLogLog
+}
+
+#endif // HYPERLOGLOG_H
+
@@ -0,0 +1,343 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef KLL_SKETCH_H
+#define KLL_SKETCH_H
+
+#include <util/serialization/serialization.h>
+
+namespace wiselib {
+
+	/**
+	 * @brief KLL quantile sketch (Karnin, Lang, Liberty) of a fixed
+	 * maximum size.
+	 *
+	 * Values are kept in levels, a value on level h stands for 2^h
+	 * inserted values. The top level holds up to K_P values and every
+	 * level below it 2/3 of the one above (at least 2). When the sketch
+	 * holds more values than that, the lowest full level is sorted and
+	 * every other value of it moves up one level. Sketches are merged by
+	 * uniting their levels and compacting again. Rank errors are about
+	 * 1.7 / K_P of the number of values.
+	 *
+	 * All levels live in one array of fixed size, so the sketch needs no
+	 * dynamic memory. It covers at least K_P * 2^(MAX_LEVELS_P - 1)
+	 * values, beyond that the top level is compacted into itself and
+	 * the quantiles lose accuracy.
+	 *
+	 * Every other value is chosen by a coin that alternates instead of a
+	 * random one, so equal input gives equal sketches on all nodes. The
+	 * coin goes on the air as well, a sketch that is read back before
+	 * every merge (as in rows of INQP Aggregate) would otherwise always
+	 * keep the smaller value of every pair.
+	 *
+	 * On the air: number of levels (1 byte, the coin in its top bit),
+	 * number of values inserted (4 bytes), size of every level (1 byte
+	 * each) and the values, at most
+	 * 5 + MAX_LEVELS_P + (3 * K_P + 2 * MAX_LEVELS_P) * sizeof(Value_P)
+	 * bytes. K_P has to be 64 at most, MAX_LEVELS_P 127.
+	 *
+	 * Also implements the aggregate interface of Aggregation (see
+	 * aggregate_base), get() returns the median.
+	 */
+	template<
+		typename OsModel_P,
+		typename Value_P = ::uint16_t,
+		int K_P = 8,
+		int MAX_LEVELS_P = 10
+	>
+	class KllSketch {
+
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef size_type size_t;
+			typedef Value_P Value;
+			typedef Value value_t;
+			typedef ::uint32_t weight_t;
+			typedef KllSketch self_type;
+			typedef self_type self_t;
+
+			enum {
+				K = K_P,
+				MAX_LEVELS = MAX_LEVELS_P,
+				MIN_LEVEL_CAPACITY = 2,
+				/// capacity of a compacted sketch
+				MAX_VALUES = 3 * K_P + MIN_LEVEL_CAPACITY * MAX_LEVELS_P,
+				/// room for two of them while merging
+				CAPACITY = 2 * MAX_VALUES,
+				MAX_SIZE = 5 + MAX_LEVELS_P + MAX_VALUES * sizeof(Value_P)
+			};
+
+			KllSketch() {
+				clear();
+			}
+
+			/**
+			 * Read a sketch written by writeTo().
+			 */
+			KllSketch(block_data_t *buffer) {
+				clear();
+				coin_ = *buffer >> 7;
+				levels_ = *buffer++ & 0x7f;
+				if(levels_ > MAX_LEVELS) { levels_ = MAX_LEVELS; }
+				if(levels_ < 1) { levels_ = 1; }
+				n_ = wiselib::read<OsModel, block_data_t, ::uint32_t>(buffer);
+				buffer += sizeof(::uint32_t);
+
+				size_type total = 0;
+				for(size_type h = 0; h < levels_; h++) {
+					sizes_[h] = *buffer++;
+					total += sizes_[h];
+				}
+				if(total > MAX_VALUES) {
+					clear();
+					return;
+				}
+				for(size_type i = 0; i < total; i++) {
+					items_[i] = wiselib::read<OsModel, block_data_t, Value>(buffer);
+					buffer += sizeof(Value);
+				}
+			}
+
+			void clear() {
+				levels_ = 1;
+				memset(sizes_, 0, sizeof(sizes_));
+				n_ = 0;
+				coin_ = 0;
+			}
+
+			void insert(Value v) {
+				items_[total()] = v;
+				sizes_[0]++;
+				n_++;
+				compress();
+			}
+
+			/**
+			 * Make this the sketch of the values of this and @a other.
+			 */
+			void merge(const self_type& other) {
+				while(levels_ < other.levels_) {
+					sizes_[levels_++] = 0;
+				}
+
+				size_type end = total();
+				size_type from = 0;
+				// other's levels are stored from the top, so go from the top
+				for(size_type h = other.levels_; h-- > 0; ) {
+					size_type pos = offset(h) + sizes_[h];
+					size_type n = other.sizes_[h];
+					memmove(items_ + pos + n, items_ + pos, (end - pos) * sizeof(Value));
+					memcpy(items_ + pos, other.items_ + from, n * sizeof(Value));
+					sizes_[h] += n;
+					end += n;
+					from += n;
+				}
+				n_ += other.n_;
+				compress();
+			}
+
+			/**
+			 * @return Number of values inserted into this sketch and the
+			 * ones merged into it.
+			 */
+			::uint32_t count() const { return n_; }
+
+			/**
+			 * @return Estimated number of inserted values less than @a v.
+			 */
+			weight_t rank(Value v) const {
+				weight_t r = 0;
+				size_type i = 0;
+				for(size_type h = levels_; h-- > 0; ) {
+					for(size_type end = i + sizes_[h]; i < end; i++) {
+						if(items_[i] < v) { r += (weight_t)1 << h; }
+					}
+				}
+				return r;
+			}
+
+			/**
+			 * @return Estimated value of rank @a q * count() (0 <= q <= 1),
+			 * e.g. q = 0.5 for the median.
+			 */
+			Value quantile(float q) const {
+				Value values[MAX_VALUES];
+				weight_t weights[MAX_VALUES];
+				size_type n = 0;
+				weight_t total_weight = 0;
+
+				// insertion sort of (value, weight) pairs, the sketch is
+				// small
+				for(size_type h = levels_, i = 0; h-- > 0; ) {
+					for(size_type end = i + sizes_[h]; i < end; i++) {
+						size_type j = n++;
+						for( ; j > 0 && items_[i] < values[j - 1]; j--) {
+							values[j] = values[j - 1];
+							weights[j] = weights[j - 1];
+						}
+						values[j] = items_[i];
+						weights[j] = (weight_t)1 << h;
+						total_weight += weights[j];
+					}
+				}
+				if(n == 0) { return Value(); }
+
+				weight_t target = (weight_t)(q * total_weight);
+				weight_t w = 0;
+				for(size_type i = 0; i < n; i++) {
+					w += weights[i];
+					if(w > target) { return values[i]; }
+				}
+				return values[n - 1];
+			}
+
+			// Aggregate interface (see aggregate_base)
+
+			self_type combine(self_type& rhs) {
+				self_type r(*this);
+				r.merge(rhs);
+				return r;
+			}
+
+			value_t get() { return quantile(0.5); }
+
+			void writeTo(block_data_t *buffer) {
+				*buffer++ = levels_ | (coin_ << 7);
+				buffer += wiselib::write<OsModel, block_data_t, ::uint32_t>(buffer, n_);
+				for(size_type h = 0; h < levels_; h++) {
+					*buffer++ = (block_data_t)sizes_[h];
+				}
+				for(size_type i = 0, end = total(); i < end; i++) {
+					buffer += wiselib::write<OsModel, block_data_t, Value>(buffer, items_[i]);
+				}
+			}
+
+			size_type size() {
+				return 5 + levels_ + total() * sizeof(Value);
+			}
+
+		private:
+			/**
+			 * Capacity of level @a h with the current number of levels.
+			 */
+			size_type level_capacity(size_type h) const {
+				size_type c = K;
+				for(size_type depth = levels_ - 1 - h; depth && c > MIN_LEVEL_CAPACITY; depth--) {
+					c = c * 2 / 3;
+				}
+				return (c < MIN_LEVEL_CAPACITY) ? (size_type)MIN_LEVEL_CAPACITY : c;
+			}
+
+			size_type capacity() const {
+				size_type c = 0;
+				for(size_type h = 0; h < levels_; h++) {
+					c += level_capacity(h);
+				}
+				return c;
+			}
+
+			size_type total() const {
+				size_type t = 0;
+				for(size_type h = 0; h < levels_; h++) {
+					t += sizes_[h];
+				}
+				return t;
+			}
+
+			/**
+			 * Position of level @a h in items_, levels are stored from the
+			 * top level down to level 0.
+			 */
+			size_type offset(size_type h) const {
+				size_type o = 0;
+				for(size_type l = h + 1; l < levels_; l++) {
+					o += sizes_[l];
+				}
+				return o;
+			}
+
+			void compress() {
+				while(total() > capacity()) {
+					size_type h = 0;
+					while(sizes_[h] < level_capacity(h)) {
+						h++;
+					}
+					compact(h);
+				}
+			}
+
+			/**
+			 * Sort level @a h and move every other value of it one level
+			 * up. With an odd number of values the last one stays.
+			 */
+			void compact(size_type h) {
+				if(h == levels_ - 1u && levels_ < MAX_LEVELS) {
+					// new (empty) top level, stored in front of the others
+					sizes_[levels_++] = 0;
+				}
+
+				size_type start = offset(h);
+				size_type s = sizes_[h];
+				size_type m = s & ~(size_type)1;
+				size_type lower = total() - start - s;
+
+				Value *v = items_ + start;
+				for(size_type i = 1; i < m; i++) {
+					Value x = v[i];
+					size_type j = i;
+					for( ; j > 0 && x < v[j - 1]; j--) {
+						v[j] = v[j - 1];
+					}
+					v[j] = x;
+				}
+
+				size_type half = m / 2;
+				for(size_type i = 0; i < half; i++) {
+					v[i] = v[2 * i + coin_];
+				}
+				coin_ ^= 1;
+				if(s > m) {
+					v[half] = v[m];
+				}
+				memmove(v + half + (s - m), v + s, lower * sizeof(Value));
+
+				if(h + 1 < levels_) {
+					sizes_[h + 1] += half;
+					sizes_[h] = s - m;
+				}
+				else {
+					// out of levels, compact the top level into itself
+					sizes_[h] = half + (s - m);
+				}
+			}
+
+			Value items_[CAPACITY];
+			::uint16_t sizes_[MAX_LEVELS_P];
+			::uint8_t levels_;
+			::uint8_t coin_;
+			::uint32_t n_;
+
+	}; // KllSketch
+}
+
+#endif // KLL_SKETCH_H
+
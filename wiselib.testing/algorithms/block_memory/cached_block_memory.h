@@ -224,6 +224,9 @@ namespace wiselib {
 				reads_ = writes_ = 0;
 			}
 			
+			size_type reads() { return reads_; }
+			size_type writes() { return writes_; }
+			
 			void print_stats() {
 				DBG("CBM phys reads: %ld phys writes: %ld", reads_, writes_);
 			}
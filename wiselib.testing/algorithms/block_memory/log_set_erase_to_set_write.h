@@ -0,0 +1,569 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef LOG_SET_ERASE_TO_SET_WRITE_H
+#define LOG_SET_ERASE_TO_SET_WRITE_H
+
+#include "to_set_write_base.h"
+#include "util/serialization/simple_types.h"
+
+namespace wiselib {
+
+	/**
+	 * \brief Log-structured mode of SetEraseToSetWrite.
+	 *
+	 * Instead of redirecting overwritten blocks in place, every write
+	 * appends a new version of the block to the currently open erase block
+	 * and updates a logical -> physical map kept in RAM. Each physical
+	 * block carries the logical address and a global sequence number, the
+	 * first block of each erase block holds its erase counter, so the map
+	 * can be rebuilt with mount().
+	 *
+	 * Space of outdated versions is reclaimed by an incremental garbage
+	 * collector: gc_step() copies at most GC_STEP_BLOCKS live blocks of
+	 * the current victim erase block to a separate (cold) open erase block
+	 * or erases the evacuated victim. It is called from the timer (see
+	 * enable_background_gc()) and, only if no free erase block is left for
+	 * the writer, synchronously from write().
+	 *
+	 * Victims are chosen either greedily (fewest live blocks) or by the
+	 * cost-benefit rule of LFS ((1 - u) * age / (1 + u)).
+	 * Free erase blocks are opened lowest erase count first and if the
+	 * erase counts diverge by more than WEAR_LEVELING_THRESHOLD the
+	 * least worn erase block is collected regardless of policy, so cold
+	 * data does not pin it.
+	 *
+	 * All bookkeeping lives in RAM, roughly
+	 * sizeof(address_t) * LOGICAL_BLOCKS + PHYSICAL_BLOCKS / 8 +
+	 * 11 * ERASE_BLOCKS bytes.
+	 *
+	 * \ingroup
+	 *
+	 * \tparam SPARE_ERASE_BLOCKS_P Number of erase blocks not exported as
+	 *   logical capacity (over-provisioning), must be at least 2.
+	 */
+	template<
+		typename OsModel_P,
+		typename Storage_P,
+		typename Timer_P = typename OsModel_P::Timer,
+		typename Debug_P = typename OsModel_P::Debug,
+		int SPARE_ERASE_BLOCKS_P = 2
+	>
+	class LogSetEraseToSetWrite : public ToSetWriteBase<OsModel_P, Storage_P> {
+		public:
+			typedef OsModel_P OsModel;
+			typedef Storage_P Storage;
+			typedef Timer_P Timer;
+			typedef ToSetWriteBase<OsModel, Storage> Base;
+			typedef typename Base::block_data_t block_data_t;
+			typedef typename Base::size_type size_type;
+			typedef typename Base::address_t address_t;
+			typedef typename Storage::erase_block_address_t erase_block_address_t;
+			typedef LogSetEraseToSetWrite<OsModel_P, Storage_P, Timer_P, Debug_P, SPARE_ERASE_BLOCKS_P> self_type;
+			typedef self_type* self_pointer_t;
+			typedef ::uint32_t sequence_t;
+			typedef ::uint32_t erase_count_t;
+
+			enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+			enum { NO_ADDRESS = (address_t)(-1) };
+			enum { BLOCK_SIZE = Storage::BLOCK_SIZE - sizeof(address_t) - sizeof(sequence_t) };
+
+			enum {
+				/// Blocks per erase block usable for data (first one is the header)
+				DATA_BLOCKS = Storage::ERASE_BLOCK_SIZE - 1,
+				LOGICAL_BLOCKS = (Storage::ERASE_BLOCKS - SPARE_ERASE_BLOCKS_P) * DATA_BLOCKS,
+				PHYSICAL_BLOCKS = Storage::ERASE_BLOCKS * Storage::ERASE_BLOCK_SIZE
+			};
+
+			enum {
+				/// Free erase blocks only the collector may open
+				GC_RESERVE = 1,
+				/// Maximum number of blocks copied by one gc_step()
+				GC_STEP_BLOCKS = 8,
+				WEAR_LEVELING_THRESHOLD = 16
+			};
+
+			enum GcPolicy { GC_GREEDY, GC_COST_BENEFIT };
+
+			LogSetEraseToSetWrite() : timer_(0), gc_interval_(0), gc_free_target_(GC_RESERVE + 1), policy_(GC_COST_BENEFIT) {
+			}
+
+			int init(typename Storage::self_pointer_t storage, typename Debug_P::self_pointer_t debug) {
+				debug_ = debug;
+				Base::init(storage);
+				reset_state();
+				return SUCCESS;
+			}
+
+			/**
+			 * Erase the whole storage. This also resets the wear counters.
+			 */
+			int wipe() {
+				int r = storage().erase(0, Storage::ERASE_BLOCKS);
+				if(r != SUCCESS) { return r; }
+				reset_state();
+				return SUCCESS;
+			}
+
+			/**
+			 * Rebuild the RAM state from storage. Partially written erase
+			 * blocks are not reopened, their remaining space is reclaimed
+			 * by the collector.
+			 */
+			int mount() {
+				reset_state();
+
+				block_data_t buf[Storage::BLOCK_SIZE];
+				block_data_t buf2[Storage::BLOCK_SIZE];
+
+				for(erase_block_address_t eb = 0; eb < Storage::ERASE_BLOCKS; eb++) {
+					int r = storage().read(buf, erase_block_start(eb));
+					if(r != SUCCESS) { return r; }
+
+					if(rd<sequence_t>(buf) != MAGIC) {
+						if(!is_blank(buf)) {
+							r = storage().erase(eb);
+							if(r != SUCCESS) { return r; }
+						}
+						continue;
+					}
+
+					free_erase_blocks_--;
+					state_[eb] = FULL;
+					erase_count_[eb] = rd<erase_count_t>(buf + sizeof(sequence_t));
+
+					for(address_t i = 1; i < Storage::ERASE_BLOCK_SIZE; i++) {
+						const address_t p = erase_block_start(eb) + i;
+						r = storage().read(buf, p);
+						if(r != SUCCESS) { return r; }
+
+						address_t l = tag_address(buf);
+						if(l == NO_ADDRESS) { break; }
+
+						sequence_t s = tag_sequence(buf);
+						if(s > sequence_) { sequence_ = s; }
+						if(s > modified_[eb]) { modified_[eb] = s; }
+						if(l >= LOGICAL_BLOCKS) { continue; }
+
+						if(map_[l] != NO_ADDRESS) {
+							r = storage().read(buf2, map_[l]);
+							if(r != SUCCESS) { return r; }
+							if(tag_sequence(buf2) > s) { continue; }
+							set_dead(map_[l]);
+						}
+						map_[l] = p;
+						set_live(p);
+					}
+				}
+				return SUCCESS;
+			}
+
+			/**
+			 * Write @a buffer to a so far unused logical block.
+			 *
+			 * @return logical address of the block or NO_ADDRESS if the
+			 * storage is full.
+			 */
+			address_t create(block_data_t* buffer) {
+				for(address_t i = 0; i < LOGICAL_BLOCKS; i++) {
+					address_t l = (create_cursor_ + i) % LOGICAL_BLOCKS;
+					if(map_[l] == NO_ADDRESS) {
+						if(write(buffer, l) != SUCCESS) { return NO_ADDRESS; }
+						create_cursor_ = (l + 1) % LOGICAL_BLOCKS;
+						return l;
+					}
+				}
+				return NO_ADDRESS;
+			}
+
+			int read(block_data_t* target, address_t block) {
+				if(block >= LOGICAL_BLOCKS || map_[block] == NO_ADDRESS) { return ERR_UNSPEC; }
+
+				block_data_t buf[Storage::BLOCK_SIZE];
+				int r = storage().read(buf, map_[block]);
+				if(r != SUCCESS) { return r; }
+				memcpy(target, payload(buf), BLOCK_SIZE);
+				return SUCCESS;
+			}
+
+			/**
+			 * Blocks are never modified in place, so this is the same as
+			 * write().
+			 */
+			int set(block_data_t* buffer, address_t block) {
+				return write(buffer, block);
+			}
+
+			int write(block_data_t* buffer, address_t block) {
+				bool b;
+				return write(buffer, block, b);
+			}
+
+			/**
+			 * @param did_gc set to true iff the write had to wait for the
+			 * garbage collector.
+			 */
+			int write(block_data_t* buffer, address_t block, bool& did_gc) {
+				did_gc = false;
+				if(block >= LOGICAL_BLOCKS) { return ERR_UNSPEC; }
+
+				if(write_eb_ == NO_ADDRESS) {
+					while(free_erase_blocks_ <= GC_RESERVE) {
+						did_gc = true;
+						if(!gc_step()) { return ERR_UNSPEC; }
+					}
+					int r = open_erase_block(write_eb_, write_pos_);
+					if(r != SUCCESS) { return r; }
+				}
+
+				block_data_t buf[Storage::BLOCK_SIZE];
+				set_tag(buf, block, ++sequence_);
+				memcpy(payload(buf), buffer, BLOCK_SIZE);
+
+				int r = append(buf, block, write_eb_, write_pos_);
+				if(r != SUCCESS) { return r; }
+				user_writes_++;
+				return SUCCESS;
+			}
+
+			///@{
+			///@name Garbage collection
+
+			void set_gc_policy(GcPolicy policy) { policy_ = policy; }
+
+			/**
+			 * Run gc_idle() from @a timer every @a interval ms.
+			 */
+			void enable_background_gc(typename Timer::self_pointer_t timer, typename Timer::millis_t interval) {
+				bool running = (gc_interval_ != 0);
+				timer_ = timer;
+				gc_interval_ = interval;
+				if(!running) {
+					timer_->template set_timer<self_type, &self_type::on_gc_timer>(gc_interval_, this, 0);
+				}
+			}
+
+			void disable_background_gc() {
+				gc_interval_ = 0;
+			}
+
+			/**
+			 * Background collection tries to keep at least this many erase
+			 * blocks free (default GC_RESERVE + 1).
+			 */
+			void set_gc_free_target(size_type free_target) { gc_free_target_ = free_target; }
+
+			void on_gc_timer(void*) {
+				if(gc_interval_ == 0) { return; }
+				gc_idle();
+				timer_->template set_timer<self_type, &self_type::on_gc_timer>(gc_interval_, this, 0);
+			}
+
+			/**
+			 * One gc_step() if free space is below target or a collection
+			 * is in progress. Can be called from an idle loop instead of
+			 * using the timer.
+			 *
+			 * @return true iff some work was done.
+			 */
+			bool gc_idle() {
+				if(victim_ != NO_ADDRESS || free_erase_blocks_ < gc_free_target_) {
+					return gc_step();
+				}
+				return false;
+			}
+
+			/**
+			 * Do a bounded amount of garbage collection work: pick a
+			 * victim if there is none, then either copy up to
+			 * GC_STEP_BLOCKS live blocks of it or, if it has no live
+			 * blocks left, erase it.
+			 *
+			 * @return false iff no progress could be made.
+			 */
+			bool gc_step() {
+				if(victim_ == NO_ADDRESS) {
+					victim_ = select_victim();
+					if(victim_ == NO_ADDRESS) { return false; }
+					victim_pos_ = 1;
+				}
+
+				if(live_[victim_] == 0) {
+					if(storage().erase(victim_) != SUCCESS) { return false; }
+					erase_count_[victim_]++;
+					erases_++;
+					state_[victim_] = FREE;
+					modified_[victim_] = 0;
+					free_erase_blocks_++;
+					victim_ = NO_ADDRESS;
+					return true;
+				}
+
+				block_data_t buf[Storage::BLOCK_SIZE];
+				size_type copied = 0;
+				for( ; victim_pos_ < Storage::ERASE_BLOCK_SIZE && copied < GC_STEP_BLOCKS; victim_pos_++) {
+					const address_t p = erase_block_start(victim_) + victim_pos_;
+					if(!is_live(p)) { continue; }
+
+					if(gc_eb_ == NO_ADDRESS) {
+						if(open_erase_block(gc_eb_, gc_pos_) != SUCCESS) { return copied != 0; }
+					}
+					if(storage().read(buf, p) != SUCCESS) { return copied != 0; }
+					// keeps the original sequence number (and thus age)
+					if(append(buf, tag_address(buf), gc_eb_, gc_pos_) != SUCCESS) { return copied != 0; }
+					gc_writes_++;
+					copied++;
+				}
+				return true;
+			}
+
+			///@}
+
+			///@{
+			///@name Statistics
+
+			size_type user_writes() { return user_writes_; }
+			size_type gc_writes() { return gc_writes_; }
+			size_type erases() { return erases_; }
+			void reset_stats() { user_writes_ = gc_writes_ = erases_ = 0; }
+
+			size_type free_erase_blocks() { return free_erase_blocks_; }
+			erase_count_t erase_count(erase_block_address_t eb) { return erase_count_[eb]; }
+
+			erase_count_t min_erase_count() {
+				erase_count_t r = erase_count_[0];
+				for(erase_block_address_t eb = 1; eb < Storage::ERASE_BLOCKS; eb++) {
+					if(erase_count_[eb] < r) { r = erase_count_[eb]; }
+				}
+				return r;
+			}
+
+			erase_count_t max_erase_count() {
+				erase_count_t r = erase_count_[0];
+				for(erase_block_address_t eb = 1; eb < Storage::ERASE_BLOCKS; eb++) {
+					if(erase_count_[eb] > r) { r = erase_count_[eb]; }
+				}
+				return r;
+			}
+
+			///@}
+
+		private:
+
+			enum { FREE, OPEN, FULL };
+			enum { MAGIC = 0x4c4f4721 };
+
+			Storage& storage() { return *(this->storage_); }
+
+			static address_t erase_block_start(erase_block_address_t a) { return a * Storage::ERASE_BLOCK_SIZE; }
+			static erase_block_address_t erase_block(address_t a) { return a / Storage::ERASE_BLOCK_SIZE; }
+
+			void reset_state() {
+				for(address_t i = 0; i < LOGICAL_BLOCKS; i++) { map_[i] = NO_ADDRESS; }
+				memset(live_map_, 0, sizeof(live_map_));
+				for(erase_block_address_t eb = 0; eb < Storage::ERASE_BLOCKS; eb++) {
+					state_[eb] = FREE;
+					live_[eb] = 0;
+					erase_count_[eb] = 0;
+					modified_[eb] = 0;
+				}
+				free_erase_blocks_ = Storage::ERASE_BLOCKS;
+				write_eb_ = gc_eb_ = victim_ = NO_ADDRESS;
+				write_pos_ = gc_pos_ = victim_pos_ = 0;
+				create_cursor_ = 0;
+				sequence_ = 0;
+				reset_stats();
+			}
+
+			// Block layout
+			// {{{
+
+			template<typename T>
+			static T rd(block_data_t *p) { return wiselib::read<OsModel, block_data_t, T>(p); }
+
+			template<typename T>
+			static void wr(block_data_t *p, T v) { wiselib::write<OsModel, block_data_t, T>(p, v); }
+
+			static address_t tag_address(block_data_t *block) { return rd<address_t>(block); }
+			static sequence_t tag_sequence(block_data_t *block) { return rd<sequence_t>(block + sizeof(address_t)); }
+
+			static void set_tag(block_data_t *block, address_t a, sequence_t s) {
+				wr<address_t>(block, a);
+				wr<sequence_t>(block + sizeof(address_t), s);
+			}
+
+			static block_data_t* payload(block_data_t *block) {
+				return block + sizeof(address_t) + sizeof(sequence_t);
+			}
+
+			static bool is_blank(block_data_t *block) {
+				for(size_type i = 0; i < Storage::BLOCK_SIZE; i++) {
+					if(block[i] != 0xff) { return false; }
+				}
+				return true;
+			}
+
+			// }}}
+
+			// Live block bookkeeping
+			// {{{
+
+			bool is_live(address_t p) { return live_map_[p / 8] & (1 << (p % 8)); }
+
+			void set_live(address_t p) {
+				live_map_[p / 8] |= (1 << (p % 8));
+				live_[erase_block(p)]++;
+			}
+
+			void set_dead(address_t p) {
+				live_map_[p / 8] &= ~(1 << (p % 8));
+				live_[erase_block(p)]--;
+			}
+
+			// }}}
+
+			// Erase block management
+			// {{{
+
+			/**
+			 * Open the free erase block with the lowest erase count for
+			 * appending.
+			 */
+			int open_erase_block(address_t& eb, address_t& pos) {
+				erase_block_address_t best = NO_ADDRESS;
+				for(erase_block_address_t i = 0; i < Storage::ERASE_BLOCKS; i++) {
+					if(state_[i] == FREE && (best == (erase_block_address_t)NO_ADDRESS || erase_count_[i] < erase_count_[best])) {
+						best = i;
+					}
+				}
+				if(best == (erase_block_address_t)NO_ADDRESS) { return ERR_UNSPEC; }
+
+				block_data_t buf[Storage::BLOCK_SIZE];
+				memset(buf, 0xff, Storage::BLOCK_SIZE);
+				wr<sequence_t>(buf, MAGIC);
+				wr<erase_count_t>(buf + sizeof(sequence_t), erase_count_[best]);
+				int r = storage().set(buf, erase_block_start(best));
+				if(r != SUCCESS) { return r; }
+
+				state_[best] = OPEN;
+				free_erase_blocks_--;
+				eb = best;
+				pos = 1;
+				return SUCCESS;
+			}
+
+			/**
+			 * Append @a buf (tagged with logical address @a l) to the open
+			 * erase block @a eb and make it the current version of @a l.
+			 */
+			int append(block_data_t *buf, address_t l, address_t& eb, address_t& pos) {
+				const address_t p = erase_block_start(eb) + pos;
+				int r = storage().set(buf, p);
+				if(r != SUCCESS) { return r; }
+
+				if(map_[l] != NO_ADDRESS) { set_dead(map_[l]); }
+				map_[l] = p;
+				set_live(p);
+
+				sequence_t s = tag_sequence(buf);
+				if(s > modified_[eb]) { modified_[eb] = s; }
+
+				pos++;
+				if(pos == Storage::ERASE_BLOCK_SIZE) {
+					state_[eb] = FULL;
+					eb = NO_ADDRESS;
+				}
+				return SUCCESS;
+			}
+
+			/**
+			 * @return full erase block to collect next or NO_ADDRESS if
+			 * collecting would not gain any space.
+			 */
+			address_t select_victim() {
+				erase_block_address_t best = NO_ADDRESS;
+
+				// Wear leveling moves live data without gaining space, only
+				// do it when not short of free erase blocks
+				if(free_erase_blocks_ > GC_RESERVE && max_erase_count() - min_erase_count() > WEAR_LEVELING_THRESHOLD) {
+					for(erase_block_address_t eb = 0; eb < Storage::ERASE_BLOCKS; eb++) {
+						if(state_[eb] == FULL && (best == (erase_block_address_t)NO_ADDRESS || erase_count_[eb] < erase_count_[best])) {
+							best = eb;
+						}
+					}
+					if(best != (erase_block_address_t)NO_ADDRESS && erase_count_[best] == min_erase_count()) {
+						return best;
+					}
+					best = NO_ADDRESS;
+				}
+
+				::uint32_t best_score = 0;
+				for(erase_block_address_t eb = 0; eb < Storage::ERASE_BLOCKS; eb++) {
+					if(state_[eb] != FULL || live_[eb] >= DATA_BLOCKS) { continue; }
+
+					::uint32_t score;
+					if(policy_ == GC_GREEDY) {
+						score = DATA_BLOCKS - live_[eb];
+					}
+					else {
+						::uint32_t age = sequence_ - modified_[eb];
+						if(age > 0xffff) { age = 0xffff; }
+						score = ((DATA_BLOCKS - live_[eb]) * (age + 1)) / (DATA_BLOCKS + live_[eb]);
+					}
+					if(best == (erase_block_address_t)NO_ADDRESS || score > best_score) {
+						best = eb;
+						best_score = score;
+					}
+				}
+				return best;
+			}
+
+			// }}}
+
+			typename Debug_P::self_pointer_t debug_;
+			typename Timer::self_pointer_t timer_;
+			typename Timer::millis_t gc_interval_;
+			size_type gc_free_target_;
+			GcPolicy policy_;
+
+			address_t map_[LOGICAL_BLOCKS];
+			block_data_t live_map_[(PHYSICAL_BLOCKS + 7) / 8];
+
+			::uint8_t state_[Storage::ERASE_BLOCKS];
+			::uint16_t live_[Storage::ERASE_BLOCKS];
+			erase_count_t erase_count_[Storage::ERASE_BLOCKS];
+			sequence_t modified_[Storage::ERASE_BLOCKS];
+			size_type free_erase_blocks_;
+
+			address_t write_eb_, write_pos_;
+			address_t gc_eb_, gc_pos_;
+			address_t victim_, victim_pos_;
+			address_t create_cursor_;
+			sequence_t sequence_;
+
+			size_type user_writes_;
+			size_type gc_writes_;
+			size_type erases_;
+	};
+
+} // namespace
+
+#endif // LOG_SET_ERASE_TO_SET_WRITE_H
+
+// vim: set ts=4 sw=4 noexpandtab foldenable foldmethod=marker:
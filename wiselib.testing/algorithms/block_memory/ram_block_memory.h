@@ -63,6 +63,10 @@ namespace wiselib {
 				return wipe();
 			}
 			
+			size_type size() {
+				return SIZE;
+			}
+			
 			int wipe() {
 				memset(data_, 0xff, BLOCK_SIZE * SIZE);
 				return SUCCESS;
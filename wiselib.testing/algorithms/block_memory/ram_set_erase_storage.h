@@ -31,7 +31,9 @@ namespace wiselib {
 	 */
 	template<
 		typename OsModel_P,
-		typename Debug_P = typename OsModel_P::Debug
+		typename Debug_P = typename OsModel_P::Debug,
+		int ERASE_BLOCK_SIZE_P = 128,
+		int ERASE_BLOCKS_P = 10
 	>
 	class RamSetEraseStorage {
 		
@@ -43,14 +45,14 @@ namespace wiselib {
 			typedef size_type address_t; /// always refers to a block number
 			typedef size_type erase_block_address_t;
 			
-			typedef RamSetEraseStorage<OsModel> self_type;
+			typedef RamSetEraseStorage<OsModel, Debug, ERASE_BLOCK_SIZE_P, ERASE_BLOCKS_P> self_type;
 			typedef self_type* self_pointer_t;
 			
 			enum {
 				BLOCK_SIZE = 512,
-				SIZE = 128 * 10,
-				ERASE_BLOCK_SIZE = 128,
-				ERASE_BLOCKS = 10,
+				SIZE = ERASE_BLOCK_SIZE_P * ERASE_BLOCKS_P,
+				ERASE_BLOCK_SIZE = ERASE_BLOCK_SIZE_P,
+				ERASE_BLOCKS = ERASE_BLOCKS_P,
 			};
 			
 			enum {
@@ -62,13 +64,25 @@ namespace wiselib {
 				debug_ = debug;
 				//memset(block_data_, 0xff, sizeof(block_data_));
 				erase(0, ERASE_BLOCKS);
+				reset_stats();
 				return SUCCESS;
 			}
 			
+			///@{
+			///@name Operation counters (in blocks / erase blocks)
+			
+			void reset_stats() { reads_ = sets_ = erases_ = 0; }
+			size_type reads() { return reads_; }
+			size_type sets() { return sets_; }
+			size_type erases() { return erases_; }
+			
+			///@}
+			
 			int erase(erase_block_address_t start_block) { return erase(start_block, 1); }
 			
 			int erase(erase_block_address_t start_block, erase_block_address_t blocks) {
 				memset(block_data_ + ERASE_BLOCK_SIZE * BLOCK_SIZE * start_block, 0xff, blocks * ERASE_BLOCK_SIZE * BLOCK_SIZE);
+				erases_ += blocks;
 				return SUCCESS;
 			}
 			
@@ -76,6 +90,7 @@ namespace wiselib {
 				
 			int read(block_data_t* buffer, address_t start_block, address_t blocks) {
 				memcpy(buffer, block_data_ + start_block * BLOCK_SIZE, blocks * BLOCK_SIZE);
+				reads_ += blocks;
 			
 			//printf("read(%d, %d) -> 0x%x 0x%x 0x%x 0x%x...\n",
 				  //start_block, blocks, buffer[0], buffer[1], buffer[2], buffer[3]);
@@ -90,6 +105,7 @@ namespace wiselib {
 				  //buffer[0], buffer[1], buffer[2], buffer[3], start_block, blocks);
 			
 				memcpy(block_data_ + start_block * BLOCK_SIZE, buffer, blocks * BLOCK_SIZE);
+				sets_ += blocks;
 				return SUCCESS;
 			}
 			
@@ -137,6 +153,9 @@ namespace wiselib {
 		private:
 			block_data_t block_data_[BLOCK_SIZE * SIZE];
 			typename Debug::self_pointer_t debug_;
+			size_type reads_;
+			size_type sets_;
+			size_type erases_;
 			
 	}; // RamSetEraseStorage
 }
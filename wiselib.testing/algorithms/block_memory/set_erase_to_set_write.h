@@ -37,6 +37,9 @@ namespace wiselib {
 			typedef Storage_P Storage;
 			typedef EraseBlockMap_P EraseBlockMap;
 			typedef ToSetWriteBase<OsModel, Storage> Base;
+			typedef typename Base::block_data_t block_data_t;
+			typedef typename Base::size_type size_type;
+			typedef typename Base::address_t address_t;
 			typedef typename Storage::erase_block_address_t erase_block_address_t;
 			
 			enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
@@ -65,7 +68,7 @@ namespace wiselib {
 				address_t addr = allocate_blocks(1);
 				if(addr == NO_ADDRESS) { return NO_ADDRESS; }
 				block_data_t buf[Storage::BLOCK_SIZE];
-				memcpy(buf, buffer, BLOCK_SIZE);
+				memcpy(payload(buf), buffer, BLOCK_SIZE);
 				next(buf) = NO_ADDRESS;
 				int r = storage().set(buf, physical_address(addr));
 				if(r != SUCCESS) { return NO_ADDRESS; }
@@ -23,6 +23,7 @@
 #include <util/meta.h>
 
 #include "set_erase_to_set_write.h"
+#include "log_set_erase_to_set_write.h"
 
 namespace wiselib {
 	
@@ -40,15 +41,20 @@ namespace wiselib {
 				has_erase<T, int (T::*)(typename T::erase_block_address_t)>::value;
 		};
 		
-		template<bool IsSetErase, typename OsModel_P, typename Storage_P>
+		template<bool IsSetErase, bool LogStructured, typename OsModel_P, typename Storage_P>
 		struct select_implementation {
 			//typedef WriteToSetWrite impl;
 		};
 		
 		template<typename OsModel_P, typename Storage_P>
-		struct select_implementation<true, OsModel_P, Storage_P> {
+		struct select_implementation<true, false, OsModel_P, Storage_P> {
 			typedef SetEraseToSetWrite<OsModel_P, Storage_P> impl;
 		};
+		
+		template<typename OsModel_P, typename Storage_P>
+		struct select_implementation<true, true, OsModel_P, Storage_P> {
+			typedef LogSetEraseToSetWrite<OsModel_P, Storage_P> impl;
+		};
 	}
 	
 	/**
@@ -56,14 +62,16 @@ namespace wiselib {
 	 * 
 	 * \ingroup
 	 * 
-	 * \tparam 
+	 * \tparam LOG_STRUCTURED_P For set/erase storage, use the
+	 *   log-structured LogSetEraseToSetWrite instead of SetEraseToSetWrite.
 	 */
 	template<
 		typename OsModel_P,
-		typename Storage_P
+		typename Storage_P,
+		bool LOG_STRUCTURED_P = false
 	>
 	class ToSetWrite
-			: public select_implementation<is_set_erase<Storage_P>::value, OsModel_P, Storage_P>::impl {
+			: public select_implementation<is_set_erase<Storage_P>::value, LOG_STRUCTURED_P, OsModel_P, Storage_P>::impl {
 		public:
 		
 		private:
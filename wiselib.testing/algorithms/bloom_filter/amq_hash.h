@@ -0,0 +1,100 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef AMQ_HASH_H
+#define AMQ_HASH_H
+
+#include <external_interface/external_interface.h>
+
+namespace wiselib {
+	
+	/**
+	 * @brief Hash helpers shared by the approximate membership query
+	 * filters (BlockedBloomFilter, CuckooFilter, XorFilter).
+	 * 
+	 * Values are reduced to 32 bit by amq_hash() (value.hash() for class
+	 * types, the value itself for integers), the filters then derive all
+	 * positions and fingerprints from that by the finalizers below, so
+	 * the quality of the value's own hash only matters in so far as
+	 * different values should get different hashes.
+	 */
+	template<typename V>
+	::uint32_t amq_hash(const V& v) { return v.hash(); }
+	
+	inline ::uint32_t amq_hash(::uint8_t v) { return v; }
+	inline ::uint32_t amq_hash(::uint16_t v) { return v; }
+	inline ::uint32_t amq_hash(::uint32_t v) { return v; }
+	inline ::uint32_t amq_hash(::int32_t v) { return v; }
+	
+	/// MurmurHash3 32 bit finalizer, a bijection.
+	inline ::uint32_t amq_mix32(::uint32_t h) {
+		h ^= h >> 16;
+		h *= 0x85ebca6bUL;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35UL;
+		h ^= h >> 16;
+		return h;
+	}
+	
+	/// A second, independent finalizer (constants of the lowbias32 hash).
+	inline ::uint32_t amq_remix32(::uint32_t h) {
+		h ^= h >> 16;
+		h *= 0x7feb352dUL;
+		h ^= h >> 15;
+		h *= 0x846ca68bUL;
+		h ^= h >> 16;
+		return h;
+	}
+	
+	/**
+	 * Map @a h uniformly to [0, n) without a division
+	 * (Lemire's multiply-shift "fastrange").
+	 */
+	inline ::uint32_t amq_reduce(::uint32_t h, ::uint32_t n) {
+		return (::uint32_t)(((::uint64_t)h * n) >> 32);
+	}
+	
+	/// Number of set bits
+	inline ::uint8_t amq_popcount(::uint32_t x) {
+		#if defined(__GNUC__)
+			return __builtin_popcountl(x);
+		#else
+			x = x - ((x >> 1) & 0x55555555UL);
+			x = (x & 0x33333333UL) + ((x >> 2) & 0x33333333UL);
+			x = (x + (x >> 4)) & 0x0f0f0f0fUL;
+			return (x * 0x01010101UL) >> 24;
+		#endif
+	}
+	
+	/**
+	 * Natural logarithm for 0 < y <= 1, good to about 4 digits; for
+	 * cardinality estimates on targets without libm.
+	 */
+	inline float amq_ln(float y) {
+		int e = 0;
+		while(y < 0.5f) { y *= 2.0f; e--; }
+		float z = (y - 1.0f) / (y + 1.0f);
+		float z2 = z * z;
+		return z * (2.0f + z2 * (2.0f / 3.0f + z2 * (2.0f / 5.0f + z2 * (2.0f / 7.0f)))) + e * 0.6931472f;
+	}
+}
+
+#endif // AMQ_HASH_H
+
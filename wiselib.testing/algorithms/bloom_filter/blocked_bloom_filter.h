@@ -0,0 +1,276 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef BLOCKED_BLOOM_FILTER_H
+#define BLOCKED_BLOOM_FILTER_H
+
+#include <util/meta.h>
+#include "amq_hash.h"
+
+namespace wiselib {
+	
+	/**
+	 * @brief Bloom filter with k hash functions and a blocked layout.
+	 * 
+	 * Same interface as BloomFilter (insert(), contains(), |=, ==, data())
+	 * and can be used in its place, but sets @a Hashes_P bits per element
+	 * (derived from amq_hash(value) by double hashing, h1 + i * h2), which
+	 * for a well chosen k (about 0.7 * bits per element) gives a much
+	 * lower false positive rate at the same size.
+	 * 
+	 * The filter consists of blocks of @a BlockWords_P words, an element
+	 * sets all its bits inside one block:
+	 * - BlockWords_P = 1: register blocked, insert() and contains() are a
+	 *   single word access,
+	 * - BlockWords_P = 64 bytes / sizeof(Word_P): one cache line,
+	 * - BlockWords_P = WORDS: classic unblocked filter (best false
+	 *   positive rate, for small filters like the ones sent in beacons).
+	 * Smaller blocks are faster but fill unevenly and so have a somewhat
+	 * higher false positive rate at the same size.
+	 * 
+	 * Union, intersection and popcount work on whole words. On PC the
+	 * loops are simple enough for the compiler to vectorize them.
+	 * 
+	 * The bit layout is independent of the word size and byte order
+	 * (bit n is bit n % 8 of byte n / 8, as in BloomFilter) so data() can
+	 * be exchanged between different platforms.
+	 * 
+	 * @ingroup container_concept
+	 * 
+	 * @tparam Size_P Minimum size in bits, rounded up to whole blocks
+	 * @tparam Hashes_P Number of bits set per element (k)
+	 * @tparam BlockWords_P Words per block, a power of 2
+	 * @tparam Word_P Unsigned integer type used for bit operations
+	 */
+	template<
+		typename OsModel_P,
+		typename Value_P,
+		int Size_P,
+		int Hashes_P = 3,
+		int BlockWords_P = 1,
+		typename Word_P = ::uint32_t
+	>
+	class BlockedBloomFilter {
+		
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef Value_P value_type;
+			typedef Word_P word_type;
+			typedef BlockedBloomFilter self_type;
+			
+			enum {
+				HASHES = Hashes_P,
+				WORD_BITS = 8 * sizeof(Word_P),
+				BLOCK_WORDS = BlockWords_P,
+				BLOCK_BITS = WORD_BITS * BLOCK_WORDS,
+				BLOCKS = DivCeil<Size_P, BLOCK_BITS>::value,
+				WORDS = BLOCKS * BLOCK_WORDS,
+				SIZE = WORDS * WORD_BITS,
+				SIZE_BYTES = WORDS * sizeof(Word_P)
+			};
+			
+			BlockedBloomFilter() {
+				clear();
+			}
+			
+			/**
+			 * Remove all elements from the filter.
+			 */
+			void clear() {
+				for(size_type i = 0; i < WORDS; i++) { data_[i] = 0; }
+			}
+			
+			/**
+			 * Insert element into the filter.
+			 */
+			void insert(const value_type& v) {
+				add(amq_hash(v));
+			}
+			
+			/**
+			 * Return true if v is in the set. If v is not in the set, this
+			 * may either return true or false.
+			 */
+			bool contains(const value_type& v) const {
+				return test(amq_hash(v));
+			}
+			
+			/**
+			 * Direct interface: Insert an element by its 32 bit hash.
+			 */
+			void add(::uint32_t h) {
+				::uint32_t h1, h2;
+				word_type *block = data_ + locate(h, h1, h2);
+				if(BLOCK_WORDS == 1) {
+					block[0] |= mask(h1, h2);
+					return;
+				}
+				for(size_type i = 0; i < HASHES; i++, h1 += h2) {
+					::uint32_t p = h1 % BLOCK_BITS;
+					block[p / WORD_BITS] |= bit(p % WORD_BITS);
+				}
+			}
+			
+			/**
+			 * Direct interface: Test for an element by its 32 bit hash.
+			 */
+			bool test(::uint32_t h) const {
+				::uint32_t h1, h2;
+				const word_type *block = data_ + locate(h, h1, h2);
+				if(BLOCK_WORDS == 1) {
+					word_type m = mask(h1, h2);
+					return (block[0] & m) == m;
+				}
+				for(size_type i = 0; i < HASHES; i++, h1 += h2) {
+					::uint32_t p = h1 % BLOCK_BITS;
+					if(!(block[p / WORD_BITS] & bit(p % WORD_BITS))) { return false; }
+				}
+				return true;
+			}
+			
+			/**
+			 * Add all elements of given filter to this one.
+			 */
+			self_type& operator|=(const self_type& other) {
+				for(size_type i = 0; i < WORDS; i++) { data_[i] |= other.data_[i]; }
+				return *this;
+			}
+			
+			/**
+			 * Keep only bits also set in @a other. The result contains
+			 * (at least) the elements of the intersection, it may have a
+			 * higher false positive rate than a filter built from the
+			 * intersection directly.
+			 */
+			self_type& operator&=(const self_type& other) {
+				for(size_type i = 0; i < WORDS; i++) { data_[i] &= other.data_[i]; }
+				return *this;
+			}
+			
+			/**
+			 * @return false if the filters certainly have no element in
+			 * common.
+			 */
+			bool intersects(const self_type& other) const {
+				word_type r = 0;
+				for(size_type i = 0; i < WORDS; i++) { r |= data_[i] & other.data_[i]; }
+				return r != 0;
+			}
+			
+			/**
+			 * @return number of bits set.
+			 */
+			size_type count() const {
+				size_type r = 0;
+				for(size_type i = 0; i < WORDS; i++) { r += popcount(data_[i]); }
+				return r;
+			}
+			
+			/**
+			 * Estimated number of distinct elements inserted,
+			 * -SIZE / HASHES * ln(1 - count() / SIZE).
+			 */
+			size_type estimate_size() const {
+				return estimate(count());
+			}
+			
+			/**
+			 * Estimated number of distinct elements in the union of both
+			 * filters, without building it.
+			 */
+			size_type estimate_union_size(const self_type& other) const {
+				size_type c = 0;
+				for(size_type i = 0; i < WORDS; i++) { c += popcount(data_[i] | other.data_[i]); }
+				return estimate(c);
+			}
+			
+			/**
+			 * @return pointer to the raw bit data (SIZE_BYTES bytes).
+			 */
+			block_data_t* data() { return reinterpret_cast<block_data_t*>(data_); }
+			
+			///
+			bool operator==(const self_type& other) const {
+				for(size_type i = 0; i < WORDS; i++) {
+					if(data_[i] != other.data_[i]) { return false; }
+				}
+				return true;
+			}
+			
+			///
+			bool operator!=(const self_type& other) const {
+				return !(*this == other);
+			}
+			
+		private:
+			
+			/**
+			 * Index of the first word of the block of @a h, sets @a h1
+			 * and @a h2 (odd, so the HASHES probes are distinct).
+			 */
+			static size_type locate(::uint32_t h, ::uint32_t& h1, ::uint32_t& h2) {
+				::uint32_t a = amq_mix32(h);
+				h1 = amq_remix32(h);
+				h2 = amq_mix32(h1) | 1;
+				return (BLOCKS == 1) ? 0 : amq_reduce(a, BLOCKS) * BLOCK_WORDS;
+			}
+			
+			static word_type mask(::uint32_t h1, ::uint32_t h2) {
+				word_type m = 0;
+				for(size_type i = 0; i < HASHES; i++, h1 += h2) {
+					m |= bit(h1 % WORD_BITS);
+				}
+				return m;
+			}
+			
+			/**
+			 * Word with bit @a n set, such that in memory it is bit n % 8
+			 * of byte n / 8 regardless of the byte order.
+			 */
+			static word_type bit(::uint32_t n) {
+				if(OsModel::endianness == WISELIB_LITTLE_ENDIAN || sizeof(word_type) == 1) {
+					return (word_type)1 << n;
+				}
+				return (word_type)1 << ((sizeof(word_type) - 1 - n / 8) * 8 + n % 8);
+			}
+			
+			static size_type popcount(word_type w) {
+				size_type r = 0;
+				for(size_type i = 0; i < sizeof(word_type); i += 4) {
+					r += amq_popcount((::uint32_t)(w >> (i * 8)));
+				}
+				return r;
+			}
+			
+			static size_type estimate(size_type bits) {
+				if(bits >= SIZE) { return (size_type)-1; }
+				float n = -(float)SIZE / HASHES * amq_ln(1.0f - (float)bits / SIZE);
+				return (size_type)(n + 0.5f);
+			}
+			
+			word_type data_[WORDS];
+		
+	}; // BlockedBloomFilter
+}
+
+#endif // BLOCKED_BLOOM_FILTER_H
+
@@ -0,0 +1,296 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef CUCKOO_FILTER_H
+#define CUCKOO_FILTER_H
+
+#include <util/meta.h>
+#include "amq_hash.h"
+
+namespace wiselib {
+	
+	/**
+	 * @brief Cuckoo filter: approximate membership with deletion.
+	 * 
+	 * Stores a fingerprint of every element in one of two buckets of
+	 * @a SLOTS_P entries (partial-key cuckoo hashing: the alternative
+	 * bucket is computed from the bucket and the fingerprint only, so
+	 * entries can be moved without knowing the element). Offers the same
+	 * interface as BloomFilter plus erase(); for a false positive rate
+	 * below about 3% it needs less space than a Bloom filter.
+	 * 
+	 * False positive rate is about 2 * SLOTS / 2^(fingerprint bits),
+	 * the table can be filled to about 95% with 4 slots per bucket.
+	 * When insert() can not find a place after @a MaxKicks_P relocations
+	 * the last displaced fingerprint is kept in a one entry stash (so
+	 * there are never false negatives), further inserts fail until an
+	 * erase() makes room.
+	 * 
+	 * erase() must only be called for elements that have been inserted,
+	 * otherwise another element with the same fingerprint may be removed.
+	 * Inserting the same element twice stores it twice.
+	 * 
+	 * @ingroup container_concept
+	 * 
+	 * @tparam Buckets_P Number of buckets, a power of 2
+	 * @tparam Fingerprint_P Unsigned integer type of the fingerprints
+	 * @tparam SLOTS_P Fingerprints per bucket
+	 * @tparam MaxKicks_P Relocations before an insert gives up
+	 */
+	template<
+		typename OsModel_P,
+		typename Value_P,
+		int Buckets_P,
+		typename Fingerprint_P = ::uint8_t,
+		int SLOTS_P = 4,
+		int MaxKicks_P = 500
+	>
+	class CuckooFilter {
+		
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef Value_P value_type;
+			typedef Fingerprint_P fingerprint_t;
+			typedef CuckooFilter self_type;
+			
+			enum {
+				SUCCESS = OsModel::SUCCESS,
+				ERR_NOMEM = OsModel::ERR_NOMEM
+			};
+			
+			enum {
+				BUCKETS = Buckets_P,
+				SLOTS = SLOTS_P,
+				ENTRIES = BUCKETS * SLOTS,
+				FINGERPRINT_BITS = 8 * sizeof(Fingerprint_P),
+				MAX_KICKS = MaxKicks_P,
+				SIZE_BYTES = ENTRIES * sizeof(Fingerprint_P)
+			};
+			
+			CuckooFilter() {
+				clear();
+			}
+			
+			/**
+			 * Remove all elements from the filter.
+			 */
+			void clear() {
+				for(size_type i = 0; i < ENTRIES; i++) { table_[i] = 0; }
+				stash_ = 0;
+				stash_bucket_ = 0;
+				size_ = 0;
+			}
+			
+			/**
+			 * Insert element into the filter.
+			 * @return SUCCESS or ERR_NOMEM if the filter is full.
+			 */
+			int insert(const value_type& v) {
+				return add(amq_hash(v));
+			}
+			
+			/**
+			 * Return true if v is in the set. If v is not in the set, this
+			 * may either return true or false.
+			 */
+			bool contains(const value_type& v) const {
+				return test(amq_hash(v));
+			}
+			
+			/**
+			 * Remove an element that has been inserted before.
+			 * @return true if a matching fingerprint was removed.
+			 */
+			bool erase(const value_type& v) {
+				return remove(amq_hash(v));
+			}
+			
+			/**
+			 * Direct interface: Insert an element by its 32 bit hash.
+			 */
+			int add(::uint32_t h) {
+				size_type i;
+				fingerprint_t f = fingerprint(h, i);
+				return place(i, f);
+			}
+			
+			/**
+			 * Direct interface: Test for an element by its 32 bit hash.
+			 */
+			bool test(::uint32_t h) const {
+				size_type i;
+				fingerprint_t f = fingerprint(h, i);
+				size_type j = alternate(i, f);
+				if(stash_ == f && (stash_bucket_ == i || stash_bucket_ == j)) { return true; }
+				return find(i, f) != ENTRIES || find(j, f) != ENTRIES;
+			}
+			
+			/**
+			 * Direct interface: Remove an element by its 32 bit hash.
+			 */
+			bool remove(::uint32_t h) {
+				size_type i;
+				fingerprint_t f = fingerprint(h, i);
+				size_type j = alternate(i, f);
+				size_type e = find(i, f);
+				if(e == ENTRIES) { e = find(j, f); }
+				if(e != ENTRIES) {
+					table_[e] = 0;
+					size_--;
+					// move the stashed entry back into the table
+					if(stash_) {
+						fingerprint_t s = stash_;
+						stash_ = 0;
+						size_--;
+						place(stash_bucket_, s);
+					}
+					return true;
+				}
+				if(stash_ == f && (stash_bucket_ == i || stash_bucket_ == j)) {
+					stash_ = 0;
+					size_--;
+					return true;
+				}
+				return false;
+			}
+			
+			/**
+			 * Add all elements of given filter to this one by re-inserting
+			 * its fingerprints.
+			 * @return SUCCESS or ERR_NOMEM if not all of them fit.
+			 */
+			int merge(const self_type& other) {
+				int r = SUCCESS;
+				for(size_type e = 0; e < ENTRIES; e++) {
+					if(other.table_[e] && place(e / SLOTS, other.table_[e]) != SUCCESS) { r = ERR_NOMEM; }
+				}
+				if(other.stash_ && place(other.stash_bucket_, other.stash_) != SUCCESS) { r = ERR_NOMEM; }
+				return r;
+			}
+			
+			/**
+			 * Same as merge(), for compatibility with BloomFilter.
+			 */
+			self_type& operator|=(const self_type& other) {
+				merge(other);
+				return *this;
+			}
+			
+			/// Number of fingerprints stored
+			size_type size() const { return size_; }
+			
+			/// true if the stash is in use, that is, the next insert fails
+			bool full() const { return stash_ != 0; }
+			
+			/**
+			 * @return pointer to the raw data (SIZE_BYTES bytes).
+			 */
+			block_data_t* data() { return reinterpret_cast<block_data_t*>(table_); }
+			
+			///
+			bool operator==(const self_type& other) const {
+				for(size_type i = 0; i < ENTRIES; i++) {
+					if(table_[i] != other.table_[i]) { return false; }
+				}
+				return stash_ == other.stash_ && (!stash_ || stash_bucket_ == other.stash_bucket_);
+			}
+			
+			///
+			bool operator!=(const self_type& other) const {
+				return !(*this == other);
+			}
+			
+		private:
+			
+			/**
+			 * Fingerprint (never 0, that marks empty slots) and first
+			 * bucket of an element.
+			 */
+			static fingerprint_t fingerprint(::uint32_t h, size_type& bucket) {
+				::uint32_t a = amq_mix32(h);
+				bucket = a & (BUCKETS - 1);
+				::uint32_t b = amq_remix32(h);
+				fingerprint_t f = (fingerprint_t)b;
+				// map 0 to something else instead of rehashing, slightly
+				// skews the distribution but costs no loop
+				return f ? f : (fingerprint_t)(b >> (FINGERPRINT_BITS / 2) | 1);
+			}
+			
+			/**
+			 * The other bucket for fingerprint @a f in bucket @a i.
+			 * An involution: alternate(alternate(i, f), f) == i.
+			 */
+			static size_type alternate(size_type i, fingerprint_t f) {
+				return (i ^ amq_mix32(f)) & (BUCKETS - 1);
+			}
+			
+			/// Index of the entry with fingerprint @a f in bucket @a i or ENTRIES
+			size_type find(size_type i, fingerprint_t f) const {
+				for(size_type e = i * SLOTS; e < (i + 1) * SLOTS; e++) {
+					if(table_[e] == f) { return e; }
+				}
+				return ENTRIES;
+			}
+			
+			bool put(size_type i, fingerprint_t f) {
+				size_type e = find(i, 0);
+				if(e == ENTRIES) { return false; }
+				table_[e] = f;
+				return true;
+			}
+			
+			/**
+			 * Store @a f in bucket @a i or its alternate, relocating
+			 * other entries as needed.
+			 */
+			int place(size_type i, fingerprint_t f) {
+				if(stash_) { return ERR_NOMEM; }
+				size_++;
+				size_type j = alternate(i, f);
+				if(put(i, f) || put(j, f)) { return SUCCESS; }
+				
+				// Kick out a pseudo randomly chosen entry, the choice only
+				// depends on the fingerprint and the number of kicks so far
+				i = (amq_remix32(f) & 1) ? i : j;
+				for(size_type kick = 0; kick < MAX_KICKS; kick++) {
+					size_type e = i * SLOTS + amq_mix32(f + kick) % SLOTS;
+					fingerprint_t victim = table_[e];
+					table_[e] = f;
+					f = victim;
+					i = alternate(i, f);
+					if(put(i, f)) { return SUCCESS; }
+				}
+				stash_ = f;
+				stash_bucket_ = i;
+				return SUCCESS;
+			}
+			
+			fingerprint_t table_[ENTRIES];
+			fingerprint_t stash_;
+			size_type stash_bucket_;
+			size_type size_;
+		
+	}; // CuckooFilter
+}
+
+#endif // CUCKOO_FILTER_H
+
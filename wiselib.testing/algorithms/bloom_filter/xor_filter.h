@@ -0,0 +1,281 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef XOR_FILTER_H
+#define XOR_FILTER_H
+
+#include <util/meta.h>
+#include <util/pstl/algorithm.h>
+#include "amq_hash.h"
+
+namespace wiselib {
+	
+	/**
+	 * @brief Static xor filter (Graf & Lemire): approximate membership
+	 * for a set that is known in advance.
+	 * 
+	 * Each element is mapped to three table slots (one in each third of
+	 * the table), build() chooses the slot contents so that the xor of
+	 * the three slots is the element's fingerprint. contains() is three
+	 * reads and a compare. Needs about 1.23 * fingerprint bits per
+	 * element for a false positive rate of 2^-(fingerprint bits), which is
+	 * less than a Bloom or cuckoo filter with the same rate.
+	 * 
+	 * The set can not be changed after build(), build a new filter
+	 * instead (e.g. on the sink or PC) and distribute data().
+	 * build() uses get_allocator() for temporary arrays (about
+	 * 16 bytes per table slot), contains() needs no allocator.
+	 * 
+	 * @ingroup container_concept
+	 * 
+	 * @tparam Capacity_P Maximum number of elements
+	 * @tparam Fingerprint_P Unsigned integer type of the fingerprints
+	 */
+	template<
+		typename OsModel_P,
+		typename Value_P,
+		int Capacity_P,
+		typename Fingerprint_P = ::uint8_t
+	>
+	class XorFilter {
+		
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef Value_P value_type;
+			typedef Fingerprint_P fingerprint_t;
+			typedef XorFilter self_type;
+			
+			enum {
+				SUCCESS = OsModel::SUCCESS,
+				ERR_UNSPEC = OsModel::ERR_UNSPEC,
+				ERR_NOMEM = OsModel::ERR_NOMEM
+			};
+			
+			enum {
+				CAPACITY = Capacity_P,
+				SEGMENT = DivCeil<Capacity_P * 123UL / 100 + 32, 3>::value,
+				SLOTS = 3 * SEGMENT,
+				FINGERPRINT_BITS = 8 * sizeof(Fingerprint_P),
+				SIZE_BYTES = SLOTS * sizeof(Fingerprint_P),
+				MAX_ATTEMPTS = 32
+			};
+			
+			XorFilter() {
+				clear();
+			}
+			
+			/**
+			 * Make this the filter of the empty set.
+			 */
+			void clear() {
+				for(size_type i = 0; i < SLOTS; i++) { table_[i] = 0; }
+				seed_ = 0;
+				size_ = 0;
+			}
+			
+			/**
+			 * Build the filter for the @a n given values, replaces the
+			 * current contents.
+			 * @return SUCCESS, ERR_NOMEM if n > CAPACITY or the
+			 * temporary arrays could not be allocated, ERR_UNSPEC if no
+			 * working hash seed was found (practically impossible).
+			 */
+			int build(const value_type *values, size_type n) {
+				if(n > CAPACITY) { return ERR_NOMEM; }
+				::uint32_t *hashes = ::get_allocator().template allocate_array< ::uint32_t>(n ? n : 1).raw();
+				if(!hashes) { return ERR_NOMEM; }
+				for(size_type i = 0; i < n; i++) { hashes[i] = amq_hash(values[i]); }
+				int r = build_hashes(hashes, n);
+				::get_allocator().free_array(hashes);
+				return r;
+			}
+			
+			/**
+			 * Direct interface: Build from 32 bit hashes of the elements.
+			 * @a hashes will be sorted and deduplicated in place.
+			 */
+			int build_hashes(::uint32_t *hashes, size_type n) {
+				clear();
+				if(n > CAPACITY) { return ERR_NOMEM; }
+				if(n == 0) { return SUCCESS; }
+				
+				// Equal hashes would never peel, and are the same element
+				// as far as the filter is concerned anyway.
+				sort(hashes, hashes + n);
+				n = unique(hashes, hashes + n) - hashes;
+				
+				Scratch *scratch = ::get_allocator().template allocate_array<Scratch>(SLOTS).raw();
+				Peeled *stack = ::get_allocator().template allocate_array<Peeled>(n).raw();
+				size_type *queue = ::get_allocator().template allocate_array<size_type>(SLOTS).raw();
+				int r = ERR_NOMEM;
+				if(scratch && stack && queue) {
+					r = ERR_UNSPEC;
+					for(size_type attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+						seed_ = amq_mix32(attempt + 0x9e3779b9UL);
+						if(peel(hashes, n, scratch, stack, queue)) {
+							assign(stack, n);
+							size_ = n;
+							r = SUCCESS;
+							break;
+						}
+					}
+				}
+				if(queue) { ::get_allocator().free_array(queue); }
+				if(stack) { ::get_allocator().free_array(stack); }
+				if(scratch) { ::get_allocator().free_array(scratch); }
+				if(r != SUCCESS) { clear(); }
+				return r;
+			}
+			
+			/**
+			 * Return true if v is in the set. If v is not in the set, this
+			 * may either return true or false.
+			 */
+			bool contains(const value_type& v) const {
+				return test(amq_hash(v));
+			}
+			
+			/**
+			 * Direct interface: Test for an element by its 32 bit hash.
+			 */
+			bool test(::uint32_t h) const {
+				if(size_ == 0) { return false; }
+				size_type p[3];
+				fingerprint_t f = locate(h, p);
+				return f == (fingerprint_t)(table_[p[0]] ^ table_[p[1]] ^ table_[p[2]]);
+			}
+			
+			/// Number of distinct elements the filter was built from
+			size_type size() const { return size_; }
+			
+			/**
+			 * @return pointer to the raw table (SIZE_BYTES bytes).
+			 * The hash seed (seed()) is needed as well to use it.
+			 */
+			block_data_t* data() { return reinterpret_cast<block_data_t*>(table_); }
+			::uint32_t seed() const { return seed_; }
+			
+			///
+			bool operator==(const self_type& other) const {
+				if(seed_ != other.seed_ || size_ != other.size_) { return false; }
+				for(size_type i = 0; i < SLOTS; i++) {
+					if(table_[i] != other.table_[i]) { return false; }
+				}
+				return true;
+			}
+			
+			///
+			bool operator!=(const self_type& other) const {
+				return !(*this == other);
+			}
+			
+		private:
+			
+			struct Scratch {
+				::uint32_t count;
+				::uint32_t hashes; // xor of the hashes mapped here
+			};
+			
+			struct Peeled {
+				::uint32_t hash;
+				size_type slot;
+			};
+			
+			/**
+			 * The three slots of @a h (one per segment) and its
+			 * fingerprint.
+			 */
+			fingerprint_t locate(::uint32_t h, size_type *p) const {
+				::uint32_t x = amq_mix32(h ^ seed_);
+				::uint32_t y = amq_remix32(x + seed_);
+				::uint32_t z = amq_mix32(x ^ y);
+				p[0] = amq_reduce(x, SEGMENT);
+				p[1] = SEGMENT + amq_reduce(y, SEGMENT);
+				p[2] = 2 * SEGMENT + amq_reduce(z, SEGMENT);
+				return (fingerprint_t)amq_remix32(z ^ h);
+			}
+			
+			/**
+			 * Repeatedly remove an element that is the only one in one of
+			 * its slots, recording (element, slot) on @a stack.
+			 * @return true if all elements could be removed.
+			 */
+			bool peel(const ::uint32_t *hashes, size_type n, Scratch *scratch, Peeled *stack, size_type *queue) {
+				for(size_type i = 0; i < SLOTS; i++) {
+					scratch[i].count = 0;
+					scratch[i].hashes = 0;
+				}
+				size_type p[3];
+				for(size_type i = 0; i < n; i++) {
+					locate(hashes[i], p);
+					for(int j = 0; j < 3; j++) {
+						scratch[p[j]].count++;
+						scratch[p[j]].hashes ^= hashes[i];
+					}
+				}
+				
+				size_type queued = 0;
+				for(size_type i = 0; i < SLOTS; i++) {
+					if(scratch[i].count == 1) { queue[queued++] = i; }
+				}
+				
+				size_type peeled = 0;
+				while(queued) {
+					size_type s = queue[--queued];
+					if(scratch[s].count != 1) { continue; }
+					::uint32_t h = scratch[s].hashes;
+					stack[peeled].hash = h;
+					stack[peeled].slot = s;
+					peeled++;
+					locate(h, p);
+					for(int j = 0; j < 3; j++) {
+						scratch[p[j]].count--;
+						scratch[p[j]].hashes ^= h;
+						if(scratch[p[j]].count == 1) { queue[queued++] = p[j]; }
+					}
+				}
+				return peeled == n;
+			}
+			
+			/**
+			 * In reverse peeling order each element's own slot is still
+			 * free, set it so the three slots xor to the fingerprint.
+			 */
+			void assign(const Peeled *stack, size_type n) {
+				size_type p[3];
+				for(size_type i = n; i > 0; i--) {
+					const Peeled& e = stack[i - 1];
+					fingerprint_t f = locate(e.hash, p);
+					table_[e.slot] = 0;
+					table_[e.slot] = f ^ table_[p[0]] ^ table_[p[1]] ^ table_[p[2]];
+				}
+			}
+			
+			fingerprint_t table_[SLOTS];
+			::uint32_t seed_;
+			size_type size_;
+		
+	}; // XorFilter
+}
+
+#endif // XOR_FILTER_H
+
@@ -58,15 +58,17 @@ public:
 	EdgesSize num_edges();
 	VertexIteratorRange vertices();
 	EdgeIteratorRange edges();
-	VertexDescriptor add_vertex();
-	EdgeDescriptor add_edge(VertexDescriptor,VertexDescriptor);
+	/// Descriptor of the vertex in slot @a i (see VertexDescriptor::index())
+	VertexDescriptor vertex(VerticesSize i);
+	VertexDescriptor add_vertex(VertexData const &data=VertexData());
+	EdgeDescriptor add_edge(VertexDescriptor,VertexDescriptor,EdgeData const &data=EdgeData());
 	void remove_vertex(VertexDescriptor,bool remove_edges=false);
 	void remove_edge(EdgeDescriptor);
 
 	static VerticesSize const max_vertices=N;
 	static EdgesSize const max_edges=M;
-	static VertexDescriptor const null_vertex;
-	static EdgeDescriptor const null_edge;
+	VertexDescriptor null_vertex();
+	EdgeDescriptor null_edge();
 
 private:
 	struct VertexEntry;
@@ -173,6 +175,11 @@ public:
 	VertexData operator*();
 	bool operator==(VertexDescriptor);
 	bool operator!=(VertexDescriptor);
+	/**
+	 * Slot of this vertex in the vertex array, in [0, max_vertices).
+	 * Stable as long as the vertex is not removed.
+	 */
+	VerticesSize index() const { return v; }
 
 protected:
 	VertexDescriptor(AdjacencyList &);
@@ -182,6 +189,7 @@ protected:
 	VerticesSize v;
 
 	friend class AdjacencyList;
+	friend class EdgeDescriptor;
 	friend class OutEdgeIterator;
 	friend class InEdgeIterator;
 };
@@ -290,6 +298,8 @@ public:
 	EdgeData operator*();
 	bool operator==(EdgeDescriptor);
 	bool operator!=(EdgeDescriptor);
+	/// Slot of this edge in the edge array, in [0, max_edges).
+	EdgesSize index() const { return e; }
 
 protected:
 	EdgeDescriptor(AdjacencyList &);
@@ -406,8 +416,8 @@ template<class OsModel_P,
 	class VData,
 	class EData>
 typename AdjacencyList<OsModel_P,N,M,VData,EData>::VertexIterator AdjacencyList<OsModel_P,N,M,VData,EData>::VertexIterator::operator++(){
-	if(operator!=(null_vertex))
-		VertexDescriptor::v=vertex_set[VertexDescriptor::v].next;
+	if(VertexDescriptor::v!=max_vertices)
+		VertexDescriptor::v=VertexDescriptor::g.vertex_set[VertexDescriptor::v].next;
 	return *this;
 }
 
@@ -451,8 +461,8 @@ template<class OsModel_P,
 	class VData,
 	class EData>
 typename AdjacencyList<OsModel_P,N,M,VData,EData>::EdgeIterator AdjacencyList<OsModel_P,N,M,VData,EData>::EdgeIterator::operator++(){
-	if(operator!=(null_edge))
-		EdgeDescriptor::e=edge_set[EdgeDescriptor::e].next;
+	if(EdgeDescriptor::e!=max_edges)
+		EdgeDescriptor::e=EdgeDescriptor::g.edge_set[EdgeDescriptor::e].next;
 	return *this;
 }
 
@@ -472,6 +482,7 @@ private:
 	VertexDescriptor &v;
 
 	friend class AdjacencyList;
+	friend class VertexDescriptor;
 };
 
 template<class OsModel_P,
@@ -500,8 +511,8 @@ template<class OsModel_P,
 	class VData,
 	class EData>
 typename AdjacencyList<OsModel_P,N,M,VData,EData>::VertexDescriptor::OutEdgeIterator AdjacencyList<OsModel_P,N,M,VData,EData>::VertexDescriptor::OutEdgeIterator::operator++(){
-	if(operator!=(null_edge))
-		EdgeDescriptor::e=edge_set[EdgeDescriptor::e].next_out;
+	if(EdgeDescriptor::e!=max_edges)
+		EdgeDescriptor::e=EdgeDescriptor::g.edge_set[EdgeDescriptor::e].next_out;
 	return *this;
 }
 
@@ -521,6 +532,7 @@ private:
 	VertexDescriptor &v;
 
 	friend class AdjacencyList;
+	friend class VertexDescriptor;
 };
 
 template<class OsModel_P,
@@ -549,8 +561,8 @@ template<class OsModel_P,
 	class VData,
 	class EData>
 typename AdjacencyList<OsModel_P,N,M,VData,EData>::VertexDescriptor::InEdgeIterator AdjacencyList<OsModel_P,N,M,VData,EData>::VertexDescriptor::InEdgeIterator::operator++(){
-	if(operator!=(null_edge))
-		EdgeDescriptor::e=edge_set[EdgeDescriptor::e].next_in;
+	if(EdgeDescriptor::e!=max_edges)
+		EdgeDescriptor::e=EdgeDescriptor::g.edge_set[EdgeDescriptor::e].next_in;
 	return *this;
 }
 
@@ -595,9 +607,9 @@ template<class OsModel_P,
 	typename OsModel_P::size_t M,
 	class VData,
 	class EData>
-typename AdjacencyList<OsModel_P,N,M,VData,EData>::VertexDescriptor AdjacencyList<OsModel_P,N,M,VData,EData>::add_vertex() {
+typename AdjacencyList<OsModel_P,N,M,VData,EData>::VertexDescriptor AdjacencyList<OsModel_P,N,M,VData,EData>::add_vertex(VertexData const &data) {
 	if(nvertices==max_vertices)
-		return null_vertex;
+		return null_vertex();
 	++nvertices;
 	VerticesSize const v=first_unused_vertex;
 	first_unused_vertex=vertex_set[v].next;
@@ -608,6 +620,7 @@ typename AdjacencyList<OsModel_P,N,M,VData,EData>::VertexDescriptor AdjacencyLis
 	first_vertex=v;
 	vertex_set[v].out_edges=vertex_set[v].in_edges=max_edges;
 	vertex_set[v].in_degree=vertex_set[v].out_degree=0;
+	vertex_set[v].data=data;
 	return VertexDescriptor(*this,v);
 }
 
@@ -616,17 +629,18 @@ template<class OsModel_P,
 	typename OsModel_P::size_t M,
 	class VData,
 	class EData>
-typename AdjacencyList<OsModel_P,N,M,VData,EData>::EdgeDescriptor AdjacencyList<OsModel_P,N,M,VData,EData>::add_edge(VertexDescriptor source,VertexDescriptor target) {
-	if(nedges==max_edges||source==null_vertex||target==null_vertex)
-		return null_edge;
+typename AdjacencyList<OsModel_P,N,M,VData,EData>::EdgeDescriptor AdjacencyList<OsModel_P,N,M,VData,EData>::add_edge(VertexDescriptor source,VertexDescriptor target,EdgeData const &data) {
+	if(nedges==max_edges||source.v==max_vertices||target.v==max_vertices)
+		return null_edge();
 	EdgesSize const e=first_unused_edge;
 	first_unused_edge=edge_set[e].next;
 	edge_set[e].source=source.v;
 	edge_set[e].target=target.v;
+	edge_set[e].data=data;
 	edge_set[e].prev=max_edges;
-	edge_set[e].next_out=first_edge;
+	edge_set[e].next=first_edge;
 	if(first_edge!=max_edges)
-		edge_set[first_edge].prev_out=e;
+		edge_set[first_edge].prev=e;
 	first_edge=e;
 	++nedges;
 	edge_set[e].prev_out=max_edges;
@@ -656,12 +670,9 @@ template<class OsModel_P,
 	class VData,
 	class EData>
 void AdjacencyList<OsModel_P,N,M,VData,EData>::remove_edge(EdgeDescriptor edge) {
-	if(edge==null_edge||edge_set[edge.e].source==max_vertices)
+	if(edge.e==max_edges||edge_set[edge.e].source==max_vertices)
 		return;
 	EdgesSize const e=edge.e;
-	edge_set[e].source=max_vertices;
-	edge_set[e].next=first_unused_edge;
-	first_unused_edge=e;
 	{
 		EdgesSize const prev=edge_set[e].prev_out;
 		EdgesSize const next=edge_set[e].next_out;
@@ -677,7 +688,7 @@ void AdjacencyList<OsModel_P,N,M,VData,EData>::remove_edge(EdgeDescriptor edge)
 		EdgesSize const prev=edge_set[e].prev_in;
 		EdgesSize const next=edge_set[e].next_in;
 		if(prev==max_edges)
-			vertex_set[edge_set[e].source].in_edges=next;
+			vertex_set[edge_set[e].target].in_edges=next;
 		else
 			edge_set[prev].next_in=next;
 		if(next!=max_edges)
@@ -694,6 +705,9 @@ void AdjacencyList<OsModel_P,N,M,VData,EData>::remove_edge(EdgeDescriptor edge)
 		if(next!=max_edges)
 			edge_set[next].prev=prev;
 	}
+	edge_set[e].source=max_vertices;
+	edge_set[e].next=first_unused_edge;
+	first_unused_edge=e;
 	--nedges;
 }
 
@@ -703,12 +717,15 @@ template<class OsModel_P,
 	class VData,
 	class EData>
 void AdjacencyList<OsModel_P,N,M,VData,EData>::remove_vertex(VertexDescriptor vertex,bool remove_edges) {
-	if(vertex==null_vertex||vertex_set[vertex.v].out_degree==max_edges)
+	if(vertex.v==max_vertices||vertex_set[vertex.v].out_degree==max_edges)
 		return;
 	VerticesSize const v=vertex.v;
-	vertex_set[v].out_degree=max_edges;
-	vertex_set[v].next=first_unused_vertex;
-	first_unused_vertex=v;
+	if(remove_edges){
+		while(vertex_set[v].out_edges!=max_edges)
+			remove_edge(EdgeDescriptor(*this,vertex_set[v].out_edges));
+		while(vertex_set[v].in_edges!=max_edges)
+			remove_edge(EdgeDescriptor(*this,vertex_set[v].in_edges));
+	}
 	{
 		VerticesSize const prev=vertex_set[v].prev;
 		VerticesSize const next=vertex_set[v].next;
@@ -719,13 +736,37 @@ void AdjacencyList<OsModel_P,N,M,VData,EData>::remove_vertex(VertexDescriptor ve
 		if(next!=max_vertices)
 			vertex_set[next].prev=prev;
 	}
+	vertex_set[v].out_degree=max_edges;
+	vertex_set[v].next=first_unused_vertex;
+	first_unused_vertex=v;
 	--nvertices;
-	if(remove_edges){
-		while(vertex_set[v].out_edges!=max_edges)
-			remove_edge(EdgeDescriptor(*this,vertex_set[v].out_edges));
-		while(vertex_set[v].in_edges!=max_edges)
-			remove_edge(EdgeDescriptor(*this,vertex_set[v].in_edges));
-	}
+}
+
+template<class OsModel_P,
+	typename OsModel_P::size_t N,
+	typename OsModel_P::size_t M,
+	class VData,
+	class EData>
+typename AdjacencyList<OsModel_P,N,M,VData,EData>::VertexDescriptor AdjacencyList<OsModel_P,N,M,VData,EData>::vertex(VerticesSize i) {
+	return VertexDescriptor(*this,i);
+}
+
+template<class OsModel_P,
+	typename OsModel_P::size_t N,
+	typename OsModel_P::size_t M,
+	class VData,
+	class EData>
+typename AdjacencyList<OsModel_P,N,M,VData,EData>::VertexDescriptor AdjacencyList<OsModel_P,N,M,VData,EData>::null_vertex() {
+	return VertexDescriptor(*this);
+}
+
+template<class OsModel_P,
+	typename OsModel_P::size_t N,
+	typename OsModel_P::size_t M,
+	class VData,
+	class EData>
+typename AdjacencyList<OsModel_P,N,M,VData,EData>::EdgeDescriptor AdjacencyList<OsModel_P,N,M,VData,EData>::null_edge() {
+	return EdgeDescriptor(*this);
 }
 
 }
@@ -0,0 +1,455 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef CSR_GRAPH_H
+#define CSR_GRAPH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+
+namespace wiselib {
+
+	namespace CsrGraph_detail {
+		/// Weight function for graphs without (numeric) edge data
+		template<typename Weight_P>
+		struct UnitWeight {
+			template<typename T>
+			Weight_P operator()(const T&) const { return 1; }
+		};
+	}
+
+	/**
+	 * @brief Immutable compressed sparse row snapshot of a directed graph.
+	 *
+	 * Vertices are dense indices 0..size()-1. The out-neighbours of vertex
+	 * u are targets()[offsets()[u] .. offsets()[u + 1]), sorted by target
+	 * and without parallel edges (of several parallel edges the lightest
+	 * one is kept), weights() is parallel to targets(). The transposed graph
+	 * (in-neighbours, needed by bottom-up BFS) is kept as a second CSR. For
+	 * symmetric graphs (all topologies with bidirectional links) both are
+	 * the same arrays, so it costs no extra memory.
+	 *
+	 * Compared to AdjacencyList, where every step of an out_edges()
+	 * iteration follows a link to a different place of the edge array, a
+	 * neighbourhood here is one contiguous run of 4 byte vertex indices.
+	 * The snapshot is built once from an AdjacencyList, a list of node id
+	 * pairs (testbed topologies) or node positions (Shawn world files,
+	 * WiseML) and can then be handed to the kernels in
+	 * csr_graph_kernels.h.
+	 *
+	 * Building:
+	 * @code
+	 * g.begin(n);
+	 * g.add_edge(u, v, w); ...
+	 * g.end();
+	 * @endcode
+	 *
+	 * Uses the heap and the STL, so this is for PC only.
+	 */
+	template<typename OsModel_P, typename Weight_P = uint32_t>
+	class CsrGraph {
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::size_t size_type;
+			typedef Weight_P weight_type;
+			typedef uint32_t vertex_type;
+			typedef uint32_t edge_type;
+			typedef CsrGraph<OsModel_P, Weight_P> self_type;
+
+			enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+			enum { NO_VERTEX = 0xffffffffUL };
+
+			CsrGraph() : vertices_(0), symmetric_(true) {
+				offsets_.push_back(0);
+			}
+
+			void clear() {
+				begin(0);
+				end();
+			}
+
+			/**
+			 * Start building a new snapshot with the vertices 0..n-1,
+			 * the current one is discarded.
+			 */
+			void begin(vertex_type n) {
+				vertices_ = n;
+				pending_.clear();
+				ids_.clear();
+				names_.clear();
+			}
+
+			void add_edge(vertex_type u, vertex_type v, weight_type w = 1) {
+				PendingEdge e = { u, v, w };
+				pending_.push_back(e);
+			}
+
+			void add_undirected_edge(vertex_type u, vertex_type v, weight_type w = 1) {
+				add_edge(u, v, w);
+				add_edge(v, u, w);
+			}
+
+			/**
+			 * Sort the added edges into the CSR arrays and build the
+			 * transposed graph.
+			 */
+			void end() {
+				std::sort(pending_.begin(), pending_.end());
+
+				offsets_.assign(vertices_ + 1, 0);
+				targets_.clear();
+				weights_.clear();
+				targets_.reserve(pending_.size());
+				weights_.reserve(pending_.size());
+				for(size_type i = 0; i < pending_.size(); i++) {
+					const PendingEdge& e = pending_[i];
+					// sorted by weight within (u, v): first one is the lightest
+					if(i && e.u == pending_[i - 1].u && e.v == pending_[i - 1].v) { continue; }
+					offsets_[e.u + 1]++;
+					targets_.push_back(e.v);
+					weights_.push_back(e.w);
+				}
+				std::vector<PendingEdge>().swap(pending_);
+				for(vertex_type u = 0; u < vertices_; u++) {
+					offsets_[u + 1] += offsets_[u];
+				}
+
+				transpose();
+			}
+
+			/**
+			 * Snapshot of @a graph (an AdjacencyList). Vertices are
+			 * numbered in the order of their slots, id(v) is the slot
+			 * (VertexDescriptor::index()) of vertex v. All edges get
+			 * weight 1.
+			 */
+			template<typename Graph_P>
+			void from_adjacency_list(Graph_P& graph) {
+				from_adjacency_list(graph, CsrGraph_detail::UnitWeight<weight_type>());
+			}
+
+			/**
+			 * As above, weight of an edge is weight_of(*edge), that is
+			 * computed from its EdgeData.
+			 */
+			template<typename Graph_P, typename WeightFunction_P>
+			void from_adjacency_list(Graph_P& graph, WeightFunction_P weight_of) {
+				typedef typename Graph_P::VertexIterator VertexIterator;
+				typedef typename Graph_P::VertexDescriptor::OutEdgeIterator OutEdgeIterator;
+				typedef typename Graph_P::VertexDescriptor::OutEdgeIteratorRange OutEdgeIteratorRange;
+
+				std::vector<vertex_type> dense(Graph_P::max_vertices, NO_VERTEX);
+				typename Graph_P::VertexIteratorRange vertices = graph.vertices();
+				for(VertexIterator it = vertices.first; it != vertices.second; ++it) {
+					dense[it.index()] = 0;
+				}
+				vertex_type n = 0;
+				for(size_type i = 0; i < dense.size(); i++) {
+					if(dense[i] != NO_VERTEX) { dense[i] = n++; }
+				}
+
+				begin(n);
+				ids_.resize(n);
+				pending_.reserve(graph.num_edges());
+				for(size_type i = 0; i < dense.size(); i++) {
+					if(dense[i] == NO_VERTEX) { continue; }
+					ids_[dense[i]] = i;
+					typename Graph_P::VertexDescriptor vertex = graph.vertex(i);
+					OutEdgeIteratorRange out = vertex.out_edges();
+					for(OutEdgeIterator e = out.first; e != out.second; ++e) {
+						add_edge(dense[i], dense[e.target().index()], weight_of(*e));
+					}
+				}
+				end();
+			}
+
+			/**
+			 * Undirected snapshot from a list of node id pairs (as in the
+			 * testbed topology headers): @a pairs holds @a count pairs
+			 * (2 * count ids). Vertices are numbered in order of first
+			 * appearance, id(v) is the node id.
+			 */
+			template<typename NodeId_P>
+			void from_pairs(const NodeId_P *pairs, size_type count) {
+				std::map<NodeId_P, vertex_type> index;
+				std::vector<unsigned long> ids;
+				for(size_type i = 0; i < 2 * count; i++) {
+					if(index.find(pairs[i]) == index.end()) {
+						index[pairs[i]] = ids.size();
+						ids.push_back(pairs[i]);
+					}
+				}
+				begin(ids.size());
+				for(size_type i = 0; i < count; i++) {
+					vertex_type u = index[pairs[2 * i]], v = index[pairs[2 * i + 1]];
+					if(u != v) { add_undirected_edge(u, v); }
+				}
+				end();
+				ids_.swap(ids);
+			}
+
+			/**
+			 * Unit disk graph of @a n nodes at the given positions (@a z
+			 * may be 0 for 2D): Two nodes are connected when their
+			 * distance is at most @a range, the edge weight is the
+			 * distance times @a scale (use a scale > 1 for integer weight
+			 * types).
+			 * Neighbours are found through a grid of range sized cells,
+			 * so this is O(n) for a bounded density.
+			 */
+			void from_positions(vertex_type n, const double *x, const double *y, const double *z,
+					double range, double scale = 1.0) {
+				begin(n);
+				if(n == 0 || range <= 0.0) {
+					end();
+					return;
+				}
+
+				double min[3] = { x[0], y[0], z ? z[0] : 0.0 };
+				for(vertex_type i = 1; i < n; i++) {
+					min[0] = std::min(min[0], x[i]);
+					min[1] = std::min(min[1], y[i]);
+					if(z) { min[2] = std::min(min[2], z[i]); }
+				}
+
+				std::vector<CellEntry> cells(n);
+				for(vertex_type i = 0; i < n; i++) {
+					cells[i].cell = cell_key(
+							(uint64_t)((x[i] - min[0]) / range),
+							(uint64_t)((y[i] - min[1]) / range),
+							z ? (uint64_t)((z[i] - min[2]) / range) : 0);
+					cells[i].vertex = i;
+				}
+				std::sort(cells.begin(), cells.end());
+
+				double r2 = range * range;
+				for(vertex_type i = 0; i < n; i++) {
+					uint64_t cx = (uint64_t)((x[i] - min[0]) / range);
+					uint64_t cy = (uint64_t)((y[i] - min[1]) / range);
+					uint64_t cz = z ? (uint64_t)((z[i] - min[2]) / range) : 0;
+					for(uint64_t nx = (cx ? cx - 1 : 0); nx <= cx + 1; nx++) {
+					for(uint64_t ny = (cy ? cy - 1 : 0); ny <= cy + 1; ny++) {
+					for(uint64_t nz = (cz ? cz - 1 : 0); nz <= cz + 1; nz++) {
+						CellEntry key = { cell_key(nx, ny, nz), 0 };
+						typename std::vector<CellEntry>::iterator it =
+							std::lower_bound(cells.begin(), cells.end(), key);
+						for( ; it != cells.end() && it->cell == key.cell; ++it) {
+							vertex_type j = it->vertex;
+							if(j == i) { continue; }
+							double dx = x[i] - x[j], dy = y[i] - y[j], dz = z ? z[i] - z[j] : 0.0;
+							double d2 = dx * dx + dy * dy + dz * dz;
+							if(d2 <= r2) { add_edge(i, j, (weight_type)(sqrt(d2) * scale)); }
+						}
+					}
+					}
+					}
+				}
+				end();
+			}
+
+			/**
+			 * Read node ids and positions from a Shawn world file
+			 * (<node id="..."><location x=".." y=".." z=".."/>) or a
+			 * WiseML file (<node id="..."><position><x>..</x>...) and
+			 * build the unit disk graph of them as from_positions()
+			 * does. name(v) is the id attribute of the node.
+			 * Nodes without a position are skipped.
+			 *
+			 * @return SUCCESS or ERR_UNSPEC if the file could not be read.
+			 */
+			int load_topology(const char *filename, double range, double scale = 1.0) {
+				FILE *f = fopen(filename, "rb");
+				if(!f) { return ERR_UNSPEC; }
+				std::string text;
+				char buf[4096];
+				size_t l;
+				while((l = fread(buf, 1, sizeof(buf), f)) > 0) { text.append(buf, l); }
+				fclose(f);
+
+				std::vector<std::string> names;
+				std::vector<double> x, y, z;
+				const char *p = text.c_str();
+				while((p = strstr(p, "<node ")) != 0) {
+					const char *end = strstr(p, "</node>");
+					if(!end) { break; }
+					std::string node(p, end - p);
+					p = end;
+
+					std::string id;
+					double pos[3];
+					if(!attribute(node, "id", id)) { continue; }
+					std::string::size_type loc = node.find("<location");
+					if(loc != std::string::npos) {
+						std::string tag = node.substr(loc, node.find('>', loc) - loc);
+						std::string v;
+						const char *axes[] = { "x", "y", "z" };
+						bool ok = true;
+						for(int a = 0; a < 3; a++) {
+							if(attribute(tag, axes[a], v)) { pos[a] = atof(v.c_str()); }
+							else if(a == 2) { pos[a] = 0.0; }
+							else { ok = false; }
+						}
+						if(!ok) { continue; }
+					}
+					else if(node.find("<position>") != std::string::npos) {
+						const char *axes[] = { "<x>", "<y>", "<z>" };
+						bool ok = true;
+						for(int a = 0; a < 3; a++) {
+							std::string::size_type s = node.find(axes[a], node.find("<position>"));
+							if(s != std::string::npos) { pos[a] = atof(node.c_str() + s + 3); }
+							else if(a == 2) { pos[a] = 0.0; }
+							else { ok = false; }
+						}
+						if(!ok) { continue; }
+					}
+					else {
+						continue;
+					}
+					names.push_back(id);
+					x.push_back(pos[0]);
+					y.push_back(pos[1]);
+					z.push_back(pos[2]);
+				}
+
+				vertex_type n = names.size();
+				from_positions(n, n ? &x[0] : 0, n ? &y[0] : 0, n ? &z[0] : 0, range, scale);
+				names_.swap(names);
+				return SUCCESS;
+			}
+
+			/// Number of vertices
+			vertex_type size() const { return vertices_; }
+			/// Number of (directed) edges
+			edge_type edges() const { return targets_.size(); }
+			/// true if for every edge (u, v) there is an edge (v, u)
+			bool symmetric() const { return symmetric_; }
+
+			edge_type out_degree(vertex_type u) const { return offsets_[u + 1] - offsets_[u]; }
+			const vertex_type* out_begin(vertex_type u) const { return targets() + offsets_[u]; }
+			const vertex_type* out_end(vertex_type u) const { return targets() + offsets_[u + 1]; }
+			const weight_type* out_weights(vertex_type u) const { return weights() + offsets_[u]; }
+
+			edge_type in_degree(vertex_type v) const { return in_offsets()[v + 1] - in_offsets()[v]; }
+			const vertex_type* in_begin(vertex_type v) const { return in_sources() + in_offsets()[v]; }
+			const vertex_type* in_end(vertex_type v) const { return in_sources() + in_offsets()[v + 1]; }
+
+			/// Raw arrays for the kernels
+			const edge_type* offsets() const { return &offsets_[0]; }
+			const vertex_type* targets() const { return targets_.empty() ? 0 : &targets_[0]; }
+			const weight_type* weights() const { return weights_.empty() ? 0 : &weights_[0]; }
+			const edge_type* in_offsets() const { return symmetric_ ? offsets() : &in_offsets_[0]; }
+			const vertex_type* in_sources() const {
+				return symmetric_ ? targets() : (in_sources_.empty() ? 0 : &in_sources_[0]);
+			}
+
+			/**
+			 * Id of v in the source of the snapshot: the slot for
+			 * from_adjacency_list(), the node id for from_pairs(), v
+			 * otherwise.
+			 */
+			unsigned long id(vertex_type v) const { return ids_.empty() ? v : ids_[v]; }
+
+			/// Node name from load_topology(), empty otherwise.
+			const char* name(vertex_type v) const { return names_.empty() ? "" : names_[v].c_str(); }
+
+		private:
+			struct PendingEdge {
+				vertex_type u, v;
+				weight_type w;
+
+				bool operator<(const PendingEdge& other) const {
+					if(u != other.u) { return u < other.u; }
+					if(v != other.v) { return v < other.v; }
+					return w < other.w;
+				}
+			};
+
+			struct CellEntry {
+				uint64_t cell;
+				vertex_type vertex;
+
+				bool operator<(const CellEntry& other) const { return cell < other.cell; }
+			};
+
+			static uint64_t cell_key(uint64_t x, uint64_t y, uint64_t z) {
+				return (x << 42) | ((y & 0x1fffff) << 21) | (z & 0x1fffff);
+			}
+
+			/**
+			 * Counting sort of the edges by target. Sources come out
+			 * sorted as the forward CSR is walked in source order.
+			 */
+			void transpose() {
+				in_offsets_.assign(vertices_ + 1, 0);
+				for(edge_type k = 0; k < targets_.size(); k++) {
+					in_offsets_[targets_[k] + 1]++;
+				}
+				for(vertex_type v = 0; v < vertices_; v++) {
+					in_offsets_[v + 1] += in_offsets_[v];
+				}
+				in_sources_.resize(targets_.size());
+				std::vector<edge_type> fill(in_offsets_.begin(), in_offsets_.end() - 1);
+				for(vertex_type u = 0; u < vertices_; u++) {
+					for(edge_type k = offsets_[u]; k < offsets_[u + 1]; k++) {
+						in_sources_[fill[targets_[k]]++] = u;
+					}
+				}
+
+				symmetric_ = (in_offsets_ == offsets_ && in_sources_ == targets_);
+				if(symmetric_) {
+					std::vector<edge_type>().swap(in_offsets_);
+					std::vector<vertex_type>().swap(in_sources_);
+				}
+			}
+
+			static bool attribute(const std::string& tag, const char *name, std::string& value) {
+				std::string key = std::string(" ") + name + "=\"";
+				std::string::size_type s = tag.find(key);
+				if(s == std::string::npos) { return false; }
+				s += key.size();
+				std::string::size_type e = tag.find('"', s);
+				if(e == std::string::npos) { return false; }
+				value = tag.substr(s, e - s);
+				return true;
+			}
+
+			vertex_type vertices_;
+			bool symmetric_;
+			std::vector<edge_type> offsets_;
+			std::vector<vertex_type> targets_;
+			std::vector<weight_type> weights_;
+			std::vector<edge_type> in_offsets_;
+			std::vector<vertex_type> in_sources_;
+			std::vector<unsigned long> ids_;
+			std::vector<std::string> names_;
+			std::vector<PendingEdge> pending_;
+	}; // class CsrGraph
+
+} // namespace wiselib
+
+#endif // CSR_GRAPH_H
+
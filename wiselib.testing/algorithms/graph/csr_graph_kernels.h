@@ -0,0 +1,450 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef CSR_GRAPH_KERNELS_H
+#define CSR_GRAPH_KERNELS_H
+
+#include "algorithms/graph/csr_graph.h"
+#include "external_interface/pc/pc_thread_pool.h"
+#include "util/pstl/indexed_heap.h"
+
+#include <stdint.h>
+#include <limits>
+#include <vector>
+
+namespace wiselib {
+
+	/**
+	 * @brief Multi-threaded traversal kernels on a CsrGraph.
+	 *
+	 * - bfs(): Direction-optimizing breadth first search. Levels with a
+	 *   small frontier are expanded top-down (frontier as a vertex queue,
+	 *   unvisited neighbours are claimed with a compare-and-swap), levels
+	 *   where the frontier has more outgoing edges than the unvisited part
+	 *   of the graph has incoming ones are expanded bottom-up (every
+	 *   unvisited vertex scans its in-neighbours for a frontier member and
+	 *   stops at the first hit, frontier as a bitmap).
+	 * - dijkstra(): Single source shortest paths with an IndexedHeap and
+	 *   decrease_key(), one source per worker when given several sources.
+	 * - connected_components(): Weakly connected components by lock-free
+	 *   union-find, all edges are hooked in parallel. The label of a
+	 *   vertex is the smallest vertex index of its component.
+	 *
+	 * All work is distributed over a PCThreadPool, a pool of size 1 runs
+	 * everything in the calling thread.
+	 *
+	 * Uses the heap, threads and the STL, so this is for PC only.
+	 */
+	template<typename OsModel_P, typename Graph_P>
+	class CsrGraphKernels {
+		public:
+			typedef OsModel_P OsModel;
+			typedef Graph_P Graph;
+			typedef CsrGraphKernels<OsModel_P, Graph_P> self_type;
+			typedef PCThreadPool<OsModel> ThreadPool;
+			typedef typename ThreadPool::size_type size_type;
+			typedef typename Graph::vertex_type vertex_type;
+			typedef typename Graph::edge_type edge_type;
+			typedef typename Graph::weight_type weight_type;
+			typedef uint32_t depth_type;
+
+			enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+			enum { UNREACHED = 0xffffffffUL };
+			enum {
+				/// switch to bottom-up when frontier edges > unvisited edges / ALPHA
+				ALPHA = 15,
+				/// switch back to top-down when frontier size < vertices / BETA
+				BETA = 18
+			};
+
+			CsrGraphKernels() : graph_(0) {
+			}
+
+			/**
+			 * @param threads number of workers including the calling
+			 * thread, 0 = one per cpu.
+			 */
+			int init(const Graph *graph, size_type threads = 0) {
+				graph_ = graph;
+				int r = pool_.init(threads);
+				workers_.resize(pool_.size());
+				return r;
+			}
+
+			size_type threads() const { return pool_.size(); }
+
+			static weight_type infinity() { return std::numeric_limits<weight_type>::max(); }
+
+			/**
+			 * Hop distances from @a source, UNREACHED for vertices not
+			 * reachable.
+			 */
+			void bfs(vertex_type source, std::vector<depth_type>& depth) {
+				vertex_type n = graph_->size();
+				depth.assign(n, (depth_type)UNREACHED);
+				top_down_levels_ = bottom_up_levels_ = 0;
+				if(source >= n) { return; }
+
+				depth_ = &depth[0];
+				depth_[source] = 0;
+				frontier_.assign(1, source);
+				size_type words = (n + 63) / 64;
+				current_.assign(words, 0);
+				next_.assign(words, 0);
+
+				level_ = 0;
+				bool bottom_up = false;
+				uint64_t frontier_edges = graph_->out_degree(source);
+				uint64_t unvisited_edges = graph_->edges() - frontier_edges;
+				size_type frontier_size = 1;
+
+				while(frontier_size) {
+					if(!bottom_up && frontier_edges > unvisited_edges / ALPHA) {
+						to_bitmap();
+						bottom_up = true;
+					}
+					else if(bottom_up && frontier_size < n / BETA) {
+						to_queue();
+						bottom_up = false;
+					}
+
+					if(bottom_up) {
+						pool_.template run<self_type, &self_type::bottom_up_step>(this);
+						current_.swap(next_);
+						bottom_up_levels_++;
+					}
+					else {
+						cursor_ = 0;
+						pool_.template run<self_type, &self_type::top_down_step>(this);
+						gather_queues();
+						top_down_levels_++;
+					}
+
+					frontier_size = 0;
+					frontier_edges = 0;
+					for(size_type w = 0; w < workers_.size(); w++) {
+						frontier_size += workers_[w].awake;
+						frontier_edges += workers_[w].edges;
+					}
+					unvisited_edges -= frontier_edges;
+					level_++;
+				}
+			}
+
+			/// Number of levels of the last bfs() expanded top-down
+			size_type top_down_levels() const { return top_down_levels_; }
+			/// Number of levels of the last bfs() expanded bottom-up
+			size_type bottom_up_levels() const { return bottom_up_levels_; }
+
+			/**
+			 * Shortest path distances from @a source, infinity() for
+			 * vertices not reachable. Runs in the calling thread.
+			 */
+			void dijkstra(vertex_type source, std::vector<weight_type>& dist) {
+				dijkstra(source, dist, workers_[0]);
+			}
+
+			/**
+			 * Shortest path distances from each of the @a count
+			 * @a sources into @a dists[i], sources are distributed over
+			 * the workers.
+			 */
+			void dijkstra(const vertex_type *sources, size_type count, std::vector<weight_type> *dists) {
+				sources_ = sources;
+				sources_count_ = count;
+				dists_ = dists;
+				cursor_ = 0;
+				pool_.template run<self_type, &self_type::dijkstra_step>(this);
+			}
+
+			/**
+			 * Weakly connected components: @a label[v] is the smallest
+			 * vertex of the component of v.
+			 * @return number of components
+			 */
+			size_type connected_components(std::vector<vertex_type>& label) {
+				label.resize(graph_->size());
+				if(label.empty()) { return 0; }
+				parent_ = &label[0];
+				pool_.template run<self_type, &self_type::cc_init_step>(this);
+				pool_.template run<self_type, &self_type::cc_hook_step>(this);
+				pool_.template run<self_type, &self_type::cc_compress_step>(this);
+
+				size_type r = 0;
+				for(size_type w = 0; w < workers_.size(); w++) { r += workers_[w].awake; }
+				return r;
+			}
+
+		private:
+			struct DistEntry {
+				weight_type dist;
+				vertex_type vertex;
+			};
+
+			static int compare_entries(DistEntry& a, DistEntry& b) {
+				return a.dist < b.dist ? -1 : b.dist < a.dist;
+			}
+
+			typedef IndexedHeap<OsModel, DistEntry, std::vector<size_type>,
+					std::vector<IndexedHeap_detail::Node<DistEntry, size_type> >,
+					&self_type::compare_entries> Heap;
+
+			/**
+			 * Per worker state. Padded so the counters of different
+			 * workers don't share a cache line.
+			 */
+			struct Worker {
+				std::vector<vertex_type> queue;
+				size_type awake;
+				uint64_t edges;
+				Heap heap;
+				std::vector<size_type> handles;
+				char padding[64];
+			};
+
+			enum { CHUNK = 256 };
+			enum { SETTLED = (size_type)(-2) };
+
+			void to_bitmap() {
+				std::fill(current_.begin(), current_.end(), 0);
+				for(size_type i = 0; i < frontier_.size(); i++) {
+					current_[frontier_[i] / 64] |= (uint64_t)1 << (frontier_[i] % 64);
+				}
+			}
+
+			void to_queue() {
+				frontier_.clear();
+				for(size_type i = 0; i < current_.size(); i++) {
+					for(uint64_t word = current_[i]; word; word &= word - 1) {
+						frontier_.push_back(i * 64 + __builtin_ctzll(word));
+					}
+				}
+			}
+
+			void gather_queues() {
+				frontier_.clear();
+				for(size_type w = 0; w < workers_.size(); w++) {
+					frontier_.insert(frontier_.end(), workers_[w].queue.begin(), workers_[w].queue.end());
+				}
+			}
+
+			/**
+			 * Expand the frontier queue, chunks of CHUNK vertices are
+			 * handed out dynamically as degrees may vary a lot.
+			 */
+			void top_down_step(size_type worker, size_type) {
+				Worker& state = workers_[worker];
+				state.queue.clear();
+				state.awake = 0;
+				state.edges = 0;
+
+				const edge_type *offsets = graph_->offsets();
+				const vertex_type *targets = graph_->targets();
+				depth_type next_depth = level_ + 1;
+				size_type n = frontier_.size();
+				while(true) {
+					size_type b = __sync_fetch_and_add(&cursor_, (size_type)CHUNK);
+					if(b >= n) { break; }
+					size_type e = (b + CHUNK < n) ? b + CHUNK : n;
+					for(size_type i = b; i < e; i++) {
+						vertex_type u = frontier_[i];
+						for(edge_type k = offsets[u]; k < offsets[u + 1]; k++) {
+							vertex_type v = targets[k];
+							if(depth_[v] == (depth_type)UNREACHED &&
+									__sync_bool_compare_and_swap(&depth_[v], (depth_type)UNREACHED, next_depth)) {
+								state.queue.push_back(v);
+								state.edges += offsets[v + 1] - offsets[v];
+							}
+						}
+					}
+				}
+				state.awake = state.queue.size();
+			}
+
+			/**
+			 * Every worker owns a range of bitmap words and so a range of
+			 * vertices, no synchronization needed.
+			 */
+			void bottom_up_step(size_type worker, size_type workers) {
+				Worker& state = workers_[worker];
+				state.awake = 0;
+				state.edges = 0;
+
+				const edge_type *in_offsets = graph_->in_offsets();
+				const vertex_type *in_sources = graph_->in_sources();
+				const edge_type *offsets = graph_->offsets();
+				vertex_type n = graph_->size();
+				depth_type next_depth = level_ + 1;
+
+				size_type begin, end;
+				ThreadPool::split(current_.size(), worker, workers, begin, end);
+				for(size_type i = begin; i < end; i++) {
+					uint64_t word = 0;
+					vertex_type last = (i * 64 + 64 < n) ? i * 64 + 64 : n;
+					for(vertex_type v = i * 64; v < last; v++) {
+						if(depth_[v] != (depth_type)UNREACHED) { continue; }
+						for(edge_type k = in_offsets[v]; k < in_offsets[v + 1]; k++) {
+							vertex_type u = in_sources[k];
+							if(current_[u / 64] & ((uint64_t)1 << (u % 64))) {
+								depth_[v] = next_depth;
+								word |= (uint64_t)1 << (v % 64);
+								state.awake++;
+								state.edges += offsets[v + 1] - offsets[v];
+								break;
+							}
+						}
+					}
+					next_[i] = word;
+				}
+			}
+
+			void dijkstra_step(size_type worker, size_type) {
+				while(true) {
+					size_type i = __sync_fetch_and_add(&cursor_, (size_type)1);
+					if(i >= sources_count_) { break; }
+					dijkstra(sources_[i], dists_[i], workers_[worker]);
+				}
+			}
+
+			void dijkstra(vertex_type source, std::vector<weight_type>& dist, Worker& state) {
+				vertex_type n = graph_->size();
+				dist.assign(n, infinity());
+				if(source >= n) { return; }
+
+				const edge_type *offsets = graph_->offsets();
+				const vertex_type *targets = graph_->targets();
+				const weight_type *weights = graph_->weights();
+				std::vector<size_type>& handles = state.handles;
+				Heap& heap = state.heap;
+				handles.assign(n, (size_type)Heap::NO_HANDLE);
+				heap.clear();
+
+				DistEntry entry = { 0, source };
+				dist[source] = 0;
+				handles[source] = heap.push(entry);
+				while(!heap.empty()) {
+					DistEntry top = heap.pop();
+					vertex_type u = top.vertex;
+					handles[u] = SETTLED;
+					for(edge_type k = offsets[u]; k < offsets[u + 1]; k++) {
+						vertex_type v = targets[k];
+						if(handles[v] == (size_type)SETTLED) { continue; }
+						weight_type d = top.dist + weights[k];
+						if(d >= dist[v]) { continue; }
+						dist[v] = d;
+						entry.dist = d;
+						entry.vertex = v;
+						if(handles[v] == (size_type)Heap::NO_HANDLE) { handles[v] = heap.push(entry); }
+						else { heap.decrease_key(handles[v], entry); }
+					}
+				}
+			}
+
+			void cc_init_step(size_type worker, size_type workers) {
+				size_type begin, end;
+				ThreadPool::split(graph_->size(), worker, workers, begin, end);
+				for(size_type v = begin; v < end; v++) { parent_[v] = v; }
+			}
+
+			/**
+			 * Root of the tree of @a x with path halving. Only non-roots
+			 * are written here and always to an ancestor, so concurrent
+			 * hooking (which only changes roots) is not disturbed.
+			 */
+			vertex_type find(vertex_type x) {
+				volatile vertex_type *parent = parent_;
+				while(true) {
+					vertex_type px = parent[x];
+					if(px == x) { return x; }
+					vertex_type ppx = parent[px];
+					if(ppx != px) { parent[x] = ppx; }
+					x = ppx;
+				}
+			}
+
+			/**
+			 * Union of the endpoints of every edge: the larger root is
+			 * hooked below the smaller one, so roots stay the minimum of
+			 * their tree. For symmetric graphs every edge is seen twice,
+			 * one direction is enough.
+			 */
+			void cc_hook_step(size_type worker, size_type workers) {
+				const edge_type *offsets = graph_->offsets();
+				const vertex_type *targets = graph_->targets();
+				bool symmetric = graph_->symmetric();
+
+				size_type begin, end;
+				ThreadPool::split(graph_->size(), worker, workers, begin, end);
+				for(vertex_type u = begin; u < end; u++) {
+					for(edge_type k = offsets[u]; k < offsets[u + 1]; k++) {
+						vertex_type v = targets[k];
+						if(symmetric && v < u) { continue; }
+						while(true) {
+							vertex_type ru = find(u), rv = find(v);
+							if(ru == rv) { break; }
+							if(ru < rv) { vertex_type t = ru; ru = rv; rv = t; }
+							if(__sync_bool_compare_and_swap(&parent_[ru], ru, rv)) { break; }
+						}
+					}
+				}
+			}
+
+			void cc_compress_step(size_type worker, size_type workers) {
+				size_type begin, end;
+				ThreadPool::split(graph_->size(), worker, workers, begin, end);
+				size_type roots = 0;
+				for(vertex_type v = begin; v < end; v++) {
+					vertex_type r = find(v);
+					parent_[v] = r;
+					if(r == v) { roots++; }
+				}
+				workers_[worker].awake = roots;
+			}
+
+			const Graph *graph_;
+			ThreadPool pool_;
+			std::vector<Worker> workers_;
+
+			// bfs
+			depth_type *depth_;
+			depth_type level_;
+			std::vector<vertex_type> frontier_;
+			std::vector<uint64_t> current_;
+			std::vector<uint64_t> next_;
+			size_type top_down_levels_;
+			size_type bottom_up_levels_;
+			volatile size_type cursor_;
+
+			// dijkstra
+			const vertex_type *sources_;
+			size_type sources_count_;
+			std::vector<weight_type> *dists_;
+
+			// connected components
+			vertex_type *parent_;
+
+			CsrGraphKernels(const self_type&);
+			self_type& operator=(const self_type&);
+	}; // class CsrGraphKernels
+
+} // namespace wiselib
+
+#endif // CSR_GRAPH_KERNELS_H
+
@@ -0,0 +1,971 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+#ifndef __ALGORITHMS_LOCALIZATION_DISTANCE_BASED_BATCH_LOCALIZATION_BATCH_SOLVER_H
+#define __ALGORITHMS_LOCALIZATION_DISTANCE_BASED_BATCH_LOCALIZATION_BATCH_SOLVER_H
+
+#include "algorithms/localization/distance_based/math/vec.h"
+#include "external_interface/pc/pc_thread_pool.h"
+
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+
+namespace wiselib
+{
+
+   /// Centralized (offline) localization of a whole network
+   /** PC-side counterpart of the distributed distance-based localization
+    *  modules: Given all measured pairwise ranges (e.g. from testbed logs)
+    *  and the anchor positions, positions for all nodes are computed at
+    *  once instead of node by node in message rounds.
+    *
+    *  Processing is done in three steps:
+    *
+    *  -# DV-hop: Hop counts from every anchor to every node are computed
+    *     by a bit-parallel multi-source BFS (64 anchors per sweep, sweeps
+    *     distributed over the worker threads). As in
+    *     LocalizationDvHopModule, anchors derive an average hop distance
+    *     from the other anchors, unknowns convert their hop counts with
+    *     the average hop distance of their closest anchor.
+    *  -# Lateration of the DV-hop distances gives a start position for
+    *     every node that is reachable from at least DIMENSIONS + 1
+    *     anchors.
+    *  -# Refinement: Sparse nonlinear least squares over all measured
+    *     ranges of the whole graph (Levenberg-Marquardt). The damped
+    *     normal equations are solved matrix-free by a block-Jacobi
+    *     preconditioned conjugate gradient, all kernels run in parallel
+    *     over node ranges.
+    *
+    *  Nodes are addressed by dense indices 0..size()-1, mapping radio node
+    *  ids to indices is up to the caller. Positions are handed out as the
+    *  same Vec type the distributed modules use.
+    *
+    *  Uses the heap and threads, so this is for PC only.
+    */
+   template<typename OsModel_P,
+            typename Arithmatic_P = double,
+            int DIMENSIONS_P = 2>
+   class LocalizationBatchSolver
+   {
+
+   public:
+      typedef OsModel_P OsModel;
+      typedef Arithmatic_P Arithmatic;
+      typedef Vec<Arithmatic> Position;
+
+      typedef LocalizationBatchSolver<OsModel, Arithmatic, DIMENSIONS_P> self_type;
+      typedef PCThreadPool<OsModel> ThreadPool;
+      typedef typename ThreadPool::size_type size_type;
+
+      typedef uint32_t index_t;
+      typedef uint16_t hops_t;
+
+      enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+      enum { DIMENSIONS = DIMENSIONS_P };
+      enum { UNREACHED = 0xffff };
+
+      ///@name construction / destruction
+      ///@{
+      ///
+      LocalizationBatchSolver();
+      ///@}
+
+      ///@name setup
+      ///@{
+      /** \param nodes number of nodes in the network
+       *  \param threads number of worker threads, 0 = one per cpu
+       */
+      int init( size_type nodes, size_type threads = 0 );
+      /** Add a symmetric range measurement. Multiple measurements of the
+       *  same pair are fine, they simply become additional residuals.
+       */
+      void add_range( index_t a, index_t b, Arithmatic distance );
+      ///
+      void set_anchor( index_t node, const Position& pos );
+      /** Restrict lateration to the \c n closest anchors (by hop count),
+       *  0 (default) uses all reached anchors.
+       */
+      void set_anchor_limit( size_type n )
+      { anchor_limit_ = n; }
+      ///@}
+
+      ///@name solving
+      ///@{
+      /** Build hop counts and DV-hop start positions.
+       *
+       *  \return number of nodes that got a position (anchors included)
+       */
+      size_type compute_dv_hop( void );
+      /** Levenberg-Marquardt refinement over all ranges between located
+       *  nodes. Can be called without compute_dv_hop() if start positions
+       *  have been set with set_position().
+       *
+       *  \return number of LM iterations performed
+       */
+      int solve( int max_iterations = 50, Arithmatic tolerance = 1e-9 );
+      ///@}
+
+      ///@name results
+      ///@{
+      ///
+      size_type size( void ) const
+      { return nodes_; }
+      ///
+      size_type range_count( void ) const
+      { return edges_a_.size(); }
+      ///
+      size_type anchor_count( void ) const
+      { return anchors_.size(); }
+      ///
+      bool is_anchor( index_t node ) const
+      { return flags_[node] & FLAG_ANCHOR; }
+      ///
+      bool is_localized( index_t node ) const
+      { return flags_[node] & (FLAG_ANCHOR | FLAG_LOCALIZED); }
+      ///
+      Position position( index_t node ) const;
+      /** Set a start position (marks node as localized).
+       */
+      void set_position( index_t node, const Position& pos );
+      /** \return Hop count between the i-th anchor (in order of
+       *  set_anchor()) and \c node, UNREACHED if there is no path.
+       */
+      hops_t hops( size_type anchor, index_t node ) const
+      { return hops_[node * anchors_.size() + anchor]; }
+      /** \return Sum of squared range residuals over all ranges between
+       *  localized nodes.
+       */
+      Arithmatic cost( void );
+      ///@}
+
+   private:
+
+      enum Flags
+      {
+         FLAG_ANCHOR = 0x01,
+         FLAG_LOCALIZED = 0x02
+      };
+
+      enum Phase
+      {
+         PHASE_BFS,
+         PHASE_LATERATE,
+         PHASE_COST,
+         PHASE_LINEARIZE,
+         PHASE_CG_MATVEC,
+         PHASE_CG_STEP,
+         PHASE_CG_DIRECTION,
+         PHASE_APPLY
+      };
+
+      /// per-worker reduction slot, padded to a cache line
+      struct Partial
+      {
+         double a;
+         char padding[64 - sizeof(double)];
+      };
+
+      void work( size_type worker, size_type workers );
+      void run( Phase phase );
+      double reduce_a( void );
+
+      void build_adjacency( void );
+      void bfs_sweep( size_type first_anchor );
+      void laterate( index_t node );
+      double cost_range( index_t begin, index_t end );
+      void linearize_range( index_t begin, index_t end, Partial& p );
+      void matvec_range( index_t begin, index_t end, Partial& p );
+      void cg_step_range( index_t begin, index_t end, Partial& p );
+      void cg_direction_range( index_t begin, index_t end );
+      void apply_range( index_t begin, index_t end );
+
+      inline bool is_variable( index_t node ) const
+      { return (flags_[node] & (FLAG_ANCHOR | FLAG_LOCALIZED)) == FLAG_LOCALIZED; }
+      inline bool is_used( index_t node ) const
+      { return flags_[node] & (FLAG_ANCHOR | FLAG_LOCALIZED); }
+
+      static bool solve_small( double *m, double *rhs, double *out );
+
+      size_type nodes_;
+      size_type anchor_limit_;
+      ThreadPool pool_;
+      Phase phase_;
+      Partial partial_[ThreadPool::MAX_WORKERS];
+
+      std::vector<uint8_t> flags_;
+      std::vector<double> coords_;
+      std::vector<index_t> anchors_;
+
+      // measurements as given, adjacency (CSR) built from them
+      std::vector<index_t> edges_a_, edges_b_;
+      std::vector<Arithmatic> edges_d_;
+      bool adjacency_valid_;
+      std::vector<index_t> adj_offset_;
+      std::vector<index_t> adj_node_;
+      std::vector<double> adj_dist_;
+
+      // dv-hop, node-major: hops_[node * anchor_count() + anchor]
+      std::vector<hops_t> hops_;
+      std::vector<double> avg_hop_dist_;
+
+      // LM / CG state, all of size nodes_ * DIMENSIONS
+      std::vector<double> adj_unit_;
+      std::vector<double> precond_;
+      std::vector<double> cg_x_, cg_r_, cg_z_, cg_p_, cg_ap_;
+      std::vector<double> saved_coords_;
+      double lambda_, alpha_, beta_;
+
+      LocalizationBatchSolver( const self_type& );
+      self_type& operator=( const self_type& );
+   };
+   // ----------------------------------------------------------------------
+   // ----------------------------------------------------------------------
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   LocalizationBatchSolver()
+      : nodes_         ( 0 ),
+        anchor_limit_  ( 0 ),
+        phase_         ( PHASE_BFS ),
+        adjacency_valid_ ( false ),
+        lambda_        ( 0 ),
+        alpha_         ( 0 ),
+        beta_          ( 0 )
+   {}
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   int
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   init( size_type nodes, size_type threads )
+   {
+      nodes_ = nodes;
+      flags_.assign( nodes_, 0 );
+      coords_.assign( nodes_ * DIMENSIONS, 0.0 );
+      anchors_.clear();
+      edges_a_.clear();
+      edges_b_.clear();
+      edges_d_.clear();
+      adjacency_valid_ = false;
+      hops_.clear();
+      avg_hop_dist_.clear();
+
+      return pool_.init( threads );
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   add_range( index_t a, index_t b, Arithmatic distance )
+   {
+      if ( a == b || a >= nodes_ || b >= nodes_ )
+         return;
+
+      edges_a_.push_back( a );
+      edges_b_.push_back( b );
+      edges_d_.push_back( distance );
+      adjacency_valid_ = false;
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   set_anchor( index_t node, const Position& pos )
+   {
+      if ( !(flags_[node] & FLAG_ANCHOR) )
+         anchors_.push_back( node );
+      flags_[node] |= FLAG_ANCHOR;
+      set_position( node, pos );
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   set_position( index_t node, const Position& pos )
+   {
+      double *c = &coords_[node * DIMENSIONS];
+      c[0] = pos.x();
+      if ( DIMENSIONS > 1 ) c[1] = pos.y();
+      if ( DIMENSIONS > 2 ) c[2] = pos.z();
+      flags_[node] |= FLAG_LOCALIZED;
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   typename LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::Position
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   position( index_t node ) const
+   {
+      const double *c = &coords_[node * DIMENSIONS];
+      return Position( c[0],
+                       DIMENSIONS > 1 ? c[1] : 0.0,
+                       DIMENSIONS > 2 ? c[2] : 0.0 );
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   build_adjacency( void )
+   {
+      if ( adjacency_valid_ )
+         return;
+
+      size_type m = edges_a_.size();
+      adj_offset_.assign( nodes_ + 1, 0 );
+      for ( size_type e = 0; e < m; e++ )
+      {
+         adj_offset_[edges_a_[e] + 1]++;
+         adj_offset_[edges_b_[e] + 1]++;
+      }
+      for ( size_type i = 0; i < nodes_; i++ )
+         adj_offset_[i + 1] += adj_offset_[i];
+
+      adj_node_.resize( 2 * m );
+      adj_dist_.resize( 2 * m );
+      std::vector<index_t> fill( adj_offset_.begin(), adj_offset_.end() - 1 );
+      for ( size_type e = 0; e < m; e++ )
+      {
+         index_t a = edges_a_[e], b = edges_b_[e];
+         adj_node_[fill[a]] = b;
+         adj_dist_[fill[a]++] = edges_d_[e];
+         adj_node_[fill[b]] = a;
+         adj_dist_[fill[b]++] = edges_d_[e];
+      }
+      adjacency_valid_ = true;
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   typename LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::size_type
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   compute_dv_hop( void )
+   {
+      build_adjacency();
+
+      size_type a = anchors_.size();
+      hops_.assign( a * nodes_, (hops_t)UNREACHED );
+      avg_hop_dist_.assign( a, 0.0 );
+      run( PHASE_BFS );
+
+      // Average hop distance per anchor, see
+      // LocalizationDvHopModule::process_dv_hop_message_anchor
+      for ( size_type i = 0; i < a; i++ )
+      {
+         double sum = 0.0;
+         int cnt = 0;
+         Position pi = position( anchors_[i] );
+         for ( size_type j = 0; j < a; j++ )
+         {
+            hops_t h = hops( i, anchors_[j] );
+            if ( i == j || h == UNREACHED || h == 0 )
+               continue;
+            sum += Position::euclidean_distance( pi, position( anchors_[j] ) ) / h;
+            cnt++;
+         }
+         avg_hop_dist_[i] = cnt ? sum / cnt : 0.0;
+      }
+
+      run( PHASE_LATERATE );
+
+      size_type localized = 0;
+      for ( size_type i = 0; i < nodes_; i++ )
+         if ( is_used( i ) )
+            localized++;
+      return localized;
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   bfs_sweep( size_type first_anchor )
+   {
+      // Bit-parallel multi-source BFS: bit k of the masks belongs to anchor
+      // first_anchor + k. Every node is touched once per level for all
+      // 64 sources together instead of once per source.
+      size_type count = anchors_.size() - first_anchor;
+      if ( count > 64 )
+         count = 64;
+
+      std::vector<uint64_t> seen( nodes_, 0 ), visit( nodes_, 0 ), next( nodes_, 0 );
+      std::vector<index_t> frontier, next_frontier;
+
+      for ( size_type k = 0; k < count; k++ )
+      {
+         index_t s = anchors_[first_anchor + k];
+         if ( !visit[s] )
+            frontier.push_back( s );
+         seen[s] |= (uint64_t)1 << k;
+         visit[s] |= (uint64_t)1 << k;
+         hops_[s * anchors_.size() + first_anchor + k] = 0;
+      }
+
+      for ( hops_t level = 1; !frontier.empty() && level < UNREACHED; level++ )
+      {
+         next_frontier.clear();
+         for ( size_type f = 0; f < frontier.size(); f++ )
+         {
+            index_t v = frontier[f];
+            uint64_t mask = visit[v];
+            for ( index_t e = adj_offset_[v]; e < adj_offset_[v + 1]; e++ )
+            {
+               index_t n = adj_node_[e];
+               uint64_t d = mask & ~seen[n];
+               if ( !d )
+                  continue;
+               if ( !next[n] )
+                  next_frontier.push_back( n );
+               next[n] |= d;
+               seen[n] |= d;
+               while ( d )
+               {
+                  int k = __builtin_ctzll( d );
+                  hops_[n * anchors_.size() + first_anchor + k] = level;
+                  d &= d - 1;
+               }
+            }
+         }
+         for ( size_type f = 0; f < frontier.size(); f++ )
+            visit[frontier[f]] = 0;
+         for ( size_type f = 0; f < next_frontier.size(); f++ )
+         {
+            visit[next_frontier[f]] = next[next_frontier[f]];
+            next[next_frontier[f]] = 0;
+         }
+         frontier.swap( next_frontier );
+      }
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   laterate( index_t node )
+   {
+      if ( flags_[node] & (FLAG_ANCHOR | FLAG_LOCALIZED) )
+         return;
+
+      const size_type D = DIMENSIONS;
+      size_type a = anchors_.size();
+
+      // Closest anchor provides the average hop distance, as the first
+      // calibration message would do in the distributed version
+      size_type nearest = a;
+      for ( size_type i = 0; i < a; i++ )
+         if ( hops( i, node ) != UNREACHED && avg_hop_dist_[i] > 0.0 &&
+               ( nearest == a || hops( i, node ) < hops( nearest, node ) ) )
+            nearest = i;
+      if ( nearest == a )
+         return;
+      double hop_dist = avg_hop_dist_[nearest];
+
+      // Collect reached anchors, optionally only the closest ones
+      std::vector<size_type> used;
+      for ( size_type i = 0; i < a; i++ )
+         if ( hops( i, node ) != UNREACHED )
+            used.push_back( i );
+      if ( anchor_limit_ && used.size() > anchor_limit_ )
+      {
+         for ( size_type i = 0; i < anchor_limit_; i++ )
+            for ( size_type j = i + 1; j < used.size(); j++ )
+               if ( hops( used[j], node ) < hops( used[i], node ) )
+               {
+                  size_type t = used[i]; used[i] = used[j]; used[j] = t;
+               }
+         used.resize( anchor_limit_ );
+      }
+      if ( used.size() < D + 1 )
+         return;
+
+      // Linearize by subtracting the equation of the last anchor and solve
+      // the normal equations of the overdetermined system
+      double m[9] = { 0 }, rhs[3] = { 0 }, out[3];
+      const double *ref = &coords_[anchors_[used.back()] * D];
+      double r_ref = hops( used.back(), node ) * hop_dist;
+      double ref_sq = 0.0;
+      for ( size_type d = 0; d < D; d++ )
+         ref_sq += ref[d] * ref[d];
+
+      for ( size_type k = 0; k + 1 < used.size(); k++ )
+      {
+         const double *p = &coords_[anchors_[used[k]] * D];
+         double r = hops( used[k], node ) * hop_dist;
+         double row[3], p_sq = 0.0;
+         for ( size_type d = 0; d < D; d++ )
+         {
+            row[d] = 2.0 * ( ref[d] - p[d] );
+            p_sq += p[d] * p[d];
+         }
+         double b = r * r - r_ref * r_ref - p_sq + ref_sq;
+         for ( size_type i = 0; i < D; i++ )
+         {
+            for ( size_type j = 0; j < D; j++ )
+               m[i * D + j] += row[i] * row[j];
+            rhs[i] += row[i] * b;
+         }
+      }
+
+      if ( !solve_small( m, rhs, out ) )
+         return;
+
+      double *c = &coords_[node * D];
+      for ( size_type d = 0; d < D; d++ )
+         c[d] = out[d];
+      flags_[node] |= FLAG_LOCALIZED;
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   bool
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   solve_small( double *m, double *rhs, double *out )
+   {
+      // Gaussian elimination with partial pivoting on a DxD system
+      const int D = DIMENSIONS;
+      for ( int col = 0; col < D; col++ )
+      {
+         int piv = col;
+         for ( int r = col + 1; r < D; r++ )
+            if ( fabs( m[r * D + col] ) > fabs( m[piv * D + col] ) )
+               piv = r;
+         if ( fabs( m[piv * D + col] ) < 1e-12 )
+            return false;
+         if ( piv != col )
+         {
+            for ( int k = 0; k < D; k++ )
+            {
+               double t = m[col * D + k]; m[col * D + k] = m[piv * D + k]; m[piv * D + k] = t;
+            }
+            double t = rhs[col]; rhs[col] = rhs[piv]; rhs[piv] = t;
+         }
+         for ( int r = col + 1; r < D; r++ )
+         {
+            double f = m[r * D + col] / m[col * D + col];
+            for ( int k = col; k < D; k++ )
+               m[r * D + k] -= f * m[col * D + k];
+            rhs[r] -= f * rhs[col];
+         }
+      }
+      for ( int r = D - 1; r >= 0; r-- )
+      {
+         double s = rhs[r];
+         for ( int k = r + 1; k < D; k++ )
+            s -= m[r * D + k] * out[k];
+         out[r] = s / m[r * D + r];
+      }
+      return true;
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   typename LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::Arithmatic
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   cost( void )
+   {
+      build_adjacency();
+      run( PHASE_COST );
+      return reduce_a();
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   double
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   cost_range( index_t begin, index_t end )
+   {
+      const size_type D = DIMENSIONS;
+      double sum = 0.0;
+      for ( index_t i = begin; i < end; i++ )
+      {
+         if ( !is_used( i ) )
+            continue;
+         const double *pi = &coords_[i * D];
+         for ( index_t e = adj_offset_[i]; e < adj_offset_[i + 1]; e++ )
+         {
+            // every range is stored twice, count it at its lower end
+            index_t j = adj_node_[e];
+            if ( j < i || !is_used( j ) )
+               continue;
+            const double *pj = &coords_[j * D];
+            double sq = 0.0;
+            for ( size_type d = 0; d < D; d++ )
+               sq += ( pi[d] - pj[d] ) * ( pi[d] - pj[d] );
+            double r = sqrt( sq ) - adj_dist_[e];
+            sum += r * r;
+         }
+      }
+      return sum;
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   linearize_range( index_t begin, index_t end, Partial& p )
+   {
+      // Per node: unit vectors of all incident ranges (rows of J), the
+      // right hand side r = -J^T f, the inverted block diagonal of
+      // J^T J + lambda I as preconditioner and the CG start state for x=0.
+      const size_type D = DIMENSIONS;
+      double rz = 0.0;
+      for ( index_t i = begin; i < end; i++ )
+      {
+         double *r = &cg_r_[i * D];
+         double *z = &cg_z_[i * D];
+         double *m = &precond_[i * D * D];
+         for ( size_type d = 0; d < D; d++ )
+         {
+            r[d] = 0.0;
+            z[d] = 0.0;
+            cg_x_[i * D + d] = 0.0;
+            cg_p_[i * D + d] = 0.0;
+         }
+         if ( !is_variable( i ) )
+            continue;
+
+         double block[9] = { 0 };
+         const double *pi = &coords_[i * D];
+         for ( index_t e = adj_offset_[i]; e < adj_offset_[i + 1]; e++ )
+         {
+            double *u = &adj_unit_[e * D];
+            index_t j = adj_node_[e];
+            for ( size_type d = 0; d < D; d++ )
+               u[d] = 0.0;
+            if ( !is_used( j ) )
+               continue;
+            const double *pj = &coords_[j * D];
+            double sq = 0.0;
+            for ( size_type d = 0; d < D; d++ )
+            {
+               u[d] = pi[d] - pj[d];
+               sq += u[d] * u[d];
+            }
+            double len = sqrt( sq );
+            if ( len < 1e-12 )
+            {
+               for ( size_type d = 0; d < D; d++ )
+                  u[d] = 0.0;
+               continue;
+            }
+            double f = len - adj_dist_[e];
+            for ( size_type d = 0; d < D; d++ )
+            {
+               u[d] /= len;
+               r[d] -= f * u[d];
+            }
+            for ( size_type a = 0; a < D; a++ )
+               for ( size_type b = 0; b < D; b++ )
+                  block[a * D + b] += u[a] * u[b];
+         }
+
+         for ( size_type d = 0; d < D; d++ )
+            block[d * D + d] += lambda_;
+
+         // invert the (tiny, SPD) block column by column
+         for ( size_type col = 0; col < D; col++ )
+         {
+            double tmp[9], e[3] = { 0, 0, 0 }, out[3];
+            for ( size_type k = 0; k < D * D; k++ )
+               tmp[k] = block[k];
+            e[col] = 1.0;
+            if ( !solve_small( tmp, e, out ) )
+            {
+               out[0] = out[1] = out[2] = 0.0;
+               out[col] = 1.0 / lambda_;
+            }
+            for ( size_type row = 0; row < D; row++ )
+               m[row * D + col] = out[row];
+         }
+
+         for ( size_type a = 0; a < D; a++ )
+         {
+            for ( size_type b = 0; b < D; b++ )
+               z[a] += m[a * D + b] * r[b];
+            cg_p_[i * D + a] = z[a];
+            rz += r[a] * z[a];
+         }
+      }
+      p.a = rz;
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   matvec_range( index_t begin, index_t end, Partial& p )
+   {
+      // Ap = (J^T J + lambda I) p, one row block per node. Reads p of the
+      // neighbors only, so node ranges can be processed independently.
+      const size_type D = DIMENSIONS;
+      double pap = 0.0;
+      for ( index_t i = begin; i < end; i++ )
+      {
+         double *ap = &cg_ap_[i * D];
+         const double *pi = &cg_p_[i * D];
+         if ( !is_variable( i ) )
+         {
+            for ( size_type d = 0; d < D; d++ )
+               ap[d] = 0.0;
+            continue;
+         }
+         double acc[3];
+         for ( size_type d = 0; d < D; d++ )
+            acc[d] = lambda_ * pi[d];
+         for ( index_t e = adj_offset_[i]; e < adj_offset_[i + 1]; e++ )
+         {
+            const double *u = &adj_unit_[e * D];
+            const double *pj = &cg_p_[adj_node_[e] * D];
+            double dot = 0.0;
+            for ( size_type d = 0; d < D; d++ )
+               dot += u[d] * ( pi[d] - pj[d] );
+            for ( size_type d = 0; d < D; d++ )
+               acc[d] += dot * u[d];
+         }
+         for ( size_type d = 0; d < D; d++ )
+         {
+            ap[d] = acc[d];
+            pap += pi[d] * acc[d];
+         }
+      }
+      p.a = pap;
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   cg_step_range( index_t begin, index_t end, Partial& p )
+   {
+      const size_type D = DIMENSIONS;
+      double rz = 0.0;
+      for ( index_t i = begin; i < end; i++ )
+      {
+         if ( !is_variable( i ) )
+            continue;
+         double *r = &cg_r_[i * D];
+         double *z = &cg_z_[i * D];
+         const double *m = &precond_[i * D * D];
+         for ( size_type d = 0; d < D; d++ )
+         {
+            cg_x_[i * D + d] += alpha_ * cg_p_[i * D + d];
+            r[d] -= alpha_ * cg_ap_[i * D + d];
+         }
+         for ( size_type a = 0; a < D; a++ )
+         {
+            z[a] = 0.0;
+            for ( size_type b = 0; b < D; b++ )
+               z[a] += m[a * D + b] * r[b];
+            rz += r[a] * z[a];
+         }
+      }
+      p.a = rz;
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   cg_direction_range( index_t begin, index_t end )
+   {
+      const size_type D = DIMENSIONS;
+      for ( index_t k = begin * D; k < end * D; k++ )
+         cg_p_[k] = cg_z_[k] + beta_ * cg_p_[k];
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   apply_range( index_t begin, index_t end )
+   {
+      const size_type D = DIMENSIONS;
+      for ( index_t k = begin * D; k < end * D; k++ )
+      {
+         saved_coords_[k] = coords_[k];
+         coords_[k] += cg_x_[k];
+      }
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   work( size_type worker, size_type workers )
+   {
+      Partial& p = partial_[worker];
+      p.a = 0.0;
+
+      if ( phase_ == PHASE_BFS )
+      {
+         size_type sweeps = ( anchors_.size() + 63 ) / 64;
+         for ( size_type s = worker; s < sweeps; s += workers )
+            bfs_sweep( s * 64 );
+         return;
+      }
+
+      size_type b, e;
+      ThreadPool::split( nodes_, worker, workers, b, e );
+      switch ( phase_ )
+      {
+         case PHASE_LATERATE:
+            for ( index_t i = b; i < e; i++ )
+               laterate( i );
+            break;
+         case PHASE_COST:
+            p.a = cost_range( b, e );
+            break;
+         case PHASE_LINEARIZE:
+            linearize_range( b, e, p );
+            break;
+         case PHASE_CG_MATVEC:
+            matvec_range( b, e, p );
+            break;
+         case PHASE_CG_STEP:
+            cg_step_range( b, e, p );
+            break;
+         case PHASE_CG_DIRECTION:
+            cg_direction_range( b, e );
+            break;
+         case PHASE_APPLY:
+            apply_range( b, e );
+            break;
+         default:
+            break;
+      }
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   void
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   run( Phase phase )
+   {
+      phase_ = phase;
+      pool_.template run<self_type, &self_type::work>( this );
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   double
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   reduce_a( void )
+   {
+      double s = 0.0;
+      for ( size_type i = 0; i < pool_.size(); i++ )
+         s += partial_[i].a;
+      return s;
+   }
+   // ----------------------------------------------------------------------
+   template<typename OsModel_P,
+            typename Arithmatic_P,
+            int DIMENSIONS_P>
+   int
+   LocalizationBatchSolver<OsModel_P, Arithmatic_P, DIMENSIONS_P>::
+   solve( int max_iterations, Arithmatic tolerance )
+   {
+      const size_type D = DIMENSIONS;
+      const int MAX_CG_ITERATIONS = 100;
+
+      build_adjacency();
+      adj_unit_.assign( adj_node_.size() * D, 0.0 );
+      precond_.assign( nodes_ * D * D, 0.0 );
+      cg_x_.assign( nodes_ * D, 0.0 );
+      cg_r_.assign( nodes_ * D, 0.0 );
+      cg_z_.assign( nodes_ * D, 0.0 );
+      cg_p_.assign( nodes_ * D, 0.0 );
+      cg_ap_.assign( nodes_ * D, 0.0 );
+      saved_coords_.assign( nodes_ * D, 0.0 );
+
+      double current = cost();
+      lambda_ = 1e-3;
+      int it = 0;
+      for ( ; it < max_iterations && current > 0.0; it++ )
+      {
+         // Solve (J^T J + lambda I) x = -J^T f with PCG
+         run( PHASE_LINEARIZE );
+         double rz = reduce_a();
+         double rz0 = rz;
+         for ( int k = 0; k < MAX_CG_ITERATIONS && rz > 1e-20 * rz0 && rz > 0.0; k++ )
+         {
+            run( PHASE_CG_MATVEC );
+            double pap = reduce_a();
+            if ( pap <= 0.0 )
+               break;
+            alpha_ = rz / pap;
+            run( PHASE_CG_STEP );
+            double rz_new = reduce_a();
+            beta_ = rz_new / rz;
+            rz = rz_new;
+            run( PHASE_CG_DIRECTION );
+         }
+
+         run( PHASE_APPLY );
+         double next = cost();
+         if ( next < current )
+         {
+            bool converged = ( current - next ) <= tolerance * current;
+            current = next;
+            lambda_ /= 3.0;
+            if ( lambda_ < 1e-12 )
+               lambda_ = 1e-12;
+            if ( converged )
+            {
+               it++;
+               break;
+            }
+         }
+         else
+         {
+            coords_.swap( saved_coords_ );
+            lambda_ *= 4.0;
+            if ( lambda_ > 1e12 )
+               break;
+         }
+      }
+      return it;
+   }
+
+}// namespace wiselib
+#endif
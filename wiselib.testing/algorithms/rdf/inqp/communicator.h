@@ -100,7 +100,9 @@ namespace wiselib {
 				MESSAGE_ID_OPERATOR = 'O',
 				MESSAGE_ID_QUERY = 'Q',
 				MESSAGE_ID_INTERMEDIATE_RESULT,
-				MESSAGE_ID_RESOLVE_HASHVALUE
+				MESSAGE_ID_RESOLVE_HASHVALUE,
+				/// Like an intermediate result, for a row to drop from the result
+				MESSAGE_ID_RETRACTED_RESULT
 			};
 			
 			typedef typename QueryProcessor::CommunicationType CommunicationType;
@@ -133,6 +135,11 @@ namespace wiselib {
 			
 			void on_send_row(int type, size_type columns, RowT& row, query_id_t query_id, operator_id_t operator_id) {
 				block_data_t buf[ResultRadio::MAX_MESSAGE_LENGTH];
+				if(ResultMessage::HEADER_SIZE + sizeof(typename RowT::Value) * columns > ResultRadio::MAX_MESSAGE_LENGTH) {
+					// e.g. sketch aggregates with too large parameters
+					DBG("com row too long cols%d", (int)columns);
+					return;
+				}
 				ResultMessage *message = reinterpret_cast<ResultMessage*>(buf);
 				message->set_message_id(MESSAGE_ID_INTERMEDIATE_RESULT);
 				message->set_query_id(query_id);
@@ -163,6 +170,10 @@ namespace wiselib {
 						}
 						break;
 					}
+					case QueryProcessor::COMMUNICATION_TYPE_SINK_RETRACT:
+						message->set_message_id(MESSAGE_ID_RETRACTED_RESULT);
+						result_radio_->send(sink_id_, ResultMessage::HEADER_SIZE + sizeof(typename RowT::Value) * columns, buf);
+						break;
 					case QueryProcessor::COMMUNICATION_TYPE_CONSTRUCTION_RULE:
 						break;
 				} // switch
@@ -20,11 +20,17 @@
 #ifndef DICTIONARY_TRANSLATOR_H
 #define DICTIONARY_TRANSLATOR_H
 
+#include <util/tuple_store/hash_indexed_dictionary.h>
+
 namespace wiselib {
 	
 	/**
 	 * @brief INQP Dictionary Translator.
 	 * Translates dictionary keys into hash values.
+	 * Dictionaries with a hash index for Hash_P (see DictionaryHashIndex)
+	 * store the hash value of every string, it is read from there.
+	 * For all others the hash values of the last few keys are cached in a
+	 * table of @a MAX_SIZE_P entries.
 	 */
 	template<
 		typename OsModel_P,
@@ -42,6 +48,7 @@ namespace wiselib {
 			typedef typename Dictionary::key_type dict_key_t;
 			typedef Hash_P Hash;
 			typedef typename Hash::hash_t hash_t;
+			typedef DictionaryHashLookup<Dictionary, Hash> Lookup;
 			
 			class KeyHashPair {
 				public:
@@ -61,6 +68,7 @@ namespace wiselib {
 			};
 			
 			enum { MAX_SIZE = MAX_SIZE_P };
+			enum { INDEXED = Lookup::INDEXED };
 			
 			void init(typename Dictionary::self_pointer_t dict) {
 				dictionary_ = dict;
@@ -71,6 +79,10 @@ namespace wiselib {
 			 * value.
 			 */
 			hash_t translate(dict_key_t dict_key) {
+				if(INDEXED) {
+					return Lookup::hash(*dictionary_, dict_key);
+				}
+				
 				size_type idx = dict_key_to_index(dict_key);
 				KeyHashPair &p = lookup_table_[idx];
 				if(p.dict_key() != dict_key) {
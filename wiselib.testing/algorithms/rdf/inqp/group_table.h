@@ -0,0 +1,173 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef GROUP_TABLE_H
+#define GROUP_TABLE_H
+
+#include <algorithms/rdf/inqp/row.h>
+#include <algorithms/rdf/inqp/table.h>
+
+namespace wiselib {
+	
+	/**
+	 * @brief A table of aggregate rows with a hash index over their group
+	 * columns.
+	 * 
+	 * The table does not know which columns form the group, the user
+	 * passes the hash value of the group columns to @a find() and @a
+	 * insert() and a predicate for comparing them. Rows are never removed
+	 * individually, so row indices stay valid until @a clear().
+	 * 
+	 * GroupTable t;
+	 * size_type idx = t.find(h, matches_row);
+	 * if(idx == GroupTable::npos) { idx = t.insert(h, row); }
+	 */
+	template<
+		typename OsModel_P,
+		typename Row_P = Row<OsModel_P>
+	>
+	class GroupTable {
+		
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef Row_P RowT;
+			typedef Table<OsModel, RowT> TableT;
+			typedef typename TableT::iterator iterator;
+			typedef ::uint32_t hash_t;
+			
+			enum { npos = (size_type)(-1) };
+			enum { MIN_SLOTS = 8 };
+			
+			GroupTable() : slots_(0), slots_capacity_(0) {
+			}
+			
+			void init(size_type columns) {
+				table_.init(columns);
+				slots_ = 0;
+				slots_capacity_ = 0;
+			}
+			
+			/**
+			 * Can be called without prior call to init().
+			 */
+			void destruct() {
+				table_.destruct();
+				free_slots();
+			}
+			
+			/**
+			 * @return index of the row with hash value @a h for which
+			 * match(row) is true or npos.
+			 */
+			template<typename Match>
+			size_type find(hash_t h, Match& match) {
+				if(!slots_capacity_) { return npos; }
+				
+				size_type mask = slots_capacity_ - 1;
+				for(size_type i = h & mask; slots_[i].row; i = (i + 1) & mask) {
+					if(slots_[i].hash == h && match(table_[slots_[i].row - 1])) {
+						return slots_[i].row - 1;
+					}
+				}
+				return npos;
+			}
+			
+			/**
+			 * Append @a row (which must not match any row in the table)
+			 * under hash value @a h.
+			 * @return index of the new row.
+			 */
+			size_type insert(hash_t h, const RowT& row) {
+				// keep the load below 3/4
+				if(4 * (table_.size() + 1) > 3 * slots_capacity_) {
+					rehash(slots_capacity_ ? 2 * slots_capacity_ : (size_type)MIN_SLOTS);
+				}
+				size_type idx = table_.size();
+				table_.insert(row);
+				put(h, idx);
+				return idx;
+			}
+			
+			RowT& operator[](size_type n) { return table_[n]; }
+			void set(size_type i, const RowT& row) { table_.set(i, row); }
+			size_type size() { return table_.size(); }
+			iterator begin() { return table_.begin(); }
+			iterator end() { return table_.end(); }
+			
+			void clear() {
+				table_.clear();
+				free_slots();
+			}
+			
+			/**
+			 * See Table::pack().
+			 */
+			void pack() { table_.pack(); }
+			
+			TableT& table() { return table_; }
+			
+		private:
+			struct Slot {
+				// row index + 1, 0 for an empty slot
+				::uint32_t row;
+				hash_t hash;
+			};
+			
+			void put(hash_t h, size_type idx) {
+				size_type mask = slots_capacity_ - 1;
+				size_type i = h & mask;
+				while(slots_[i].row) { i = (i + 1) & mask; }
+				slots_[i].row = idx + 1;
+				slots_[i].hash = h;
+			}
+			
+			void rehash(size_type n) {
+				Slot *old = slots_;
+				size_type old_capacity = slots_capacity_;
+				
+				slots_ = ::get_allocator().template allocate_array<Slot>(n).raw();
+				memset(slots_, 0, n * sizeof(Slot));
+				slots_capacity_ = n;
+				
+				for(size_type i = 0; i < old_capacity; i++) {
+					if(old[i].row) { put(old[i].hash, old[i].row - 1); }
+				}
+				if(old) { ::get_allocator().free_array(old); }
+			}
+			
+			void free_slots() {
+				if(slots_) {
+					::get_allocator().free_array(slots_);
+					slots_ = 0;
+				}
+				slots_capacity_ = 0;
+			}
+			
+			TableT table_;
+			Slot *slots_;
+			size_type slots_capacity_;
+		
+	}; // GroupTable
+}
+
+#endif // GROUP_TABLE_H
+
@@ -20,13 +20,17 @@
 #ifndef HASH_TRANSLATOR_H
 #define HASH_TRANSLATOR_H
 
+#include <util/tuple_store/hash_indexed_dictionary.h>
+
 namespace wiselib {
 	
 	/**
 	 * @brief Translates hash values into dictionary keys.
-	 * This implementation features a limited cache (@a MAX_SIZE_P elements)
-	 * for lookup. If a hash value is not find, an exhaustive search over the
-	 * dictionary has to be conducted.
+	 * If the dictionary keeps a hash index for Hash_P (HashDictionary,
+	 * HashIndexedDictionary, see DictionaryHashIndex) that is used.
+	 * Otherwise this implementation features a limited cache (@a
+	 * MAX_SIZE_P elements) for lookup. If a hash value is not found there,
+	 * an exhaustive search over the dictionary has to be conducted.
 	 * 
 	 */
 	template<
@@ -45,8 +49,10 @@ namespace wiselib {
 			typedef typename Dictionary::key_type dict_key_t;
 			typedef Hash_P Hash;
 			typedef typename Hash::hash_t hash_t;
+			typedef DictionaryHashLookup<Dictionary, Hash> Lookup;
 			
 			enum { MAX_SIZE = MAX_SIZE_P };
+			enum { INDEXED = Lookup::INDEXED };
 			
 			class HashKeyPair {
 				public:
@@ -69,6 +75,10 @@ namespace wiselib {
 			 * NULL_KEY is returned.
 			 */
 			dict_key_t translate(hash_t hash) {
+				if(INDEXED) {
+					return Lookup::find_hash(*dictionary_, hash);
+				}
+				
 				size_type idx = hash_to_index(hash);
 				HashKeyPair &p = lookup_table_[idx];
 				if(p.dict_key() != Dictionary::NULL_KEY && p.hash() == hash) {
@@ -99,6 +109,9 @@ namespace wiselib {
 			 * Fill the internal cache with some keys from the dictionary.
 			 */
 			void fill() {
+				if(INDEXED) {
+					return;
+				}
 				for(typename Dictionary::iterator iter = dictionary_->begin_keys();
 						iter != dictionary_->end_keys(); ++iter) {
 					dict_key_t k = *iter;
@@ -117,6 +130,9 @@ namespace wiselib {
 			 * happen.
 			 */
 			void offer(dict_key_t key, hash_t hash) {
+				if(INDEXED) {
+					return;
+				}
 				size_type idx = hash_to_index(hash);
 				HashKeyPair &p = lookup_table_[idx];
 				if(p.dict_key() == Dictionary::NULL_KEY) {
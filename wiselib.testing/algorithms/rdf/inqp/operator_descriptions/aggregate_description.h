@@ -41,7 +41,7 @@ namespace wiselib {
 			typedef OperatorDescription<OsModel_P, Processor_P> Base;
 			typedef Processor_P Processor;
 			
-			enum AggregationType { GROUP = 0, SUM = 1, AVG = 2, COUNT = 3, MIN = 4, MAX = 5, AGAIN = 0x80 };
+			enum AggregationType { GROUP = 0, SUM = 1, AVG = 2, COUNT = 3, MIN = 4, MAX = 5, COUNT_DISTINCT = 6, TOP_K = 7, QUANTILE = 8, AGAIN = 0x80 };
 			
 			enum {
 				OFFSET_COLUMNS = Base::OFFSET_BASE_END,
@@ -55,6 +55,8 @@ namespace wiselib {
 				CONSTRUCT = 'C',
 				AGGREGATE = 'a',
 				DELETE = 'D',
+				/// Not sent, only created by ShardedQueryProcessor
+				EXCHANGE = 'x',
 			};
 			
 			enum {
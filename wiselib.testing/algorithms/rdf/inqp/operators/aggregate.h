@@ -23,11 +23,36 @@
 #include <external_interface/external_interface.h>
 #include "../row.h"
 #include "../table.h"
+#include "../group_table.h"
 #include "../projection_info.h"
 #include "operator.h"
 #include "../operator_descriptions/aggregate_description.h"
 #include "../compare_values.h"
 #include <util/pstl/map_static_vector.h>
+#include <algorithms/aggregation/hyperloglog.h>
+#include <algorithms/aggregation/count_min_sketch.h>
+#include <algorithms/aggregation/kll_sketch.h>
+
+#ifndef INQP_AGGREGATE_DISTINCT_PRECISION
+	#define INQP_AGGREGATE_DISTINCT_PRECISION 6
+#endif
+
+#ifndef INQP_AGGREGATE_TOP_K
+	#define INQP_AGGREGATE_TOP_K 2
+#endif
+#ifndef INQP_AGGREGATE_TOP_K_WIDTH
+	#define INQP_AGGREGATE_TOP_K_WIDTH 8
+#endif
+#ifndef INQP_AGGREGATE_TOP_K_DEPTH
+	#define INQP_AGGREGATE_TOP_K_DEPTH 5
+#endif
+
+#ifndef INQP_AGGREGATE_QUANTILE_K
+	#define INQP_AGGREGATE_QUANTILE_K 4
+#endif
+#ifndef INQP_AGGREGATE_QUANTILE_LEVELS
+	#define INQP_AGGREGATE_QUANTILE_LEVELS 4
+#endif
 
 namespace wiselib {
 	
@@ -38,6 +63,35 @@ namespace wiselib {
 	 * unprojected data to our parent anyway and projection can only
 	 * be usefully done in the sink!
 	 * 
+	 * Groups are found by a hash over their group columns (GroupTable).
+	 * Besides the local aggregates and the last aggregates reported by
+	 * every child the operator keeps the merged aggregates of all of them,
+	 * a group changed by a child report is merged again from the local
+	 * and the children's rows of just that group.
+	 * 
+	 * COUNT_DISTINCT keeps a HyperLogLog sketch of the values in its
+	 * physical columns (Distinct, 2^INQP_AGGREGATE_DISTINCT_PRECISION
+	 * registers of 4 bits), use count_distinct() for its estimate.
+	 * TOP_K and QUANTILE keep the wire form (writeTo()) of a Count-Min
+	 * sketch with candidate list (TopK) and of a KLL sketch (Quantiles),
+	 * read top_k() and quantile() from the output rows. With the
+	 * default parameters each takes 23 physical columns (92 bytes), one
+	 * of them and a few other columns fit a 116 byte radio message,
+	 * Communicator drops rows that do not fit.
+	 * QUANTILE orders INTEGER and FLOAT values as compare_values()
+	 * does.
+	 * 
+	 * In incremental queries (INQP_INCREMENTAL) inserted rows are added
+	 * to their group right away and only groups whose value changed are
+	 * sent. Aggregates can not take rows out again, an erased row has the
+	 * query evaluated completely on its next execution. A group that
+	 * loses all its rows is not retracted from the parent.
+	 * 
+	 * A partial aggregate (set_partial()) only aggregates the rows pushed
+	 * to it, another Aggregate of the same description merges its groups
+	 * with merge_partial(). ShardedQueryProcessor aggregates every shard
+	 * like that.
+	 * 
 	 * @ingroup
 	 * 
 	 * @tparam 
@@ -59,8 +113,13 @@ namespace wiselib {
 			typedef Aggregate self_type;
 			typedef Row<OsModel> RowT;
 			typedef Table<OsModel, RowT> TableT;
+			typedef GroupTable<OsModel, RowT> GroupTableT;
+			typedef typename GroupTableT::hash_t hash_t;
 			typedef typename RowT::Value Value;
 			typedef AggregateDescription<OsModel, Processor> AD;
+			typedef HyperLogLog<OsModel, INQP_AGGREGATE_DISTINCT_PRECISION> Distinct;
+			typedef CountMinSketch<OsModel, Value, INQP_AGGREGATE_TOP_K_WIDTH, INQP_AGGREGATE_TOP_K_DEPTH, INQP_AGGREGATE_TOP_K> TopK;
+			typedef KllSketch<OsModel, Value, INQP_AGGREGATE_QUANTILE_K, INQP_AGGREGATE_QUANTILE_LEVELS> Quantiles;
 			
 			// TODO: this should be the node_id_t of the aggregation radio
 			// or the join radio (if that will turn out to be a different
@@ -74,7 +133,7 @@ namespace wiselib {
 			
 			enum { npos = (size_type)(-1) };
 			enum { MAX_CHILDS = MAX_NEIGHBORS_P };
-			typedef MapStaticVector<OsModel, node_id_t, TableT, MAX_CHILDS> ChildStates;
+			typedef MapStaticVector<OsModel, node_id_t, GroupTableT, MAX_CHILDS> ChildStates;
 			
 			enum { WAIT_AFTER_LOCAL = 1000 * WISELIB_TIME_FACTOR, CHECK_INTERVAL = INQP_AGGREGATE_CHECK_INTERVAL * WISELIB_TIME_FACTOR };
 			
@@ -95,6 +154,7 @@ namespace wiselib {
 				aggregation_types_ = ::get_allocator().template allocate_array< ::uint8_t>(aggregation_columns_logical_).raw();
 				memcpy(aggregation_types_, ad->aggregation_types(), aggregation_columns_logical_);
 				timer_info_ = 0;
+				partial_ = false;
 			}
 			#pragma GCC diagnostic pop
 			
@@ -147,6 +207,21 @@ namespace wiselib {
 								op.init_ = &Operation::init_value;
 								j += Operation::COLS_MAX;
 								break;
+							case AD::COUNT_DISTINCT:
+								op.aggregate_ = &Operation::aggregate_distinct;
+								op.init_ = &Operation::init_distinct;
+								j += Operation::COLS_DISTINCT;
+								break;
+							case AD::TOP_K:
+								op.aggregate_ = &Operation::aggregate_top_k;
+								op.init_ = &Operation::init_top_k;
+								j += Operation::COLS_TOP_K;
+								break;
+							case AD::QUANTILE:
+								op.aggregate_ = &Operation::aggregate_quantile;
+								op.init_ = &Operation::init_quantile;
+								j += Operation::COLS_QUANTILE;
+								break;
 						}
 						
 						if(!(aggregation_types_[i] & AD::AGAIN)) {
@@ -158,7 +233,9 @@ namespace wiselib {
 				//GET_OS.debug("aggr phycol %d", (int)aggregation_columns_physical_);
 					
 					local_aggregates_.init(aggregation_columns_physical_);
-					updated_aggregates_.init(aggregation_columns_physical_);
+					// one more column for the "updated since last sent" flag
+					aggregates_.init(aggregation_columns_physical_ + 1);
+					updated_ = 0;
 					post_inited_ = true;
 				}
 			}
@@ -166,11 +243,91 @@ namespace wiselib {
 			size_type columns_logical() { return aggregation_columns_logical_; }
 			size_type columns_physical() { return aggregation_columns_physical_; }
 			
+			/**
+			 * @return Estimated number of distinct values of the
+			 * COUNT_DISTINCT column @a i (logical) of the output row @a row.
+			 */
+			::uint32_t count_distinct(RowT& row, size_type i) {
+				post_init();
+				return operations_[i].distinct(row).estimate();
+			}
+			
+			/**
+			 * Candidates for the most frequent values of the TOP_K column
+			 * @a i (logical) of the output row @a row, most frequent first.
+			 * @param counts if not 0, receives their estimated counts.
+			 * @return Number of candidates written to @a values, at most
+			 * INQP_AGGREGATE_TOP_K.
+			 */
+			size_type top_k(RowT& row, size_type i, Value *values, ::uint16_t *counts = 0) {
+				post_init();
+				TopK s = operations_[i].top_k(row);
+				size_type n = s.top_size();
+				::uint16_t c[INQP_AGGREGATE_TOP_K];
+				for(size_type j = 0; j < n; j++) {
+					Value v = s.top(j);
+					::uint16_t e = s.estimate(v);
+					size_type k = j;
+					for( ; k > 0 && c[k - 1] < e; k--) {
+						values[k] = values[k - 1];
+						c[k] = c[k - 1];
+					}
+					values[k] = v;
+					c[k] = e;
+				}
+				if(counts) { memcpy(counts, c, n * sizeof(c[0])); }
+				return n;
+			}
+			
+			/**
+			 * @return Estimated value of rank @a q * n (0 <= q <= 1) of the
+			 * n values aggregated in the QUANTILE column @a i (logical) of
+			 * the output row @a row.
+			 */
+			Value quantile(RowT& row, size_type i, float q) {
+				post_init();
+				return operations_[i].from_order_key(operations_[i].quantiles(row).quantile(q));
+			}
+			
+			/**
+			 * In a partial aggregate, the end of input only leaves the
+			 * groups in local_aggregates(), nothing is sent.
+			 */
+			void set_partial(bool partial) { partial_ = partial; }
+			
+			GroupTableT& local_aggregates() { return local_aggregates_; }
+			
+			/**
+			 * Merge the group @a row of a partial aggregate into the local
+			 * aggregates, as if its rows had been pushed here.
+			 */
+			void merge_partial(RowT& row) {
+				post_init();
+				hash_t h = hash_group(row, true);
+				size_type idx = find_matching_group(local_aggregates_, row, true, h);
+				if(idx == npos) {
+					local_aggregates_.insert(h, row);
+				}
+				else {
+					merge_aggregates(local_aggregates_[idx], row);
+				}
+			}
+			
+			/**
+			 * Forget the local rows of the last evaluation.
+			 */
+			void reset() {
+				if(post_inited_) {
+					local_aggregates_.clear();
+				}
+			}
+			
 			void destruct() {
 				//GET_OS.debug("aggr destR!");
 				
 				if(timer_info_ != 0) {
 					timer_info_->alive = false;
+					timer_info_ = 0;
 				}
 				if(operations_) {
 					::get_allocator().template free_array(operations_);
@@ -180,135 +337,145 @@ namespace wiselib {
 					::get_allocator().template free_array(aggregation_types_);
 					aggregation_types_ = 0;
 				}
+				if(post_inited_) {
+					local_aggregates_.destruct();
+					aggregates_.destruct();
+					for(typename ChildStates::iterator iter = child_states_.begin(); iter != child_states_.end(); ++iter) {
+						iter->second.destruct();
+					}
+					child_states_.clear();
+					post_inited_ = false;
+				}
 			}
 			
 			void push(size_type port, RowT& row) {
 				post_init();
 				
-				DBG("--- aggr in");
-				
-				if(&row) {
-					size_type idx = find_matching_group(local_aggregates_, row);
+				// END_OF_INPUT is a null reference, read its address through
+				// a volatile so the test can not be optimized away.
+				RowT * volatile r = &row;
+			#if INQP_INCREMENTAL
+				if(this->delta() == Base::DELTA_ERASE) {
+					if(r) { this->query().invalidate(); }
+					return;
+				}
+			#endif
+				if(r) {
+					hash_t h = hash_group(row, false);
+					size_type idx = find_matching_group(local_aggregates_, row, false, h);
 					if(idx == npos) {
-				DBG("gr");
-						create_group(row);
+						idx = local_aggregates_.size();
+						create_group(row, h);
 					}
 					else {
-				DBG("ad");
 						add_to_aggregate(local_aggregates_[idx], row);
 					}
+					if(this->delta()) {
+						refresh_group(local_aggregates_[idx], true, h);
+					}
 				}
 				else {
-					local_aggregates_.pack();
-					
-					for(typename TableT::iterator iter = local_aggregates_.begin(); iter != local_aggregates_.end(); ++iter) {
-						DBG("cal refresh for local row");
-						refresh_group(*iter, true);
+					if(partial_) {
+						local_aggregates_.pack();
+						return;
+					}
+					if(!this->delta()) {
+						local_aggregates_.pack();
+						
+						for(typename GroupTableT::iterator iter = local_aggregates_.begin(); iter != local_aggregates_.end(); ++iter) {
+							refresh_group(*iter, true, hash_group(*iter, true));
+						}
 					}
 					
 					// We're done with local aggreation.
 					// Lets wait a little for possible child reports and then
-					// send out a result
+					// send out a result. The timer keeps checking for updates
+					// from then on.
 					
-					timer_info_ = ::get_allocator().template allocate<TimerInfo>().raw();
-					assert(timer_info_ != 0);
-					timer_info_->alive = true;
-					this->timer().template set_timer<self_type, &self_type::on_sending_time>(WAIT_AFTER_LOCAL, this, (void*)timer_info_);
+					if(timer_info_ == 0) {
+						timer_info_ = ::get_allocator().template allocate<TimerInfo>().raw();
+						assert(timer_info_ != 0);
+						timer_info_->alive = true;
+						this->timer().template set_timer<self_type, &self_type::on_sending_time>(WAIT_AFTER_LOCAL, this, (void*)timer_info_);
+					}
 				}
-				
-				DBG("agdon");
 			}
 			
 			/**
-			 * Refresh updated table such that it contains up to date
-			 * information about the group given by r.
-			 * (r has no otherwise special role)
+			 * Merge the group of @a row (group hash @a h) again from the
+			 * local and the children's aggregates and mark it as updated.
+			 * Always starts with the local aggregate and takes the children
+			 * in the same order so AVG rounds the same way every time.
+			 * Incremental queries only mark groups whose value changed.
 			 */
-			void refresh_group(RowT& r, bool r_is_output_form = false) {
-				size_type idx = npos;
-				size_type uidx = npos;
-				
-				// first, delete entry from updated table
-				
-				idx = find_matching_group(updated_aggregates_, r);
-				if(idx != npos) {
-					if(idx < updated_aggregates_.size() - 1) {
-						updated_aggregates_.set(idx, updated_aggregates_[updated_aggregates_.size() - 1]);
-					}
-					updated_aggregates_.pop_back();
+			void refresh_group(RowT& row, bool row_is_output, hash_t h) {
+				RowT *old = 0;
+				size_type index = find_matching_group(aggregates_, row, row_is_output, h);
+				if(index == npos) {
+					RowT *a = RowT::create(aggregation_columns_physical_ + 1);
+					(*a)[aggregation_columns_physical_] = 0;
+					index = aggregates_.insert(h, *a);
+					a->destroy();
 				}
+				else if(this->incremental()) {
+					old = RowT::create(aggregation_columns_physical_);
+					memcpy(&(*old)[0], &aggregates_[index][0], aggregation_columns_physical_ * sizeof(Value));
+				}
+				RowT &a = aggregates_[index];
+				bool first = true;
 				
-				// now see if the local table has to contribute something
-				
-				idx = find_matching_group(local_aggregates_, r, r_is_output_form);
-				DBG("refreshing: %d",(int)idx);
+				size_type idx = find_matching_group(local_aggregates_, row, row_is_output, h);
 				if(idx != npos) {
-					uidx = merge_or_create_updated(local_aggregates_[idx], uidx);
+					merge_or_copy(a, local_aggregates_[idx], first);
 				}
 				
-				// and finally all children
-				
 				for(typename ChildStates::iterator iter = child_states_.begin(); iter != child_states_.end(); ++iter) {
-					idx = find_matching_group(iter->second, r, r_is_output_form);
+					idx = find_matching_group(iter->second, row, row_is_output, h);
 					if(idx != npos) {
-						uidx = merge_or_create_updated(iter->second[idx], uidx);
+						merge_or_copy(a, iter->second[idx], first);
 					}
 				}
-			}
-			
-			/*
-			void print_table(TableT& t) {
-				size_type s = t.size();
-				DBG("table size=%d", t.size());
-				for(size_type r = 0; r < s; r++) {
-					DBG("-- row %d", r);
-					for(size_type c = 0; c < aggregation_columns_physical_; c++) {
-						DBG("  [%d] = %08x", c, t[r][c]);
-					}
+				
+				if(old) {
+					bool changed = memcmp(&(*old)[0], &a[0], aggregation_columns_physical_ * sizeof(Value)) != 0;
+					old->destroy();
+					if(!changed) { return; }
 				}
-				DBG("end table");
-			}
-			
-			void print_row(RowT& r) {
-				DBG("row");
-				for(size_type c = 0; c < aggregation_columns_physical_; c++) {
-					DBG("  [%d] = %08x", c, r[c]);
+				
+				if(!a[aggregation_columns_physical_]) {
+					a[aggregation_columns_physical_] = 1;
+					updated_++;
 				}
 			}
-			*/
 			
-			/**
-			 * Merge aggregate row source into updated table.
-			 * @param index Either the index in updated table where the
-			 * according aggregate row can be found or npos if such a row is
-			 * not there yet.
-			 * @return index of the the aggregate row in updated table.
-			 */
-			size_type merge_or_create_updated(RowT& source, size_type index) {
-				if(index == npos) {
-					index = updated_aggregates_.size();
-					updated_aggregates_.insert(source);
+			void merge_or_copy(RowT& aggregate, RowT& source, bool& first) {
+				if(first) {
+					memcpy(&aggregate[0], &source[0], aggregation_columns_physical_ * sizeof(Value));
+					first = false;
 				}
 				else {
-					merge_aggregates(updated_aggregates_[index], source);
+					merge_aggregates(aggregate, source);
 				}
-				return index;
 			}
 			
 			void on_receive_row(RowT& row, node_id_t from) {
+				post_init();
+				
 				if(!child_states_.contains(from)) {
 					child_states_[from].init(aggregation_columns_physical_);
 				}
-					
-				size_type idx = find_matching_group(child_states_[from], row, true);
+				GroupTableT &child = child_states_[from];
+				
+				hash_t h = hash_group(row, true);
+				size_type idx = find_matching_group(child, row, true, h);
 				if(idx != npos) {
-					child_states_[from].set(idx, row);
+					child.set(idx, row);
 				}
 				else {
-					child_states_[from].insert(row);
+					child.insert(h, row);
 				}
 				
-				refresh_group(row);
+				refresh_group(row, true, h);
 			}
 			
 			void on_sending_time(void* ti_) {
@@ -321,74 +488,80 @@ namespace wiselib {
 				}
 				DBG("aggr sending time alive");
 				
-				for(typename TableT::iterator iter = updated_aggregates_.begin(); iter != updated_aggregates_.end(); ++iter) {
+				for(typename GroupTableT::iterator iter = aggregates_.begin(); updated_ && iter != aggregates_.end(); ++iter) {
+					if(!(*iter)[aggregation_columns_physical_]) { continue; }
+					
 					//GET_OS.debug("aggr srow cols %d", (int)aggregation_columns_physical_);
 					this->processor().send_row(
 							Base::Processor::COMMUNICATION_TYPE_AGGREGATE,
 							aggregation_columns_physical_, *iter, this->query().id(), this->id()
 					);
+					(*iter)[aggregation_columns_physical_] = 0;
+					updated_--;
 				}
-				updated_aggregates_.clear();
 				this->timer().template set_timer<self_type, &self_type::on_sending_time>(CHECK_INTERVAL, this, ti_);
 			}
 			
-			/*
-			 * @return Index of the group row $row belongs to
-			 * or npos if no match was found.
+			/**
+			 * Hash value of the group columns of @a row.
 			 */
-			size_type find_matching_group(TableT& table, RowT& row, bool row_is_output = false) {
-				for(size_type group = 0; group < table.size(); group++) {
-					RowT& aggregate = table[group];
-					bool match = true;
-					for(size_type i = 0; i < aggregation_columns_logical_; i++) {
-						
-						/*
-						 * i --> logical output column (i'th output
-						 * aggregation value, some might take up multiple
-						 * physical columns though)
-						 * 
-						 * data_column_ --> physical INPUT column
-						 * aggregate_column_ --> physical OUTPUT column
-						 * 
-						 * if this is a group column,
-						 * it hase to have the same value in row and an table,
-						 * else its not a match
-						 */
-						
-						if((aggregation_types_[i] & ~AD::AGAIN) == AD::GROUP
-								&& row[row_is_output ? operations_[i].aggregate_column_ : operations_[i].data_column_] != aggregate[operations_[i].aggregate_column_]) {
-							
-							
-							DBG("nomatch: i %d aggrtype %d datacol %d aggrcol %d row[aggrcol] %08lx aggr[aggrcol] %08lx",
-									(int)i,
-									(int)aggregation_types_[i],
-									(int)operations_[i].data_column_,
-									(int)operations_[i].aggregate_column_,
-									(unsigned long)row[operations_[i].aggregate_column_],
-									(unsigned long)aggregate[operations_[i].aggregate_column_]);
-							
-							match = false;
-							break;
-						}
+			hash_t hash_group(RowT& row, bool row_is_output) {
+				hash_t h = 0x811c9dc5UL;
+				for(size_type i = 0; i < aggregation_columns_logical_; i++) {
+					if((aggregation_types_[i] & ~AD::AGAIN) == AD::GROUP) {
+						h = (h ^ (hash_t)row[row_is_output ? operations_[i].aggregate_column_ : operations_[i].data_column_]) * 0x01000193UL;
+						h ^= h >> 15;
 					}
-					if(match) {
-						return group;
+				}
+				return h;
+			}
+			
+			/**
+			 * @return true iff @a row belongs to the group of @a aggregate.
+			 */
+			bool same_group(RowT& row, RowT& aggregate, bool row_is_output) {
+				for(size_type i = 0; i < aggregation_columns_logical_; i++) {
+					
+					/*
+					 * i --> logical output column (i'th output
+					 * aggregation value, some might take up multiple
+					 * physical columns though)
+					 * 
+					 * data_column_ --> physical INPUT column
+					 * aggregate_column_ --> physical OUTPUT column
+					 * 
+					 * if this is a group column,
+					 * it hase to have the same value in row and an table,
+					 * else its not a match
+					 */
+					
+					if((aggregation_types_[i] & ~AD::AGAIN) == AD::GROUP
+							&& row[row_is_output ? operations_[i].aggregate_column_ : operations_[i].data_column_] != aggregate[operations_[i].aggregate_column_]) {
+						return false;
 					}
 				}
-							//assert(false);
-				return npos;
+				return true;
+			}
+			
+			/*
+			 * @return Index of the group row $row belongs to
+			 * or npos if no match was found.
+			 */
+			size_type find_matching_group(GroupTableT& table, RowT& row, bool row_is_output, hash_t h) {
+				GroupMatch match = { this, &row, row_is_output };
+				return table.find(h, match);
 			}
 			
 			/**
 			 * Add a simple data row (without extra columns) as aggregate
 			 * value of one into local aggregates.
 			 */
-			void create_group(RowT& row) {
+			void create_group(RowT& row, hash_t h) {
 				RowT *aggregate = RowT::create(aggregation_columns_physical_);
 				for(size_type i = 0; i < aggregation_columns_logical_; i++) {
 					operations_[i].init(*aggregate, row);
 				}
-				local_aggregates_.insert(*aggregate);
+				local_aggregates_.insert(h, *aggregate);
 				aggregate->destroy();
 			}
 			
@@ -397,20 +570,6 @@ namespace wiselib {
 			 */
 			void merge_aggregates(RowT& a, RowT& b) {
 				for(size_type i = 0; i < aggregation_columns_logical_; i++) {
-					
-					// {{{ DEBUG
-					if((aggregation_types_[i] & ~AD::AGAIN) == AD::GROUP) {
-						if(
-							a[operations_[i].aggregate_column_] != b[operations_[i].aggregate_column_]
-						) {
-							DBG("grp mis i=%d acol=%d ga=%08lx gb=%08lx",
-									(int)i, (int)operations_[i].aggregate_column_,
-									(long)a[operations_[i].aggregate_column_], (long)b[operations_[i].aggregate_column_]
-							);
-						}
-					}
-					// }}}
-					
 					operations_[i].aggregate(a, b);
 				}
 			}
@@ -440,7 +599,10 @@ namespace wiselib {
 			struct Operation {
 				enum AggregateColumns {
 					COLS_SUM = 1, COLS_AVG = 2, COLS_MIN = 1, COLS_MAX = 1, COLS_COUNT = 1,
-					COLS_STD = 2, COLS_GROUP = 1
+					COLS_STD = 2, COLS_GROUP = 1,
+					COLS_DISTINCT = (sizeof(Distinct) + sizeof(Value) - 1) / sizeof(Value),
+					COLS_TOP_K = (TopK::MAX_SIZE + sizeof(Value) - 1) / sizeof(Value),
+					COLS_QUANTILE = (Quantiles::MAX_SIZE + sizeof(Value) - 1) / sizeof(Value)
 				};
 				
 				void init_value(RowT& aggregate, RowT& row) {
@@ -456,6 +618,75 @@ namespace wiselib {
 					aggregate[aggregate_column_ + 1] = 1;
 				}
 				
+				void init_distinct(RowT& aggregate, RowT& row) {
+					Distinct &d = distinct(aggregate);
+					d.clear();
+					d.insert((::uint32_t)row[data_column_]);
+				}
+				
+				/**
+				 * The sketch in the physical columns of @a aggregate.
+				 */
+				Distinct& distinct(RowT& aggregate) {
+					return *reinterpret_cast<Distinct*>(&aggregate[aggregate_column_]);
+				}
+				
+				void init_top_k(RowT& aggregate, RowT& row) {
+					TopK s;
+					s.insert(row[data_column_]);
+					store(aggregate, s, COLS_TOP_K);
+				}
+				
+				void init_quantile(RowT& aggregate, RowT& row) {
+					Quantiles s;
+					s.insert(to_order_key(row[data_column_]));
+					store(aggregate, s, COLS_QUANTILE);
+				}
+				
+				TopK top_k(RowT& aggregate) { return TopK(sketch_data(aggregate)); }
+				Quantiles quantiles(RowT& aggregate) { return Quantiles(sketch_data(aggregate)); }
+				
+				block_data_t* sketch_data(RowT& aggregate) {
+					return reinterpret_cast<block_data_t*>(&aggregate[aggregate_column_]);
+				}
+				
+				/**
+				 * Write the wire form of @a s into the @a columns physical
+				 * columns of @a aggregate, the rest zeroed so equal sketches
+				 * give equal rows.
+				 */
+				template<typename Sketch>
+				void store(RowT& aggregate, Sketch& s, size_type columns) {
+					memset(sketch_data(aggregate), 0, columns * sizeof(Value));
+					s.writeTo(sketch_data(aggregate));
+				}
+				
+				/**
+				 * Map @a v to a value whose unsigned order is the order
+				 * compare_values() gives the column type.
+				 */
+				Value to_order_key(Value v) {
+					const Value sign = (Value)1 << (8 * sizeof(Value) - 1);
+					switch(type_) {
+						case ProjectionInfoBase::INTEGER:
+							return v ^ sign;
+						case ProjectionInfoBase::FLOAT:
+							return (v & sign) ? ~v : (v ^ sign);
+					}
+					return v;
+				}
+				
+				Value from_order_key(Value k) {
+					const Value sign = (Value)1 << (8 * sizeof(Value) - 1);
+					switch(type_) {
+						case ProjectionInfoBase::INTEGER:
+							return k ^ sign;
+						case ProjectionInfoBase::FLOAT:
+							return (k & sign) ? (k ^ sign) : ~k;
+					}
+					return k;
+				}
+				
 				void aggregate_noop(RowT& aggregate1, RowT& aggregate2) {
 					// Left blank for personal notes
 				}
@@ -491,13 +722,16 @@ namespace wiselib {
 							DBG("aggr col noex");
 							break;
 						case ProjectionInfoBase::INTEGER: {
-							long sum = *reinterpret_cast<long*>(&v1) + *reinterpret_cast<long*>(&v2);
-							r = *reinterpret_cast<Value*>(&sum);
+							typedef typename Sint<sizeof(Value)>::t S;
+							r = (Value)((S)v1 + (S)v2);
 							break;
 						}
 						case ProjectionInfoBase::FLOAT: {
-							float sum = *reinterpret_cast<float*>(&v1) + *reinterpret_cast<float*>(&v2);
-							r = *reinterpret_cast<Value*>(&sum);
+							float f1, f2;
+							memcpy(&f1, &v1, sizeof(f1));
+							memcpy(&f2, &v2, sizeof(f2));
+							float sum = f1 + f2;
+							memcpy(&r, &sum, sizeof(r));
 							break;
 						}
 						case ProjectionInfoBase::STRING:
@@ -520,7 +754,6 @@ namespace wiselib {
 							DBG("aggr col noex");
 							break;
 						case ProjectionInfoBase::INTEGER: {
-							DBG("AVG INT");
 							//long long avg = *reinterpret_cast<long*>(&v1) * (long long)n1 + *reinterpret_cast<long*>(&v2) * (long long)n2;
 							//avg /= ((long long)n1 + (long long)n2);
 							//long avg2 = avg;
@@ -538,10 +771,12 @@ namespace wiselib {
 							break;
 						}
 						case ProjectionInfoBase::FLOAT: {
-							DBG("avg float");
-							float avg = *reinterpret_cast<float*>(&v1) * (float)n1/(float)(n1 + n2)
-								+ *reinterpret_cast<float*>(&v2) * (float)n2/(float)(n1 + n2);
-							r = *reinterpret_cast<Value*>(&avg);
+							float f1, f2;
+							memcpy(&f1, &v1, sizeof(f1));
+							memcpy(&f2, &v2, sizeof(f2));
+							float avg = f1 * (float)n1/(float)(n1 + n2)
+								+ f2 * (float)n2/(float)(n1 + n2);
+							memcpy(&r, &avg, sizeof(r));
 							break;
 						}
 						case ProjectionInfoBase::STRING:
@@ -554,10 +789,27 @@ namespace wiselib {
 				}
 				
 				
+				void aggregate_distinct(RowT& aggregate1, RowT& aggregate2) {
+					distinct(aggregate1).merge(distinct(aggregate2));
+				}
+				
+				void aggregate_top_k(RowT& aggregate1, RowT& aggregate2) {
+					TopK s = top_k(aggregate1);
+					s.merge(top_k(aggregate2));
+					store(aggregate1, s, COLS_TOP_K);
+				}
+				
+				void aggregate_quantile(RowT& aggregate1, RowT& aggregate2) {
+					Quantiles s = quantiles(aggregate1);
+					s.merge(quantiles(aggregate2));
+					store(aggregate1, s, COLS_QUANTILE);
+				}
+				
 				void aggregate(RowT& a1, RowT& a2) {
 					(this->*aggregate_)(a1, a2);
 				}
 				
+				
 				void init(RowT& a, RowT& r) {
 					(this->*init_)(a, r);
 				}
@@ -574,15 +826,27 @@ namespace wiselib {
 				int type_;
 			};
 			
+			struct GroupMatch {
+				self_type *aggregate_;
+				RowT *row_;
+				bool row_is_output_;
+				
+				bool operator()(RowT& a) { return aggregate_->same_group(*row_, a, row_is_output_); }
+			};
+			
 			ChildStates child_states_;
-			TableT local_aggregates_;
-			TableT updated_aggregates_;
+			GroupTableT local_aggregates_;
+			// local and all child aggregates merged, the extra last column
+			// flags the groups updated since they were last sent
+			GroupTableT aggregates_;
+			size_type updated_;
 			Operation *operations_;
 			bool post_inited_;
 			uint8_t aggregation_columns_logical_;
 			uint8_t aggregation_columns_physical_;
 			uint8_t *aggregation_types_;
 			TimerInfo *timer_info_;
+			bool partial_;
 		
 	}; // Aggregate
 }
@@ -25,6 +25,10 @@
 #include "../operator_descriptions/collect_description.h"
 #include <util/types.h>
 
+#if INQP_INCREMENTAL
+	#include "../group_table.h"
+#endif
+
 #ifdef PC
 #include <iostream>
 #include <iomanip>
@@ -35,6 +39,13 @@ namespace wiselib {
 	/**
 	 * @brief
 	 * 
+	 * With INQP_INCREMENTAL, an incremental query sends every distinct
+	 * result row once. The Collect remembers how many times each row has
+	 * been derived and sends a row when it first appears and a
+	 * COMMUNICATION_TYPE_SINK_RETRACT for it when it is no longer
+	 * derived, so the sink keeps the current result (as a set) without
+	 * receiving it again on every execution.
+	 * 
 	 * @ingroup
 	 * 
 	 * @tparam 
@@ -54,9 +65,15 @@ namespace wiselib {
 			typedef typename Base::Query Query;
 			//typedef Collect<OsModel, Processor, COMMUNICATION_TYPE_P> self_type;
 			typedef Collect self_type;
+			typedef typename Base::RowBatchT RowBatchT;
 			
 			enum { COMMUNICATION_TYPE = COMMUNICATION_TYPE_P };
 			
+		#if INQP_INCREMENTAL
+			typedef GroupTable<OsModel> GroupTableT;
+			typedef typename GroupTableT::hash_t hash_t;
+		#endif
+			
 			#pragma GCC diagnostic push
 			#pragma GCC diagnostic ignored "-Wpmf-conversions"
 			void init(CollectDescription<OsModel, Processor> *cd, Query *query) {
@@ -66,7 +83,15 @@ namespace wiselib {
 			
 				//this->push_ = reinterpret_cast<typename Base::my_push_t>(&self_type::push);
 				hardcore_cast(this->push_, &self_type::push);
+			#if INQP_BATCH_ROWS
+				hardcore_cast(this->push_batch_, &self_type::push_batch);
+			#endif
 				count_ = 0;
+			#if INQP_INCREMENTAL
+				hardcore_cast(this->destruct_, &self_type::destruct);
+				post_inited_ = false;
+				dead_ = 0;
+			#endif
 			}
 			#pragma GCC diagnostic pop
 			
@@ -78,13 +103,31 @@ namespace wiselib {
 				);
 					//DBG("collect ctor %d com %d %c", (int)count_, (int)COMMUNICATION_TYPE, (char)this->type());
 				hardcore_cast(this->push_, &self_type::push);
+			#if INQP_BATCH_ROWS
+				hardcore_cast(this->push_batch_, &self_type::push_batch);
+			#endif
 				count_ = 0;
+			#if INQP_INCREMENTAL
+				hardcore_cast(this->destruct_, &self_type::destruct);
+				post_inited_ = false;
+				dead_ = 0;
+			#endif
 			}
 			
 			int count_;
 			
 			void push(size_type port, Row<OsModel>& row) {
-				if(&row) {
+				// END_OF_INPUT is a null reference, read its address through
+				// a volatile so the test can not be optimized away.
+				Row<OsModel> * volatile r = &row;
+			#if INQP_INCREMENTAL
+				if(this->incremental()) {
+					if(r) { update(row); }
+					else if(!this->delta()) { end_of_evaluation(); }
+					return;
+				}
+			#endif
+				if(r) {
 					count_++;
 				
 					//for(size_type i = 0; i < this->child(Base::CHILD_LEFT).columns(); i++) {
@@ -124,11 +167,191 @@ namespace wiselib {
 				
 			}
 			
+			/**
+			 * Batch mode version of push(), sends the selected rows of @a
+			 * batch.
+			 */
+			void push_batch(size_type port, RowBatchT& batch) {
+				size_type columns = this->child(Base::CHILD_LEFT).columns();
+				if(batch.selected()) {
+					Row<OsModel> *row = Row<OsModel>::create(columns);
+					for(size_type k = 0; k < batch.selected(); k++) {
+						batch.get_row(batch.selection(k), *row);
+					#if INQP_INCREMENTAL
+						if(this->incremental()) {
+							update(*row);
+							continue;
+						}
+					#endif
+						count_++;
+						this->processor().send_row(COMMUNICATION_TYPE, columns, *row, this->query().id(), this->id());
+					}
+					row->destroy();
+				}
+				if(batch.end_of_input()) {
+					count_ = 0;
+				#if INQP_INCREMENTAL
+					if(this->incremental()) { end_of_evaluation(); }
+				#endif
+				}
+			}
+			
 			void execute() {
 				//DBG("Collect execute");
 			}
 			
+		#if INQP_INCREMENTAL
+			void destruct() {
+				if(post_inited_) {
+					results_.destruct();
+					post_inited_ = false;
+				}
+			}
+			
+			/**
+			 * Prepare for a complete evaluation: rows sent before that are
+			 * not derived again are retracted at its end.
+			 */
+			void reset() {
+				if(!this->incremental()) { return; }
+				post_init();
+				size_type columns = this->child(Base::CHILD_LEFT).columns();
+				for(typename GroupTableT::iterator iter = results_.begin(); iter != results_.end(); ++iter) {
+					(*iter)[columns + PREVIOUS] = ((*iter)[columns + COUNT] != 0);
+					(*iter)[columns + COUNT] = 0;
+				}
+			}
+		#endif
+			
 		private:
+		#if INQP_INCREMENTAL
+			// Extra columns of results_ behind the ones of the row
+			enum { COUNT, PREVIOUS, EXTRA_COLUMNS };
+			
+			struct RowMatch {
+				Row<OsModel> *row;
+				size_type columns;
+				bool operator()(Row<OsModel>& other) {
+					return memcmp(&other, row, columns * sizeof(typename Row<OsModel>::Value)) == 0;
+				}
+			};
+			
+			void post_init() {
+				if(!post_inited_) {
+					results_.init(this->child(Base::CHILD_LEFT).columns() + EXTRA_COLUMNS);
+					dead_ = 0;
+					post_inited_ = true;
+				}
+			}
+			
+			hash_t hash_row(Row<OsModel>& row, size_type columns) {
+				hash_t h = 0x811c9dc5UL;
+				for(size_type i = 0; i < columns; i++) {
+					h = (h ^ (hash_t)row[i]) * 0x01000193UL;
+				}
+				return h;
+			}
+			
+			/**
+			 * Count @a row in or, for DELTA_ERASE, out of the result and
+			 * tell the sink if that changed the result.
+			 */
+			void update(Row<OsModel>& row) {
+				post_init();
+				size_type columns = this->child(Base::CHILD_LEFT).columns();
+				hash_t h = hash_row(row, columns);
+				RowMatch match = { &row, columns };
+				size_type idx = results_.find(h, match);
+				
+				if(this->delta() == Base::DELTA_ERASE) {
+					if(idx == GroupTableT::npos || results_[idx][columns + COUNT] == 0) {
+						return;
+					}
+					if(--results_[idx][columns + COUNT] == 0) {
+						send(Processor::COMMUNICATION_TYPE_SINK_RETRACT, row);
+						if(2 * ++dead_ > results_.size()) {
+							compact();
+						}
+					}
+					return;
+				}
+				
+				bool revived = true;
+				if(idx == GroupTableT::npos) {
+					Row<OsModel> *r = Row<OsModel>::create(columns + EXTRA_COLUMNS);
+					for(size_type i = 0; i < columns; i++) {
+						(*r)[i] = row[i];
+					}
+					(*r)[columns + COUNT] = 0;
+					(*r)[columns + PREVIOUS] = 0;
+					idx = results_.insert(h, *r);
+					r->destroy();
+					revived = false;
+				}
+				Row<OsModel> &entry = results_[idx];
+				if(entry[columns + COUNT]++ == 0) {
+					if(entry[columns + PREVIOUS]) {
+						// still at the sink from the last evaluation
+						entry[columns + PREVIOUS] = 0;
+					}
+					else {
+						if(revived) { dead_--; }
+						send(COMMUNICATION_TYPE, row);
+					}
+				}
+			}
+			
+			/**
+			 * Retract what a complete evaluation did not derive again.
+			 */
+			void end_of_evaluation() {
+				post_init();
+				size_type columns = this->child(Base::CHILD_LEFT).columns();
+				for(typename GroupTableT::iterator iter = results_.begin(); iter != results_.end(); ++iter) {
+					if((*iter)[columns + PREVIOUS]) {
+						(*iter)[columns + PREVIOUS] = 0;
+						send(Processor::COMMUNICATION_TYPE_SINK_RETRACT, *iter);
+					}
+				}
+				
+				dead_ = 0;
+				for(typename GroupTableT::iterator iter = results_.begin(); iter != results_.end(); ++iter) {
+					if((*iter)[columns + COUNT] == 0) { dead_++; }
+				}
+				if(2 * dead_ > results_.size()) {
+					compact();
+				}
+			}
+			
+			/**
+			 * Drop the rows that are no longer derived.
+			 */
+			void compact() {
+				size_type columns = this->child(Base::CHILD_LEFT).columns();
+				GroupTableT live;
+				live.init(columns + EXTRA_COLUMNS);
+				for(typename GroupTableT::iterator iter = results_.begin(); iter != results_.end(); ++iter) {
+					if((*iter)[columns + COUNT]) {
+						live.insert(hash_row(*iter, columns), *iter);
+					}
+				}
+				results_.destruct();
+				results_ = live;
+				dead_ = 0;
+			}
+			
+			void send(int communication_type, Row<OsModel>& row) {
+				count_++;
+				this->processor().send_row(communication_type, this->child(Base::CHILD_LEFT).columns(),
+						row, this->query().id(), this->id());
+			}
+			
+			/// Result rows with their COUNT and PREVIOUS columns
+			GroupTableT results_;
+			/// Rows of results_ with a COUNT of 0
+			size_type dead_;
+			bool post_inited_;
+		#endif
 	}; // Collect
 }
 
@@ -0,0 +1,132 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef EXCHANGE_H
+#define EXCHANGE_H
+
+#include "operator.h"
+#include "../row.h"
+#include "../table.h"
+#include <util/types.h>
+
+namespace wiselib {
+
+	/**
+	 * @brief Keeps the rows of an operator evaluated on one shard of a
+	 * tuple store until they are pushed on to its actual parent.
+	 *
+	 * Not created from an operator description: ShardedQueryProcessor
+	 * attaches the topmost shard-local operators of a query to an
+	 * Exchange per shard, evaluates the shards in parallel and then,
+	 * in the calling thread, flush()es the exchanges of all shards to the
+	 * parent (a join, say) followed by a single END_OF_INPUT.
+	 *
+	 * @ingroup
+	 *
+	 * @tparam
+	 */
+	template<
+		typename OsModel_P,
+		typename Processor_P
+	>
+	class Exchange : public Operator<OsModel_P, Processor_P> {
+
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef Operator<OsModel_P, Processor_P> Base;
+			typedef typename Base::Query Query;
+			typedef typename Base::ParentInfo ParentInfo;
+			typedef Processor_P Processor;
+			typedef Exchange self_type;
+			typedef Row<OsModel> RowT;
+			typedef Table<OsModel, RowT> TableT;
+			typedef typename Base::RowBatchT RowBatchT;
+
+			#pragma GCC diagnostic push
+			#pragma GCC diagnostic ignored "-Wpmf-conversions"
+			/**
+			 * Take the rows of @a source (an operator of @a query) from
+			 * now on.
+			 */
+			void init(Query *query, Base *source) {
+				Base::init(Base::Description::EXCHANGE, query, source->id(), 0, 0, source->projection_info());
+				hardcore_cast(this->push_, &self_type::push);
+			#if INQP_BATCH_ROWS
+				hardcore_cast(this->push_batch_, &self_type::push_batch);
+			#endif
+				hardcore_cast(this->destruct_, &self_type::destruct);
+				table_.init(source->projection_info().columns());
+				source->attach_to(this);
+			}
+			#pragma GCC diagnostic pop
+
+			void destruct() {
+				table_.destruct();
+			}
+
+			void push(size_type port, RowT& row) {
+				// END_OF_INPUT is a null reference, read its address through
+				// a volatile so the test can not be optimized away.
+				RowT * volatile r = &row;
+				if(r) {
+					table_.insert(row);
+				}
+			}
+
+			void push_batch(size_type port, RowBatchT& batch) {
+				RowT *row = RowT::create(batch.columns());
+				for(size_type k = 0; k < batch.selected(); k++) {
+					batch.get_row(batch.selection(k), *row);
+					table_.insert(*row);
+				}
+				row->destroy();
+			}
+
+			/**
+			 * Push the rows kept to @a parent (without END_OF_INPUT) and
+			 * forget them.
+			 */
+			void flush(ParentInfo& parent) {
+				for(typename TableT::iterator iter = table_.begin(); iter != table_.end(); ++iter) {
+					parent.push(*iter);
+				}
+				table_.clear();
+			}
+
+			void clear() { table_.clear(); }
+
+			size_type size() { return table_.size(); }
+
+			/**
+			 * The END_OF_INPUT row, to be pushed after flushing all shards.
+			 */
+			static RowT& end_of_input() { return Base::END_OF_INPUT; }
+
+			void execute() { }
+
+		private:
+			TableT table_;
+
+	}; // Exchange
+}
+
+#endif // EXCHANGE_H
+
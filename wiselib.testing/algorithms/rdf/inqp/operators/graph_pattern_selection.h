@@ -52,6 +52,9 @@ namespace wiselib {
 			typedef typename Base::Query Query;
 			typedef GraphPatternSelection<OsModel_P, Processor_P> self_type;
 			typedef typename RowT::Value Value;
+			typedef typename Base::RowBatchT RowBatchT;
+			
+			typedef typename Base::Dictionary::key_type key_type;
 			
 			//enum { MAX_STRING_LENGTH = 256 };
 			enum { TS_SEMANTIC_COLUMNS = 3 };
@@ -79,74 +82,245 @@ namespace wiselib {
 				
 			}
 			
+			/**
+			 * Push all tuples of @a ts that match the pattern to the parent.
+			 * 
+			 * The bound constants are resolved to dictionary keys once and
+			 * pushed down into the tuple store scan (@a
+			 * TupleStore::begin_raw()), so tuples are matched by key without
+			 * translating any of their columns. Constants the reverse
+			 * translator can not resolve without a hash index (it has to
+			 * rely on iterating the dictionary then) are still compared by
+			 * hash value. Only matching tuples are projected, numeric
+			 * projections are cached per dictionary key for the duration of
+			 * the execution.
+			 * 
+			 * If the parent takes batches (batch mode), the rows are
+			 * projected into a RowBatch and pushed INQP_BATCH_ROWS at a
+			 * time, the last batch marked as end of input.
+			 */
 			void execute(TupleStoreT& ts) {
-				//DBG("GPS execute");
-				typedef typename TupleStoreT::TupleContainer Container;
-				typedef typename Container::iterator Citer;
+				typedef typename TupleStoreT::iterator Iter;
+				typedef typename TupleStoreT::Tuple Tuple;
 				
-				RowT *row = RowT::create(this->projection_info().columns()); //TupleStoreT::COLUMNS);
+				key_type constants[TS_SEMANTIC_COLUMNS];
+				::uint8_t how[TS_SEMANTIC_COLUMNS];
+				if(!resolve(constants, how)) {
+					this->parent().push(Base::END_OF_INPUT);
+					return;
+				}
 				
-				//DBG("gps begin");
-				for(Citer iter = ts.container().begin(); iter != ts.container().end(); ++iter) {
-					//DBG("gps (%lx %lx %lx)", (long)iter->get_key(0), (long)iter->get_key(1), (long)iter->get_key(2));
-					
-					bool match = true;
-					size_type row_idx = 0;
+				Tuple query;
+				typename TupleStoreT::column_mask_t mask = 0;
+				bool any_hash = false;
+				for(size_type i = 0; i < TS_SEMANTIC_COLUMNS; i++) {
+					if(how[i] == MATCH_KEY) {
+						query.set_key(i, constants[i]);
+						mask |= (1 << i);
+					}
+					else if(how[i] == MATCH_HASH) {
+						any_hash = true;
+					}
+				}
+				
+				clear_numeric_cache();
+				RowT *row = 0;
+				RowBatchT *batch = 0;
+				if(this->parent().batched()) {
+					batch = RowBatchT::create(this->projection_info().columns());
+				}
+				else {
+					row = RowT::create(this->projection_info().columns());
+				}
+				
+				Iter end = ts.end();
+				for(Iter iter = ts.begin_raw(query, mask); iter != end; ++iter) {
+					// copy the keys, the container tuple might live in a
+					// block cache that is reused by the dictionary lookups
+					// below
+					key_type keys[TS_SEMANTIC_COLUMNS];
 					for(size_type i = 0; i < TS_SEMANTIC_COLUMNS; i++) {
-						typename Processor::Value v = this->translator().translate(iter->get_key(i));
-						
-						if(affected_[i]) {
-							if(values_[i] != v) {
-								//#ifdef ISENSE
-								//GET_OS.debug("gps %d nomatch [%d] = %08lx != %08lx", (int)this->id_,
-										//(int)i, (unsigned long)values_[i], (unsigned long)v);
-								//#endif
-								match = false;
-								break;
-							}
-						}
-						
-						switch(this->projection_info().type(i)) {
-							case ProjectionInfoBase::IGNORE:
-								DBG("gps %d col %d ignore", (int)this->id_, i);
-								break;
-							case ProjectionInfoBase::INTEGER: {
-								DBG("gps %d col %d INT", (int)this->id_, i);
-								block_data_t *s = this->dictionary().get_value(iter->get_key(i));
-								long l = atol((char*)s);
-								(*row)[row_idx++] = *reinterpret_cast<Value*>(&l);
-								this->dictionary().free_value(s);
-								break;
-							}
-							case ProjectionInfoBase::FLOAT: {
-								block_data_t *s = this->dictionary().get_value(iter->get_key(i));
-								float f = atof((char*)s);
-								DBG("gps %d col %d FLOAT \"%s\" %f", (int)this->id_, i, s, f);
-								(*row)[row_idx++] = *reinterpret_cast<Value*>(&f);
-								this->dictionary().free_value(s);
-								break;
-							}
-							case ProjectionInfoBase::STRING:
-								DBG("gps %d col %d STRING", (int)this->id_, i);
-								(*row)[row_idx++] = v;
-								this->reverse_translator().offer(iter->get_key(i), v);
-								break;
+						keys[i] = iter.container_iterator()->get_key(i);
+					}
+					if(any_hash && !matches(keys, constants, how)) {
+						continue;
+					}
+					
+					if(batch) {
+						project(*batch, batch->append(), keys);
+						if(batch->full()) {
+							this->parent().push_batch(*batch);
+							batch->clear();
 						}
 					}
-					if(match) {
-						DBG("---------- gps %d push", (int)this->id_);
+					else {
+						project(*row, keys);
 						this->parent().push(*row);
 					}
 				}
-				//DBG("gps end");
 				
-				row->destroy();
+				if(batch) {
+					batch->set_end_of_input();
+					this->parent().push_batch(*batch);
+					batch->destroy();
+				}
+				else {
+					row->destroy();
+					this->parent().push(Base::END_OF_INPUT);
+				}
+			}
+			
+			/**
+			 * Push the row of the tuple with the dictionary keys @a keys
+			 * if it matches the pattern, then END_OF_INPUT. For
+			 * incremental evaluation, the query's delta() tells whether
+			 * the tuple has just been inserted or is about to be erased.
+			 */
+			void execute_delta(key_type *keys) {
+				key_type constants[TS_SEMANTIC_COLUMNS];
+				::uint8_t how[TS_SEMANTIC_COLUMNS];
+				if(resolve(constants, how) && matches(keys, constants, how)) {
+					// keys may have been reused since the last execution
+					clear_numeric_cache();
+					RowT *row = RowT::create(this->projection_info().columns());
+					project(*row, keys);
+					this->parent().push(*row);
+					row->destroy();
+				}
 				this->parent().push(Base::END_OF_INPUT);
 			}
 			
 		private:
+			typedef typename Base::Dictionary Dictionary;
+			typedef typename Base::ReverseTranslator ReverseTranslator;
+			
+			enum { NUMERIC_CACHE_SIZE = 8 };
+			
+			/// How a column is matched, see resolve().
+			enum { MATCH_ANY, MATCH_KEY, MATCH_HASH };
+			
+			struct NumericCacheEntry {
+				key_type key;
+				::uint8_t type;
+				Value value;
+			};
+			
+			/**
+			 * Resolve the bound constants to dictionary keys. With a hash
+			 * index, a constant whose string is not in the dictionary can
+			 * not match any tuple. Constants that can not be resolved
+			 * otherwise are compared by hash value (MATCH_HASH). Note that
+			 * matching keys is exact where comparing hashes also matched
+			 * strings with colliding hash values.
+			 * @return false iff no tuple can match.
+			 */
+			bool resolve(key_type *constants, ::uint8_t *how) {
+				for(size_type i = 0; i < TS_SEMANTIC_COLUMNS; i++) {
+					how[i] = MATCH_ANY;
+					if(!affected_[i]) { continue; }
+					
+					constants[i] = this->reverse_translator().translate(values_[i]);
+					if(constants[i] != Dictionary::NULL_KEY) {
+						how[i] = MATCH_KEY;
+					}
+					else if(ReverseTranslator::INDEXED) {
+						return false;
+					}
+					else {
+						how[i] = MATCH_HASH;
+					}
+				}
+				return true;
+			}
+			
+			/**
+			 * @return true iff the tuple with the given keys matches the
+			 * constants resolve() gave.
+			 */
+			bool matches(key_type *keys, key_type *constants, ::uint8_t *how) {
+				for(size_type i = 0; i < TS_SEMANTIC_COLUMNS; i++) {
+					if(how[i] == MATCH_KEY && keys[i] != constants[i]) {
+						return false;
+					}
+					if(how[i] == MATCH_HASH && this->translator().translate(keys[i]) != values_[i]) {
+						return false;
+					}
+				}
+				return true;
+			}
+			
+			/**
+			 * Fill @a row with the projected columns of the tuple with the
+			 * given keys.
+			 */
+			void project(RowT& row, key_type *keys) {
+				size_type row_idx = 0;
+				for(size_type i = 0; i < TS_SEMANTIC_COLUMNS; i++) {
+					if(this->projection_info().type(i) != ProjectionInfoBase::IGNORE) {
+						row[row_idx++] = projected(i, keys[i]);
+					}
+				}
+			}
+			
+			/**
+			 * Fill row @a j of @a batch like project() does.
+			 */
+			void project(RowBatchT& batch, size_type j, key_type *keys) {
+				size_type col = 0;
+				for(size_type i = 0; i < TS_SEMANTIC_COLUMNS; i++) {
+					if(this->projection_info().type(i) != ProjectionInfoBase::IGNORE) {
+						batch.column(col++)[j] = projected(i, keys[i]);
+					}
+				}
+			}
+			
+			/**
+			 * Projected value of column @a i with dictionary key @a k.
+			 */
+			Value projected(size_type i, key_type k) {
+				if(this->projection_info().type(i) == ProjectionInfoBase::STRING) {
+					Value v = this->translator().translate(k);
+					this->reverse_translator().offer(k, v);
+					return v;
+				}
+				return numeric(k, this->projection_info().type(i));
+			}
+			
+			/**
+			 * Value of the INTEGER or FLOAT literal with dictionary key @a k.
+			 */
+			Value numeric(key_type k, int type) {
+				NumericCacheEntry &e = numeric_cache_[k % NUMERIC_CACHE_SIZE];
+				if(e.key == k && e.type == type) {
+					return e.value;
+				}
+				
+				block_data_t *s = this->dictionary().get_value(k);
+				if(type == ProjectionInfoBase::INTEGER) {
+					long l = atol((char*)s);
+					memcpy(&e.value, &l, sizeof(e.value));
+				}
+				else {
+					float f = atof((char*)s);
+					memcpy(&e.value, &f, sizeof(e.value));
+				}
+				this->dictionary().free_value(s);
+				
+				e.key = k;
+				e.type = type;
+				return e.value;
+			}
+			
+			void clear_numeric_cache() {
+				// keys may have been reused since the last execution
+				for(size_type i = 0; i < NUMERIC_CACHE_SIZE; i++) {
+					numeric_cache_[i].key = Dictionary::NULL_KEY;
+				}
+			}
+			
 			typename Processor::Value values_[3];
 			bool affected_[3];
+			NumericCacheEntry numeric_cache_[NUMERIC_CACHE_SIZE];
 		
 	}; // GraphPatternSelection
 }
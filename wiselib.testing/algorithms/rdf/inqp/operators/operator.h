@@ -22,9 +22,34 @@
 
 #include <util/delegates/delegate.hpp>
 #include "../row.h"
+#include "../row_batch.h"
 #include "../projection_info.h"
 #include "../operator_descriptions/operator_description.h"
 
+/**
+ * Rows per batch in batch mode, 0 (the default) disables it.
+ * 
+ * In batch mode operators that support it (push_batch_ set) exchange
+ * columnar RowBatch'es instead of single rows, which saves the per row
+ * call and allocation overhead when evaluating queries over large data
+ * sets (on the PC side, say). Operators that do not support it get the
+ * rows of the batches pushed one by one, see ParentInfo::push_batch().
+ */
+#ifndef INQP_BATCH_ROWS
+	#define INQP_BATCH_ROWS 0
+#endif
+
+/**
+ * Non-zero enables incremental evaluation of standing queries, see
+ * INQPQueryProcessor::insert_tuple(). Operators then learn from
+ * delta() whether the rows pushed to them are those of a complete
+ * evaluation or rows that just came into (DELTA_INSERT) or went out of
+ * (DELTA_ERASE) the input, and keep the state needed for that.
+ */
+#ifndef INQP_INCREMENTAL
+	#define INQP_INCREMENTAL 0
+#endif
+
 namespace wiselib {
 	
 	/**
@@ -56,20 +81,55 @@ namespace wiselib {
 			typedef void (*my_push_t)(void*, size_type, Row<OsModel>&);
 			typedef delegate2<void, size_type, Row<OsModel>&> push_t;
 			
+			enum { BATCH_ROWS = INQP_BATCH_ROWS ? INQP_BATCH_ROWS : 1 };
+			typedef RowBatch<OsModel, BATCH_ROWS> RowBatchT;
+			typedef void (*my_push_batch_t)(void*, size_type, RowBatchT&);
+			typedef delegate2<void, size_type, RowBatchT&> push_batch_t;
+			
 			typedef void (*my_destruct_t)(void*);
 			typedef delegate0<void> destruct_t;
 			
 			enum { CHILD_LEFT = 0, CHILD_RIGHT = 1 };
 			
+			enum { DELTA_NONE = 0, DELTA_INSERT = 1, DELTA_ERASE = 2 };
+			
 			struct ParentInfo {
 				push_t push_;
+				push_batch_t push_batch_;
 				uint8_t id_;
 				uint8_t port_;
 				
 				void push(Row<OsModel>& row) { push_(port_, row); }
+				
+				/**
+				 * true iff the parent takes batches.
+				 */
+				bool batched() { return push_batch_; }
+				
+				/**
+				 * Push the selected rows of @a batch, one by one if the parent
+				 * does not take batches (followed by END_OF_INPUT if @a batch
+				 * is the last one).
+				 */
+				void push_batch(RowBatchT& batch) {
+					if(push_batch_) {
+						push_batch_(port_, batch);
+						return;
+					}
+					
+					Row<OsModel> *row = Row<OsModel>::create(batch.columns());
+					for(size_type k = 0; k < batch.selected(); k++) {
+						batch.get_row(batch.selection(k), *row);
+						push_(port_, *row);
+					}
+					row->destroy();
+					if(batch.end_of_input()) {
+						push_(port_, END_OF_INPUT);
+					}
+				}
 			};
 			
-			Operator() : destruct_(0) {
+			Operator() : push_batch_(0), destruct_(0) {
 			}
 		
 			void init(Description* od, Query *query) {
@@ -101,8 +161,14 @@ namespace wiselib {
 				}
 			}
 			
-			void attach_to(self_type* parent) {
+			/**
+			 * Push to @a parent from now on. If @a parent takes batches,
+			 * they are pushed to it unless @a batches is false.
+			 */
+			void attach_to(self_type* parent, bool batches = true) {
 				parent_.push_ = push_t::from_stub((void*)parent, parent->push_);
+				parent_.push_batch_ = (batches && parent->push_batch_) ?
+					push_batch_t::from_stub((void*)parent, parent->push_batch_) : push_batch_t();
 				//parent_.port_ = port;
 				parent->set_projection_info(parent_.port_, projection_info_);
 			}
@@ -127,11 +193,35 @@ namespace wiselib {
 			Translator& translator() { return query_->processor().translator(); }
 			ReverseTranslator& reverse_translator() { return query_->processor().reverse_translator(); }
 			Timer& timer() { return query_->processor().timer(); }
+			
+			/**
+			 * true iff the query is evaluated incrementally.
+			 */
+			bool incremental() {
+			#if INQP_INCREMENTAL
+				return query_->incremental();
+			#else
+				return false;
+			#endif
+			}
+			
+			/**
+			 * What the rows pushed right now are, DELTA_NONE for a
+			 * complete evaluation.
+			 */
+			::uint8_t delta() {
+			#if INQP_INCREMENTAL
+				return query_->delta();
+			#else
+				return DELTA_NONE;
+			#endif
+			}
 		
 		protected:
 			ProjectionInfo<OsModel> projection_info_;
 			ParentInfo parent_;
 			my_push_t push_; // "my" push method, we need to save that for simulating virtual inheritance
+			my_push_batch_t push_batch_; // same for batches, 0 if not supported
 			my_destruct_t destruct_;
 			uint8_t type_;
 			operator_id_t id_;
@@ -54,6 +54,8 @@ namespace wiselib {
 			typedef Row<OsModel> RowT;
 			typedef Table<OsModel, RowT> TableT;
 			typedef typename RowT::Value Value;
+			typedef typename Base::RowBatchT RowBatchT;
+			typedef typename RowBatchT::index_t index_t;
 			typedef SelectionDescription<OsModel, Processor> SD;
 			
 			Selection() : selection_criteria_(0), values_(0) {
@@ -64,6 +66,9 @@ namespace wiselib {
 			void init(SD *ad, Query *query) {
 				Base::init(ad, query);
 				hardcore_cast(this->push_, &self_type::push);
+			#if INQP_BATCH_ROWS
+				hardcore_cast(this->push_batch_, &self_type::push_batch);
+			#endif
 				hardcore_cast(this->destruct_, &self_type::destruct);
 				
 				selection_columns_logical_ = ad->selection_columns();
@@ -100,13 +105,14 @@ namespace wiselib {
 			
 			void push(size_type port, RowT& row) {
 				post_init();
-				if(!&row) {
+				// END_OF_INPUT is a null reference, read its address through
+				// a volatile so the test can not be optimized away.
+				RowT * volatile r = &row;
+				if(!r) {
 					this->parent().push(row);
 					return;
 				}
 				
-				DBG("sel row %08lx %08lx", (long)row[0], (long)row[1]);
-				
 				bool match = true;
 				size_type col = 0;
 				for(size_type i = 0; i < selection_columns_logical_; i++) {
@@ -118,16 +124,12 @@ namespace wiselib {
 					int type = this->child(Base::CHILD_LEFT).result_type(col);
 					int c = compare_values(type, row[col], v);
 					
-					DBG("col%d row[col]%08lx vidx%d v%08lx",
-							(int)col, (long)row[col], (int)value_index, (long)v);
-					
 					if(!again) { col++; }
 					
 					if(!(((criterion & SD::EQ) && c == 0) ||
 							((criterion & SD::LT) && c < 0) ||
 							((criterion & SD::GT) && c > 0) ||
 							(criterion == SD::IGNORE))) {
-						DBG("crit%d c%d", (int)criterion, (int)c);
 						match = false;
 						break;
 					}
@@ -140,9 +142,126 @@ namespace wiselib {
 				
 			} // push()
 			
+			/**
+			 * Batch mode version of push(), evaluates one criterion at a
+			 * time over the whole column, narrowing down the selection
+			 * vector of @a batch.
+			 */
+			void push_batch(size_type port, RowBatchT& batch) {
+				post_init();
+				
+				index_t *sel = batch.selection();
+				size_type n = batch.selected();
+				size_type col = 0;
+				for(size_type i = 0; i < selection_columns_logical_ && n; i++) {
+					::uint8_t criterion = selection_criteria_[i] & SD::MASK_CRITERION;
+					::uint8_t value_index = selection_criteria_[i] & SD::MASK_VALUE_INDEX;
+					bool again = selection_criteria_[i] & SD::AGAIN;
+					
+					if(criterion != SD::IGNORE) {
+						// bit c + 1 set <=> comparison result c is a match
+						::uint8_t accept = ((criterion & SD::LT) ? 1 : 0) | ((criterion & SD::EQ) ? 2 : 0) | ((criterion & SD::GT) ? 4 : 0);
+						int type = this->child(Base::CHILD_LEFT).result_type(col);
+						Value *a = batch.column(col);
+						
+						if(value_index < value_count_) {
+							n = filter_constant(type, accept, a, values_[value_index], sel, n);
+						}
+						else {
+							n = filter_column(type, accept, a, batch.column(value_index - value_count_), sel, n);
+						}
+					}
+					
+					if(!again) { col++; }
+				}
+				batch.set_selected(n);
+				
+				if(n || batch.end_of_input()) {
+					this->parent().push_batch(batch);
+				}
+			}
+			
 			void execute() { }
 			
 		private:
+			typedef typename Sint<sizeof(Value)>::t SValue;
+			
+			/**
+			 * Value @a a[j] as a T (FLOAT columns hold the bits of a
+			 * float, so they can not be accessed through a float*).
+			 */
+			template<typename T>
+			static T load(Value *a, index_t j) {
+				T r;
+				memcpy(&r, a + j, sizeof(r));
+				return r;
+			}
+			
+			/**
+			 * Keep the indices in @a sel[0..n) of the rows with a[j] <op> v
+			 * (as given by @a accept, a[j] read as a T) in place.
+			 * @return Number of indices kept.
+			 */
+			template<typename T>
+			static size_type filter(::uint8_t accept, Value *a, T v, index_t *sel, size_type n) {
+				size_type m = 0;
+				for(size_type k = 0; k < n; k++) {
+					index_t j = sel[k];
+					T x = load<T>(a, j);
+					int c = (x < v) ? 0 : ((v < x) ? 2 : 1);
+					sel[m] = j;
+					m += (accept >> c) & 1;
+				}
+				return m;
+			}
+			
+			/**
+			 * Like filter() but comparing to @a b[j] instead of a constant.
+			 */
+			template<typename T>
+			static size_type filter(::uint8_t accept, Value *a, Value *b, index_t *sel, size_type n) {
+				size_type m = 0;
+				for(size_type k = 0; k < n; k++) {
+					index_t j = sel[k];
+					T x = load<T>(a, j);
+					T y = load<T>(b, j);
+					int c = (x < y) ? 0 : ((y < x) ? 2 : 1);
+					sel[m] = j;
+					m += (accept >> c) & 1;
+				}
+				return m;
+			}
+			
+			/**
+			 * Compare the values of column @a a as compare_values() would.
+			 */
+			static size_type filter_constant(int type, ::uint8_t accept, Value *a, Value v, index_t *sel, size_type n) {
+				switch(type) {
+					case ProjectionInfoBase::INTEGER:
+						return filter<SValue>(accept, a, (SValue)v, sel, n);
+					case ProjectionInfoBase::FLOAT: {
+						float f;
+						memcpy(&f, &v, sizeof(f));
+						return filter<float>(accept, a, f, sel, n);
+					}
+					case ProjectionInfoBase::STRING:
+						return filter<Value>(accept, a, v, sel, n);
+				}
+				return (accept & 2) ? n : 0;
+			}
+			
+			static size_type filter_column(int type, ::uint8_t accept, Value *a, Value *b, index_t *sel, size_type n) {
+				switch(type) {
+					case ProjectionInfoBase::INTEGER:
+						return filter<SValue>(accept, a, b, sel, n);
+					case ProjectionInfoBase::FLOAT:
+						return filter<float>(accept, a, b, sel, n);
+					case ProjectionInfoBase::STRING:
+						return filter<Value>(accept, a, b, sel, n);
+				}
+				return (accept & 2) ? n : 0;
+			}
+			
 			
 			bool post_inited_;
 			uint8_t selection_columns_logical_;
@@ -54,6 +54,7 @@ namespace wiselib {
 			typedef SimpleLocalJoin<OsModel, Processor> self_type;
 			typedef Row<OsModel> RowT;
 			typedef Table<OsModel, RowT> TableT;
+			typedef typename Base::RowBatchT RowBatchT;
 			typedef SimpleLocalJoinDescription<OsModel, Processor> SLJD;
 			
 			#pragma GCC diagnostic push
@@ -68,7 +69,11 @@ namespace wiselib {
 				
 				//this->push_ = reinterpret_cast<typename Base::my_push_t>(&self_type::push);
 				hardcore_cast(this->push_, &self_type::push);
+			#if INQP_BATCH_ROWS
+				hardcore_cast(this->push_batch_, &self_type::push_batch);
+			#endif
 				post_inited_ = false;
+				out_ = 0;
 				
 				if(left_column_ == SLJD::LEFT_COLUMN_INVALID && right_column_ == SLJD::RIGHT_COLUMN_INVALID) {
 					DBG("cross join");
@@ -85,28 +90,59 @@ namespace wiselib {
 			void destruct() {
 				//DBG("sle destr");
 				table_.destruct();
+			#if INQP_INCREMENTAL
+				right_table_.destruct();
+			#endif
+				if(out_) {
+					out_->destroy();
+					out_ = 0;
+				}
 			}
 			
 			void post_init() {
 				if(!post_inited_) {
 					table_.init(this->child(Base::CHILD_LEFT).columns());
+				#if INQP_INCREMENTAL
+					right_table_.init(this->child(Base::CHILD_RIGHT).columns());
+				#endif
 					post_inited_ = true;
 				}
 			}
 			
+			/**
+			 * Forget the rows of the last evaluation. Only needed for
+			 * incremental queries which keep them after the end of input.
+			 */
+			void reset() {
+				if(post_inited_) {
+					table_.clear();
+				#if INQP_INCREMENTAL
+					right_table_.clear();
+				#endif
+				}
+			}
+			
 			void push(size_type port, Row<OsModel>& row) {
 				post_init();
 				
 				
-				if(&row) {
+				// END_OF_INPUT is a null reference, read its address through
+				// a volatile so the test can not be optimized away.
+				RowT * volatile r = &row;
+				if(r) {
 					if(port == Base::CHILD_LEFT) {
-						GET_OS.debug("SLJl %d", (int)this->id_);
 						left_++;
+					#if INQP_INCREMENTAL
+						if(this->delta()) {
+							join_right(row);
+							update(table_, row);
+							return;
+						}
+					#endif
 						table_.insert(row);
 					}
 					else {
 						right_++;
-						GET_OS.debug("SLJr %d", (int)this->id_);
 						ProjectionInfo<OsModel>& l = this->child(Base::CHILD_LEFT);
 						ProjectionInfo<OsModel>& r = this->child(Base::CHILD_RIGHT);
 						
@@ -161,24 +197,171 @@ namespace wiselib {
 						} // for iter
 						
 						result.destroy();
+						
+					#if INQP_INCREMENTAL
+						if(this->delta()) {
+							update(right_table_, row);
+						}
+						else if(this->incremental()) {
+							right_table_.insert(row);
+						}
+					#endif
 					} // else port = left
 				} // if row
+				else if(this->delta()) {
+					// every delta ends with the input it came from
+					this->parent().push(row);
+				}
 				else if(port == Base::CHILD_RIGHT) {
+				#ifdef ISENSE
 					GET_OS.debug("slj %d push l %d r %d", (int)this->id_, (int)left_, (int)right_);
+				#endif
 					left_ = 0;
 					right_ = 0;
-					table_.clear();
+					if(!this->incremental()) {
+						table_.clear();
+					}
 					this->parent().push(row);
 				}
 			}
 			
+			/**
+			 * Batch mode version of push(). Joined rows are collected in a
+			 * batch of their own that is pushed whenever it is full and
+			 * with the end of the right input.
+			 */
+			void push_batch(size_type port, RowBatchT& batch) {
+				post_init();
+				
+				RowT *row = RowT::create(batch.columns());
+				if(port == Base::CHILD_LEFT) {
+					left_ += batch.selected();
+					for(size_type k = 0; k < batch.selected(); k++) {
+						batch.get_row(batch.selection(k), *row);
+						table_.insert(*row);
+					}
+				}
+				else {
+					right_ += batch.selected();
+					if(!out_) {
+						out_ = RowBatchT::create(this->projection_info().columns());
+					}
+					
+					ProjectionInfo<OsModel>& l = this->child(Base::CHILD_LEFT);
+					ProjectionInfo<OsModel>& r = this->child(Base::CHILD_RIGHT);
+					bool cross = (left_column_ == SLJD::LEFT_COLUMN_INVALID && right_column_ == SLJD::RIGHT_COLUMN_INVALID);
+					int type = cross ? 0 : l.result_type(left_column_);
+					
+					for(size_type k = 0; k < batch.selected(); k++) {
+						batch.get_row(batch.selection(k), *row);
+					#if INQP_INCREMENTAL
+						if(this->incremental()) {
+							right_table_.insert(*row);
+						}
+					#endif
+						for(typename TableT::iterator iter = table_.begin(); iter != table_.end(); ++iter) {
+							if(!cross && compare_values(type, (*iter)[left_column_], (*row)[right_column_]) != 0) {
+								continue;
+							}
+							
+							size_type j = out_->append();
+							size_type c = 0;
+							for(size_type i = 0; i < l.columns(); i++) {
+								if(this->projection_info().type(i) != ProjectionInfoBase::IGNORE) {
+									out_->column(c++)[j] = (*iter)[i];
+								}
+							}
+							for(size_type i = 0; i < r.columns(); i++) {
+								if(this->projection_info().type(l.columns() + i) != ProjectionInfoBase::IGNORE) {
+									out_->column(c++)[j] = (*row)[i];
+								}
+							}
+							
+							if(out_->full()) {
+								this->parent().push_batch(*out_);
+								out_->clear();
+							}
+						}
+					}
+					
+					if(batch.end_of_input()) {
+						left_ = 0;
+						right_ = 0;
+						if(!this->incremental()) {
+							table_.clear();
+						}
+						out_->set_end_of_input();
+						this->parent().push_batch(*out_);
+						out_->clear();
+					}
+				}
+				row->destroy();
+			}
+			
 			void execute() { }
 			
 		private:
+		#if INQP_INCREMENTAL
+			/**
+			 * Push the joins of the left row @a row with all right rows
+			 * kept from earlier evaluations.
+			 */
+			void join_right(RowT& row) {
+				ProjectionInfo<OsModel>& l = this->child(Base::CHILD_LEFT);
+				ProjectionInfo<OsModel>& r = this->child(Base::CHILD_RIGHT);
+				bool cross = (left_column_ == SLJD::LEFT_COLUMN_INVALID && right_column_ == SLJD::RIGHT_COLUMN_INVALID);
+				
+				RowT &result = *RowT::create(this->projection_info().columns());
+				size_type j = 0;
+				for(size_type i = 0; i < l.columns(); i++) {
+					if(this->projection_info().type(i) != ProjectionInfoBase::IGNORE) {
+						result[j++] = row[i];
+					}
+				}
+				size_type output_columns_l = j;
+				
+				for(typename TableT::iterator iter = right_table_.begin(); iter != right_table_.end(); ++iter) {
+					if(!cross && compare_values(l.result_type(left_column_), row[left_column_], (*iter)[right_column_]) != 0) {
+						continue;
+					}
+					j = output_columns_l;
+					for(size_type i = 0; i < r.columns(); i++) {
+						if(this->projection_info().type(l.columns() + i) != ProjectionInfoBase::IGNORE) {
+							result[j++] = (*iter)[i];
+						}
+					}
+					this->parent().push(result);
+				}
+				result.destroy();
+			}
+			
+			/**
+			 * Apply the delta row @a row to @a table.
+			 */
+			void update(TableT& table, RowT& row) {
+				if(this->delta() == Base::DELTA_INSERT) {
+					table.insert(row);
+					return;
+				}
+				
+				size_type row_size = table.end().row_size_;
+				for(typename TableT::iterator iter = table.begin(); iter != table.end(); ++iter) {
+					if(memcmp(&(*iter), &row, row_size) == 0) {
+						table.erase(iter);
+						return;
+					}
+				}
+			}
+			
+			/// Right rows, kept like table_ for the deltas of the left input
+			TableT right_table_;
+		#endif
+		
 			uint8_t left_column_;
 			uint8_t right_column_;
 			bool post_inited_;
 			TableT table_;
+			RowBatchT *out_;
 			int left_, right_;
 		
 	}; // SimpleLocalJoin
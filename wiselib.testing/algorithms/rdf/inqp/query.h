@@ -59,6 +59,10 @@ namespace wiselib {
 			typedef ::uint8_t query_id_t;
 			typedef ::uint8_t sequence_number_t;
 			
+		#if INQP_INCREMENTAL
+			typedef typename QueryProcessor::TupleStoreT::version_t version_t;
+		#endif
+			
 			/**
 			 */
 			void init(QueryProcessor* processor, query_id_t id) {
@@ -66,6 +70,12 @@ namespace wiselib {
 				query_id_ = id;
 				expected_operators_set_ = false;
 				entity_ = SemanticEntityId::invalid();
+			#if INQP_INCREMENTAL
+				incremental_ = true;
+				supports_incremental_ = false;
+				cached_ = false;
+				delta_ = BasicOperator::DELTA_NONE;
+			#endif
 			}
 			
 			/**
@@ -124,12 +134,29 @@ namespace wiselib {
 			 * tree.
 			 */
 			void build_tree() {
+			#if INQP_INCREMENTAL
+				supports_incremental_ = true;
+			#endif
 				for(typename Operators::iterator iter = operators_.begin(); iter != operators_.end(); ++iter) {
 					
 					BasicOperator* op = iter->second;
 					if(op->parent_id() != 0) {
 						op->attach_to(operators_[op->parent_id()]);
 					}
+				#if INQP_INCREMENTAL
+					switch(op->type()) {
+						case BOD::GRAPH_PATTERN_SELECTION:
+						case BOD::SELECTION:
+						case BOD::SIMPLE_LOCAL_JOIN:
+						case BOD::AGGREGATE:
+						case BOD::COLLECT:
+							break;
+						default:
+							// construction rules and operators that change
+							// the tuple store
+							supports_incremental_ = false;
+					}
+				#endif
 				}
 			}
 			
@@ -176,6 +203,47 @@ namespace wiselib {
 			 */
 			const SemanticEntityId& entity() { return entity_; }
 			
+		#if INQP_INCREMENTAL
+			/**
+			 * Evaluate this query completely on every execution even if
+			 * it could be evaluated incrementally.
+			 */
+			void set_incremental(bool i) {
+				incremental_ = i;
+				cached_ = false;
+			}
+			
+			/**
+			 * true iff this query is evaluated incrementally, that is
+			 * all its operators support that and it was not disabled by
+			 * set_incremental(). Known after the first execution.
+			 */
+			bool incremental() { return incremental_ && supports_incremental_; }
+			
+			/**
+			 * true iff the operators hold the result for the tuple store
+			 * contents of version @a v (and it has been sent).
+			 */
+			bool cached(version_t v) { return cached_ && version_ == v; }
+			
+			void set_cached(version_t v) {
+				cached_ = true;
+				version_ = v;
+			}
+			
+			/**
+			 * Have the next execution evaluate this query completely, for
+			 * operators that can not take a change incrementally.
+			 */
+			void invalidate() { cached_ = false; }
+			
+			/**
+			 * See Operator::delta().
+			 */
+			::uint8_t delta() { return delta_; }
+			void set_delta(::uint8_t d) { delta_ = d; }
+		#endif
+			
 			
 		private:
 			query_id_t query_id_;
@@ -184,6 +252,13 @@ namespace wiselib {
 			size_type expected_operators_;
 			bool expected_operators_set_;
 			SemanticEntityId entity_;
+		#if INQP_INCREMENTAL
+			version_t version_;
+			bool incremental_;
+			bool supports_incremental_;
+			bool cached_;
+			::uint8_t delta_;
+		#endif
 			
 		
 	}; // INQPQuery
@@ -95,7 +95,9 @@ namespace wiselib {
 			enum CommunicationType {
 				COMMUNICATION_TYPE_SINK,
 				COMMUNICATION_TYPE_AGGREGATE,
-				COMMUNICATION_TYPE_CONSTRUCTION_RULE
+				COMMUNICATION_TYPE_CONSTRUCTION_RULE,
+				/// A row sent to the sink before is no longer in the result
+				COMMUNICATION_TYPE_SINK_RETRACT
 			};
 			
 			/// @{ Operators
@@ -201,6 +203,13 @@ namespace wiselib {
 
 			/**
 			 * Execute the given query.
+			 * 
+			 * With INQP_INCREMENTAL, a query whose operators all support
+			 * it keeps its operator state between executions and is only
+			 * evaluated completely when the tuple store changed in a way
+			 * not propagated by insert_tuple() or erase_tuple(). An
+			 * execution of a query that is up to date with the tuple
+			 * store does nothing (the sink already has its result).
 			 */
 			void execute(Query *query) {
 				DBG("exec query %d", (int)query->id());
@@ -212,8 +221,38 @@ namespace wiselib {
 					GET_OS.debug("xq%d", (int)query->id());
 				#endif
 				assert(query->ready());
+			#if INQP_INCREMENTAL
+				if(query->incremental() && query->cached(tuple_store_->version())) {
+					if(exec_done_callback_) {
+						exec_done_callback_();
+					}
+					return;
+				}
+			#endif
 				query->build_tree();
 				
+				// Operators that keep rows between executions start over
+				for(operator_id_t id = 0; id < MAX_OPERATOR_ID; id++) {
+					if(!query->operators().contains(id)) { continue; }
+					
+					BasicOperator *op = query->operators()[id];
+					switch(op->type()) {
+						case BOD::SIMPLE_LOCAL_JOIN:
+							(reinterpret_cast<SimpleLocalJoinT*>(op))->reset();
+							break;
+						case BOD::AGGREGATE:
+							(reinterpret_cast<AggregateT*>(op))->reset();
+							break;
+					#if INQP_INCREMENTAL
+						case BOD::COLLECT:
+							(reinterpret_cast<CollectT*>(op))->reset();
+							break;
+					#endif
+						default:
+							break;
+					}
+				}
+				
 				for(operator_id_t id = 0; id < MAX_OPERATOR_ID; id++) {
 					if(!query->operators().contains(id)) { continue; }
 					
@@ -250,6 +289,12 @@ namespace wiselib {
 					}
 				}
 				
+			#if INQP_INCREMENTAL
+				if(query->incremental()) {
+					query->set_cached(tuple_store_->version());
+				}
+			#endif
+				
 				if(exec_done_callback_) {
 					exec_done_callback_();
 				}
@@ -443,17 +488,11 @@ namespace wiselib {
 			/**
 			 */
 			Query* create_query(query_id_t qid) {
-				GET_OS.fatal("f:%d", (int)mem->mem_free());
-				
 				Query *q = ::get_allocator().template allocate<Query>().raw();
-				GET_OS.fatal("-1 f:%d", (int)mem->mem_free());
 				q->init(this, qid);
-				GET_OS.fatal("-2 f:%d", (int)mem->mem_free());
 				if(queries_.size() >= queries_.capacity()) {
-				GET_OS.fatal("-3 f:%d", (int)mem->mem_free());
 					assert(false && "queries full, clean them up from time to time!");
 				}
-				GET_OS.fatal("-4 f:%d", (int)mem->mem_free());
 				queries_[qid] = q;
 				return q;
 			}
@@ -478,6 +517,37 @@ namespace wiselib {
 				}
 			}
 			
+		#if INQP_INCREMENTAL
+			/**
+			 * Insert @a t into the tuple store and update the results of
+			 * the incremental queries that are up to date with it.
+			 */
+			template<typename UserTuple>
+			typename TupleStoreT::iterator insert_tuple(UserTuple& t) {
+				typename TupleStoreT::version_t v = tuple_store_->version();
+				typename TupleStoreT::iterator it = tuple_store_->insert(t);
+				if(tuple_store_->version() != v) {
+					propagate(it, BasicOperator::DELTA_INSERT, v);
+					advance(v);
+				}
+				return it;
+			}
+			
+			/**
+			 * Erase the tuple @a it points to from the tuple store like
+			 * TupleStoreT::erase() and update the results of the
+			 * incremental queries that are up to date with it.
+			 */
+			typename TupleStoreT::iterator erase_tuple(typename TupleStoreT::iterator it) {
+				typename TupleStoreT::version_t v = tuple_store_->version();
+				// before erasing, the strings are still in the dictionary
+				propagate(it, BasicOperator::DELTA_ERASE, v);
+				it = tuple_store_->erase(it);
+				advance(v);
+				return it;
+			}
+		#endif
+			
 			///
 			TupleStoreT& tuple_store() { return *tuple_store_; }
 			
@@ -495,6 +565,48 @@ namespace wiselib {
 			
 		private:
 			
+		#if INQP_INCREMENTAL
+			/**
+			 * Push the tuple @a it points to as @a delta through the
+			 * queries that hold the result for version @a v.
+			 */
+			void propagate(typename TupleStoreT::iterator& it, ::uint8_t delta, typename TupleStoreT::version_t v) {
+				typedef typename GraphPatternSelectionT::key_type key_type;
+				key_type keys[GraphPatternSelectionT::TS_SEMANTIC_COLUMNS];
+				for(size_type i = 0; i < GraphPatternSelectionT::TS_SEMANTIC_COLUMNS; i++) {
+					keys[i] = it.container_iterator()->get_key(i);
+				}
+				
+				for(typename Queries::iterator qit = queries_.begin(); qit != queries_.end(); ++qit) {
+					Query *query = qit->second;
+					if(!query->incremental() || !query->cached(v)) { continue; }
+					
+					query->set_delta(delta);
+					for(operator_id_t id = 0; id < MAX_OPERATOR_ID; id++) {
+						if(!query->operators().contains(id)) { continue; }
+						
+						BasicOperator *op = query->operators()[id];
+						if(op->type() == BOD::GRAPH_PATTERN_SELECTION) {
+							(reinterpret_cast<GraphPatternSelectionT*>(op))->execute_delta(keys);
+						}
+					}
+					query->set_delta(BasicOperator::DELTA_NONE);
+				}
+			}
+			
+			/**
+			 * Queries that held the result for version @a v and were not
+			 * invalidated by the change now hold it for the current one.
+			 */
+			void advance(typename TupleStoreT::version_t v) {
+				for(typename Queries::iterator qit = queries_.begin(); qit != queries_.end(); ++qit) {
+					if(qit->second->cached(v)) {
+						qit->second->set_cached(tuple_store_->version());
+					}
+				}
+			}
+		#endif
+			
 			typename TupleStoreT::self_pointer_t tuple_store_;
 			typename Timer::self_pointer_t timer_;
 			RowCallbacks row_callbacks_;
@@ -0,0 +1,168 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef ROW_BATCH_H
+#define ROW_BATCH_H
+
+#include <external_interface/external_interface.h>
+#include "row.h"
+
+namespace wiselib {
+	
+	/**
+	 * @brief Fixed size batch of (intermediate) query result rows, stored
+	 * by column, for the batch mode of the operators (see
+	 * INQP_BATCH_ROWS in operator.h).
+	 * 
+	 * Column i of row j is column(i)[j]. Which of the rows are valid is
+	 * given by the selection vector: selected() row indices, ascending,
+	 * selection(k) being the k'th of them. Operators that filter rows
+	 * (e.g. Selection) just shrink the selection vector instead of
+	 * copying the column values around.
+	 * 
+	 * A batch with end_of_input() set is the last one a child pushes for
+	 * this execution, it may still contain rows. This takes the place of
+	 * the END_OF_INPUT row of row-at-a-time mode.
+	 * 
+	 * @tparam CAPACITY_P number of rows per batch, at most 65535.
+	 */
+	template<
+		typename OsModel_P,
+		int CAPACITY_P,
+		typename Value_P = ::uint32_t
+	>
+	class RowBatch {
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef Value_P Value;
+			typedef Row<OsModel_P, Value_P> RowT;
+			typedef ::uint16_t index_t;
+			typedef RowBatch<OsModel_P, CAPACITY_P, Value_P> self_type;
+			
+			enum { CAPACITY = CAPACITY_P };
+			
+			/**
+			 * Allocate an empty batch with the given number of columns using
+			 * the allocator.
+			 */
+			static RowBatch* create(size_type columns) {
+				RowBatch *r = reinterpret_cast<RowBatch*>( ::get_allocator()
+					.template allocate_array<block_data_t>(sizeof(self_type) + sizeof(Value) * CAPACITY * columns).raw() );
+				r->columns_ = columns;
+				r->clear();
+				return r;
+			}
+			
+			/**
+			 * Free this batch instance using the allocator.
+			 */
+			void destroy() {
+				::get_allocator().free_array(reinterpret_cast<block_data_t*>(this));
+			}
+			
+			/**
+			 * Remove all rows and reset the end of input flag.
+			 */
+			void clear() {
+				size_ = 0;
+				selected_ = 0;
+				end_of_input_ = false;
+			}
+			
+			size_type columns() { return columns_; }
+			
+			/**
+			 * Number of rows stored, including the ones not selected.
+			 */
+			size_type size() { return size_; }
+			bool full() { return size_ == CAPACITY; }
+			
+			Value* column(size_type i) { return data_ + i * CAPACITY; }
+			
+			/**
+			 * Number of valid rows.
+			 */
+			size_type selected() { return selected_; }
+			
+			/**
+			 * Index of the k'th valid row.
+			 */
+			index_t selection(size_type k) { return selection_[k]; }
+			
+			/**
+			 * The selection vector, write access is for filtering it in
+			 * place, call set_selected() afterwards.
+			 */
+			index_t* selection() { return selection_; }
+			void set_selected(size_type n) { selected_ = n; }
+			
+			bool end_of_input() { return end_of_input_; }
+			void set_end_of_input(bool e = true) { end_of_input_ = e; }
+			
+			/**
+			 * Append a row and select it, the batch must not be full.
+			 * @return Index of the new row.
+			 */
+			index_t append() {
+				selection_[selected_++] = size_;
+				return size_++;
+			}
+			
+			/**
+			 * Append a copy of @a row and select it, the batch must not be
+			 * full.
+			 */
+			void append(RowT& row) {
+				index_t j = append();
+				for(size_type i = 0; i < columns_; i++) {
+					data_[i * CAPACITY + j] = row[i];
+				}
+			}
+			
+			/**
+			 * Copy row @a j (an index into the columns, not into the
+			 * selection vector) to @a row.
+			 */
+			void get_row(size_type j, RowT& row) {
+				for(size_type i = 0; i < columns_; i++) {
+					row[i] = data_[i * CAPACITY + j];
+				}
+			}
+			
+		private:
+			// not implementable as we dont know our own size!
+			self_type& operator=(const self_type& other);
+			RowBatch(const RowBatch& other);
+			
+			index_t selection_[CAPACITY_P];
+			index_t size_;
+			index_t selected_;
+			::uint8_t columns_;
+			bool end_of_input_;
+			
+			Value data_[0];
+			
+	}; // RowBatch
+}
+
+#endif // ROW_BATCH_H
+
@@ -0,0 +1,505 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef INQP_SHARDED_QUERY_PROCESSOR_H
+#define INQP_SHARDED_QUERY_PROCESSOR_H
+
+#include <map>
+#include <vector>
+
+#include "external_interface/pc/pc_thread_pool.h"
+#include "query_processor.h"
+#include "operators/exchange.h"
+
+namespace wiselib {
+
+	/**
+	 * @brief Evaluates INQP queries in parallel on the shards of a
+	 * partitioned tuple store.
+	 *
+	 * The tuples are hash partitioned by the dictionary key of their
+	 * subject into shards() tuple stores that share one dictionary (see
+	 * insert() and partition()). Every query is instantiated once per
+	 * shard and once in a coordinating Processor_P, processor(), which
+	 * sends the results (register the row callbacks there).
+	 *
+	 * Graph pattern selections, selections above them and aggregates
+	 * above those are shard-local. They are evaluated on every shard,
+	 * the shards are taken by the workers of a PCThreadPool. The topmost
+	 * shard-local operators push into an Exchange per shard, aggregates
+	 * only aggregate their shard (Aggregate::set_partial()). Then the
+	 * calling thread flushes the exchanges of all shards, in shard order,
+	 * to the coordinator's joins and collects and merges the partial
+	 * aggregates into the coordinator's aggregates, which send their
+	 * results as usual. This goes by graph pattern selection in id order
+	 * like INQPQueryProcessor::execute(), so a join gets all of its left
+	 * input before the right one.
+	 *
+	 * While the shards are evaluated, the dictionary is only read from
+	 * several threads (get_value(), find(), and the hash lookups of
+	 * indexed translators), which HashDictionary allows. Every shard has
+	 * its own translators. The result is that of INQPQueryProcessor on
+	 * one store with all tuples, up to the order of the rows and the
+	 * rounding of INTEGER AVG aggregates which depends on that order.
+	 *
+	 * The shard workers allocate concurrently from the global allocator
+	 * (::get_allocator(): Row::create(), the group tables of aggregates,
+	 * tuple store iterators), so it has to be thread-safe when more than
+	 * one thread is used. MallocFreeAllocator is, the block based
+	 * allocators (BitmapAllocator etc.) are not.
+	 *
+	 * Queries are evaluated completely on every execute(). Queries that
+	 * change the tuple store (CONSTRUCT, DELETE) are not supported.
+	 *
+	 * Uses threads and the STL, so this is for PC only.
+	 *
+	 * @tparam Processor_P INQPQueryProcessor type of the coordinator and
+	 * the shards.
+	 */
+	template<
+		typename OsModel_P,
+		typename Processor_P
+	>
+	class ShardedQueryProcessor {
+
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef ShardedQueryProcessor self_type;
+			typedef self_type* self_pointer_t;
+
+			typedef Processor_P Processor;
+			typedef typename Processor::TupleStoreT TupleStoreT;
+			typedef typename TupleStoreT::TupleContainer TupleContainer;
+			typedef typename TupleStoreT::Dictionary Dictionary;
+			typedef typename Dictionary::key_type key_type;
+			typedef typename Processor::Timer Timer;
+			typedef typename Processor::Query Query;
+			typedef typename Processor::query_id_t query_id_t;
+			typedef typename Processor::operator_id_t operator_id_t;
+			typedef typename Processor::BasicOperator BasicOperator;
+			typedef typename Processor::BOD BOD;
+			typedef typename Processor::GraphPatternSelectionT GraphPatternSelectionT;
+			typedef typename Processor::SimpleLocalJoinT SimpleLocalJoinT;
+			typedef typename Processor::AggregateT AggregateT;
+			typedef typename Processor::CollectT CollectT;
+			typedef typename AggregateT::GroupTableT GroupTableT;
+			typedef Exchange<OsModel, Processor> ExchangeT;
+			typedef PCThreadPool<OsModel> ThreadPool;
+
+			enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+			enum { MAX_OPERATOR_ID = Processor::MAX_OPERATOR_ID };
+
+			ShardedQueryProcessor() : shards_(0), shard_count_(0), dictionary_(0) {
+			}
+
+			~ShardedQueryProcessor() {
+				destruct();
+			}
+
+			/**
+			 * @param dictionary dictionary of all shards.
+			 * @param shards number of shards.
+			 * @param threads number of workers including the calling
+			 * thread, 0 = one per cpu.
+			 */
+			int init(Dictionary *dictionary, typename Timer::self_pointer_t timer, size_type shards,
+					size_type threads = 0, typename TupleStoreT::Debug::self_pointer_t debug = 0) {
+				destruct();
+				if(shards == 0) { return ERR_UNSPEC; }
+
+				dictionary_ = dictionary;
+				shard_count_ = shards;
+				shards_ = ::get_allocator().template allocate_array<Shard>(shard_count_).raw();
+				for(size_type s = 0; s < shard_count_; s++) {
+					Shard &shard = shards_[s];
+					shard.container = ::get_allocator().template allocate<TupleContainer>().raw();
+					shard.tuple_store.init(dictionary_, shard.container, debug);
+					shard.processor.init(&shard.tuple_store, timer);
+				}
+				// The coordinator only evaluates operators above the
+				// shard-local ones, it needs a tuple store for the
+				// dictionary though.
+				coordinator_.init(&shards_[0].tuple_store, timer);
+				return pool_.init(threads);
+			}
+
+			/**
+			 * Erase all queries and tuples.
+			 */
+			int destruct() {
+				while(!queries_.empty()) {
+					erase_query(queries_.begin()->first);
+				}
+				for(size_type s = 0; s < shard_count_; s++) {
+					TupleStoreT &ts = shards_[s].tuple_store;
+					while(ts.begin() != ts.end()) {
+						ts.erase(ts.begin());
+					}
+					::get_allocator().free(shards_[s].container);
+				}
+				if(shards_) {
+					::get_allocator().free_array(shards_);
+				}
+				shards_ = 0;
+				shard_count_ = 0;
+				pool_.destruct();
+				return SUCCESS;
+			}
+
+			size_type shards() { return shard_count_; }
+			size_type threads() { return pool_.size(); }
+
+			/// Tuple store of shard @a s.
+			TupleStoreT& shard(size_type s) { return shards_[s].tuple_store; }
+
+			/// The coordinator, which sends the results.
+			Processor& processor() { return coordinator_; }
+
+			Dictionary& dictionary() { return *dictionary_; }
+
+			/**
+			 * @return shard of the tuples with subject key @a k.
+			 */
+			size_type shard_of(key_type k) {
+				::uint32_t h = (::uint32_t)k * 0x9e3779b1UL;
+				return (h ^ (h >> 16)) % shard_count_;
+			}
+
+			/**
+			 * Insert @a t into the shard of its subject, like
+			 * TupleStore::insert().
+			 */
+			template<typename UserTuple>
+			typename TupleStoreT::iterator insert(UserTuple& t) {
+				// hold a reference of the subject so its key is known
+				// before the tuple goes in
+				key_type k = dictionary_->insert(t.get(0));
+				typename TupleStoreT::iterator it = shards_[shard_of(k)].tuple_store.insert(t);
+				dictionary_->erase(k);
+				return it;
+			}
+
+			/**
+			 * Insert all tuples of @a source, which has to use the same
+			 * dictionary, into their shards. @a source is not changed.
+			 *
+			 * The tuples go in one shard after the other, so containers
+			 * that allocate a node per tuple get the nodes of a shard
+			 * close to each other. Inserted in source order, a scan of
+			 * one shard touches a new page for nearly every tuple.
+			 */
+			template<typename SourceTupleStore>
+			void partition(SourceTupleStore& source) {
+				typedef typename SourceTupleStore::TupleContainer SourceContainer;
+				typedef typename SourceContainer::value_type SourceTuple;
+
+				SourceContainer &c = source.container();
+				std::vector<std::vector<SourceTuple*> > tuples(shard_count_);
+				for(typename SourceContainer::iterator it = c.begin(); it != c.end(); ++it) {
+					tuples[shard_of(it->get_key(0))].push_back(&*it);
+				}
+				for(size_type s = 0; s < shard_count_; s++) {
+					for(size_type i = 0; i < tuples[s].size(); i++) {
+						shards_[s].tuple_store.insert_raw(*tuples[s][i]);
+					}
+				}
+			}
+
+			/**
+			 * Add the operator description @a od to query @a qid, see
+			 * INQPQueryProcessor::handle_operator(). The query is executed
+			 * when it is complete.
+			 */
+			void handle_operator(query_id_t qid, size_type size, block_data_t *od) {
+				coordinator_.handle_operator(qid, size, od);
+				for(size_type s = 0; s < shard_count_; s++) {
+					shards_[s].processor.handle_operator(qid, size, od);
+				}
+				queries_[qid];
+				if(ready(qid)) {
+					execute(qid);
+				}
+			}
+
+			/**
+			 * Set the number of operators of query @a qid, see
+			 * INQPQueryProcessor::handle_query_info().
+			 */
+			void handle_query_info(query_id_t qid, size_type nops) {
+				QueryInfo &info = queries_[qid];
+				info.expected_operators = nops;
+				info.expected_operators_set = true;
+				if(ready(qid)) {
+					execute(qid);
+				}
+			}
+
+			void erase_query(query_id_t qid) {
+				typename Queries::iterator it = queries_.find(qid);
+				if(it == queries_.end()) { return; }
+
+				QueryInfo &info = it->second;
+				for(typename Exchanges::iterator e = info.exchanges.begin(); e != info.exchanges.end(); ++e) {
+					for(size_type s = 0; s < e->second.size(); s++) {
+						e->second[s]->destruct();
+						::get_allocator().free(e->second[s]);
+					}
+				}
+				coordinator_.erase_query(qid);
+				for(size_type s = 0; s < shard_count_; s++) {
+					shards_[s].processor.erase_query(qid);
+				}
+				queries_.erase(it);
+			}
+
+			/**
+			 * Execute all complete queries.
+			 */
+			void execute_all() {
+				for(typename Queries::iterator it = queries_.begin(); it != queries_.end(); ++it) {
+					if(ready(it->first)) {
+						execute(it->first);
+					}
+				}
+			}
+
+			/**
+			 * Execute query @a qid.
+			 * @return ERR_UNSPEC if it is not complete or not supported.
+			 */
+			int execute(query_id_t qid) {
+				if(!ready(qid)) { return ERR_UNSPEC; }
+				QueryInfo &info = queries_[qid];
+				if(!info.prepared && prepare(qid, info) != SUCCESS) {
+					return ERR_UNSPEC;
+				}
+
+				Query *query = coordinator_.get_query(qid);
+				for(operator_id_t id = 0; id < MAX_OPERATOR_ID; id++) {
+					if(!query->operators().contains(id)) { continue; }
+
+					BasicOperator *op = query->operators()[id];
+					switch(op->type()) {
+						case BOD::SIMPLE_LOCAL_JOIN:
+							(reinterpret_cast<SimpleLocalJoinT*>(op))->reset();
+							break;
+						case BOD::AGGREGATE:
+							(reinterpret_cast<AggregateT*>(op))->reset();
+							break;
+					#if INQP_INCREMENTAL
+						case BOD::COLLECT:
+							(reinterpret_cast<CollectT*>(op))->reset();
+							break;
+					#endif
+						default:
+							break;
+					}
+				}
+
+				current_ = qid;
+				next_shard_ = 0;
+				pool_.template run<self_type, &self_type::execute_shards>(this);
+
+				for(operator_id_t id = 0; id < MAX_OPERATOR_ID; id++) {
+					if(!query->operators().contains(id)) { continue; }
+
+					BasicOperator *op = query->operators()[id];
+					if(op->type() != BOD::GRAPH_PATTERN_SELECTION) { continue; }
+
+					op = top(query, info, op);
+					if(op->type() == BOD::AGGREGATE) {
+						AggregateT *aggregate = reinterpret_cast<AggregateT*>(op);
+						for(size_type s = 0; s < shard_count_; s++) {
+							GroupTableT &partial = reinterpret_cast<AggregateT*>(
+									shards_[s].processor.get_query(qid)->operators()[op->id()])->local_aggregates();
+							for(typename GroupTableT::iterator it = partial.begin(); it != partial.end(); ++it) {
+								aggregate->merge_partial(*it);
+							}
+						}
+						aggregate->push(BasicOperator::CHILD_LEFT, ExchangeT::end_of_input());
+					}
+					else {
+						std::vector<ExchangeT*> &exchanges = info.exchanges[op->id()];
+						for(size_type s = 0; s < shard_count_; s++) {
+							exchanges[s]->flush(op->parent());
+						}
+						op->parent().push(ExchangeT::end_of_input());
+					}
+				}
+
+				if(coordinator_.exec_done_callback_) {
+					coordinator_.exec_done_callback_();
+				}
+				return SUCCESS;
+			}
+
+		private:
+			struct Shard {
+				TupleContainer *container;
+				TupleStoreT tuple_store;
+				Processor processor;
+			};
+
+			typedef std::map<operator_id_t, std::vector<ExchangeT*> > Exchanges;
+
+			struct QueryInfo {
+				QueryInfo() : expected_operators(0), expected_operators_set(false), prepared(false) {
+				}
+
+				size_type expected_operators;
+				bool expected_operators_set;
+				bool prepared;
+				/// Shard-local operators
+				std::vector<bool> local;
+				/// Exchanges of the topmost shard-local operators, by shard
+				Exchanges exchanges;
+			};
+
+			typedef std::map<query_id_t, QueryInfo> Queries;
+
+			bool ready(query_id_t qid) {
+				typename Queries::iterator it = queries_.find(qid);
+				Query *query = coordinator_.get_query(qid);
+				return it != queries_.end() && query && it->second.expected_operators_set
+					&& it->second.expected_operators == query->operators().size();
+			}
+
+			/**
+			 * Build the trees of the complete query @a qid, find the
+			 * shard-local operators and connect the topmost ones to their
+			 * exchanges or make them partial aggregates.
+			 */
+			int prepare(query_id_t qid, QueryInfo& info) {
+				Query *query = coordinator_.get_query(qid);
+				query->build_tree();
+
+				info.local.assign(MAX_OPERATOR_ID, false);
+				for(operator_id_t id = 0; id < MAX_OPERATOR_ID; id++) {
+					if(!query->operators().contains(id)) { continue; }
+
+					switch(query->operators()[id]->type()) {
+						case BOD::GRAPH_PATTERN_SELECTION:
+						case BOD::SELECTION:
+						case BOD::AGGREGATE:
+							info.local[id] = true;
+							break;
+						case BOD::SIMPLE_LOCAL_JOIN:
+						case BOD::COLLECT:
+						case BOD::CONSTRUCTION_RULE:
+							break;
+						default:
+							return ERR_UNSPEC;
+					}
+				}
+
+				// an operator above one that is not shard-local is not
+				// either
+				for(bool changed = true; changed; ) {
+					changed = false;
+					for(operator_id_t id = 0; id < MAX_OPERATOR_ID; id++) {
+						if(!query->operators().contains(id) || info.local[id]) { continue; }
+
+						operator_id_t parent = query->operators()[id]->parent_id();
+						if(parent && info.local[parent]) {
+							info.local[parent] = false;
+							changed = true;
+						}
+					}
+				}
+
+				for(size_type s = 0; s < shard_count_; s++) {
+					shards_[s].processor.get_query(qid)->build_tree();
+				}
+
+				for(operator_id_t id = 0; id < MAX_OPERATOR_ID; id++) {
+					if(!query->operators().contains(id) || !info.local[id]) { continue; }
+
+					BasicOperator *op = query->operators()[id];
+					if(op->type() == BOD::AGGREGATE) {
+						for(size_type s = 0; s < shard_count_; s++) {
+							reinterpret_cast<AggregateT*>(shards_[s].processor.get_query(qid)->operators()[id])->set_partial(true);
+						}
+					}
+					else if(op->parent_id() && !info.local[op->parent_id()]) {
+						std::vector<ExchangeT*> &exchanges = info.exchanges[id];
+						for(size_type s = 0; s < shard_count_; s++) {
+							Query *q = shards_[s].processor.get_query(qid);
+							ExchangeT *exchange = ::get_allocator().template allocate<ExchangeT>().raw();
+							exchange->init(q, q->operators()[id]);
+							exchanges.push_back(exchange);
+						}
+					}
+				}
+
+				info.prepared = true;
+				return SUCCESS;
+			}
+
+			/**
+			 * Topmost shard-local operator above (or) @a op.
+			 */
+			BasicOperator* top(Query *query, QueryInfo& info, BasicOperator *op) {
+				while(op->parent_id() && info.local[op->parent_id()]) {
+					op = query->operators()[op->parent_id()];
+				}
+				return op;
+			}
+
+			/**
+			 * Worker: evaluate the shard-local operators of the current
+			 * query on the shards that are not taken yet.
+			 */
+			void execute_shards(size_type worker, size_type workers) {
+				for(size_type s = __sync_fetch_and_add(&next_shard_, (size_type)1); s < shard_count_;
+						s = __sync_fetch_and_add(&next_shard_, (size_type)1)) {
+					Shard &shard = shards_[s];
+					Query *query = shard.processor.get_query(current_);
+
+					for(operator_id_t id = 0; id < MAX_OPERATOR_ID; id++) {
+						if(query->operators().contains(id) && query->operators()[id]->type() == BOD::AGGREGATE) {
+							(reinterpret_cast<AggregateT*>(query->operators()[id]))->reset();
+						}
+					}
+					for(operator_id_t id = 0; id < MAX_OPERATOR_ID; id++) {
+						if(query->operators().contains(id) && query->operators()[id]->type() == BOD::GRAPH_PATTERN_SELECTION) {
+							(reinterpret_cast<GraphPatternSelectionT*>(query->operators()[id]))->execute(shard.tuple_store);
+						}
+					}
+				}
+			}
+
+			Shard *shards_;
+			size_type shard_count_;
+			Dictionary *dictionary_;
+			Processor coordinator_;
+			Queries queries_;
+			ThreadPool pool_;
+			query_id_t current_;
+			volatile size_type next_shard_;
+
+			ShardedQueryProcessor(const self_type&);
+			self_type& operator=(const self_type&);
+
+	}; // ShardedQueryProcessor
+}
+
+#endif // INQP_SHARDED_QUERY_PROCESSOR_H
+
@@ -203,6 +203,19 @@ namespace wiselib {
 				check();
 			}
 			
+			/**
+			 * Delete the row @a it points to, the last row takes its place
+			 * (so the order of rows is not kept). Invalidates iterators.
+			 */
+			void erase(iterator it) {
+				check();
+				block_data_t *last = buffer_ + (size_ - 1) * row_size_;
+				if(it.p_ != last) {
+					memcpy(it.p_, last, row_size_);
+				}
+				pop_back();
+			}
+			
 			/**
 			 * delete the last row from the table
 			 */
@@ -263,8 +276,8 @@ namespace wiselib {
 			}
 			
 			size_type row_size_;
-			::uint16_t capacity_;
-			::uint16_t size_;
+			size_type capacity_;
+			size_type size_;
 			block_data_t *buffer_;
 		
 	}; // Table
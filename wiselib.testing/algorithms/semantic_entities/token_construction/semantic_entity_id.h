@@ -75,7 +75,18 @@ namespace wiselib {
 				return ((b * 5) & 0xff) ^ ((b * 11) >> 8);
 			}
 			
-			::uint8_t hash() const { return hash8(); }
+			/**
+			 * 32 bit hash for the AMQ filters of the neighborhood (which
+			 * derive all their bit positions from it), use hash8() where
+			 * a single byte is needed.
+			 */
+			::uint32_t hash() const {
+				::uint32_t h = rule_ * 0x9e3779b1UL + value_;
+				h ^= h >> 16;
+				h *= 0x85ebca6bUL;
+				h ^= h >> 13;
+				return h;
+			}
 			
 			void set(Rule r, Value v) {
 				rule_ = r;
@@ -26,7 +26,7 @@
 //#include <algorithms/protocols/reliable_transport/reliable_transport.h>
 #include <algorithms/protocols/reliable_transport/one_at_a_time_reliable_transport.h>
 #include <algorithms/routing/ss/self_stabilizing_tree.h>
-#include <algorithms/bloom_filter/bloom_filter.h>
+#include <algorithms/bloom_filter/blocked_bloom_filter.h>
 
 #include "regular_event.h"
 #include "semantic_entity.h"
@@ -37,6 +37,10 @@
 #endif
 */
 
+#ifndef INSE_BLOOM_FILTER_HASHES
+	#define INSE_BLOOM_FILTER_HASHES 3
+#endif
+
 #if INSE_USE_AGGREGATOR
 	#include "semantic_entity_aggregator.h"
 #endif
@@ -99,6 +103,7 @@ namespace wiselib {
 				MAX_NEIGHBORS = INSE_MAX_NEIGHBORS,
 				MAX_SEMANTIC_ENTITIES = INSE_MAX_SEMANTIC_ENTITIES,
 				BLOOM_FILTER_BITS = INSE_BLOOM_FILTER_BITS,
+				BLOOM_FILTER_HASHES = INSE_BLOOM_FILTER_HASHES,
 				MAX_AGGREGATOR_ENTRIES = 8,
 				MAX_SHDT_TABLE_SIZE = 8,
 				MAX_SSTREE_LISTENERS = 4,
@@ -106,7 +111,10 @@ namespace wiselib {
 			};
 			
 			typedef NapControl<OsModel, Radio> NapControlT;
-			typedef BloomFilter<OsModel, SemanticEntityId, BLOOM_FILTER_BITS> AmqT;
+			// A handful of SEs per subtree in a beacon sized filter: use
+			// a single (unblocked) block and several hashes per element
+			typedef BlockedBloomFilter<OsModel, SemanticEntityId, BLOOM_FILTER_BITS,
+					BLOOM_FILTER_HASHES, DivCeil<BLOOM_FILTER_BITS, 32>::value> AmqT;
 			typedef SelfStabilizingTree<OsModel, AmqT, Radio, Clock, Timer, Debug, NapControlT, MAX_NEIGHBORS, MAX_SSTREE_LISTENERS> GlobalTreeT;
 			//typedef ReliableTransport<OsModel, SemanticEntityId, GlobalTreeT, Radio, Timer, Clock, Rand, Debug, MAX_SEMANTIC_ENTITIES * 2, INSE_MESSAGE_TYPE_TOKEN_RELIABLE> ReliableTransportT;
 			typedef OneAtATimeReliableTransport<OsModel, SemanticEntityId, GlobalTreeT, Radio, Timer, Clock, Rand, Debug, MAX_SEMANTIC_ENTITIES * 2, INSE_MESSAGE_TYPE_TOKEN_RELIABLE> ReliableTransportT;
@@ -0,0 +1,202 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+// vim: set noexpandtab ts=4 sw=4:
+
+#ifndef PC_THREAD_POOL_H
+#define PC_THREAD_POOL_H
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "util/delegates/delegate.hpp"
+
+namespace wiselib {
+
+	/**
+	 * Fixed set of worker threads for PC-side bulk computations
+	 * (batch solvers, graph kernels, bulk loading, query evaluation).
+	 *
+	 * A job is a delegate that gets called once per worker with the
+	 * workers index and the total number of workers, run() returns after
+	 * all workers finished. The calling thread acts as worker 0, so a pool
+	 * of size 1 does not create any threads at all.
+	 *
+	 * Not available on embedded targets.
+	 */
+	template<typename OsModel_P>
+	class PCThreadPool {
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::size_t size_type;
+			typedef PCThreadPool<OsModel_P> self_type;
+			typedef self_type* self_pointer_t;
+			typedef delegate2<void, size_type, size_type> job_delegate_t;
+
+			enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+			enum { MAX_WORKERS = 256 };
+
+			PCThreadPool() : workers_(0), stop_(false) {
+			}
+
+			~PCThreadPool() {
+				destruct();
+			}
+
+			/**
+			 * @param workers number of workers (including the calling
+			 * thread), 0 means one per online cpu.
+			 * @return ERR_UNSPEC if not all threads could be started, the
+			 * pool is then left uninitialized.
+			 */
+			int init(size_type workers = 0) {
+				destruct();
+				if(workers == 0) {
+					long n = sysconf(_SC_NPROCESSORS_ONLN);
+					workers = (n < 1) ? 1 : (size_type)n;
+				}
+				if(workers > MAX_WORKERS) { workers = MAX_WORKERS; }
+
+				workers_ = workers;
+				stop_ = false;
+				if(workers_ == 1) { return SUCCESS; }
+
+				// Workers wait for startup_ before touching the barriers,
+				// so if not all of them can be started the ones we have
+				// can still be told to quit.
+				pthread_mutex_init(&startup_, 0);
+				pthread_mutex_lock(&startup_);
+				pthread_barrier_init(&start_, 0, workers_);
+				pthread_barrier_init(&done_, 0, workers_);
+				size_type started = 1;
+				for( ; started < workers_; started++) {
+					args_[started].pool = this;
+					args_[started].index = started;
+					if(pthread_create(&threads_[started], 0, &self_type::thread_main, &args_[started]) != 0) {
+						break;
+					}
+				}
+				stop_ = (started < workers_);
+				pthread_mutex_unlock(&startup_);
+
+				if(stop_) {
+					for(size_type i = 1; i < started; i++) {
+						pthread_join(threads_[i], 0);
+					}
+					pthread_barrier_destroy(&start_);
+					pthread_barrier_destroy(&done_);
+					pthread_mutex_destroy(&startup_);
+					workers_ = 0;
+					stop_ = false;
+					return ERR_UNSPEC;
+				}
+				return SUCCESS;
+			}
+
+			int destruct() {
+				if(workers_ > 1) {
+					stop_ = true;
+					pthread_barrier_wait(&start_);
+					for(size_type i = 1; i < workers_; i++) {
+						pthread_join(threads_[i], 0);
+					}
+					pthread_barrier_destroy(&start_);
+					pthread_barrier_destroy(&done_);
+					pthread_mutex_destroy(&startup_);
+				}
+				workers_ = 0;
+				return SUCCESS;
+			}
+
+			size_type size() const { return workers_; }
+
+			/**
+			 * Call job(i, size()) on every worker i and wait for all of
+			 * them to finish.
+			 */
+			void run(job_delegate_t job) {
+				if(workers_ <= 1) {
+					job(0, 1);
+					return;
+				}
+				job_ = job;
+				pthread_barrier_wait(&start_);
+				job_(0, workers_);
+				pthread_barrier_wait(&done_);
+			}
+
+			template<typename T, void (T::*TMethod)(size_type, size_type)>
+			void run(T *obj_pnt) {
+				run(job_delegate_t::template from_method<T, TMethod>(obj_pnt));
+			}
+
+			/**
+			 * Static partitioning of [0, n) into @a workers contiguous
+			 * ranges of (almost) equal size, [begin, end) is the one
+			 * belonging to @a worker.
+			 */
+			static void split(size_type n, size_type worker, size_type workers,
+					size_type& begin, size_type& end) {
+				size_type chunk = n / workers;
+				size_type rest = n % workers;
+				begin = worker * chunk + (worker < rest ? worker : rest);
+				end = begin + chunk + (worker < rest ? 1 : 0);
+			}
+
+		private:
+			struct ThreadArg {
+				self_pointer_t pool;
+				size_type index;
+			};
+
+			static void* thread_main(void* p) {
+				ThreadArg *arg = reinterpret_cast<ThreadArg*>(p);
+				self_pointer_t pool = arg->pool;
+
+				pthread_mutex_lock(&pool->startup_);
+				bool stop = pool->stop_;
+				pthread_mutex_unlock(&pool->startup_);
+				if(stop) { return 0; }
+
+				while(true) {
+					pthread_barrier_wait(&pool->start_);
+					if(pool->stop_) { break; }
+					pool->job_(arg->index, pool->workers_);
+					pthread_barrier_wait(&pool->done_);
+				}
+				return 0;
+			}
+
+			size_type workers_;
+			volatile bool stop_;
+			job_delegate_t job_;
+			pthread_mutex_t startup_;
+			pthread_barrier_t start_;
+			pthread_barrier_t done_;
+			pthread_t threads_[MAX_WORKERS];
+			ThreadArg args_[MAX_WORKERS];
+
+			PCThreadPool(const self_type&);
+			self_type& operator=(const self_type&);
+	}; // class PCThreadPool
+
+} // namespace wiselib
+
+#endif // PC_THREAD_POOL_H
+
@@ -36,7 +36,7 @@
 
 #include "external_interface/pc/pc_os_model.h"
 #include "util/delegates/delegate.hpp"
-#include "util/pstl/list_static.h"
+#include "util/pstl/list_chunked.h"
 
 namespace wiselib {
 	
@@ -77,7 +77,7 @@ namespace wiselib {
 				micros_t offset_;
 				void *userdata_;
 			};
-			typedef list_static<OsModel, typename self_t::Timer, MAX_TIMERS> timers_list_t;
+			typedef list_chunked<OsModel, typename self_t::Timer, MAX_TIMERS> timers_list_t;
 			
 			timers_list_t data_;
 			bool locked_;
@@ -127,19 +127,17 @@ class BitmapAllocator {
 		
 	private:
 		
+		/*
+		 * used() marks the blocks of all allocated chunks, start() the
+		 * first block of each chunk. A chunk ends at the next free block
+		 * or at the start of the next chunk.
+		 * Both bitmaps are scanned a word at a time.
+		 */
+		
 		block_data_t* first_fit(size_type required_blocks) {
-			size_type start_pos = 0, length = 0;
-			for(size_type i=0; i<BITMAP_BLOCKS; i++) {
-				if(used().get(i)) {
-					length = 0;
-					start_pos = i+1;
-				}
-				else {
-					length++;
-					if(length >= required_blocks) {
-						return allocate_chunk(start_pos, required_blocks);
-					}
-				}
+			size_type pos = used().find_run(required_blocks, 0, BITMAP_BLOCKS);
+			if(pos != bitarray_t::npos) {
+				return allocate_chunk(pos, required_blocks);
 			}
 			
 			#ifdef CONTIKI
@@ -155,37 +153,28 @@ class BitmapAllocator {
 			#endif
 			
 			size_type best_start_pos = 0, best_length = -1;
-			size_type start_pos = 0, length = 0;
-			for(size_type i=0; i<BITMAP_BLOCKS; i++) {
-				if(used().get(i)) {
-					//printf("u%d", (int)i);
-					if(length >= required_blocks && length < best_length) {
-						best_length = length;
-						best_start_pos = start_pos;
-						if(best_length == required_blocks) {
-							break;
-						}
-					}
-					length = 0;
-					start_pos = i+1;
+			for(size_type pos = 0; pos < BITMAP_BLOCKS; ) {
+				// next free run [start_pos, pos)
+				size_type start_pos = used().find_first_clear(pos, BITMAP_BLOCKS);
+				if(start_pos == bitarray_t::npos) {
+					break;
 				}
-				else {
-					length++;
-					/*
-					if(length >= required_blocks) {
-						return allocate_chunk(start_pos, required_blocks);
+				pos = used().find_first_set(start_pos, BITMAP_BLOCKS);
+				if(pos == bitarray_t::npos) {
+					pos = BITMAP_BLOCKS;
+				}
+				
+				size_type length = pos - start_pos;
+				if(length >= required_blocks && length < best_length) {
+					best_length = length;
+					best_start_pos = start_pos;
+					if(best_length == required_blocks) {
+						break;
 					}
-					*/
 				}
 			}
 			
-			
-			if(length >= required_blocks && length < best_length) {
-				best_length = length;
-				best_start_pos = start_pos;
-			}
-			
-			if(best_length == -1) {
+			if(best_length == (size_type)-1) {
 				#ifdef CONTIKI
 				printf("!allocb %dx%d", (int)required_blocks, (int)BLOCK_SIZE);
 				#endif
@@ -196,26 +185,25 @@ class BitmapAllocator {
 		}
 		
 		block_data_t* allocate_chunk(size_type pos, size_type required_blocks) {
-			for(size_type i=pos; i<pos + required_blocks; i++) {
-				start().set(i, false);
-				used().set(i, true);
-			}
+			used().set_range(pos, pos + required_blocks, true);
 			start().set(pos, true);
-			start().set(pos + required_blocks, true);
 			return buffer_ + BLOCK_SIZE * pos;
 		}
 		
 		void free_chunk(block_data_t* ptr) {
 			size_type pos = (ptr - buffer_) / BLOCK_SIZE;
 			
-			start().set(pos, false);
-			do {
-				used().set(pos, false);
-			} while(!start()[pos++]);
-			
-			if(!used()[pos]) {
-				start().set(pos, false);
+			size_type end = used().find_first_clear(pos + 1, BITMAP_BLOCKS);
+			size_type next = start().find_first_set(pos + 1, end == bitarray_t::npos ? BITMAP_BLOCKS : end);
+			if(next != bitarray_t::npos) {
+				end = next;
+			}
+			else if(end == bitarray_t::npos) {
+				end = BITMAP_BLOCKS;
 			}
+			
+			start().set(pos, false);
+			used().set_range(pos, end, false);
 		}
 		
 		bitarray_t& start() { return *((bitarray_t*)start_); }
@@ -229,7 +217,10 @@ class BitmapAllocator {
 } // namespace wiselib
 
 
-void* operator new(size_t size, void* ptr, bool _) { return ptr; }
+#ifndef WISELIB_ALLOCATOR_PLACEMENT_NEW
+#define WISELIB_ALLOCATOR_PLACEMENT_NEW
+inline void* operator new(size_t size, void* ptr, bool _) { return ptr; }
+#endif
 
 #endif // __WISELIB_UTIL_ALLOCATORS_BITMAP_ALLOCATOR_H
 
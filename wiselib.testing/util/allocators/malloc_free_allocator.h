@@ -226,9 +226,10 @@ class MallocFreeAllocator {
 
 } // namespace wiselib
 
-void* operator new(size_t size, void* ptr, bool _) {
-	return ptr;
-}
+#ifndef WISELIB_ALLOCATOR_PLACEMENT_NEW
+#define WISELIB_ALLOCATOR_PLACEMENT_NEW
+inline void* operator new(size_t size, void* ptr, bool _) { return ptr; }
+#endif
 
 #endif // MALLOC_FREE_ALLOCATOR_H
 
@@ -0,0 +1,658 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef __WISELIB_UTIL_ALLOCATORS_TLSF_ALLOCATOR_H
+#define __WISELIB_UTIL_ALLOCATORS_TLSF_ALLOCATOR_H
+
+#include <util/meta.h>
+
+#if ALLOCATOR_USE_RTTI
+	#include <typeinfo>
+	#include <map>
+	#include <string>
+#endif
+
+#ifndef WISELIB_ALLOCATOR_PLACEMENT_NEW
+#define WISELIB_ALLOCATOR_PLACEMENT_NEW
+inline void* operator new(size_t size, void* ptr, bool _) { return ptr; }
+#endif
+
+namespace wiselib {
+
+/**
+ * Two-level segregated fit allocator (TLSF) on a static buffer.
+ * 
+ * Free blocks are kept in segregated lists, the first level splits sizes
+ * into powers of two, the second level splits every power of two into
+ * 2^SL_BITS_P equally sized ranges. Two bitmaps tell which lists are
+ * non-empty, so finding a fitting block, splitting it, and merging a
+ * freed block with its physical neighbours take constant time,
+ * independent of the number of live allocations. Requests are rounded up
+ * to the next list boundary (good fit), which bounds the internal
+ * fragmentation to 1/2^SL_BITS_P of the request.
+ * 
+ * Every block carries one word of header, free blocks additionally link
+ * themselves into their list through their payload.
+ * 
+ * Allocation fails (returns a null pointer) when no large enough block
+ * is left; nothing is constructed in this case.
+ * free_array() destructs elements only when passed the array_pointer_t
+ * returned by allocate_array().
+ * 
+ * With ALLOCATOR_KEEP_STATS the number of allocations, frees, failures
+ * and the peak usage are counted, with ALLOCATOR_USE_RTTI additionally
+ * live objects and bytes per allocated type (PC only).
+ * 
+ * @ingroup Allocator_concept
+ * 
+ * @tparam BUFFER_SIZE_P Size of the managed memory in bytes.
+ * @tparam SL_BITS_P log2 of the number of second level lists per power of
+ *   two (at most 5). Smaller values need less memory for the list heads
+ *   and waste more per allocation.
+ */
+template<
+	typename OsModel_P,
+	size_t BUFFER_SIZE_P,
+	size_t SL_BITS_P = 4
+>
+class TlsfAllocator {
+	public:
+		typedef OsModel_P OsModel;
+		typedef TlsfAllocator<OsModel_P, BUFFER_SIZE_P, SL_BITS_P> self_type;
+		typedef self_type* self_pointer_t;
+		typedef typename OsModel::size_t size_t;
+		typedef typename OsModel::block_data_t block_data_t;
+		typedef size_t size_type;
+		
+		/// Word large enough for a pointer, size and flags of a block.
+		typedef typename Uint<sizeof(void*)>::t word_t;
+		
+		enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+		
+		enum {
+			BUFFER_SIZE = BUFFER_SIZE_P,
+			
+			/// Block sizes are multiples of ALIGN, freeing two flag bits.
+			ALIGN = Max<sizeof(word_t), 4>::value,
+			ALIGN_LOG2 = Log<ALIGN, 2>::value,
+			
+			SL_INDEX_COUNT_LOG2 = SL_BITS_P,
+			SL_INDEX_COUNT = 1 << SL_INDEX_COUNT_LOG2,
+			
+			/// Blocks below SMALL_BLOCK_SIZE all go into first level 0,
+			/// split linearly into the second level lists.
+			FL_INDEX_SHIFT = SL_INDEX_COUNT_LOG2 + ALIGN_LOG2,
+			SMALL_BLOCK_SIZE = 1 << FL_INDEX_SHIFT,
+			
+			/// All blocks are smaller than 2^FL_INDEX_MAX.
+			FL_INDEX_MAX = Log<BUFFER_SIZE + 1, 2>::value,
+			FL_INDEX_COUNT = Max<FL_INDEX_MAX, FL_INDEX_SHIFT>::value - FL_INDEX_SHIFT + 1
+		};
+		
+		template<typename T>
+		struct pointer_t {
+			public:
+				pointer_t() : p_(0) { }
+				pointer_t(T* p) : p_(p) { }
+				pointer_t(const pointer_t& other) : p_(other.p_) { }
+				pointer_t& operator=(const pointer_t& other) { p_ = other.p_; return *this; }
+				T& operator*() const { return *p_; }
+				T* operator->() const { return p_; }
+				T& operator[](size_t idx) { return p_[idx]; }
+				const T& operator[](size_t idx) const { return p_[idx]; }
+				bool operator==(const pointer_t& other) const { return p_ == other.p_; }
+				bool operator!=(const pointer_t& other) const { return p_ != other.p_; }
+				operator bool() const { return p_ != 0; }
+				pointer_t& operator++() { ++p_; return *this; }
+				pointer_t& operator--() { --p_; return *this; }
+				pointer_t operator+(size_t i) const { return pointer_t(p_ + i); }
+				
+				T* raw() { return p_; }
+				const T* raw() const { return p_; }
+			protected:
+				T* p_;
+				
+			friend class TlsfAllocator<OsModel_P, BUFFER_SIZE_P, SL_BITS_P>;
+		};
+		
+		template<typename T>
+		struct array_pointer_t : public pointer_t<T> {
+			public:
+				array_pointer_t() : pointer_t<T>(0), elements_(0) { }
+				array_pointer_t(T* p) : pointer_t<T>(p), elements_(1) { }
+				array_pointer_t(T* p, size_t e) : pointer_t<T>(p), elements_(e) { }
+				array_pointer_t(const array_pointer_t& other) : pointer_t<T>(other.p_), elements_(other.elements_) { }
+				array_pointer_t& operator=(const array_pointer_t& other) {
+					this->p_ = other.p_;
+					elements_ = other.elements_;
+					return *this;
+				}
+				array_pointer_t& operator++() { ++this->p_; --elements_; return *this; }
+				array_pointer_t& operator--() { --this->p_; ++elements_; return *this; }
+				array_pointer_t operator+(size_t n) const { return array_pointer_t(this->p_ + n, elements_ - n); }
+				array_pointer_t operator-(size_t n) const { return array_pointer_t(this->p_ - n, elements_ + n); }
+				
+				size_t elements() const { return elements_; }
+				
+			private:
+				size_t elements_;
+				
+			friend class TlsfAllocator<OsModel_P, BUFFER_SIZE_P, SL_BITS_P>;
+		};
+		
+		TlsfAllocator() {
+			init();
+		}
+		
+		/**
+		 * Forget all allocations and make the whole buffer one free
+		 * block.
+		 */
+		void init() {
+			null_.next_free = &null_;
+			null_.prev_free = &null_;
+			fl_bitmap_ = 0;
+			for(size_type i = 0; i < FL_INDEX_COUNT; i++) {
+				sl_bitmap_[i] = 0;
+				for(size_type j = 0; j < SL_INDEX_COUNT; j++) {
+					blocks_[i][j] = &null_;
+				}
+			}
+			used_ = 0;
+			#if ALLOCATOR_KEEP_STATS
+				allocations_ = 0;
+				frees_ = 0;
+				failures_ = 0;
+				peak_ = 0;
+			#endif
+			#if ALLOCATOR_USE_RTTI
+				types_.clear();
+			#endif
+			
+			// The first block header starts at the beginning of the
+			// buffer (its prev_phys field is never used), the size field
+			// of the zero sized sentinel block marks the end.
+			word_t payload = (sizeof(memory_) - 2 * BLOCK_HEADER_OVERHEAD - sizeof(Block*)) & ~(word_t)(ALIGN - 1);
+			Block *b = reinterpret_cast<Block*>(memory_);
+			b->size = 0;
+			b->set_size(payload);
+			b->set_free();
+			b->set_prev_used();
+			insert_free_block(b);
+			
+			Block *sentinel = b->next();
+			sentinel->size = 0;
+			sentinel->set_used();
+			sentinel->set_prev_free();
+			sentinel->prev_phys = b;
+		}
+		
+		template<typename T>
+		pointer_t<T> allocate() {
+			void *p = allocate_raw(sizeof(T));
+			if(!p) { return pointer_t<T>(); }
+			#if ALLOCATOR_USE_RTTI
+				count_type(typeid(T).name(), p, 1);
+			#endif
+			new(p, true) T;
+			return pointer_t<T>(reinterpret_cast<T*>(p));
+		}
+		
+		template<typename T>
+		array_pointer_t<T> allocate_array(size_type n) {
+			if(n > (size_type)MAX_BLOCK_SIZE / sizeof(T)) {
+				#if ALLOCATOR_KEEP_STATS
+					failures_++;
+				#endif
+				return array_pointer_t<T>();
+			}
+			void *p = allocate_raw(n * sizeof(T));
+			if(!p) { return array_pointer_t<T>(); }
+			#if ALLOCATOR_USE_RTTI
+				count_type(typeid(T).name(), p, 1);
+			#endif
+			T *r = reinterpret_cast<T*>(p);
+			for(size_type i = 0; i < n; i++) {
+				new(r + i, true) T;
+			}
+			return array_pointer_t<T>(r, n);
+		}
+		
+		template<typename T>
+		int free(pointer_t<T> p) {
+			return free(p.raw());
+		}
+		
+		template<typename T>
+		int free(T* p) {
+			if(!p) { return SUCCESS; }
+			p->~T();
+			#if ALLOCATOR_USE_RTTI
+				count_type(typeid(T).name(), p, -1);
+			#endif
+			free_raw(p);
+			return SUCCESS;
+		}
+		
+		template<typename T>
+		int free_array(array_pointer_t<T> p) {
+			if(!p) { return SUCCESS; }
+			for(size_type i = 0; i < p.elements_; i++) {
+				p.raw()[i].~T();
+			}
+			#if ALLOCATOR_USE_RTTI
+				count_type(typeid(T).name(), p.raw(), -1);
+			#endif
+			free_raw(p.raw());
+			return SUCCESS;
+		}
+		
+		/**
+		 * Free an array without calling the destructors of its elements
+		 * (their number is not known here).
+		 */
+		template<typename T>
+		int free_array(T* p) {
+			if(!p) { return SUCCESS; }
+			#if ALLOCATOR_USE_RTTI
+				count_type(typeid(T).name(), p, -1);
+			#endif
+			free_raw(p);
+			return SUCCESS;
+		}
+		
+		/**
+		 * Allocate at least n uninitialized bytes.
+		 * @return 0 if there is no large enough free block.
+		 */
+		void* allocate_raw(size_type n) {
+			word_t size = adjust_size(n);
+			Block *b = size ? locate_free(size) : 0;
+			if(!b) {
+				#if ALLOCATOR_KEEP_STATS
+					failures_++;
+				#endif
+				return 0;
+			}
+			trim_free(b, size);
+			b->mark_used();
+			used_ += b->get_size();
+			#if ALLOCATOR_KEEP_STATS
+				allocations_++;
+				if(used_ > peak_) { peak_ = used_; }
+			#endif
+			return b->payload();
+		}
+		
+		void free_raw(void *p) {
+			if(!p) { return; }
+			Block *b = Block::from_payload(p);
+			used_ -= b->get_size();
+			#if ALLOCATOR_KEEP_STATS
+				frees_++;
+			#endif
+			b->mark_free();
+			b = merge_prev(b);
+			b = merge_next(b);
+			insert_free_block(b);
+		}
+		
+		/**
+		 * Usable size of an allocated block (at least the requested
+		 * size).
+		 */
+		size_type block_size(const void *p) {
+			return Block::from_payload(const_cast<void*>(p))->get_size();
+		}
+		
+		/// Bytes in allocated blocks, without headers.
+		size_type size() { return used_; }
+		size_type capacity() { return BUFFER_SIZE; }
+		
+		/**
+		 * Size of the largest free block, ie. the largest request that
+		 * could currently succeed (up to rounding).
+		 * Walks one free list.
+		 */
+		size_type largest_free_block() {
+			if(!fl_bitmap_) { return 0; }
+			int fl = fls(fl_bitmap_);
+			int sl = fls(sl_bitmap_[fl]);
+			word_t r = 0;
+			for(Block *b = blocks_[fl][sl]; b != &null_; b = b->next_free) {
+				if(b->get_size() > r) { r = b->get_size(); }
+			}
+			return r;
+		}
+		
+		/**
+		 * Walk all blocks and free lists and verify the block headers,
+		 * list links and bitmaps. Linear, for debugging.
+		 * @return number of inconsistencies found.
+		 */
+		size_type check() {
+			size_type errors = 0;
+			size_type free_blocks = 0;
+			word_t used = 0;
+			bool prev_free = false;
+			Block *prev = 0;
+			for(Block *b = reinterpret_cast<Block*>(memory_); b->get_size(); b = b->next()) {
+				if(b->is_prev_free() != prev_free) { errors++; }
+				if(prev_free && b->prev_phys != prev) { errors++; }
+				if(b->is_free()) {
+					if(prev_free) { errors++; } // should have been merged
+					free_blocks++;
+				}
+				else { used += b->get_size(); }
+				prev_free = b->is_free();
+				prev = b;
+			}
+			if(used != used_) { errors++; }
+			
+			for(size_type i = 0; i < FL_INDEX_COUNT; i++) {
+				if(!(fl_bitmap_ & (1UL << i)) != !sl_bitmap_[i]) { errors++; }
+				for(size_type j = 0; j < SL_INDEX_COUNT; j++) {
+					bool empty = (blocks_[i][j] == &null_);
+					if(empty != !(sl_bitmap_[i] & (1UL << j))) { errors++; }
+					for(Block *b = blocks_[i][j]; b != &null_; b = b->next_free) {
+						int fl, sl;
+						mapping_insert(b->get_size(), fl, sl);
+						if(!b->is_free() || fl != (int)i || sl != (int)j) { errors++; }
+						free_blocks--;
+					}
+				}
+			}
+			if(free_blocks) { errors++; }
+			return errors;
+		}
+		
+	#if ALLOCATOR_KEEP_STATS
+		unsigned long allocations() { return allocations_; }
+		unsigned long frees() { return frees_; }
+		unsigned long failures() { return failures_; }
+		size_type peak() { return peak_; }
+	#endif
+		
+		template<typename Debug_P>
+		void print_stats(Debug_P* d) {
+			d->debug("tlsf allocator: %lu of %lu bytes used, largest free block %lu",
+					(unsigned long)used_, (unsigned long)BUFFER_SIZE, (unsigned long)largest_free_block());
+			#if ALLOCATOR_KEEP_STATS
+				d->debug("allocations %lu frees %lu failures %lu peak %lu",
+						allocations_, frees_, failures_, (unsigned long)peak_);
+			#endif
+			#if ALLOCATOR_USE_RTTI
+				for(typename TypeStatsMap::iterator it = types_.begin(); it != types_.end(); ++it) {
+					if(it->second.count) {
+						d->debug("%8ld x %10ld bytes: %s", it->second.count, it->second.bytes, it->first.c_str());
+					}
+				}
+			#endif
+		}
+		
+	private:
+		/**
+		 * Physical block layout. The size field (with the flags in its
+		 * lowest bits) precedes the payload; prev_phys is only valid if
+		 * the previous block is free and then overlaps the last word of
+		 * its payload. next_free and prev_free only exist in free
+		 * blocks.
+		 */
+		struct Block {
+			Block *prev_phys;
+			word_t size;
+			Block *next_free;
+			Block *prev_free;
+			
+			enum { FREE = 1, PREV_FREE = 2 };
+			
+			word_t get_size() const { return size & ~(word_t)(FREE | PREV_FREE); }
+			void set_size(word_t s) { size = s | (size & (FREE | PREV_FREE)); }
+			bool is_free() const { return size & FREE; }
+			void set_free() { size |= FREE; }
+			void set_used() { size &= ~(word_t)FREE; }
+			bool is_prev_free() const { return size & PREV_FREE; }
+			void set_prev_free() { size |= PREV_FREE; }
+			void set_prev_used() { size &= ~(word_t)PREV_FREE; }
+			
+			void* payload() {
+				return reinterpret_cast<block_data_t*>(this) + BLOCK_START_OFFSET;
+			}
+			static Block* from_payload(void *p) {
+				return reinterpret_cast<Block*>(reinterpret_cast<block_data_t*>(p) - BLOCK_START_OFFSET);
+			}
+			Block* next() {
+				return reinterpret_cast<Block*>(reinterpret_cast<block_data_t*>(payload()) + get_size() - BLOCK_HEADER_OVERHEAD);
+			}
+			/// Set the back link and flag of the following block.
+			Block* link_next() {
+				Block *n = next();
+				n->prev_phys = this;
+				return n;
+			}
+			void mark_free() {
+				Block *n = link_next();
+				n->set_prev_free();
+				set_free();
+			}
+			void mark_used() {
+				next()->set_prev_used();
+				set_used();
+			}
+		};
+		
+		enum {
+			BLOCK_HEADER_OVERHEAD = sizeof(word_t),
+			BLOCK_START_OFFSET = sizeof(Block*) + sizeof(word_t),
+			/// Payload must hold the free list links and the next
+			/// block's prev_phys.
+			MIN_BLOCK_SIZE = sizeof(Block) - sizeof(Block*),
+			MAX_BLOCK_SIZE = (1UL << FL_INDEX_MAX) - ALIGN
+		};
+		
+		word_t adjust_size(size_type n) {
+			if(n > (size_type)MAX_BLOCK_SIZE) { return 0; }
+			word_t s = ((word_t)n + ALIGN - 1) & ~(word_t)(ALIGN - 1);
+			return s < (word_t)MIN_BLOCK_SIZE ? (word_t)MIN_BLOCK_SIZE : s;
+		}
+		
+		static int ffs(::uint32_t w) {
+			#ifdef __GNUC__
+				return __builtin_ctz(w);
+			#else
+				int r = 0;
+				while(!(w & 1)) { w >>= 1; r++; }
+				return r;
+			#endif
+		}
+		
+		static int fls(word_t w) {
+			#ifdef __GNUC__
+				if(sizeof(word_t) > sizeof(unsigned int)) {
+					return 8 * sizeof(unsigned long long) - 1 - __builtin_clzll(w);
+				}
+				return 8 * sizeof(unsigned int) - 1 - __builtin_clz((unsigned int)w);
+			#else
+				int r = -1;
+				while(w) { w >>= 1; r++; }
+				return r;
+			#endif
+		}
+		
+		/**
+		 * List indices for a block of the given size.
+		 */
+		static void mapping_insert(word_t size, int& fl, int& sl) {
+			if(size < (word_t)SMALL_BLOCK_SIZE) {
+				fl = 0;
+				sl = size / (SMALL_BLOCK_SIZE / SL_INDEX_COUNT);
+			}
+			else {
+				fl = fls(size);
+				sl = (int)(size >> (fl - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+				fl -= FL_INDEX_SHIFT - 1;
+			}
+		}
+		
+		/**
+		 * List indices of the first list whose blocks are all large
+		 * enough for size (round up to the next list boundary).
+		 */
+		static void mapping_search(word_t size, int& fl, int& sl) {
+			if(size >= (word_t)SMALL_BLOCK_SIZE) {
+				size += ((word_t)1 << (fls(size) - SL_INDEX_COUNT_LOG2)) - 1;
+			}
+			mapping_insert(size, fl, sl);
+		}
+		
+		Block* locate_free(word_t size) {
+			int fl, sl;
+			mapping_search(size, fl, sl);
+			if(fl >= FL_INDEX_COUNT) { return 0; }
+			
+			::uint32_t sl_map = sl_bitmap_[fl] & (~(::uint32_t)0 << sl);
+			if(!sl_map) {
+				::uint32_t fl_map = (fl + 1 < 32) ? (fl_bitmap_ & (~(::uint32_t)0 << (fl + 1))) : 0;
+				if(!fl_map) { return 0; }
+				fl = ffs(fl_map);
+				sl_map = sl_bitmap_[fl];
+			}
+			sl = ffs(sl_map);
+			Block *b = blocks_[fl][sl];
+			remove_free_block(b, fl, sl);
+			return b;
+		}
+		
+		void insert_free_block(Block *b) {
+			int fl, sl;
+			mapping_insert(b->get_size(), fl, sl);
+			Block *current = blocks_[fl][sl];
+			b->next_free = current;
+			b->prev_free = &null_;
+			current->prev_free = b;
+			blocks_[fl][sl] = b;
+			fl_bitmap_ |= (::uint32_t)1 << fl;
+			sl_bitmap_[fl] |= (::uint32_t)1 << sl;
+		}
+		
+		void remove_free_block(Block *b, int fl, int sl) {
+			Block *prev = b->prev_free;
+			Block *next = b->next_free;
+			next->prev_free = prev;
+			prev->next_free = next;
+			if(blocks_[fl][sl] == b) {
+				blocks_[fl][sl] = next;
+				if(next == &null_) {
+					sl_bitmap_[fl] &= ~((::uint32_t)1 << sl);
+					if(!sl_bitmap_[fl]) {
+						fl_bitmap_ &= ~((::uint32_t)1 << fl);
+					}
+				}
+			}
+		}
+		
+		void remove_free_block(Block *b) {
+			int fl, sl;
+			mapping_insert(b->get_size(), fl, sl);
+			remove_free_block(b, fl, sl);
+		}
+		
+		/**
+		 * Split the (free, unlisted) block b to size, put the rest back
+		 * into the free lists.
+		 */
+		void trim_free(Block *b, word_t size) {
+			if(b->get_size() < size + sizeof(Block)) { return; }
+			
+			Block *rest = reinterpret_cast<Block*>(reinterpret_cast<block_data_t*>(b->payload()) + size - BLOCK_HEADER_OVERHEAD);
+			rest->size = 0;
+			rest->set_size(b->get_size() - size - BLOCK_HEADER_OVERHEAD);
+			b->set_size(size);
+			rest->mark_free();
+			b->link_next();
+			rest->set_prev_free();
+			insert_free_block(rest);
+		}
+		
+		/// Absorb b into its physical predecessor prev.
+		Block* absorb(Block *prev, Block *b) {
+			prev->set_size(prev->get_size() + b->get_size() + BLOCK_HEADER_OVERHEAD);
+			prev->link_next();
+			return prev;
+		}
+		
+		Block* merge_prev(Block *b) {
+			if(b->is_prev_free()) {
+				Block *prev = b->prev_phys;
+				remove_free_block(prev);
+				b = absorb(prev, b);
+			}
+			return b;
+		}
+		
+		Block* merge_next(Block *b) {
+			Block *next = b->next();
+			if(next->is_free()) {
+				remove_free_block(next);
+				b = absorb(b, next);
+			}
+			return b;
+		}
+		
+	#if ALLOCATOR_USE_RTTI
+		struct TypeStats {
+			TypeStats() : count(0), bytes(0) { }
+			long count;
+			long bytes;
+		};
+		typedef std::map<std::string, TypeStats> TypeStatsMap;
+		
+		void count_type(const char *name, void *p, int sign) {
+			TypeStats &s = types_[name];
+			s.count += sign;
+			s.bytes += sign * (long)block_size(p);
+		}
+		
+	public:
+		/// Live objects and bytes per type name.
+		TypeStatsMap& type_stats() { return types_; }
+		
+	private:
+		TypeStatsMap types_;
+	#endif
+		
+		word_t memory_[BUFFER_SIZE / sizeof(word_t)];
+		
+		Block null_;
+		::uint32_t fl_bitmap_;
+		::uint32_t sl_bitmap_[FL_INDEX_COUNT];
+		Block *blocks_[FL_INDEX_COUNT][SL_INDEX_COUNT];
+		
+		word_t used_;
+	#if ALLOCATOR_KEEP_STATS
+		unsigned long allocations_, frees_, failures_;
+		word_t peak_;
+	#endif
+};
+
+} // namespace wiselib
+
+#endif // __WISELIB_UTIL_ALLOCATORS_TLSF_ALLOCATOR_H
+
@@ -12,94 +12,206 @@
 
 #include "util/protobuf/varint.h"
 #include "util/protobuf/string.h"
+#include "util/protobuf/sized_writer.h"
 //#include "util/protobuf/buffer_dynamic.h"
 
 namespace wiselib
 {
 
-    template<typename OsModel_P>
+    /**
+     * Serializes RDF statements into a protobuf description message:
+     * field 1 is the node name, field 4 the description which contains one
+     * embedded message (field 1) per statement with subject, predicate and
+     * object in the string fields 1, 2 and 3.
+     * 
+     * Sizes of all embedded messages are computed in a first pass
+     * (see protobuf::SizedWriter) so the statements are written directly
+     * into the packet without temporary buffers.
+     * 
+     * \tparam MAX_STATEMENTS_P Maximum number of statements per packet.
+     * \tparam MAX_STRING_LENGTH_P Maximum length of a decoded string
+     * (including the terminating 0), longer ones are truncated.
+     */
+    template<
+		typename OsModel_P,
+		int MAX_STATEMENTS_P = 32,
+		int MAX_STRING_LENGTH_P = 256
+	>
     class ProtobufRdfSerializer
     {
         typedef OsModel_P OsModel;
 		typedef typename OsModel::block_data_t block_data_t;
-        typedef unsigned int int_t;        
+        typedef unsigned int int_t;
 		typedef block_data_t* buffer_t;
 		typedef typename OsModel::size_t size_t;
 		typedef typename OsModel::size_t size_type;
 
         typedef wiselib::protobuf::Message<OsModel, buffer_t, int_t> dynamic_message_t;
         typedef wiselib::protobuf::Message<OsModel, typename OsModel::Radio::block_data_t*, int_t> static_message_t;
+		typedef wiselib::protobuf::VarInt<OsModel, buffer_t, int_t> varint_t;
+		typedef wiselib::protobuf::SizedWriter<OsModel, int_t, MAX_STATEMENTS_P + 1, 2> writer_t;
 
     public:
+		enum {
+			FIELD_NODE = 1, FIELD_DESCRIPTION = 4, FIELD_STATEMENT = 1,
+			FIELD_SUBJECT = 1, FIELD_PREDICATE = 2, FIELD_OBJECT = 3
+		};
+		enum { MAX_STATEMENTS = MAX_STATEMENTS_P, MAX_STRING_LENGTH = MAX_STRING_LENGTH_P };
+		
+		ProtobufRdfSerializer() : read_position_(0), read_end_(0), description_position_(0), description_end_(0) {
+		}
 		
 		void reset() {
+			read_position_ = read_end_ = 0;
+			description_position_ = description_end_ = 0;
 		}
 
+		/**
+		 * Write as many statements from [current, end) into buffer as fit
+		 * (at most MAX_STATEMENTS).
+		 * On return current points to the first statement not written.
+		 * 
+		 * @return number of bytes written, 0 if not even the frame fits.
+		 */
 		template<typename iterator>
         size_type fill_buffer(buffer_t buffer, size_t max_packet_size, iterator& current, const iterator& end)
         {
-			iterator it = current;
-			block_data_t *buf = buffer, *buf_end = buffer + max_packet_size;
+			writer_.measure();
+			writer_.add_string(FIELD_NODE, "sensornode1");
+			writer_.begin_message(FIELD_DESCRIPTION);
+			if(writer_.closed_size() > max_packet_size) { return 0; }
 			
-			const size_t description_size = 1000;
-			block_data_t description[description_size];
-			block_data_t *descr = description, *descr_end = description + description_size;
-			
-            for ( ; it != end; ++it)
-			{
-				const size_t stmt_size = 200;
-                block_data_t statement[stmt_size];
-				block_data_t *stmt = statement, *stmt_end = stmt + stmt_size;
-                if(!static_message_t::write(stmt, stmt_end, 1, (char*)(*it).get(0))) { return 0; }
-                if(!static_message_t::write(stmt, stmt_end, 2, (char*)(*it).get(1))) { return 0; }
-				if(!static_message_t::write(stmt, stmt_end, 3, (char*)(*it).get(2))) { return 0; }
-                if(!static_message_t::write(descr, descr_end, 1, statement, stmt - statement)) { return 0; }
-            }
+			iterator it = current;
+			for( ; it != end; ++it) {
+				typename writer_t::Mark m = writer_.mark();
+				add_statement(*it);
+				if(!writer_.ok() || writer_.closed_size() > max_packet_size) {
+					writer_.rollback(m);
+					break;
+				}
+			}
+			writer_.end_message();
 			
-			if(!static_message_t::write(buf, buf_end, 1, "sensornode1")) { return 0; }
-			if(!static_message_t::write(buf, buf_end, 4, description, descr - description)) { return 0; }
+			if(!writer_.write(buffer, max_packet_size)) { return 0; }
+			writer_.add_string(FIELD_NODE, "sensornode1");
+			writer_.begin_message(FIELD_DESCRIPTION);
+			for( ; current != it; ++current) {
+				add_statement(*current);
+			}
+			writer_.end_message();
 			
-			current = it;
-            return buf - buffer;
+            return writer_.size();
         }
-
 		
+		/**
+		 * Prepare reading statements from buffer with read_next().
+		 * buffer must stay valid until reading is finished.
+		 */
+		void start_reading(block_data_t* buffer, size_type buffer_size) {
+			read_position_ = buffer;
+			read_end_ = buffer + buffer_size;
+			description_position_ = description_end_ = 0;
+		}
+		
+		/**
+		 * Read the next statement into tuple (using set_deep()).
+		 * Unknown fields are skipped.
+		 * 
+		 * @return false if there are no more statements or the buffer is
+		 * malformed.
+		 */
 		template<typename Tuple>
-		size_type read_buffer(Tuple& tuple, block_data_t* buffer, size_type buffer_size) {
-			int_t field;
-			block_data_t *buf = buffer, *end = buffer + buffer_size;
+		bool read_next(Tuple& tuple) {
+			int_t field, wire_type, length;
+			buffer_t data;
 			
-			do {
-				block_data_t description[1000], *descr=description, *descr_end = description + 1000;
-				switch(static_message_t::field_number(buf, end)) {
-					case 4:
-						if(!static_message_t::read(buf, end, field, description)) { return 0; }
-						do {
-							block_data_t statement[200], *stmt=statement, *statement_end = statement + 200;
-							switch(static_message_t::field_number(buf, end)) {
-								case 1:
-									if(!static_message_t::read(buf, end, field, statement)) { return 0; }
-									//do {
-										char s[200];
-										for(size_type i=0; i<3;i++) {
-											int_t field2 = static_message_t::field_number(stmt, end);
-											if(!static_message_t::read(stmt, statement_end, field, s)) { return 0; }
-											tuple.set_deep(field2 - 1, (block_data_t*)s);
-										}
-										return buf - buffer;
-									//} while(buf < end);
-							} // switch
-						} while(buf < end);
-						break;
-				} // switch
-			} while(buf < end);
+			while(true) {
+				if(description_position_ < description_end_) {
+					if(!next_field(description_position_, description_end_, field, wire_type, data, length)) { return false; }
+					if(field == FIELD_STATEMENT && wire_type == WIRE_LENGTH_DELIMITED) {
+						return read_statement(tuple, data, data + length);
+					}
+					continue;
+				}
+				
+				if(read_position_ >= read_end_) { return false; }
+				if(!next_field(read_position_, read_end_, field, wire_type, data, length)) { return false; }
+				if(field == FIELD_DESCRIPTION && wire_type == WIRE_LENGTH_DELIMITED) {
+					description_position_ = data;
+					description_end_ = data + length;
+				}
+			}
+		}
+		
+		/**
+		 * Read the first statement from buffer into tuple.
+		 * 
+		 * @return number of bytes up to the end of the statement,
+		 * 0 if there is none.
+		 */
+		template<typename Tuple>
+		size_type read_buffer(Tuple& tuple, block_data_t* buffer, size_type buffer_size) {
+			start_reading(buffer, buffer_size);
+			if(!read_next(tuple)) { return 0; }
+			return description_position_ - buffer;
+		}
+		
+	private:
+		enum { WIRE_VARINT = 0, WIRE_LENGTH_DELIMITED = 2 };
+		
+		template<typename Tuple>
+		void add_statement(Tuple& t) {
+			writer_.begin_message(FIELD_STATEMENT);
+			writer_.add_string(FIELD_SUBJECT, (char*)t.get(0));
+			writer_.add_string(FIELD_PREDICATE, (char*)t.get(1));
+			writer_.add_string(FIELD_OBJECT, (char*)t.get(2));
+			writer_.end_message();
+		}
+		
+		/**
+		 * Read the field at position and advance position behind it.
+		 * For length delimited fields data and length describe the
+		 * contents, for varints length holds the value.
+		 */
+		bool next_field(buffer_t& position, buffer_t end, int_t& field, int_t& wire_type, buffer_t& data, int_t& length) {
+			int_t tag;
+			if(!varint_t::read(position, end, tag)) { return false; }
+			field = tag >> 3;
+			wire_type = tag & 0x07;
+			if(!varint_t::read(position, end, length)) { return false; }
+			if(wire_type == WIRE_LENGTH_DELIMITED) {
+				if(length > (size_type)(end - position)) { return false; }
+				data = position;
+				position += length;
+				return true;
+			}
+			return wire_type == WIRE_VARINT;
+		}
+		
+		template<typename Tuple>
+		bool read_statement(Tuple& tuple, buffer_t position, buffer_t end) {
+			int_t field, wire_type, length;
+			buffer_t data;
 			
-			return 0;
+			while(position < end) {
+				if(!next_field(position, end, field, wire_type, data, length)) { return false; }
+				if(wire_type != WIRE_LENGTH_DELIMITED || field < FIELD_SUBJECT || field > FIELD_OBJECT) { continue; }
+				
+				if(length >= MAX_STRING_LENGTH) { length = MAX_STRING_LENGTH - 1; }
+				memcpy(string_buffer_, data, length);
+				string_buffer_[length] = '\0';
+				tuple.set_deep(field - FIELD_SUBJECT, string_buffer_);
+			}
+			return true;
 		}
 		
+		writer_t writer_;
+		buffer_t read_position_, read_end_;
+		buffer_t description_position_, description_end_;
+		block_data_t string_buffer_[MAX_STRING_LENGTH];
+		
     }; // class ProtobufRdfSerializer
 }
 
 
 #endif	/* _PROTOBUF_RDF_SERIALIZER_H */
-
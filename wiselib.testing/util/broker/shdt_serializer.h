@@ -36,11 +36,25 @@ namespace wiselib {
 	 *    w.set_buffer_size(BUF_SIZE); // or leave out to keep buffer size
 	 *  }
 	 * ----
+	 * 
+	 * Table entries are kept packed in a single arena that is compacted
+	 * (and if necessary grown) on demand, so pointers returned by
+	 * get_table() (and thus by Reader) are only valid until the next
+	 * instruction that modifies the table.
+	 * 
+	 * With SHDT_REUSE_PREFIXES the writer looks for the table entry with
+	 * the longest common prefix of each string it writes. With
+	 * PREFIX_INDEX_P (default) this is answered by a compressed trie over
+	 * the live table entries in O(string length) instead of comparing
+	 * against every entry. The result (and thus the produced byte stream)
+	 * is the same either way, disabling the index just saves the RAM for
+	 * the trie nodes (about 20 byte per table entry).
 	 */
 	template<
 		typename OsModel_P,
 		size_t MAX_TABLE_SIZE_P,
-		size_t MAX_TUPLE_SIZE_P = 4
+		size_t MAX_TUPLE_SIZE_P = 4,
+		bool PREFIX_INDEX_P = true
 	>
 	class ShdtSerializer {
 		public:
@@ -49,6 +63,7 @@ namespace wiselib {
 			typedef OsModel_P OsModel;
 			enum { MAX_TABLE_SIZE = MAX_TABLE_SIZE_P };
 			enum { MAX_TUPLE_SIZE = MAX_TUPLE_SIZE_P };
+			enum { PREFIX_INDEX = PREFIX_INDEX_P };
 			
 			typedef typename OsModel::size_t size_type;
 			typedef typename OsModel::block_data_t block_data_t;
@@ -413,12 +428,18 @@ namespace wiselib {
 			
 			typedef delegate1<void, Writer&> write_callback_t;
 			
-			ShdtSerializer() {
-				memset((void*)lookup_table_, 0, sizeof(lookup_table_));
+			ShdtSerializer() : table_size_(0), tuple_size_(0),
+					arena_(0), arena_capacity_(0), arena_used_(0), arena_garbage_(0) {
+				memset((void*)entry_live_, 0, sizeof(entry_live_));
+				index_clear();
 			}
 			
 			~ShdtSerializer() {
 				reset();
+				if(arena_) {
+					get_allocator().free_array(arena_);
+					arena_ = 0;
+				}
 			}
 			
 			/**
@@ -432,16 +453,19 @@ namespace wiselib {
 			 * scratch.
 			 */
 			void reset() {
-				for(size_type i=0; i<MAX_TABLE_SIZE; i++) {
-					if(lookup_table_[i]) {
-						get_allocator().free(lookup_table_[i]);
-					}
-				}
-				memset((void*)lookup_table_, 0, sizeof(lookup_table_));
+				memset((void*)entry_live_, 0, sizeof(entry_live_));
+				arena_used_ = 0;
+				arena_garbage_ = 0;
+				index_clear();
 			}
 			
 			table_id_t table_size() { return table_size_; }
-			void set_table_size(table_id_t ts) { table_size_ = ts; }
+			void set_table_size(table_id_t ts) {
+				if(ts != table_size_) {
+					table_size_ = ts;
+					index_rebuild();
+				}
+			}
 			
 			table_id_t tuple_size() { return tuple_size_; }
 			void set_tuple_size(table_id_t ts) { tuple_size_ = ts; }
@@ -477,26 +501,14 @@ namespace wiselib {
 				table_id_t source_id = 0;
 				
 				#if SHDT_REUSE_PREFIXES
-					// find a string in table with the longest common prefix
-					
-					id = nidx;
-					
-					for(table_id_t cid = 0; cid < table_size_; cid++) {
-						size_type current_size = 0;
-						block_data_t *current = get_table(cid, current_size);
-						if(current) {
-							size_type pn = prefix_length_n(min(data_size, current_size), current, data);
-							if(pn > p) {
-								p = pn;
-								source_id = cid;
-								if(p == data_size) { break; }
-							}
-						}
-						else {
-							if(id == nidx) { id = cid; }
-						}
-					}
+					// find a string in table with the longest common prefix,
+					// the one with the lowest id if there are several.
+					// Target is the lowest free id, but only below the
+					// source if the string is already there completely
+					// (as a linear scan stopping at the source would do).
 					
+					source_id = find_longest_prefix(data, data_size, p);
+					id = first_free((p && p == data_size) ? source_id : table_size_);
 					if(id == nidx) {
 						id = hash(data, data_size);
 						id = ensure_avoids(id, n_avoid, avoid);
@@ -666,7 +678,7 @@ namespace wiselib {
 				
 				if(in.command() == CMD_HEADER) {
 					HeaderInstruction *head = reinterpret_cast<HeaderInstruction*>(&in);
-					table_size_ = head->table_size();
+					set_table_size(head->table_size());
 					assert(table_size_ > 0);
 					tuple_size_ = head->tuple_size();
 					
@@ -759,23 +771,17 @@ namespace wiselib {
 			#endif
 			
 			void set_table(table_id_t id, block_data_t* data, sz_t data_size) {
-				//GET_OS.debug("set table id %d sz %d", (int)id, (int)table_size_);
-				//assert(strlen((char*)data) + 1 >= data_size);
-				
-				if(lookup_table_[id]) {
-					//GET_OS.debug("freeing 0x%lx", (unsigned long)(void*)lookup_table_[id]);
-					get_allocator().free_array(lookup_table_[id]);
-					lookup_table_[id] = 0;
+				if(is_live(id)) {
+					erase_entry(id);
 				}
-				block_data_t* d = get_allocator().allocate_array<block_data_t>(data_size + sizeof(sz_t)).raw();
-				lookup_table_[id] = d;
 				
-				wiselib::write<OsModel>(d, data_size);
-				memcpy(d + sizeof(sz_t), data, data_size);
-				//GET_OS.debug("d=0x%lx", (unsigned long)(void*)d);
-				//GET_OS.debug("*d=%d %s", (int)d[0], (char*)(d+1));
-				//GET_OS.debug("f%d", (int)mem->mem_free());
-				//GET_OS.debug("/set table");
+				entry_offset_[id] = append(data, data_size);
+				entry_size_[id] = data_size;
+				entry_live_[id / 8] |= (1 << (id % 8));
+				
+				if(id < table_size_) {
+					index_insert(id);
+				}
 			}
 			
 			block_data_t* get_table(table_id_t id, size_type& sz) {
@@ -786,12 +792,355 @@ namespace wiselib {
 			}
 				
 			block_data_t* get_table(table_id_t id, sz_t& sz) {
-				if(!lookup_table_[id]) {
+				if(!is_live(id)) {
 					sz = 0;
 					return 0;
 				}
-				wiselib::read<OsModel>(lookup_table_[id], sz);
-				return lookup_table_[id] + sizeof(sz_t);
+				sz = entry_size_[id];
+				return arena_ + entry_offset_[id];
+			}
+			
+			/**
+			 * Find the table entry with the longest common prefix with
+			 * data (lowest id among equally long ones).
+			 * 
+			 * @param p will be set to the length of the common prefix, 0 if
+			 * there is no entry sharing a prefix with data.
+			 * @return id of that entry, 0 if p == 0.
+			 */
+			table_id_t find_longest_prefix(block_data_t* data, size_type data_size, size_type& p) {
+				if(PREFIX_INDEX) {
+					return index_find(data, data_size, p);
+				}
+				
+				table_id_t source_id = 0;
+				p = 0;
+				for(table_id_t cid = 0; cid < table_size_; cid++) {
+					size_type current_size = 0;
+					block_data_t *current = get_table(cid, current_size);
+					if(current) {
+						size_type pn = prefix_length_n(min(data_size, current_size), current, data);
+						if(pn > p) {
+							p = pn;
+							source_id = cid;
+							if(p == data_size) { break; }
+						}
+					}
+				}
+				return source_id;
+			}
+			
+		private:
+			
+			typedef ::uint16_t arena_offset_t;
+			typedef ::uint16_t node_t;
+			
+			enum { NO_NODE = (node_t)(-1) };
+			enum { ROOT = 0 };
+			enum { MAX_NODES = PREFIX_INDEX_P ? 2 * MAX_TABLE_SIZE_P + 1 : 1 };
+			enum { ARENA_MIN_CAPACITY = 64, ARENA_MAX_CAPACITY = (arena_offset_t)(-1) };
+			
+			/**
+			 * Node of the prefix trie. Path compressed, so a node exists
+			 * only where entries branch or end. The edge into a node covers
+			 * the bytes [parent.depth, depth) of any entry in its subtree,
+			 * min_id is used to read those bytes.
+			 */
+			struct TrieNode {
+				::uint16_t depth;
+				table_id_t min_id;
+				table_id_t first_entry;
+				node_t parent;
+				node_t first_child;
+				node_t next_sibling;
+			};
+			
+			bool is_live(table_id_t id) {
+				return entry_live_[id / 8] & (1 << (id % 8));
+			}
+			
+			/**
+			 * @return lowest id < limit that is not in use, nidx if none.
+			 */
+			table_id_t first_free(size_type limit) {
+				for(size_type i = 0; i * 8 < limit; i++) {
+					if(entry_live_[i] == 0xff) { continue; }
+					for(size_type id = i * 8; id < i * 8 + 8 && id < limit; id++) {
+						if(!is_live(id)) { return id; }
+					}
+				}
+				return nidx;
+			}
+			
+			void erase_entry(table_id_t id) {
+				index_erase(id);
+				entry_live_[id / 8] &= ~(1 << (id % 8));
+				arena_garbage_ += entry_size_[id];
+			}
+			
+			//
+			// Arena
+			//
+			
+			/**
+			 * Copy data_size bytes to the end of the arena, compact and/or
+			 * grow it first if necessary. data may point into the arena.
+			 * @return offset of the copy.
+			 */
+			arena_offset_t append(block_data_t* data, size_type data_size) {
+				if((size_type)arena_used_ + data_size > arena_capacity_) {
+					size_type needed = (size_type)(arena_used_ - arena_garbage_) + data_size;
+					size_type capacity = arena_capacity_ ? arena_capacity_ : (size_type)ARENA_MIN_CAPACITY;
+					while(capacity < 2 * needed && capacity < ARENA_MAX_CAPACITY) {
+						capacity *= 2;
+					}
+					if(capacity > ARENA_MAX_CAPACITY) { capacity = ARENA_MAX_CAPACITY; }
+					assert(capacity >= needed);
+					
+					// Always compact into a fresh buffer, so data stays
+					// valid even if it points into the old one
+					block_data_t *a = get_allocator().template allocate_array<block_data_t>(capacity).raw();
+					arena_offset_t used = 0;
+					for(size_type id = 0; id < MAX_TABLE_SIZE; id++) {
+						if(!is_live(id)) { continue; }
+						memcpy(a + used, arena_ + entry_offset_[id], entry_size_[id]);
+						entry_offset_[id] = used;
+						used += entry_size_[id];
+					}
+					memcpy(a + used, data, data_size);
+					
+					if(arena_) {
+						get_allocator().free_array(arena_);
+					}
+					arena_ = a;
+					arena_capacity_ = capacity;
+					arena_used_ = used + data_size;
+					arena_garbage_ = 0;
+					return used;
+				}
+				
+				arena_offset_t r = arena_used_;
+				memmove(arena_ + r, data, data_size);
+				arena_used_ += data_size;
+				return r;
+			}
+			
+			//
+			// Prefix index
+			//
+			
+			block_data_t* entry_data(table_id_t id) {
+				return arena_ + entry_offset_[id];
+			}
+			
+			void index_clear() {
+				if(!PREFIX_INDEX) { return; }
+				
+				nodes_[ROOT].depth = 0;
+				nodes_[ROOT].min_id = nidx;
+				nodes_[ROOT].first_entry = nidx;
+				nodes_[ROOT].parent = NO_NODE;
+				nodes_[ROOT].first_child = NO_NODE;
+				nodes_[ROOT].next_sibling = NO_NODE;
+				
+				free_node_ = (MAX_NODES > 1) ? 1 : NO_NODE;
+				for(size_type i = 1; i < MAX_NODES; i++) {
+					nodes_[i].next_sibling = (i + 1 < MAX_NODES) ? i + 1 : NO_NODE;
+				}
+				for(size_type i = 0; i < MAX_TABLE_SIZE; i++) {
+					entry_node_[i] = NO_NODE;
+				}
+			}
+			
+			void index_rebuild() {
+				if(!PREFIX_INDEX) { return; }
+				
+				index_clear();
+				for(size_type id = 0; id < table_size_ && id < MAX_TABLE_SIZE; id++) {
+					if(is_live(id)) { index_insert(id); }
+				}
+			}
+			
+			node_t new_node(::uint16_t depth, node_t parent) {
+				node_t n = free_node_;
+				assert(n != NO_NODE);
+				free_node_ = nodes_[n].next_sibling;
+				nodes_[n].depth = depth;
+				nodes_[n].min_id = nidx;
+				nodes_[n].first_entry = nidx;
+				nodes_[n].parent = parent;
+				nodes_[n].first_child = NO_NODE;
+				nodes_[n].next_sibling = NO_NODE;
+				return n;
+			}
+			
+			void delete_node(node_t n) {
+				nodes_[n].next_sibling = free_node_;
+				free_node_ = n;
+			}
+			
+			void add_child(node_t parent, node_t child) {
+				nodes_[child].parent = parent;
+				nodes_[child].next_sibling = nodes_[parent].first_child;
+				nodes_[parent].first_child = child;
+			}
+			
+			void replace_child(node_t parent, node_t old_child, node_t new_child) {
+				node_t *link = &nodes_[parent].first_child;
+				while(*link != old_child) {
+					link = &nodes_[*link].next_sibling;
+				}
+				*link = new_child;
+				nodes_[new_child].next_sibling = nodes_[old_child].next_sibling;
+				nodes_[new_child].parent = parent;
+			}
+			
+			void add_entry(node_t n, table_id_t id) {
+				entry_next_[id] = nodes_[n].first_entry;
+				nodes_[n].first_entry = id;
+				entry_node_[id] = n;
+			}
+			
+			/**
+			 * @return child of n whose edge starts with byte c.
+			 */
+			node_t find_child(node_t n, block_data_t c) {
+				size_type d = nodes_[n].depth;
+				for(node_t ch = nodes_[n].first_child; ch != NO_NODE; ch = nodes_[ch].next_sibling) {
+					if(entry_data(nodes_[ch].min_id)[d] == c) { return ch; }
+				}
+				return NO_NODE;
+			}
+			
+			void update_min_id(node_t n) {
+				table_id_t m = nidx;
+				for(table_id_t e = nodes_[n].first_entry; e != nidx; e = entry_next_[e]) {
+					if(e < m) { m = e; }
+				}
+				for(node_t ch = nodes_[n].first_child; ch != NO_NODE; ch = nodes_[ch].next_sibling) {
+					if(nodes_[ch].min_id < m) { m = nodes_[ch].min_id; }
+				}
+				nodes_[n].min_id = m;
+			}
+			
+			void index_insert(table_id_t id) {
+				if(!PREFIX_INDEX) { return; }
+				
+				block_data_t *s = entry_data(id);
+				size_type l = entry_size_[id];
+				node_t n = ROOT;
+				
+				while(true) {
+					if(id < nodes_[n].min_id) { nodes_[n].min_id = id; }
+					size_type d = nodes_[n].depth;
+					
+					if(d == l) {
+						add_entry(n, id);
+						return;
+					}
+					
+					node_t ch = find_child(n, s[d]);
+					if(ch == NO_NODE) {
+						node_t leaf = new_node(l, n);
+						nodes_[leaf].min_id = id;
+						add_entry(leaf, id);
+						add_child(n, leaf);
+						return;
+					}
+					
+					// follow edge into ch as far as it matches
+					size_type limit = min((size_type)nodes_[ch].depth, l);
+					block_data_t *cs = entry_data(nodes_[ch].min_id);
+					size_type k = d + 1;
+					while(k < limit && cs[k] == s[k]) { k++; }
+					
+					if(k == nodes_[ch].depth) {
+						n = ch;
+						continue;
+					}
+					
+					// split edge at k
+					node_t m = new_node(k, n);
+					replace_child(n, ch, m);
+					nodes_[ch].next_sibling = NO_NODE;
+					add_child(m, ch);
+					nodes_[m].min_id = min(nodes_[ch].min_id, id);
+					if(k == l) {
+						add_entry(m, id);
+					}
+					else {
+						node_t leaf = new_node(l, m);
+						nodes_[leaf].min_id = id;
+						add_entry(leaf, id);
+						add_child(m, leaf);
+					}
+					return;
+				}
+			}
+			
+			void index_erase(table_id_t id) {
+				if(!PREFIX_INDEX || entry_node_[id] == NO_NODE) { return; }
+				
+				node_t n = entry_node_[id];
+				entry_node_[id] = NO_NODE;
+				
+				table_id_t *link = &nodes_[n].first_entry;
+				while(*link != id) { link = &entry_next_[*link]; }
+				*link = entry_next_[id];
+				
+				// Remove nodes that became useless (no entries and less than
+				// two children), then fix min_id up to the root.
+				while(n != ROOT && nodes_[n].first_entry == nidx) {
+					node_t parent = nodes_[n].parent;
+					node_t ch = nodes_[n].first_child;
+					if(ch == NO_NODE) {
+						node_t *l = &nodes_[parent].first_child;
+						while(*l != n) { l = &nodes_[*l].next_sibling; }
+						*l = nodes_[n].next_sibling;
+						delete_node(n);
+						n = parent;
+					}
+					else if(nodes_[ch].next_sibling == NO_NODE) {
+						replace_child(parent, n, ch);
+						delete_node(n);
+						n = parent;
+						break;
+					}
+					else {
+						break;
+					}
+				}
+				
+				for( ; n != NO_NODE; n = nodes_[n].parent) {
+					update_min_id(n);
+				}
+			}
+			
+			table_id_t index_find(block_data_t* data, size_type data_size, size_type& p) {
+				node_t n = ROOT;
+				size_type k = 0;
+				p = 0;
+				
+				while(k < data_size) {
+					node_t ch = find_child(n, data[k]);
+					if(ch == NO_NODE) { break; }
+					
+					size_type limit = min((size_type)nodes_[ch].depth, data_size);
+					block_data_t *cs = entry_data(nodes_[ch].min_id);
+					k++;
+					while(k < limit && cs[k] == data[k]) { k++; }
+					
+					if(k < nodes_[ch].depth) {
+						// stopped inside the edge: everything below ch
+						// shares exactly k bytes with data
+						p = k;
+						return nodes_[ch].min_id;
+					}
+					n = ch;
+				}
+				
+				p = k;
+				return p ? nodes_[n].min_id : 0;
 			}
 			
 		private:
@@ -831,9 +1180,21 @@ namespace wiselib {
 				return r % table_size_;
 			}
 			
-			block_data_t *lookup_table_[MAX_TABLE_SIZE];
 			table_id_t table_size_;
 			table_id_t tuple_size_;
+			
+			block_data_t *arena_;
+			arena_offset_t arena_capacity_;
+			arena_offset_t arena_used_;
+			arena_offset_t arena_garbage_;
+			arena_offset_t entry_offset_[MAX_TABLE_SIZE];
+			sz_t entry_size_[MAX_TABLE_SIZE];
+			::uint8_t entry_live_[(MAX_TABLE_SIZE + 7) / 8];
+			
+			TrieNode nodes_[MAX_NODES];
+			node_t free_node_;
+			node_t entry_node_[PREFIX_INDEX_P ? MAX_TABLE_SIZE_P : 1];
+			table_id_t entry_next_[PREFIX_INDEX_P ? MAX_TABLE_SIZE_P : 1];
 	};
 	
 } // namespace wiselib
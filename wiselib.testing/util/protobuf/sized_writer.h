@@ -0,0 +1,261 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef SIZED_WRITER_H
+#define SIZED_WRITER_H
+
+#include "varint.h"
+
+namespace wiselib {
+   namespace protobuf {
+
+/**
+ * Two-phase protobuf writer for nested messages.
+ * 
+ * Protobuf prefixes every embedded message with its length, so writing
+ * nested messages directly needs a temporary buffer per nesting level
+ * that is copied into its parent afterwards.
+ * SizedWriter instead is driven twice with the same sequence of calls:
+ * In the measure phase (after measure()) only sizes are computed and the
+ * length of each embedded message is recorded. In the write phase (after
+ * write()) the fields are encoded directly into a single contiguous
+ * buffer, the recorded lengths are consumed in order. As the total size
+ * is known beforehand, no bounds checks are necessary while writing.
+ * 
+ * mark(), rollback() and closed_size() allow to find out during the
+ * measure phase how many elements fit into a buffer of a given size.
+ * 
+ * Usage:
+ * @code
+ * writer.measure();
+ * writer.begin_message(4);
+ * writer.add_string(1, "foo");
+ * writer.end_message();
+ * if(writer.ok() && writer.size() <= buffer_size) {
+ *    writer.write(buffer, buffer_size);
+ *    writer.begin_message(4);
+ *    writer.add_string(1, "foo");
+ *    writer.end_message();
+ * }
+ * @endcode
+ * 
+ * \tparam MAX_MESSAGES_P Maximum number of embedded messages per run.
+ * \tparam MAX_DEPTH_P Maximum nesting depth of embedded messages.
+ */
+template<
+   typename OsModel_P,
+   typename Integer_P = ::uint32_t,
+   size_t MAX_MESSAGES_P = 32,
+   size_t MAX_DEPTH_P = 8
+>
+class SizedWriter {
+   public:
+      typedef OsModel_P Os;
+      typedef typename Os::block_data_t block_data_t;
+      typedef typename Os::size_t size_type;
+      typedef Integer_P int_t;
+      typedef SizedWriter<OsModel_P, Integer_P, MAX_MESSAGES_P, MAX_DEPTH_P> self_type;
+      
+      typedef VarInt<Os, block_data_t*, int_t> varint_t;
+      
+      enum {
+         MAX_MESSAGES = MAX_MESSAGES_P,
+         MAX_DEPTH = MAX_DEPTH_P
+      };
+      
+      enum { WIRE_VARINT = 0, WIRE_LENGTH_DELIMITED = 2 };
+      
+      /**
+       * State of the measure phase that can be restored with rollback().
+       */
+      struct Mark {
+         size_type size;
+         size_type messages;
+         size_type depth;
+      };
+      
+      SizedWriter() {
+         measure();
+      }
+      
+      /**
+       * Start (or restart) the measure phase.
+       */
+      void measure() {
+         writing_ = false;
+         ok_ = true;
+         size_ = 0;
+         messages_ = 0;
+         depth_ = 0;
+      }
+      
+      /**
+       * Start the write phase.
+       * All messages must have been closed in the measure phase and the
+       * measured size must fit into the buffer.
+       * The fields then have to be added again in the same order.
+       * 
+       * @return false if the measured data does not fit or the measure
+       * phase failed.
+       */
+      bool write(block_data_t *buffer, size_type buffer_size) {
+         if(!ok_ || depth_ != 0 || size_ > buffer_size) { return false; }
+         writing_ = true;
+         buffer_ = buffer;
+         position_ = buffer;
+         next_message_ = 0;
+         return true;
+      }
+      
+      void begin_message(int_t field) {
+         if(writing_) {
+            position_ = varint_t::encode(position_, tag(field, WIRE_LENGTH_DELIMITED));
+            position_ = varint_t::encode(position_, lengths_[next_message_++]);
+            return;
+         }
+         
+         if(messages_ >= MAX_MESSAGES || depth_ >= MAX_DEPTH) {
+            ok_ = false;
+            return;
+         }
+         size_ += varint_t::size(tag(field, WIRE_LENGTH_DELIMITED));
+         stack_[depth_].message = messages_++;
+         stack_[depth_].start = size_;
+         depth_++;
+      }
+      
+      void end_message() {
+         if(writing_ || !ok_) { return; }
+         
+         depth_--;
+         int_t l = size_ - stack_[depth_].start;
+         lengths_[stack_[depth_].message] = l;
+         size_ += varint_t::size(l);
+      }
+      
+      void add_varint(int_t field, int_t v) {
+         if(writing_) {
+            position_ = varint_t::encode(position_, tag(field, WIRE_VARINT));
+            position_ = varint_t::encode(position_, v);
+            return;
+         }
+         size_ += varint_field_size(field, v);
+      }
+      
+      void add_bytes(int_t field, const block_data_t *data, size_type l) {
+         if(writing_) {
+            position_ = varint_t::encode(position_, tag(field, WIRE_LENGTH_DELIMITED));
+            position_ = varint_t::encode(position_, l);
+            memcpy(position_, data, l);
+            position_ += l;
+            return;
+         }
+         size_ += bytes_field_size(field, l);
+      }
+      
+      /**
+       * Add a 0-terminated string (without the terminating 0).
+       */
+      void add_string(int_t field, const char *s) {
+         add_bytes(field, reinterpret_cast<const block_data_t*>(s), strlen(s));
+      }
+      
+      /**
+       * @return Size measured so far, in the write phase: number of bytes
+       * written so far.
+       */
+      size_type size() {
+         return writing_ ? (size_type)(position_ - buffer_) : size_;
+      }
+      
+      /**
+       * @return Size the data would have if all currently open messages
+       * were closed now (measure phase only).
+       */
+      size_type closed_size() {
+         size_type s = size_;
+         for(size_type d = depth_; d > 0; d--) {
+            s += varint_t::size(s - stack_[d - 1].start);
+         }
+         return s;
+      }
+      
+      Mark mark() {
+         Mark m;
+         m.size = size_;
+         m.messages = messages_;
+         m.depth = depth_;
+         return m;
+      }
+      
+      /**
+       * Forget everything that has been measured after m was taken.
+       */
+      void rollback(const Mark& m) {
+         size_ = m.size;
+         messages_ = m.messages;
+         depth_ = m.depth;
+         ok_ = true;
+      }
+      
+      /**
+       * @return false if MAX_MESSAGES or MAX_DEPTH has been exceeded
+       * since the last measure() or rollback().
+       */
+      bool ok() { return ok_; }
+      
+      static int_t tag(int_t field, int_t wire_type) {
+         return field << 3 | wire_type;
+      }
+      
+      static size_type varint_field_size(int_t field, int_t v) {
+         return varint_t::size(tag(field, WIRE_VARINT)) + varint_t::size(v);
+      }
+      
+      static size_type bytes_field_size(int_t field, size_type l) {
+         return varint_t::size(tag(field, WIRE_LENGTH_DELIMITED)) + varint_t::size(l) + l;
+      }
+      
+   private:
+      struct Open {
+         size_type message;
+         size_type start;
+      };
+      
+      bool writing_;
+      bool ok_;
+      
+      // measure phase
+      size_type size_;
+      size_type messages_;
+      size_type depth_;
+      Open stack_[MAX_DEPTH];
+      int_t lengths_[MAX_MESSAGES];
+      
+      // write phase
+      block_data_t *buffer_;
+      block_data_t *position_;
+      size_type next_message_;
+};
+
+   } // ns protobuf
+} // ns wiselib
+
+#endif // SIZED_WRITER_H
+// vim: set ts=3 sw=3 expandtab:
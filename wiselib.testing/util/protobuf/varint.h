@@ -26,12 +26,43 @@
 namespace wiselib {
    namespace protobuf {
 
+/**
+ * Size computation shared by the VarInt implementations.
+ */
+template<typename Integer_P>
+class VarIntBase {
+   public:
+      typedef Integer_P int_t;
+      
+      enum { WIRE_TYPE = 0 };
+      
+      /// Maximum number of bytes an int_t can occupy when encoded.
+      enum { MAX_SIZE = (sizeof(int_t) * 8 + 6) / 7 };
+      
+      /**
+       * @return number of bytes needed to encode v.
+       */
+      static size_t size(int_t v) {
+         size_t n = 1;
+         while(v >= CONTINUATION) {
+            v >>= 7;
+            n++;
+         }
+         return n;
+      }
+      
+   protected:
+      static const uint8_t DATA = 0x7f, CONTINUATION = 0x80;
+};
+
 /**
  * Implements the ProtobufRW Concept.
  * 
  * \tparam Buffer_P type of a (write-)iterator over a block_data_t collection,
  * must support iter++ as well es (*iter) = some_block_data_t_instance.
  * E.g. block_data_t*, vector_dynamic<..., block_data_t>::iterator.
+ * For plain pointers a specialization without per-byte bounds checks is
+ * used.
  * 
  * \tparam Integer_P Unsigned integer type that is used on the application
  * side to represent varints. Note that this *must* be an unsigned type, else
@@ -43,50 +74,139 @@ template<
    typename Buffer_P,
    typename Integer_P
 >
-class VarInt {
+class VarInt : public VarIntBase<Integer_P> {
    public:
       typedef OsModel_P Os;
       typedef Buffer_P buffer_t;
       typedef typename Os::block_data_t block_data_t;
       typedef Integer_P int_t;
+      typedef VarIntBase<Integer_P> base_t;
       
       typedef Byte<Os, buffer_t> byterw_t;
       
-      enum { WIRE_TYPE = 0 };
+      static bool write(buffer_t& buffer, buffer_t& buffer_end, int_t v, size_t sz=0) {
+         while(v >= base_t::CONTINUATION) {
+            if(!byterw_t::write(buffer, buffer_end, (block_data_t)(v | base_t::CONTINUATION))) { return false; }
+            v >>= 7;
+         }
+         return byterw_t::write(buffer, buffer_end, (block_data_t)v);
+      }
       
-      static bool write(buffer_t& buffer, buffer_t& buffer_end, int_t v_, size_t sz=0) {
-         unsigned v = (unsigned)v_;
-         bool continuation = (v >> 7) != 0;
-         
-         if(!byterw_t::write(buffer, buffer_end, (int_t)((v & DATA) | (continuation << 7)))) { return false; }
-         if(continuation) {
-            if(!write(buffer, buffer_end, v >> 7)) { return false; }
+      static bool read(buffer_t& buffer, buffer_t& buffer_end, int_t& out) {
+         int_t v = 0;
+         block_data_t b;
+         for(size_t shift = 0; shift < 7 * base_t::MAX_SIZE; shift += 7) {
+            if(!byterw_t::read(buffer, buffer_end, b)) { return false; }
+            v |= (int_t)(b & base_t::DATA) << shift;
+            if(!(b & base_t::CONTINUATION)) {
+               out = v;
+               return true;
+            }
          }
+         return false;
+      }
+};
+
+/**
+ * VarInt on contiguous memory.
+ * 
+ * If at least MAX_SIZE bytes are left in the buffer, encoding and decoding
+ * run without any bounds checks, else the remaining space is checked once
+ * (writing) or per byte (reading).
+ * encode() and decode() are the unchecked primitives for callers that
+ * already know their buffer is large enough (see SizedWriter).
+ */
+template<
+   typename OsModel_P,
+   typename T,
+   typename Integer_P
+>
+class VarInt<OsModel_P, T*, Integer_P> : public VarIntBase<Integer_P> {
+   public:
+      typedef OsModel_P Os;
+      typedef T* buffer_t;
+      typedef typename Os::block_data_t block_data_t;
+      typedef Integer_P int_t;
+      typedef VarIntBase<Integer_P> base_t;
+      
+      static bool write(buffer_t& buffer, buffer_t& buffer_end, int_t v, size_t sz=0) {
+         if(buffer_end - buffer < (long)base_t::MAX_SIZE && (size_t)(buffer_end - buffer) < base_t::size(v)) {
+            return false;
+         }
+         buffer = encode(buffer, v);
          return true;
       }
       
       static bool read(buffer_t& buffer, buffer_t& buffer_end, int_t& out) {
-         int_t v;
-         block_data_t b;
-         if(!byterw_t::read(buffer, buffer_end, b)) { return false; }
-         v = b;
-         bool continuation = (v >> 7) != 0;
-         v &= DATA;
+         if(buffer_end - buffer >= (long)base_t::MAX_SIZE) {
+            buffer_t p = decode(buffer, out);
+            if(!p) { return false; }
+            buffer = p;
+            return true;
+         }
          
-         if(continuation) {
-            int_t v2;
-            if(!read(buffer, buffer_end, v2)) { return false; }
-            out = v | (v2 << 7);
+         int_t v = 0;
+         buffer_t p = buffer;
+         for(size_t shift = 0; p < buffer_end && shift < 7 * base_t::MAX_SIZE; shift += 7, ++p) {
+            ::uint8_t b = (::uint8_t)*p;
+            v |= (int_t)(b & base_t::DATA) << shift;
+            if(!(b & base_t::CONTINUATION)) {
+               out = v;
+               buffer = p + 1;
+               return true;
+            }
+         }
+         return false;
+      }
+      
+      /**
+       * Write v to p without any bounds checks.
+       * @return position after the encoded value.
+       */
+      static buffer_t encode(buffer_t p, int_t v) {
+         if(v < base_t::CONTINUATION) {
+            *p = (T)v;
+            return p + 1;
+         }
+         *p++ = (T)(v | base_t::CONTINUATION);
+         v >>= 7;
+         while(v >= base_t::CONTINUATION) {
+            *p++ = (T)(v | base_t::CONTINUATION);
+            v >>= 7;
+         }
+         *p++ = (T)v;
+         return p;
+      }
+      
+      /**
+       * Read a value from p, which must have at least MAX_SIZE bytes
+       * available. The first two bytes (values < 2^14) are unrolled.
+       * @return position after the encoded value or 0 if the encoding
+       * is longer than MAX_SIZE bytes.
+       */
+      static buffer_t decode(buffer_t p, int_t& out) {
+         int_t b = (::uint8_t)p[0];
+         if(!(b & base_t::CONTINUATION)) {
+            out = b;
+            return p + 1;
          }
-         else {
+         int_t v = b & base_t::DATA;
+         b = (::uint8_t)p[1];
+         v |= (b & base_t::DATA) << 7;
+         if(!(b & base_t::CONTINUATION)) {
             out = v;
+            return p + 2;
          }
-         return true;
+         for(size_t i = 2; i < base_t::MAX_SIZE; i++) {
+            b = (::uint8_t)p[i];
+            v |= (b & base_t::DATA) << (7 * i);
+            if(!(b & base_t::CONTINUATION)) {
+               out = v;
+               return p + i + 1;
+            }
+         }
+         return 0;
       }
-         
-   private:
-      static const uint8_t DATA = 0x7f, CONTINUATION = 0x80;
-   
 };
 
    }
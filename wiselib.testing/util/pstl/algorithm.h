@@ -445,14 +445,14 @@ template<class ForwardIterator, class T>
 ForwardIterator lower_bound(ForwardIterator first, ForwardIterator last,
 		T const &value) {
 	ForwardIterator it;
-	typename iterator_traits<ForwardIterator>::distance_type count, step;
+	typename iterator_traits<ForwardIterator>::difference_type count, step;
 	count = distance(first, last);
 	while (count > 0) {
 		it = first;
 		step = count >> 1;
 		advance(it, step);
 		if (*it < value) {
-			first = it + 1;
+			first = ++it;
 			count -= step + 1;
 		} else
 			count = step;
@@ -464,14 +464,14 @@ template<class ForwardIterator, class T, class Compare>
 ForwardIterator lower_bound(ForwardIterator first, ForwardIterator last,
 		T const &value, Compare comp) {
 	ForwardIterator it;
-	typename iterator_traits<ForwardIterator>::distance_type count, step;
+	typename iterator_traits<ForwardIterator>::difference_type count, step;
 	count = distance(first, last);
 	while (count > 0) {
 		it = first;
 		step = count >> 1;
 		advance(it, step);
 		if (comp(*it, value)) {
-			first = it + 1;
+			first = ++it;
 			count -= step + 1;
 		} else
 			count = step;
@@ -483,14 +483,14 @@ template<class ForwardIterator, class T>
 ForwardIterator upper_bound(ForwardIterator first, ForwardIterator last,
 		T const &value) {
 	ForwardIterator it;
-	typename iterator_traits<ForwardIterator>::distance_type count, step;
+	typename iterator_traits<ForwardIterator>::difference_type count, step;
 	count = distance(first, last);
 	while (count > 0) {
 		it = first;
 		step = count >> 1;
 		advance(it, step);
 		if (!(value < *it)) {
-			first = it + 1;
+			first = ++it;
 			count -= step + 1;
 		} else
 			count = step;
@@ -502,14 +502,14 @@ template<class ForwardIterator, class T, class Compare>
 ForwardIterator upper_bound(ForwardIterator first, ForwardIterator last,
 		T const &value, Compare comp) {
 	ForwardIterator it;
-	typename iterator_traits<ForwardIterator>::distance_type count, step;
+	typename iterator_traits<ForwardIterator>::difference_type count, step;
 	count = distance(first, last);
 	while (count > 0) {
 		it = first;
 		step = count >> 1;
 		advance(it, step);
 		if (!comp(value, *it)) {
-			first = it + 1;
+			first = ++it;
 			count -= step + 1;
 		} else
 			count = step;
@@ -741,6 +741,8 @@ OutputIterator reverse_copy(BidirectionalIterator first,
 
 template<class ForwardIterator>
 void rotate(ForwardIterator first, ForwardIterator middle, ForwardIterator last) {
+	if (first == middle || middle == last)
+		return;
 	ForwardIterator next = middle;
 	while (first != next) {
 		swap(*first++, *next++);
@@ -1038,16 +1040,12 @@ void heap_sort(RandomAccessIterator first, RandomAccessIterator last,
 template<class InputIterator1, class InputIterator2, class OutputIterator>
 OutputIterator merge(InputIterator1 first1, InputIterator1 last1,
 		InputIterator2 first2, InputIterator2 last2, OutputIterator result) {
-	for (;;)
-		if (*first1 < *first2) {
-			*result++ = *first1++;
-			if (first1 == last1)
-				return copy(first1, last1, result);
-		} else {
+	while (first1 != last1 && first2 != last2)
+		if (*first2 < *first1)
 			*result++ = *first2++;
-			if (first2 == last2)
-				return copy(first2, last2, result);
-		}
+		else
+			*result++ = *first1++;
+	return copy(first2, last2, copy(first1, last1, result));
 }
 
 template<class InputIterator1, class InputIterator2, class OutputIterator,
@@ -1055,28 +1053,132 @@ template<class InputIterator1, class InputIterator2, class OutputIterator,
 OutputIterator merge(InputIterator1 first1, InputIterator1 last1,
 		InputIterator2 first2, InputIterator2 last2, OutputIterator result,
 		Compare comp) {
-	for (;;)
-		if (comp(*first1, *first2)) {
-			*result++ = *first1++;
-			if (first1 == last1)
-				return copy(first1, last1, result);
-		} else {
+	while (first1 != last1 && first2 != last2)
+		if (comp(*first2, *first1))
 			*result++ = *first2++;
-			if (first2 == last2)
-				return copy(first2, last2, result);
+		else
+			*result++ = *first1++;
+	return copy(first2, last2, copy(first1, last1, result));
+}
+
+template<class T>
+struct __less {
+	bool operator()(T const &a, T const &b) const {
+		return a < b;
+	}
+};
+
+/*
+ * Stable merge of [first, middle) and [middle, last).
+ * If one of the halves fits into buffer it is moved there and merged back
+ * in a single pass, otherwise the larger half is split, the ranges between
+ * the cuts rotated and both parts merged recursively (with buffer_size = 0
+ * this needs O(n log n) moves and no extra memory).
+ */
+template<class BidirectionalIterator, class Distance, class T, class Compare>
+void __merge_adaptive(BidirectionalIterator first,
+		BidirectionalIterator middle, BidirectionalIterator last, Distance len1,
+		Distance len2, T *buffer, Distance buffer_size, Compare comp) {
+	if (len1 == 0 || len2 == 0)
+		return;
+	if (len1 + len2 == 2) {
+		if (comp(*middle, *first))
+			iter_swap(first, middle);
+		return;
+	}
+
+	if (len1 <= buffer_size) {
+		T *buffer_end = copy(first, middle, buffer);
+		while (buffer != buffer_end && middle != last)
+			if (comp(*middle, *buffer))
+				*first++ = *middle++;
+			else
+				*first++ = *buffer++;
+		copy(buffer, buffer_end, first);
+		return;
+	}
+
+	if (len2 <= buffer_size) {
+		T *buffer_end = copy(middle, last, buffer);
+		BidirectionalIterator a = middle;
+		--a;
+		--buffer_end;
+		for (;;) {
+			if (comp(*buffer_end, *a)) {
+				*--last = *a;
+				if (a == first) {
+					copy_backward(buffer, buffer_end + 1, last);
+					return;
+				}
+				--a;
+			} else {
+				*--last = *buffer_end;
+				if (buffer_end == buffer)
+					return;
+				--buffer_end;
+			}
 		}
+	}
+
+	BidirectionalIterator first_cut = first, second_cut = middle;
+	Distance len11, len22;
+	if (len1 > len2) {
+		len11 = len1 >> 1;
+		advance(first_cut, len11);
+		second_cut = lower_bound(middle, last, *first_cut, comp);
+		len22 = distance(middle, second_cut);
+	} else {
+		len22 = len2 >> 1;
+		advance(second_cut, len22);
+		first_cut = upper_bound(first, middle, *second_cut, comp);
+		len11 = distance(first, first_cut);
+	}
+	rotate(first_cut, middle, second_cut);
+	BidirectionalIterator new_middle = first_cut;
+	advance(new_middle, len22);
+	__merge_adaptive(first, first_cut, new_middle, len11, len22, buffer,
+			buffer_size, comp);
+	__merge_adaptive(new_middle, second_cut, last, len1 - len11, len2 - len22,
+			buffer, buffer_size, comp);
+}
+
+template<class BidirectionalIterator, class Compare>
+void inplace_merge(BidirectionalIterator first, BidirectionalIterator middle,
+		BidirectionalIterator last, Compare comp) {
+	typedef typename iterator_traits<BidirectionalIterator>::difference_type
+			index_type;
+	__merge_adaptive(first, middle, last, distance(first, middle), distance(
+			middle, last), (typename iterator_traits<BidirectionalIterator>::
+			value_type*) 0, index_type(0), comp);
 }
 
 template<class BidirectionalIterator>
 void inplace_merge(BidirectionalIterator first, BidirectionalIterator middle,
 		BidirectionalIterator last) {
-	heap_sort(first, last);
+	inplace_merge(first, middle, last, __less<typename iterator_traits<
+			BidirectionalIterator>::value_type> ());
 }
 
+/*
+ * buffer must hold buffer_size elements, min(middle - first, last - middle)
+ * are enough for a linear time merge.
+ */
 template<class BidirectionalIterator, class Compare>
 void inplace_merge(BidirectionalIterator first, BidirectionalIterator middle,
-		BidirectionalIterator last, Compare comp) {
-	heap_sort(first, last, comp);
+		BidirectionalIterator last, typename iterator_traits<
+				BidirectionalIterator>::value_type *buffer, typename iterator_traits<
+				BidirectionalIterator>::difference_type buffer_size, Compare comp) {
+	__merge_adaptive(first, middle, last, distance(first, middle), distance(
+			middle, last), buffer, buffer_size, comp);
+}
+
+template<class BidirectionalIterator>
+void inplace_merge(BidirectionalIterator first, BidirectionalIterator middle,
+		BidirectionalIterator last, typename iterator_traits<
+				BidirectionalIterator>::value_type *buffer, typename iterator_traits<
+				BidirectionalIterator>::difference_type buffer_size) {
+	inplace_merge(first, middle, last, buffer, buffer_size, __less<
+			typename iterator_traits<BidirectionalIterator>::value_type> ());
 }
 
 template<class InputIterator1, class InputIterator2>
@@ -1355,25 +1457,139 @@ void selection_partial_sort(RandomAccessIterator first,
 		iter_swap(first, min_element(first, last, comp));
 }
 
+enum {
+	__SORT_THRESHOLD = 16
+};
+
+template<class RandomAccessIterator, class Compare>
+void __move_median_to_first(RandomAccessIterator result,
+		RandomAccessIterator a, RandomAccessIterator b, RandomAccessIterator c,
+		Compare comp) {
+	if (comp(*a, *b)) {
+		if (comp(*b, *c))
+			iter_swap(result, b);
+		else if (comp(*a, *c))
+			iter_swap(result, c);
+		else
+			iter_swap(result, a);
+	} else if (comp(*a, *c))
+		iter_swap(result, a);
+	else if (comp(*b, *c))
+		iter_swap(result, c);
+	else
+		iter_swap(result, b);
+}
+
+/*
+ * Hoare partition of [first, last) around *pivot, which must lie outside
+ * the range. Elements equal to the pivot stop both scans, so ranges with
+ * many duplicates are still split in the middle.
+ */
+template<class RandomAccessIterator, class Compare>
+RandomAccessIterator __unguarded_partition(RandomAccessIterator first,
+		RandomAccessIterator last, RandomAccessIterator pivot, Compare comp) {
+	for (;;) {
+		while (comp(*first, *pivot))
+			++first;
+		--last;
+		while (comp(*pivot, *last))
+			--last;
+		if (!(first < last))
+			return first;
+		iter_swap(first, last);
+		++first;
+	}
+}
+
+/*
+ * Quicksort with median of 3 pivot down to __SORT_THRESHOLD elements,
+ * falls back to heap_sort after depth_limit levels. Leaves the range
+ * partitioned into unsorted blocks of at most __SORT_THRESHOLD elements.
+ */
+template<class RandomAccessIterator, class Size, class Compare>
+void __introsort_loop(RandomAccessIterator first, RandomAccessIterator last,
+		Size depth_limit, Compare comp) {
+	while (last - first > __SORT_THRESHOLD) {
+		if (depth_limit == 0) {
+			heap_sort(first, last, comp);
+			return;
+		}
+		--depth_limit;
+		__move_median_to_first(first, first + 1, first + (last - first) / 2,
+				last - 1, comp);
+		RandomAccessIterator const cut = __unguarded_partition(first + 1, last,
+				first, comp);
+		__introsort_loop(cut, last, depth_limit, comp);
+		last = cut;
+	}
+}
+
+template<class RandomAccessIterator, class Compare>
+void sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp) {
+	typename iterator_traits<RandomAccessIterator>::difference_type depth = 0;
+	for (typename iterator_traits<RandomAccessIterator>::difference_type n =
+			last - first; n > 1; n >>= 1)
+		depth += 2;
+	__introsort_loop(first, last, depth, comp);
+	insertion_sort(first, last, comp);
+}
+
 template<class RandomAccessIterator>
-void stable_sort(RandomAccessIterator first, RandomAccessIterator last) {
-	insertion_sort(first, last);
+void sort(RandomAccessIterator first, RandomAccessIterator last) {
+	sort(first, last, __less<
+			typename iterator_traits<RandomAccessIterator>::value_type> ());
+}
+
+template<class RandomAccessIterator, class T, class Distance, class Compare>
+void __stable_sort(RandomAccessIterator first, RandomAccessIterator last,
+		T *buffer, Distance buffer_size, Compare comp) {
+	if (last - first <= __SORT_THRESHOLD) {
+		insertion_sort(first, last, comp);
+		return;
+	}
+	RandomAccessIterator const middle = first + (last - first) / 2;
+	__stable_sort(first, middle, buffer, buffer_size, comp);
+	__stable_sort(middle, last, buffer, buffer_size, comp);
+	if (!comp(*middle, *(middle - 1)))
+		return;
+	__merge_adaptive(first, middle, last, Distance(middle - first), Distance(
+			last - middle), buffer, buffer_size, comp);
 }
 
+/*
+ * Merge sort. With a buffer of at least (last - first + 1) / 2 elements it
+ * runs in O(n log n), smaller buffers (or none, for targets without an
+ * allocator) fall back to rotation based merging, O(n log^2 n).
+ */
 template<class RandomAccessIterator, class Compare>
 void stable_sort(RandomAccessIterator first, RandomAccessIterator last,
+		typename iterator_traits<RandomAccessIterator>::value_type *buffer,
+		typename iterator_traits<RandomAccessIterator>::difference_type buffer_size,
 		Compare comp) {
-	insertion_sort(first, last, comp);
+	__stable_sort(first, last, buffer, buffer_size, comp);
 }
 
 template<class RandomAccessIterator>
-void sort(RandomAccessIterator first, RandomAccessIterator last) {
-	heap_sort(first, last);
+void stable_sort(RandomAccessIterator first, RandomAccessIterator last,
+		typename iterator_traits<RandomAccessIterator>::value_type *buffer,
+		typename iterator_traits<RandomAccessIterator>::difference_type buffer_size) {
+	__stable_sort(first, last, buffer, buffer_size, __less<
+			typename iterator_traits<RandomAccessIterator>::value_type> ());
 }
 
 template<class RandomAccessIterator, class Compare>
-void sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp) {
-	heap_sort(first, last, comp);
+void stable_sort(RandomAccessIterator first, RandomAccessIterator last,
+		Compare comp) {
+	typedef typename iterator_traits<RandomAccessIterator>::difference_type
+			index_type;
+	__stable_sort(first, last, (typename iterator_traits<RandomAccessIterator>::
+			value_type*) 0, index_type(0), comp);
+}
+
+template<class RandomAccessIterator>
+void stable_sort(RandomAccessIterator first, RandomAccessIterator last) {
+	stable_sort(first, last, __less<
+			typename iterator_traits<RandomAccessIterator>::value_type> ());
 }
 
 template<class RandomAccessIterator>
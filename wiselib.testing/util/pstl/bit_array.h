@@ -4,8 +4,22 @@
 
 #include <util/meta.h>
 
+#if defined(PC) && defined(__GNUC__)
+	#define WISELIB_BIT_ARRAY_VECTORIZED 1
+#endif
+
 namespace wiselib {
 	
+	/**
+	 * Bit array laid over a byte buffer, bit i is bit (i % 8) of byte
+	 * i / 8 (LSB first). The array does not know its own size, all
+	 * operations that scan take the range explicitly.
+	 *
+	 * Scans, counts and bulk operations work on whole machine words
+	 * (loaded with memcpy, so the buffer needs no alignment) and never
+	 * read bytes beyond the given end. On PC the bulk operations use 16
+	 * byte vectors.
+	 */
 	template<
 		typename OsModel_P
 	>
@@ -37,43 +51,122 @@ namespace wiselib {
 			}
 			*/
 			
+			typedef unsigned long word_t;
+			enum { WORD_BYTES = sizeof(word_t), WORD_BITS = 8 * sizeof(word_t) };
+			
+			/**
+			 * @return position of the first bit with value v in
+			 * [start, end), npos if there is none.
+			 */
 			size_type first(bool v, size_type start, size_type end) {
-				/*
-				block_data_t empty = v ? 0 : 0xff;
-				
-				size_type pos = start;
-				for( ; pos < 8 * ((start + 7) / 8) && pos < end; pos++) {
-					if(get(pos) == v) { return pos; }
-				}
-				
-				for( ; pos < 8 * (end / 8); pos += 8) {
-					if(data_[pos / 8] != empty) {
-						for( ; pos < end; pos++) {
-							if(get(pos) == v) { return pos; }
-						}
-						assert(false);
+				size_type end_byte = bytes_needed(end);
+				for(size_type pos = start; pos < end; ) {
+					size_type b = byte(pos);
+					word_t w = load_word(b, end_byte);
+					if(!v) { w = ~w; }
+					w >>= bit(pos);
+					if(w) {
+						pos += ctz(w);
+						return (pos < end) ? pos : (size_type)npos;
 					}
+					pos = 8 * b + WORD_BITS;
 				}
-				
-				for( ; pos < end; pos++) {
-					if(get(pos) == v) { return pos; }
+				return npos;
+			}
+			
+			size_type find_first_set(size_type start, size_type end) { return first(true, start, end); }
+			size_type find_first_clear(size_type start, size_type end) { return first(false, start, end); }
+			
+			/**
+			 * @return start of the first run of n clear bits in
+			 * [start, end), npos if there is none.
+			 */
+			size_type find_run(size_type n, size_type start, size_type end) {
+				for(size_type pos = start; ; ) {
+					pos = find_first_clear(pos, end);
+					if(pos == npos || end - pos < n) { return npos; }
+					size_type set = find_first_set(pos, pos + n);
+					if(set == npos) { return pos; }
+					pos = set + 1;
 				}
-				*/
-				for(size_type pos = start; pos < end; pos++) {
-					if(get(pos) == v) { return pos; }
+			}
+			
+			/**
+			 * @return number of set bits in [start, end).
+			 */
+			size_type count(size_type start, size_type end) {
+				size_type end_byte = bytes_needed(end);
+				size_type r = 0;
+				for(size_type pos = start; pos < end; ) {
+					size_type b = byte(pos);
+					word_t w = load_word(b, end_byte) >> bit(pos);
+					size_type n = 8 * b + WORD_BITS - pos;
+					if(n > end - pos) {
+						n = end - pos;
+						w &= ((word_t)1 << n) - 1;
+					}
+					r += popcount(w);
+					pos += n;
+				}
+				return r;
+			}
+			
+			/// number of set bits before pos
+			size_type rank(size_type pos) { return count(0, pos); }
+			
+			/**
+			 * @return position of the set bit with rank k (i.e. the
+			 * k+1-th set bit) in [start, end), npos if there are not
+			 * that many.
+			 */
+			size_type select(size_type k, size_type start, size_type end) {
+				size_type end_byte = bytes_needed(end);
+				for(size_type pos = start; pos < end; ) {
+					size_type b = byte(pos);
+					word_t w = load_word(b, end_byte) >> bit(pos);
+					size_type n = 8 * b + WORD_BITS - pos;
+					if(n > end - pos) {
+						n = end - pos;
+						w &= ((word_t)1 << n) - 1;
+					}
+					size_type c = popcount(w);
+					if(k < c) { return pos + select_in_word(w, k); }
+					k -= c;
+					pos += n;
 				}
 				return npos;
 			}
 			
+			/**
+			 * Set all bits in [start, end) to v.
+			 */
+			void set_range(size_type start, size_type end, bool v) {
+				for( ; start < end && bit(start); start++) { set(start, v); }
+				for( ; end > start && bit(end); end--) { set(end - 1, v); }
+				if(start < end) {
+					memset(data() + byte(start), v ? 0xff : 0x00, byte(end) - byte(start));
+				}
+			}
+			
+			///@{
+			///@name Bulk operations
+			/// Combine the first bytes_needed(bits) bytes with other.
+			
+			void bit_and(const BitArray& other, size_type bits) { combine<And>(other, bits); }
+			void bit_or(const BitArray& other, size_type bits) { combine<Or>(other, bits); }
+			void bit_xor(const BitArray& other, size_type bits) { combine<Xor>(other, bits); }
+			
+			///@}
+			
 			bool operator[](size_type idx) { return get(idx); }
 			
 			bool get(size_type idx) {
-				return (data_[byte(idx)] & (1 << bit(idx))) != 0;
+				return (data()[byte(idx)] & (1 << bit(idx))) != 0;
 			}
 			
 			void set(size_type i, bool v) {
-				data_[byte(i)] &= ~(1 << bit(i));
-				data_[byte(i)] |= v << bit(i);
+				data()[byte(i)] &= ~(1 << bit(i));
+				data()[byte(i)] |= v << bit(i);
 			}
 			
 			/**
@@ -82,7 +175,7 @@ namespace wiselib {
 			 * assumes, the bits  to fill are clear (i.e. uses OR)
 			 */
 			void fill_byte(size_type pos, block_data_t filler) {
-				data_[byte(pos)] |= filler << bit(pos);
+				data()[byte(pos)] |= filler << bit(pos);
 			}
 			
 			void copy(BitArray* target, size_type target_pos, size_type source_pos, size_type len) {
@@ -96,7 +189,7 @@ namespace wiselib {
 				return (bits + 7) / 8;
 			}
 			
-			const char* c_str() { return (const char*)data_; }
+			const char* c_str() { return (const char*)data(); }
 			
 			size_type terminate(size_type idx){
 				size_type zeros = 8;
@@ -111,8 +204,91 @@ namespace wiselib {
 			
 			static size_type byte(size_type pos) { return pos / 8; }
 			static int8_t bit(size_type pos) { return pos % 8; }
+			
+			static size_type ctz(word_t w) {
+			#if defined(__GNUC__)
+				return __builtin_ctzl(w);
+			#else
+				size_type r = 0;
+				for( ; !(w & 1); w >>= 1) { r++; }
+				return r;
+			#endif
+			}
+			
+			static size_type popcount(word_t w) {
+			#if defined(__GNUC__)
+				return __builtin_popcountl(w);
+			#else
+				size_type r = 0;
+				for( ; w; w &= w - 1) { r++; }
+				return r;
+			#endif
+			}
+			
+			/// position of the set bit with rank k in w
+			static size_type select_in_word(word_t w, size_type k) {
+				for( ; k; k--) { w &= w - 1; }
+				return ctz(w);
+			}
+			
 		private:
-			block_data_t data_[0];
+			struct And { template<typename T> static T apply(T a, T b) { return a & b; } };
+			struct Or { template<typename T> static T apply(T a, T b) { return a | b; } };
+			struct Xor { template<typename T> static T apply(T a, T b) { return a ^ b; } };
+			
+			/**
+			 * The bits start at the object's address (make() allocates
+			 * exactly the bytes needed, StaticBitArray has its buffer in
+			 * the empty base's place). Not a zero length member array, so
+			 * the compiler does not take it to be 0 bytes large.
+			 */
+			block_data_t* data() { return reinterpret_cast<block_data_t*>(this); }
+			const block_data_t* data() const { return reinterpret_cast<const block_data_t*>(this); }
+			
+			/**
+			 * The word starting at byte b, bytes from end_byte on read as
+			 * 0.
+			 */
+			word_t load_word(size_type b, size_type end_byte) {
+				word_t w = 0;
+			#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+				if(b + WORD_BYTES <= end_byte) {
+					memcpy(&w, data() + b, WORD_BYTES);
+					return w;
+				}
+			#endif
+				for(size_type i = 0; i < WORD_BYTES && b + i < end_byte; i++) {
+					w |= (word_t)data()[b + i] << (8 * i);
+				}
+				return w;
+			}
+			
+			template<typename Op>
+			void combine(const BitArray& other, size_type bits) {
+				size_type n = bytes_needed(bits);
+				size_type i = 0;
+			#if WISELIB_BIT_ARRAY_VECTORIZED
+				typedef block_data_t vector_t __attribute__((vector_size(16)));
+				for( ; i + sizeof(vector_t) <= n; i += sizeof(vector_t)) {
+					vector_t a, b;
+					memcpy(&a, data() + i, sizeof(a));
+					memcpy(&b, other.data() + i, sizeof(b));
+					a = Op::apply(a, b);
+					memcpy(data() + i, &a, sizeof(a));
+				}
+			#endif
+				for( ; i + WORD_BYTES <= n; i += WORD_BYTES) {
+					word_t a, b;
+					memcpy(&a, data() + i, sizeof(a));
+					memcpy(&b, other.data() + i, sizeof(b));
+					a = Op::apply(a, b);
+					memcpy(data() + i, &a, sizeof(a));
+				}
+				for( ; i < n; i++) {
+					data()[i] = Op::apply(data()[i], other.data()[i]);
+				}
+			}
+			
 	};
 	
 	template<
@@ -124,6 +300,74 @@ namespace wiselib {
 			typename BitArray<OsModel_P>::block_data_t buffer_[DivCeil<BITS_P, 8>::value];
 	};
 	
+	/**
+	 * Rank / select index for the first MAX_BITS_P bits of a BitArray:
+	 * the number of set bits before every SAMPLE_BITS_P-th position.
+	 * rank() then counts at most SAMPLE_BITS_P bits, select() does a
+	 * binary search over the samples first.
+	 * The index has to be rebuilt after the bit array changes.
+	 */
+	template<
+		typename OsModel_P,
+		size_t MAX_BITS_P,
+		size_t SAMPLE_BITS_P = 512
+	>
+	class BitArrayRankIndex {
+		public:
+			typedef OsModel_P OsModel;
+			typedef BitArray<OsModel> bitarray_t;
+			typedef typename OsModel::size_t size_type;
+			
+			enum {
+				npos = bitarray_t::npos,
+				SAMPLE_BITS = SAMPLE_BITS_P,
+				SAMPLES = DivCeil<MAX_BITS_P, SAMPLE_BITS_P>::value + 1
+			};
+			
+			BitArrayRankIndex() : array_(0), bits_(0) {
+			}
+			
+			void build(bitarray_t *array, size_type bits) {
+				array_ = array;
+				bits_ = bits;
+				samples_[0] = 0;
+				size_type s = 1;
+				for(size_type pos = 0; pos < bits; pos += SAMPLE_BITS, s++) {
+					size_type end = (bits - pos < SAMPLE_BITS) ? bits : pos + SAMPLE_BITS;
+					samples_[s] = samples_[s - 1] + array->count(pos, end);
+				}
+				samples_used_ = s;
+			}
+			
+			/// number of set bits before pos
+			size_type rank(size_type pos) {
+				size_type s = pos / SAMPLE_BITS;
+				return samples_[s] + array_->count(s * SAMPLE_BITS, pos);
+			}
+			
+			/// position of the set bit with rank k, npos if there is none
+			size_type select(size_type k) {
+				if(k >= samples_[samples_used_ - 1]) { return npos; }
+				// last sample with at most k set bits before it
+				size_type lo = 0, hi = samples_used_ - 1;
+				while(hi - lo > 1) {
+					size_type mid = (lo + hi) / 2;
+					if(samples_[mid] <= k) { lo = mid; }
+					else { hi = mid; }
+				}
+				return array_->select(k - samples_[lo], lo * SAMPLE_BITS, bits_);
+			}
+			
+			/// total number of set bits
+			size_type count() { return samples_[samples_used_ - 1]; }
+			
+		private:
+			bitarray_t *array_;
+			size_type bits_;
+			size_type samples_used_;
+			size_type samples_[SAMPLES];
+	};
+	
 }
 
 #endif // BITARRAY_H
@@ -0,0 +1,270 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+namespace wiselib {
+	
+	namespace IndexedHeap_detail {
+		template<typename V_>
+		int compare_obvious(V_& a, V_& b) {
+			return a < b ? -1 : b < a;
+		}
+		
+		/**
+		 * Heap entry, the value is stored next to its handle so sifting
+		 * does not need an indirection per comparison.
+		 */
+		template<typename Value_P, typename Handle_P>
+		struct Node {
+			Value_P value;
+			Handle_P handle;
+		};
+	}
+	
+	/**
+	 * @brief 4-ary min-heap with stable handles.
+	 * 
+	 * push() returns a handle that stays valid (and refers to the same
+	 * element) until the element is popped or erased, so priorities can be
+	 * changed in place with decrease_key() / increase_key() / update()
+	 * instead of removing and reinserting.
+	 * Handles of removed elements are reused by later push()es.
+	 * 
+	 * Values are kept in the heap array together with their handle, a
+	 * second array maps handles to heap positions. A 4-ary heap has half
+	 * the depth of a binary one and the 4 children of a node are adjacent
+	 * in memory.
+	 * 
+	 * Define INDEXED_HEAP_CHECK to 1 to verify the heap (with assert())
+	 * after every modification.
+	 * 
+	 * Use indexed_priority_queue (static, in priority_queue.h) or
+	 * IndexedPriorityQueueDynamic (in priority_queue_dynamic.h) rather
+	 * than this class directly.
+	 * 
+	 * @tparam HandleContainer_P vector-like container of size_type
+	 * @tparam NodeContainer_P vector-like container of
+	 *   IndexedHeap_detail::Node<Value_P, size_type>
+	 * @tparam CAPACITY_P Maximum number of elements, 0 = unlimited.
+	 */
+	template<
+		typename OsModel_P,
+		typename Value_P,
+		typename HandleContainer_P,
+		typename NodeContainer_P,
+		int (*Compare_P)(Value_P&, Value_P&) = &IndexedHeap_detail::compare_obvious<Value_P>,
+		int CAPACITY_P = 0
+	>
+	class IndexedHeap {
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::size_t size_type;
+			typedef Value_P value_type;
+			typedef size_type handle_type;
+			typedef IndexedHeap_detail::Node<value_type, handle_type> node_type;
+			
+			enum { ARITY = 4, CAPACITY = CAPACITY_P };
+			enum { NO_HANDLE = (size_type)(-1) };
+			
+			
+			/**
+			 * @return handle of the new element or NO_HANDLE if the heap
+			 * is full.
+			 */
+			handle_type push(const value_type& v) {
+				handle_type h;
+				node_type n;
+				if(free_.size()) {
+					h = free_[free_.size() - 1];
+					free_.pop_back();
+				}
+				else {
+					if(CAPACITY != 0 && position_.size() >= (size_type)CAPACITY) { return NO_HANDLE; }
+					h = position_.size();
+					position_.push_back(0);
+				}
+				n.value = v;
+				n.handle = h;
+				heap_.push_back(n);
+				sift_up(heap_.size() - 1, n);
+				check_heap();
+				return h;
+			}
+			
+			value_type& top() { return heap_[0].value; }
+			handle_type top_handle() { return heap_[0].handle; }
+			
+			value_type pop() {
+				assert(heap_.size() > 0);
+				value_type r = heap_[0].value;
+				erase(heap_[0].handle);
+				return r;
+			}
+			
+			/**
+			 * Value of the element with handle h.
+			 * Do not modify its priority through the reference, use
+			 * update() and friends for that.
+			 */
+			value_type& operator[](handle_type h) { return heap_[position_[h]].value; }
+			
+			bool contains(handle_type h) {
+				return h < position_.size() && position_[h] != (size_type)NO_HANDLE;
+			}
+			
+			/**
+			 * Replace the value of h by v which must not be larger.
+			 */
+			void decrease_key(handle_type h, const value_type& v) {
+				node_type n;
+				n.value = v;
+				n.handle = h;
+				sift_up(position_[h], n);
+				check_heap();
+			}
+			
+			/**
+			 * Replace the value of h by v which must not be smaller.
+			 */
+			void increase_key(handle_type h, const value_type& v) {
+				node_type n;
+				n.value = v;
+				n.handle = h;
+				sift_down(position_[h], n);
+				check_heap();
+			}
+			
+			/**
+			 * Replace the value of h by v.
+			 */
+			void update(handle_type h, const value_type& v) {
+				node_type n;
+				n.value = v;
+				n.handle = h;
+				restore(position_[h], n);
+				check_heap();
+			}
+			
+			void erase(handle_type h) {
+				size_type p = position_[h];
+				position_[h] = NO_HANDLE;
+				free_.push_back(h);
+				node_type last = heap_[heap_.size() - 1];
+				heap_.pop_back();
+				if(p != heap_.size()) {
+					restore(p, last);
+				}
+				check_heap();
+			}
+			
+			void clear() {
+				for(size_type i = 0; i < heap_.size(); i++) {
+					position_[heap_[i].handle] = NO_HANDLE;
+					free_.push_back(heap_[i].handle);
+				}
+				heap_.clear();
+			}
+			
+			size_type size() { return heap_.size(); }
+			bool empty() { return heap_.size() == 0; }
+			
+		private:
+			static bool less(value_type& a, value_type& b) {
+				return Compare_P(a, b) < 0;
+			}
+			
+			static size_type parent(size_type p) { return (p - 1) / ARITY; }
+			static size_type first_child(size_type p) { return ARITY * p + 1; }
+			
+			void place(size_type p, const node_type& n) {
+				heap_[p] = n;
+				position_[n.handle] = p;
+			}
+			
+			/**
+			 * Put n into the hole at p and move it up or down.
+			 */
+			void restore(size_type p, node_type& n) {
+				if(p > 0 && less(n.value, heap_[parent(p)].value)) {
+					sift_up(p, n);
+				}
+				else {
+					sift_down(p, n);
+				}
+			}
+			
+			void sift_up(size_type p, node_type& n) {
+				while(p > 0) {
+					size_type q = parent(p);
+					if(!less(n.value, heap_[q].value)) { break; }
+					place(p, heap_[q]);
+					p = q;
+				}
+				place(p, n);
+			}
+			
+			void sift_down(size_type p, node_type& n) {
+				size_type size = heap_.size();
+				for(size_type c = first_child(p); c < size; c = first_child(p)) {
+					size_type end = c + ARITY;
+					if(end > size) { end = size; }
+					size_type min = c;
+					for(c++; c < end; c++) {
+						if(less(heap_[c].value, heap_[min].value)) { min = c; }
+					}
+					if(!less(heap_[min].value, n.value)) { break; }
+					place(p, heap_[min]);
+					p = min;
+				}
+				place(p, n);
+			}
+			
+#if INDEXED_HEAP_CHECK
+			/**
+			 * Check the heap order, the handle -> position mapping and
+			 * that every handle is either in the heap or free. Linear in
+			 * the size of the heap.
+			 */
+			void check_heap() {
+				for(size_type p = 0; p < heap_.size(); p++) {
+					assert(p == 0 || !less(heap_[p].value, heap_[parent(p)].value));
+					assert(position_[heap_[p].handle] == p);
+				}
+				for(size_type i = 0; i < free_.size(); i++) {
+					assert(position_[free_[i]] == (size_type)NO_HANDLE);
+				}
+				assert(heap_.size() + free_.size() == position_.size());
+			}
+#else
+			void check_heap() { }
+#endif // INDEXED_HEAP_CHECK
+			
+			NodeContainer_P heap_;
+			/// handle -> position in heap_ or NO_HANDLE
+			HandleContainer_P position_;
+			/// handles of erased elements, reused by push()
+			HandleContainer_P free_;
+		
+	}; // IndexedHeap
+}
+
+#endif // INDEXED_HEAP_H
+
@@ -256,7 +256,7 @@ void __advance(RandomAccessIterator& i, Distance n, random_access_iterator_tag)
 
 template<class InputIterator, class Distance>
 void advance(InputIterator& i, Distance n) {
-	__advance(i, n,
+	wiselib::__advance(i, n,
 			typename iterator_traits<InputIterator>::iterator_category());
 }
 
@@ -279,7 +279,7 @@ typename iterator_traits<RandomAccessIterator>::difference_type distance(
 template<class InputIterator>
 typename iterator_traits<InputIterator>::difference_type distance(
 		InputIterator first, InputIterator last) {
-	__distance(first, last,
+	return wiselib::distance(first, last,
 			typename iterator_traits<InputIterator>::iterator_category());
 }
 
@@ -0,0 +1,997 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef __WISELIB_UTIL_PSTL_LIST_CHUNKED_H
+#define __WISELIB_UTIL_PSTL_LIST_CHUNKED_H
+
+#include "util/pstl/list_static.h"
+#include "util/pstl/reverse_iterator.h"
+
+namespace wiselib {
+
+	/**
+	 * Chunk of a list_chunked: ring buffer of count_ elements (together
+	 * with their handles) from slot first_ on.
+	 */
+	template<typename Value_P, list_size_t ChunkSize_P>
+	struct list_chunk {
+		/// Slot of the element at index i.
+		list_size_t slot(list_size_t i) const { return (first_ + i) & (ChunkSize_P - 1); }
+
+		Value_P items_[ChunkSize_P];
+		list_size_t ids_[ChunkSize_P];
+		list_chunk *prev_;
+		list_chunk *next_;
+		list_size_t first_;
+		list_size_t count_;
+	};
+
+	/**
+	 * Chunks and handle table of one or more list_chunked.
+	 * Lists on the same storage can splice in constant time, see
+	 * list_chunked_pool for how to create one.
+	 */
+	template<typename Value_P, list_size_t ChunkSize_P>
+	class list_chunked_storage {
+		public:
+			typedef list_chunk<Value_P, ChunkSize_P> chunk_type;
+
+			enum { NO_SLOT = 0xff };
+
+			/// Elements that fit into all chunks.
+			list_size_t capacity() const { return chunks_count_ * ChunkSize_P; }
+
+			/// Elements stored in all lists using this storage.
+			list_size_t used() const { return used_; }
+
+			bool full() const { return used_ >= capacity(); }
+
+			/// Chunks not used by any list.
+			list_size_t free_chunks() const {
+				list_size_t r = 0;
+				for(chunk_type *c = free_chunks_; c; c = c->next_) { r++; }
+				return r;
+			}
+
+			chunk_type* get_chunk() {
+				chunk_type *c = free_chunks_;
+				if(c) {
+					free_chunks_ = c->next_;
+					c->prev_ = 0;
+					c->next_ = 0;
+					c->first_ = 0;
+					c->count_ = 0;
+				}
+				return c;
+			}
+
+			void put_chunk(chunk_type *c) {
+				c->next_ = free_chunks_;
+				free_chunks_ = c;
+			}
+
+			/**
+			 * Only call when there is a free slot in some chunk
+			 * (then there also is a free handle).
+			 */
+			list_size_t get_handle() {
+				list_size_t h = free_handles_;
+				free_handles_ = handle_chunk_[h];
+				used_++;
+				return h;
+			}
+
+			void put_handle(list_size_t h) {
+				handle_chunk_[h] = free_handles_;
+				handle_slot_[h] = NO_SLOT;
+				free_handles_ = h;
+				used_--;
+			}
+
+			/// Record that the element in slot i of c (and its handle) is there now.
+			void place(chunk_type *c, list_size_t i) {
+				list_size_t h = c->ids_[i];
+				handle_chunk_[h] = c - chunks_;
+				handle_slot_[h] = i;
+			}
+
+			bool valid(list_size_t h) const {
+				return h >= 0 && h < capacity() && handle_slot_[h] != NO_SLOT;
+			}
+
+			chunk_type* handle_chunk(list_size_t h) const { return chunks_ + handle_chunk_[h]; }
+			list_size_t handle_slot(list_size_t h) const { return handle_slot_[h]; }
+
+		protected:
+			list_chunked_storage() { }
+
+			void init(chunk_type *chunks, list_size_t chunks_count, list_size_t *handle_chunk, unsigned char *handle_slot) {
+				chunks_ = chunks;
+				chunks_count_ = chunks_count;
+				handle_chunk_ = handle_chunk;
+				handle_slot_ = handle_slot;
+				used_ = 0;
+
+				free_chunks_ = 0;
+				for(list_size_t i = chunks_count; i > 0; i--) {
+					put_chunk(chunks_ + i - 1);
+				}
+				free_handles_ = -1;
+				for(list_size_t h = capacity(); h > 0; h--) {
+					handle_chunk_[h - 1] = free_handles_;
+					handle_slot_[h - 1] = NO_SLOT;
+					free_handles_ = h - 1;
+				}
+			}
+
+		private:
+			list_chunked_storage(const list_chunked_storage&);
+			list_chunked_storage& operator=(const list_chunked_storage&);
+
+			chunk_type *chunks_;
+			chunk_type *free_chunks_;
+			list_size_t *handle_chunk_;
+			unsigned char *handle_slot_;
+			list_size_t chunks_count_;
+			list_size_t free_handles_;
+			list_size_t used_;
+	};
+
+	/**
+	 * Storage for Capacity_P elements (rounded up to whole chunks).
+	 * Every list_chunked has one of these for itself, a separate one
+	 * can be shared by several lists:
+	 *
+	 * @code
+	 * list_chunked_pool<Os, Message, 64> pool;
+	 * list_chunked<Os, Message, 0> sent(pool), received(pool);
+	 * @endcode
+	 */
+	template<typename OsModel_P, typename Value_P, list_size_t Capacity_P, list_size_t ChunkSize_P = 8>
+	class list_chunked_pool : public list_chunked_storage<Value_P, ChunkSize_P> {
+		public:
+			typedef list_chunked_storage<Value_P, ChunkSize_P> storage_type;
+			typedef typename storage_type::chunk_type chunk_type;
+
+			enum {
+				CHUNKS = (Capacity_P > 0) ? (Capacity_P + ChunkSize_P - 1) / ChunkSize_P : 1
+			};
+
+			list_chunked_pool() {
+				this->init(chunks_, CHUNKS, handle_chunk_, handle_slot_);
+			}
+
+		private:
+			chunk_type chunks_[CHUNKS];
+			list_size_t handle_chunk_[CHUNKS * ChunkSize_P];
+			unsigned char handle_slot_[CHUNKS * ChunkSize_P];
+	};
+
+	/**
+	 * Unrolled replacement for list_static: elements are kept in chunks of
+	 * ChunkSize_P consecutive slots, so traversal touches one cache line
+	 * (and one pointer) per chunk instead of per element and a node costs
+	 * no link pointers.
+	 *
+	 * Has the interface of list_static, plus
+	 *  - splice() in O(ChunkSize_P) between lists on the same storage
+	 *    (list_chunked_pool), elementwise otherwise,
+	 *  - insert_range() and erase_if() which work chunk- rather than
+	 *    element-wise,
+	 *  - handles: small integers that identify an element for as long as it
+	 *    is in the list (on the same storage), see insert_handle(),
+	 *    handle() and find_handle().
+	 *
+	 * Unlike list_static, elements move in memory (within their chunk and
+	 * between neighbouring chunks): insert() and erase() invalidate
+	 * iterators and pointers to elements. Use the iterator returned by
+	 * erase() instead of erase(it++) and handles instead of pointers to
+	 * keep track of elements.
+	 *
+	 * When a full chunk needs to be split and the storage has no free
+	 * chunk, elements are shifted into a neighbour chunk or the list is
+	 * compacted, so an own-storage list holds up to max_size() elements.
+	 *
+	 * ListSize_P is the size of the own storage, may be 0 for lists that
+	 * are always constructed with a shared storage. ChunkSize_P must be a
+	 * power of two (chunks are ring buffers) of at most 128.
+	 */
+	template<typename OsModel_P, typename Value_P, list_size_t ListSize_P, list_size_t ChunkSize_P = 8>
+	class list_chunked {
+		public:
+			typedef OsModel_P OsModel;
+			typedef Value_P value_type;
+			typedef value_type* pointer;
+			typedef value_type& reference;
+			typedef list_chunked<OsModel_P, Value_P, ListSize_P, ChunkSize_P> list_type;
+			typedef list_chunked_storage<Value_P, ChunkSize_P> storage_type;
+			typedef list_chunked_pool<OsModel_P, Value_P, ListSize_P, ChunkSize_P> pool_type;
+			typedef typename storage_type::chunk_type chunk_type;
+			typedef list_size_t handle_t;
+
+			enum { CHUNK_SIZE = ChunkSize_P };
+			enum { NO_HANDLE = -1 };
+
+			class iterator {
+				public:
+					typedef list_size_t difference_type;
+					typedef Value_P value_type;
+					typedef value_type* pointer;
+					typedef value_type& reference;
+
+					iterator() : list_(0), chunk_(0), index_(0) { }
+
+					reference operator*() const { return chunk_->items_[chunk_->slot(index_)]; }
+					pointer operator->() const { return &chunk_->items_[chunk_->slot(index_)]; }
+
+					iterator& operator++() {
+						if(++index_ >= chunk_->count_) {
+							chunk_ = chunk_->next_;
+							index_ = 0;
+						}
+						return *this;
+					}
+
+					iterator operator++(int) {
+						iterator tmp = *this;
+						++*this;
+						return tmp;
+					}
+
+					/// Like in list_static, end() comes before begin().
+					iterator& operator--() {
+						if(!chunk_) {
+							chunk_ = list_->tail_;
+							index_ = chunk_ ? chunk_->count_ - 1 : 0;
+						}
+						else if(index_ == 0) {
+							chunk_ = chunk_->prev_;
+							index_ = chunk_ ? chunk_->count_ - 1 : 0;
+						}
+						else {
+							index_--;
+						}
+						return *this;
+					}
+
+					iterator operator--(int) {
+						iterator tmp = *this;
+						--*this;
+						return tmp;
+					}
+
+					bool operator==(const iterator& other) const {
+						return chunk_ == other.chunk_ && index_ == other.index_;
+					}
+
+					bool operator!=(const iterator& other) const { return !(*this == other); }
+
+				private:
+					iterator(const list_type *list, chunk_type *chunk, list_size_t index)
+						: list_(list), chunk_(chunk), index_(index) {
+					}
+
+					const list_type *list_;
+					chunk_type *chunk_;
+					list_size_t index_;
+
+				friend class list_chunked;
+			};
+
+			typedef reverse_iterator<iterator> riterator;
+
+			/// List on its own storage.
+			list_chunked() : storage_(&pool_), head_(0), tail_(0), size_(0) {
+			}
+
+			/// List on a (shared) storage.
+			explicit list_chunked(storage_type& storage) : storage_(&storage), head_(0), tail_(0), size_(0) {
+			}
+
+			/// The copy uses the same storage if it is shared.
+			list_chunked(const list_chunked& other)
+				: storage_(other.storage_ == &other.pool_ ? &pool_ : other.storage_), head_(0), tail_(0), size_(0) {
+				insert_range(end(), other.begin(), other.end());
+			}
+
+			~list_chunked() {
+				clear();
+			}
+
+			list_chunked& operator=(const list_chunked& other) {
+				if(&other != this) {
+					clear();
+					insert_range(end(), other.begin(), other.end());
+				}
+				return *this;
+			}
+
+			/**
+			 * Move the (empty) list to another storage.
+			 */
+			void set_storage(storage_type& storage) {
+				clear();
+				storage_ = &storage;
+			}
+
+			storage_type& storage() { return *storage_; }
+
+			///@name Iterators
+			///@{
+			iterator begin() const { return iterator(this, head_, 0); }
+			iterator end() const { return iterator(this, 0, 0); }
+
+			riterator rbegin() const {
+				iterator tmp = end();
+				--tmp;
+				return riterator(tmp);
+			}
+
+			riterator rend() const { return riterator(end()); }
+			///@}
+
+			///@name Capacity
+			///@{
+			bool empty() const { return size_ == 0; }
+			bool full() const { return storage_->full(); }
+			list_size_t size() const { return size_; }
+			list_size_t max_size() const { return storage_->capacity(); }
+			///@}
+
+			///@name Element Access
+			///@{
+			value_type& front() { return head_->items_[head_->first_]; }
+			const value_type& front() const { return head_->items_[head_->first_]; }
+			value_type& back() { return tail_->items_[tail_->slot(tail_->count_ - 1)]; }
+			const value_type& back() const { return tail_->items_[tail_->slot(tail_->count_ - 1)]; }
+			///@}
+
+			///@name Handles
+			///@{
+			handle_t handle(iterator position) const {
+				return position.chunk_->ids_[position.chunk_->slot(position.index_)];
+			}
+
+			/**
+			 * @return true if h is the handle of an element in a list on
+			 * this storage.
+			 */
+			bool valid(handle_t h) const { return storage_->valid(h); }
+
+			/// Only for valid handles of elements in this list.
+			iterator find_handle(handle_t h) const {
+				chunk_type *c = storage_->handle_chunk(h);
+				return iterator(this, c, (storage_->handle_slot(h) - c->first_) & (ChunkSize_P - 1));
+			}
+
+			value_type& get(handle_t h) {
+				return storage_->handle_chunk(h)->items_[storage_->handle_slot(h)];
+			}
+			///@}
+
+			///@name Modifiers
+			///@{
+
+			/**
+			 * Insert x before position.
+			 * @return handle of the new element or NO_HANDLE if there is no
+			 * space left.
+			 */
+			handle_t insert_handle(iterator position, const value_type& x) {
+				if(storage_->full()) {
+					return NO_HANDLE;
+				}
+
+				// x may be an element of this list that is moved below
+				value_type v(x);
+
+				chunk_type *c = position.chunk_;
+				list_size_t i = position.index_;
+
+				if(c == 0) {
+					// at the end
+					c = tail_;
+					if(c == 0 || c->count_ == ChunkSize_P) {
+						chunk_type *n = storage_->get_chunk();
+						if(n) {
+							link_after(tail_, n);
+							c = n;
+						}
+						else if(c == 0) {
+							return NO_HANDLE;
+						}
+					}
+					i = c->count_;
+				}
+				else if(i == 0 && c->prev_ && c->prev_->count_ < ChunkSize_P) {
+					// append to the predecessor instead of shifting
+					c = c->prev_;
+					i = c->count_;
+				}
+
+				if(c->count_ == ChunkSize_P) {
+					chunk_type *n = storage_->get_chunk();
+					if(n) {
+						split(c, ChunkSize_P / 2, n);
+						if(i > ChunkSize_P / 2) {
+							c = n;
+							i -= ChunkSize_P / 2;
+						}
+					}
+					else if(!make_room(c, i)) {
+						// the free slots are in other lists on the storage
+						return NO_HANDLE;
+					}
+				}
+
+				list_size_t slot = open_slot(c, i);
+				handle_t h = storage_->get_handle();
+				c->items_[slot] = v;
+				c->ids_[slot] = h;
+				storage_->place(c, slot);
+				size_++;
+				return h;
+			}
+
+			/// insert x before position, false if there is no space left
+			bool insert(iterator position, const value_type& x) {
+				return insert_handle(position, x) != NO_HANDLE;
+			}
+
+			/// insert n copies of x before position
+			void insert(iterator position, list_size_t n, const value_type& x) {
+				value_type v(x);
+				insert_range(position, repeat_iterator(&v, 0), repeat_iterator(&v, n));
+			}
+
+			/**
+			 * Copy [first, last) before position.
+			 * @return true if all elements have been inserted
+			 */
+			template<typename InputIterator_P>
+			bool insert(iterator position, InputIterator_P first, InputIterator_P last) {
+				list_size_t n = 0;
+				for(InputIterator_P it = first; it != last; ++it) {
+					n++;
+				}
+				return insert_range(position, first, last) == n;
+			}
+
+			/**
+			 * Copy [first, last) before position, filling whole chunks at a
+			 * time.
+			 * @return number of elements inserted (less than in the range if
+			 * the storage is full)
+			 */
+			template<typename InputIterator_P>
+			list_size_t insert_range(iterator position, InputIterator_P first, InputIterator_P last) {
+				list_size_t inserted = 0;
+				chunk_type *c = 0;
+				bool chunkwise = true;
+
+				// the new elements go after c (at the front if 0)
+				if(position.chunk_ == 0) {
+					c = tail_;
+				}
+				else if(position.index_ == 0) {
+					c = position.chunk_->prev_;
+				}
+				else {
+					chunk_type *n = storage_->get_chunk();
+					if(n) {
+						split(position.chunk_, position.index_, n);
+						c = position.chunk_;
+					}
+					else {
+						chunkwise = false;
+					}
+				}
+
+				if(chunkwise) {
+					for( ; first != last; ++first) {
+						if(c == 0 || c->count_ == ChunkSize_P) {
+							chunk_type *n = storage_->get_chunk();
+							if(n == 0) {
+								break;
+							}
+							link_after(c, n);
+							c = n;
+						}
+						list_size_t i = c->slot(c->count_);
+						c->items_[i] = *first;
+						c->ids_[i] = storage_->get_handle();
+						storage_->place(c, i);
+						c->count_++;
+						size_++;
+						inserted++;
+					}
+					if(!(first != last)) {
+						return inserted;
+					}
+					position = iterator(this, c ? c->next_ : head_, 0);
+				}
+
+				// out of chunks: one by one
+				list_size_t at = index_of(position);
+				for( ; first != last; ++first) {
+					if(insert_handle(at_index(at), *first) == NO_HANDLE) {
+						break;
+					}
+					at++;
+					inserted++;
+				}
+				return inserted;
+			}
+
+			bool push_back(const value_type& x) { return insert(end(), x); }
+			bool push_front(const value_type& x) { return insert(begin(), x); }
+
+			/// removes last element
+			bool pop_back() {
+				if(empty()) {
+					return false;
+				}
+				erase(--end());
+				return true;
+			}
+
+			/// removes first element
+			bool pop_front() {
+				if(empty()) {
+					return false;
+				}
+				erase(begin());
+				return true;
+			}
+
+			/**
+			 * Remove the element at position.
+			 * @return iterator to the element after it
+			 */
+			iterator erase(iterator position) {
+				chunk_type *c = position.chunk_;
+				list_size_t i = position.index_;
+
+				storage_->put_handle(c->ids_[c->slot(i)]);
+				close_slot(c, i);
+				size_--;
+
+				if(c->count_ == 0) {
+					chunk_type *n = c->next_;
+					unlink(c);
+					storage_->put_chunk(c);
+					return iterator(this, n, 0);
+				}
+
+				// merge sparse neighbours (leaving some room for inserts)
+				if(c->next_ && c->count_ + c->next_->count_ <= MERGE_LIMIT) {
+					merge(c, c->next_);
+				}
+				else if(c->prev_ && c->prev_->count_ + c->count_ <= MERGE_LIMIT) {
+					chunk_type *p = c->prev_;
+					i += p->count_;
+					merge(p, c);
+					c = p;
+				}
+
+				if(i < c->count_) {
+					return iterator(this, c, i);
+				}
+				return iterator(this, c->next_, 0);
+			}
+
+			/// remove [first, last)
+			void erase(iterator first, iterator last) {
+				for(list_size_t n = index_of(last) - index_of(first); n > 0; n--) {
+					first = erase(first);
+				}
+			}
+
+			/**
+			 * Remove all elements for which pred(element) is true in one
+			 * pass, leaving the remaining ones in full chunks.
+			 * @return number of elements removed
+			 */
+			template<typename Predicate_P>
+			list_size_t erase_if(Predicate_P pred) {
+				bool freed;
+				return filter(pred, freed);
+			}
+
+			/// remove every element with given value
+			void remove(const value_type& value) {
+				equal_to pred(value);
+				erase_if(pred);
+			}
+
+			/**
+			 * Remove every but the first occurrence in a consecutive set of
+			 * elements with the same value.
+			 */
+			void unique() {
+				duplicate pred;
+				erase_if(pred);
+			}
+
+			/// reverse order of list elements
+			void reverse() {
+				if(size_ < 2) {
+					return;
+				}
+				iterator a = begin(), b = end();
+				--b;
+				for(list_size_t k = size_ / 2; k > 0; k--) {
+					swap(a, b);
+					++a;
+					--b;
+				}
+			}
+
+			/**
+			 * Move all elements of l before position.
+			 *
+			 * If l is on the same storage, this relinks l's chunks (and
+			 * splits at most the chunk at position), handles stay valid.
+			 * Otherwise elements are copied as long as there is space.
+			 */
+			void splice(iterator position, list_type& l) {
+				if(&l == this || l.empty()) {
+					return;
+				}
+
+				if(l.storage_ == storage_) {
+					chunk_type *before = 0;
+					bool linkable = true;
+
+					if(position.chunk_ == 0) {
+						before = tail_;
+					}
+					else if(position.index_ == 0) {
+						before = position.chunk_->prev_;
+					}
+					else {
+						chunk_type *n = storage_->get_chunk();
+						if(n) {
+							split(position.chunk_, position.index_, n);
+							before = position.chunk_;
+						}
+						else {
+							linkable = false;
+						}
+					}
+
+					if(linkable) {
+						chunk_type *after = before ? before->next_ : head_;
+						l.head_->prev_ = before;
+						l.tail_->next_ = after;
+						if(before) { before->next_ = l.head_; }
+						else { head_ = l.head_; }
+						if(after) { after->prev_ = l.tail_; }
+						else { tail_ = l.tail_; }
+						size_ += l.size_;
+						l.head_ = 0;
+						l.tail_ = 0;
+						l.size_ = 0;
+						return;
+					}
+				}
+
+				for(list_size_t n = insert_range(position, l.begin(), l.end()); n > 0; n--) {
+					l.pop_front();
+				}
+			}
+
+			/// Move the element at it from l to before position.
+			void splice(iterator position, list_type& l, iterator it) {
+				if(&l != this && insert(position, *it)) {
+					l.erase(it);
+				}
+			}
+
+			/// remove all elements
+			void clear() {
+				while(head_) {
+					chunk_type *n = head_->next_;
+					for(list_size_t j = 0; j < head_->count_; j++) {
+						storage_->put_handle(head_->ids_[head_->slot(j)]);
+					}
+					storage_->put_chunk(head_);
+					head_ = n;
+				}
+				tail_ = 0;
+				size_ = 0;
+			}
+
+			/**
+			 * Fill all chunks, give the empty ones back to the storage.
+			 * @return true if a chunk has been freed
+			 */
+			bool compact() {
+				never pred;
+				bool freed;
+				filter(pred, freed);
+				return freed;
+			}
+			///@}
+
+			/// Position of an iterator from the front, O(chunks).
+			list_size_t index_of(iterator position) const {
+				list_size_t r = 0;
+				for(chunk_type *c = head_; c != position.chunk_; c = c->next_) {
+					r += c->count_;
+				}
+				return r + position.index_;
+			}
+
+			/// Iterator to the element at index i, O(chunks).
+			iterator at_index(list_size_t i) const {
+				chunk_type *c = head_;
+				for( ; c && i >= c->count_; c = c->next_) {
+					i -= c->count_;
+				}
+				return iterator(this, c, c ? i : 0);
+			}
+
+		private:
+			enum { MERGE_LIMIT = ChunkSize_P - ChunkSize_P / 4 };
+
+			typedef char chunk_size_must_be_a_power_of_two[
+				((ChunkSize_P & (ChunkSize_P - 1)) == 0 && ChunkSize_P <= 128) ? 1 : -1];
+
+			/// Yields *v n times (for insert(position, n, x)).
+			class repeat_iterator {
+				public:
+					repeat_iterator(const value_type *v, list_size_t i) : v_(v), i_(i) { }
+					const value_type& operator*() const { return *v_; }
+					repeat_iterator& operator++() { i_++; return *this; }
+					bool operator!=(const repeat_iterator& other) const { return i_ != other.i_; }
+				private:
+					const value_type *v_;
+					list_size_t i_;
+			};
+
+			struct never {
+				bool operator()(const value_type&) { return false; }
+			};
+
+			struct equal_to {
+				equal_to(const value_type& v) : v_(v) { }
+				bool operator()(const value_type& x) { return x == v_; }
+				value_type v_;
+			};
+
+			struct duplicate {
+				duplicate() : first_(true) { }
+				bool operator()(const value_type& x) {
+					if(!first_ && x == last_) {
+						return true;
+					}
+					first_ = false;
+					last_ = x;
+					return false;
+				}
+				bool first_;
+				value_type last_;
+			};
+
+			/// Copy the element in slot si of src to slot di of dst.
+			void move(chunk_type *dst, list_size_t di, chunk_type *src, list_size_t si) {
+				dst->items_[di] = src->items_[si];
+				dst->ids_[di] = src->ids_[si];
+				storage_->place(dst, di);
+			}
+
+			/**
+			 * Make room for a new element at index i of c (which must not be
+			 * full), shifting the shorter side.
+			 * @return slot for the new element
+			 */
+			list_size_t open_slot(chunk_type *c, list_size_t i) {
+				if(i < c->count_ / 2) {
+					c->first_ = (c->first_ - 1) & (ChunkSize_P - 1);
+					for(list_size_t j = 0; j < i; j++) {
+						move(c, c->slot(j), c, c->slot(j + 1));
+					}
+				}
+				else {
+					for(list_size_t j = c->count_; j > i; j--) {
+						move(c, c->slot(j), c, c->slot(j - 1));
+					}
+				}
+				c->count_++;
+				return c->slot(i);
+			}
+
+			/// Close the gap of the removed element at index i of c.
+			void close_slot(chunk_type *c, list_size_t i) {
+				if(i < c->count_ / 2) {
+					for(list_size_t j = i; j > 0; j--) {
+						move(c, c->slot(j), c, c->slot(j - 1));
+					}
+					c->first_ = c->slot(1);
+				}
+				else {
+					for(list_size_t j = i + 1; j < c->count_; j++) {
+						move(c, c->slot(j - 1), c, c->slot(j));
+					}
+				}
+				c->count_--;
+			}
+
+			/**
+			 * Make room for an insert at index i of the full chunk c when
+			 * there are no free chunks: move one element each from c
+			 * towards the nearest chunk that is not full. Updates c and i
+			 * to where the element is to be inserted.
+			 * @return false if all chunks are full
+			 */
+			bool make_room(chunk_type*& c, list_size_t& i) {
+				list_size_t forward = 1;
+				chunk_type *f = c->next_;
+				while(f && f->count_ == ChunkSize_P) {
+					f = f->next_;
+					forward++;
+				}
+
+				// inserting at the front of c can also go to the back of its predecessor
+				chunk_type *t = (i == 0) ? c->prev_ : c;
+				list_size_t backward = 1;
+				chunk_type *b = t ? t->prev_ : 0;
+				while(b && b->count_ == ChunkSize_P) {
+					b = b->prev_;
+					backward++;
+				}
+
+				if(f && (!b || forward <= backward)) {
+					for(chunk_type *e = f; e != c; e = e->prev_) {
+						chunk_type *p = e->prev_;
+						move(e, open_slot(e, 0), p, p->slot(p->count_ - 1));
+						p->count_--;
+					}
+					return true;
+				}
+				if(b) {
+					for(chunk_type *e = b; e != t; e = e->next_) {
+						chunk_type *n = e->next_;
+						move(e, open_slot(e, e->count_), n, n->first_);
+						n->first_ = n->slot(1);
+						n->count_--;
+					}
+					if(t == c) {
+						i--;
+					}
+					else {
+						c = t;
+						i = t->count_;
+					}
+					return true;
+				}
+				return false;
+			}
+
+			void swap(iterator a, iterator b) {
+				list_size_t sa = a.chunk_->slot(a.index_);
+				list_size_t sb = b.chunk_->slot(b.index_);
+				value_type v = a.chunk_->items_[sa];
+				handle_t h = a.chunk_->ids_[sa];
+				move(a.chunk_, sa, b.chunk_, sb);
+				b.chunk_->items_[sb] = v;
+				b.chunk_->ids_[sb] = h;
+				storage_->place(b.chunk_, sb);
+			}
+
+			/// Link n after c (at the front if c is 0).
+			void link_after(chunk_type *c, chunk_type *n) {
+				n->prev_ = c;
+				n->next_ = c ? c->next_ : head_;
+				if(n->next_) { n->next_->prev_ = n; }
+				else { tail_ = n; }
+				if(c) { c->next_ = n; }
+				else { head_ = n; }
+			}
+
+			void unlink(chunk_type *c) {
+				if(c->prev_) { c->prev_->next_ = c->next_; }
+				else { head_ = c->next_; }
+				if(c->next_) { c->next_->prev_ = c->prev_; }
+				else { tail_ = c->prev_; }
+			}
+
+			/// Move the elements from index from on of c into the empty n, link n after c.
+			void split(chunk_type *c, list_size_t from, chunk_type *n) {
+				for(list_size_t j = from; j < c->count_; j++) {
+					move(n, j - from, c, c->slot(j));
+				}
+				n->count_ = c->count_ - from;
+				c->count_ = from;
+				link_after(c, n);
+			}
+
+			/// Append the elements of n (following c) to c and free n.
+			void merge(chunk_type *c, chunk_type *n) {
+				for(list_size_t j = 0; j < n->count_; j++) {
+					move(c, c->slot(c->count_ + j), n, n->slot(j));
+				}
+				c->count_ += n->count_;
+				unlink(n);
+				storage_->put_chunk(n);
+			}
+
+			/**
+			 * Remove the elements pred() is true for, move the others
+			 * forward into full chunks and free the empty chunks at the end.
+			 */
+			template<typename Predicate_P>
+			list_size_t filter(Predicate_P& pred, bool& freed) {
+				// w keeps its first_, so within a chunk writing never
+				// overtakes reading
+				chunk_type *w = head_;
+				list_size_t wi = 0;
+				list_size_t removed = 0;
+
+				for(chunk_type *r = head_; r; ) {
+					chunk_type *next = r->next_;
+					list_size_t count = r->count_;
+					for(list_size_t j = 0; j < count; j++) {
+						list_size_t s = r->slot(j);
+						if(pred(r->items_[s])) {
+							storage_->put_handle(r->ids_[s]);
+							removed++;
+							continue;
+						}
+						if(w != r || wi != j) {
+							move(w, w->slot(wi), r, s);
+						}
+						if(++wi == ChunkSize_P) {
+							w->count_ = ChunkSize_P;
+							w = w->next_;
+							wi = 0;
+						}
+					}
+					r = next;
+				}
+
+				if(w && wi) {
+					w->count_ = wi;
+					w = w->next_;
+				}
+				freed = (w != 0);
+				while(w) {
+					chunk_type *n = w->next_;
+					unlink(w);
+					storage_->put_chunk(w);
+					w = n;
+				}
+				size_ -= removed;
+				return removed;
+			}
+
+			pool_type pool_;
+			storage_type *storage_;
+			chunk_type *head_;
+			chunk_type *tail_;
+			list_size_t size_;
+
+		friend class iterator;
+	};
+}
+
+#endif // __WISELIB_UTIL_PSTL_LIST_CHUNKED_H
+
+
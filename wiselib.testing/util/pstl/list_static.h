@@ -244,7 +244,7 @@ namespace wiselib {
          // skip dummy node
          iterator tmp = begin();
          --tmp;
-         return rterator( tmp );
+         return riterator( tmp );
       }
       ///@}
       // --------------------------------------------------------------------
@@ -381,7 +381,6 @@ namespace wiselib {
             {
                return false;
             }
-            position++;
             it++;
             if ( it == first )
             {
@@ -470,8 +469,8 @@ namespace wiselib {
       {
          while ( !full() && !l.empty() )
          {
-            insert( position, l.pop_front()->elment_ );
-            position++;
+            insert( position, l.front() );
+            l.pop_front();
          }
       }
       // --------------------------------------------------------------------
@@ -20,6 +20,8 @@
 #define __WISELIB_INTERNAL_INTERFACE_STL_PRIORITY_QUEUE_H
 
 #include "util/pstl/iterator.h"
+#include "util/pstl/vector_static.h"
+#include "util/pstl/indexed_heap.h"
 
 namespace wiselib
 {
@@ -91,11 +93,13 @@ namespace wiselib
       // --------------------------------------------------------------------
       void push( const value_type& x )
       {
+         if ( finish_ == end_of_storage_ )
+            return;
          int i = size();
-         while ( i != 0 && x < vec_[i/2] )
+         while ( i != 0 && x < vec_[parent(i)] )
          {
-            vec_[i] = vec_[i/2];
-            i = i/2;
+            vec_[i] = vec_[parent(i)];
+            i = parent(i);
          }
          vec_[i] = x;
          ++finish_;
@@ -109,15 +113,18 @@ namespace wiselib
          --finish_;
          int i = 0;
          int c = 1;
-         while ( c <= n )
+         while ( c < n )
          {
-            if ( c < n && vec_[c + 1] < vec_[c] )
-               ++c;
-            if ( !( vec_[c] < x ) )
+            int m = c;
+            int end = c + ARITY < n ? c + ARITY : n;
+            for ( ++c; c < end; ++c )
+               if ( vec_[c] < vec_[m] )
+                  m = c;
+            if ( !( vec_[m] < x ) )
                break;
-            vec_[i] = vec_[c];
-            i = c;
-            c = 2 * i;
+            vec_[i] = vec_[m];
+            i = m;
+            c = ARITY * i + 1;
          }
          vec_[i] = x;
          return e;
@@ -125,11 +132,34 @@ namespace wiselib
       ///@}
 
    protected:
+      /// 4-ary heap, the children of i are ARITY * i + 1 .. ARITY * i + ARITY
+      enum { ARITY = 4 };
+
+      static int parent( int i )
+      { return (i - 1) / ARITY; }
+
       value_type vec_[QUEUE_SIZE];
 
       pointer start_, finish_, end_of_storage_;
    };
 
+   /**
+    * Static capacity priority queue (min-heap) with stable handles that
+    * supports decrease_key(), increase_key(), update() and erase(),
+    * see IndexedHeap.
+    */
+   template<typename OsModel_P,
+            typename Value_P,
+            int QUEUE_SIZE,
+            int (*Compare_P)(Value_P&, Value_P&) = &IndexedHeap_detail::compare_obvious<Value_P> >
+   class indexed_priority_queue
+      : public IndexedHeap<OsModel_P, Value_P,
+            vector_static<OsModel_P, typename OsModel_P::size_t, QUEUE_SIZE>,
+            vector_static<OsModel_P, IndexedHeap_detail::Node<Value_P, typename OsModel_P::size_t>, QUEUE_SIZE>,
+            Compare_P, QUEUE_SIZE>
+   {
+   };
+
 }
 
 #endif
@@ -21,6 +21,7 @@
 #define PRIORITY_QUEUE_DYNAMIC_H
 
 #include "vector_dynamic.h"
+#include "indexed_heap.h"
 
 namespace wiselib {
 	
@@ -150,6 +151,28 @@ namespace wiselib {
 			Vector vector_;
 		
 	}; // PriorityQueueDynamic
+	
+	/**
+	 * @brief Dynamically growing priority queue (min-heap) with stable
+	 * handles that supports decrease_key(), increase_key(), update() and
+	 * erase(), see IndexedHeap.
+	 * 
+	 * Holds at most 65535 elements (vector_dynamic has 16 bit sizes),
+	 * push() returns NO_HANDLE when full.
+	 */
+	template<
+		typename OsModel_P,
+		typename Value_P,
+		int (*Compare_P)(Value_P&, Value_P&) = &IndexedHeap_detail::compare_obvious<Value_P>
+	>
+	class IndexedPriorityQueueDynamic : public IndexedHeap<
+		OsModel_P, Value_P,
+		vector_dynamic<OsModel_P, typename OsModel_P::size_t>,
+		vector_dynamic<OsModel_P, IndexedHeap_detail::Node<Value_P, typename OsModel_P::size_t> >,
+		Compare_P,
+		0xffff
+	> {
+	}; // IndexedPriorityQueueDynamic
 }
 
 #endif // PRIORITY_QUEUE_DYNAMIC_H
@@ -21,6 +21,8 @@
 #ifndef STRING_DYNAMIC_H
 #define STRING_DYNAMIC_H
 
+#include <util/pstl/string_slice.h>
+
 #ifndef assert
 	#define assert(X)
 #endif
@@ -30,13 +32,20 @@ namespace wiselib {
 	/**
 	 * Dynamic string implementation.
 	 * 
+	 * Strings of up to INLINE_CAPACITY_P characters are stored inside the
+	 * object, longer ones in a buffer from the allocator whose capacity
+	 * grows by a factor of 1.5, so appending n characters one by one
+	 * causes O(log n) allocations.
+	 * The content is always '\0'-terminated.
+	 * 
 	 * @ingroup String_concept
 	 * @ingroup PSTL
 	 */
 	template<
 		typename OsModel_P,
 		typename Allocator_P,
-		typename Char_P = char
+		typename Char_P = char,
+		size_t INLINE_CAPACITY_P = 15
 	>
 	class string_dynamic {
 		public:
@@ -45,50 +54,61 @@ namespace wiselib {
 			typedef Char_P Char;
 			typedef Allocator_P Allocator;
 			
-			typedef string_dynamic<OsModel, Allocator, Char> self_type;
+			typedef string_dynamic<OsModel, Allocator, Char, INLINE_CAPACITY_P> self_type;
 			typedef self_type* self_pointer_t;
 			typedef typename Allocator::template pointer_t<Char> char_pointer_t;
 			typedef typename Allocator::template array_pointer_t<Char> char_arr_pointer_t;
+			typedef string_slice<OsModel, Char> slice_type;
+			
+			enum { INLINE_CAPACITY = INLINE_CAPACITY_P };
+			
+			string_dynamic() : buffer_(0), size_(0), capacity_(INLINE_CAPACITY) {
+				inline_[0] = '\0';
+			}
 			
-			string_dynamic() : buffer_(0), size_(0) {
+			string_dynamic(typename Allocator::self_pointer_t alloc) : buffer_(0), size_(0), capacity_(INLINE_CAPACITY) {
+				inline_[0] = '\0';
 			}
 			
-			string_dynamic(typename Allocator::self_pointer_t alloc) : buffer_(0), size_(0) {
+			string_dynamic(const string_dynamic& other) : buffer_(0), size_(0), capacity_(INLINE_CAPACITY) {
+				inline_[0] = '\0';
+				assign(other.data(), other.size_);
 			}
 			
-			string_dynamic(const string_dynamic& other) : buffer_(0), size_(0){
-				// TODO: Implement buffer sharing with copy-on-write
-				resize(other.size_);
-				to_buffer_(other.buffer_, size_);
+			string_dynamic(const Char* c) : buffer_(0), size_(0), capacity_(INLINE_CAPACITY) {
+				inline_[0] = '\0';
+				assign(c, strlen((const char*)c));
 			}
 			
-			string_dynamic(const Char* c) : buffer_(0), size_(0) {
-				resize(strlen((const char*)c));
-				to_buffer_(c, strlen((const char*)c));
+			string_dynamic(const Char* c, size_t size) : buffer_(0), size_(0), capacity_(INLINE_CAPACITY) {
+				inline_[0] = '\0';
+				assign(c, size);
 			}
 			
-			string_dynamic(const Char* c, size_t size) : buffer_(0), size_(0) {
-				resize(size);
-				to_buffer_(c, size);
+			string_dynamic(const slice_type& s) : buffer_(0), size_(0), capacity_(INLINE_CAPACITY) {
+				inline_[0] = '\0';
+				assign(s.data(), s.size());
 			}
 			
 			string_dynamic& operator=(const string_dynamic& other) {
-				resize(other.size_);
-				to_buffer_(other.buffer_, size_);
+				if(&other != this) { assign(other.data(), other.size_); }
 				return *this;
 			}
 			
 			string_dynamic& operator=(const Char* other) {
-				resize(strlen((const char*)other));
-				to_buffer_(other, size_);
+				assign(other, strlen((const char*)other));
+				return *this;
+			}
+			
+			string_dynamic& operator=(const slice_type& other) {
+				assign(other.data(), other.size());
 				return *this;
 			}
 			
 			~string_dynamic() {
-				if(buffer_) { // && !weak_) {
+				if(buffer_) {
 					get_allocator().template free_array<Char>(buffer_);
-					buffer_ = 0;
-					size_ = 0;
+					buffer_ = char_arr_pointer_t(0);
 				}
 			}
 			
@@ -100,38 +120,68 @@ namespace wiselib {
 				return size_;
 			}
 			
+			bool empty() const {
+				return size_ == 0;
+			}
+			
+			/**
+			 * Number of characters that fit without reallocation.
+			 */
+			size_t capacity() const {
+				return capacity_;
+			}
+			
 			void clear() {
-				resize(0);
+				size_ = 0;
+				data()[0] = '\0';
 			}
 			
+			/**
+			 * Change the length to n characters, new characters are
+			 * '\0'.
+			 */
 			void resize(size_t n) {
-				if(n == size_) { return; }
+				if(!reserve(n)) { return; }
+				Char *d = data();
+				for(size_t i = size_; i < n; i++) { d[i] = '\0'; }
 				size_ = n;
-				
-				if(buffer_) {
-					get_allocator().template free_array<Char>(buffer_);
-				}
-				buffer_ = get_allocator().template allocate_array<Char>(size_ + 1);
-				assert(buffer_);
-				buffer_[size_] = '\0';
+				d[size_] = '\0';
 			}
 			
-			const Char* c_str() const { return buffer_.raw(); }
-			Char* c_str() { return buffer_.raw(); }
+			/**
+			 * Make room for at least n characters.
+			 * @return false if the allocation failed.
+			 */
+			bool reserve(size_t n) {
+				if(n <= capacity_) { return true; }
+				return reallocate(n);
+			}
 			
-			const Char* data() const { return buffer_.raw(); }
-			Char* data() { return buffer_.raw(); }
+			/**
+			 * Release unused capacity (moving the string back into the
+			 * object if it fits).
+			 */
+			void shrink_to_fit() {
+				if(!buffer_ || size_ == capacity_) { return; }
+				reallocate(size_);
+			}
+			
+			const Char* c_str() const { return data(); }
+			Char* c_str() { return data(); }
+			
+			const Char* data() const { return buffer_ ? buffer_.raw() : inline_; }
+			Char* data() { return buffer_ ? buffer_.raw() : inline_; }
+			
+			/**
+			 * Non-owning view of (a part of) this string, valid until the
+			 * string is modified or destroyed.
+			 */
+			slice_type slice(size_t from = 0, int length = -1) const {
+				return slice_type(data(), size_).substr(from, length);
+			}
 			
 			int cmp(const string_dynamic& other) const {
-				int r = 0;
-				if(size_ != other.size_) { r = (size_ < other.size_) ? -1 : (size_ > other.size_); }
-				else {
-					for(size_t i=0; i<size_; i++) {
-						if(buffer_[i] < other.buffer_[i]) { r = -1; break; }
-						if(buffer_[i] > other.buffer_[i]) { r =  1; break; }
-					}
-				}
-				return r;
+				return slice().cmp(other.slice());
 			}
 			bool operator<(const string_dynamic& other) const { return cmp(other) < 0; }
 			bool operator<=(const string_dynamic& other) const { return cmp(other) <= 0; }
@@ -139,59 +189,67 @@ namespace wiselib {
 			bool operator>=(const string_dynamic& other) const { return cmp(other) >= 0; }
 			bool operator==(const string_dynamic& other) const { return cmp(other) == 0; }
 			bool operator!=(const string_dynamic& other) const { return cmp(other) != 0; }
-		//	char operator[] (const size_t pos) const {return (pos >= size_) ? 0 : buffer_[pos]; }
-			Char& operator[] (const size_t pos)  { return buffer_[pos]; }
+			
+			Char& operator[] (const size_t pos) { return data()[pos]; }
+			const Char& operator[] (const size_t pos) const { return data()[pos]; }
 			
 			string_dynamic& append(const Char* other) {
-				return append(string_dynamic(other));
+				return append(other, strlen((const char*)other));
 			}
 			
 			string_dynamic& append(const string_dynamic& other) {
-				char_arr_pointer_t old_buffer = buffer_;
-				buffer_ = get_allocator().template allocate_array<Char>(size_ + other.size_ + 1);
-				
-				if(old_buffer) {
-					to_buffer_(old_buffer, size_);
-				}
-				to_buffer_(other.buffer_, other.size_, size_);
-				
-				size_ = size_ + other.size_;
-				if(old_buffer) {
-					get_allocator().template free_array<Char>(old_buffer);
+				return append(other.data(), other.size_);
+			}
+			
+			string_dynamic& append(const slice_type& other) {
+				return append(other.data(), other.size());
+			}
+			
+			string_dynamic& append(const Char* other, size_t n) {
+				if(size_ + n > capacity_) {
+					// other might point into our own buffer
+					const Char *d = data();
+					bool inside = (other >= d && other < d + size_);
+					size_t offset = other - d;
+					
+					size_t c = capacity_ + capacity_ / 2;
+					if(!reallocate((c < size_ + n) ? size_ + n : c)) { return *this; }
+					if(inside) { other = data() + offset; }
 				}
-				buffer_[size_] = '\0';
-				
+				Char *d = data() + size_;
+				for(size_t i = 0; i < n; i++) { d[i] = other[i]; }
+				size_ += n;
+				data()[size_] = '\0';
 				return *this;
 			}
 			
 			string_dynamic& push_back(Char c) {
-				char_arr_pointer_t old_buffer = buffer_;
-				buffer_ = get_allocator().template allocate_array<Char>(size_ + 2);
-				
-				if(old_buffer) {
-					to_buffer_(old_buffer, size_);
+				if(size_ == capacity_ && !reallocate(capacity_ + capacity_ / 2 + 1)) {
+					return *this;
 				}
-				to_buffer_(&c, 1, size_);
-				
-				size_ = size_ + 1;
-				if(old_buffer) {
-					get_allocator().template free_array<Char>(old_buffer);
-				}
-				buffer_[size_] = '\0';
-				
+				Char *d = data();
+				d[size_++] = c;
+				d[size_] = '\0';
 				return *this;
 			}
 			
+			string_dynamic& operator+=(const Char* other) { return append(other); }
+			string_dynamic& operator+=(const string_dynamic& other) { return append(other); }
+			string_dynamic& operator+=(const slice_type& other) { return append(other); }
+			string_dynamic& operator+=(Char c) { return push_back(c); }
+			
 			int first_index_of(Char c) const {
-				for(int i=0; i<size_; i++) {
-					if(buffer_[i] == c) { return i; }
-				}
-				return -1;
+				return slice().first_index_of(c);
 			}
 			
+			/**
+			 * Copy of a part of the string, see slice() for a
+			 * non-copying variant.
+			 * @param length number of characters, negative for all up to
+			 * the end.
+			 */
 			string_dynamic substr(int from, int length=-1) const {
-				if(length == 0) length = size_ - from;
-				return string_dynamic(buffer_.raw() + from, length);
+				return string_dynamic(slice(from, length));
 			}
 			
 			template<typename Int>
@@ -230,6 +288,7 @@ namespace wiselib {
 				if(c >= 'a' && c <= 'z') {
 					return true;
 				}
+				return false;
 			}
 			int to_int(Char c) {
 				if(c >= '0' && c <= '9') {
@@ -240,12 +299,9 @@ namespace wiselib {
 			
 			template<typename Int>
 			void int_to_string_r(Int i, Int base, bool first=true) {
-				if(i > base) {
+				if(i >= base) {
 					int_to_string_r((Int)(i / base), (Int)base, false);
 				}
-				if((i == 0) && !first) {
-					return;
-				}
 				if((i%base) < 10) {
 					push_back('0' + (i % base));
 				}
@@ -254,23 +310,51 @@ namespace wiselib {
 				}
 			}
 			
+			void assign(const Char* src, size_t n) {
+				if(n > capacity_ && !reallocate(n)) { return; }
+				Char *d = data();
+				for(size_t i = 0; i < n; i++) { d[i] = src[i]; }
+				size_ = n;
+				d[size_] = '\0';
+			}
 			
-		
-			template<typename T>
-			void to_buffer_(T src, size_t n, size_t offset = 0) {
-				if(n == 0) { return; }
+			/**
+			 * Move the content to storage for exactly n characters (inline
+			 * if they fit), n >= size_.
+			 */
+			bool reallocate(size_t n) {
+				char_arr_pointer_t b(0);
+				Char *d = inline_;
+				if(n > (size_t)INLINE_CAPACITY) {
+					b = get_allocator().template allocate_array<Char>(n + 1);
+					if(!b) {
+						assert(false && "string_dynamic: out of memory");
+						return false;
+					}
+					d = b.raw();
+				}
+				else {
+					n = INLINE_CAPACITY;
+				}
 				
-				Char* ptr = buffer_.raw() + offset;
-				for(size_t i=0; i<n; i++) {
-					*ptr = *src;
-					++ptr; ++src;
+				if(buffer_) {
+					const Char *s = buffer_.raw();
+					for(size_t i = 0; i <= size_; i++) { d[i] = s[i]; }
+					get_allocator().template free_array<Char>(buffer_);
 				}
+				else if(d != inline_) {
+					for(size_t i = 0; i <= size_; i++) { d[i] = inline_[i]; }
+				}
+				buffer_ = b;
+				capacity_ = n;
+				return true;
 			}
 			
 			char_arr_pointer_t buffer_;
 			size_t size_;
+			size_t capacity_;
+			Char inline_[INLINE_CAPACITY_P + 1];
 	};
 } // ns
 
 #endif // STRING_DYNAMIC_H
-
@@ -0,0 +1,131 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef STRING_SLICE_H
+#define STRING_SLICE_H
+
+namespace wiselib {
+	
+	/**
+	 * Non-owning view of a sequence of characters, for passing substrings
+	 * around without copying them.
+	 * The referenced characters must outlive the slice and are not
+	 * necessarily '\0'-terminated.
+	 * Ordering is the one of string_dynamic (shorter strings first, then
+	 * by characters).
+	 * 
+	 * @ingroup String_concept
+	 * @ingroup PSTL
+	 */
+	template<
+		typename OsModel_P,
+		typename Char_P = char
+	>
+	class string_slice {
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel_P::size_t size_t;
+			typedef Char_P Char;
+			typedef string_slice<OsModel, Char> self_type;
+			typedef const Char* iterator;
+			typedef const Char* const_iterator;
+			
+			string_slice() : data_(0), size_(0) {
+			}
+			
+			string_slice(const Char* s) : data_(s), size_(0) {
+				if(s) {
+					while(s[size_] != '\0') { size_++; }
+				}
+			}
+			
+			string_slice(const Char* s, size_t n) : data_(s), size_(n) {
+			}
+			
+			const Char* data() const { return data_; }
+			size_t size() const { return size_; }
+			size_t length() const { return size_; }
+			bool empty() const { return size_ == 0; }
+			
+			const_iterator begin() const { return data_; }
+			const_iterator end() const { return data_ + size_; }
+			
+			const Char& operator[](size_t pos) const { return data_[pos]; }
+			
+			/**
+			 * @param length number of characters, negative for all up to
+			 * the end.
+			 */
+			self_type substr(size_t from, int length = -1) const {
+				if(from > size_) { from = size_; }
+				size_t n = size_ - from;
+				if(length >= 0 && (size_t)length < n) { n = length; }
+				return self_type(data_ + from, n);
+			}
+			
+			void remove_prefix(size_t n) {
+				if(n > size_) { n = size_; }
+				data_ += n;
+				size_ -= n;
+			}
+			
+			void remove_suffix(size_t n) {
+				size_ -= (n > size_) ? size_ : n;
+			}
+			
+			int first_index_of(Char c) const {
+				for(size_t i = 0; i < size_; i++) {
+					if(data_[i] == c) { return i; }
+				}
+				return -1;
+			}
+			
+			bool starts_with(const self_type& other) const {
+				if(other.size_ > size_) { return false; }
+				for(size_t i = 0; i < other.size_; i++) {
+					if(data_[i] != other.data_[i]) { return false; }
+				}
+				return true;
+			}
+			
+			int cmp(const self_type& other) const {
+				if(size_ != other.size_) { return (size_ < other.size_) ? -1 : 1; }
+				for(size_t i = 0; i < size_; i++) {
+					if(data_[i] < other.data_[i]) { return -1; }
+					if(data_[i] > other.data_[i]) { return  1; }
+				}
+				return 0;
+			}
+			
+			bool operator<(const self_type& other) const { return cmp(other) < 0; }
+			bool operator<=(const self_type& other) const { return cmp(other) <= 0; }
+			bool operator>(const self_type& other) const { return cmp(other) > 0; }
+			bool operator>=(const self_type& other) const { return cmp(other) >= 0; }
+			bool operator==(const self_type& other) const { return cmp(other) == 0; }
+			bool operator!=(const self_type& other) const { return cmp(other) != 0; }
+			
+		private:
+			const Char *data_;
+			size_t size_;
+	};
+} // ns
+
+#endif // STRING_SLICE_H
+
@@ -203,45 +203,42 @@ namespace wiselib {
 						bool child_idx = (p == p->parent->childs[Node::RIGHT]);
 						p->parent->childs[child_idx] = 0;
 					}
+					else {
+						root_ = 0;
+					}
 				}
 				else {
 					bool successor_side = 1;
 					Node *s = find_successor(p, successor_side);
 					assert(s != 0);
 					
-					// remove successor from subtree
-					s->parent->childs[!successor_side] = s->childs[successor_side];
-					if(s->childs[successor_side]) {
-						s->childs[successor_side]->parent = s->parent->childs[!successor_side];
-					}
+					// remove successor from subtree, it has no child on the
+					// side facing away from p
+					Node *c = s->childs[successor_side];
+					if(s->parent == p) { p->childs[successor_side] = c; }
+					else { s->parent->childs[!successor_side] = c; }
+					if(c) { c->parent = s->parent; }
+					
+					// put successor in place of p
+					s->childs[0] = p->childs[0];
+					s->childs[1] = p->childs[1];
+					if(s->childs[0]) { s->childs[0]->parent = s; }
+					if(s->childs[1]) { s->childs[1]->parent = s; }
 					
+					s->parent = p->parent;
 					if(p->parent) {
 						bool child_idx = (p == p->parent->childs[Node::RIGHT]);
 						p->parent->childs[child_idx] = s;
 					}
-					/*
-					if(p->childs[!successor_side]) { p->childs[!successor_side]->parent = s; }
-					if(p->childs[successor_side]) { p->childs[successor_side]->parent = s; }
-					*/
-					if(p->childs[0]) { p->childs[0]->parent = s; }
-					if(p->childs[1]) { p->childs[1]->parent = s; }
-					
-					s->parent = p->parent;
-					
-					/*
-					s->childs[!successor_side] = p->childs[!successor_side];
-					s->childs[successor_side] = p->childs[successor_side];
-					*/
-					s->childs[0] = p->childs[0];
-					s->childs[1] = p->childs[1];
+					else {
+						root_ = s;
+					}
 				}
 				
 				get_allocator().free_array(
 						reinterpret_cast<block_data_t*>(p)
 				);
 				
-				if(root_ == p) { root_ = 0; }
-				
 				check();
 				
 				return 1;
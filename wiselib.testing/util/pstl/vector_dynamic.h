@@ -21,12 +21,20 @@
 #define __WISELIB_INTERNAL_INTERFACE_STL_VECTOR_DYNAMIC_H
 
 #include "util/pstl/iterator.h"
+#include "util/pstl/element_traits.h"
 
 #define VECTOR_DYNAMIC_MIN_SIZE 4
 
 namespace wiselib
 {
 
+   /**
+    * Dynamically growing vector on get_allocator().
+    *
+    * Elements are moved with memmove() if they are trivially relocatable
+    * and by (move) assignment otherwise, see element_ops. When erasing
+    * shrinks the buffer is decided by the shrink policy (set_shrink_policy()).
+    */
    template<typename OsModel_P,
             typename Value_P
             >
@@ -47,16 +55,42 @@ namespace wiselib
       typedef value_type* buffer_pointer_t;
       
       typedef buffer_pointer_t iterator;
+
+      typedef element_ops<value_type> ops;
+
+      enum ShrinkPolicy {
+         /// halve the buffer when less than a quarter is used (default)
+         SHRINK_QUARTER,
+         /// never give memory back except in clear() and pack()
+         SHRINK_NEVER,
+         /// always shrink to the size (for tight memory, reallocates a lot)
+         SHRINK_EXACT
+      };
       // --------------------------------------------------------------------
-      vector_dynamic() :  size_(0), capacity_(0), buffer_(0)
+      vector_dynamic() :  size_(0), capacity_(0), shrink_policy_(SHRINK_QUARTER), buffer_(0)
       {
       }
       // --------------------------------------------------------------------
-      vector_dynamic( const vector_dynamic& vec )
+      vector_dynamic( const vector_dynamic& vec ) : size_(0), capacity_(0), shrink_policy_(vec.shrink_policy_), buffer_(0)
       {
          *this = vec;
       }
       // --------------------------------------------------------------------
+#if __cplusplus >= 201103L
+      vector_dynamic( vector_dynamic&& vec ) : size_(vec.size_), capacity_(vec.capacity_), shrink_policy_(vec.shrink_policy_), buffer_(vec.buffer_)
+      {
+         vec.size_ = 0;
+         vec.capacity_ = 0;
+         vec.buffer_ = 0;
+      }
+      // --------------------------------------------------------------------
+      vector_dynamic& operator=( vector_dynamic&& vec )
+      {
+         swap( vec );
+         return *this;
+      }
+#endif
+      // --------------------------------------------------------------------
       ~vector_dynamic() {
          if(buffer_) {
             get_allocator().free_array(buffer_);
@@ -72,6 +106,7 @@ namespace wiselib
 		 */
 		void detach() {
          size_ = 0;
+         capacity_ = 0;
          buffer_ = 0;
 		}
       
@@ -81,16 +116,21 @@ namespace wiselib
          }
          buffer_ = buffer;
          size_ = size;
+         capacity_ = size;
       }
       
       vector_dynamic& operator=( const vector_dynamic& vec )
       {
-           clear();
-           change_capacity(vec.capacity_);
-          for(size_t i = 0;i < vec.size_;++i){
-              buffer_[size_++] = vec[i];
-          }
-          return *this;
+         if(this == &vec) {
+            return *this;
+         }
+         size_ = 0;
+         if(capacity_ < vec.size_ || capacity_ > 2 * vec.capacity_) {
+            change_capacity(vec.capacity_);
+         }
+         ops::copy(buffer_, vec.buffer_, vec.buffer_ + vec.size_);
+         size_ = vec.size_;
+         return *this;
       }
       // --------------------------------------------------------------------
       
@@ -116,6 +156,16 @@ namespace wiselib
       // --------------------------------------------------------------------
       bool empty() const
       { return size() == 0; }
+      // --------------------------------------------------------------------
+      void set_shrink_policy(ShrinkPolicy policy)
+      { shrink_policy_ = policy; }
+      // --------------------------------------------------------------------
+      /// make room for n elements
+      void reserve(size_type n) {
+         if(n > capacity_) {
+            change_capacity(n);
+         }
+      }
       ///@}
       // --------------------------------------------------------------------
       ///@name Element Access
@@ -155,35 +205,69 @@ namespace wiselib
       template <class InputIterator>
       void assign ( InputIterator first, InputIterator last )
       {
-         clear();
-         for ( InputIterator it = first; it != last; ++it )
-            push_back( *it );
+         size_ = 0;
+         insert( end(), first, last );
       }
       // --------------------------------------------------------------------
       void assign( size_type n, const value_type& u )
       {
-         clear();
-         for ( unsigned int i = 0; i < n; ++i )
-            push_back( u );
+         size_ = 0;
+         insert( end(), n, u );
       }
       // --------------------------------------------------------------------
       void push_back( const value_type& x )
       {
          if(size_ >= capacity_) {
-            grow();
+            // x may be an element of this vector
+            value_type v = x;
+            grow(size_ + 1);
+            buffer_[size_++] = rvalue(v);
+         }
+         else {
+            buffer_[size_++] = x;
          }
-            
-         buffer_[size_++] = x;
       }
       // --------------------------------------------------------------------
+#if __cplusplus >= 201103L
+      void push_back( value_type&& x )
+      {
+         if(size_ >= capacity_) {
+            value_type v = rvalue(x);
+            grow(size_ + 1);
+            buffer_[size_++] = rvalue(v);
+         }
+         else {
+            buffer_[size_++] = rvalue(x);
+         }
+      }
+      // --------------------------------------------------------------------
+      /// construct an element from args at the end
+      template<typename... Args>
+      void emplace_back( Args&&... args )
+      {
+         if(size_ >= capacity_) {
+            grow(size_ + 1);
+         }
+         reconstruct( buffer_ + size_, static_cast<Args&&>( args )... );
+         size_++;
+      }
+      // --------------------------------------------------------------------
+      /// construct an element from args before position
+      template<typename... Args>
+      iterator emplace( iterator position, Args&&... args )
+      {
+         pointer p = open( position, 1 );
+         reconstruct( p, static_cast<Args&&>( args )... );
+         return p;
+      }
+#endif
+      // --------------------------------------------------------------------
       void pop_back()
       {
          if ( size_ > 0 )
             --size_;
          
-         if(size_ < (capacity_ / 4)) {
-            shrink();
-         }
+         shrink();
       }
       // --------------------------------------------------------------------
       iterator insert(const value_type& x) {
@@ -196,32 +280,35 @@ namespace wiselib
          }
          return iter;
       }
+      // --------------------------------------------------------------------
       iterator insert( iterator position, const value_type& x )
       {
-         // no more elements can be inserted because vector is full
-         //if ( size() == max_size() )
-            //return iterator((buffer_pointer_t)buffer_ + (typename OsModel_P::size_t)size_);
-         if(size_ >= capacity_) {
-            grow();
-         }
-         size_++;
-
-         value_type cur = x, temp;
-         for ( iterator it = position; it != end(); ++it )
-         {
-            temp = *it;
-            *it = cur;
-            cur = temp;
-         }
-         push_back( cur );
-
-         return position;
+         // x may be an element that is about to move
+         value_type v = x;
+         pointer p = open( position, 1 );
+         *p = rvalue( v );
+         return p;
       }
       // --------------------------------------------------------------------
       void insert( iterator position, size_type n, const value_type& x )
       {
-         for ( int i = 0; i < n; ++i )
-            insert( position, x );
+         value_type v = x;
+         pointer p = open( position, n );
+         for ( size_type i = 0; i < n; ++i )
+            p[i] = v;
+      }
+      // --------------------------------------------------------------------
+      /// insert copies of [first, last) with at most one reallocation
+      template <class InputIterator>
+      void insert( iterator position, InputIterator first, InputIterator last )
+      {
+         size_type n = 0;
+         for ( InputIterator it = first; it != last; ++it )
+            ++n;
+
+         pointer p = open( position, n );
+         for ( size_type i = 0; i < n; ++i, ++first )
+            p[i] = *first;
       }
       // --------------------------------------------------------------------
       iterator erase( iterator position )
@@ -229,12 +316,13 @@ namespace wiselib
          if ( position == end() )
             return end();
 
-         for ( iterator cur = position; cur != end(); ++cur )
-            *cur = *(cur + (typename OsModel::size_t)1);
+         ops::move( position, position + 1, end() );
+         size_--;
 
-         pop_back();
-
-         return position;
+         // shrinking moves the buffer
+         size_type i = position - buffer_;
+         shrink();
+         return buffer_ + i;
       }
       // --------------------------------------------------------------------
       iterator erase( iterator first, iterator last )
@@ -242,24 +330,27 @@ namespace wiselib
          if ( first == end() || first == last )
             return first;
 
-         iterator ret = first;
-
-         while ( last != end() )
-         {
-            *first = *last;
-            first++;
-            last++;
-         }
+         ops::move( first, last, end() );
+         size_ -= last - first;
 
-         size_ = &(*first) - buffer_;
-         return ret;
+         size_type i = first - buffer_;
+         shrink();
+         return buffer_ + i;
       }
       // --------------------------------------------------------------------
       void swap( vector_type& vec )
       {
-         vector_type tmp = *this;
-         *this = vec;
-         vec = tmp;
+         uint16_t s = size_, c = capacity_;
+         uint8_t p = shrink_policy_;
+         buffer_pointer_t b = buffer_;
+         size_ = vec.size_;
+         capacity_ = vec.capacity_;
+         shrink_policy_ = vec.shrink_policy_;
+         buffer_ = vec.buffer_;
+         vec.size_ = s;
+         vec.capacity_ = c;
+         vec.shrink_policy_ = p;
+         vec.buffer_ = b;
       }
       // --------------------------------------------------------------------
       void clear()
@@ -269,29 +360,52 @@ namespace wiselib
       }
       ///@}
       
-      void grow() {
-         if(capacity_ < VECTOR_DYNAMIC_MIN_SIZE) {
-            change_capacity(VECTOR_DYNAMIC_MIN_SIZE);
-         }
-         else {
-            change_capacity(capacity_ * 2);
+      /// grow geometrically to at least n elements
+      void grow(size_type n = 0) {
+         size_type c = capacity_ < VECTOR_DYNAMIC_MIN_SIZE ? VECTOR_DYNAMIC_MIN_SIZE : capacity_ * 2;
+         // capacity_ is 16 bits wide
+         if(c > 0xffff) { c = 0xffff; }
+         change_capacity(c < n ? n : c);
+      }
+      
+      /// give memory back according to the shrink policy
+      void shrink() {
+         switch(shrink_policy_) {
+            case SHRINK_QUARTER:
+               if(size_ < (capacity_ / 4)) {
+                  change_capacity(capacity_ / 2);
+               }
+               break;
+            case SHRINK_EXACT:
+               if(size_ < capacity_) {
+                  change_capacity(size_);
+               }
+               break;
+            case SHRINK_NEVER:
+               break;
          }
       }
-      void shrink() { change_capacity(capacity_ / 2); }
       
       void pack() { change_capacity(size_); }
+      void shrink_to_fit() { pack(); }
       
       void change_capacity(size_t n) {
+         if(n == capacity_) {
+            return;
+         }
+         if(size_ > n) {
+            size_ = n;
+         }
+         
          buffer_pointer_t new_buffer(0);
          if(n != 0) {
             new_buffer = get_allocator().template allocate_array<value_type>(n) .raw();
+            // the old buffer is thrown away, so non-trivial elements can
+            // be moved out of it
+            ops::move(new_buffer, buffer_, buffer_ + size_);
          }
          
          if(buffer_) {
-            /*for(size_type i=0; i<size_; i++) {
-               new_buffer[i] = buffer_[i];
-            }*/
-            memcpy((void*)&new_buffer[0], (void*)&buffer_[0], size_ * sizeof(value_type));
             get_allocator().free_array(buffer_);
          }
          buffer_ = new_buffer;
@@ -300,12 +414,29 @@ namespace wiselib
       }
       
       void resize(size_t n) {
-         size_ = n;
          change_capacity(n);
+         size_ = n;
       }
       
    protected:
+      /**
+       * Shift [position, end) up by n, growing if necessary.
+       * @return pointer to the first of the n slots now free
+       */
+      pointer open( iterator position, size_type n )
+      {
+         size_type i = position - buffer_;
+         if(size_ + n > capacity_) {
+            grow(size_ + n);
+         }
+         pointer p = buffer_ + i;
+         ops::move( p + n, p, buffer_ + size_ );
+         size_ += n;
+         return p;
+      }
+
       uint16_t size_, capacity_;
+      uint8_t shrink_policy_;
       buffer_pointer_t buffer_;
    };
 
@@ -53,14 +53,17 @@ namespace wiselib {
 			
 			void parse_line(char *line) {
 				strncpy(line_, line, MAX_LINE_LENGTH_P);
-				
-				char *p = line_;
-				
-				for(size_ = 0; *p; size_++) {
-					elements_[size_] = parse_element(p);
-					p++;
-					if(*p == '.') { size_++; break; }
-				}
+				line_[MAX_LINE_LENGTH_P - 1] = '\0';
+				parse(line_, line_ + strlen(line_));
+			}
+			
+			/**
+			 * Like parse_line() but without copying, the elements point
+			 * into @a line, which is modified (elements get
+			 * 0-terminated). @a end points to the terminating 0 of @a line.
+			 */
+			void parse_line_in_place(char *line, char *end) {
+				parse(line, end);
 			}
 			
 			char*& operator[](size_type i) { return elements_[i]; }
@@ -68,6 +71,18 @@ namespace wiselib {
 		
 		private:
 			
+			void parse(char *p, char *end) {
+				for(size_ = 0; p < end && *p && size_ < MAX_ELEMENTS; size_++) {
+					elements_[size_] = parse_element(p);
+					// elements are followed by a 0 that used to be
+					// whitespace, but the last one may be followed by the
+					// end of the line
+					if(p >= end) { size_++; break; }
+					p++;
+					if(*p == '.') { size_++; break; }
+				}
+			}
+			
 			char* parse_element(char*& p) {
 				char *r;
 				p = skip_whitespace(p);
@@ -20,64 +20,597 @@
 #ifndef BLOCK_DICTIONARY_H
 #define BLOCK_DICTIONARY_H
 
+#include <algorithms/block_memory/b_plus_tree.h>
+
 namespace wiselib {
-	
+
 	/**
-	 * \brief
-	 * 
-	 * \ingroup
-	 * 
-	 * \tparam 
+	 * \brief Dictionary for (0-terminated) strings on block memory.
+	 *
+	 * Strings are packed into slotted pages, each page is one block
+	 * obtained from the block storage. A page starts with a small header,
+	 * followed by the slot directory that grows upwards, records are
+	 * placed at the end of the page and grow downwards.
+	 * Each record holds its reference count, the key of the next record
+	 * with the same hash value and the string itself.
+	 *
+	 * Keys are (page address, slot) pairs. As records are only ever moved
+	 * within their page (when compacting it), keys stay valid until the
+	 * entry is erased.
+	 *
+	 * A B+ tree (on the same block storage) maps the hash value of a
+	 * string to the key of the first record of its collision chain.
+	 *
+	 * Erasing the last reference to a string frees its slot, the page is
+	 * compacted lazily when the space is needed again, and empty pages
+	 * are returned to the block storage.
+	 * A small number of pages with lots of reclaimed space is remembered
+	 * in RAM so new strings are preferably put there.
+	 *
+	 * Strings longer than MAX_VALUE_SIZE can not be stored, insert()
+	 * returns NULL_KEY for them.
+	 *
+	 * \ingroup ConcreteBDTDictionary_concept
+	 *
+	 * \tparam BlockStorage_P Block allocator with create(), free(),
+	 *   read(), write() and invalidate() on whole blocks,
+	 *   e.g. BitmapChunkAllocator.
+	 * \tparam Hash_P Hash function for strings, e.g. Sdbm.
 	 */
 	template<
 		typename OsModel_P,
-		typename BlockStorage_P
+		typename BlockStorage_P,
+		typename Hash_P
 	>
 	class BlockDictionary {
-		
+
 		public:
 			typedef OsModel_P OsModel;
 			typedef typename OsModel::block_data_t block_data_t;
 			typedef typename OsModel::size_t size_type;
 			typedef BlockStorage_P BlockStorage;
-			
-			typedef typename ... key_type;
+			typedef typename BlockStorage::address_t address_t;
+			typedef Hash_P Hash;
+			typedef typename Hash::hash_t hash_t;
+			typedef BlockDictionary<OsModel_P, BlockStorage_P, Hash_P> self_type;
+			typedef self_type* self_pointer_t;
+
+			typedef address_t key_type;
 			typedef block_data_t* mapped_type;
 			typedef ::uint32_t refcount_t;
-			
+
+			typedef BPlusTree<OsModel, BlockStorage, hash_t, key_type> Tree;
+
 			enum { ABSTRACT_KEYS = true };
 			static const key_type NULL_KEY;
-			
+
 			enum ErrorCodes {
 				SUCCESS = OsModel::SUCCESS,
 				ERR_UNSPEC = OsModel::ERR_UNSPEC
 			};
-			
+
+			enum {
+				BLOCK_SIZE = BlockStorage::BLOCK_SIZE,
+				NO_ADDRESS = BlockStorage::NO_ADDRESS
+			};
+
+			enum {
+				SLOT_BITS = 8,
+				MAX_SLOTS = (1 << SLOT_BITS) - 1,
+				HEADER_SIZE = 4 * sizeof(::uint16_t),
+				SLOT_SIZE = 2 * sizeof(::uint16_t),
+				RECORD_HEADER_SIZE = sizeof(refcount_t) + sizeof(key_type),
+				MAX_RECORD_SIZE = BLOCK_SIZE - HEADER_SIZE - SLOT_SIZE,
+				MAX_VALUE_SIZE = MAX_RECORD_SIZE - RECORD_HEADER_SIZE
+			};
+
+			enum {
+				/// Number of pages with reclaimed space remembered in RAM.
+				CANDIDATE_PAGES = 8,
+				/// Pages with at least this many free bytes become candidates.
+				CANDIDATE_THRESHOLD = BLOCK_SIZE / 4
+			};
+
+			/**
+			 * Iterates over the keys of all stored strings in hash order.
+			 */
+			class key_iterator {
+				public:
+					key_iterator() : dictionary_(0), key_(NULL_KEY) {
+					}
+
+					key_iterator(self_pointer_t dictionary, const typename Tree::iterator& it)
+							: dictionary_(dictionary), tree_iterator_(it), key_(NULL_KEY) {
+						if(tree_iterator_ != dictionary_->tree_.end()) {
+							key_ = tree_iterator_->value();
+						}
+					}
+
+					bool operator==(const key_iterator& other) { return key_ == other.key_; }
+					bool operator!=(const key_iterator& other) { return key_ != other.key_; }
+
+					const key_iterator& operator++() {
+						key_ = dictionary_->next_in_chain(key_);
+						if(key_ == NULL_KEY) {
+							++tree_iterator_;
+							if(tree_iterator_ != dictionary_->tree_.end()) {
+								key_ = tree_iterator_->value();
+							}
+						}
+						return *this;
+					}
+
+					key_type operator*() { return key_; }
+					const key_type* operator->() const { return &key_; }
+
+				private:
+					self_pointer_t dictionary_;
+					typename Tree::iterator tree_iterator_;
+					key_type key_;
+			};
+			typedef key_iterator iterator;
+
+			BlockDictionary() : storage_(0), page_address_(NO_ADDRESS), fill_page_(NO_ADDRESS), size_(0), pages_(0) {
+			}
+
+			int init(typename BlockStorage::self_pointer_t storage, typename OsModel::Debug::self_pointer_t debug) {
+				storage_ = storage;
+				debug_ = debug;
+				tree_.init(storage_, debug_);
+				page_address_ = NO_ADDRESS;
+				fill_page_ = NO_ADDRESS;
+				for(size_type i = 0; i < CANDIDATE_PAGES; i++) {
+					candidate_page_[i] = NO_ADDRESS;
+					candidate_free_[i] = 0;
+				}
+				size_ = 0;
+				pages_ = 0;
+				return SUCCESS;
+			}
+
+			key_iterator begin_keys() { return key_iterator(this, tree_.begin()); }
+			key_iterator end_keys() { return key_iterator(this, tree_.end()); }
+
+			/**
+			 * Insert a string or increase its reference count if it is
+			 * already present.
+			 *
+			 * @return key of the string, NULL_KEY if it is too long.
+			 */
 			key_type insert(mapped_type value) {
-				// TODO
+				size_type l = strlen(reinterpret_cast<char*>(value)) + 1;
+				if(l > MAX_VALUE_SIZE) { return NULL_KEY; }
+
+				hash_t h = Hash::hash(value, l - 1);
+				typename Tree::iterator it = tree_.find(h);
+				key_type head = (it == tree_.end()) ? NULL_KEY : it->value();
+
+				key_type k = find_in_chain(head, value, l);
+				if(k != NULL_KEY) {
+					// page_ holds the record now
+					block_data_t *r = record(slot_of(k));
+					set_refcount(r, refcount(r) + 1);
+					store_page();
+					return k;
+				}
+
+				k = allocate_record(RECORD_HEADER_SIZE + l);
+				block_data_t *r = record(slot_of(k));
+				set_refcount(r, 1);
+				set_next(r, head);
+				memcpy(r + RECORD_HEADER_SIZE, value, l);
+				store_page();
+
+				if(it == tree_.end()) { tree_.insert(h, k); }
+				else { tree_.update(it, k); }
+
+				size_++;
+				return k;
 			}
-			
+
+			/**
+			 * @return key of the given string or NULL_KEY if it is not
+			 * in the dictionary.
+			 */
 			key_type find(mapped_type value) {
-				// TODO
+				size_type l = strlen(reinterpret_cast<char*>(value)) + 1;
+				if(l > MAX_VALUE_SIZE) { return NULL_KEY; }
+
+				typename Tree::iterator it = tree_.find(Hash::hash(value, l - 1));
+				if(it == tree_.end()) { return NULL_KEY; }
+				return find_in_chain(it->value(), value, l);
 			}
-			
-			void erase(key_type entry) {
-				// TODO
+
+			/**
+			 * Decrease the reference count of the given entry, remove it
+			 * if the count drops to zero.
+			 */
+			void erase(key_type k) {
+				assert(k != NULL_KEY);
+
+				load_page(page_of(k));
+				block_data_t *r = record(slot_of(k));
+				refcount_t rc = refcount(r);
+				assert(rc > 0);
+				if(rc > 1) {
+					set_refcount(r, rc - 1);
+					store_page();
+					return;
+				}
+
+				key_type next = get_next(r);
+				hash_t h = Hash::hash(r + RECORD_HEADER_SIZE, get_record_length(slot_of(k)) - RECORD_HEADER_SIZE - 1);
+
+				// Unlink from collision chain
+				typename Tree::iterator it = tree_.find(h);
+				assert(it != tree_.end());
+				if(it->value() == k) {
+					if(next == NULL_KEY) { tree_.erase(it); }
+					else { tree_.update(it, next); }
+				}
+				else {
+					key_type p = it->value();
+					while(p != NULL_KEY) {
+						load_page(page_of(p));
+						block_data_t *pr = record(slot_of(p));
+						if(get_next(pr) == k) {
+							set_next(pr, next);
+							store_page();
+							break;
+						}
+						p = get_next(pr);
+					}
+				}
+
+				free_record(k);
+				size_--;
 			}
-			
-			mapped_type get(key_type k) {
-				// TODO
+
+			/**
+			 * @return reference count of the given entry.
+			 */
+			size_type count(key_type k) {
+				load_page(page_of(k));
+				return refcount(record(slot_of(k)));
 			}
-			
-			mapped_type get_value(key_type k) { return getk(k); }
-			
-			void free_value(mapped_type v) {
-				// TODO
+
+			/**
+			 * @return the string for the given key. The returned pointer
+			 * stays valid until the next call to get_value() or
+			 * operator[].
+			 */
+			mapped_type operator[](key_type k) {
+				load_page(page_of(k));
+				size_type s = slot_of(k);
+				memcpy(value_buffer_, record(s) + RECORD_HEADER_SIZE, get_record_length(s) - RECORD_HEADER_SIZE);
+				return value_buffer_;
 			}
-		
+
+			mapped_type get(key_type k) { return (*this)[k]; }
+			mapped_type get_value(key_type k) { return (*this)[k]; }
+
+			void free_value(mapped_type v) { }
+
+			/// Number of distinct strings.
+			size_type size() { return size_; }
+
+			/// Number of blocks currently used for string pages.
+			size_type pages() { return pages_; }
+
+			Tree& tree() { return tree_; }
+
 		private:
-		
+
+			///@{
+			///@name Keys
+
+			static key_type make_key(address_t page, size_type slot) {
+				return ((key_type)page << SLOT_BITS) | (key_type)slot;
+			}
+			static address_t page_of(key_type k) { return (address_t)(k >> SLOT_BITS); }
+			static size_type slot_of(key_type k) { return (size_type)(k & MAX_SLOTS); }
+
+			///@}
+
+			///@{
+			///@name Page layout
+
+			block_data_t* page() { return reinterpret_cast<block_data_t*>(page_data_); }
+
+			// Header fields and slot entries are 16 bit values at byte
+			// offsets of the page, accessed with memcpy like the records
+
+			::uint16_t get_field(size_type offset) {
+				::uint16_t v;
+				memcpy(&v, page() + offset, sizeof(v));
+				return v;
+			}
+			void set_field(size_type offset, size_type v) {
+				::uint16_t f = v;
+				memcpy(page() + offset, &f, sizeof(f));
+			}
+
+			size_type get_page_slots() { return get_field(0); }
+			void set_page_slots(size_type v) { set_field(0, v); }
+			size_type get_page_data_start() { return get_field(2); }
+			void set_page_data_start(size_type v) { set_field(2, v); }
+			size_type get_page_free() { return get_field(4); }
+			void set_page_free(size_type v) { set_field(4, v); }
+			size_type get_page_live() { return get_field(6); }
+			void set_page_live(size_type v) { set_field(6, v); }
+
+			size_type get_record_offset(size_type s) { return get_field(HEADER_SIZE + s * SLOT_SIZE); }
+			void set_record_offset(size_type s, size_type v) { set_field(HEADER_SIZE + s * SLOT_SIZE, v); }
+			size_type get_record_length(size_type s) { return get_field(HEADER_SIZE + s * SLOT_SIZE + 2); }
+			void set_record_length(size_type s, size_type v) { set_field(HEADER_SIZE + s * SLOT_SIZE + 2, v); }
+
+			block_data_t* record(size_type s) { return page() + get_record_offset(s); }
+
+			// Records have no alignment guarantees, thus the memcpy's
+
+			static refcount_t refcount(block_data_t *r) {
+				refcount_t rc;
+				memcpy(&rc, r, sizeof(rc));
+				return rc;
+			}
+			static void set_refcount(block_data_t *r, refcount_t rc) { memcpy(r, &rc, sizeof(rc)); }
+
+			static key_type get_next(block_data_t *r) {
+				key_type k;
+				memcpy(&k, r + sizeof(refcount_t), sizeof(k));
+				return k;
+			}
+			static void set_next(block_data_t *r, key_type k) { memcpy(r + sizeof(refcount_t), &k, sizeof(k)); }
+
+			size_type gap() { return get_page_data_start() - (HEADER_SIZE + get_page_slots() * SLOT_SIZE); }
+
+			/**
+			 * @return true iff a record of @a n bytes fits into the
+			 * currently loaded page (possibly after compacting it).
+			 */
+			bool fits(size_type n) {
+				if(get_page_live() < get_page_slots()) { return get_page_free() >= n; }
+				return get_page_slots() < MAX_SLOTS && get_page_free() >= n + SLOT_SIZE;
+			}
+
+			void init_page() {
+				memset(page(), 0, BLOCK_SIZE);
+				set_page_slots(0);
+				set_page_data_start(BLOCK_SIZE);
+				set_page_free(BLOCK_SIZE - HEADER_SIZE);
+				set_page_live(0);
+			}
+
+			/**
+			 * Move all records to the end of the page so all free space is
+			 * in one piece. Processes records by descending offset, so each
+			 * one is only moved towards the end into space that has already
+			 * been vacated.
+			 */
+			void compact() {
+				size_type pos = BLOCK_SIZE;
+				size_type prev = BLOCK_SIZE;
+				while(true) {
+					size_type best = MAX_SLOTS;
+					for(size_type s = 0; s < get_page_slots(); s++) {
+						size_type o = get_record_offset(s);
+						if(o && o < prev && (best == MAX_SLOTS || o > get_record_offset(best))) {
+							best = s;
+						}
+					}
+					if(best == MAX_SLOTS) { break; }
+					prev = get_record_offset(best);
+					pos -= get_record_length(best);
+					memmove(page() + pos, page() + prev, get_record_length(best));
+					set_record_offset(best, pos);
+				}
+				set_page_data_start(pos);
+			}
+
+			///@}
+
+			///@{
+			///@name Page I/O
+
+			void load_page(address_t a) {
+				if(a == page_address_) { return; }
+				storage_->read(page(), a);
+				page_address_ = a;
+			}
+
+			void store_page() {
+				assert(page_address_ != (address_t)NO_ADDRESS);
+				storage_->write(page(), page_address_);
+			}
+
+			///@}
+
+			///@{
+			///@name Record management
+
+			/**
+			 * Walk the collision chain starting at @a k looking for @a value.
+			 * If found, the corresponding page is loaded.
+			 */
+			key_type find_in_chain(key_type k, mapped_type value, size_type l) {
+				while(k != NULL_KEY) {
+					load_page(page_of(k));
+					size_type s = slot_of(k);
+					block_data_t *r = record(s);
+					if(get_record_length(s) == RECORD_HEADER_SIZE + l && memcmp(r + RECORD_HEADER_SIZE, value, l) == 0) {
+						return k;
+					}
+					k = get_next(r);
+				}
+				return NULL_KEY;
+			}
+
+			key_type next_in_chain(key_type k) {
+				if(k == NULL_KEY) { return NULL_KEY; }
+				load_page(page_of(k));
+				return get_next(record(slot_of(k)));
+			}
+
+			/**
+			 * Reserve space for a record of @a n bytes, preferably in the
+			 * page currently being filled, then in one of the pages with
+			 * reclaimed space, else in a fresh page.
+			 * On return the page holding the new record is loaded (and
+			 * not yet written back).
+			 */
+			key_type allocate_record(size_type n) {
+				address_t a = NO_ADDRESS;
+
+				if(fill_page_ != (address_t)NO_ADDRESS) {
+					load_page(fill_page_);
+					if(fits(n)) { a = fill_page_; }
+				}
+
+				if(a == (address_t)NO_ADDRESS) {
+					for(size_type i = 0; i < CANDIDATE_PAGES; i++) {
+						if(candidate_page_[i] == (address_t)NO_ADDRESS || candidate_free_[i] < n) { continue; }
+						load_page(candidate_page_[i]);
+						if(fits(n)) {
+							a = candidate_page_[i];
+							break;
+						}
+					}
+				}
+
+				if(a == (address_t)NO_ADDRESS) {
+					init_page();
+					a = storage_->create(page());
+					page_address_ = a;
+					fill_page_ = a;
+					pages_++;
+				}
+
+				// Make room before growing the slot directory: a new slot
+				// may overlap live records until the page is compacted,
+				// and compact() must not see it.
+				size_type s = 0;
+				size_type slot_size = 0;
+				if(get_page_live() < get_page_slots()) {
+					while(get_record_offset(s)) { s++; }
+				}
+				else {
+					s = get_page_slots();
+					slot_size = SLOT_SIZE;
+				}
+
+				if(gap() < slot_size + n) { compact(); }
+				assert(gap() >= slot_size + n);
+
+				if(slot_size) {
+					set_page_slots(get_page_slots() + 1);
+					set_page_free(get_page_free() - SLOT_SIZE);
+				}
+
+				set_page_data_start(get_page_data_start() - n);
+				set_record_offset(s, get_page_data_start());
+				set_record_length(s, n);
+				set_page_free(get_page_free() - n);
+				set_page_live(get_page_live() + 1);
+
+				update_candidate(a);
+				return make_key(a, s);
+			}
+
+			void free_record(key_type k) {
+				address_t a = page_of(k);
+				size_type s = slot_of(k);
+				load_page(a);
+
+				set_page_free(get_page_free() + get_record_length(s));
+				set_page_live(get_page_live() - 1);
+				set_record_offset(s, 0);
+				set_record_length(s, 0);
+				while(get_page_slots() && get_record_offset(get_page_slots() - 1) == 0) {
+					set_page_slots(get_page_slots() - 1);
+					set_page_free(get_page_free() + SLOT_SIZE);
+				}
+
+				if(get_page_live() == 0) {
+					page_address_ = NO_ADDRESS;
+					if(fill_page_ == a) { fill_page_ = NO_ADDRESS; }
+					forget_candidate(a);
+					storage_->invalidate(a);
+					storage_->free(a);
+					pages_--;
+					return;
+				}
+
+				store_page();
+				update_candidate(a);
+			}
+
+			///@}
+
+			///@{
+			///@name Candidate pages
+
+			/**
+			 * Update the free space of page @a a (currently loaded) in
+			 * the candidate list, add it if it has enough reclaimed space
+			 * (replacing the candidate with the least space), remove it if
+			 * it has not.
+			 */
+			void update_candidate(address_t a) {
+				if(a == fill_page_) { return; }
+
+				size_type smallest = 0;
+				for(size_type i = 0; i < CANDIDATE_PAGES; i++) {
+					if(candidate_page_[i] == a) {
+						if(get_page_free() >= CANDIDATE_THRESHOLD) { candidate_free_[i] = get_page_free(); }
+						else { candidate_page_[i] = NO_ADDRESS; }
+						return;
+					}
+					if(candidate_page_[i] == (address_t)NO_ADDRESS) { candidate_free_[i] = 0; }
+					if(candidate_free_[i] < candidate_free_[smallest]) { smallest = i; }
+				}
+
+				if(get_page_free() >= CANDIDATE_THRESHOLD && get_page_free() > candidate_free_[smallest]) {
+					candidate_page_[smallest] = a;
+					candidate_free_[smallest] = get_page_free();
+				}
+			}
+
+			void forget_candidate(address_t a) {
+				for(size_type i = 0; i < CANDIDATE_PAGES; i++) {
+					if(candidate_page_[i] == a) {
+						candidate_page_[i] = NO_ADDRESS;
+						candidate_free_[i] = 0;
+					}
+				}
+			}
+
+			///@}
+
+			typename BlockStorage::self_pointer_t storage_;
+			typename OsModel::Debug::self_pointer_t debug_;
+			Tree tree_;
+
+			/// Currently loaded page (uint32 for alignment of the header)
+			::uint32_t page_data_[BLOCK_SIZE / sizeof(::uint32_t)];
+			address_t page_address_;
+
+			/// Page new records are appended to
+			address_t fill_page_;
+			address_t candidate_page_[CANDIDATE_PAGES];
+			::uint16_t candidate_free_[CANDIDATE_PAGES];
+
+			/// for returning values by get_value()
+			block_data_t value_buffer_[MAX_VALUE_SIZE];
+
+			size_type size_;
+			size_type pages_;
+
 	}; // BlockDictionary
+
+	template<
+		typename OsModel_P, typename BlockStorage_P, typename Hash_P
+	>
+	const typename BlockDictionary<OsModel_P, BlockStorage_P, Hash_P>::key_type BlockDictionary<OsModel_P, BlockStorage_P, Hash_P>::NULL_KEY = (key_type)(-1);
 }
 
 #endif // BLOCK_DICTIONARY_H
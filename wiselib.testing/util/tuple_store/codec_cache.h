@@ -0,0 +1,182 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef CODEC_CACHE_H
+#define CODEC_CACHE_H
+
+#include <util/types.h>
+#include <algorithms/hash/fnv.h>
+
+namespace wiselib {
+
+	/**
+	 * @brief Bounded LRU cache of zero-terminated strings by
+	 * zero-terminated strings, CodecTupleStore keeps the encodings and
+	 * decodings of hot terms in two of these.
+	 *
+	 * Holds copies of at most SIZE_P key / value pairs (one allocation
+	 * per pair) in a fixed table, chained by hash value. When full,
+	 * insert() drops the least recently used pair. Pointers returned by
+	 * find() and insert() point into the cache, they stay valid for at
+	 * least the next SIZE_P - 1 insert()s.
+	 *
+	 * @tparam SIZE_P Maximum number of pairs.
+	 */
+	template<
+		typename OsModel_P,
+		int SIZE_P,
+		typename Hash_P = Fnv1a<OsModel_P, ::uint32_t>
+	>
+	class CodecCache {
+
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef CodecCache<OsModel_P, SIZE_P, Hash_P> self_type;
+			typedef Hash_P Hash;
+			typedef typename Hash::hash_t hash_t;
+
+			enum { SIZE = SIZE_P };
+			enum { npos = (size_type)(-1) };
+
+			CodecCache() : used_(0), head_(npos), tail_(npos), hits_(0), misses_(0) {
+				for(size_type i = 0; i < SIZE; i++) { buckets_[i] = npos; }
+			}
+
+			~CodecCache() {
+				clear();
+			}
+
+			/**
+			 * @return the value cached for @a key or NULL.
+			 */
+			block_data_t* find(block_data_t *key) {
+				hash_t h = hash(key);
+				for(size_type e = buckets_[h % SIZE]; e != npos; e = entries_[e].chain) {
+					Entry &entry = entries_[e];
+					if(entry.hash == h && strcmp((char*)entry.data, (char*)key) == 0) {
+						unlink(e);
+						push_front(e);
+						hits_++;
+						return entry.data + entry.value;
+					}
+				}
+				misses_++;
+				return 0;
+			}
+
+			/**
+			 * Cache @a value for @a key, which must not be in the cache.
+			 * @return the cached copy of @a value.
+			 */
+			block_data_t* insert(block_data_t *key, block_data_t *value) {
+				size_type e;
+				if(used_ < SIZE) {
+					e = used_++;
+				}
+				else {
+					e = tail_;
+					unchain(e);
+					unlink(e);
+					::get_allocator().free_array(entries_[e].data);
+				}
+
+				Entry &entry = entries_[e];
+				size_type kl = strlen((char*)key) + 1;
+				size_type vl = strlen((char*)value) + 1;
+				entry.data = ::get_allocator().template allocate_array<block_data_t>(kl + vl).raw();
+				memcpy(entry.data, key, kl);
+				memcpy(entry.data + kl, value, vl);
+				entry.value = kl;
+				entry.hash = hash(key);
+				entry.chain = buckets_[entry.hash % SIZE];
+				buckets_[entry.hash % SIZE] = e;
+				push_front(e);
+				return entry.data + entry.value;
+			}
+
+			void clear() {
+				for(size_type e = 0; e < used_; e++) {
+					::get_allocator().free_array(entries_[e].data);
+				}
+				for(size_type i = 0; i < SIZE; i++) { buckets_[i] = npos; }
+				used_ = 0;
+				head_ = tail_ = npos;
+			}
+
+			size_type size() { return used_; }
+
+			///@{
+			///@name Statistics of find()
+			unsigned long hits() { return hits_; }
+			unsigned long misses() { return misses_; }
+			void reset_stats() { hits_ = misses_ = 0; }
+			///@}
+
+		private:
+			struct Entry {
+				/// key and value, both zero-terminated
+				block_data_t *data;
+				/// offset of the value in data
+				size_type value;
+				hash_t hash;
+				size_type prev, next, chain;
+			};
+
+			static hash_t hash(block_data_t *s) {
+				return Hash::hash(s, strlen((char*)s));
+			}
+
+			void push_front(size_type e) {
+				entries_[e].prev = npos;
+				entries_[e].next = head_;
+				if(head_ != npos) { entries_[head_].prev = e; }
+				head_ = e;
+				if(tail_ == npos) { tail_ = e; }
+			}
+
+			void unlink(size_type e) {
+				Entry &entry = entries_[e];
+				if(entry.prev != npos) { entries_[entry.prev].next = entry.next; }
+				else { head_ = entry.next; }
+				if(entry.next != npos) { entries_[entry.next].prev = entry.prev; }
+				else { tail_ = entry.prev; }
+			}
+
+			void unchain(size_type e) {
+				size_type *p = &buckets_[entries_[e].hash % SIZE];
+				while(*p != e) { p = &entries_[*p].chain; }
+				*p = entries_[e].chain;
+			}
+
+			Entry entries_[SIZE];
+			size_type buckets_[SIZE];
+			size_type used_;
+			size_type head_, tail_;
+			unsigned long hits_, misses_;
+
+			CodecCache(const self_type&);
+			self_type& operator=(const self_type&);
+
+	}; // CodecCache
+}
+
+#endif // CODEC_CACHE_H
+
@@ -2,12 +2,40 @@
 #ifndef CODEC_TUPLESTORE_H
 #define CODEC_TUPLESTORE_H
 
+#include <util/meta.h>
+#include "util/tuple_store/codec_cache.h"
+
 namespace wiselib {
+	
+	/**
+	 * @brief Tuple store that runs the CODEC_COLUMNS_P columns of all
+	 * tuples through Codec_P (eg. HuffmanCodec) on their way into and out
+	 * of ParentTupleStore_P.
+	 * 
+	 * Queries are encoded once per begin() and matched by the parent in
+	 * the encoded domain (for dictionary columns that is a comparison of
+	 * keys). This requires equal strings to have equal encodings, which
+	 * holds for deterministic codecs like HuffmanCodec.
+	 * 
+	 * With CACHE_SIZE_P > 0 the store keeps the encodings of the last
+	 * CACHE_SIZE_P distinct terms it encoded (inserts and queries) and the
+	 * decodings of the last CACHE_SIZE_P distinct terms it decoded
+	 * (iteration) in two CodecCaches, so hot terms like predicates or
+	 * frequently queried subjects are only run through the codec once.
+	 * The caches are keyed by content, so they never have to be
+	 * invalidated. Each holds at most CACHE_SIZE_P allocations (one per
+	 * key / value pair).
+	 * 
+	 * @tparam CODEC_COLUMNS_P Bitmask of the columns to encode.
+	 * @tparam CACHE_SIZE_P Number of terms to cache per direction, 0 for
+	 * no caching. At least the number of columns.
+	 */
 	template<
 		typename OsModel_P,
 		typename ParentTupleStore_P,
 		typename Codec_P,
-		::uint64_t CODEC_COLUMNS_P = 0
+		::uint64_t CODEC_COLUMNS_P = 0,
+		int CACHE_SIZE_P = 0
 	>
 	class CodecTupleStore {
 		public:
@@ -21,6 +49,7 @@ namespace wiselib {
 			enum { COLUMNS = ParentTupleStore::COLUMNS };
 			enum { DICTIONARY_COLUMNS = ParentTupleStore::DICTIONARY_COLUMNS };
 			enum { CODEC_COLUMNS = CODEC_COLUMNS_P };
+			enum { CACHE_SIZE = CACHE_SIZE_P };
 			
 			typedef typename ParentTupleStore::Tuple Tuple;
 			typedef typename ParentTupleStore::iterator ParentIterator;
@@ -28,8 +57,9 @@ namespace wiselib {
 			typedef typename ParentTupleStore::TupleContainer TupleContainer;
 			typedef typename ParentTupleStore::Dictionary Dictionary;
 			
-			typedef CodecTupleStore<OsModel, ParentTupleStore, Codec, CODEC_COLUMNS> self_type;
+			typedef CodecTupleStore<OsModel, ParentTupleStore, Codec, CODEC_COLUMNS, CACHE_SIZE> self_type;
 			typedef self_type* self_pointer_t;
+			typedef CodecCache<OsModel, (CACHE_SIZE > 0) ? CACHE_SIZE : 1> Cache;
 			
 			class Iterator {
 				// {{{
@@ -38,11 +68,11 @@ namespace wiselib {
 					enum { COLUMNS = Tuple::SIZE };
 					
 					
-					Iterator() {
+					Iterator() : store_(0) {
 					}
 					
-					Iterator(ParentIterator parent, ParentIterator parent_end, Tuple* query = 0, column_mask_t column_mask = 0) :
-						parent_iterator_(parent), parent_end_(parent_end), up_to_date_(false) {
+					Iterator(self_type *store, ParentIterator parent, ParentIterator parent_end, Tuple* query = 0, column_mask_t column_mask = 0) :
+						store_(store), parent_iterator_(parent), parent_end_(parent_end), up_to_date_(false) {
 							if(column_mask) {
 							set_query(*query, column_mask);
 							}
@@ -54,6 +84,7 @@ namespace wiselib {
 					
 					Iterator& operator=(const Iterator& oc) {
 						Iterator& o = const_cast<Iterator&>(oc);
+						store_ = o.store_;
 						parent_iterator_ = o.parent_iterator_;
 						parent_end_ = o.parent_end_;
 						current_.destruct_deep();
@@ -91,9 +122,9 @@ namespace wiselib {
 					void set_query(Tuple& query, column_mask_t mask) {
 						//parent_iterator_.set_mask(mask);
 						Tuple encoded_query;
-						encode_copy(encoded_query, query, mask);
+						column_mask_t owned = store_->encode_copy(encoded_query, query, mask);
 						parent_iterator_.set_query(encoded_query, mask);
-						free_encoded_copy(encoded_query, mask);
+						free_encoded_copy(encoded_query, owned);
 						//parent_iterator_.forward();
 					}
 					
@@ -105,12 +136,12 @@ namespace wiselib {
 					void update_current() {
 						current_.destruct_deep();
 						if(parent_iterator_ != parent_end_) {
-							Tuple t = *parent_iterator_;
-							decode_copy(current_, t);
+							store_->decode_copy(current_, *parent_iterator_);
 						}
 						up_to_date_ = true;
 					}
 						
+					self_type *store_;
 					Tuple current_;
 					ParentIterator parent_iterator_, parent_end_;
 					bool up_to_date_;
@@ -123,32 +154,70 @@ namespace wiselib {
 			
 			template<typename DictPtr, typename ContainerPtr>
 			void init(DictPtr d, ContainerPtr c, typename OsModel_P::Debug::self_pointer_t debug_) {
+				// encode_copy() must not evict a column it just encoded
+				static_assert(CACHE_SIZE == 0 || (int)CACHE_SIZE >= (int)COLUMNS);
 				parent_.init(d, c, debug_);
 			}
 			
 			iterator insert(Tuple& t) {
 				Tuple encoded;
-				encode_copy(encoded, t);
+				column_mask_t owned = encode_copy(encoded, t);
 				ParentIterator i = parent_.insert(encoded);
-				encoded.destruct_deep();
-				iterator r(i, parent_.end());
+				free_encoded_copy(encoded, owned);
+				iterator r(this, i, parent_.end());
 				return r;
 			}
 			
+			/**
+			 * Insert the @a n tuples at @a tuples.
+			 */
+			void insert(Tuple *tuples, size_type n) {
+				Tuple encoded;
+				for(size_type j = 0; j < n; j++) {
+					column_mask_t owned = encode_copy(encoded, tuples[j]);
+					parent_.insert(encoded);
+					free_encoded_copy(encoded, owned);
+				}
+			}
+			
+			/**
+			 * Encode the @a n tuples at @a from into the ones at @a to,
+			 * which get deep copies (free them with destruct_deep()).
+			 */
+			void encode(Tuple *to, Tuple *from, size_type n) {
+				for(size_type j = 0; j < n; j++) {
+					column_mask_t owned = encode_copy(to[j], from[j]);
+					for(size_type i = 0; i < COLUMNS; i++) {
+						if(!(owned & (1 << i))) { to[j].set_deep(i, to[j].get(i)); }
+					}
+				}
+			}
+			
+			/**
+			 * Decode the @a n tuples at @a from (as they are in the parent
+			 * tuple store) into the ones at @a to, which get deep copies
+			 * (free them with destruct_deep()).
+			 */
+			void decode(Tuple *to, Tuple *from, size_type n) {
+				for(size_type j = 0; j < n; j++) {
+					decode_copy(to[j], from[j]);
+				}
+			}
+			
 			iterator erase(iterator iter) {
 				ParentIterator i = parent_.erase(iter.parent_iterator());
 				iter.parent_iterator_ = parent_.end();
-				iterator r(i, parent_.end());
+				iterator r(this, i, parent_.end());
 				return r;
 			}
 			
 			iterator begin(Tuple* query = 0, column_mask_t mask = 0) {
-				iterator r(parent_.begin(), parent_.end(), query, mask);
+				iterator r(this, parent_.begin(), parent_.end(), query, mask);
 				return r;
 			}
 			
 			iterator end() {
-				iterator r(parent_.end(), parent_.end());
+				iterator r(this, parent_.end(), parent_.end());
 				return r;
 			}
 			
@@ -156,34 +225,52 @@ namespace wiselib {
 			
 			size_type size() { return parent_.size(); }
 			
+			/// See TupleStore::version().
+			typename ParentTupleStore::version_t version() { return parent_.version(); }
+			
+			///@{
+			///@name Term caches (unused if CACHE_SIZE is 0)
+			Cache& encode_cache() { return encode_cache_; }
+			Cache& decode_cache() { return decode_cache_; }
+			///@}
+			
 		private:
-			static void encode_copy(Tuple& to, Tuple& from, column_mask_t mask = (column_mask_t)(-1)) {
+			/**
+			 * Set the columns in @a mask of @a to to the encoded columns
+			 * of @a from. Columns that are not encoded and encodings from
+			 * the cache are not copied.
+			 * 
+			 * @return mask of the columns of @a to that have to be freed
+			 * with free_encoded_copy().
+			 */
+			column_mask_t encode_copy(Tuple& to, Tuple& from, column_mask_t mask = (column_mask_t)(-1)) {
+				column_mask_t owned = 0;
 				for(size_type i = 0; i<COLUMNS; i++) {
 					if(mask & (1 << i)) {
-						if(CODEC_COLUMNS & (1 << i)) { to.set(i, Codec::encode(from.get(i))); }
-						else { to.set_deep(i, from.get(i)); }
+						if(!(CODEC_COLUMNS & (1 << i))) { to.set(i, from.get(i)); }
+						else if(CACHE_SIZE > 0) { to.set(i, encode_cached(from.get(i))); }
+						else {
+							to.set(i, Codec::encode(from.get(i)));
+							owned |= (1 << i);
+						}
 					}
 				}
+				return owned;
 			}
 			
-			static void free_encoded_copy(Tuple& to, column_mask_t mask = (column_mask_t)(-1)) {
+			static void free_encoded_copy(Tuple& to, column_mask_t owned) {
 				for(size_type i = 0; i<COLUMNS; i++) {
-					if(mask & (1 << i)) {
-						if(CODEC_COLUMNS & (1 << i)) {
-							if(to.get(i)) {
-								to.free_deep(i);
-								to.set(i, 0);
-							}
-						}
+					if((owned & (1 << i)) && to.get(i)) {
+						to.free_deep(i);
+						to.set(i, 0);
 					}
 				}
 			}
 			
-			static void decode_copy(Tuple& to, Tuple& from) {
+			void decode_copy(Tuple& to, Tuple& from) {
 				for(size_type i = 0; i<COLUMNS; i++) {
 					if(CODEC_COLUMNS & (1 << i)) {
-						block_data_t *r = Codec::decode(from.get(i));
-						to.set(i, r);
+						to.set(i, decode(from.get(i)));
 					}
 					else { 
 						to.set_deep(i, from.get(i));
@@ -191,7 +278,42 @@ namespace wiselib {
 				}
 			}
 			
+			/**
+			 * @return encoding of @a s, owned by the encode cache.
+			 */
+			block_data_t* encode_cached(block_data_t *s) {
+				block_data_t *r = encode_cache_.find(s);
+				if(!r) {
+					block_data_t *e = Codec::encode(s);
+					r = encode_cache_.insert(s, e);
+					Codec::free_result(e);
+				}
+				return r;
+			}
+			
+			/**
+			 * @return decoding of @a s, owned by the caller.
+			 */
+			block_data_t* decode(block_data_t *s) {
+				if(CACHE_SIZE == 0) {
+					return Codec::decode(s);
+				}
+				
+				block_data_t *r = decode_cache_.find(s);
+				if(r) {
+					size_type l = strlen((char*)r) + 1;
+					block_data_t *d = ::get_allocator().template allocate_array<block_data_t>(l).raw();
+					memcpy(d, r, l);
+					return d;
+				}
+				r = Codec::decode(s);
+				decode_cache_.insert(s, r);
+				return r;
+			}
+			
 			ParentTupleStore parent_;
+			Cache encode_cache_;
+			Cache decode_cache_;
 	};
 	
 } // namespace wiselib
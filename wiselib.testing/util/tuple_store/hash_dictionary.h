@@ -0,0 +1,435 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef HASH_DICTIONARY_H
+#define HASH_DICTIONARY_H
+
+#include <algorithms/hash/fnv.h>
+
+namespace wiselib {
+
+	/**
+	 * \brief Interning dictionary for (0-terminated) strings with an open
+	 * addressing hash index.
+	 *
+	 * Strings are appended to one contiguous arena. Every string has an
+	 * entry in a side array, and the entry's index is the string's key.
+	 * The entry holds the arena offset, the length, the precomputed hash
+	 * value and the reference count. So keys are small integers that
+	 * stay valid until the string's last reference is erased. Keys of
+	 * erased strings are reused.
+	 *
+	 * The index is a power-of-two table of keys with linear probing.
+	 * Erasing uses backward shift instead of tombstones. Lookups compare
+	 * the stored hash and length before touching the arena. Growing the
+	 * index rehashes from the stored hash values only.
+	 *
+	 * The space of erased strings is reclaimed by compacting the arena
+	 * once more than half of it is garbage. This moves strings around, so
+	 * pointers returned by get_value() are only valid until the next
+	 * insert() or erase(). Keys are not affected.
+	 *
+	 * \ingroup ConcreteBDTDictionary_concept
+	 *
+	 * \tparam Hash_P Hash function for strings (default FNV-1a, 32 bit).
+	 */
+	template<
+		typename OsModel_P,
+		typename Hash_P = Fnv1a<OsModel_P, ::uint32_t>
+	>
+	class HashDictionary {
+
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef Hash_P Hash;
+			typedef typename Hash::hash_t hash_t;
+			typedef HashDictionary<OsModel_P, Hash_P> self_type;
+			typedef self_type* self_pointer_t;
+
+			typedef ::uint32_t key_type;
+			typedef block_data_t* mapped_type;
+			typedef ::uint32_t refcount_t;
+
+			enum { ABSTRACT_KEYS = true };
+			static const key_type NULL_KEY;
+
+			enum ErrorCodes {
+				SUCCESS = OsModel::SUCCESS
+			};
+
+			enum {
+				/// Initial number of index slots (power of two).
+				MIN_SLOTS = 16,
+				/// Initial number of entries.
+				MIN_ENTRIES = 8,
+				/// Initial arena size in bytes.
+				MIN_ARENA = 256
+			};
+
+		private:
+			struct Entry {
+				/// Offset in the arena, next free key for unused entries.
+				::uint32_t offset;
+				/// String length without terminator.
+				::uint32_t length;
+				hash_t hash;
+				/// 0 for unused entries.
+				refcount_t refcount;
+			};
+
+		public:
+			/**
+			 * Iterates over the keys of all stored strings in key order.
+			 */
+			class key_iterator {
+				public:
+					key_iterator() : dictionary_(0), key_(NULL_KEY) {
+					}
+
+					key_iterator(self_pointer_t dictionary, key_type k) : dictionary_(dictionary), key_(k) {
+						forward();
+					}
+
+					bool operator==(const key_iterator& other) { return key_ == other.key_; }
+					bool operator!=(const key_iterator& other) { return key_ != other.key_; }
+
+					const key_iterator& operator++() {
+						key_++;
+						forward();
+						return *this;
+					}
+
+					key_type operator*() { return key_; }
+					const key_type* operator->() const { return &key_; }
+
+				private:
+					void forward() {
+						while(key_ < dictionary_->entries_used_ && dictionary_->entries_[key_].refcount == 0) {
+							key_++;
+						}
+						if(key_ >= dictionary_->entries_used_) { key_ = NULL_KEY; }
+					}
+
+					self_pointer_t dictionary_;
+					key_type key_;
+			};
+			typedef key_iterator iterator;
+
+			HashDictionary() : slots_(0), slot_mask_(0), entries_(0), entries_used_(0), entries_capacity_(0),
+					free_key_(NULL_KEY), arena_(0), arena_used_(0), arena_capacity_(0), garbage_(0), size_(0) {
+			}
+
+			~HashDictionary() {
+				destruct();
+			}
+
+			int init(typename OsModel::Debug::self_pointer_t debug) {
+				debug_ = debug;
+				return SUCCESS;
+			}
+
+			/// Free all memory, the dictionary is empty afterwards.
+			int destruct() {
+				if(slots_) { get_allocator().free_array(slots_); }
+				if(entries_) { get_allocator().free_array(entries_); }
+				if(arena_) { get_allocator().free_array(arena_); }
+				slots_ = 0;
+				slot_mask_ = 0;
+				entries_ = 0;
+				entries_used_ = 0;
+				entries_capacity_ = 0;
+				free_key_ = NULL_KEY;
+				arena_ = 0;
+				arena_used_ = 0;
+				arena_capacity_ = 0;
+				garbage_ = 0;
+				size_ = 0;
+				return SUCCESS;
+			}
+
+			key_iterator begin_keys() { return key_iterator(this, 0); }
+			key_iterator end_keys() { return key_iterator(); }
+
+			/**
+			 * Insert a string or increase its reference count if it is
+			 * already present. value may point into this dictionary
+			 * (i.e. come from get_value()).
+			 *
+			 * @return key of the string.
+			 */
+			key_type insert(mapped_type value) {
+				size_type l = strlen(reinterpret_cast<char*>(value));
+				hash_t h = Hash::hash(value, l);
+
+				size_type slot;
+				key_type k = lookup(value, l, h, slot);
+				if(k != NULL_KEY) {
+					entries_[k].refcount++;
+					return k;
+				}
+
+				if((size_ + 1) * 4 > (slot_mask_ + 1) * 3) {
+					grow_index();
+					lookup(value, l, h, slot);
+				}
+
+				k = allocate_entry();
+				Entry &e = entries_[k];
+				e.offset = append(value, l);
+				e.length = l;
+				e.hash = h;
+				e.refcount = 1;
+				slots_[slot] = k;
+				size_++;
+				return k;
+			}
+
+			/**
+			 * @return key of the given string or NULL_KEY if it is not
+			 * in the dictionary.
+			 */
+			key_type find(mapped_type value) {
+				if(!size_) { return NULL_KEY; }
+				size_type l = strlen(reinterpret_cast<char*>(value));
+				size_type slot;
+				return lookup(value, l, Hash::hash(value, l), slot);
+			}
+
+			/**
+			 * Decrease the reference count of the given entry, remove it
+			 * if the count drops to zero.
+			 */
+			void erase(key_type k) {
+				if(k == NULL_KEY || k >= entries_used_ || entries_[k].refcount == 0) { return; }
+
+				Entry &e = entries_[k];
+				if(--e.refcount) { return; }
+
+				// backward shift deletion
+				size_type i = e.hash & slot_mask_;
+				while(slots_[i] != k) { i = (i + 1) & slot_mask_; }
+				for(size_type j = (i + 1) & slot_mask_; slots_[j] != NULL_KEY; j = (j + 1) & slot_mask_) {
+					size_type home = entries_[slots_[j]].hash & slot_mask_;
+					if(((j - home) & slot_mask_) >= ((j - i) & slot_mask_)) {
+						slots_[i] = slots_[j];
+						i = j;
+					}
+				}
+				slots_[i] = NULL_KEY;
+
+				garbage_ += e.length + 1;
+				e.offset = free_key_;
+				free_key_ = k;
+				size_--;
+
+				if(garbage_ > MIN_ARENA && 2 * garbage_ > arena_used_) {
+					compact();
+				}
+			}
+
+			/**
+			 * Increase the reference count of the given entry by @a n, as
+			 * @a n insert()s of its string would (for bulk loading).
+			 */
+			void add_references(key_type k, refcount_t n) {
+				if(k == NULL_KEY || k >= entries_used_ || entries_[k].refcount == 0) { return; }
+				entries_[k].refcount += n;
+			}
+
+			/**
+			 * @return key of a string with the given hash value, NULL_KEY
+			 * if there is none. If several strings share the hash value,
+			 * one of them.
+			 */
+			key_type find_hash(hash_t h) {
+				if(!size_) { return NULL_KEY; }
+				for(size_type i = h & slot_mask_; slots_[i] != NULL_KEY; i = (i + 1) & slot_mask_) {
+					if(entries_[slots_[i]].hash == h) { return slots_[i]; }
+				}
+				return NULL_KEY;
+			}
+
+			/**
+			 * @return reference count of the given entry.
+			 */
+			size_type count(key_type k) {
+				return (k < entries_used_) ? entries_[k].refcount : 0;
+			}
+
+			/**
+			 * @return the string for the given key, valid until the next
+			 * insert() or erase().
+			 */
+			mapped_type operator[](key_type k) { return arena_ + entries_[k].offset; }
+
+			mapped_type get(key_type k) { return (*this)[k]; }
+			mapped_type get_value(key_type k) { return (*this)[k]; }
+
+			void free_value(mapped_type v) { }
+
+			/// Length of the string for the given key (without terminator).
+			size_type length(key_type k) { return entries_[k].length; }
+
+			/// Stored hash value of the string for the given key.
+			hash_t hash(key_type k) { return entries_[k].hash; }
+
+			/// Number of distinct strings.
+			size_type size() { return size_; }
+
+			/// Bytes allocated for arena, entries and index.
+			size_type memory() {
+				return arena_capacity_ + entries_capacity_ * sizeof(Entry) + (slots_ ? (slot_mask_ + 1) * sizeof(key_type) : 0);
+			}
+
+		private:
+
+			/**
+			 * @return key of the string, NULL_KEY if not present. In
+			 * that case slot is the free index slot it would go to.
+			 */
+			key_type lookup(const block_data_t *value, size_type l, hash_t h, size_type& slot) {
+				if(!slots_) {
+					slot = 0;
+					return NULL_KEY;
+				}
+				for(size_type i = h & slot_mask_; ; i = (i + 1) & slot_mask_) {
+					key_type k = slots_[i];
+					if(k == NULL_KEY) {
+						slot = i;
+						return NULL_KEY;
+					}
+					const Entry &e = entries_[k];
+					if(e.hash == h && e.length == l && memcmp(arena_ + e.offset, value, l) == 0) {
+						slot = i;
+						return k;
+					}
+				}
+			}
+
+			void grow_index() {
+				size_type n = slots_ ? 2 * (slot_mask_ + 1) : (size_type)MIN_SLOTS;
+				key_type *old = slots_;
+				slots_ = get_allocator().template allocate_array<key_type>(n) .raw();
+				slot_mask_ = n - 1;
+				for(size_type i = 0; i < n; i++) { slots_[i] = NULL_KEY; }
+
+				// rehash from the stored hash values
+				for(key_type k = 0; k < entries_used_; k++) {
+					if(entries_[k].refcount == 0) { continue; }
+					size_type i = entries_[k].hash & slot_mask_;
+					while(slots_[i] != NULL_KEY) { i = (i + 1) & slot_mask_; }
+					slots_[i] = k;
+				}
+				if(old) { get_allocator().free_array(old); }
+			}
+
+			key_type allocate_entry() {
+				if(free_key_ != NULL_KEY) {
+					key_type k = free_key_;
+					free_key_ = entries_[k].offset;
+					return k;
+				}
+				if(entries_used_ == entries_capacity_) {
+					size_type n = entries_capacity_ ? 2 * entries_capacity_ : (size_type)MIN_ENTRIES;
+					Entry *e = get_allocator().template allocate_array<Entry>(n) .raw();
+					if(entries_) {
+						memcpy((void*)e, (void*)entries_, entries_used_ * sizeof(Entry));
+						get_allocator().free_array(entries_);
+					}
+					entries_ = e;
+					entries_capacity_ = n;
+				}
+				return entries_used_++;
+			}
+
+			/**
+			 * Copy l bytes and a terminator to the end of the arena.
+			 * @return offset of the copy
+			 */
+			::uint32_t append(const block_data_t *value, size_type l) {
+				if(arena_used_ + l + 1 > arena_capacity_) {
+					size_type n = arena_capacity_ ? 2 * arena_capacity_ : (size_type)MIN_ARENA;
+					while(n < arena_used_ + l + 1) { n *= 2; }
+					block_data_t *a = get_allocator().template allocate_array<block_data_t>(n) .raw();
+					if(arena_) {
+						memcpy(a, arena_, arena_used_);
+						// value may be a string in the old arena
+						if(value >= arena_ && value < arena_ + arena_used_) {
+							value = a + (value - arena_);
+						}
+						get_allocator().free_array(arena_);
+					}
+					arena_ = a;
+					arena_capacity_ = n;
+				}
+				::uint32_t offset = arena_used_;
+				memcpy(arena_ + offset, value, l);
+				arena_[offset + l] = '\0';
+				arena_used_ += l + 1;
+				return offset;
+			}
+
+			/**
+			 * Move all live strings into a new arena without gaps.
+			 */
+			void compact() {
+				size_type used = arena_used_ - garbage_;
+				size_type n = MIN_ARENA;
+				while(n < 2 * used) { n *= 2; }
+				block_data_t *a = get_allocator().template allocate_array<block_data_t>(n) .raw();
+				::uint32_t offset = 0;
+				for(key_type k = 0; k < entries_used_; k++) {
+					Entry &e = entries_[k];
+					if(e.refcount == 0) { continue; }
+					memcpy(a + offset, arena_ + e.offset, e.length + 1);
+					e.offset = offset;
+					offset += e.length + 1;
+				}
+				get_allocator().free_array(arena_);
+				arena_ = a;
+				arena_used_ = offset;
+				arena_capacity_ = n;
+				garbage_ = 0;
+			}
+
+			key_type *slots_;
+			size_type slot_mask_;
+			Entry *entries_;
+			size_type entries_used_;
+			size_type entries_capacity_;
+			key_type free_key_;
+			block_data_t *arena_;
+			size_type arena_used_;
+			size_type arena_capacity_;
+			size_type garbage_;
+			size_type size_;
+			typename OsModel::Debug::self_pointer_t debug_;
+
+	}; // HashDictionary
+
+	template<
+		typename OsModel_P, typename Hash_P
+	>
+	const typename HashDictionary<OsModel_P, Hash_P>::key_type HashDictionary<OsModel_P, Hash_P>::NULL_KEY = (key_type)(-1);
+}
+
+#endif // HASH_DICTIONARY_H
+
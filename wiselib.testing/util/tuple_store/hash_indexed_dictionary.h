@@ -0,0 +1,318 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef HASH_INDEXED_DICTIONARY_H
+#define HASH_INDEXED_DICTIONARY_H
+
+#include <util/tuple_store/hash_dictionary.h>
+
+namespace wiselib {
+
+	/**
+	 * \brief Adds a complete hash value <-> key index to any dictionary.
+	 *
+	 * Wraps Dictionary_P and keeps two open addressing tables in sync
+	 * with insert() and erase():
+	 *  - by hash value: the keys of all strings (find_hash())
+	 *  - by key: the hash value and the reference count (hash())
+	 * so hash values are computed once per distinct string, when it is
+	 * first inserted.
+	 *
+	 * Keys must be convertible to an integer (by a C-style cast, so
+	 * pointers work as well) and NULL_KEY must never be a valid key.
+	 *
+	 * Everything else is forwarded to the wrapped dictionary, init() takes
+	 * the arguments of its init().
+	 *
+	 * \ingroup ConcreteBDTDictionary_concept
+	 *
+	 * \tparam Hash_P Hash function for the index, typically the one of the
+	 *   INQP query processor.
+	 */
+	template<
+		typename OsModel_P,
+		typename Dictionary_P,
+		typename Hash_P
+	>
+	class HashIndexedDictionary {
+
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef Dictionary_P Dictionary;
+			typedef Hash_P Hash;
+			typedef typename Hash::hash_t hash_t;
+			typedef HashIndexedDictionary<OsModel_P, Dictionary_P, Hash_P> self_type;
+			typedef self_type* self_pointer_t;
+
+			typedef typename Dictionary::key_type key_type;
+			typedef typename Dictionary::mapped_type mapped_type;
+			typedef typename Dictionary::iterator iterator;
+			typedef ::uint32_t refcount_t;
+
+			enum { ABSTRACT_KEYS = Dictionary::ABSTRACT_KEYS };
+			static const key_type NULL_KEY;
+
+			enum ErrorCodes {
+				SUCCESS = OsModel::SUCCESS
+			};
+
+			enum { MIN_SLOTS = 16 };
+
+		private:
+			struct HashSlot {
+				hash_t hash;
+				key_type key;
+
+				size_type home() const { return mix((unsigned long)hash); }
+			};
+
+			struct KeySlot {
+				key_type key;
+				hash_t hash;
+				refcount_t refcount;
+
+				size_type home() const { return mix((unsigned long)key); }
+			};
+
+		public:
+			HashIndexedDictionary() : by_hash_(0), by_key_(0), slot_mask_(0), size_(0) {
+			}
+
+			~HashIndexedDictionary() {
+				clear_index();
+			}
+
+			template<typename A>
+			int init(A a) {
+				clear_index();
+				return dictionary_.init(a);
+			}
+
+			template<typename A, typename B>
+			int init(A a, B b) {
+				clear_index();
+				return dictionary_.init(a, b);
+			}
+
+			Dictionary& dictionary() { return dictionary_; }
+
+			iterator begin_keys() { return dictionary_.begin_keys(); }
+			iterator end_keys() { return dictionary_.end_keys(); }
+
+			key_type insert(mapped_type value) {
+				key_type k = dictionary_.insert(value);
+				if(k == NULL_KEY) { return k; }
+
+				size_type i = find_key_slot(k);
+				if(i != NO_SLOT) {
+					by_key_[i].refcount++;
+					return k;
+				}
+
+				if((size_ + 1) * 4 > (slot_mask_ + 1) * 3) { grow(); }
+				hash_t h = Hash::hash(value, strlen(reinterpret_cast<char*>(value)));
+
+				HashSlot &hs = by_hash_[free_slot(by_hash_, mix((unsigned long)h))];
+				hs.hash = h;
+				hs.key = k;
+				KeySlot &ks = by_key_[free_slot(by_key_, mix((unsigned long)k))];
+				ks.key = k;
+				ks.hash = h;
+				ks.refcount = 1;
+				size_++;
+				return k;
+			}
+
+			key_type find(mapped_type value) { return dictionary_.find(value); }
+
+			void erase(key_type k) {
+				size_type i = find_key_slot(k);
+				if(i == NO_SLOT) { return; }
+				dictionary_.erase(k);
+				if(--by_key_[i].refcount) { return; }
+
+				hash_t h = by_key_[i].hash;
+				remove(by_key_, i);
+				for(i = mix((unsigned long)h) & slot_mask_; by_hash_[i].key != k; i = (i + 1) & slot_mask_) {
+				}
+				remove(by_hash_, i);
+				size_--;
+			}
+
+			/**
+			 * @return key of a string with the given hash value, NULL_KEY
+			 * if there is none. If several strings share the hash value,
+			 * one of them.
+			 */
+			key_type find_hash(hash_t h) {
+				if(!size_) { return NULL_KEY; }
+				for(size_type i = mix((unsigned long)h) & slot_mask_; by_hash_[i].key != NULL_KEY; i = (i + 1) & slot_mask_) {
+					if(by_hash_[i].hash == h) { return by_hash_[i].key; }
+				}
+				return NULL_KEY;
+			}
+
+			/// Hash value of the string for the given key.
+			hash_t hash(key_type k) {
+				size_type i = find_key_slot(k);
+				return (i == NO_SLOT) ? 0 : by_key_[i].hash;
+			}
+
+			size_type count(key_type k) {
+				size_type i = find_key_slot(k);
+				return (i == NO_SLOT) ? 0 : by_key_[i].refcount;
+			}
+
+			mapped_type get(key_type k) { return dictionary_.get_value(k); }
+			mapped_type get_value(key_type k) { return dictionary_.get_value(k); }
+			void free_value(mapped_type v) { dictionary_.free_value(v); }
+
+			/// Number of distinct strings.
+			size_type size() { return size_; }
+
+		private:
+			enum { NO_SLOT = (size_type)(-1) };
+
+			static size_type mix(unsigned long x) {
+				x ^= x >> 16;
+				x *= 0x45d9f3bUL;
+				x ^= x >> 16;
+				return x;
+			}
+
+			size_type find_key_slot(key_type k) {
+				if(!size_) { return NO_SLOT; }
+				for(size_type i = mix((unsigned long)k) & slot_mask_; by_key_[i].key != NULL_KEY; i = (i + 1) & slot_mask_) {
+					if(by_key_[i].key == k) { return i; }
+				}
+				return NO_SLOT;
+			}
+
+			template<typename Slot>
+			size_type free_slot(Slot *table, size_type home) {
+				size_type i = home & slot_mask_;
+				while(table[i].key != NULL_KEY) { i = (i + 1) & slot_mask_; }
+				return i;
+			}
+
+			/// backward shift deletion of slot i
+			template<typename Slot>
+			void remove(Slot *table, size_type i) {
+				for(size_type j = (i + 1) & slot_mask_; table[j].key != NULL_KEY; j = (j + 1) & slot_mask_) {
+					size_type home = table[j].home() & slot_mask_;
+					if(((j - home) & slot_mask_) >= ((j - i) & slot_mask_)) {
+						table[i] = table[j];
+						i = j;
+					}
+				}
+				table[i].key = NULL_KEY;
+			}
+
+			void grow() {
+				size_type n = by_hash_ ? 2 * (slot_mask_ + 1) : (size_type)MIN_SLOTS;
+				HashSlot *old_hash = by_hash_;
+				KeySlot *old_key = by_key_;
+				size_type old_n = by_hash_ ? slot_mask_ + 1 : 0;
+
+				by_hash_ = get_allocator().template allocate_array<HashSlot>(n) .raw();
+				by_key_ = get_allocator().template allocate_array<KeySlot>(n) .raw();
+				slot_mask_ = n - 1;
+				for(size_type i = 0; i < n; i++) {
+					by_hash_[i].key = NULL_KEY;
+					by_key_[i].key = NULL_KEY;
+				}
+				for(size_type i = 0; i < old_n; i++) {
+					if(old_hash[i].key != NULL_KEY) {
+						by_hash_[free_slot(by_hash_, old_hash[i].home())] = old_hash[i];
+					}
+					if(old_key[i].key != NULL_KEY) {
+						by_key_[free_slot(by_key_, old_key[i].home())] = old_key[i];
+					}
+				}
+				if(old_hash) {
+					get_allocator().free_array(old_hash);
+					get_allocator().free_array(old_key);
+				}
+			}
+
+			void clear_index() {
+				if(by_hash_) {
+					get_allocator().free_array(by_hash_);
+					get_allocator().free_array(by_key_);
+				}
+				by_hash_ = 0;
+				by_key_ = 0;
+				slot_mask_ = 0;
+				size_ = 0;
+			}
+
+			Dictionary dictionary_;
+			HashSlot *by_hash_;
+			KeySlot *by_key_;
+			size_type slot_mask_;
+			size_type size_;
+
+	}; // HashIndexedDictionary
+
+	template<
+		typename OsModel_P, typename Dictionary_P, typename Hash_P
+	>
+	const typename HashIndexedDictionary<OsModel_P, Dictionary_P, Hash_P>::key_type
+	HashIndexedDictionary<OsModel_P, Dictionary_P, Hash_P>::NULL_KEY = Dictionary_P::NULL_KEY;
+
+	/**
+	 * Whether Dictionary_P keeps a complete hash value <-> key index for
+	 * Hash_P (find_hash() and hash()).
+	 */
+	template<typename Dictionary_P, typename Hash_P>
+	struct DictionaryHashIndex { enum { value = false }; };
+
+	template<typename OsModel_P, typename Hash_P>
+	struct DictionaryHashIndex<HashDictionary<OsModel_P, Hash_P>, Hash_P> { enum { value = true }; };
+
+	template<typename OsModel_P, typename Dictionary_P, typename Hash_P>
+	struct DictionaryHashIndex<HashIndexedDictionary<OsModel_P, Dictionary_P, Hash_P>, Hash_P> { enum { value = true }; };
+
+	/**
+	 * find_hash() / hash() for dictionaries with a hash index, for the
+	 * others INDEXED is false and the functions must not be called.
+	 */
+	template<
+		typename Dictionary_P,
+		typename Hash_P,
+		bool INDEXED_P = DictionaryHashIndex<Dictionary_P, Hash_P>::value
+	>
+	struct DictionaryHashLookup {
+		enum { INDEXED = false };
+		static typename Dictionary_P::key_type find_hash(Dictionary_P&, typename Hash_P::hash_t) { return Dictionary_P::NULL_KEY; }
+		static typename Hash_P::hash_t hash(Dictionary_P&, typename Dictionary_P::key_type) { return 0; }
+	};
+
+	template<typename Dictionary_P, typename Hash_P>
+	struct DictionaryHashLookup<Dictionary_P, Hash_P, true> {
+		enum { INDEXED = true };
+		static typename Dictionary_P::key_type find_hash(Dictionary_P& d, typename Hash_P::hash_t h) { return d.find_hash(h); }
+		static typename Hash_P::hash_t hash(Dictionary_P& d, typename Dictionary_P::key_type k) { return d.hash(k); }
+	};
+}
+
+#endif // HASH_INDEXED_DICTIONARY_H
+
@@ -0,0 +1,513 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef N3_BULK_LOADER_H
+#define N3_BULK_LOADER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
+
+#include "external_interface/pc/pc_thread_pool.h"
+#include "util/split_n3.h"
+#include "util/tuple_store/hash_dictionary.h"
+#include "util/tuple_store/prescilla_dictionary.h"
+#include "algorithms/hash/fnv.h"
+
+namespace wiselib {
+	
+	namespace N3BulkLoader_detail {
+		
+		/**
+		 * Add @a n references to the string @a s with key @a k. The
+		 * dictionary concept only has insert() for that.
+		 */
+		template<typename Dictionary_P>
+		struct References {
+			static void add(Dictionary_P& d, typename Dictionary_P::key_type k, typename Dictionary_P::mapped_type s, size_t n) {
+				for( ; n; n--) { d.insert(s); }
+			}
+		};
+		
+		template<typename OsModel_P, typename Hash_P>
+		struct References< HashDictionary<OsModel_P, Hash_P> > {
+			typedef HashDictionary<OsModel_P, Hash_P> Dictionary;
+			
+			static void add(Dictionary& d, typename Dictionary::key_type k, typename Dictionary::mapped_type s, size_t n) {
+				d.add_references(k, n);
+			}
+		};
+		
+		template<typename OsModel_P, typename Debug_P>
+		struct References< PrescillaDictionary<OsModel_P, Debug_P> > {
+			typedef PrescillaDictionary<OsModel_P, Debug_P> Dictionary;
+			
+			static void add(Dictionary& d, typename Dictionary::key_type k, typename Dictionary::mapped_type s, size_t n) {
+				d.add_references(k, n);
+			}
+		};
+	}
+	
+	/**
+	 * @brief Bulk loader for N-Triples / N-Quads files into a TupleStore,
+	 * parsing in parallel.
+	 * 
+	 * The input is mmapped (or read in chunks if it is not a regular
+	 * file) and processed in batches of about BATCH_BYTES_P bytes that
+	 * end on line boundaries. Every batch is split into one slice per
+	 * worker, again on line boundaries, and the workers
+	 * 
+	 * 1. parse their lines in place (SplitN3::parse_line_in_place()),
+	 *    keeping the first Tuple::SIZE elements of every line, lines with
+	 *    less elements and comment lines are skipped,
+	 * 2. deduplicate the terms of their slice in a hash table of their
+	 *    own.
+	 * 
+	 * Then the distinct terms of all workers are interned, one
+	 * Dictionary::insert() per distinct term and worker instead of one per
+	 * term occurrence. The workers translate their tuples to dictionary
+	 * keys and sort them, the sorted runs are merged into the tuple
+	 * container. Last, the dictionary reference counts are adjusted to
+	 * the number of tuples the container actually took, so they end up as
+	 * if every tuple had been inserted with TupleStore::insert().
+	 * 
+	 * This only pays off when Dictionary::insert() is expensive
+	 * (PrescillaDictionary, about 2x faster than line by line insertion
+	 * with a single thread). The per worker deduplication costs about as
+	 * much as a HashDictionary::insert() (both hash and compare every
+	 * term occurrence), so with HashDictionary the batch pipeline is
+	 * pure overhead and the loader is slower than fgets() and
+	 * TupleStore::insert() per line, up to 2.4x with one thread. It
+	 * only catches up when parsing is spread over enough cores.
+	 *
+	 * Dictionary and container are only touched from the calling thread.
+	 * Only the dictionary columns (DICTIONARY_COLUMNS) of the tuple store
+	 * are interned, the others are deep copied as TupleStore::insert()
+	 * does.
+	 * 
+	 * Uses threads, mmap and the STL, so this is for PC only.
+	 * 
+	 * @tparam TupleStore_P TupleStore to load into, for a CodecTupleStore
+	 * that is its parent_tuple_store() if it does not encode any columns.
+	 * @tparam BATCH_BYTES_P Batch size, the terms of a batch are kept in
+	 * memory until the batch is inserted.
+	 */
+	template<
+		typename OsModel_P,
+		typename TupleStore_P,
+		int BATCH_BYTES_P = (8 << 20),
+		typename Hash_P = Fnv1a<OsModel_P, ::uint32_t>
+	>
+	class N3BulkLoader {
+		
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef N3BulkLoader<OsModel_P, TupleStore_P, BATCH_BYTES_P, Hash_P> self_type;
+			typedef PCThreadPool<OsModel> ThreadPool;
+			typedef typename ThreadPool::size_type size_type;
+			typedef TupleStore_P TupleStoreT;
+			typedef typename TupleStoreT::Tuple Tuple;
+			typedef typename TupleStoreT::Dictionary Dictionary;
+			typedef typename TupleStoreT::TupleContainer TupleContainer;
+			typedef typename Dictionary::key_type key_type;
+			typedef Hash_P Hash;
+			typedef typename Hash::hash_t hash_t;
+			
+			enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+			enum {
+				COLUMNS = Tuple::SIZE,
+				DICTIONARY_COLUMNS = TupleStoreT::DICTIONARY_COLUMNS,
+				BATCH_BYTES = BATCH_BYTES_P
+			};
+			
+			N3BulkLoader() : tuple_store_(0), tuples_(0), inserted_(0), skipped_(0) {
+			}
+			
+			/**
+			 * @param threads number of workers including the calling
+			 * thread, 0 = one per cpu.
+			 */
+			int init(TupleStoreT *tuple_store, size_type threads = 0) {
+				tuple_store_ = tuple_store;
+				int r = pool_.init(threads);
+				workers_.resize(pool_.size());
+				tuples_ = inserted_ = skipped_ = 0;
+				return r;
+			}
+			
+			size_type threads() const { return pool_.size(); }
+			
+			/// Tuples parsed so far.
+			unsigned long tuples() const { return tuples_; }
+			
+			/// Tuples the container took so far (less than tuples() for
+			/// containers that do not hold duplicates).
+			unsigned long inserted() const { return inserted_; }
+			
+			/// Lines skipped (comments, too few elements) so far.
+			unsigned long skipped() const { return skipped_; }
+			
+			/**
+			 * Load the file at @a path, mmapped if it is a regular file.
+			 */
+			int load(const char *path) {
+				int fd = open(path, O_RDONLY);
+				if(fd < 0) { return ERR_UNSPEC; }
+				
+				struct stat st;
+				if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+					close(fd);
+					FILE *f = fopen(path, "r");
+					if(!f) { return ERR_UNSPEC; }
+					int r = load(f);
+					fclose(f);
+					return r;
+				}
+				
+				size_t size = st.st_size;
+				// private writable mapping, lines are parsed in place
+				void *m = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+				close(fd);
+				if(m == MAP_FAILED) { return ERR_UNSPEC; }
+				madvise(m, size, MADV_SEQUENTIAL);
+				
+				char *data = reinterpret_cast<char*>(m);
+				char *end = data + size;
+				for(char *p = data; p < end; ) {
+					char *e = line_boundary(p + BATCH_BYTES, end);
+					load_batch(p, e);
+					p = e;
+				}
+				munmap(m, size);
+				return SUCCESS;
+			}
+			
+			/**
+			 * Load from @a f (a pipe from zcat, say), read in chunks of
+			 * BATCH_BYTES.
+			 */
+			int load(FILE *f) {
+				std::vector<char> buffer(BATCH_BYTES + 1);
+				size_type used = 0;
+				while(true) {
+					if(used == buffer.size() - 1) {
+						// a line longer than the buffer
+						buffer.resize(2 * buffer.size());
+					}
+					size_type n = fread(&buffer[used], 1, buffer.size() - 1 - used, f);
+					used += n;
+					if(n == 0) { break; }
+					
+					char *data = &buffer[0];
+					char *last = reinterpret_cast<char*>(memrchr(data, '\n', used));
+					if(!last) { continue; }
+					
+					load_batch(data, last + 1);
+					size_type rest = data + used - (last + 1);
+					memmove(data, last + 1, rest);
+					used = rest;
+				}
+				if(ferror(f)) { return ERR_UNSPEC; }
+				if(used) {
+					buffer[used] = '\n';
+					load_batch(&buffer[0], &buffer[0] + used + 1);
+				}
+				return SUCCESS;
+			}
+			
+		private:
+			enum { NO_TERM = 0xffffffffUL };
+			
+			struct Term {
+				const char *s;
+				::uint32_t length;
+				hash_t hash;
+				key_type key;
+				/// Number of references by tuples the container took.
+				::uint32_t refs;
+				/// Used in a dictionary column.
+				bool interned;
+			};
+			
+			struct Entry {
+				/// Dictionary keys for dictionary columns, term ids otherwise
+				key_type key[COLUMNS];
+				::uint32_t term[COLUMNS];
+				
+				bool operator<(const Entry& other) const {
+					for(size_type i = 0; i < COLUMNS; i++) {
+						if(key[i] != other.key[i]) { return key[i] < other.key[i]; }
+					}
+					return false;
+				}
+			};
+			
+			struct Worker {
+				char *begin, *end;
+				std::vector<Term> terms;
+				/// Hash index into terms, power of two size.
+				std::vector< ::uint32_t> slots;
+				std::vector<Entry> entries;
+				/// Last line if it had no line break.
+				std::vector<char> tail;
+				SplitN3<OsModel> splitter;
+				unsigned long skipped;
+				
+				void clear() {
+					terms.clear();
+					slots.assign(1024, (::uint32_t)NO_TERM);
+					entries.clear();
+					skipped = 0;
+				}
+				
+				::uint32_t intern(const char *s) {
+					::uint32_t l = strlen(s);
+					hash_t h = Hash::hash(reinterpret_cast<const block_data_t*>(s), l);
+					size_type mask = slots.size() - 1;
+					size_type i = h & mask;
+					for( ; slots[i] != NO_TERM; i = (i + 1) & mask) {
+						Term &t = terms[slots[i]];
+						if(t.hash == h && t.length == l && memcmp(t.s, s, l) == 0) {
+							return slots[i];
+						}
+					}
+					
+					Term t = { s, l, h, key_type(), 0, false };
+					::uint32_t id = terms.size();
+					terms.push_back(t);
+					slots[i] = id;
+					if(terms.size() * 4 > slots.size() * 3) {
+						grow();
+					}
+					return id;
+				}
+				
+				void grow() {
+					slots.assign(2 * slots.size(), (::uint32_t)NO_TERM);
+					size_type mask = slots.size() - 1;
+					for(size_type id = 0; id < terms.size(); id++) {
+						size_type i = terms[id].hash & mask;
+						while(slots[i] != NO_TERM) { i = (i + 1) & mask; }
+						slots[i] = id;
+					}
+				}
+			};
+			
+			/**
+			 * Position after the first line break at or after @a p,
+			 * @a end if there is none.
+			 */
+			static char* line_boundary(char *p, char *end) {
+				if(p >= end) { return end; }
+				char *nl = reinterpret_cast<char*>(memchr(p, '\n', end - p));
+				return nl ? nl + 1 : end;
+			}
+			
+			void load_batch(char *begin, char *end) {
+				size_type n = workers_.size();
+				char *p = begin;
+				for(size_type w = 0; w < n; w++) {
+					workers_[w].begin = p;
+					p = (w + 1 == n) ? end : line_boundary(begin + (end - begin) * (w + 1) / n, end);
+					if(p < workers_[w].begin) { p = workers_[w].begin; }
+					workers_[w].end = p;
+				}
+				
+				pool_.template run<self_type, &self_type::parse>(this);
+				intern_terms();
+				pool_.template run<self_type, &self_type::translate>(this);
+				insert_entries();
+				update_references();
+			}
+			
+			/**
+			 * Worker job: parse the lines of the slice, deduplicate terms.
+			 */
+			void parse(size_type worker, size_type workers) {
+				Worker &w = workers_[worker];
+				w.clear();
+				
+				for(char *p = w.begin; p < w.end; ) {
+					char *nl = reinterpret_cast<char*>(memchr(p, '\n', w.end - p));
+					char *line = p, *eol;
+					if(nl) {
+						*nl = '\0';
+						eol = nl;
+						p = nl + 1;
+					}
+					else {
+						// we can not terminate it in place
+						w.tail.assign(p, w.end);
+						w.tail.push_back('\0');
+						line = &w.tail[0];
+						eol = line + (w.end - p);
+						p = w.end;
+					}
+					if(eol > line && eol[-1] == '\r') {
+						*--eol = '\0';
+					}
+					
+					char *first = skip_whitespace(line);
+					if(*first == '#' || *first == '\0') {
+						w.skipped++;
+						continue;
+					}
+					
+					w.splitter.parse_line_in_place(line, eol);
+					if(w.splitter.size() < COLUMNS) {
+						w.skipped++;
+						continue;
+					}
+					
+					Entry e;
+					for(size_type i = 0; i < COLUMNS; i++) {
+						e.term[i] = w.intern(w.splitter[i]);
+						if(DICTIONARY_COLUMNS & (1 << i)) {
+							w.terms[e.term[i]].interned = true;
+						}
+					}
+					w.entries.push_back(e);
+				}
+			}
+			
+			/**
+			 * Insert every distinct term used in a dictionary column once
+			 * per worker. This reference keeps the key valid until
+			 * update_references().
+			 */
+			void intern_terms() {
+				Dictionary &d = tuple_store_->dictionary();
+				for(size_type w = 0; w < workers_.size(); w++) {
+					std::vector<Term> &terms = workers_[w].terms;
+					for(size_type i = 0; i < terms.size(); i++) {
+						if(terms[i].interned) {
+							terms[i].key = d.insert((block_data_t*)terms[i].s);
+						}
+					}
+				}
+			}
+			
+			/**
+			 * Worker job: translate the terms of the tuples to keys and
+			 * sort them.
+			 */
+			void translate(size_type worker, size_type workers) {
+				Worker &w = workers_[worker];
+				for(size_type j = 0; j < w.entries.size(); j++) {
+					Entry &e = w.entries[j];
+					for(size_type i = 0; i < COLUMNS; i++) {
+						e.key[i] = (DICTIONARY_COLUMNS & (1 << i)) ? w.terms[e.term[i]].key : (key_type)e.term[i];
+					}
+				}
+				std::sort(w.entries.begin(), w.entries.end());
+			}
+			
+			/**
+			 * Merge the sorted runs of the workers into the container.
+			 */
+			void insert_entries() {
+				TupleContainer &container = tuple_store_->container();
+				size_type n = workers_.size();
+				std::vector<size_type> pos(n, 0);
+				
+				while(true) {
+					size_type best = n;
+					for(size_type w = 0; w < n; w++) {
+						if(pos[w] < workers_[w].entries.size() && (best == n ||
+									workers_[w].entries[pos[w]] < workers_[best].entries[pos[best]])) {
+							best = w;
+						}
+					}
+					if(best == n) { break; }
+					
+					Worker &w = workers_[best];
+					Entry &e = w.entries[pos[best]++];
+					Tuple t;
+					for(size_type i = 0; i < COLUMNS; i++) {
+						if(DICTIONARY_COLUMNS & (1 << i)) {
+							t.set_key(i, e.key[i]);
+						}
+						else {
+							t.set_deep(i, (block_data_t*)w.terms[e.term[i]].s);
+						}
+					}
+					
+					size_type sz = container.size();
+					container.insert(t);
+					tuples_++;
+					if(container.size() == sz) {
+						// already there
+						for(size_type i = 0; i < COLUMNS; i++) {
+							if(!(DICTIONARY_COLUMNS & (1 << i))) { t.free_deep(i); }
+						}
+						continue;
+					}
+					inserted_++;
+					for(size_type i = 0; i < COLUMNS; i++) {
+						if(DICTIONARY_COLUMNS & (1 << i)) {
+							w.terms[e.term[i]].refs++;
+						}
+					}
+				}
+			}
+			
+			/**
+			 * Turn the one reference every interned term got into the
+			 * number of tuples referencing it.
+			 */
+			void update_references() {
+				Dictionary &d = tuple_store_->dictionary();
+				for(size_type w = 0; w < workers_.size(); w++) {
+					std::vector<Term> &terms = workers_[w].terms;
+					for(size_type i = 0; i < terms.size(); i++) {
+						Term &t = terms[i];
+						if(!t.interned) { continue; }
+						if(t.refs == 0) {
+							d.erase(t.key);
+						}
+						else if(t.refs > 1) {
+							N3BulkLoader_detail::References<Dictionary>::add(d, t.key, (block_data_t*)t.s, t.refs - 1);
+						}
+					}
+					skipped_ += workers_[w].skipped;
+				}
+			}
+			
+			TupleStoreT *tuple_store_;
+			ThreadPool pool_;
+			std::vector<Worker> workers_;
+			unsigned long tuples_;
+			unsigned long inserted_;
+			unsigned long skipped_;
+			
+			N3BulkLoader(const self_type&);
+			self_type& operator=(const self_type&);
+			
+	}; // N3BulkLoader
+}
+
+#endif // N3_BULK_LOADER_H
+
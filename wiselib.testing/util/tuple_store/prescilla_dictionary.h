@@ -414,6 +414,20 @@ namespace wiselib
             return NULL_KEY;
         }
 
+        /**
+         * Increase the reference count of the given entry by @a n, as
+         * @a n insert()s of its string would (for bulk loading).
+         */
+        void add_references(key_type k, size_type n)
+        {
+            node_pointer entry = reinterpret_cast<node_pointer>(k);
+            if (k == NULL_KEY || entry->count_ == 0)
+            {
+                return;
+            }
+            entry->count_ += n;
+        }
+
         //void erase(DictionaryEntry* entry) {
         void erase(key_type entry_)
         {
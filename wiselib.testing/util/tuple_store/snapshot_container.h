@@ -0,0 +1,426 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef SNAPSHOT_CONTAINER_H
+#define SNAPSHOT_CONTAINER_H
+
+#include <util/serialization/serialization.h>
+#include <util/protobuf/varint.h>
+#include <util/tuple_store/tuplestore.h>
+
+namespace wiselib {
+
+	/**
+	 * \brief Read-only tuple container on a section of sorted, delta
+	 * compressed triples of dictionary keys (as written by encode()),
+	 * e.g. in a memory mapped SnapshotFile.
+	 *
+	 * The section holds every triple three times, sorted in SPO, POS and
+	 * OSP order (permutation k has column (k + j) % 3 at position j). A
+	 * permutation is split into blocks of block_size triples, every block
+	 * is encoded relative to its predecessor triple, starting from
+	 * (0, 0, 0):
+	 *
+	 *   da (varint), then b and c if da > 0,
+	 *   else db, then c if db > 0, else dc.
+	 *
+	 * Section layout (32 bit integers in wiselib byte order):
+	 *
+	 *   size, block_size, offset of every permutation;
+	 *   per permutation: for every block the offset of its data and its
+	 *   first triple, then the data;
+	 *   VarInt::MAX_SIZE bytes of padding.
+	 *
+	 * All offsets are from the section start.
+	 *
+	 * Any combination of bound columns is a prefix of one of the
+	 * permutations, so begin(query, mask) binary searches the block index
+	 * of that permutation, decodes at most one block up to the first
+	 * match and ends the iteration after the last one. TupleStore uses
+	 * this for begin() and begin_raw() through TupleStore_detail::Lookup,
+	 * when all three columns are dictionary columns.
+	 *
+	 * The contents are immutable, there is no insert() or erase().
+	 *
+	 * \tparam Tuple_P Tuple type with SIZE 3 and set_key()/get_key(), as
+	 * used by TupleStore for dictionary columns.
+	 */
+	template<
+		typename OsModel_P,
+		typename Tuple_P
+	>
+	class SnapshotContainer {
+
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef Tuple_P Tuple;
+			typedef Tuple value_type;
+			typedef SnapshotContainer<OsModel_P, Tuple_P> self_type;
+			typedef self_type* self_pointer_t;
+			typedef protobuf::VarInt<OsModel, block_data_t*, ::uint32_t> VarIntT;
+			typedef ::uint32_t key_type;
+			typedef size_type column_mask_t;
+
+			enum ErrorCodes {
+				SUCCESS = OsModel::SUCCESS,
+				ERR_UNSPEC = OsModel::ERR_UNSPEC
+			};
+
+			enum {
+				COLUMNS = 3,
+				PERMUTATIONS = 3,
+				/// size, block_size, permutation offsets
+				HEADER_SIZE = (2 + PERMUTATIONS) * sizeof(::uint32_t),
+				/// data offset, first triple
+				INDEX_ENTRY_SIZE = (1 + COLUMNS) * sizeof(::uint32_t),
+				/// Block size encode() uses by default.
+				BLOCK_SIZE = 64
+			};
+
+			enum { SPO = 0, POS = 1, OSP = 2 };
+
+			/**
+			 * Iterates over the triples of one permutation, in its order,
+			 * as long as they match the prefix it was started with.
+			 */
+			class iterator {
+				public:
+					iterator() : container_(0), p_(0), next_(0), index_(0), permutation_(0), prefix_length_(0) {
+					}
+
+					Tuple& operator*() { return current_; }
+					Tuple* operator->() { return &current_; }
+
+					iterator& operator++() {
+						advance();
+						return *this;
+					}
+
+					bool operator==(const iterator& other) const { return p_ == other.p_; }
+					bool operator!=(const iterator& other) const { return p_ != other.p_; }
+
+				private:
+					/**
+					 * Position on the first triple of @a permutation that is
+					 * not less than @a prefix in its first @a prefix_length
+					 * positions, end() if there is none or it does not
+					 * match.
+					 */
+					void seek(self_pointer_t container, size_type permutation, key_type *prefix, size_type prefix_length) {
+						container_ = container;
+						permutation_ = permutation;
+						prefix_length_ = prefix_length;
+						for(size_type j = 0; j < COLUMNS; j++) {
+							prefix_[j] = (j < prefix_length) ? prefix[j] : 0;
+						}
+						if(!container_->size_) {
+							p_ = 0;
+							return;
+						}
+
+						// first block starting with a triple >= prefix,
+						// matches may start in the block before it
+						size_type lo = 0, hi = container_->blocks_;
+						while(lo < hi) {
+							size_type mid = (lo + hi) / 2;
+							block_data_t *e = container_->index_entry(permutation_, mid);
+							key_type first[COLUMNS];
+							for(size_type j = 0; j < COLUMNS; j++) {
+								first[j] = read32(e + (1 + j) * sizeof(::uint32_t));
+							}
+							if(compare_prefix(first) < 0) { lo = mid + 1; }
+							else { hi = mid; }
+						}
+						size_type block = lo ? lo - 1 : 0;
+
+						index_ = block * container_->block_size_;
+						next_ = container_->data_ + read32(container_->index_entry(permutation_, block));
+						decode();
+						int c;
+						while((c = compare_prefix(triple_)) < 0) {
+							if(++index_ >= container_->size_) {
+								p_ = 0;
+								return;
+							}
+							decode();
+						}
+						if(c > 0) {
+							p_ = 0;
+							return;
+						}
+						update_current();
+					}
+
+					void advance() {
+						if(!p_) { return; }
+						if(++index_ >= container_->size_) {
+							p_ = 0;
+							return;
+						}
+						decode();
+						if(compare_prefix(triple_) != 0) {
+							p_ = 0;
+							return;
+						}
+						update_current();
+					}
+
+					/**
+					 * Decode the triple at next_, triple_ holding its
+					 * predecessor unless it starts a block.
+					 */
+					void decode() {
+						if(index_ % container_->block_size_ == 0) {
+							triple_[0] = triple_[1] = triple_[2] = 0;
+						}
+						p_ = next_;
+						::uint32_t d = 0;
+						next_ = VarIntT::decode(next_, d);
+						if(d) {
+							triple_[0] += d;
+							next_ = VarIntT::decode(next_, triple_[1]);
+							next_ = VarIntT::decode(next_, triple_[2]);
+							return;
+						}
+						next_ = VarIntT::decode(next_, d);
+						if(d) {
+							triple_[1] += d;
+							next_ = VarIntT::decode(next_, triple_[2]);
+							return;
+						}
+						next_ = VarIntT::decode(next_, d);
+						triple_[2] += d;
+					}
+
+					int compare_prefix(key_type *t) {
+						for(size_type j = 0; j < prefix_length_; j++) {
+							if(t[j] != prefix_[j]) { return (t[j] < prefix_[j]) ? -1 : 1; }
+						}
+						return 0;
+					}
+
+					void update_current() {
+						for(size_type j = 0; j < COLUMNS; j++) {
+							current_.set_key((permutation_ + j) % COLUMNS, triple_[j]);
+						}
+					}
+
+					self_pointer_t container_;
+					/// Start of the current triple, 0 at the end.
+					block_data_t *p_;
+					block_data_t *next_;
+					size_type index_;
+					size_type permutation_;
+					size_type prefix_length_;
+					key_type prefix_[COLUMNS];
+					/// Current triple in permutation order.
+					key_type triple_[COLUMNS];
+					Tuple current_;
+
+				friend class SnapshotContainer;
+			};
+
+			SnapshotContainer() : data_(0), size_(0), block_size_(0), blocks_(0) {
+			}
+
+			/**
+			 * Use the triple section at @a data which is @a length bytes
+			 * long. The section has to stay valid (mapped) while the
+			 * container is in use.
+			 *
+			 * @return ERR_UNSPEC if the section is malformed.
+			 */
+			int attach(block_data_t *data, size_type length) {
+				data_ = 0;
+				size_ = blocks_ = 0;
+				if(length < HEADER_SIZE) { return ERR_UNSPEC; }
+
+				::uint32_t size = read32(data);
+				::uint32_t block_size = read32(data + 4);
+				if(size && !block_size) { return ERR_UNSPEC; }
+				size_type blocks = size ? (size + block_size - 1) / block_size : 0;
+				for(size_type k = 0; k < PERMUTATIONS; k++) {
+					::uint32_t offset = read32(data + (2 + k) * sizeof(::uint32_t));
+					if(offset + blocks * INDEX_ENTRY_SIZE + VarIntT::MAX_SIZE > length) { return ERR_UNSPEC; }
+					permutations_[k] = offset;
+				}
+
+				data_ = data;
+				size_ = size;
+				block_size_ = block_size;
+				blocks_ = blocks;
+				return SUCCESS;
+			}
+
+			/// All triples in SPO order.
+			iterator begin() {
+				iterator r;
+				r.seek(this, SPO, 0, 0);
+				return r;
+			}
+
+			/**
+			 * Triples whose columns in @a mask have the keys of @a query,
+			 * from the permutation that has these columns as prefix.
+			 */
+			iterator begin(Tuple& query, column_mask_t mask) {
+				key_type prefix[COLUMNS];
+				size_type l = 0;
+				size_type k = permutation(mask, l);
+				for(size_type j = 0; j < l; j++) {
+					prefix[j] = query.get_key((k + j) % COLUMNS);
+				}
+				iterator r;
+				r.seek(this, k, prefix, l);
+				return r;
+			}
+
+			iterator end() { return iterator(); }
+
+			iterator find(Tuple& query) {
+				return begin(query, (1 << COLUMNS) - 1);
+			}
+
+			size_type size() { return size_; }
+			bool empty() { return size_ == 0; }
+
+			/**
+			 * @return the permutation that has exactly the columns in @a
+			 * mask as prefix, @a length is set to the prefix length.
+			 */
+			static size_type permutation(column_mask_t mask, size_type& length) {
+				length = 0;
+				for(size_type i = 0; i < COLUMNS; i++) {
+					if(mask & (1 << i)) { length++; }
+				}
+				for(size_type k = 0; k < PERMUTATIONS; k++) {
+					column_mask_t m = 0;
+					for(size_type j = 0; j < length; j++) {
+						m |= 1 << ((k + j) % COLUMNS);
+					}
+					if(m == (mask & ((1 << COLUMNS) - 1))) { return k; }
+				}
+				return SPO;
+			}
+
+			/**
+			 * Write a triple section to @a out.
+			 *
+			 * @param permutations for every permutation (SPO, POS, OSP)
+			 * the @a n triples (3 * @a n keys) in the column order of the
+			 * permutation, sorted and distinct.
+			 * @param out where to write the section, 0 to just compute
+			 * its size.
+			 * @return size of the section in bytes.
+			 */
+			static size_type encode(block_data_t *out, key_type **permutations, size_type n, size_type block_size = BLOCK_SIZE) {
+				size_type blocks = (n + block_size - 1) / block_size;
+				size_type pos = HEADER_SIZE;
+				block_data_t varint[3 * VarIntT::MAX_SIZE];
+
+				for(size_type k = 0; k < PERMUTATIONS; k++) {
+					size_type index = pos;
+					if(out) { write32(out + (2 + k) * sizeof(::uint32_t), index); }
+					pos += blocks * INDEX_ENTRY_SIZE;
+
+					key_type *t = permutations[k];
+					key_type prev[COLUMNS] = { 0, 0, 0 };
+					for(size_type i = 0; i < n; i++, t += COLUMNS) {
+						if(i % block_size == 0) {
+							prev[0] = prev[1] = prev[2] = 0;
+							if(out) {
+								block_data_t *e = out + index + (i / block_size) * INDEX_ENTRY_SIZE;
+								write32(e, pos);
+								for(size_type j = 0; j < COLUMNS; j++) {
+									write32(e + (1 + j) * sizeof(::uint32_t), t[j]);
+								}
+							}
+						}
+
+						block_data_t *v = varint;
+						if(t[0] != prev[0]) {
+							v = VarIntT::encode(v, t[0] - prev[0]);
+							v = VarIntT::encode(v, t[1]);
+							v = VarIntT::encode(v, t[2]);
+						}
+						else {
+							v = VarIntT::encode(v, 0);
+							if(t[1] != prev[1]) {
+								v = VarIntT::encode(v, t[1] - prev[1]);
+								v = VarIntT::encode(v, t[2]);
+							}
+							else {
+								v = VarIntT::encode(v, 0);
+								v = VarIntT::encode(v, t[2] - prev[2]);
+							}
+						}
+						if(out) { memcpy(out + pos, varint, v - varint); }
+						pos += v - varint;
+						prev[0] = t[0];
+						prev[1] = t[1];
+						prev[2] = t[2];
+					}
+				}
+
+				if(out) {
+					write32(out, n);
+					write32(out + 4, block_size);
+					memset(out + pos, 0, VarIntT::MAX_SIZE);
+				}
+				return pos + VarIntT::MAX_SIZE;
+			}
+
+		private:
+			static ::uint32_t read32(block_data_t *p) {
+				return wiselib::read<OsModel, block_data_t, ::uint32_t>(p);
+			}
+
+			static void write32(block_data_t *p, ::uint32_t v) {
+				wiselib::write<OsModel, block_data_t, ::uint32_t>(p, v);
+			}
+
+			block_data_t* index_entry(size_type permutation, size_type block) {
+				return data_ + permutations_[permutation] + block * INDEX_ENTRY_SIZE;
+			}
+
+			block_data_t *data_;
+			size_type size_;
+			size_type block_size_;
+			size_type blocks_;
+			::uint32_t permutations_[PERMUTATIONS];
+
+	}; // SnapshotContainer
+
+	namespace TupleStore_detail {
+		template<typename OsModel_P, typename Tuple_P>
+		struct Lookup< SnapshotContainer<OsModel_P, Tuple_P> > {
+			typedef SnapshotContainer<OsModel_P, Tuple_P> Container;
+
+			template<typename Mask>
+			static typename Container::iterator begin(Container& c, Tuple_P& query, Mask mask) {
+				return c.begin(query, mask);
+			}
+		};
+	}
+}
+
+#endif // SNAPSHOT_CONTAINER_H
+
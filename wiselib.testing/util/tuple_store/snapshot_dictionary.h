@@ -0,0 +1,363 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+#ifndef SNAPSHOT_DICTIONARY_H
+#define SNAPSHOT_DICTIONARY_H
+
+#include <util/serialization/serialization.h>
+#include <util/protobuf/varint.h>
+
+namespace wiselib {
+
+	/**
+	 * \brief Read-only string dictionary on a sorted, front coded string
+	 * section (as written by encode()), e.g. in a memory mapped
+	 * SnapshotFile.
+	 *
+	 * The key of a string is its rank in strcmp() order plus one, so
+	 * keys are 1..size() and compare like their strings. Strings are
+	 * stored in buckets of bucket_size: the first string of a bucket (its
+	 * head) in full, every other one as the length of the prefix it shares
+	 * with its predecessor (varint) followed by the rest of it. Section
+	 * layout (32 bit integers in wiselib byte order):
+	 *
+	 *   size, bucket_size, max_length (with terminator),
+	 *   offset of every bucket (from the section start),
+	 *   the buckets, VarInt::MAX_SIZE bytes of padding.
+	 *
+	 * find() binary searches the bucket heads and decodes at most one
+	 * bucket, get_value() decodes up to the string. Nothing is copied on
+	 * attach(), the only memory allocated are two buffers of max_length
+	 * bytes.
+	 *
+	 * The contents are immutable: insert() only returns the key of
+	 * strings that are already there (NULL_KEY otherwise), erase() does
+	 * nothing and there is no reference counting.
+	 *
+	 * \ingroup ConcreteBDTDictionary_concept
+	 */
+	template<
+		typename OsModel_P
+	>
+	class SnapshotDictionary {
+
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef SnapshotDictionary<OsModel_P> self_type;
+			typedef self_type* self_pointer_t;
+			typedef protobuf::VarInt<OsModel, block_data_t*, ::uint32_t> VarIntT;
+
+			typedef ::uint32_t key_type;
+			typedef block_data_t* mapped_type;
+
+			enum { ABSTRACT_KEYS = true };
+			static const key_type NULL_KEY;
+
+			enum ErrorCodes {
+				SUCCESS = OsModel::SUCCESS,
+				ERR_UNSPEC = OsModel::ERR_UNSPEC
+			};
+
+			enum {
+				/// size, bucket_size, max_length
+				HEADER_SIZE = 3 * sizeof(::uint32_t),
+				/// Bucket size encode() uses by default.
+				BUCKET_SIZE = 16
+			};
+
+			/**
+			 * Iterates over all keys in order.
+			 */
+			class key_iterator {
+				public:
+					key_iterator() : key_(NULL_KEY), size_(0) {
+					}
+
+					key_iterator(key_type k, size_type size) : key_(k), size_(size) {
+						if(key_ > size_) { key_ = NULL_KEY; }
+					}
+
+					bool operator==(const key_iterator& other) { return key_ == other.key_; }
+					bool operator!=(const key_iterator& other) { return key_ != other.key_; }
+
+					const key_iterator& operator++() {
+						key_ = (key_ < size_) ? key_ + 1 : NULL_KEY;
+						return *this;
+					}
+
+					key_type operator*() { return key_; }
+					const key_type* operator->() const { return &key_; }
+
+				private:
+					key_type key_;
+					size_type size_;
+			};
+			typedef key_iterator iterator;
+
+			SnapshotDictionary() : data_(0), size_(0), bucket_size_(0), buckets_(0), max_length_(0), value_(0), probe_(0) {
+			}
+
+			~SnapshotDictionary() {
+				destruct();
+			}
+
+			int init(typename OsModel::Debug::self_pointer_t debug) {
+				debug_ = debug;
+				return SUCCESS;
+			}
+
+			/**
+			 * Use the string section at @a data which is @a length bytes
+			 * long. The section has to stay valid (mapped) while the
+			 * dictionary is in use.
+			 *
+			 * @return ERR_UNSPEC if the section is malformed.
+			 */
+			int attach(block_data_t *data, size_type length) {
+				destruct();
+				if(length < HEADER_SIZE) { return ERR_UNSPEC; }
+
+				::uint32_t size = read32(data);
+				::uint32_t bucket_size = read32(data + 4);
+				::uint32_t max_length = read32(data + 8);
+				if(size && (!bucket_size || !max_length)) { return ERR_UNSPEC; }
+
+				size_type buckets = size ? (size + bucket_size - 1) / bucket_size : 0;
+				if(HEADER_SIZE + buckets * sizeof(::uint32_t) + VarIntT::MAX_SIZE > length) { return ERR_UNSPEC; }
+				for(size_type b = 0; b < buckets; b++) {
+					if(read32(data + HEADER_SIZE + b * sizeof(::uint32_t)) >= length) { return ERR_UNSPEC; }
+				}
+
+				data_ = data;
+				size_ = size;
+				bucket_size_ = bucket_size;
+				buckets_ = buckets;
+				max_length_ = max_length;
+				if(max_length_) {
+					value_ = get_allocator().template allocate_array<block_data_t>(max_length_) .raw();
+					probe_ = get_allocator().template allocate_array<block_data_t>(max_length_) .raw();
+				}
+				return SUCCESS;
+			}
+
+			/// Detach from the section, the dictionary is empty afterwards.
+			int destruct() {
+				if(value_) { get_allocator().free_array(value_); }
+				if(probe_) { get_allocator().free_array(probe_); }
+				data_ = 0;
+				size_ = 0;
+				bucket_size_ = 0;
+				buckets_ = 0;
+				max_length_ = 0;
+				value_ = 0;
+				probe_ = 0;
+				return SUCCESS;
+			}
+
+			key_iterator begin_keys() { return key_iterator(1, size_); }
+			key_iterator end_keys() { return key_iterator(); }
+
+			/**
+			 * The dictionary is read-only.
+			 * @return key of @a value if it is there, NULL_KEY otherwise.
+			 */
+			key_type insert(mapped_type value) { return find(value); }
+
+			/// The dictionary is read-only, does nothing.
+			void erase(key_type k) { }
+
+			/**
+			 * @return key of the given string or NULL_KEY if it is not
+			 * in the dictionary.
+			 */
+			key_type find(mapped_type value) {
+				if(!size_) { return NULL_KEY; }
+
+				// last bucket whose head is <= value
+				size_type lo = 0, hi = buckets_;
+				while(hi - lo > 1) {
+					size_type mid = (lo + hi) / 2;
+					if(compare(head(mid), value) <= 0) { lo = mid; }
+					else { hi = mid; }
+				}
+
+				block_data_t *p = head(lo);
+				int c = compare(p, value);
+				if(c == 0) { return lo * bucket_size_ + 1; }
+				if(c > 0) { return NULL_KEY; }
+
+				size_type l = strlen((char*)p) + 1;
+				memcpy(probe_, p, l);
+				p += l;
+				size_type n = bucket_length(lo);
+				for(size_type i = 1; i < n; i++) {
+					p = decode(p, probe_);
+					c = compare(probe_, value);
+					if(c == 0) { return lo * bucket_size_ + i + 1; }
+					if(c > 0) { break; }
+				}
+				return NULL_KEY;
+			}
+
+			/**
+			 * @return the string for the given key, valid until the next
+			 * get_value() (a bucket head is returned directly from the
+			 * section though), 0 for an invalid key.
+			 */
+			mapped_type get_value(key_type k) {
+				if(k == NULL_KEY || k > size_) { return 0; }
+				size_type b = (k - 1) / bucket_size_;
+				size_type i = (k - 1) % bucket_size_;
+
+				block_data_t *p = head(b);
+				if(i == 0) { return p; }
+
+				size_type l = strlen((char*)p) + 1;
+				memcpy(value_, p, l);
+				p += l;
+				for( ; i; i--) {
+					p = decode(p, value_);
+				}
+				return value_;
+			}
+
+			mapped_type get(key_type k) { return get_value(k); }
+			mapped_type operator[](key_type k) { return get_value(k); }
+
+			void free_value(mapped_type v) { }
+
+			/**
+			 * @return 1 for every string in the dictionary, there is no
+			 * reference counting.
+			 */
+			size_type count(key_type k) { return (k != NULL_KEY && k <= size_) ? 1 : 0; }
+
+			/// Number of strings.
+			size_type size() { return size_; }
+
+			/// Bytes allocated (not counting the section).
+			size_type memory() { return 2 * max_length_; }
+
+			/**
+			 * Write a string section for the @a n strings in @a strings,
+			 * which have to be sorted in strcmp() order and distinct, to
+			 * @a out. The string strings[i] gets the key i + 1.
+			 *
+			 * @param out where to write the section, 0 to just compute
+			 * its size.
+			 * @return size of the section in bytes.
+			 */
+			static size_type encode(block_data_t *out, mapped_type *strings, size_type n, size_type bucket_size = BUCKET_SIZE) {
+				size_type buckets = (n + bucket_size - 1) / bucket_size;
+				size_type pos = HEADER_SIZE + buckets * sizeof(::uint32_t);
+				size_type max_length = 0;
+				block_data_t varint[VarIntT::MAX_SIZE];
+
+				for(size_type i = 0; i < n; i++) {
+					char *s = (char*)strings[i];
+					size_type l = strlen(s) + 1;
+					if(l > max_length) { max_length = l; }
+
+					if(i % bucket_size == 0) {
+						if(out) {
+							write32(out + HEADER_SIZE + (i / bucket_size) * sizeof(::uint32_t), pos);
+							memcpy(out + pos, s, l);
+						}
+						pos += l;
+						continue;
+					}
+
+					char *prev = (char*)strings[i - 1];
+					size_type shared = 0;
+					while(prev[shared] && prev[shared] == s[shared]) { shared++; }
+					size_type vl = VarIntT::encode(varint, shared) - varint;
+					if(out) {
+						memcpy(out + pos, varint, vl);
+						memcpy(out + pos + vl, s + shared, l - shared);
+					}
+					pos += vl + l - shared;
+				}
+
+				if(out) {
+					write32(out, n);
+					write32(out + 4, bucket_size);
+					write32(out + 8, max_length);
+					memset(out + pos, 0, VarIntT::MAX_SIZE);
+				}
+				return pos + VarIntT::MAX_SIZE;
+			}
+
+		private:
+			static ::uint32_t read32(block_data_t *p) {
+				return wiselib::read<OsModel, block_data_t, ::uint32_t>(p);
+			}
+
+			static void write32(block_data_t *p, ::uint32_t v) {
+				wiselib::write<OsModel, block_data_t, ::uint32_t>(p, v);
+			}
+
+			static int compare(block_data_t *a, block_data_t *b) {
+				return strcmp((char*)a, (char*)b);
+			}
+
+			block_data_t* head(size_type b) {
+				return data_ + read32(data_ + HEADER_SIZE + b * sizeof(::uint32_t));
+			}
+
+			/// Number of strings in bucket @a b.
+			size_type bucket_length(size_type b) {
+				size_type n = size_ - b * bucket_size_;
+				return (n < bucket_size_) ? n : bucket_size_;
+			}
+
+			/**
+			 * Decode the string at @a p into @a buffer which holds its
+			 * predecessor.
+			 * @return position after the string.
+			 */
+			static block_data_t* decode(block_data_t *p, block_data_t *buffer) {
+				::uint32_t shared = 0;
+				p = VarIntT::decode(p, shared);
+				size_type l = strlen((char*)p) + 1;
+				memcpy(buffer + shared, p, l);
+				return p + l;
+			}
+
+			block_data_t *data_;
+			size_type size_;
+			size_type bucket_size_;
+			size_type buckets_;
+			size_type max_length_;
+			/// Decoding buffers for get_value() and find().
+			block_data_t *value_;
+			block_data_t *probe_;
+			typename OsModel::Debug::self_pointer_t debug_;
+
+	}; // SnapshotDictionary
+
+	template<
+		typename OsModel_P
+	>
+	const typename SnapshotDictionary<OsModel_P>::key_type SnapshotDictionary<OsModel_P>::NULL_KEY = 0;
+}
+
+#endif // SNAPSHOT_DICTIONARY_H
+
@@ -0,0 +1,305 @@
+/***************************************************************************
+ ** This file is part of the generic algorithm library Wiselib.           **
+ ** Copyright (C) 2008,2009 by the Wisebed (www.wisebed.eu) project.      **
+ **                                                                       **
+ ** The Wiselib is free software: you can redistribute it and/or modify   **
+ ** it under the terms of the GNU Lesser General Public License as        **
+ ** published by the Free Software Foundation, either version 3 of the    **
+ ** License, or (at your option) any later version.                       **
+ **                                                                       **
+ ** The Wiselib is distributed in the hope that it will be useful,        **
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+ ** GNU Lesser General Public License for more details.                   **
+ **                                                                       **
+ ** You should have received a copy of the GNU Lesser General Public      **
+ ** License along with the Wiselib.                                       **
+ ** If not, see <http://www.gnu.org/licenses/>.                           **
+ ***************************************************************************/
+
+
+#ifndef SNAPSHOT_FILE_H
+#define SNAPSHOT_FILE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
+
+#include "util/tuple_store/snapshot_dictionary.h"
+#include "util/tuple_store/snapshot_container.h"
+
+namespace wiselib {
+
+	namespace SnapshotFile_detail {
+
+		/**
+		 * Orders indices into a table of strings by strcmp() of the
+		 * strings.
+		 */
+		struct StringLess {
+			StringLess(char **strings) : strings_(strings) { }
+			bool operator()(size_t a, size_t b) const { return strcmp(strings_[a], strings_[b]) < 0; }
+			char **strings_;
+		};
+
+		/**
+		 * Triple of keys, ordered lexicographically.
+		 */
+		struct Triple {
+			::uint32_t k[3];
+
+			bool operator<(const Triple& other) const {
+				for(int j = 0; j < 3; j++) {
+					if(k[j] != other.k[j]) { return k[j] < other.k[j]; }
+				}
+				return false;
+			}
+			bool operator==(const Triple& other) const {
+				return k[0] == other.k[0] && k[1] == other.k[1] && k[2] == other.k[2];
+			}
+		};
+	}
+
+	/**
+	 * @brief Immutable, memory mapped snapshot of a triple store.
+	 *
+	 * write() saves the contents of a TupleStore whose three columns are
+	 * all dictionary columns, open() maps such a file read-only and sets
+	 * up dictionary() (a SnapshotDictionary) and container() (a
+	 * SnapshotContainer) directly on the mapping. A TupleStore over these
+	 * two answers queries without loading or interning anything, the
+	 * pages of the file are read in by the kernel as lookups touch them
+	 * and can be shared by several processes.
+	 *
+	 * File layout (32 bit integers in wiselib byte order):
+	 *
+	 *   MAGIC, VERSION,
+	 *   string section (see SnapshotDictionary),
+	 *   triple section (see SnapshotContainer),
+	 *   footer: offset and length of both sections, VERSION, MAGIC.
+	 *
+	 * The footer is at the very end so a reader finds the sections
+	 * without parsing anything. Sections and offsets are 32 bit, so a
+	 * snapshot is limited to 4 GiB.
+	 *
+	 * Uses mmap and the STL, so this is for PC only.
+	 *
+	 * @tparam Tuple_P Tuple type of the TupleStore that is to use the
+	 * snapshot.
+	 */
+	template<
+		typename OsModel_P,
+		typename Tuple_P
+	>
+	class SnapshotFile {
+
+		public:
+			typedef OsModel_P OsModel;
+			typedef typename OsModel::block_data_t block_data_t;
+			typedef typename OsModel::size_t size_type;
+			typedef SnapshotFile<OsModel_P, Tuple_P> self_type;
+			typedef Tuple_P Tuple;
+			typedef SnapshotDictionary<OsModel> Dictionary;
+			typedef SnapshotContainer<OsModel, Tuple> Container;
+			typedef typename Dictionary::key_type key_type;
+
+			enum { SUCCESS = OsModel::SUCCESS, ERR_UNSPEC = OsModel::ERR_UNSPEC };
+			enum {
+				MAGIC = 0x57534e50UL, // "WSNP"
+				VERSION = 1,
+				HEADER_SIZE = 2 * sizeof(::uint32_t),
+				FOOTER_SIZE = 6 * sizeof(::uint32_t)
+			};
+
+			SnapshotFile() : data_(0), size_(0) {
+			}
+
+			~SnapshotFile() {
+				close();
+			}
+
+			/**
+			 * Map the snapshot at @a path.
+			 * @return ERR_UNSPEC if it can not be mapped or is not a valid
+			 * snapshot.
+			 */
+			int open(const char *path) {
+				close();
+				int fd = ::open(path, O_RDONLY);
+				if(fd < 0) { return ERR_UNSPEC; }
+
+				struct stat st;
+				if(fstat(fd, &st) != 0 || st.st_size < (off_t)(HEADER_SIZE + FOOTER_SIZE)) {
+					::close(fd);
+					return ERR_UNSPEC;
+				}
+				size_type size = st.st_size;
+				void *m = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+				::close(fd);
+				if(m == MAP_FAILED) { return ERR_UNSPEC; }
+				data_ = reinterpret_cast<block_data_t*>(m);
+				size_ = size;
+
+				block_data_t *footer = data_ + size_ - FOOTER_SIZE;
+				::uint32_t d_offset = read32(footer);
+				::uint32_t d_length = read32(footer + 4);
+				::uint32_t c_offset = read32(footer + 8);
+				::uint32_t c_length = read32(footer + 12);
+				if(read32(data_) != MAGIC || read32(data_ + 4) != VERSION
+						|| read32(footer + 16) != VERSION || read32(footer + 20) != MAGIC
+						|| (size_type)d_offset + d_length > size_ - FOOTER_SIZE
+						|| (size_type)c_offset + c_length > size_ - FOOTER_SIZE
+						|| dictionary_.attach(data_ + d_offset, d_length) != SUCCESS
+						|| container_.attach(data_ + c_offset, c_length) != SUCCESS) {
+					close();
+					return ERR_UNSPEC;
+				}
+				return SUCCESS;
+			}
+
+			void close() {
+				dictionary_.destruct();
+				container_.attach(0, 0);
+				if(data_) {
+					munmap(data_, size_);
+				}
+				data_ = 0;
+				size_ = 0;
+			}
+
+			Dictionary& dictionary() { return dictionary_; }
+			Container& container() { return container_; }
+
+			/// Size of the mapped file.
+			size_type size() { return size_; }
+
+			/**
+			 * Write a snapshot of @a tuple_store to @a path. All three
+			 * columns of the tuple store have to be dictionary columns.
+			 */
+			template<typename TupleStore_P>
+			static int write(TupleStore_P& tuple_store, const char *path,
+					size_type bucket_size = Dictionary::BUCKET_SIZE, size_type block_size = Container::BLOCK_SIZE) {
+				typedef typename TupleStore_P::TupleContainer TupleContainer;
+				typedef typename TupleStore_P::Dictionary SourceDictionary;
+				typedef typename SourceDictionary::key_type source_key_t;
+				typedef SnapshotFile_detail::Triple Triple;
+
+				if(TupleStore_P::COLUMNS != 3 || TupleStore_P::DICTIONARY_COLUMNS != 7) { return ERR_UNSPEC; }
+
+				TupleContainer &container = tuple_store.container();
+				SourceDictionary &dictionary = tuple_store.dictionary();
+
+				// distinct keys and their strings, sorted
+				std::vector<source_key_t> keys;
+				for(typename TupleContainer::iterator it = container.begin(); it != container.end(); ++it) {
+					for(size_type i = 0; i < 3; i++) { keys.push_back(it->get_key(i)); }
+				}
+				std::sort(keys.begin(), keys.end());
+				keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+				std::vector<char> arena;
+				std::vector<size_type> offsets(keys.size());
+				for(size_type i = 0; i < keys.size(); i++) {
+					block_data_t *v = dictionary.get_value(keys[i]);
+					offsets[i] = arena.size();
+					arena.insert(arena.end(), (char*)v, (char*)v + strlen((char*)v) + 1);
+					dictionary.free_value(v);
+				}
+				std::vector<char*> strings(keys.size());
+				std::vector<size_type> order(keys.size());
+				for(size_type i = 0; i < keys.size(); i++) {
+					strings[i] = &arena[offsets[i]];
+					order[i] = i;
+				}
+				if(!strings.empty()) {
+					std::sort(order.begin(), order.end(), SnapshotFile_detail::StringLess(&strings[0]));
+				}
+
+				// new key of every string: its rank + 1
+				std::vector<key_type> rank(keys.size());
+				std::vector<block_data_t*> sorted(keys.size());
+				for(size_type i = 0; i < order.size(); i++) {
+					rank[order[i]] = i + 1;
+					sorted[i] = (block_data_t*)strings[order[i]];
+				}
+
+				std::vector<Triple> permutations[Container::PERMUTATIONS];
+				for(typename TupleContainer::iterator it = container.begin(); it != container.end(); ++it) {
+					key_type t[3];
+					for(size_type i = 0; i < 3; i++) {
+						t[i] = rank[std::lower_bound(keys.begin(), keys.end(), (source_key_t)it->get_key(i)) - keys.begin()];
+					}
+					for(size_type k = 0; k < Container::PERMUTATIONS; k++) {
+						Triple p;
+						for(size_type j = 0; j < 3; j++) { p.k[j] = t[(k + j) % 3]; }
+						permutations[k].push_back(p);
+					}
+				}
+				// a Triple is just its three keys, so the vectors are the
+				// flat key arrays encode() wants
+				key_type *triples[Container::PERMUTATIONS];
+				for(size_type k = 0; k < Container::PERMUTATIONS; k++) {
+					std::sort(permutations[k].begin(), permutations[k].end());
+					permutations[k].erase(std::unique(permutations[k].begin(), permutations[k].end()), permutations[k].end());
+					triples[k] = permutations[k].empty() ? 0 : permutations[k][0].k;
+				}
+				size_type n = permutations[0].size();
+
+				block_data_t **s = sorted.empty() ? 0 : &sorted[0];
+
+				unsigned long long d_length = Dictionary::encode(0, s, sorted.size(), bucket_size);
+				unsigned long long c_length = Container::encode(0, triples, n, block_size);
+				unsigned long long total = HEADER_SIZE + d_length + c_length + FOOTER_SIZE;
+				if(total > 0xffffffffULL) { return ERR_UNSPEC; }
+
+				std::vector<block_data_t> out(total);
+				block_data_t *p = &out[0];
+				::uint32_t d_offset = HEADER_SIZE;
+				::uint32_t c_offset = HEADER_SIZE + d_length;
+				write32(p, MAGIC);
+				write32(p + 4, VERSION);
+				Dictionary::encode(p + d_offset, s, sorted.size(), bucket_size);
+				Container::encode(p + c_offset, triples, n, block_size);
+				block_data_t *footer = p + total - FOOTER_SIZE;
+				write32(footer, d_offset);
+				write32(footer + 4, d_length);
+				write32(footer + 8, c_offset);
+				write32(footer + 12, c_length);
+				write32(footer + 16, VERSION);
+				write32(footer + 20, MAGIC);
+
+				FILE *f = fopen(path, "wb");
+				if(!f) { return ERR_UNSPEC; }
+				bool ok = fwrite(p, 1, total, f) == total;
+				ok = (fclose(f) == 0) && ok;
+				return ok ? SUCCESS : ERR_UNSPEC;
+			}
+
+		private:
+			static ::uint32_t read32(block_data_t *p) {
+				return wiselib::read<OsModel, block_data_t, ::uint32_t>(p);
+			}
+
+			static void write32(block_data_t *p, ::uint32_t v) {
+				wiselib::write<OsModel, block_data_t, ::uint32_t>(p, v);
+			}
+
+			block_data_t *data_;
+			size_type size_;
+			Dictionary dictionary_;
+			Container container_;
+
+			SnapshotFile(const self_type&);
+			self_type& operator=(const self_type&);
+
+	}; // SnapshotFile
+}
+
+#endif // SNAPSHOT_FILE_H
+
@@ -388,6 +388,20 @@ namespace wiselib {
 			};
 			
 		// }}}
+		
+		/**
+		 * Where a scan for the keys of @a query in the columns of @a mask
+		 * starts. The default scans the whole container, containers with
+		 * an index (SnapshotContainer) specialize this to start at the
+		 * first match and end after the last one.
+		 */
+		template<typename TupleContainer_P>
+		struct Lookup {
+			template<typename Tuple, typename Mask>
+			static typename TupleContainer_P::iterator begin(TupleContainer_P& c, Tuple& query, Mask mask) {
+				return c.begin();
+			}
+		};
 	} // namespace
 	
 	/**
@@ -419,6 +433,7 @@ namespace wiselib {
 			typedef typename TupleContainer::iterator ContainerIterator;
 			typedef size_type column_mask_t;
 			typedef self_type ParentTupleStore;
+			typedef ::uint32_t version_t;
 			
 			enum {
 				COLUMNS = Tuple::SIZE,
@@ -430,7 +445,7 @@ namespace wiselib {
 				OsModel, self_type, DICTIONARY_COLUMNS, Compare_P
 			> iterator;
 			
-			TupleStore() : container_(0), dictionary_(0) { }
+			TupleStore() : container_(0), dictionary_(0), version_(0) { }
 			~TupleStore() { } // ~TupleStore
 			
 			TupleStore& parent_tuple_store() { return *this; }
@@ -439,6 +454,7 @@ namespace wiselib {
 				debug_ = debug;
 				dictionary_ = dict;
 				container_ = container;
+				version_ = 0;
 			}
 			
 			template<typename UserTuple>
@@ -471,6 +487,9 @@ namespace wiselib {
 						}
 					}
 				}
+				else {
+					version_++;
+				}
 				return iterator(ci, container_->end(), dictionary_, 0, 0);
 			} // insert()
 			
@@ -514,6 +533,9 @@ namespace wiselib {
 						}
 					}
 				}
+				else {
+					version_++;
+				}
 				return iterator(ci, container_->end(), dictionary_, 0, 0);
 			} // insert()
 			
@@ -543,6 +565,7 @@ namespace wiselib {
 				
 				// now remove tuple from the container, yielding a new iterator
 				ContainerIterator nextc = container_->erase(iter.container_iterator());
+				version_++;
 				iterator r = iterator(
 						nextc,
 						container_->end(),
@@ -575,7 +598,7 @@ namespace wiselib {
 					return end();
 				}
 				else {
-					r.container_iterator_ = container_->begin();
+					r.container_iterator_ = TupleStore_detail::Lookup<TupleContainer>::begin(*container_, r.query_, mask);
 					r.container_end_ = container_->end();
 					r.set_dictionary(dictionary_);
 					r.column_mask_ = mask;
@@ -584,6 +607,32 @@ namespace wiselib {
 				}
 			}
 			
+			/**
+			 * Like @a begin(), but expect a raw query, that is a tuple that
+			 * contains dictionary keys instead of the resolved strings.
+			 * Dictionary columns are then matched by key without any
+			 * dictionary lookups.
+			 */
+			iterator begin_raw(Tuple& query, column_mask_t mask) {
+				iterator r;
+				r.set_dictionary(dictionary_);
+				for(size_type i = 0; i < COLUMNS; i++) {
+					if(mask & (1 << i)) {
+						if(DICTIONARY_COLUMNS && (DICTIONARY_COLUMNS & (1 << i))) {
+							r.query_.set_key(i, query.get_key(i));
+						}
+						else {
+							r.query_.set_deep(i, query.get(i));
+						}
+					}
+				}
+				r.container_iterator_ = TupleStore_detail::Lookup<TupleContainer>::begin(*container_, r.query_, mask);
+				r.container_end_ = container_->end();
+				r.column_mask_ = mask;
+				r.forward();
+				return r;
+			}
+			
 			iterator end() {
 				return iterator(
 						container_->end(),
@@ -630,6 +679,12 @@ namespace wiselib {
 			size_type size() { return container_->size(); }
 			bool empty() { return container_->empty(); }
 			
+			/**
+			 * Number of tuples inserted into or erased from this store so
+			 * far. Equal versions mean equal contents.
+			 */
+			version_t version() { return version_; }
+			
 			void check() {
 				assert(container_ != 0);
 				assert(dictionary_ != 0);
@@ -685,6 +740,7 @@ namespace wiselib {
 			TupleContainer *container_;
 			Dictionary *dictionary_;
 			typename Debug::self_pointer_t debug_;
+			version_t version_;
 	};
 	
 	
@@ -712,6 +768,7 @@ namespace wiselib {
 			typedef typename TupleContainer::iterator ContainerIterator;
 			typedef size_type column_mask_t;
 			typedef self_type ParentTupleStore;
+			typedef ::uint32_t version_t;
 			
 			enum {
 				COLUMNS = Tuple::SIZE,
@@ -730,6 +787,7 @@ namespace wiselib {
 			void init(Dictionary* dict, TupleContainer* container, typename Debug::self_pointer_t debug) {
 				debug_ = debug;
 				container_ = container;
+				version_ = 0;
 			}
 			
 			template<typename UserTuple>
@@ -743,6 +801,9 @@ namespace wiselib {
 				if(container_->size() == sz) {
 					tmp.destruct_deep();
 				}
+				else {
+					version_++;
+				}
 				
 				return iterator(ci, container_->end(), 0, 0);
 			}
@@ -763,6 +824,7 @@ namespace wiselib {
 				
 				// now remove tuple from the container, yielding a new iterator
 				ContainerIterator nextc = container_->erase(iter.container_iterator());
+				version_++;
 				iterator r = iterator(
 						nextc,
 						container_->end(),
@@ -801,6 +863,13 @@ namespace wiselib {
 				return r;
 			}
 			
+			/**
+			 * Without dictionary columns a raw query is just a query.
+			 */
+			iterator begin_raw(Tuple& query, column_mask_t mask) {
+				return begin(&query, mask);
+			}
+			
 			iterator end() {
 				return iterator(
 						container_->end(),
@@ -829,12 +898,19 @@ namespace wiselib {
 			size_type size() { return container_->size(); }
 			bool empty() { return container_->empty(); }
 			
+			/**
+			 * Number of tuples inserted into or erased from this store so
+			 * far. Equal versions mean equal contents.
+			 */
+			version_t version() { return version_; }
+			
 			//Dictionary& dictionary() { return *dictionary_; }
 			
 		//private:
 			
 			TupleContainer *container_;
 			typename Debug::self_pointer_t debug_;
+			version_t version_;
 	};
 }
 